@@ -48,6 +48,7 @@ typedef enum wavefmt_t : char
     FMT_FLAC,
     FMT_XA,
     FMT_XMP,
+    FMT_PCM,  // decoded Vorbis, FLAC or XA data from the PCM cache
     FMT_MAX
 } wavefmt_t;
 
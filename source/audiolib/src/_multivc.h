@@ -114,6 +114,9 @@ private:
 
 #define MV_MAXVOICES 256
 
+#define MV_MAXMIXTHREADS      8
+#define MV_MINVOICESPERTHREAD 8  // fewer voices than this are not worth handing to another thread
+
 typedef enum : bool
 {
     NoMoreData,
@@ -174,6 +177,7 @@ typedef struct VoiceNode
     uint32_t RateScale;
     uint32_t position;
     std::atomic<int> Paused;
+    std::atomic<int> Stopped;  // set by whichever of MV_Kill() and the mixer ends the voice first
 
     int handle;
     int priority;
@@ -181,6 +185,32 @@ typedef struct VoiceNode
     async::task<int> task;
 } VoiceNode;
 
+// The float mixers ramp the panned volume towards the goal volume the same way SMOOTH_VOLUME() does, as
+// goal + (panned - goal) * (1 - MV_VolumeSmoothFactor)^n for the nth frame mixed.
+typedef struct
+{
+    float goal[2];   // goal volume of each output channel, times the voice and global volume
+    float delta[2];  // panned - goal volume of each output channel, times the voice and global volume
+    float decay;     // 1 - MV_VolumeSmoothFactor
+    float ramp;      // decay^n after n frames, what is left of delta
+} mixvolume_t;
+
+static FORCE_INLINE mixvolume_t MV_GetMixVolume(VoiceNode const *voice)
+{
+    float const scale = fix16_to_float(voice->volume) * fix16_to_float(MV_GlobalVolume);
+
+    return { { fix16_to_float(voice->GoalVolume.Left) * scale, fix16_to_float(voice->GoalVolume.Right) * scale },
+             { fix16_to_float(voice->PannedVolume.Left - voice->GoalVolume.Left) * scale,
+               fix16_to_float(voice->PannedVolume.Right - voice->GoalVolume.Right) * scale },
+             1.f - fix16_to_float(MV_VolumeSmoothFactor), 1.f };
+}
+
+static FORCE_INLINE void MV_PutMixVolume(VoiceNode *voice, mixvolume_t const &vol)
+{
+    voice->PannedVolume = { voice->GoalVolume.Left + fix16_from_float(fix16_to_float(voice->PannedVolume.Left - voice->GoalVolume.Left) * vol.ramp),
+                            voice->GoalVolume.Right + fix16_from_float(fix16_to_float(voice->PannedVolume.Right - voice->GoalVolume.Right) * vol.ramp) };
+}
+
 typedef struct
 {
     uint8_t left;
@@ -260,18 +290,120 @@ void MV_ReleaseXMPVoice(VoiceNode *voice);
 extern int MV_XMPInterpolation;
 #endif
 
+// Voices are mixed into a float bus of MV_MIXBUFFERSIZE frames holding samples on the 16-bit scale, which is
+// added to the 16-bit output buffer and clamped once per buffer instead of once per voice and sample.
+
 // implemented in mix.c
-template <typename S, typename D> uint32_t MV_MixMono(struct VoiceNode * const voice, uint32_t length);
-template <typename S, typename D> uint32_t MV_MixStereo(struct VoiceNode * const voice, uint32_t length);
+template <typename S> uint32_t MV_MixMono(struct VoiceNode * const voice, uint32_t length);
+template <typename S> uint32_t MV_MixStereo(struct VoiceNode * const voice, uint32_t length);
 template <typename T> void MV_Reverb(char const *src, char * const dest, const fix16_t volume, int count);
+void MV_MixBusToPCM(int16_t *dest, float const *bus, int count);
+void MV_SumBus(float *dest, float const *bus, int count);
 
 // implemented in mixst.c
-template <typename S, typename D> uint32_t MV_MixMonoStereo(struct VoiceNode * const voice, uint32_t length);
-template <typename S, typename D> uint32_t MV_MixStereoStereo(struct VoiceNode * const voice, uint32_t length);
+template <typename S> uint32_t MV_MixMonoStereo(struct VoiceNode * const voice, uint32_t length);
+template <typename S> uint32_t MV_MixStereoStereo(struct VoiceNode * const voice, uint32_t length);
+
+// implemented in mixsimd.cpp
+enum
+{
+    MV_MIXSIMD_SCALAR,
+    MV_MIXSIMD_VEC4,  // SSE2 or NEON
+    MV_MIXSIMD_VEC8,  // AVX2
+};
 
-extern char *MV_MixDestination;  // pointer to the next output sample
+typedef uint32_t (*mixfunc_t)(struct VoiceNode *, uint32_t);
+
+typedef struct
+{
+    // indexed by T_MONO, T_16BITSOURCE and T_STEREOSOURCE, see MV_SetVoiceMixMode()
+    mixfunc_t mix[8];
+    void (*topcm)(int16_t *dest, float const *bus, int count);
+    void (*sumbus)(float *dest, float const *bus, int count);
+} mixsimd_t;
+
+extern mixsimd_t MV_MixSimd;
+
+int MV_MixSimdInit(int maxlevel);
+char const *MV_MixSimdName(int level);
+
+extern thread_local float *MV_MixDestination;  // pointer to the next output frame in the mix bus
 extern int MV_SampleSize;
-extern int MV_RightChannelOffset;
+
+// implemented in multivoc.cpp
+typedef struct
+{
+    uint32_t buffers;    // buffers mixed since the stats were last reset
+    uint32_t misses;     // buffers that took longer to mix than they take to play
+    uint32_t maxvoices;  // most voices mixed into one buffer
+    uint64_t totaltime;  // time spent mixing, in nanoseconds
+    uint64_t maxtime;    // longest time spent mixing one buffer
+    uint64_t deadline;   // time it takes to play one buffer
+    uint64_t voicemixes; // sum of the voices mixed into each buffer
+    uint64_t musictime;  // part of totaltime spent rendering MIDI music
+    uint64_t decodetime[FMT_MAX];  // part of totaltime spent in each format's GetSound(), summed over the mix threads
+    uint64_t commands;   // voice commands queued for the mixer
+    uint64_t commandsrun;  // voice commands carried out, the difference to commands is still queued
+    uint32_t ringfull;   // times a game thread found the command ring full and carried out the queued commands itself
+    uint32_t dropped;    // commands that found no room in the ring and were lost, always 0 unless something is broken
+} mixstats_t;
+
+extern int MV_MixThreads;
+
+void MV_SetMixThreads(void);
+void MV_GetMixStats(mixstats_t *stats, bool reset);
+
+// Carries out every queued command and returns the number of voices that are free to be played, which is every
+// voice once all sounds have stopped. usedhandles gets the number of handles still given out.
+int MV_GetFreeVoices(int *usedhandles);
+
+// Short Vorbis, FLAC and XA sound effects are decoded once into 16-bit PCM and kept in an LRU cache with a
+// memory budget of MV_PCMCacheSize megabytes. Voices playing them hold a reference to the buffer, so it
+// outlives its eviction from the cache until they stop. The decoding happens in the background, a sound is
+// streamed as usual until it is done.
+
+// implemented in pcmcache.cpp
+typedef struct
+{
+    int16_t *data;       // little endian samples, interleaved for stereo
+    uint32_t frames;
+    uint32_t capacity;   // frames allocated for data
+    uint32_t rate;
+    int      channels;
+    int32_t  loopstart;  // loop points read from the file's tags, in frames, or -1 if there are none
+    int32_t  loopend;
+    std::atomic<int> refcount;
+    bool     pending;    // placeholder for a sound that is still being decoded
+} pcmbuffer_t;
+
+typedef struct
+{
+    uint32_t hits;
+    uint32_t misses;     // plays that were streamed while their sound was being decoded
+    uint32_t uncached;   // sounds that were too large or failed to decode, and are streamed instead
+    uint32_t evictions;
+    uint32_t entries;
+    uint64_t bytes;
+} pcmcachestats_t;
+
+extern int MV_PCMCacheSize;
+
+pcmbuffer_t *MV_GetCachedPCM(char *ptr, uint32_t length, wavefmt_t fmt);
+void         MV_ReleaseCachedPCM(pcmbuffer_t *pcm);
+int16_t     *MV_ReservePCM(pcmbuffer_t *pcm, uint32_t frames, uint32_t maxbytes);
+void         MV_TrimPCMCache(void);
+void         MV_GetPCMCacheStats(pcmcachestats_t *stats);
+
+int  MV_DecodeVorbis(char *ptr, uint32_t length, uint32_t maxbytes, pcmbuffer_t *pcm);
+int  MV_DecodeFLAC(char *ptr, uint32_t length, uint32_t maxbytes, pcmbuffer_t *pcm);
+int  MV_DecodeXA(char *ptr, uint32_t length, uint32_t maxbytes, pcmbuffer_t *pcm);
+
+// implemented in formats.cpp
+int  MV_PlayPCM(pcmbuffer_t *pcm, int loopstart, int pitchoffset, int vol, int left, int right, int priority, fix16_t volume, intptr_t callbackval);
+int  MV_PlayPCM3D(pcmbuffer_t *pcm, int loophow, int pitchoffset, int angle, int distance, int priority, fix16_t volume, intptr_t callbackval);
+int  MV_GetPCMPosition(VoiceNode *voice);
+void MV_SetPCMPosition(VoiceNode *voice, int position);
+void MV_ReleasePCMVoice(VoiceNode *voice);
 
 #define loopStartTagCount 3
 extern const char *loopStartTags[loopStartTagCount];
@@ -0,0 +1,276 @@
+/*
+ Copyright (C) EDuke32 developers and contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+/**
+ * Output driver for MultiVoc without any sound hardware, for benchmarking and headless runs
+ */
+
+#include "driver_null.h"
+
+#include "compat.h"
+#include "multivoc.h"
+#include "vfs.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+enum
+{
+    NullErr_Error   = -1,
+    NullErr_Ok      = 0,
+    NullErr_Uninitialised,
+    NullErr_WAVFile,
+};
+
+int  NullDrv_Speed;
+char NullDrv_WAVFile[BMAX_PATH];
+
+static int ErrorCode = NullErr_Ok;
+static int Initialised;
+static int Playing;
+
+static int MixRate;
+static int NumChannels;
+
+static char *MixBuffer;
+static int MixBufferSize;
+static int MixBufferCount;
+static int MixBufferCurrent;
+static void (*MixCallBack)(void);
+
+// recursive like the SDL audio device lock, the mixer makes the voice callbacks with it held
+static std::recursive_mutex MixMutex;
+static std::thread MixThread;
+static std::atomic<bool> MixThreadRunning;
+
+static buildvfs_FILE WAVFile;
+static uint32_t WAVDataSize;
+
+static void writeLE32(uint8_t *p, uint32_t v) { v = B_LITTLE32(v); Bmemcpy(p, &v, 4); }
+static void writeLE16(uint8_t *p, uint16_t v) { v = B_LITTLE16(v); Bmemcpy(p, &v, 2); }
+
+// the sizes are 0 until closeWAV() goes back and fills them in
+static void writeWAVHeader(uint32_t datasize)
+{
+    uint8_t header[44];
+
+    Bmemcpy(&header[0], "RIFF", 4);
+    writeLE32(&header[4], 36 + datasize);
+    Bmemcpy(&header[8], "WAVEfmt ", 8);
+    writeLE32(&header[16], 16);
+    writeLE16(&header[20], 1);
+    writeLE16(&header[22], NumChannels);
+    writeLE32(&header[24], MixRate);
+    writeLE32(&header[28], MixRate * NumChannels * sizeof(int16_t));
+    writeLE16(&header[32], NumChannels * sizeof(int16_t));
+    writeLE16(&header[34], 16);
+    Bmemcpy(&header[36], "data", 4);
+    writeLE32(&header[40], datasize);
+
+    buildvfs_fwrite(header, sizeof(header), 1, WAVFile);
+}
+
+static int openWAV(void)
+{
+    if (NullDrv_WAVFile[0] == '\0')
+        return NullErr_Ok;
+
+    if ((WAVFile = buildvfs_fopen_write(NullDrv_WAVFile)) == nullptr)
+    {
+        ErrorCode = NullErr_WAVFile;
+        return NullErr_Error;
+    }
+
+    WAVDataSize = 0;
+    writeWAVHeader(0);
+
+    return NullErr_Ok;
+}
+
+static void closeWAV(void)
+{
+    if (WAVFile == nullptr)
+        return;
+
+    buildvfs_fseek_abs(WAVFile, 0);
+    writeWAVHeader(WAVDataSize);
+    buildvfs_fclose(WAVFile);
+    WAVFile = nullptr;
+
+    VLOG_F(LOG_ASS, "Wrote %.1f seconds of sound to %s", (float)WAVDataSize / (MixRate * NumChannels * sizeof(int16_t)), NullDrv_WAVFile);
+}
+
+// same order as the SDL driver: mix one buffer, then play the oldest one
+static void pullBuffer(void)
+{
+    std::lock_guard<std::recursive_mutex> lock(MixMutex);
+
+    MixCallBack();
+
+    if (++MixBufferCurrent >= MixBufferCount)
+        MixBufferCurrent -= MixBufferCount;
+
+    if (WAVFile == nullptr)
+        return;
+
+    auto buffer = (int16_t *)(MixBuffer + MixBufferCurrent * MixBufferSize);
+
+#if B_BIG_ENDIAN != 0
+    for (int i = 0; i < (MixBufferSize >> 1); i++)
+        buffer[i] = B_LITTLE16(buffer[i]);
+#endif
+
+    buildvfs_fwrite(buffer, MixBufferSize, 1, WAVFile);
+    WAVDataSize += MixBufferSize;
+}
+
+static void mixThread(void)
+{
+    auto const period = std::chrono::nanoseconds(MixBufferSize / (NumChannels * sizeof(int16_t)) * 1000000000ull / MixRate);
+    auto next = std::chrono::steady_clock::now();
+
+    while (MixThreadRunning.load(std::memory_order_relaxed))
+    {
+        pullBuffer();
+
+        if (NullDrv_Speed <= 0)
+        {
+            // still let the game threads in between buffers
+            std::this_thread::yield();
+            continue;
+        }
+
+        next += period * 100 / NullDrv_Speed;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+int NullDrv_GetError(void) { return ErrorCode; }
+
+const char *NullDrv_ErrorString(int ErrorNumber)
+{
+    switch (ErrorNumber)
+    {
+        case NullErr_Error:         return NullDrv_ErrorString(ErrorCode);
+        case NullErr_Ok:            return "Null sound ok.";
+        case NullErr_Uninitialised: return "Null sound uninitialized.";
+        case NullErr_WAVFile:       return "Null sound: error opening WAV output file.";
+        default:                    return "Unknown null sound error code.";
+    }
+}
+
+int NullDrv_PCM_Init(int *mixrate, int *numchannels, void *initdata)
+{
+    UNREFERENCED_PARAMETER(initdata);
+
+    if (Initialised)
+        NullDrv_PCM_Shutdown();
+
+    // anything goes, there is no device to disagree
+    *numchannels = clamp(*numchannels, 1, 2);
+
+    MixRate     = *mixrate;
+    NumChannels = *numchannels;
+
+    if (NullDrv_Speed < 0)
+        VLOG_F(LOG_ASS, "Using null sound driver, mixing on demand");
+    else if (NullDrv_Speed == 0)
+        VLOG_F(LOG_ASS, "Using null sound driver, mixing as fast as possible");
+    else
+        VLOG_F(LOG_ASS, "Using null sound driver at %d%% of real time", NullDrv_Speed);
+
+    Initialised = 1;
+    return NullErr_Ok;
+}
+
+void NullDrv_PCM_Shutdown(void)
+{
+    if (!Initialised)
+        return;
+
+    NullDrv_PCM_StopPlayback();
+    Initialised = 0;
+}
+
+int NullDrv_PCM_BeginPlayback(char *BufferStart, int BufferSize, int NumDivisions, void (*CallBackFunc)(void))
+{
+    if (!Initialised)
+    {
+        ErrorCode = NullErr_Uninitialised;
+        return NullErr_Error;
+    }
+
+    if (Playing)
+        NullDrv_PCM_StopPlayback();
+
+    if (openWAV() != NullErr_Ok)
+        return NullErr_Error;
+
+    MixBuffer = BufferStart;
+    MixBufferSize = BufferSize;
+    MixBufferCount = NumDivisions;
+    MixBufferCurrent = 0;
+    MixCallBack = CallBackFunc;
+
+    // prime the buffer
+    {
+        std::lock_guard<std::recursive_mutex> lock(MixMutex);
+        MixCallBack();
+    }
+
+    if (NullDrv_Speed >= 0)
+    {
+        MixThreadRunning = true;
+        MixThread = std::thread(mixThread);
+    }
+
+    Playing = 1;
+
+    return NullErr_Ok;
+}
+
+void NullDrv_PCM_StopPlayback(void)
+{
+    if (!Initialised || !Playing)
+        return;
+
+    if (MixThread.joinable())
+    {
+        MixThreadRunning = false;
+        MixThread.join();
+    }
+
+    closeWAV();
+    Playing = 0;
+}
+
+void NullDrv_PCM_Lock(void)   { MixMutex.lock(); }
+void NullDrv_PCM_Unlock(void) { MixMutex.unlock(); }
+
+void NullDrv_PCM_Pull(int numbuffers)
+{
+    if (!Playing || MixThread.joinable())
+        return;
+
+    while (numbuffers-- > 0)
+        pullBuffer();
+}
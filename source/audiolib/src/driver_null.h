@@ -0,0 +1,44 @@
+/*
+ Copyright (C) EDuke32 developers and contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef driver_null_h__
+#define driver_null_h__
+
+#include "compat.h"
+
+// Buffers are pulled on a thread of the driver's own at NullDrv_Speed percent of real time, or as fast as the
+// mixer can go if it is 0. With NullDrv_Speed < 0 there is no thread and nothing is mixed until NullDrv_PCM_Pull()
+// is called. If NullDrv_WAVFile is set when playback begins, everything mixed is also written to it.
+extern int  NullDrv_Speed;
+extern char NullDrv_WAVFile[BMAX_PATH];
+
+const char *NullDrv_ErrorString(int ErrorNumber);
+
+int  NullDrv_GetError(void);
+int  NullDrv_PCM_Init(int *mixrate, int *numchannels, void *initdata);
+void NullDrv_PCM_Shutdown(void);
+int  NullDrv_PCM_BeginPlayback(char *BufferStart, int BufferSize, int NumDivisions, void (*CallBackFunc)(void));
+void NullDrv_PCM_StopPlayback(void);
+void NullDrv_PCM_Lock(void);
+void NullDrv_PCM_Unlock(void);
+
+void NullDrv_PCM_Pull(int numbuffers);
+
+#endif // driver_null_h__
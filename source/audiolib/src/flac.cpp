@@ -293,6 +293,73 @@ void error_flac_stream(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderEr
     // FLAC__stream_decoder_flush(fd->stream);
 }
 
+// reads the loop points from the tags, leaving -1 for the start and 0 for the end and length when they are missing
+static void MV_GetFLACCommentLoops(const FLAC__StreamMetadata_VorbisComment *vc, FLAC__int64 *loopstart, FLAC__int64 *loopend, FLAC__int64 *looplength)
+{
+    const char *vc_loopstart = nullptr;
+    const char *vc_loopend = nullptr;
+    const char *vc_looplength = nullptr;
+
+    for (FLAC__uint32 comment = 0; comment < vc->num_comments; ++comment)
+    {
+        const char *entry = (const char *)vc->comments[comment].entry;
+        if (entry != nullptr && entry[0] != '\0')
+        {
+            const char *value = strchr(entry, '=');
+
+            if (!value)
+                continue;
+
+            const size_t field = value - entry;
+            value += 1;
+
+            for (int t = 0; t < loopStartTagCount && vc_loopstart == nullptr; ++t)
+            {
+                char const * const tag = loopStartTags[t];
+                if (field == strlen(tag) && Bstrncasecmp(entry, tag, field) == 0)
+                    vc_loopstart = value;
+            }
+
+            for (int t = 0; t < loopEndTagCount && vc_loopend == nullptr; ++t)
+            {
+                char const * const tag = loopEndTags[t];
+                if (field == strlen(tag) && Bstrncasecmp(entry, tag, field) == 0)
+                    vc_loopend = value;
+            }
+
+            for (int t = 0; t < loopLengthTagCount && vc_looplength == nullptr; ++t)
+            {
+                char const * const tag = loopLengthTags[t];
+                if (field == strlen(tag) && Bstrncasecmp(entry, tag, field) == 0)
+                    vc_looplength = value;
+            }
+        }
+    }
+
+    *loopstart  = -1;
+    *loopend    = 0;
+    *looplength = 0;
+
+    if (vc_loopstart != nullptr)
+    {
+        const FLAC__int64 flac_loopstart = atol(vc_loopstart);
+        if (flac_loopstart >= 0)  // a loop starting at 0 is valid
+            *loopstart = flac_loopstart;
+    }
+    if (vc_loopend != nullptr)
+    {
+        const FLAC__int64 flac_loopend = atol(vc_loopend);
+        if (flac_loopend > 0)  // a loop ending at 0 is invalid
+            *loopend = flac_loopend;
+    }
+    if (vc_looplength != nullptr)
+    {
+        const FLAC__int64 flac_looplength = atol(vc_looplength);
+        if (flac_looplength > 0)  // a loop of length 0 is invalid
+            *looplength = flac_looplength;
+    }
+}
+
 int MV_GetFLACPosition(VoiceNode *voice)
 {
     FLAC__uint64 position = 0;
@@ -476,10 +543,6 @@ int MV_PlayFLAC(char *ptr, uint32_t length, int loopstart, int loopend, int pitc
             FLAC__Metadata_Iterator *metadata_iterator = FLAC__metadata_iterator_new();
             if (metadata_iterator != nullptr)
             {
-                char *vc_loopstart = nullptr;
-                char *vc_loopend = nullptr;
-                char *vc_looplength = nullptr;
-
                 FLAC__metadata_iterator_init(metadata_iterator, metadata_chain);
 
                 do
@@ -509,76 +572,23 @@ int MV_PlayFLAC(char *ptr, uint32_t length, int loopstart, int loopend, int pitc
                     // load loop tags from metadata
                     if (tags->type == FLAC__METADATA_TYPE_VORBIS_COMMENT)
                     {
-                        FLAC__uint32 comment;
-                        for (comment = 0; comment < tags->data.vorbis_comment.num_comments; ++comment)
-                        {
-                            const char *entry = (const char *)tags->data.vorbis_comment.comments[comment].entry;
-                            if (entry != nullptr && entry[0] != '\0')
-                            {
-                                const char *value = strchr(entry, '=');
-                                const size_t field = value - entry;
-                                value += 1;
-
-                                for (int t = 0; t < loopStartTagCount && vc_loopstart == nullptr; ++t)
-                                {
-                                    char const * const tag = loopStartTags[t];
-                                    if (field == strlen(tag) && Bstrncasecmp(entry, tag, field) == 0)
-                                        vc_loopstart = Xstrdup(value);
-                                }
-
-                                for (int t = 0; t < loopEndTagCount && vc_loopend == nullptr; ++t)
-                                {
-                                    char const * const tag = loopEndTags[t];
-                                    if (field == strlen(tag) && Bstrncasecmp(entry, tag, field) == 0)
-                                        vc_loopend = Xstrdup(value);
-                                }
-
-                                for (int t = 0; t < loopLengthTagCount && vc_looplength == nullptr; ++t)
-                                {
-                                    char const * const tag = loopLengthTags[t];
-                                    if (field == strlen(tag) && Bstrncasecmp(entry, tag, field) == 0)
-                                        vc_looplength = Xstrdup(value);
-                                }
-                            }
-                        }
-                    }
+                        FLAC__int64 loopstart, loopend, looplength;
 
-                    FLAC__metadata_object_delete(
-                    tags);  // If it were not for this, I would assign pointers instead of strdup().
-                } while (FLAC__metadata_iterator_next(metadata_iterator));
+                        MV_GetFLACCommentLoops(&tags->data.vorbis_comment, &loopstart, &loopend, &looplength);
 
-                if (vc_loopstart != nullptr)
-                {
-                    {
-                        const FLAC__int64 flac_loopstart = atol(vc_loopstart);
-                        if (flac_loopstart >= 0)  // a loop starting at 0 is valid
+                        if (loopstart >= 0)
                         {
-                            voice->Loop.Start = (const char *)(intptr_t)flac_loopstart;
+                            voice->Loop.Start = (const char *)(intptr_t)loopstart;
                             voice->Loop.Size = 1;
                         }
+                        if (loopend > 0 && voice->Loop.Size > 0)
+                            voice->Loop.End = (const char *)(intptr_t)loopend;
+                        if (looplength > 0 && voice->Loop.Size > 0 && voice->Loop.End == 0)
+                            voice->Loop.End = (const char *)((intptr_t)looplength + (intptr_t)voice->Loop.Start);
                     }
-                    Xfree(vc_loopstart);
-                }
-                if (vc_loopend != nullptr)
-                {
-                    if (voice->Loop.Size > 0)
-                    {
-                        const FLAC__int64 flac_loopend = atol(vc_loopend);
-                        if (flac_loopend > 0)  // a loop ending at 0 is invalid
-                            voice->Loop.End = (const char *)(intptr_t)flac_loopend;
-                    }
-                    Xfree(vc_loopend);
-                }
-                if (vc_looplength != nullptr)
-                {
-                    if (voice->Loop.Size > 0 && voice->Loop.End == 0)
-                    {
-                        const FLAC__int64 flac_looplength = atol(vc_looplength);
-                        if (flac_looplength > 0)  // a loop of length 0 is invalid
-                            voice->Loop.End = (const char *)((intptr_t)flac_looplength + (intptr_t)voice->Loop.Start);
-                    }
-                    Xfree(vc_looplength);
-                }
+
+                    FLAC__metadata_object_delete(tags);
+                } while (FLAC__metadata_iterator_next(metadata_iterator));
 
                 FLAC__metadata_iterator_delete(metadata_iterator);
             }
@@ -606,6 +616,117 @@ int MV_PlayFLAC(char *ptr, uint32_t length, int loopstart, int loopend, int pitc
 }
 
 
+// decoding a whole stream into a PCM cache buffer, see pcmcache.cpp
+
+typedef struct
+{
+    flac_data fd;  // for the read callbacks, which only use ptr, length and pos
+
+    pcmbuffer_t *pcm;
+    uint32_t maxbytes;
+    FLAC__uint64 totalframes;  // from STREAMINFO, 0 if unknown
+} flac_decode_data;
+
+static FLAC__StreamDecoderWriteStatus write_flac_decode(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame,
+                                                        const FLAC__int32 *const ibuffer[], void *client_data)
+{
+    auto fdd = (flac_decode_data *)client_data;
+    auto pcm = fdd->pcm;
+
+    UNREFERENCED_PARAMETER(decoder);
+
+    if ((int)frame->header.channels != pcm->channels || frame->header.sample_rate != pcm->rate)
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+
+    uint32_t const samples = frame->header.blocksize;
+    auto obuffer = MV_ReservePCM(pcm, samples, fdd->maxbytes);
+
+    if (obuffer == nullptr)
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+
+    int const bits = frame->header.bits_per_sample;
+
+    for (uint32_t sample = 0; sample < samples; ++sample)
+        for (int channel = 0; channel < pcm->channels; ++channel)
+        {
+            FLAC__int32 const val = ibuffer[channel][sample];
+            *obuffer++ = B_LITTLE16((int16_t)(bits > 16 ? val >> (bits - 16) : val * (1 << (16 - bits))));
+        }
+
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void metadata_flac_decode(const FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *metadata, void *client_data)
+{
+    auto fdd = (flac_decode_data *)client_data;
+    auto pcm = fdd->pcm;
+
+    UNREFERENCED_PARAMETER(decoder);
+
+    if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO)
+    {
+        pcm->channels    = metadata->data.stream_info.channels;
+        pcm->rate        = metadata->data.stream_info.sample_rate;
+        fdd->totalframes = metadata->data.stream_info.total_samples;
+    }
+    else if (metadata->type == FLAC__METADATA_TYPE_VORBIS_COMMENT)
+    {
+        FLAC__int64 loopstart, loopend, looplength;
+
+        MV_GetFLACCommentLoops(&metadata->data.vorbis_comment, &loopstart, &loopend, &looplength);
+
+        if (loopend <= 0 && looplength > 0)
+            loopend = max<FLAC__int64>(loopstart, 0) + looplength;
+
+        pcm->loopstart = (int32_t)loopstart;
+        pcm->loopend   = loopend > 0 ? (int32_t)loopend : -1;
+    }
+}
+
+static void error_flac_decode(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data)
+{
+    UNREFERENCED_PARAMETER(decoder);
+    UNREFERENCED_PARAMETER(status);
+    UNREFERENCED_PARAMETER(client_data);
+}
+
+int MV_DecodeFLAC(char *ptr, uint32_t length, uint32_t maxbytes, pcmbuffer_t *pcm)
+{
+    flac_decode_data fdd = {};
+
+    fdd.fd.ptr    = ptr;
+    fdd.fd.length = length;
+    fdd.pcm       = pcm;
+    fdd.maxbytes  = maxbytes;
+
+    auto stream = FLAC__stream_decoder_new();
+
+    if (stream == nullptr)
+        return MV_Error;
+
+    FLAC__stream_decoder_set_metadata_respond(stream, FLAC__METADATA_TYPE_VORBIS_COMMENT);
+
+    int status = MV_SetErrorCode(MV_InvalidFile);
+
+    // the metadata comes before the first frame, so the write callback never sees a buffer without a format
+    if (FLAC__stream_decoder_init_stream(stream, read_flac_stream, seek_flac_stream, tell_flac_stream, length_flac_stream, eof_flac_stream,
+                                         write_flac_decode, metadata_flac_decode, error_flac_decode, (void *)&fdd) == FLAC__STREAM_DECODER_INIT_STATUS_OK
+        && FLAC__stream_decoder_process_until_end_of_metadata(stream) && (pcm->channels == 1 || pcm->channels == 2))
+    {
+        // don't decode what could never fit
+        if (fdd.totalframes > maxbytes / (pcm->channels * sizeof(int16_t)))
+            status = MV_Error;
+        else if (FLAC__stream_decoder_process_until_end_of_stream(stream)
+                 && FLAC__stream_decoder_get_state(stream) == FLAC__STREAM_DECODER_END_OF_STREAM)
+            status = MV_Ok;
+    }
+
+    FLAC__stream_decoder_finish(stream);
+    FLAC__stream_decoder_delete(stream);
+
+    return status;
+}
+
 void MV_ReleaseFLACVoice(VoiceNode *voice)
 {
     Bassert(voice->wavetype == FMT_FLAC && voice->rawdataptr != nullptr && voice->rawdatasiz == sizeof(flac_data));
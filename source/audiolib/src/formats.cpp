@@ -510,3 +510,112 @@ int MV_PlayRAW(char *ptr, uint32_t length, int rate, char *loopstart, char *loop
 
     return voice->handle;
 }
+
+int MV_PlayPCM3D(pcmbuffer_t *pcm, int loophow, int pitchoffset, int angle, int distance, int priority, fix16_t volume, intptr_t callbackval)
+{
+    if (!MV_Installed)
+    {
+        MV_ReleaseCachedPCM(pcm);
+        return MV_Error;
+    }
+
+    if (distance < 0)
+    {
+        distance  = -distance;
+        angle    += MV_NUMPANPOSITIONS / 2;
+    }
+
+    int const vol = MIX_VOLUME(distance);
+
+    // Ensure angle is within 0 - 127
+    angle &= MV_MAXPANPOSITION;
+
+    return MV_PlayPCM(pcm, loophow, pitchoffset, max(0, 255 - distance),
+        MV_PanTable[angle][vol].left, MV_PanTable[angle][vol].right, priority, volume, callbackval);
+}
+
+// takes over the caller's reference to pcm, which the voice drops when it stops
+int MV_PlayPCM(pcmbuffer_t *pcm, int loopstart, int pitchoffset, int vol, int left, int right, int priority, fix16_t volume, intptr_t callbackval)
+{
+    if (!MV_Installed)
+    {
+        MV_ReleaseCachedPCM(pcm);
+        return MV_Error;
+    }
+
+    auto voice = MV_AllocVoice(priority);
+
+    if (voice == nullptr)
+    {
+        MV_ReleaseCachedPCM(pcm);
+        return MV_SetErrorCode(MV_NoVoices);
+    }
+
+    // with MV_LazyAlloc, a voice that last played a streamed Vorbis, FLAC, XA or XMP sound still owns its decoder state
+    if (voice->rawdataptr != nullptr && voice->wavetype >= FMT_VORBIS && voice->wavetype != FMT_PCM)
+        ALIGNED_FREE_AND_NULL(voice->rawdataptr);
+
+    voice->rawdataptr  = pcm;
+    voice->rawdatasiz  = 0;
+    voice->wavetype    = FMT_PCM;
+    voice->bits        = 16;
+    voice->channels    = pcm->channels;
+    voice->GetSound    = MV_GetNextRAWBlock;
+    voice->NextBlock   = (char *)pcm->data;
+    voice->position    = 0;
+    voice->BlockLength = pcm->frames;
+    voice->priority    = priority;
+    voice->callbackval = callbackval;
+    voice->Loop        = {};
+
+    // like the streaming decoders, loop tags make the sound loop even if the caller did not ask for it
+    if (loopstart >= 0 || pcm->loopstart >= 0)
+    {
+        uint32_t const start = min<uint32_t>(max(pcm->loopstart, 0), pcm->frames - 1);
+        uint32_t const end   = pcm->loopend > 0 ? clamp<uint32_t>(pcm->loopend, start + 1, pcm->frames) : pcm->frames;
+
+        voice->BlockLength = end;
+        voice->Loop.Start  = (char *)(pcm->data + start * pcm->channels);
+        voice->Loop.End    = (char *)(pcm->data + end * pcm->channels);
+        voice->Loop.Size   = end - start;
+    }
+
+    MV_SetVoicePitch(voice, pcm->rate, pitchoffset);
+    MV_SetVoiceVolume(voice, vol, left, right, volume);
+    MV_PlayVoice(voice);
+
+    return voice->handle;
+}
+
+int MV_GetPCMPosition(VoiceNode *voice)
+{
+    auto pcm = (pcmbuffer_t *)voice->rawdataptr;
+
+    return ((int16_t const *)voice->NextBlock - pcm->data) / pcm->channels - (voice->length >> 16) + (voice->position >> 16);
+}
+
+void MV_SetPCMPosition(VoiceNode *voice, int position)
+{
+    auto pcm = (pcmbuffer_t *)voice->rawdataptr;
+    uint32_t const end = voice->Loop.End ? ((int16_t const *)voice->Loop.End - pcm->data) / pcm->channels : pcm->frames;
+
+    if ((unsigned)position >= end)
+        position = 0;
+
+    voice->NextBlock   = (char *)(pcm->data + position * pcm->channels);
+    voice->BlockLength = end - position;
+    voice->length      = 0;
+    voice->position    = 0;
+}
+
+void MV_ReleasePCMVoice(VoiceNode *voice)
+{
+    Bassert(voice->wavetype == FMT_PCM && voice->rawdataptr != nullptr);
+
+    auto pcm = (pcmbuffer_t *)voice->rawdataptr;
+
+    voice->rawdataptr = nullptr;
+    voice->rawdatasiz = 0;
+
+    MV_ReleaseCachedPCM(pcm);
+}
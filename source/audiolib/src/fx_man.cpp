@@ -91,6 +91,10 @@ static int osdcmd_cvar_set_audiolib(osdcmdptr_t parm)
 #endif
     else if (ASS_MIDISoundDriver == ASS_SF2 && (!Bstrcasecmp(parm->name, "mus_sf2_bank") || !Bstrcasecmp(parm->name, "mus_sf2_sampleblocksize")))
         MIDI_Restart();
+    else if (!Bstrcasecmp(parm->name, "snd_pcmcache"))
+        MV_TrimPCMCache();
+    else if (!Bstrcasecmp(parm->name, "snd_mixthreads"))
+        MV_SetMixThreads();
     else if (!Bstrcasecmp(parm->name, "mus_al_stereo"))
         AL_SetStereo(AL_Stereo);
 #ifdef HAVE_XMP
@@ -116,6 +120,51 @@ static int osdcmd_cvar_set_audiolib(osdcmdptr_t parm)
     return r;
 }
 
+static int osdcmd_pcmcachestats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    pcmcachestats_t stats;
+    MV_GetPCMCacheStats(&stats);
+
+    uint32_t const lookups = stats.hits + stats.misses;
+
+    LOG_F(INFO, "Decoded sound cache:");
+    LOG_F(INFO, "%9s: %u sounds, %.2f of %d MB", "held", stats.entries, stats.bytes / (1024.f * 1024.f), MV_PCMCacheSize);
+    LOG_F(INFO, "%9s: %u hits, %u misses (%.1f%% hit rate)", "lookups", stats.hits, stats.misses, lookups ? stats.hits * 100.f / lookups : 0.f);
+    LOG_F(INFO, "%9s: %u", "evictions", stats.evictions);
+    LOG_F(INFO, "%9s: %u plays", "streamed", stats.uncached);
+    return OSDCMD_OK;
+}
+
+static int osdcmd_mixstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    if (!FX_Installed)
+        return OSDCMD_OK;
+
+    // each call starts a new measurement window
+    mixstats_t stats;
+    MV_GetMixStats(&stats, true);
+
+    LOG_F(INFO, "Sound mixing on %d thread%s since last check:", MV_MixThreads, MV_MixThreads > 1 ? "s" : "");
+    LOG_F(INFO, "%9s: %u, %.1f us each", "buffers", stats.buffers, stats.deadline / 1000.f);
+    LOG_F(INFO, "%9s: %.1f us avg, %.1f us max", "mix time", stats.buffers ? stats.totaltime / (1000.f * stats.buffers) : 0.f, stats.maxtime / 1000.f);
+    LOG_F(INFO, "%9s: %u buffers mixed late", "misses", stats.misses);
+    LOG_F(INFO, "%9s: %u max, %.1f avg", "voices", stats.maxvoices, stats.buffers ? (float)stats.voicemixes / stats.buffers : 0.f);
+
+    uint64_t decodetime = 0;
+
+    for (auto t : stats.decodetime)
+        decodetime += t;
+
+    LOG_F(INFO, "%9s: %.1f us avg", "decoding", stats.buffers ? decodetime / (1000.f * stats.buffers) : 0.f);
+    LOG_F(INFO, "%9s: %.1f us avg", "MIDI", stats.buffers ? stats.musictime / (1000.f * stats.buffers) : 0.f);
+    LOG_F(INFO, "%9s: %" PRIu64 " queued, ring full %u times", "commands", stats.commands, stats.ringfull);
+    return OSDCMD_OK;
+}
+
 void FX_InitCvars(void)
 {
     static osdcvardata_t cvars_audiolib [] ={
@@ -140,11 +189,15 @@ void FX_InitCvars(void)
           (void *)SDLAudioDriverName, CVAR_STRING | CVAR_FUNCPTR, 0, sizeof(SDLAudioDriverName) - 1 },
 #endif
         { "snd_lazyalloc", "use lazy sound allocations", (void*) &MV_LazyAlloc, CVAR_BOOL, 0, 1 },
+        { "snd_pcmcache", "megabytes of memory for keeping decoded compressed sounds (0: decode on every play)", (void*) &MV_PCMCacheSize, CVAR_INT | CVAR_FUNCPTR, 0, 1024 },
+        { "snd_mixthreads", "number of threads mixing sound voices, including the audio thread", (void*) &MV_MixThreads, CVAR_INT | CVAR_FUNCPTR, 1, MV_MAXMIXTHREADS },
     };
 
     for (auto& i : cvars_audiolib)
         OSD_RegisterCvar(&i, (i.flags & CVAR_FUNCPTR) ? osdcmd_cvar_set_audiolib : osdcmd_cvar_set);
 
+    OSD_RegisterFunction("snd_pcmcachestats", "decoded sound cache statistics", osdcmd_pcmcachestats);
+    OSD_RegisterFunction("snd_mixstats", "sound mixing time and missed buffer deadlines", osdcmd_mixstats);
 #ifdef _WIN32
     OSD_RegisterFunction("mus_mme_debuginfo", "Windows MME MIDI buffer debug information", WinMMDrv_MIDI_PrintBufferInfo);
 #endif
@@ -248,11 +301,16 @@ static int FX_BadFmt3D(char *, uint32_t, int, int, int, int, int, fix16_t, intpt
 int FX_Play(char *ptr, uint32_t ptrlength, int loopstart, int loopend, int pitchoffset,
             int vol, int left, int right, int priority, fix16_t volume, intptr_t callbackval)
 {
-    static constexpr decltype(FX_Play) *func[] = { FX_BadFmt, nullptr, MV_PlayVOC, MV_PlayWAV, MV_PlayVorbis, MV_PlayFLAC, MV_PlayXA, MV_PlayXMP };
+    static constexpr decltype(FX_Play) *func[] = { FX_BadFmt, nullptr, MV_PlayVOC, MV_PlayWAV, MV_PlayVorbis, MV_PlayFLAC, MV_PlayXA, MV_PlayXMP, nullptr };
 
     EDUKE32_STATIC_ASSERT(FMT_MAX == ARRAY_SIZE(func));
 
-    int handle = func[FX_ReadFmt(ptr, ptrlength)](ptr, ptrlength, loopstart, loopend, pitchoffset, vol, left, right, priority, volume, callbackval);
+    auto const fmt = FX_ReadFmt(ptr, ptrlength);
+    // music is long and only played once in a while, decoding it whole would stall the caller
+    auto const pcm = priority != FX_MUSIC_PRIORITY ? MV_GetCachedPCM(ptr, ptrlength, fmt) : nullptr;
+
+    int handle = pcm ? MV_PlayPCM(pcm, loopstart, pitchoffset, vol, left, right, priority, volume, callbackval)
+                     : func[fmt](ptr, ptrlength, loopstart, loopend, pitchoffset, vol, left, right, priority, volume, callbackval);
 
     if (EDUKE32_PREDICT_FALSE(handle <= MV_Ok))
     {
@@ -266,11 +324,15 @@ int FX_Play(char *ptr, uint32_t ptrlength, int loopstart, int loopend, int pitch
 int FX_Play3D(char *ptr, uint32_t ptrlength, int loophow, int pitchoffset, int angle, int distance,
               int priority, fix16_t volume, intptr_t callbackval)
 {
-    static constexpr decltype(FX_Play3D) *func[] = { FX_BadFmt3D, nullptr, MV_PlayVOC3D, MV_PlayWAV3D, MV_PlayVorbis3D, MV_PlayFLAC3D, MV_PlayXA3D, MV_PlayXMP3D };
+    static constexpr decltype(FX_Play3D) *func[] = { FX_BadFmt3D, nullptr, MV_PlayVOC3D, MV_PlayWAV3D, MV_PlayVorbis3D, MV_PlayFLAC3D, MV_PlayXA3D, MV_PlayXMP3D, nullptr };
 
     EDUKE32_STATIC_ASSERT(FMT_MAX == ARRAY_SIZE(func));
 
-    int handle = func[FX_ReadFmt(ptr, ptrlength)](ptr, ptrlength, loophow, pitchoffset, angle, distance, priority, volume, callbackval);
+    auto const fmt = FX_ReadFmt(ptr, ptrlength);
+    auto const pcm = priority != FX_MUSIC_PRIORITY ? MV_GetCachedPCM(ptr, ptrlength, fmt) : nullptr;
+
+    int handle = pcm ? MV_PlayPCM3D(pcm, loophow, pitchoffset, angle, distance, priority, volume, callbackval)
+                     : func[fmt](ptr, ptrlength, loophow, pitchoffset, angle, distance, priority, volume, callbackval);
 
     if (EDUKE32_PREDICT_FALSE(handle <= MV_Ok))
     {
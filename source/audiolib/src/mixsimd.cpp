@@ -0,0 +1,414 @@
+// mixsimd.cpp
+//  SSE2/AVX2/NEON versions of the voice mixers in mix.cpp and mixst.cpp.
+//
+// Each kernel mixes 4 or 8 frames of a voice per iteration into the float
+// mix bus. The source frames are still picked one at a time, since the
+// resampling steps through the sound at an arbitrary rate, but the volume
+// ramp, the scaling by the panned volume and the accumulation into the bus
+// are done on whole vectors: the ramp for frames n to n+3 is computed as
+// goal + delta * decay^n * { 1, decay, decay^2, decay^3 } instead of one
+// SMOOTH_VOLUME() step per frame. The leftover frames at the end of a call
+// go through the same math one frame at a time. The results differ from the
+// scalar mixers by float rounding only.
+//
+// The bus is converted to 16-bit samples once per buffer, 8 samples at a
+// time, by topcm.
+
+#include "_multivc.h"
+#include "build_cpuid.h"
+#include "compat.h"
+#include "log.h"
+
+#if defined EDUKE32_CPU_X86 && (EDUKE32_GCC_PREREQ(4,9) || defined __clang__ || defined _MSC_VER)
+# define MIXSIMD_X86
+# include <immintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+# define MIXSIMD_NEON
+# include <arm_neon.h>
+#endif
+
+#if defined __GNUC__ || defined __clang__
+# define SIMD_TARGET(x) __attribute__((target(x)))
+#else
+# define SIMD_TARGET(x)
+#endif
+
+#define SIMD_SSE2 SIMD_TARGET("sse2")
+#define SIMD_AVX2 SIMD_TARGET("avx2")
+
+// the kernels for each combination of source and output, in the order of mixsimd_t::mix
+#define MIXSIMD_FUNCS(f) \
+    { f<uint8_t, 1, 2>, f<uint8_t, 1, 1>, f<int16_t, 1, 2>, f<int16_t, 1, 1>, f<uint8_t, 2, 2>, f<uint8_t, 2, 1>, f<int16_t, 2, 2>, f<int16_t, 2, 1> }
+
+// channel ch of the frame at position, or the sum of both channels of a stereo source for mono output
+template <typename S, int SRCCH, int DSTCH>
+static FORCE_INLINE int32_t frameSample(S const * __restrict source, uint32_t const position, int const ch)
+{
+    S const *const frame = &source[(position >> 16) * SRCCH];
+
+    if (SRCCH == 1)
+        return CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(frame[0]);
+    else if (DSTCH == 1)
+        return CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(frame[0]) + CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(frame[1]);
+
+    return CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(frame[ch]);
+}
+
+template <typename S, int SRCCH, int DSTCH>
+static FORCE_INLINE float *mixFrames(S const * __restrict source, float * __restrict dest, uint32_t &position, uint32_t const rate,
+                                     mixvolume_t &volume, uint32_t length)
+{
+    for (; length > 0; length--)
+    {
+        float const l = (float)frameSample<S, SRCCH, DSTCH>(source, position, 0);
+
+        dest[0] += l * (volume.goal[0] + volume.delta[0] * volume.ramp);
+
+        if (DSTCH == 2)
+            dest[1] += (SRCCH == 2 ? (float)frameSample<S, SRCCH, DSTCH>(source, position, 1) : l) * (volume.goal[1] + volume.delta[1] * volume.ramp);
+
+        position += rate;
+        dest += DSTCH;
+        volume.ramp *= volume.decay;
+    }
+
+    return dest;
+}
+
+// a stereo source mixed to mono output is (left + right) / 2, frameSample() does the sum
+template <int SRCCH, int DSTCH>
+static FORCE_INLINE void adjustVolume(mixvolume_t &volume)
+{
+    if (SRCCH == 2 && DSTCH == 1)
+    {
+        volume.goal[0]  *= 0.5f;
+        volume.delta[0] *= 0.5f;
+    }
+}
+
+#ifdef MIXSIMD_X86
+
+///// SSE2 /////
+
+template <typename S, int SRCCH, int DSTCH>
+static SIMD_SSE2 uint32_t mix_sse2(VoiceNode * const voice, uint32_t length)
+{
+    auto const * __restrict source = (S const *)voice->sound;
+    auto       * __restrict dest   = MV_MixDestination;
+
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    auto           volume   = MV_GetMixVolume(voice);
+
+    adjustVolume<SRCCH, DSTCH>(volume);
+
+    float const d = volume.decay, d2 = d * d;
+    float const decay4 = d2 * d2;
+
+    __m128 const steps  = _mm_setr_ps(1.f, d, d2, d2 * d);
+    __m128 const goall  = _mm_set1_ps(volume.goal[0]);
+    __m128 const deltal = _mm_set1_ps(volume.delta[0]);
+    __m128 const goalr  = _mm_set1_ps(volume.goal[1]);
+    __m128 const deltar = _mm_set1_ps(volume.delta[1]);
+
+    for (; length >= 4; length -= 4)
+    {
+        uint32_t const p0 = position, p1 = p0 + rate, p2 = p1 + rate, p3 = p2 + rate;
+        position = p3 + rate;
+
+        __m128 const ramp = _mm_mul_ps(_mm_set1_ps(volume.ramp), steps);
+        __m128 const sl   = _mm_cvtepi32_ps(_mm_setr_epi32(frameSample<S, SRCCH, DSTCH>(source, p0, 0), frameSample<S, SRCCH, DSTCH>(source, p1, 0),
+                                                           frameSample<S, SRCCH, DSTCH>(source, p2, 0), frameSample<S, SRCCH, DSTCH>(source, p3, 0)));
+        __m128 const outl = _mm_mul_ps(sl, _mm_add_ps(goall, _mm_mul_ps(deltal, ramp)));
+
+        if (DSTCH == 1)
+            _mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), outl));
+        else
+        {
+            __m128 const sr   = SRCCH == 2 ? _mm_cvtepi32_ps(_mm_setr_epi32(frameSample<S, SRCCH, DSTCH>(source, p0, 1), frameSample<S, SRCCH, DSTCH>(source, p1, 1),
+                                                                            frameSample<S, SRCCH, DSTCH>(source, p2, 1), frameSample<S, SRCCH, DSTCH>(source, p3, 1)))
+                                             : sl;
+            __m128 const outr = _mm_mul_ps(sr, _mm_add_ps(goalr, _mm_mul_ps(deltar, ramp)));
+
+            _mm_storeu_ps(dest,     _mm_add_ps(_mm_loadu_ps(dest),     _mm_unpacklo_ps(outl, outr)));
+            _mm_storeu_ps(dest + 4, _mm_add_ps(_mm_loadu_ps(dest + 4), _mm_unpackhi_ps(outl, outr)));
+        }
+
+        dest += 4 * DSTCH;
+        volume.ramp *= decay4;
+    }
+
+    dest = mixFrames<S, SRCCH, DSTCH>(source, dest, position, rate, volume, length);
+
+    MV_PutMixVolume(voice, volume);
+    MV_MixDestination = dest;
+
+    return position;
+}
+
+static SIMD_SSE2 void topcm_sse2(int16_t *dest, float const *bus, int count)
+{
+    __m128 const pcmmin = _mm_set1_ps(INT16_MIN), pcmmax = _mm_set1_ps(INT16_MAX);
+
+    for (; count >= 8; count -= 8, dest += 8, bus += 8)
+    {
+        __m128i const pcm = _mm_loadu_si128((__m128i const *)dest);
+        __m128 const lo = _mm_add_ps(_mm_loadu_ps(bus),     _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16)));
+        __m128 const hi = _mm_add_ps(_mm_loadu_ps(bus + 4), _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(pcm, pcm), 16)));
+
+        _mm_storeu_si128((__m128i *)dest, _mm_packs_epi32(_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(lo, pcmmin), pcmmax)),
+                                                          _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(hi, pcmmin), pcmmax))));
+    }
+
+    if (count > 0)
+        MV_MixBusToPCM(dest, bus, count);
+}
+
+static SIMD_SSE2 void sumbus_sse2(float *dest, float const *bus, int count)
+{
+    for (; count >= 8; count -= 8, dest += 8, bus += 8)
+    {
+        _mm_storeu_ps(dest,     _mm_add_ps(_mm_loadu_ps(dest),     _mm_loadu_ps(bus)));
+        _mm_storeu_ps(dest + 4, _mm_add_ps(_mm_loadu_ps(dest + 4), _mm_loadu_ps(bus + 4)));
+    }
+
+    if (count > 0)
+        MV_SumBus(dest, bus, count);
+}
+
+///// AVX2 /////
+
+template <typename S, int SRCCH, int DSTCH>
+static SIMD_AVX2 uint32_t mix_avx2(VoiceNode * const voice, uint32_t length)
+{
+    auto const * __restrict source = (S const *)voice->sound;
+    auto       * __restrict dest   = MV_MixDestination;
+
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    auto           volume   = MV_GetMixVolume(voice);
+
+    adjustVolume<SRCCH, DSTCH>(volume);
+
+    float const d = volume.decay, d2 = d * d, d4 = d2 * d2;
+    float const decay8 = d4 * d4;
+
+    __m256 const steps  = _mm256_setr_ps(1.f, d, d2, d2 * d, d4, d4 * d, d4 * d2, d4 * d2 * d);
+    __m256 const goall  = _mm256_set1_ps(volume.goal[0]);
+    __m256 const deltal = _mm256_set1_ps(volume.delta[0]);
+    __m256 const goalr  = _mm256_set1_ps(volume.goal[1]);
+    __m256 const deltar = _mm256_set1_ps(volume.delta[1]);
+
+    for (; length >= 8; length -= 8)
+    {
+        uint32_t const p0 = position, p1 = p0 + rate, p2 = p1 + rate, p3 = p2 + rate;
+        uint32_t const p4 = p3 + rate, p5 = p4 + rate, p6 = p5 + rate, p7 = p6 + rate;
+        position = p7 + rate;
+
+        __m256 const ramp = _mm256_mul_ps(_mm256_set1_ps(volume.ramp), steps);
+        __m256 const sl   = _mm256_cvtepi32_ps(_mm256_setr_epi32(frameSample<S, SRCCH, DSTCH>(source, p0, 0), frameSample<S, SRCCH, DSTCH>(source, p1, 0),
+                                                                 frameSample<S, SRCCH, DSTCH>(source, p2, 0), frameSample<S, SRCCH, DSTCH>(source, p3, 0),
+                                                                 frameSample<S, SRCCH, DSTCH>(source, p4, 0), frameSample<S, SRCCH, DSTCH>(source, p5, 0),
+                                                                 frameSample<S, SRCCH, DSTCH>(source, p6, 0), frameSample<S, SRCCH, DSTCH>(source, p7, 0)));
+        __m256 const outl = _mm256_mul_ps(sl, _mm256_add_ps(goall, _mm256_mul_ps(deltal, ramp)));
+
+        if (DSTCH == 1)
+            _mm256_storeu_ps(dest, _mm256_add_ps(_mm256_loadu_ps(dest), outl));
+        else
+        {
+            __m256 const sr   = SRCCH == 2 ? _mm256_cvtepi32_ps(_mm256_setr_epi32(frameSample<S, SRCCH, DSTCH>(source, p0, 1), frameSample<S, SRCCH, DSTCH>(source, p1, 1),
+                                                                                  frameSample<S, SRCCH, DSTCH>(source, p2, 1), frameSample<S, SRCCH, DSTCH>(source, p3, 1),
+                                                                                  frameSample<S, SRCCH, DSTCH>(source, p4, 1), frameSample<S, SRCCH, DSTCH>(source, p5, 1),
+                                                                                  frameSample<S, SRCCH, DSTCH>(source, p6, 1), frameSample<S, SRCCH, DSTCH>(source, p7, 1)))
+                                             : sl;
+            __m256 const outr = _mm256_mul_ps(sr, _mm256_add_ps(goalr, _mm256_mul_ps(deltar, ramp)));
+
+            // the unpacks interleave within each 128-bit lane, giving frames 0-1 and 4-5, and 2-3 and 6-7
+            __m256 const lo = _mm256_unpacklo_ps(outl, outr);
+            __m256 const hi = _mm256_unpackhi_ps(outl, outr);
+
+            _mm256_storeu_ps(dest,     _mm256_add_ps(_mm256_loadu_ps(dest),     _mm256_permute2f128_ps(lo, hi, 0x20)));
+            _mm256_storeu_ps(dest + 8, _mm256_add_ps(_mm256_loadu_ps(dest + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+        }
+
+        dest += 8 * DSTCH;
+        volume.ramp *= decay8;
+    }
+
+    dest = mixFrames<S, SRCCH, DSTCH>(source, dest, position, rate, volume, length);
+
+    MV_PutMixVolume(voice, volume);
+    MV_MixDestination = dest;
+
+    return position;
+}
+
+static SIMD_AVX2 void sumbus_avx2(float *dest, float const *bus, int count)
+{
+    for (; count >= 16; count -= 16, dest += 16, bus += 16)
+    {
+        _mm256_storeu_ps(dest,     _mm256_add_ps(_mm256_loadu_ps(dest),     _mm256_loadu_ps(bus)));
+        _mm256_storeu_ps(dest + 8, _mm256_add_ps(_mm256_loadu_ps(dest + 8), _mm256_loadu_ps(bus + 8)));
+    }
+
+    if (count > 0)
+        MV_SumBus(dest, bus, count);
+}
+
+#endif // MIXSIMD_X86
+
+#ifdef MIXSIMD_NEON
+
+///// NEON /////
+
+// builds the vector in registers, going through memory would stall on the four separate stores
+static FORCE_INLINE int32x4_t makeVector(int32_t a, int32_t b, int32_t c, int32_t d)
+{
+    return vsetq_lane_s32(d, vsetq_lane_s32(c, vsetq_lane_s32(b, vdupq_n_s32(a), 1), 2), 3);
+}
+
+template <typename S, int SRCCH, int DSTCH>
+static uint32_t mix_neon(VoiceNode * const voice, uint32_t length)
+{
+    auto const * __restrict source = (S const *)voice->sound;
+    auto       * __restrict dest   = MV_MixDestination;
+
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    auto           volume   = MV_GetMixVolume(voice);
+
+    adjustVolume<SRCCH, DSTCH>(volume);
+
+    float const d = volume.decay, d2 = d * d;
+    float const decay4 = d2 * d2;
+    float const stepv[4] = { 1.f, d, d2, d2 * d };
+
+    float32x4_t const steps  = vld1q_f32(stepv);
+    float32x4_t const goall  = vdupq_n_f32(volume.goal[0]);
+    float32x4_t const deltal = vdupq_n_f32(volume.delta[0]);
+    float32x4_t const goalr  = vdupq_n_f32(volume.goal[1]);
+    float32x4_t const deltar = vdupq_n_f32(volume.delta[1]);
+
+    for (; length >= 4; length -= 4)
+    {
+        uint32_t const p0 = position, p1 = p0 + rate, p2 = p1 + rate, p3 = p2 + rate;
+        position = p3 + rate;
+
+        float32x4_t const ramp = vmulq_n_f32(steps, volume.ramp);
+        float32x4_t const sl   = vcvtq_f32_s32(makeVector(frameSample<S, SRCCH, DSTCH>(source, p0, 0), frameSample<S, SRCCH, DSTCH>(source, p1, 0),
+                                                          frameSample<S, SRCCH, DSTCH>(source, p2, 0), frameSample<S, SRCCH, DSTCH>(source, p3, 0)));
+        float32x4_t const outl = vmulq_f32(sl, vmlaq_f32(goall, deltal, ramp));
+
+        if (DSTCH == 1)
+            vst1q_f32(dest, vaddq_f32(vld1q_f32(dest), outl));
+        else
+        {
+            float32x4_t const   sr   = SRCCH == 2 ? vcvtq_f32_s32(makeVector(frameSample<S, SRCCH, DSTCH>(source, p0, 1), frameSample<S, SRCCH, DSTCH>(source, p1, 1),
+                                                                            frameSample<S, SRCCH, DSTCH>(source, p2, 1), frameSample<S, SRCCH, DSTCH>(source, p3, 1)))
+                                                 : sl;
+            float32x4_t const   outr = vmulq_f32(sr, vmlaq_f32(goalr, deltar, ramp));
+            float32x4x2_t const out  = vzipq_f32(outl, outr);
+
+            vst1q_f32(dest,     vaddq_f32(vld1q_f32(dest),     out.val[0]));
+            vst1q_f32(dest + 4, vaddq_f32(vld1q_f32(dest + 4), out.val[1]));
+        }
+
+        dest += 4 * DSTCH;
+        volume.ramp *= decay4;
+    }
+
+    dest = mixFrames<S, SRCCH, DSTCH>(source, dest, position, rate, volume, length);
+
+    MV_PutMixVolume(voice, volume);
+    MV_MixDestination = dest;
+
+    return position;
+}
+
+static FORCE_INLINE int32x4_t roundToInt(float32x4_t x)
+{
+#ifdef __aarch64__
+    return vcvtnq_s32_f32(x);
+#else
+    return vcvtq_s32_f32(vaddq_f32(x, vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f))));
+#endif
+}
+
+static void topcm_neon(int16_t *dest, float const *bus, int count)
+{
+    for (; count >= 8; count -= 8, dest += 8, bus += 8)
+    {
+        int16x8_t const   pcm = vld1q_s16(dest);
+        float32x4_t const lo  = vaddq_f32(vld1q_f32(bus),     vcvtq_f32_s32(vmovl_s16(vget_low_s16(pcm))));
+        float32x4_t const hi  = vaddq_f32(vld1q_f32(bus + 4), vcvtq_f32_s32(vmovl_s16(vget_high_s16(pcm))));
+
+        vst1q_s16(dest, vcombine_s16(vqmovn_s32(roundToInt(lo)), vqmovn_s32(roundToInt(hi))));
+    }
+
+    if (count > 0)
+        MV_MixBusToPCM(dest, bus, count);
+}
+
+static void sumbus_neon(float *dest, float const *bus, int count)
+{
+    for (; count >= 8; count -= 8, dest += 8, bus += 8)
+    {
+        vst1q_f32(dest,     vaddq_f32(vld1q_f32(dest),     vld1q_f32(bus)));
+        vst1q_f32(dest + 4, vaddq_f32(vld1q_f32(dest + 4), vld1q_f32(bus + 4)));
+    }
+
+    if (count > 0)
+        MV_SumBus(dest, bus, count);
+}
+
+#endif // MIXSIMD_NEON
+
+static mixsimd_t const simdfuncs[] =
+{
+    { { MV_MixStereo<uint8_t>,       MV_MixMono<uint8_t>,       MV_MixStereo<int16_t>,       MV_MixMono<int16_t>,
+        MV_MixStereoStereo<uint8_t>, MV_MixMonoStereo<uint8_t>, MV_MixStereoStereo<int16_t>, MV_MixMonoStereo<int16_t> },
+      MV_MixBusToPCM, MV_SumBus },
+#if defined MIXSIMD_X86
+    { MIXSIMD_FUNCS(mix_sse2), topcm_sse2, sumbus_sse2 },
+    { MIXSIMD_FUNCS(mix_avx2), topcm_sse2, sumbus_avx2 },
+#elif defined MIXSIMD_NEON
+    { MIXSIMD_FUNCS(mix_neon), topcm_neon, sumbus_neon },
+#endif
+};
+
+mixsimd_t MV_MixSimd = simdfuncs[MV_MIXSIMD_SCALAR];
+
+char const *MV_MixSimdName(int level)
+{
+#ifdef MIXSIMD_NEON
+    static char const *const levelnames[] = { "scalar", "NEON", "AVX2" };
+#else
+    static char const *const levelnames[] = { "scalar", "SSE2", "AVX2" };
+#endif
+
+    return levelnames[clamp(level, MV_MIXSIMD_SCALAR, MV_MIXSIMD_VEC8)];
+}
+
+int MV_MixSimdInit(int maxlevel)
+{
+    int level = MV_MIXSIMD_SCALAR;
+
+#if defined MIXSIMD_X86
+    if (cpu.features.sse2)
+    {
+        level = MV_MIXSIMD_VEC4;
+
+        if (cpu.features.avx2)
+            level = MV_MIXSIMD_VEC8;
+    }
+#elif defined MIXSIMD_NEON
+    level = MV_MIXSIMD_VEC4;
+#endif
+
+    level = clamp(maxlevel, MV_MIXSIMD_SCALAR, level);
+    MV_MixSimd = simdfuncs[level];
+
+    LOG_F(INFO, "Sound mixing using %s kernels", MV_MixSimdName(level));
+
+    return level;
+}
@@ -20,10 +20,10 @@
 
 #include "_multivc.h"
 
-template uint32_t MV_MixMonoStereo<uint8_t, int16_t>(struct VoiceNode * const voice, uint32_t length);
-template uint32_t MV_MixStereoStereo<uint8_t, int16_t>(struct VoiceNode * const voice, uint32_t length);
-template uint32_t MV_MixMonoStereo<int16_t, int16_t>(struct VoiceNode * const voice, uint32_t length);
-template uint32_t MV_MixStereoStereo<int16_t, int16_t>(struct VoiceNode * const voice, uint32_t length);
+template uint32_t MV_MixMonoStereo<uint8_t>(struct VoiceNode * const voice, uint32_t length);
+template uint32_t MV_MixStereoStereo<uint8_t>(struct VoiceNode * const voice, uint32_t length);
+template uint32_t MV_MixMonoStereo<int16_t>(struct VoiceNode * const voice, uint32_t length);
+template uint32_t MV_MixStereoStereo<int16_t>(struct VoiceNode * const voice, uint32_t length);
 
 /*
  length = count of samples to mix
@@ -33,63 +33,63 @@ template uint32_t MV_MixStereoStereo<int16_t, int16_t>(struct VoiceNode * const
  */
 
 // stereo source, mono output
-template <typename S, typename D>
+template <typename S>
 uint32_t MV_MixMonoStereo(struct VoiceNode * const voice, uint32_t length)
 {
     auto const * __restrict source = (S const *)voice->sound;
-    auto       * __restrict dest   = (D *)MV_MixDestination;
+    auto       * __restrict dest   = MV_MixDestination;
 
     uint32_t       position = voice->position;
     uint32_t const rate     = voice->RateScale;
-    fix16_t const  volume   = fix16_fast_trunc_mul(voice->volume, MV_GlobalVolume);
+    auto           volume   = MV_GetMixVolume(voice);
 
     do
     {
-        auto const isample0 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[(position >> 16) << 1]);
-        auto const isample1 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[((position >> 16) << 1) + 1]);
+        auto const isample0 = (float)CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(source[(position >> 16) << 1]);
+        auto const isample1 = (float)CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(source[((position >> 16) << 1) + 1]);
 
         position += rate;
 
-        *dest = MIX_SAMPLES<D>((SCALE_SAMPLE((isample0 + isample1) >> 1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left))), *dest);
-        dest++;
+        *dest++ += (isample0 + isample1) * 0.5f * (volume.goal[0] + volume.delta[0] * volume.ramp);
 
-        voice->PannedVolume.Left = SMOOTH_VOLUME(voice->PannedVolume.Left, voice->GoalVolume.Left);
+        volume.ramp *= volume.decay;
     }
     while (--length);
 
-    MV_MixDestination = (char *)dest;
+    MV_PutMixVolume(voice, volume);
+    MV_MixDestination = dest;
 
     return position;
 }
 
 // stereo source, stereo output
-template <typename S, typename D>
+template <typename S>
 uint32_t MV_MixStereoStereo(struct VoiceNode * const voice, uint32_t length)
 {
     auto const * __restrict source = (S const *)voice->sound;
-    auto       * __restrict dest   = (D *)MV_MixDestination;
+    auto       * __restrict dest   = MV_MixDestination;
 
     uint32_t       position = voice->position;
     uint32_t const rate     = voice->RateScale;
-    fix16_t const  volume   = fix16_fast_trunc_mul(voice->volume, MV_GlobalVolume);
+    auto           volume   = MV_GetMixVolume(voice);
 
     do
     {
-        auto const isample0 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[(position >> 16) << 1]);
-        auto const isample1 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[((position >> 16) << 1) + 1]);
+        auto const isample0 = (float)CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(source[(position >> 16) << 1]);
+        auto const isample1 = (float)CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(source[((position >> 16) << 1) + 1]);
 
         position += rate;
 
-        *dest = MIX_SAMPLES<D>(SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left)), *dest);
-        *(dest + (MV_RightChannelOffset / sizeof(*dest)))
-            = MIX_SAMPLES<D>(SCALE_SAMPLE(isample1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Right)), *(dest + (MV_RightChannelOffset / sizeof(*dest))));
+        dest[0] += isample0 * (volume.goal[0] + volume.delta[0] * volume.ramp);
+        dest[1] += isample1 * (volume.goal[1] + volume.delta[1] * volume.ramp);
         dest += 2;
 
-        voice->PannedVolume = { SMOOTH_VOLUME(voice->PannedVolume.Left, voice->GoalVolume.Left), SMOOTH_VOLUME(voice->PannedVolume.Right, voice->GoalVolume.Right) };
+        volume.ramp *= volume.decay;
     }
     while (--length);
 
-    MV_MixDestination = (char *)dest;
+    MV_PutMixVolume(voice, volume);
+    MV_MixDestination = dest;
 
     return position;
 }
@@ -40,9 +40,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "fx_man.h"
 #include "libasync_config.h"
 #include "linklist.h"
+#include "microprofile.h"
 #include "osd.h"
 #include "pitch.h"
 #include "pragmas.h"
+#include "spscring.h"
+#include "timer.h"
+
+#include <mutex>
 
 #ifdef HAVE_XMP
 # define BUILDING_STATIC
@@ -92,9 +97,28 @@ static int MV_MixPage;
 
 static void (*MV_CallBackFunc)(intptr_t);
 
-char *MV_MixDestination;
+thread_local float *MV_MixDestination;
 int MV_SampleSize = 1;
-int MV_RightChannelOffset;
+
+// see _multivc.h
+alignas(32) static float MV_MixBus[MV_MIXBUFFERSIZE * 2];
+
+// With MV_MixThreads > 1 the voices are dealt out to that many jobs, one of them run by the audio thread itself.
+// Each job mixes into its own bus, and the buses are summed into MV_MixBus once all of them are done.
+int MV_MixThreads = 1;
+
+static async::threadpool_scheduler *MV_MixPool;
+static int MV_MixPoolThreads = 1;
+
+alignas(32) static float MV_MixSubBus[MV_MAXMIXTHREADS - 1][MV_MIXBUFFERSIZE * 2];
+
+static VoiceNode *MV_MixVoices[MV_MAXVOICES];
+static bool       MV_MixVoiceDone[MV_MAXVOICES];
+
+static mixstats_t MV_MixStats;
+static std::atomic<uint64_t> MV_DecodeTicks[FMT_MAX];
+static std::atomic<uint64_t> MV_CommandsQueued, MV_CommandsRun;
+static std::atomic<uint32_t> MV_CommandRingFull, MV_CommandsDropped;
 
 int MV_ErrorCode = MV_NotInstalled;
 
@@ -107,7 +131,46 @@ static void (*MV_MusicCallback)(void);
 
 static VoiceNode **MV_Handles;
 
-static bool MV_Mix(VoiceNode * const voice, int const buffer)
+// Game threads don't change VoiceList or a playing voice themselves, they queue commands that the mixer carries out at the
+// start of each buffer. MV_CommandMutex only orders the game threads among themselves and guards VoicePool and MV_Handles;
+// the mixer never waits for it.
+enum
+{
+    MVCMD_PLAY,
+    MVCMD_SETPAN,
+    MVCMD_SETPITCH,
+    MVCMD_ENDLOOP,
+    MVCMD_STOP,
+};
+
+typedef struct
+{
+    VoiceNode *voice;
+    int        type;
+    int        args[3];
+} mvcommand_t;
+
+#define MV_COMMANDRINGSIZE 1024
+
+static SPSCRing<mvcommand_t, MV_COMMANDRINGSIZE> MV_Commands;
+static std::mutex MV_CommandMutex;
+
+// voices that have stopped playing only go back to VoicePool once no queued command can refer to them
+static VoiceNode *MV_StoppedVoices[MV_MAXVOICES];
+static int        MV_NumStoppedVoices;
+
+// decoding happens a block at a time, so timing every call costs next to nothing
+static playbackstatus MV_GetNextBlock(VoiceNode * const voice)
+{
+    uint64_t const startTicks = timerGetNanoTicks();
+    auto const     status     = voice->GetSound(voice);
+
+    MV_DecodeTicks[voice->wavetype].fetch_add(timerGetNanoTicks() - startTicks, std::memory_order_relaxed);
+
+    return status;
+}
+
+static bool MV_MixVoice(VoiceNode * const voice, float * const bus)
 {
     if (voice->task.valid())
     {
@@ -123,19 +186,14 @@ static bool MV_Mix(VoiceNode * const voice, int const buffer)
         }
     }
 
-    if (voice->length == 0 && voice->GetSound(voice) != KeepPlaying)
+    if (voice->length == 0 && MV_GetNextBlock(voice) != KeepPlaying)
         return false;
 
-    fix16_t const gv = MV_GlobalVolume;
-
-    if (voice->priority == FX_MUSIC_PRIORITY)
-        MV_GlobalVolume = fix16_one;
-
     int            length = MV_MIXBUFFERSIZE;
     uint32_t       bufsiz = voice->FixedPointBufferSize;
     uint32_t const rate   = voice->RateScale;
 
-    MV_MixDestination = MV_MixBuffer[buffer];
+    MV_MixDestination = bus;
 
     // Add this voice to the mix
     do
@@ -150,11 +208,8 @@ static bool MV_Mix(VoiceNode * const voice, int const buffer)
         {
             if (position >= voclen - voice->channels)
             {
-                if (voice->GetSound(voice) != KeepPlaying)
-                {
-                    MV_GlobalVolume = gv;
+                if (MV_GetNextBlock(voice) != KeepPlaying)
                     return false;
-                }
 
                 break;
             }
@@ -168,11 +223,8 @@ static bool MV_Mix(VoiceNode * const voice, int const buffer)
         if (voice->position >= voclen - voice->channels)
         {
             // Get the next block of sound
-            if (voice->GetSound(voice) != KeepPlaying)
-            {
-                MV_GlobalVolume = gv;
+            if (MV_GetNextBlock(voice) != KeepPlaying)
                 return false;
-            }
 
             // Get the position of the last sample in the buffer
             if (length > (voice->channels - 1))
@@ -180,37 +232,26 @@ static bool MV_Mix(VoiceNode * const voice, int const buffer)
         }
     } while (length > 0);
 
-    MV_GlobalVolume = gv;
     return true;
 }
 
-void MV_PlayVoice(VoiceNode *voice)
+// the music voice ignores the global volume, it is only ever mixed by the audio thread
+static bool MV_Mix(VoiceNode * const voice, float * const bus)
 {
-    MV_Lock();
-    LL::SortedInsert(&VoiceList, voice, &VoiceNode::priority);
-    voice->PannedVolume = voice->GoalVolume;
-    voice->Paused.store(false, std::memory_order_release);
-    MV_Unlock();
-}
+    if (voice->priority != FX_MUSIC_PRIORITY)
+        return MV_MixVoice(voice, bus);
 
-static void MV_FreeHandle(VoiceNode* voice)
-{
-    if (voice->handle < MV_MINVOICEHANDLE)
-        return;
+    fix16_t const gv = MV_GlobalVolume;
 
-    MV_Handles[voice->handle - MV_MINVOICEHANDLE] = nullptr;
-    voice->handle = 0;
-    voice->length = 0;
-    voice->sound = nullptr;
-    voice->wavetype = FMT_UNKNOWN;
-    LL::Move(voice, &VoicePool);
+    MV_GlobalVolume = fix16_one;
+    bool const playing = MV_MixVoice(voice, bus);
+    MV_GlobalVolume = gv;
+
+    return playing;
 }
 
-static void MV_CleanupVoice(VoiceNode* voice)
+static void MV_ReleaseVoice(VoiceNode* voice)
 {
-    if (MV_CallBackFunc)
-        MV_CallBackFunc(voice->callbackval);
-
     switch (voice->wavetype)
     {
 #ifdef HAVE_VORBIS
@@ -223,6 +264,7 @@ static void MV_CleanupVoice(VoiceNode* voice)
 #ifdef HAVE_XMP
         case FMT_XMP:    MV_ReleaseXMPVoice(voice); break;
 #endif
+        case FMT_PCM:    MV_ReleasePCMVoice(voice); break;
         default:
             // these are in the default case of this switch instead of down below because the functions above only zero them if MV_LazyAlloc is false
             voice->rawdataptr = nullptr;
@@ -231,13 +273,138 @@ static void MV_CleanupVoice(VoiceNode* voice)
     }
 }
 
-static void MV_StopVoice(VoiceNode *voice)
+// takes the voice out of VoiceList, it goes back to VoicePool in MV_ReclaimVoices()
+static void MV_RetireVoice(VoiceNode* voice)
+{
+    MV_ReleaseVoice(voice);
+
+    // a voice that was stopped before MVCMD_PLAY reached the mixer is in no list at all
+    if (voice->next)
+        LL::Remove(voice);
+
+    MV_StoppedVoices[MV_NumStoppedVoices++] = voice;
+}
+
+// called by the mixer for voices that ran out of data
+static void MV_StopVoice(VoiceNode* voice)
+{
+    // lost the race against MV_Kill(), whose MVCMD_STOP will retire the voice
+    if (voice->Stopped.exchange(true, std::memory_order_acq_rel))
+        return;
+
+    if (MV_CallBackFunc)
+        MV_CallBackFunc(voice->callbackval);
+
+    MV_RetireVoice(voice);
+}
+
+static void MV_ProcessCommands(void)
+{
+    mvcommand_t cmd;
+
+    while (MV_Commands.pop(cmd))
+    {
+        auto voice = cmd.voice;
+
+        MV_CommandsRun.fetch_add(1, std::memory_order_relaxed);
+
+        switch (cmd.type)
+        {
+            case MVCMD_PLAY:
+                // killed before it got here, see MVCMD_STOP
+                if (voice->Stopped.load(std::memory_order_acquire))
+                {
+                    MV_RetireVoice(voice);
+                    break;
+                }
+                LL::SortedInsert(&VoiceList, voice, &VoiceNode::priority);
+                voice->PannedVolume = voice->GoalVolume;
+                voice->Paused.store(false, std::memory_order_release);
+                break;
+            case MVCMD_SETPAN:
+                MV_SetVoiceVolume(voice, cmd.args[0], cmd.args[1], cmd.args[2], voice->volume);
+                break;
+            case MVCMD_SETPITCH:
+                MV_SetVoicePitch(voice, cmd.args[0] ? cmd.args[0] : voice->SamplingRate, cmd.args[1]);
+                break;
+            case MVCMD_ENDLOOP:
+                voice->Loop = {};
+                break;
+            case MVCMD_STOP:
+                // A stale handle can kill a voice that its owner hasn't posted MVCMD_PLAY for yet. It mustn't be
+                // reclaimed before then, so MVCMD_PLAY retires it instead.
+                if (voice->next)
+                    MV_RetireVoice(voice);
+                break;
+        }
+    }
+}
+
+// only safe with MV_CommandMutex held and the command ring drained
+static void MV_ReclaimVoices(void)
 {
-    MV_CleanupVoice(voice);
+    for (int i = 0; i < MV_NumStoppedVoices; i++)
+    {
+        auto voice = MV_StoppedVoices[i];
+
+        // MV_Kill() gives the handle up straight away, it may belong to another voice by now
+        if (voice->handle >= MV_MINVOICEHANDLE && MV_Handles[voice->handle - MV_MINVOICEHANDLE] == voice)
+            MV_Handles[voice->handle - MV_MINVOICEHANDLE] = nullptr;
+
+        voice->length   = 0;
+        voice->sound    = nullptr;
+        voice->wavetype = FMT_UNKNOWN;
+        LL::Insert(&VoicePool, voice);
+    }
+
+    MV_NumStoppedVoices = 0;
+}
+
+// Makes the calling thread the consumer of the command ring. Returns with both MV_Lock() and MV_CommandMutex held, the
+// ring drained and every stopped voice back in VoicePool.
+static void MV_FlushCommands(std::unique_lock<std::mutex> &lock)
+{
+    if (lock.owns_lock())
+        lock.unlock();
+
     MV_Lock();
-    // move the voice from the play list to the free list
-    MV_FreeHandle(voice);
-    MV_Unlock();
+    lock.lock();
+
+    MV_ProcessCommands();
+    MV_ReclaimVoices();
+}
+
+// Returns with MV_CommandMutex held and room in the ring for one command.
+static std::unique_lock<std::mutex> MV_LockCommands(void)
+{
+    std::unique_lock<std::mutex> lock(MV_CommandMutex);
+
+    // the mixer has fallen behind or isn't running
+    if (MV_Commands.size() == MV_COMMANDRINGSIZE)
+    {
+        MV_CommandRingFull.fetch_add(1, std::memory_order_relaxed);
+        MV_FlushCommands(lock);
+        MV_Unlock();
+    }
+
+    return lock;
+}
+
+static void MV_PostCommand(VoiceNode *voice, int type, int arg0 = 0, int arg1 = 0, int arg2 = 0)
+{
+    bool const queued = MV_Commands.push({ voice, type, { arg0, arg1, arg2 } });
+    Bassert(queued);
+
+    if (EDUKE32_PREDICT_TRUE(queued))
+        MV_CommandsQueued.fetch_add(1, std::memory_order_relaxed);
+    else
+        MV_CommandsDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MV_PlayVoice(VoiceNode *voice)
+{
+    auto lock = MV_LockCommands();
+    MV_PostCommand(voice, MVCMD_PLAY);
 }
 
 /*---------------------------------------------------------------------
@@ -247,8 +414,38 @@ static void MV_StopVoice(VoiceNode *voice)
         locking in the user-space functions of MultiVoc. The call
         to MV_ServiceVoc is synchronised in the driver.
 ---------------------------------------------------------------------*/
+static void MV_MixVoiceList(int const numvoices, int const busSamples)
+{
+    int const numjobs = min(MV_MixPoolThreads, numvoices / MV_MINVOICESPERTHREAD);
+
+    if (numjobs < 2)
+    {
+        for (int i = 0; i < numvoices; i++)
+            MV_MixVoiceDone[i] = !MV_Mix(MV_MixVoices[i], MV_MixBus);
+
+        return;
+    }
+
+    // dealing the voices out in turn spreads the expensive ones, which tend to be next to each other in priority order
+    async::parallel_for(*MV_MixPool, async::static_partitioner(async::irange(0, numjobs), 1), [numvoices, numjobs, busSamples](int const job)
+    {
+        auto bus = job ? MV_MixSubBus[job - 1] : MV_MixBus;
+
+        if (job)
+            Bmemset(bus, 0, busSamples * sizeof(float));
+
+        for (int i = job; i < numvoices; i += numjobs)
+            MV_MixVoiceDone[i] = !MV_Mix(MV_MixVoices[i], bus);
+    });
+
+    for (int job = 1; job < numjobs; job++)
+        MV_MixSimd.sumbus(MV_MixBus, MV_MixSubBus[job - 1], busSamples);
+}
+
 static void MV_ServiceVoc(void)
 {
+    uint64_t const startTicks = timerGetNanoTicks();
+
     // Toggle which buffer we'll mix next
     ++MV_MixPage;
     MV_MixPage &= MV_NumberOfBuffers-1;
@@ -285,53 +482,140 @@ static void MV_ServiceVoc(void)
         } while (length > 0);
     }
 
-    VoiceNode *MusicVoice = nullptr;
+    MV_ProcessCommands();
 
-    if (VoiceList.next && VoiceList.next != &VoiceList)
+    // anything queued since might still refer to a stopped voice, so the voices are only reclaimed with the game threads kept out
+    if (MV_NumStoppedVoices > 0 && MV_CommandMutex.try_lock())
     {
-        auto voice = VoiceList.next;
-        VoiceNode *next;
+        MV_ProcessCommands();
+        MV_ReclaimVoices();
+        MV_CommandMutex.unlock();
+    }
 
-        do
-        {
-            next = voice->next;
+    VoiceNode *MusicVoice = nullptr;
+    int const  busSamples = MV_BufferSize / sizeof(int16_t);
+    int        numVoices  = 0;
 
-            if (voice->Paused.load(std::memory_order_acquire))
+    if (VoiceList.next)
+    {
+        for (auto voice = VoiceList.next; voice != &VoiceList; voice = voice->next)
+        {
+            if (voice->Paused.load(std::memory_order_acquire) || voice->Stopped.load(std::memory_order_acquire))
                 continue;
 
             if (voice->priority == FX_MUSIC_PRIORITY)
-            {
                 MusicVoice = voice;
-                continue;
-            }
+            else
+                MV_MixVoices[numVoices++] = voice;
+        }
+    }
 
-            MV_BufferEmpty[ MV_MixPage ] = FALSE;
+    if (numVoices > 0)
+    {
+        MV_BufferEmpty[ MV_MixPage ] = FALSE;
 
-            // Is this voice done?
-            if (!MV_Mix(voice, MV_MixPage))
-            {
-                MV_CleanupVoice(voice);
-                MV_FreeHandle(voice);
-            }
+        Bmemset(MV_MixBus, 0, busSamples * sizeof(float));
+        MV_MixVoiceList(numVoices, busSamples);
+        MV_MixSimd.topcm((int16_t *)MV_MixBuffer[MV_MixPage], MV_MixBus, busSamples);
+
+        // the callbacks are made from this thread in priority order, however the voices were mixed
+        for (int i = 0; i < numVoices; i++)
+        {
+            if (MV_MixVoiceDone[i])
+                MV_StopVoice(MV_MixVoices[i]);
         }
-        while ((voice = next) != &VoiceList);
     }
 
     Bmemcpy(MV_MixBuffer[MV_MixPage+MV_NumberOfBuffers], MV_MixBuffer[MV_MixPage], MV_BufferSize);
 
+    uint64_t musicTicks = 0;
+
     if (MV_MusicCallback)
     {
+        musicTicks = timerGetNanoTicks();
         MV_MusicCallback();
+        musicTicks = timerGetNanoTicks() - musicTicks;
+
         int16_t * __restrict source = (int16_t*)MV_MusicBuffer;
         int16_t * __restrict dest = (int16_t*)MV_MixBuffer[MV_MixPage+MV_NumberOfBuffers];
         for (int32_t i = 0; i < MV_BufferSize>>1; i++, dest++)
             *dest = clamp(*dest + *source++,INT16_MIN, INT16_MAX);
     }
 
-    if (MusicVoice && !MV_Mix(MusicVoice, MV_MixPage + MV_NumberOfBuffers))
+    if (MusicVoice)
     {
-        MV_CleanupVoice(MusicVoice);
-        MV_FreeHandle(MusicVoice);
+        Bmemset(MV_MixBus, 0, busSamples * sizeof(float));
+
+        bool const playing = MV_Mix(MusicVoice, MV_MixBus);
+
+        MV_MixSimd.topcm((int16_t *)MV_MixBuffer[MV_MixPage + MV_NumberOfBuffers], MV_MixBus, busSamples);
+
+        if (!playing)
+            MV_StopVoice(MusicVoice);
+    }
+
+    uint64_t const mixTime = (timerGetNanoTicks() - startTicks) * 1000000000ull / timerGetNanoTickRate();
+
+    MV_MixStats.buffers++;
+    MV_MixStats.misses    += mixTime > MV_MixStats.deadline;
+    MV_MixStats.totaltime += mixTime;
+    MV_MixStats.maxtime    = max(MV_MixStats.maxtime, mixTime);
+    MV_MixStats.maxvoices  = max<uint32_t>(MV_MixStats.maxvoices, numVoices + (MusicVoice != nullptr));
+    MV_MixStats.voicemixes += numVoices + (MusicVoice != nullptr);
+    MV_MixStats.musictime  += musicTicks * 1000000000ull / timerGetNanoTickRate();
+}
+
+void MV_GetMixStats(mixstats_t *stats, bool reset)
+{
+    MV_Lock();
+
+    *stats = MV_MixStats;
+
+    for (int i = 0; i < FMT_MAX; i++)
+    {
+        uint64_t const ticks = reset ? MV_DecodeTicks[i].exchange(0, std::memory_order_relaxed) : MV_DecodeTicks[i].load(std::memory_order_relaxed);
+        stats->decodetime[i] = ticks * 1000000000ull / timerGetNanoTickRate();
+    }
+
+    stats->commands    = reset ? MV_CommandsQueued.exchange(0, std::memory_order_relaxed) : MV_CommandsQueued.load(std::memory_order_relaxed);
+    stats->commandsrun = reset ? MV_CommandsRun.exchange(0, std::memory_order_relaxed) : MV_CommandsRun.load(std::memory_order_relaxed);
+    stats->ringfull    = reset ? MV_CommandRingFull.exchange(0, std::memory_order_relaxed) : MV_CommandRingFull.load(std::memory_order_relaxed);
+    stats->dropped     = reset ? MV_CommandsDropped.exchange(0, std::memory_order_relaxed) : MV_CommandsDropped.load(std::memory_order_relaxed);
+
+    if (reset)
+    {
+        uint64_t const deadline = MV_MixStats.deadline;
+
+        MV_MixStats = {};
+        MV_MixStats.deadline = deadline;
+    }
+
+    MV_Unlock();
+}
+
+void MV_SetMixThreads(void)
+{
+    int const numthreads = MV_Installed ? clamp(MV_MixThreads, 1, MV_MAXMIXTHREADS) : 1;
+
+    if (numthreads == MV_MixPoolThreads)
+        return;
+
+    // the audio thread is stopped by the time MV_Shutdown() gets here
+    if (MV_Installed)
+        MV_Lock();
+
+    DO_DELETE_AND_NULL(MV_MixPool);
+
+    // the audio thread runs one of the jobs, so the pool needs one thread less
+    if (numthreads > 1)
+        MV_MixPool = new async::threadpool_scheduler(numthreads - 1, []() { MicroProfileOnThreadCreate("Sound mix"); }, nullptr);
+
+    MV_MixPoolThreads = numthreads;
+
+    if (MV_Installed)
+    {
+        MV_Unlock();
+        VLOG_F(LOG_ASS, "Mixing sound voices on %d thread%s", numthreads, numthreads > 1 ? "s" : "");
     }
 }
 
@@ -343,19 +627,26 @@ static VoiceNode *MV_GetVoice(int handle)
         return nullptr;
     }
 
-    if (MV_Handles[handle - MV_MINVOICEHANDLE] != nullptr)
-        return MV_Handles[handle - MV_MINVOICEHANDLE];
+    auto voice = MV_Handles[handle - MV_MINVOICEHANDLE];
+
+    if (voice != nullptr && !voice->Stopped.load(std::memory_order_acquire))
+        return voice;
 
     MV_SetErrorCode(MV_VoiceNotFound);
     return nullptr;
 }
 
-VoiceNode *MV_BeginService(int handle)
+static VoiceNode *MV_WaitForVoice(int handle)
 {
     if (!MV_Installed)
         return nullptr;
 
-    auto voice = MV_GetVoice(handle);
+    VoiceNode *voice;
+
+    {
+        std::lock_guard<std::mutex> lock(MV_CommandMutex);
+        voice = MV_GetVoice(handle);
+    }
 
     if (voice == nullptr)
     {
@@ -363,51 +654,100 @@ VoiceNode *MV_BeginService(int handle)
         return nullptr;
     }
 
+    // the task posts MVCMD_PLAY itself, so it can't be waited for with MV_CommandMutex held
     if (voice->task.valid() && !voice->task.ready())
         voice->task.wait();
 
+    return voice;
+}
+
+VoiceNode *MV_BeginService(int handle)
+{
+    if (MV_WaitForVoice(handle) == nullptr)
+        return nullptr;
+
     MV_Lock();
 
+    // the mixer may have stopped the voice while we waited
+    auto voice = MV_GetVoice(handle);
+
+    if (voice == nullptr)
+        MV_Unlock();
+
     return voice;
 }
 
 static inline void MV_EndService(void) { MV_Unlock(); }
 
+// Returns with MV_CommandMutex held when the voice is found, so it can't be reclaimed before the command is queued.
+static VoiceNode *MV_BeginCommand(int handle, std::unique_lock<std::mutex> &lock)
+{
+    if (MV_WaitForVoice(handle) == nullptr)
+        return nullptr;
+
+    lock = MV_LockCommands();
+
+    auto voice = MV_GetVoice(handle);
+
+    if (voice == nullptr)
+        lock.unlock();
+
+    return voice;
+}
+
 int MV_VoicePlaying(int handle)
 {
     Bassert(handle <= MV_MaxVoices);
     auto voice = MV_Handles[handle - MV_MINVOICEHANDLE];
-    return MV_Installed && voice != nullptr && !voice->Paused.load(std::memory_order_relaxed);
+    return MV_Installed && voice != nullptr && !voice->Paused.load(std::memory_order_relaxed) && !voice->Stopped.load(std::memory_order_relaxed);
 }
 
-int MV_KillAllVoices(void)
+// Stops every voice on the spot, with MV_Lock() and MV_CommandMutex held and the ring drained. Returns the number of
+// callbacks the caller should make once it has let go of MV_CommandMutex.
+static int MV_StopAllVoices(bool const keepMusic, intptr_t *callbackvals)
 {
-    if (!MV_Installed)
-        return MV_Error;
+    int numcallbacks = 0;
 
-    MV_Lock();
-
-    if (&VoiceList == VoiceList.next)
+    for (auto voice = VoiceList.next, next = voice; voice != &VoiceList; voice = next)
     {
-        MV_Unlock();
-        return MV_Ok;
+        next = voice->next;
+
+        if (keepMusic && voice->priority == MV_MUSIC_PRIORITY)
+            continue;
+
+        if (!voice->Stopped.exchange(true, std::memory_order_acq_rel))
+            callbackvals[numcallbacks++] = voice->callbackval;
+
+        MV_RetireVoice(voice);
     }
 
-    auto voice = VoiceList.prev;
+    MV_ReclaimVoices();
 
-    // Remove all the voices from the list
-    while (voice != &VoiceList)
-    {
-        if (voice->priority == MV_MUSIC_PRIORITY)
-        {
-            voice = voice->prev;
-            continue;
-        }
+    return numcallbacks;
+}
 
-        MV_Kill(voice->handle);
-        voice = VoiceList.prev;
+static void MV_MakeCallbacks(intptr_t const *callbackvals, int const numcallbacks)
+{
+    if (MV_CallBackFunc)
+    {
+        for (int i = 0; i < numcallbacks; i++)
+            MV_CallBackFunc(callbackvals[i]);
     }
+}
 
+int MV_KillAllVoices(void)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    intptr_t callbackvals[MV_MAXVOICES];
+    std::unique_lock<std::mutex> lock(MV_CommandMutex, std::defer_lock);
+
+    MV_FlushCommands(lock);
+    int const numcallbacks = MV_StopAllVoices(true, callbackvals);
+    lock.unlock();
+
+    MV_MakeCallbacks(callbackvals, numcallbacks);
     MV_Unlock();
 
     return MV_Ok;
@@ -415,17 +755,55 @@ int MV_KillAllVoices(void)
 
 int MV_Kill(int handle)
 {
-    auto voice = MV_BeginService(handle);
+    std::unique_lock<std::mutex> lock;
+    auto voice = MV_BeginCommand(handle, lock);
 
-    if (voice == nullptr)
+    // lost the race against the mixer, which has already made the callback
+    if (voice == nullptr || voice->Stopped.exchange(true, std::memory_order_acq_rel))
         return MV_Error;
 
-    MV_StopVoice(voice);
-    MV_EndService();
+    // the voice goes quiet at the start of the next buffer, but the handle and the callback are done with right away
+    intptr_t const callbackval = voice->callbackval;
+
+    MV_Handles[handle - MV_MINVOICEHANDLE] = nullptr;
+    MV_PostCommand(voice, MVCMD_STOP);
+    lock.unlock();
+
+    if (MV_CallBackFunc)
+        MV_CallBackFunc(callbackval);
 
     return MV_Ok;
 }
 
+int MV_GetFreeVoices(int *usedhandles)
+{
+    if (usedhandles)
+        *usedhandles = 0;
+
+    if (!MV_Installed)
+        return 0;
+
+    std::unique_lock<std::mutex> lock(MV_CommandMutex, std::defer_lock);
+
+    MV_FlushCommands(lock);
+
+    int numfree = 0, numhandles = 0;
+
+    for (auto voice = VoicePool.next; voice != &VoicePool; voice = voice->next)
+        numfree++;
+
+    for (int i = 0; i < MV_MaxVoices; i++)
+        numhandles += MV_Handles[i] != nullptr;
+
+    lock.unlock();
+    MV_Unlock();
+
+    if (usedhandles)
+        *usedhandles = numhandles;
+
+    return numfree;
+}
+
 int MV_VoicesPlaying(void)
 {
     if (!MV_Installed)
@@ -475,19 +853,36 @@ static inline void MV_FinishAllocation(VoiceNode* voice, uint32_t const allocsiz
 
 VoiceNode *MV_AllocVoice(int priority, uint32_t allocsize /* = 0 */)
 {
-    MV_Lock();
+    std::unique_lock<std::mutex> lock(MV_CommandMutex);
+    bool flushed = false;
+    intptr_t callbackval = 0;
+    bool stolen = false;
 
     // Check if we have any free voices
     if (LL::Empty(&VoicePool))
     {
-        auto voice = MV_GetLowestPriorityVoice();
+        // voices that stopped since the mixer last reclaimed any are only a flush away
+        MV_FlushCommands(lock);
+        flushed = true;
 
-        if (voice != &VoiceList && voice->priority <= priority && voice->handle >= MV_MINVOICEHANDLE && FX_SoundValidAndActive(voice->handle))
-            MV_Kill(voice->handle);
+        if (LL::Empty(&VoicePool))
+        {
+            auto voice = MV_GetLowestPriorityVoice();
+
+            if (voice != &VoiceList && voice->priority <= priority && voice->handle >= MV_MINVOICEHANDLE && FX_SoundValidAndActive(voice->handle)
+                && !voice->Stopped.exchange(true, std::memory_order_acq_rel))
+            {
+                callbackval = voice->callbackval;
+                stolen = true;
+                MV_RetireVoice(voice);
+                MV_ReclaimVoices();
+            }
+        }
 
         if (LL::Empty(&VoicePool))
         {
             // No free voices
+            lock.unlock();
             MV_Unlock();
             return nullptr;
         }
@@ -510,7 +905,16 @@ VoiceNode *MV_AllocVoice(int priority, uint32_t allocsize /* = 0 */)
     voice->BlockLength = 0;
     voice->handle = handle;
     voice->next = voice->prev = nullptr;
-    MV_Unlock();
+    voice->Stopped.store(false, std::memory_order_relaxed);
+    lock.unlock();
+
+    if (flushed)
+    {
+        if (stolen && MV_CallBackFunc)
+            MV_CallBackFunc(callbackval);
+
+        MV_Unlock();
+    }
 
     if (allocsize)
         MV_FinishAllocation(voice, allocsize);
@@ -520,15 +924,20 @@ VoiceNode *MV_AllocVoice(int priority, uint32_t allocsize /* = 0 */)
 
 int MV_VoiceAvailable(int priority)
 {
-    // Check if we have any free voices
-    if (!LL::Empty(&VoicePool))
-        return TRUE;
+    {
+        std::lock_guard<std::mutex> lock(MV_CommandMutex);
+
+        // Check if we have any free voices
+        if (!LL::Empty(&VoicePool))
+            return TRUE;
+    }
 
     MV_Lock();
     auto const voice = MV_GetLowestPriorityVoice();
+    int const  stopped = MV_NumStoppedVoices;
     MV_Unlock();
 
-    return (voice == &VoiceList || voice->priority > priority) ? FALSE : TRUE;
+    return (stopped == 0 && (voice == &VoiceList || voice->priority > priority)) ? FALSE : TRUE;
 }
 
 void MV_SetVoicePitch(VoiceNode *voice, uint32_t rate, int pitchoffset)
@@ -544,35 +953,38 @@ void MV_SetVoicePitch(VoiceNode *voice, uint32_t rate, int pitchoffset)
 
 int MV_SetPitch(int handle, int pitchoffset)
 {
-    auto voice = MV_BeginService(handle);
+    std::unique_lock<std::mutex> lock;
+    auto voice = MV_BeginCommand(handle, lock);
 
     if (voice == nullptr)
         return MV_Error;
 
-    MV_SetVoicePitch(voice, voice->SamplingRate, pitchoffset);
-    MV_EndService();
+    MV_PostCommand(voice, MVCMD_SETPITCH, 0, pitchoffset);
 
     return MV_Ok;
 }
 
 int MV_SetFrequency(int handle, int frequency)
 {
-    auto voice = MV_BeginService(handle);
+    std::unique_lock<std::mutex> lock;
+    auto voice = MV_BeginCommand(handle, lock);
 
     if (voice == nullptr)
         return MV_Error;
 
-    MV_SetVoicePitch(voice, frequency, 0);
-    MV_EndService();
+    MV_PostCommand(voice, MVCMD_SETPITCH, frequency, 0);
 
     return MV_Ok;
 }
 
 int MV_GetFrequency(int handle, int *frequency)
 {
+    if (!frequency)
+        return MV_Error;
+
     auto voice = MV_BeginService(handle);
 
-    if (voice == NULL || !frequency)
+    if (voice == NULL)
         return MV_Error;
 
     if (voice->SamplingRate == 0)
@@ -587,32 +999,28 @@ int MV_GetFrequency(int handle, int *frequency)
 /*---------------------------------------------------------------------
    Function: MV_SetVoiceMixMode
 
-   Selects which method should be used to mix the voice.
+   Selects which method should be used to mix the voice, from the
+   kernels picked by MV_MixSimdInit().
 
    16Bit        16Bit |  8Bit  16Bit  8Bit  16Bit |
    Mono         Ster  |  Mono  Mono   Ster  Ster  |  Mixer
    Out          Out   |  In    In     In    In    |
 ----------------------+---------------------------+-------------
-    X                 |         X                 | MixMono<int16_t, int16_t>
-    X                 |   X                       | MixMono<uint8_t, int16_t>
-                 X    |         X                 | MixStereo<int16_t, int16_t>
-                 X    |   X                       | MixStereo<uint8_t, int16_t>
+    X                 |         X                 | MixMono<int16_t>
+    X                 |   X                       | MixMono<uint8_t>
+                 X    |         X                 | MixStereo<int16_t>
+                 X    |   X                       | MixStereo<uint8_t>
 ----------------------+---------------------------+-------------
-                 X    |                      X    | MixStereoStereo<int16_t, int16_t>
-                 X    |                X          | MixStereoStereo<uint8_t, int16_t>
-    X                 |                      X    | MixMonoStereo<int16_t, int16_t>
-    X                 |                X          | MixMonoStereo<uint8_t, int16_t>
+                 X    |                      X    | MixStereoStereo<int16_t>
+                 X    |                X          | MixStereoStereo<uint8_t>
+    X                 |                      X    | MixMonoStereo<int16_t>
+    X                 |                X          | MixMonoStereo<uint8_t>
 ---------------------------------------------------------------------*/
 
 void MV_SetVoiceMixMode(VoiceNode *voice)
-{    
-    // stereo look-up table
-    static constexpr decltype(voice->mix) mixslut[]
-    = { MV_MixStereo<uint8_t, int16_t>,       MV_MixMono<uint8_t, int16_t>,       MV_MixStereo<int16_t, int16_t>,       MV_MixMono<int16_t, int16_t>,
-        MV_MixStereoStereo<uint8_t, int16_t>, MV_MixMonoStereo<uint8_t, int16_t>, MV_MixStereoStereo<int16_t, int16_t>, MV_MixMonoStereo<int16_t, int16_t> };
-
+{
     // corresponds to T_MONO, T_16BITSOURCE, and T_STEREOSOURCE
-    voice->mix = mixslut[(MV_Channels == 1) | ((voice->bits == 16) << 1) | ((voice->channels == 2) << 2)];
+    voice->mix = MV_MixSimd.mix[(MV_Channels == 1) | ((voice->bits == 16) << 1) | ((voice->channels == 2) << 2)];
 }
 
 void MV_SetVoiceVolume(VoiceNode *voice, int vol, int left, int right, fix16_t volume)
@@ -632,13 +1040,14 @@ void MV_SetVoiceVolume(VoiceNode *voice, int vol, int left, int right, fix16_t v
 
 int MV_PauseVoice(int handle, int pause)
 {
-    auto voice = MV_BeginService(handle);
+    std::unique_lock<std::mutex> lock;
+    auto voice = MV_BeginCommand(handle, lock);
 
     if (voice == nullptr)
         return MV_Error;
 
+    // the mixer only reads this, so it needs no command
     voice->Paused.store(pause, std::memory_order_release);
-    MV_EndService();
 
     return MV_Ok;
 }
@@ -662,6 +1071,7 @@ int MV_GetPosition(int handle, int *position)
 #ifdef HAVE_XMP
         case FMT_XMP:    *position = MV_GetXMPPosition(voice); break;
 #endif
+        case FMT_PCM:    *position = MV_GetPCMPosition(voice); break;
         default:         *position = (int)max<intptr_t>(0, (((intptr_t)voice->NextBlock + (intptr_t)voice->position - (intptr_t)voice->rawdataptr) >> 16) * ((voice->channels * voice->bits) >> 3)); break;
     }
 
@@ -689,6 +1099,7 @@ int MV_SetPosition(int handle, int position)
 #ifdef HAVE_XMP
         case FMT_XMP:    MV_SetXMPPosition(voice, position); break;
 #endif
+        case FMT_PCM:    MV_SetPCMPosition(voice, position); break;
         default: break;
     }
 
@@ -699,27 +1110,26 @@ int MV_SetPosition(int handle, int position)
 
 int MV_EndLooping(int handle)
 {
-    auto voice = MV_BeginService(handle);
+    std::unique_lock<std::mutex> lock;
+    auto voice = MV_BeginCommand(handle, lock);
 
     if (voice == nullptr)
         return MV_Error;
 
-    voice->Loop = {};
-
-    MV_EndService();
+    MV_PostCommand(voice, MVCMD_ENDLOOP);
 
     return MV_Ok;
 }
 
 int MV_SetPan(int handle, int vol, int left, int right)
 {
-    auto voice = MV_BeginService(handle);
+    std::unique_lock<std::mutex> lock;
+    auto voice = MV_BeginCommand(handle, lock);
 
     if (voice == nullptr)
         return MV_Error;
 
-    MV_SetVoiceVolume(voice, vol, left, right, voice->volume);
-    MV_EndService();
+    MV_PostCommand(voice, MVCMD_SETPAN, vol, left, right);
     return MV_Ok;
 }
 
@@ -767,8 +1177,6 @@ static int MV_SetMixMode(int numchannels)
     Bassert(isPow2(MV_NumberOfBuffers));
     MV_BufferLength = MV_TOTALBUFFERSIZE;
 
-    MV_RightChannelOffset = MV_SampleSize >> 1;
-
     return MV_Ok;
 }
 
@@ -792,15 +1200,15 @@ static void MV_StopPlayback(void)
 {
     SoundDriver_PCM_StopPlayback();
 
-    // Make sure all callbacks are done.
-    MV_Lock();
+    intptr_t callbackvals[MV_MAXVOICES];
+    std::unique_lock<std::mutex> lock(MV_CommandMutex, std::defer_lock);
 
-    for (VoiceNode *voice = VoiceList.next, *next; voice != &VoiceList; voice = next)
-    {
-        next = voice->next;
-        MV_StopVoice(voice);
-    }
+    // Make sure all callbacks are done.
+    MV_FlushCommands(lock);
+    int const numcallbacks = MV_StopAllVoices(false, callbackvals);
+    lock.unlock();
 
+    MV_MakeCallbacks(callbackvals, numcallbacks);
     MV_Unlock();
 }
 
@@ -862,6 +1270,7 @@ int MV_Init(int soundcard, int MixRate, int Voices, int numchannels, void *initd
 
     LL::Reset((VoiceNode*) &VoiceList);
     LL::Reset((VoiceNode*) &VoicePool);
+    MV_NumStoppedVoices = 0;
 
     for (int index = 0; index < Voices; index++)
         LL::Insert(&VoicePool, &MV_Voices[index]);
@@ -911,8 +1320,17 @@ int MV_Init(int soundcard, int MixRate, int Voices, int numchannels, void *initd
     // Calculate pan table
     MV_CalcPanTable();
 
+    MV_MixSimdInit(MV_MIXSIMD_VEC8);
+
     MV_VolumeSmoothFactor = fix16_from_float(1.f-powf(0.1f, 30.f/MixRate));
 
+    MV_MixStats = {};
+    MV_MixStats.deadline = MV_MIXBUFFERSIZE * 1000000000ull / MixRate;
+
+    for (auto &ticks : MV_DecodeTicks)
+        ticks.store(0, std::memory_order_relaxed);
+    MV_SetMixThreads();
+
     // Start the playback engine
     if (MV_StartPlayback() != MV_Ok)
     {
@@ -940,6 +1358,8 @@ int MV_Shutdown(void)
     // Shutdown the sound card
     SoundDriver_PCM_Shutdown();
 
+    MV_SetMixThreads();
+
     // Free any voices we allocated
     ALIGNED_FREE_AND_NULL(MV_Voices);
 
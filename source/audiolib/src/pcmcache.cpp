@@ -0,0 +1,254 @@
+//-------------------------------------------------------------------------
+/*
+Copyright (C) 2020 EDuke32 developers and contributors
+
+This file is part of EDuke32.
+
+EDuke32 is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+//-------------------------------------------------------------------------
+
+/**
+ * Decoded PCM cache for compressed sound effects
+ */
+
+#include "_multivc.h"
+#include "compat.h"
+#include "lru.h"
+#include "multivoc.h"
+#include "xxhash.h"
+
+#include <mutex>
+
+int MV_PCMCacheSize = 32;
+
+// a single sound may take up to this fraction of the budget, anything longer keeps being streamed
+#define PCMCACHE_MAXSOUNDSHIFT 3
+#define PCMCACHE_MAXSOUNDS     1024
+
+typedef LruCache<uint64_t, pcmbuffer_t *, PCMCACHE_MAXSOUNDS, 1031> pcmcache_t;
+
+// sounds are keyed by a hash of their file contents, since the game is free to move or reload them
+static pcmcache_t MV_PCMCache;
+static std::mutex MV_PCMCacheMutex;
+static pcmcachestats_t MV_PCMCacheStats;
+
+static FORCE_INLINE uint64_t MV_PCMBufferSize(pcmbuffer_t const *pcm) { return (uint64_t)pcm->frames * pcm->channels * sizeof(int16_t); }
+static FORCE_INLINE uint64_t MV_PCMCacheBudget(void) { return (uint64_t)max(MV_PCMCacheSize, 0) << 20; }
+static FORCE_INLINE uint32_t MV_PCMMaxSoundBytes(void) { return (uint32_t)min<uint64_t>(MV_PCMCacheBudget() >> PCMCACHE_MAXSOUNDSHIFT, UINT32_MAX); }
+
+void MV_ReleaseCachedPCM(pcmbuffer_t *pcm)
+{
+    if (pcm->refcount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    Xfree(pcm->data);
+    Xfree(pcm);
+}
+
+int16_t *MV_ReservePCM(pcmbuffer_t *pcm, uint32_t frames, uint32_t maxbytes)
+{
+    uint32_t const framesize = pcm->channels * sizeof(int16_t);
+    uint32_t const maxframes = maxbytes / framesize;
+
+    if (frames > maxframes - pcm->frames)
+        return nullptr;
+
+    if (pcm->frames + frames > pcm->capacity)
+    {
+        pcm->capacity = min(max(pcm->frames + frames, pcm->capacity * 2), maxframes);
+        pcm->data     = (int16_t *)Xrealloc(pcm->data, pcm->capacity * framesize);
+    }
+
+    auto samples = pcm->data + pcm->frames * pcm->channels;
+    pcm->frames += frames;
+
+    return samples;
+}
+
+static void MV_EvictPCM(void)
+{
+    pcmcache_t::Pair evicted;
+
+    if (!MV_PCMCache.popLru(&evicted))
+        return;
+
+    MV_PCMCacheStats.bytes -= MV_PCMBufferSize(evicted.second);
+    MV_PCMCacheStats.evictions++;
+    MV_ReleaseCachedPCM(evicted.second);
+}
+
+static pcmbuffer_t *MV_DecodePCM(char *ptr, uint32_t length, wavefmt_t fmt)
+{
+    auto pcm = (pcmbuffer_t *)Xcalloc(1, sizeof(pcmbuffer_t));
+
+    pcm->loopstart = -1;
+    pcm->loopend   = -1;
+    pcm->refcount  = 1;
+
+    uint32_t const maxbytes = MV_PCMMaxSoundBytes();
+    int status = MV_Error;
+
+    switch (fmt)
+    {
+#ifdef HAVE_VORBIS
+        case FMT_VORBIS: status = MV_DecodeVorbis(ptr, length, maxbytes, pcm); break;
+#endif
+#ifdef HAVE_FLAC
+        case FMT_FLAC:   status = MV_DecodeFLAC(ptr, length, maxbytes, pcm); break;
+#endif
+        case FMT_XA:     status = MV_DecodeXA(ptr, length, maxbytes, pcm); break;
+        default: break;
+    }
+
+    // a failed decode is cached as an empty buffer, so the sound is streamed without trying again.
+    // The decoders check the length before decoding, so a sound that is too long costs little even
+    // when its empty buffer was evicted.
+    if (status != MV_Ok || pcm->frames == 0)
+    {
+        DO_FREE_AND_NULL(pcm->data);
+        pcm->frames = pcm->capacity = 0;
+    }
+    else if (pcm->frames < pcm->capacity)
+    {
+        pcm->data     = (int16_t *)Xrealloc(pcm->data, MV_PCMBufferSize(pcm));
+        pcm->capacity = pcm->frames;
+    }
+
+    return pcm;
+}
+
+pcmbuffer_t *MV_GetCachedPCM(char *ptr, uint32_t length, wavefmt_t fmt)
+{
+    if (MV_PCMCacheSize <= 0 || (fmt != FMT_VORBIS && fmt != FMT_FLAC && fmt != FMT_XA))
+        return nullptr;
+
+    // these formats decode to more bytes than they take up, so a source this large is streamed
+    // without hashing or parsing it
+    if (length > MV_PCMMaxSoundBytes())
+    {
+        std::lock_guard<std::mutex> lock(MV_PCMCacheMutex);
+        MV_PCMCacheStats.uncached++;
+        return nullptr;
+    }
+
+    uint64_t const key = XXH3_64bits(ptr, length);
+
+    {
+        std::lock_guard<std::mutex> lock(MV_PCMCacheMutex);
+
+        if (auto cached = MV_PCMCache.access(key))
+        {
+            auto pcm = *cached;
+
+            if (pcm->pending)
+            {
+                MV_PCMCacheStats.misses++;
+                return nullptr;
+            }
+
+            if (pcm->data == nullptr)
+            {
+                MV_PCMCacheStats.uncached++;
+                return nullptr;
+            }
+
+            MV_PCMCacheStats.hits++;
+            pcm->refcount.fetch_add(1, std::memory_order_relaxed);
+            return pcm;
+        }
+
+        MV_PCMCacheStats.misses++;
+
+        // keeps further plays from starting the same decode
+        auto placeholder = (pcmbuffer_t *)Xcalloc(1, sizeof(pcmbuffer_t));
+
+        placeholder->refcount = 1;
+        placeholder->pending  = true;
+
+        if (MV_PCMCache.size() == PCMCACHE_MAXSOUNDS)
+            MV_EvictPCM();
+
+        MV_PCMCache.insert(key, placeholder);
+    }
+
+    // Decoding a whole sound takes far too long for the game thread, so this play is streamed and the sound is
+    // decoded in the background. The game is free to unload its copy of the file in the meantime.
+    auto data = (char *)Xmalloc(length);
+    memcpy(data, ptr, length);
+
+    async::spawn([key, data, length, fmt]()
+    {
+        auto pcm = MV_DecodePCM(data, length, fmt);
+        Xfree(data);
+
+        std::lock_guard<std::mutex> lock(MV_PCMCacheMutex);
+
+        // the cache was switched off or trimmed while the sound was decoded
+        if (MV_PCMCacheSize <= 0)
+        {
+            MV_ReleaseCachedPCM(pcm);
+            return;
+        }
+
+        if (auto cached = MV_PCMCache.peek(key))
+        {
+            // someone else decoded the same sound after our placeholder was evicted
+            if (!(*cached)->pending)
+            {
+                MV_ReleaseCachedPCM(pcm);
+                return;
+            }
+
+            MV_ReleaseCachedPCM(*cached);
+            *cached = pcm;
+        }
+        else
+        {
+            if (MV_PCMCache.size() == PCMCACHE_MAXSOUNDS)
+                MV_EvictPCM();
+
+            MV_PCMCache.insert(key, pcm);
+        }
+
+        MV_PCMCacheStats.bytes += MV_PCMBufferSize(pcm);
+
+        while (MV_PCMCacheStats.bytes > MV_PCMCacheBudget() && MV_PCMCache.size() > 1)
+            MV_EvictPCM();
+    });
+
+    return nullptr;
+}
+
+void MV_TrimPCMCache(void)
+{
+    std::lock_guard<std::mutex> lock(MV_PCMCacheMutex);
+
+    uint64_t const budget = MV_PCMCacheBudget();
+
+    for (int i = MV_PCMCache.size(); i > 0 && (MV_PCMCacheStats.bytes > budget || budget == 0); --i)
+        MV_EvictPCM();
+
+    if (budget == 0)
+        MV_PCMCacheStats = {};
+}
+
+void MV_GetPCMCacheStats(pcmcachestats_t *stats)
+{
+    std::lock_guard<std::mutex> lock(MV_PCMCacheMutex);
+
+    *stats = MV_PCMCacheStats;
+    stats->entries = MV_PCMCache.size();
+}
@@ -52,8 +52,8 @@ typedef struct {
    int lastbitstream;
 } vorbis_data;
 
-// designed with multiple calls in mind
-static void MV_GetVorbisCommentLoops(VoiceNode *voice, vorbis_comment *vc)
+// reads the loop points from the tags, leaving -1 for the start and 0 for the end and length when they are missing
+static void MV_GetVorbisCommentLoops(vorbis_comment *vc, ogg_int64_t total, ogg_int64_t *loopstart, ogg_int64_t *loopend, ogg_int64_t *looplength)
 {
     const char *vc_loopstart = nullptr;
     const char *vc_loopend = nullptr;
@@ -94,40 +94,51 @@ static void MV_GetVorbisCommentLoops(VoiceNode *voice, vorbis_comment *vc)
             }
         }
     }
-    
-    auto vd    = (vorbis_data *)voice->rawdataptr;
-    auto total = ov_pcm_total(&vd->vf, -1);
-    
+
+    *loopstart  = -1;
+    *loopend    = 0;
+    *looplength = 0;
+
     if (vc_loopstart != nullptr)
     {
         const ogg_int64_t ov_loopstart = Batol(vc_loopstart);
         if ((unsigned)(ov_loopstart-1) <= total)
-        {
-            voice->Loop.Start = (const char *) (intptr_t) ov_loopstart;
-            voice->Loop.Size  = 1;
-        }
+            *loopstart = ov_loopstart;
         else LOG_F(WARNING, "MV_GetVorbisCommentLoops: loop start is beyond end of data");
     }
     if (vc_loopend != nullptr)
     {
-        if (voice->Loop.Size > 0)
-        {
-            const ogg_int64_t ov_loopend = Batol(vc_loopend);
-            if ((unsigned)(ov_loopend-1) <= total)
-                voice->Loop.End = (const char *) (intptr_t) ov_loopend;
-            else LOG_F(WARNING, "MV_GetVorbisCommentLoops: loop end is beyond end of data");
-        }
+        const ogg_int64_t ov_loopend = Batol(vc_loopend);
+        if ((unsigned)(ov_loopend-1) <= total)
+            *loopend = ov_loopend;
+        else LOG_F(WARNING, "MV_GetVorbisCommentLoops: loop end is beyond end of data");
     }
     if (vc_looplength != nullptr)
     {
-        if (voice->Loop.Size > 0 && voice->Loop.End == 0)
-        {
-            const ogg_int64_t ov_looplength = Batol(vc_looplength);
-            if (ov_looplength > 0) // a loop of length 0 is invalid
-                voice->Loop.End = (const char *) ((intptr_t) ov_looplength + (intptr_t) voice->Loop.Start);
-            else LOG_F(WARNING, "MV_GetVorbisCommentLoops: loop length is zero");
-        }
+        const ogg_int64_t ov_looplength = Batol(vc_looplength);
+        if (ov_looplength > 0) // a loop of length 0 is invalid
+            *looplength = ov_looplength;
+        else LOG_F(WARNING, "MV_GetVorbisCommentLoops: loop length is zero");
+    }
+}
+
+// designed with multiple calls in mind
+static void MV_SetVorbisVoiceLoops(VoiceNode *voice, vorbis_comment *vc)
+{
+    auto vd = (vorbis_data *)voice->rawdataptr;
+    ogg_int64_t loopstart, loopend, looplength;
+
+    MV_GetVorbisCommentLoops(vc, ov_pcm_total(&vd->vf, -1), &loopstart, &loopend, &looplength);
+
+    if (loopstart >= 0)
+    {
+        voice->Loop.Start = (const char *) (intptr_t) loopstart;
+        voice->Loop.Size  = 1;
     }
+    if (loopend > 0 && voice->Loop.Size > 0)
+        voice->Loop.End = (const char *) (intptr_t) loopend;
+    if (looplength > 0 && voice->Loop.Size > 0 && voice->Loop.End == 0)
+        voice->Loop.End = (const char *) ((intptr_t) looplength + (intptr_t) voice->Loop.Start);
 }
 
 // callbacks
@@ -413,7 +424,7 @@ int MV_PlayVorbis(char *ptr, uint32_t length, int loopstart, int loopend, int pi
 
         // load loop tags from metadata
         if (auto comment = ov_comment(&vd->vf, 0))
-            MV_GetVorbisCommentLoops(voice, comment);
+            MV_SetVorbisVoiceLoops(voice, comment);
 
         MV_SetVoicePitch(voice, vi->rate, vd->lastbitstream);
         vd->lastbitstream = -1;
@@ -424,6 +435,96 @@ int MV_PlayVorbis(char *ptr, uint32_t length, int loopstart, int loopend, int pi
     return voice->handle;
 }
 
+int MV_DecodeVorbis(char *ptr, uint32_t length, uint32_t maxbytes, pcmbuffer_t *pcm)
+{
+    vorbis_data vd;
+
+    vd.ptr    = ptr;
+    vd.pos    = 0;
+    vd.length = length;
+
+    int status = ov_open_callbacks((void *)&vd, &vd.vf, 0, 0, vorbis_callbacks);
+    vorbis_info *vi = nullptr;
+
+    if (status < 0 || ((vi = ov_info(&vd.vf, 0)) == nullptr) || vi->channels < 1 || vi->channels > 2)
+    {
+        if (status == 0)
+            ov_clear(&vd.vf);
+
+        return MV_SetErrorCode(MV_InvalidFile);
+    }
+
+    pcm->channels = vi->channels;
+    pcm->rate     = vi->rate;
+
+    int const framesize = pcm->channels * sizeof(int16_t);
+
+    // don't decode what could never fit
+    if (ov_pcm_total(&vd.vf, -1) > (ogg_int64_t)(maxbytes / framesize))
+    {
+        ov_clear(&vd.vf);
+        return MV_Error;
+    }
+
+    if (auto comment = ov_comment(&vd.vf, 0))
+    {
+        ogg_int64_t loopstart, loopend, looplength;
+
+        MV_GetVorbisCommentLoops(comment, ov_pcm_total(&vd.vf, -1), &loopstart, &loopend, &looplength);
+
+        if (loopend <= 0 && looplength > 0)
+            loopend = max<ogg_int64_t>(loopstart, 0) + looplength;
+
+        pcm->loopstart = (int32_t)loopstart;
+        pcm->loopend   = loopend > 0 ? (int32_t)loopend : -1;
+    }
+
+    int bitstream;
+
+    for (;;)
+    {
+#ifdef USING_TREMOR
+        int bytes = ov_read(&vd.vf, vd.block, BLOCKSIZE, &bitstream);
+#else
+        int bytes = ov_read(&vd.vf, vd.block, BLOCKSIZE, 0, 2, 1, &bitstream);
+#endif
+        if (bytes == OV_HOLE)
+            continue;
+        else if (bytes <= 0)
+        {
+            status = bytes == 0 ? MV_Ok : MV_SetErrorCode(MV_InvalidFile);
+            break;
+        }
+
+        // chained streams that change format can only be streamed
+        vi = ov_info(&vd.vf, -1);
+        if (!vi || vi->channels != pcm->channels || (uint32_t)vi->rate != pcm->rate)
+        {
+            status = MV_SetErrorCode(MV_InvalidFile);
+            break;
+        }
+
+        auto samples = MV_ReservePCM(pcm, bytes / framesize, maxbytes);
+
+        if (samples == nullptr)
+        {
+            status = MV_Error;
+            break;
+        }
+
+        memcpy(samples, vd.block, bytes / framesize * framesize);
+
+#ifdef GEKKO
+        for (int i = 0, i_end = bytes / framesize * pcm->channels; i < i_end; ++i)
+            samples[i] = (samples[i] & 0xff) << 8 | ((samples[i] & 0xff00) >> 8);
+#endif
+    }
+
+    ov_clear(&vd.vf);
+
+    return status;
+}
+
 void MV_ReleaseVorbisVoice(VoiceNode *voice)
 {
     Bassert(voice->wavetype == FMT_VORBIS && voice->rawdataptr != nullptr && voice->rawdatasiz == sizeof(vorbis_data));
@@ -451,6 +451,77 @@ int MV_PlayXA(char *ptr, uint32_t length, int loopstart, int loopend, int pitcho
 }
 
 
+int MV_DecodeXA(char *ptr, uint32_t length, uint32_t maxbytes, pcmbuffer_t *pcm)
+{
+    // every sector decodes to at most kBufSize bytes, don't decode what could never fit
+    uint64_t const numsectors = length > XA_DATA_START ? (length - XA_DATA_START + sizeof(XASector) - 1) / sizeof(XASector) : 0;
+
+    if (numsectors * kBufSize > maxbytes)
+        return MV_Error;
+
+    auto xad = (xa_data *)Xcalloc(1, sizeof(xa_data));
+
+    xad->ptr    = ptr;
+    xad->pos    = XA_DATA_START;
+    xad->length = length;
+
+    int status = MV_Ok;
+
+    while (xad->pos < xad->length)
+    {
+        XASector ssct = {};
+        size_t const bytes = min(sizeof(XASector), xad->length - xad->pos);
+
+        memcpy(&ssct, (int8_t *)xad->ptr + xad->pos, bytes);
+        xad->pos += bytes;
+
+        if (ssct.sectorFiller[46] != (SUBMODE_REAL_TIME_SECTOR | SUBMODE_FORM | SUBMODE_AUDIO_DATA))
+            continue;
+
+        int const coding   = ssct.sectorFiller[47];
+        int const channels = (coding & 3) + 1;
+        uint32_t const rate = (((coding >> 2) & 3) == 1) ? 18900 : 37800;
+
+        if (pcm->channels == 0)
+        {
+            pcm->channels = channels;
+            pcm->rate     = rate;
+        }
+        else if (channels != pcm->channels || rate != pcm->rate)
+        {
+            status = MV_SetErrorCode(MV_InvalidFile);
+            break;
+        }
+
+        uint32_t samples;
+
+        if (channels == 2)
+        {
+            decodeSoundSectStereo(&ssct, xad);
+            samples = kSamplesStereo;
+        }
+        else
+        {
+            decodeSoundSectMono(&ssct, xad);
+            samples = kSamplesMono;
+        }
+
+        auto obuffer = MV_ReservePCM(pcm, samples, maxbytes);
+
+        if (obuffer == nullptr)
+        {
+            status = MV_Error;
+            break;
+        }
+
+        memcpy(obuffer, xad->block, kBufSize);
+    }
+
+    Xfree(xad);
+
+    return status;
+}
+
 void MV_ReleaseXAVoice(VoiceNode * voice)
 {
     Bassert(voice->wavetype == FMT_XA && voice->rawdataptr != nullptr && voice->rawdatasiz == sizeof(xa_data));
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "mmulti.h"
 #include "compat.h"
 #include "renderlayer.h"
+#include "tilepreload.h"
 #include "vfs.h"
 #include "fx_man.h"
 #include "common.h"
@@ -49,6 +50,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gui.h"
 #include "levels.h"
 #include "loadsave.h"
+#include "loopback.h"
 #include "menu.h"
 #include "mirrors.h"
 #include "music.h"
@@ -450,6 +452,15 @@ void PrecacheExtraTextureMaps(int nTile)
 }
 #endif
 
+static void PreloadTile(int32_t nTile, int32_t)
+{
+#ifdef USE_OPENGL
+    PrecacheExtraTextureMaps(nTile);
+#else
+    UNREFERENCED_PARAMETER(nTile);
+#endif
+}
+
 void PreloadCache(void)
 {
     char tempbuf[128];
@@ -463,48 +474,56 @@ void PreloadCache(void)
         sndTryPlaySpecialMusic(MUS_LOADING);
     PreloadTiles();
     ClockTicks clock = totalclock;
-    int cnt = 0;
     int percentDisplayed = -1;
 
-    for (int i=0; i<kMaxTiles && !KB_KeyPressed(sc_Space); i++)
+    tilePreloadBegin();
+
+    int nTiles = 0;
+
+    for (int i=0; i<kMaxTiles; i++)
     {
         if (TestBitString(gotpic, i))
         {
-            if (waloff[i] == 0)
-                tileLoad((int16_t)i);
+            tilePreloadQueue(i, (TestBitString(precachehightile[0], i) ? TILEPRELOAD_WALL : 0)
+                              | (TestBitString(precachehightile[1], i) ? TILEPRELOAD_SPRITE : 0));
+            nTiles++;
+        }
+    }
 
-#ifdef USE_OPENGL
-            PrecacheExtraTextureMaps(i);
-#endif
+    int nTilesLeft = nTiles;
 
-            MUSIC_Update();
+    while (nTilesLeft > 0 && !KB_KeyPressed(sc_Space))
+    {
+        nTilesLeft = tilePreloadRun(PreloadTile, TILEPRELOAD_FRAMETIME);
 
-            if ((++cnt & 7) == 0)
-                gameHandleEvents();
+        MUSIC_Update();
+        gameHandleEvents();
+
+        if (videoGetRenderMode() != REND_CLASSIC && totalclock - clock > (kTicRate>>2))
+        {
+            int const cnt = nTiles - nTilesLeft;
+            int const percentComplete = min(100, tabledivide32_noinline(100 * cnt, nTiles));
 
-            if (videoGetRenderMode() != REND_CLASSIC && totalclock - clock > (kTicRate>>2))
+            // this just prevents the loading screen percentage bar from making large jumps
+            while (percentDisplayed < percentComplete)
             {
-                int const percentComplete = min(100, tabledivide32_noinline(100 * cnt, nPrecacheCount));
+                gameHandleEvents();
+                Bsprintf(tempbuf, "Loaded %d%% (%d/%d textures)\n", percentDisplayed, cnt, nTiles);
+                viewLoadingScreenUpdate(tempbuf, percentDisplayed);
+                videoNextPage();
 
-                // this just prevents the loading screen percentage bar from making large jumps
-                while (percentDisplayed < percentComplete)
+                if (totalclock - clock >= 1)
                 {
-                    gameHandleEvents();
-                    Bsprintf(tempbuf, "Loaded %d%% (%d/%d textures)\n", percentDisplayed, cnt, nPrecacheCount);
-                    viewLoadingScreenUpdate(tempbuf, percentDisplayed);
-                    videoNextPage();
-
-                    if (totalclock - clock >= 1)
-                    {
-                        clock = totalclock;
-                        percentDisplayed++;
-                    }
+                    clock = totalclock;
+                    percentDisplayed++;
                 }
-
-                clock = totalclock;
             }
+
+            clock = totalclock;
         }
     }
+
+    tilePreloadEnd();
     memset(gotpic,0,sizeof(gotpic));
 }
 
@@ -1098,7 +1117,7 @@ void ProcessFrame(void)
     if ((gGameOptions.uGameFlags&1) != 0 && !gStartNewGame)
     {
         ready2send = 0;
-        if (gNetPlayers > 1 && gNetMode == NETWORK_SERVER && gPacketMode == PACKETMODE_1 && myconnectindex == connecthead)
+        if (gNetPlayers > 1 && (gNetMode == NETWORK_SERVER || gNetMode == NETWORK_LOOPBACK) && gPacketMode == PACKETMODE_1 && myconnectindex == connecthead)
         {
             while (gNetFifoMasterTail < gNetFifoTail)
             {
@@ -1182,6 +1201,7 @@ SWITCH switches[] = {
     { "c", 43, 1 },
     { "conf", 43, 1 },
     { "noconsole", 43, 0 },
+    { "loopback", 44, 1 },
     { NULL, 0, 0 }
 };
 
@@ -1201,6 +1221,7 @@ void PrintHelp(void)
         "-h [file.def]\tLoad an alternate definitions file\n"
         "-ini [file.ini]\tSpecify an INI file name (default is blood.ini)\n"
         "-j [dir]\t\tAdd a directory to " APPNAME "'s search list\n"
+        "-loopback [players]\tRun a multiplayer game against simulated clients in this process\n"
         "-map [file.map]\tLoad an external map file\n"
         "-mh [file.def]\tInclude an additional definitions module\n"
         "-noautoload\tDisable loading from autoload directory\n"
@@ -1496,6 +1517,13 @@ void ParseOptions(void)
             break;
         case 43: // conf, noconsole
             break;
+        case 44:
+            if (OptArgc < 1)
+                ThrowError("Missing argument");
+            gNetPlayers = ClipRange(atoi(OptArgv[0]), 2, kMaxPlayers);
+            gNetMode = NETWORK_LOOPBACK;
+            gPacketMode = PACKETMODE_1;
+            break;
         }
     }
 #if 0
@@ -1807,7 +1835,9 @@ RESTART:
         gDemo.Playback();
     if (gDemo.nDemosFound > 0)
         gGameMenuMgr.Deactivate();
-    if (!bAddUserMap && !gGameStarted)
+    if (gNetMode == NETWORK_LOOPBACK && !gGameStarted)
+        lbStartGame(bAddUserMap ? gUserMapFilename : NULL);
+    else if (!bAddUserMap && !gGameStarted)
     {
         gGameMenuMgr.Push(&menuMain, -1);
         if (gGameOptions.nGameType > 0)
@@ -1850,7 +1880,10 @@ RESTART:
                             if (i >= 0)
                                 break;
                             faketimerhandler();
+                            uint64_t const nFrameStart = timerGetNanoTicks();
                             ProcessFrame();
+                            if (gNetMode == NETWORK_LOOPBACK)
+                                lbFrameDone(timerGetNanoTicks() - nFrameStart);
                         }
                     } while (totalclock >= gNetFifoClock && ready2send);
                     gameUpdate = true;
@@ -1869,7 +1902,7 @@ RESTART:
             else
             {
                 netCheckSync();
-                if (bDraw)
+                if (bDraw && !(gNetMode == NETWORK_LOOPBACK && gLoopbackHeadless))
                 {
                     viewDrawScreen();
                     g_gameUpdateAndDrawTime = timerGetFractionalTicks() - gameUpdateStartTime;
@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "control.h"
 #include "osd.h"
 #include "mmulti.h"
+#include "timer.h"
 
 #include "blood.h"
 #include "controls.h"
@@ -36,6 +37,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gamemenu.h"
 #include "globals.h"
 #include "levels.h"
+#include "loadsave.h"
 #include "menu.h"
 #include "messages.h"
 #include "misc.h"
@@ -43,10 +45,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "network.h"
 #include "player.h"
 #include "screen.h"
+#include "sfx.h"
 #include "view.h"
 
 int nBuild = 0;
 
+int gDemoKeyframeInterval = 10;
+int gDemoKeyframeMemory = 64;
+int gDemoHeadless = 0;
+
+static uint32_t nSeekTestSeed = 1;
+
 void ReadGameOptionsLegacy(GAMEOPTIONS &gameOptions, GAMEOPTIONSLEGACY &gameOptionsLegacy)
 {
     gameOptions.nGameType = gameOptionsLegacy.nGameType;
@@ -91,6 +100,18 @@ CDemo::CDemo()
     at2 = 0;
     memset(&atf, 0, sizeof(atf));
     m_bLegacy = false;
+    m_nPlayers = 0;
+    m_nFrame = 0;
+    m_nSeekFrame = -1;
+    m_nSeekTests = 0;
+    m_pKeyframes = NULL;
+    m_nKeyframes = 0;
+    m_nKeyframeSpacing = 1;
+    m_nKeyframeBytes = 0;
+    m_nSeeks = 0;
+    m_nSeekFrames = 0;
+    m_fSeekTime = 0;
+    m_fMaxSeekTime = 0;
 }
 
 CDemo::~CDemo()
@@ -120,6 +141,7 @@ CDemo::~CDemo()
     pCurrentDemo = NULL;
     nDemosFound = 0;
     m_bLegacy = false;
+    FreeKeyframes();
 }
 
 bool CDemo::Create(const char *pzFile)
@@ -234,6 +256,7 @@ void CDemo::Close(void)
     }
     at0 = 0;
     at1 = 0;
+    FreeKeyframes();
 }
 
 bool CDemo::SetupPlayback(const char *pzFile)
@@ -335,6 +358,12 @@ void CDemo::ProcessKeys(void)
                     gViewIndex = connecthead;
                 gView = &gPlayer[gViewIndex];
                 break;
+            case sc_LeftArrow:
+                Skip(-10*kTicsPerSec);
+                break;
+            case sc_RightArrow:
+                Skip(10*kTicsPerSec);
+                break;
             }
         }
         break;
@@ -360,6 +389,9 @@ void CDemo::Playback(void)
 _DEMOPLAYBACK:
     while (at1 && !gQuitGame)
     {
+        // headless playback runs as fast as it simulates
+        if (gDemoHeadless)
+            gNetFifoClock = totalclock;
         while (totalclock >= gNetFifoClock && !gQuitGame)
         {
             if (!v4)
@@ -385,27 +417,46 @@ _DEMOPLAYBACK:
                     gProfile[i].nAutoAim = 1;
                     gProfile[i].nWeaponSwitch = 1;
                 }
+                m_nPlayers = 0;
+                for (int p = connecthead; p >= 0; p = connectpoint2[p])
+                    m_nPlayers++;
+                m_nFrame = 0;
+                FreeKeyframes();
             }
             ready2send = 0;
             OSD_DispatchQueued();
             if (!gDemo.at1)
                 break;
             ProcessKeys();
+            bool bSeekTest = false;
+            if (m_nSeekTests > 0 && m_nSeekFrame < 0 && FrameCount() > 0)
+            {
+                // not the game's RNG, that one is part of the simulation
+                nSeekTestSeed = nSeekTestSeed * 1103515245 + 12345;
+                m_nSeekFrame = (nSeekTestSeed >> 8) % FrameCount();
+                bSeekTest = --m_nSeekTests == 0;
+            }
+            if (m_nSeekFrame >= 0)
+            {
+                v4 = DoSeek(m_nSeekFrame);
+                m_nSeekFrame = -1;
+                if (bSeekTest)
+                    PrintSeekStats();
+            }
+            TakeKeyframe();
             for (int p = connecthead; p >= 0; p = connectpoint2[p])
             {
-                if ((v4&1023) == 0)
-                {
-                    unsigned int nSize = atb-v4;
-                    if (nSize > kInputBufferSize)
-                        nSize = kInputBufferSize;
-                    ReadInput(nSize);
-                }
-                memcpy(&gFifoInput[gNetFifoHead[p]&255], &at1aa[v4&1023], sizeof(GINPUT));
-                gNetFifoHead[p]++;
+                FeedInput(p, v4);
                 v4++;
                 if (v4 >= atf.nInputCount)
                 {
                     ready2send = 0;
+                    if (gDemoHeadless)
+                    {
+                        PrintSeekStats();
+                        gQuitGame = true;
+                        break;
+                    }
                     if (nDemosFound > 1)
                     {
                         v4 = 0;
@@ -425,6 +476,7 @@ _DEMOPLAYBACK:
             gNetFifoClock += 4;
             if (!gQuitGame)
                 ProcessFrame();
+            m_nFrame++;
             ready2send = 0;
         }
         if (engineFPSLimit())
@@ -435,7 +487,8 @@ _DEMOPLAYBACK:
                 quitevent = 0;
             }
             MUSIC_Update();
-            viewDrawScreen();
+            if (!gDemoHeadless)
+                viewDrawScreen();
             if (gInputMode == INPUT_MODE_1 && CGameMenuMgr::m_bActive)
                 gGameMenuMgr.Draw();
             videoNextPage();
@@ -651,3 +704,150 @@ void CDemo::ReadInput(int nCount)
         }
     }
 }
+
+void CDemo::FeedInput(int nPlayer, int nInput)
+{
+    if ((nInput&(kInputBufferSize-1)) == 0)
+        ReadInput(ClipHigh(atb-nInput, kInputBufferSize));
+    memcpy(&gFifoInput[gNetFifoHead[nPlayer]&255], &at1aa[nInput&(kInputBufferSize-1)], sizeof(GINPUT));
+    gNetFifoHead[nPlayer]++;
+}
+
+// Positions the file so that FeedInput() goes on with nInput
+void CDemo::SeekInput(int nInput)
+{
+    int const nOffset = sizeof(DEMOHEADER)+(m_bLegacy ? sizeof(GAMEOPTIONSLEGACY) : sizeof(GAMEOPTIONS));
+    int const nChunk = nInput&~(kInputBufferSize-1);
+    klseek(hPFile, nOffset+nChunk*(m_bLegacy ? nInputSizeLegacy : nInputSize), SEEK_SET);
+    // at the start of a chunk FeedInput() reads it itself
+    if (nInput != nChunk)
+        ReadInput(ClipHigh(atb-nChunk, kInputBufferSize));
+}
+
+int CDemo::FrameCount(void)
+{
+    return m_nPlayers > 0 ? atf.nInputCount/m_nPlayers : 0;
+}
+
+void CDemo::TakeKeyframe(void)
+{
+    // frame 0 is always kept, seeking backwards can start from there at worst
+    if (m_nKeyframes > 0 && m_pKeyframes[m_nKeyframes-1].nFrame >= m_nFrame)
+        return;
+    if (m_nFrame > 0 && (gDemoKeyframeInterval <= 0 || m_nFrame % m_nKeyframeSpacing != 0))
+        return;
+    m_pKeyframes = (DEMOKEYFRAME *)Xrealloc(m_pKeyframes, (m_nKeyframes+1)*sizeof(DEMOKEYFRAME));
+    DEMOKEYFRAME *pKeyframe = &m_pKeyframes[m_nKeyframes++];
+    pKeyframe->nFrame = m_nFrame;
+    pKeyframe->pState = LoadSave::SaveState(&pKeyframe->nSize);
+    m_nKeyframeBytes += pKeyframe->nSize;
+    // over the budget: keep every other keyframe and take them half as often
+    while ((int64_t)m_nKeyframeBytes > ((int64_t)gDemoKeyframeMemory<<20) && m_nKeyframes > 1)
+    {
+        int j = 1;
+        for (int i = 1; i < m_nKeyframes; i++)
+        {
+            if ((m_pKeyframes[i].nFrame/m_nKeyframeSpacing)&1)
+            {
+                m_nKeyframeBytes -= m_pKeyframes[i].nSize;
+                Xfree(m_pKeyframes[i].pState);
+            }
+            else
+                m_pKeyframes[j++] = m_pKeyframes[i];
+        }
+        m_nKeyframes = j;
+        m_nKeyframeSpacing *= 2;
+    }
+}
+
+void CDemo::FreeKeyframes(void)
+{
+    for (int i = 0; i < m_nKeyframes; i++)
+        Xfree(m_pKeyframes[i].pState);
+    if (m_pKeyframes)
+        Xfree(m_pKeyframes);
+    m_pKeyframes = NULL;
+    m_nKeyframes = 0;
+    m_nKeyframeBytes = 0;
+    m_nKeyframeSpacing = ClipLow(gDemoKeyframeInterval*kTicsPerSec, 1);
+}
+
+// Restores the last keyframe at or before nFrame, unless playing on from
+// the current frame is closer, and simulates up to nFrame without drawing.
+// Returns the input position for the playback loop.
+int CDemo::DoSeek(int nFrame)
+{
+    uint64_t const nStart = timerGetNanoTicks();
+    int const nFrom = m_nFrame;
+    nFrame = ClipRange(nFrame, 0, FrameCount()-1);
+    DEMOKEYFRAME *pKeyframe = NULL;
+    for (int i = m_nKeyframes-1; i >= 0; i--)
+    {
+        if (m_pKeyframes[i].nFrame <= nFrame)
+        {
+            pKeyframe = &m_pKeyframes[i];
+            break;
+        }
+    }
+    bool const bRestore = pKeyframe && (nFrame < m_nFrame || pKeyframe->nFrame > m_nFrame);
+    if (!bRestore && nFrame < m_nFrame)
+        return m_nFrame*m_nPlayers;
+    if (bRestore)
+    {
+        LoadSave::LoadState(pKeyframe->pState, pKeyframe->nSize);
+        m_nFrame = pKeyframe->nFrame;
+        SeekInput(m_nFrame*m_nPlayers);
+    }
+    int const nStartFrame = m_nFrame;
+    int nInput = m_nFrame*m_nPlayers;
+    while (m_nFrame < nFrame && !gQuitGame)
+    {
+        TakeKeyframe();
+        for (int p = connecthead; p >= 0; p = connectpoint2[p])
+            FeedInput(p, nInput++);
+        ProcessFrame();
+        m_nFrame++;
+    }
+    // whatever started while catching up
+    sfxKillAllSounds();
+    gNetFifoClock = totalclock;
+    double const fTime = (double)(timerGetNanoTicks()-nStart)*1000.0/timerGetNanoTickRate();
+    m_nSeeks++;
+    m_nSeekFrames += m_nFrame-nStartFrame;
+    m_fSeekTime += fTime;
+    m_fMaxSeekTime = max(m_fMaxSeekTime, fTime);
+    if (bRestore)
+        OSD_Printf("Seek from frame %d to %d: keyframe %d, %d frames simulated in %.2f ms\n", nFrom, m_nFrame, nStartFrame, m_nFrame-nStartFrame, fTime);
+    else
+        OSD_Printf("Seek from frame %d to %d: %d frames simulated in %.2f ms\n", nFrom, m_nFrame, m_nFrame-nStartFrame, fTime);
+    return nInput;
+}
+
+void CDemo::Seek(int nFrame)
+{
+    if (!at1)
+        return;
+    m_nSeekFrame = ClipLow(nFrame, 0);
+}
+
+void CDemo::Skip(int nFrames)
+{
+    Seek(m_nFrame+nFrames);
+}
+
+// Seeks to nCount random frames, one per played frame, then prints the stats
+void CDemo::SeekTest(int nCount)
+{
+    m_nSeekTests = nCount;
+    m_nSeeks = 0;
+    m_nSeekFrames = 0;
+    m_fSeekTime = 0;
+    m_fMaxSeekTime = 0;
+}
+
+void CDemo::PrintSeekStats(void)
+{
+    OSD_Printf("Demo: %d frames, %d keyframes every %d frames, %d kB\n", FrameCount(), m_nKeyframes, m_nKeyframeSpacing, m_nKeyframeBytes>>10);
+    if (m_nSeeks > 0)
+        OSD_Printf("%d seeks: avg %.2f ms, max %.2f ms, %.1f frames simulated per seek\n", m_nSeeks, m_fSeekTime/m_nSeeks, m_fMaxSeekTime, (double)m_nSeekFrames/m_nSeeks);
+}
@@ -75,6 +75,19 @@ struct DEMOCHAIN
     char zName[BMAX_PATH];
 };
 
+// Game state saved during playback, seeking restores the nearest one
+// before the target and plays on from there without drawing.
+struct DEMOKEYFRAME
+{
+    int nFrame;
+    char *pState;
+    int nSize;
+};
+
+extern int gDemoKeyframeInterval;
+extern int gDemoKeyframeMemory;
+extern int gDemoHeadless;
+
 class CDemo {
 public:
     CDemo();
@@ -90,6 +103,11 @@ public:
     void NextDemo(void);
     void FlushInput(int nCount);
     void ReadInput(int nCount);
+    void Seek(int nFrame);
+    void Skip(int nFrames);
+    void SeekTest(int nCount);
+    void PrintSeekStats(void);
+    int FrameCount(void);
     bool at0; // record
     bool at1; // playback
     bool m_bLegacy;
@@ -105,6 +123,24 @@ public:
     DEMOCHAIN *pFirstDemo;
     DEMOCHAIN *pCurrentDemo;
     int nDemosFound;
+    int m_nPlayers;
+    int m_nFrame;
+    int m_nSeekFrame;
+    int m_nSeekTests;
+    DEMOKEYFRAME *m_pKeyframes;
+    int m_nKeyframes;
+    int m_nKeyframeSpacing;
+    int m_nKeyframeBytes;
+    int m_nSeeks;
+    int m_nSeekFrames;
+    double m_fSeekTime;
+    double m_fMaxSeekTime;
+private:
+    void FeedInput(int nPlayer, int nInput);
+    void SeekInput(int nInput);
+    void TakeKeyframe(void);
+    void FreeKeyframes(void);
+    int DoSeek(int nFrame);
 };
 
 extern CDemo gDemo;
@@ -612,6 +612,13 @@ void evKill(int a1, int a2, CALLBACK_ID a3)
     eventQ.Kill(a1, a2, a3);
 }
 
+// visits the pending events in queue order without removing them
+void evEnumerate(void(*pFunc)(unsigned int nTime, EVENT event))
+{
+    if (eventQ.PQueue)
+        eventQ.PQueue->Enumerate([=](uint32_t nTime, EVENT event) { pFunc(nTime, event); });
+}
+
 class EventQLoadSave : public LoadSave
 {
 public:
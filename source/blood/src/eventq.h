@@ -149,4 +149,5 @@ void evPost(int nIndex, int nType, unsigned int nDelta, CALLBACK_ID callback);
 void evProcess(unsigned int nTime);
 void evKill(int a1, int a2);
 void evKill(int idx, int type, int causer);
-void evKill(int a1, int a2, CALLBACK_ID a3);
\ No newline at end of file
+void evKill(int a1, int a2, CALLBACK_ID a3);
+void evEnumerate(void(*pFunc)(unsigned int nTime, EVENT event));
\ No newline at end of file
@@ -0,0 +1,765 @@
+//-------------------------------------------------------------------------
+/*
+Copyright (C) 2010-2019 EDuke32 developers and contributors
+
+This file is part of NBlood.
+
+NBlood is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+//-------------------------------------------------------------------------
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "build.h"
+#include "mmulti.h"
+#include "xxhash.h"
+#include "common_game.h"
+
+#include "ai.h"
+#include "db.h"
+#include "eventq.h"
+#include "fingerprint.h"
+#include "globals.h"
+#include "network.h"
+#include "player.h"
+#include "seq.h"
+#include "view.h"
+
+// objects are grouped so that a range fits in one packet
+#define kFPRangeBytes 448
+#define kFPChunkBytes 448
+#define kFPMaxSpans 64
+
+enum {
+    kFPRegionMisc = 0,
+    kFPRegionPlayers,
+    kFPRegionSectors,
+    kFPRegionXSectors,
+    kFPRegionWalls,
+    kFPRegionXWalls,
+    kFPRegionSprites,
+    kFPRegionXSprites,
+    kFPRegionEvents,
+    kFPRegionSeqWall,
+    kFPRegionSeqCeiling,
+    kFPRegionSeqFloor,
+    kFPRegionSeqSprite,
+    kFPRegionSeqMasked,
+    kFPRegionMax
+};
+
+enum {
+    kFPOpRegions = 0,
+    kFPOpSpans,
+    kFPOpData,
+};
+
+enum {
+    kFPStatusOk = 0,
+    kFPStatusMissing,
+    kFPStatusBadRequest,
+};
+
+struct FPFIELD {
+    const char *pzName;
+    int (*pGet)(int nIndex);
+};
+
+struct FPREGIONINFO {
+    const char *pzName;
+    int nWord;                  // gChecksum word the region is folded into
+    const FPFIELD *pFields;     // NULL: raw words of the player struct
+    int nFields;
+    int (*pCount)(void);
+    bool (*pInUse)(int nIndex); // objects not in use are all zero
+};
+
+struct FPREGION {
+    int nCount;
+    int nRanges;
+    int32_t *pData;
+    int nDataSize;
+    uint32_t *pRangeHash;
+    int nRangeSize;
+    uint32_t nHash;
+};
+
+struct FPRECORD {
+    int nCheck;
+    int nFrame;
+    bool bValid;
+    FPREGION region[kFPRegionMax];
+};
+
+static FPRECORD fpHistory[kFPHistory];
+static bool fpFrozen;
+
+struct FPEVENT {
+    unsigned int nTime;
+    EVENT event;
+};
+
+static FPEVENT *fpEvents;
+static int fpEventCount, fpEventSize;
+
+static void fpAddEvent(unsigned int nTime, EVENT event)
+{
+    if (fpEventCount == fpEventSize)
+    {
+        fpEventSize = fpEventSize ? fpEventSize*2 : 256;
+        fpEvents = (FPEVENT*)Xrealloc(fpEvents, fpEventSize*sizeof(FPEVENT));
+    }
+    fpEvents[fpEventCount].nTime = nTime;
+    fpEvents[fpEventCount].event = event;
+    fpEventCount++;
+}
+
+// AI states are globals, so their distance to genIdle is the same in every instance of the same build
+static int fpAIState(AISTATE *pState)
+{
+    if (!pState)
+        return 0;
+    return int((intptr_t)pState - (intptr_t)&genIdle) + 1;
+}
+
+static const FPFIELD fpMiscFields[] = {
+    { "gFrame", [](int)->int { return gFrame; } },
+    { "gFrameClock", [](int)->int { return (int)gFrameClock; } },
+    { "wrandomseed", [](int)->int { return (int)wrandomseed; } },
+    { "randomseed", [](int)->int { return randomseed; } },
+    { "events", [](int)->int { return fpEventCount; } },
+};
+
+#define SECTORF(f) { #f, [](int i)->int { return sector[i].f; } }
+static const FPFIELD fpSectorFields[] = {
+    SECTORF(wallptr), SECTORF(wallnum), SECTORF(ceilingz), SECTORF(floorz), SECTORF(ceilingstat), SECTORF(floorstat),
+    SECTORF(ceilingpicnum), SECTORF(ceilingheinum), SECTORF(ceilingshade), SECTORF(ceilingpal),
+    SECTORF(ceilingxpanning), SECTORF(ceilingypanning), SECTORF(floorpicnum), SECTORF(floorheinum),
+    SECTORF(floorshade), SECTORF(floorpal), SECTORF(floorxpanning), SECTORF(floorypanning),
+    SECTORF(visibility), SECTORF(fogpal), SECTORF(type), SECTORF(hitag), SECTORF(extra),
+};
+
+#define XSECTORF(f) { #f, [](int i)->int { return xsector[i].f; } }
+static const FPFIELD fpXSectorFields[] = {
+    XSECTORF(reference), XSECTORF(state), XSECTORF(busy), XSECTORF(data), XSECTORF(txID), XSECTORF(rxID),
+    XSECTORF(busyWaveA), XSECTORF(busyWaveB), XSECTORF(command), XSECTORF(triggerOn), XSECTORF(triggerOff),
+    XSECTORF(busyTimeA), XSECTORF(waitTimeA), XSECTORF(restState), XSECTORF(interruptable),
+    XSECTORF(reTriggerA), XSECTORF(reTriggerB), XSECTORF(amplitude), XSECTORF(freq), XSECTORF(phase),
+    XSECTORF(wave), XSECTORF(shadeAlways), XSECTORF(shadeFloor), XSECTORF(shadeCeiling), XSECTORF(shadeWalls),
+    XSECTORF(shade), XSECTORF(panAlways), XSECTORF(panFloor), XSECTORF(panCeiling), XSECTORF(Drag),
+    XSECTORF(panVel), XSECTORF(panAngle), XSECTORF(Underwater), XSECTORF(Depth), XSECTORF(decoupled),
+    XSECTORF(triggerOnce), XSECTORF(isTriggered), XSECTORF(Key), XSECTORF(Push), XSECTORF(Vector),
+    XSECTORF(Reserved), XSECTORF(Enter), XSECTORF(Exit), XSECTORF(Wallpush), XSECTORF(color),
+    XSECTORF(busyTimeB), XSECTORF(waitTimeB), XSECTORF(stopOn), XSECTORF(stopOff), XSECTORF(ceilpal),
+    XSECTORF(offCeilZ), XSECTORF(onCeilZ), XSECTORF(offFloorZ), XSECTORF(onFloorZ), XSECTORF(marker0),
+    XSECTORF(marker1), XSECTORF(Crush), XSECTORF(ceilXPanFrac), XSECTORF(ceilYPanFrac), XSECTORF(floorXPanFrac),
+    XSECTORF(damageType), XSECTORF(floorpal), XSECTORF(floorYPanFrac), XSECTORF(locked), XSECTORF(windVel),
+    XSECTORF(windAng), XSECTORF(windAlways), XSECTORF(dudeLockout), XSECTORF(bobTheta), XSECTORF(bobZRange),
+    XSECTORF(bobSpeed), XSECTORF(bobAlways), XSECTORF(bobFloor), XSECTORF(bobCeiling), XSECTORF(bobRotate),
+};
+
+#define WALLF(f) { #f, [](int i)->int { return wall[i].f; } }
+static const FPFIELD fpWallFields[] = {
+    WALLF(x), WALLF(y), WALLF(point2), WALLF(nextwall), WALLF(nextsector), WALLF(cstat), WALLF(picnum),
+    WALLF(overpicnum), WALLF(shade), WALLF(pal), WALLF(xrepeat), WALLF(yrepeat), WALLF(xpanning),
+    WALLF(ypanning), WALLF(type), WALLF(hitag), WALLF(extra),
+};
+
+#define XWALLF(f) { #f, [](int i)->int { return xwall[i].f; } }
+static const FPFIELD fpXWallFields[] = {
+    XWALLF(reference), XWALLF(state), XWALLF(busy), XWALLF(data), XWALLF(txID), XWALLF(rxID), XWALLF(command),
+    XWALLF(triggerOn), XWALLF(triggerOff), XWALLF(busyTime), XWALLF(waitTime), XWALLF(restState),
+    XWALLF(interruptable), XWALLF(panAlways), XWALLF(panXVel), XWALLF(panYVel), XWALLF(decoupled),
+    XWALLF(triggerOnce), XWALLF(isTriggered), XWALLF(key), XWALLF(triggerPush), XWALLF(triggerVector),
+    XWALLF(triggerTouch), XWALLF(xpanFrac), XWALLF(ypanFrac), XWALLF(locked), XWALLF(dudeLockout),
+};
+
+#define SPRITEF(f) { #f, [](int i)->int { return sprite[i].f; } }
+static const FPFIELD fpSpriteFields[] = {
+    SPRITEF(x), SPRITEF(y), SPRITEF(z), SPRITEF(cstat), SPRITEF(picnum), SPRITEF(shade), SPRITEF(pal),
+    SPRITEF(clipdist), SPRITEF(blend), SPRITEF(xrepeat), SPRITEF(yrepeat), SPRITEF(xoffset), SPRITEF(yoffset),
+    SPRITEF(sectnum), SPRITEF(statnum), SPRITEF(ang), SPRITEF(owner), SPRITEF(index), SPRITEF(yvel),
+    SPRITEF(inittype), SPRITEF(type), SPRITEF(flags), SPRITEF(extra),
+    { "xvel[]", [](int i)->int { return xvel[i]; } },
+    { "yvel[]", [](int i)->int { return yvel[i]; } },
+    { "zvel[]", [](int i)->int { return zvel[i]; } },
+};
+
+#define XSPRITEF(f) { #f, [](int i)->int { return xsprite[i].f; } }
+static const FPFIELD fpXSpriteFields[] = {
+    XSPRITEF(unused1), XSPRITEF(reference), XSPRITEF(state), XSPRITEF(busy), XSPRITEF(txID), XSPRITEF(rxID),
+    XSPRITEF(command), XSPRITEF(triggerOn), XSPRITEF(triggerOff), XSPRITEF(busyTime), XSPRITEF(waitTime),
+    XSPRITEF(restState), XSPRITEF(Interrutable), XSPRITEF(respawnPending), XSPRITEF(dropMsg),
+    XSPRITEF(Decoupled), XSPRITEF(triggerOnce), XSPRITEF(isTriggered), XSPRITEF(key), XSPRITEF(wave),
+    XSPRITEF(Push), XSPRITEF(Vector), XSPRITEF(Impact), XSPRITEF(Pickup), XSPRITEF(Touch), XSPRITEF(Sight),
+    XSPRITEF(Proximity), XSPRITEF(lSkill), XSPRITEF(lS), XSPRITEF(lB), XSPRITEF(lT), XSPRITEF(lC),
+    XSPRITEF(DudeLockout), XSPRITEF(data1), XSPRITEF(data2), XSPRITEF(data3), XSPRITEF(data4), XSPRITEF(locked),
+    XSPRITEF(medium), XSPRITEF(respawn), XSPRITEF(lockMsg), XSPRITEF(health), XSPRITEF(dudeDeaf),
+    XSPRITEF(dudeAmbush), XSPRITEF(dudeGuard), XSPRITEF(dudeFlag4), XSPRITEF(target), XSPRITEF(targetX),
+    XSPRITEF(targetY), XSPRITEF(targetZ), XSPRITEF(goalAng), XSPRITEF(dodgeDir), XSPRITEF(burnTime),
+    XSPRITEF(burnSource), XSPRITEF(height), XSPRITEF(stateTimer),
+    { "aiState", [](int i)->int { return fpAIState(xsprite[i].aiState); } },
+#ifdef NOONE_EXTENSIONS
+    XSPRITEF(sysData1), XSPRITEF(sysData2), XSPRITEF(physAttr),
+#endif
+    XSPRITEF(scale),
+    { "hit", [](int i)->int { return gSpriteHit[i].hit; } },
+    { "ceilhit", [](int i)->int { return gSpriteHit[i].ceilhit; } },
+    { "florhit", [](int i)->int { return gSpriteHit[i].florhit; } },
+};
+
+#define EVENTF(f) { #f, [](int i)->int { return fpEvents[i].event.f; } }
+static const FPFIELD fpEventFields[] = {
+    { "time", [](int i)->int { return fpEvents[i].nTime; } },
+    EVENTF(index), EVENTF(type), EVENTF(cmd), EVENTF(funcID), EVENTF(causer),
+};
+
+#define SEQF(t, f) { #f, [](int i)->int { SEQINST *pInst = GetInstance(t, i); return pInst ? pInst->f : 0; } }
+#define SEQFIELDS(t) SEQF(t, nSeq), SEQF(t, nCallbackID), SEQF(t, timeCount), SEQF(t, frameIndex), SEQF(t, isPlaying)
+static const FPFIELD fpSeqWallFields[] = { SEQFIELDS(0) };
+static const FPFIELD fpSeqCeilingFields[] = { SEQFIELDS(1) };
+static const FPFIELD fpSeqFloorFields[] = { SEQFIELDS(2) };
+static const FPFIELD fpSeqSpriteFields[] = { SEQFIELDS(3) };
+static const FPFIELD fpSeqMaskedFields[] = { SEQFIELDS(4) };
+
+// the same span of the player struct the old checksum summed up
+#define kFPPlayerWords (int(sizeof(PLAYER) - offsetof(PLAYER, used1)) / 4)
+
+static bool fpSpriteInUse(int nSprite) { return sprite[nSprite].statnum != kMaxStatus; }
+static bool fpXSpriteInUse(int nXSprite) { return xsprite[nXSprite].reference >= 0; }
+static bool fpXSectorInUse(int nXSector) { return xsector[nXSector].reference >= 0; }
+static bool fpXWallInUse(int nXWall) { return xwall[nXWall].reference >= 0; }
+
+template<int nType> bool fpSeqInUse(int nXIndex)
+{
+    SEQINST *pInst = GetInstance(nType, nXIndex);
+    return pInst && pInst->isPlaying;
+}
+
+// one past the highest object in use
+static int fpHighest(int nMax, bool (*pInUse)(int))
+{
+    while (nMax > 0 && !pInUse(nMax-1))
+        nMax--;
+    return nMax;
+}
+
+#define FPFIELDS(a) a, ARRAY_SIZE(a)
+static const FPREGIONINFO fpRegionInfo[kFPRegionMax] = {
+    { "misc", 1, FPFIELDS(fpMiscFields), [](void)->int { return 1; }, NULL },
+    { "player", 1, NULL, kFPPlayerWords, [](void)->int { return kMaxPlayers; }, NULL },
+    { "sector", 2, FPFIELDS(fpSectorFields), [](void)->int { return (int)numsectors; }, NULL },
+    { "xsector", 2, FPFIELDS(fpXSectorFields), [](void)->int { return fpHighest(kMaxXSectors, fpXSectorInUse); }, fpXSectorInUse },
+    { "wall", 2, FPFIELDS(fpWallFields), [](void)->int { return (int)numwalls; }, NULL },
+    { "xwall", 2, FPFIELDS(fpXWallFields), [](void)->int { return fpHighest(kMaxXWalls, fpXWallInUse); }, fpXWallInUse },
+    { "sprite", 3, FPFIELDS(fpSpriteFields), [](void)->int { return fpHighest(kMaxSprites, fpSpriteInUse); }, fpSpriteInUse },
+    { "xsprite", 3, FPFIELDS(fpXSpriteFields), [](void)->int { return fpHighest(kMaxXSprites, fpXSpriteInUse); }, fpXSpriteInUse },
+    { "event", 3, FPFIELDS(fpEventFields), [](void)->int { return fpEventCount; }, NULL },
+    { "wall seq", 3, FPFIELDS(fpSeqWallFields), [](void)->int { return fpHighest(kMaxXWalls, fpSeqInUse<0>); }, fpSeqInUse<0> },
+    { "ceiling seq", 3, FPFIELDS(fpSeqCeilingFields), [](void)->int { return fpHighest(kMaxXSectors, fpSeqInUse<1>); }, fpSeqInUse<1> },
+    { "floor seq", 3, FPFIELDS(fpSeqFloorFields), [](void)->int { return fpHighest(kMaxXSectors, fpSeqInUse<2>); }, fpSeqInUse<2> },
+    { "sprite seq", 3, FPFIELDS(fpSeqSpriteFields), [](void)->int { return fpHighest(kMaxXSprites, fpSeqInUse<3>); }, fpSeqInUse<3> },
+    { "masked seq", 3, FPFIELDS(fpSeqMaskedFields), [](void)->int { return fpHighest(kMaxXWalls, fpSeqInUse<4>); }, fpSeqInUse<4> },
+};
+
+static int fpRangeObjects(int nRegion)
+{
+    return ClipLow(kFPRangeBytes / (fpRegionInfo[nRegion].nFields*4), 1);
+}
+
+static int fpRangeCount(int nRegion, int nCount)
+{
+    int const nObjects = fpRangeObjects(nRegion);
+    return (nCount + nObjects - 1) / nObjects;
+}
+
+static void fpSerialize(int nRegion, int nIndex, int32_t *pOut)
+{
+    const FPREGIONINFO *pInfo = &fpRegionInfo[nRegion];
+    if (pInfo->pInUse && !pInfo->pInUse(nIndex))
+    {
+        memset(pOut, 0, pInfo->nFields*sizeof(int32_t));
+        return;
+    }
+    if (!pInfo->pFields)
+    {
+        memcpy(pOut, &gPlayer[nIndex].used1, pInfo->nFields*sizeof(int32_t));
+        return;
+    }
+    for (int i = 0; i < pInfo->nFields; i++)
+        pOut[i] = pInfo->pFields[i].pGet(nIndex);
+}
+
+static FPRECORD *fpGetRecord(int nCheck)
+{
+    if (nCheck < 0)
+        return NULL;
+    FPRECORD *pRecord = &fpHistory[nCheck % kFPHistory];
+    if (!pRecord->bValid || pRecord->nCheck != nCheck)
+        return NULL;
+    return pRecord;
+}
+
+static void fpRecordRegion(int nRegion, FPREGION *pRegion, const FPREGION *pPrev)
+{
+    const FPREGIONINFO *pInfo = &fpRegionInfo[nRegion];
+    int const nFields = pInfo->nFields;
+    int const nCount = pInfo->pCount();
+    int const nRangeObjects = fpRangeObjects(nRegion);
+    int const nRanges = fpRangeCount(nRegion, nCount);
+
+    if (nCount*nFields > pRegion->nDataSize)
+    {
+        pRegion->nDataSize = nCount*nFields;
+        pRegion->pData = (int32_t*)Xrealloc(pRegion->pData, pRegion->nDataSize*sizeof(int32_t));
+    }
+    if (nRanges > pRegion->nRangeSize)
+    {
+        pRegion->nRangeSize = nRanges;
+        pRegion->pRangeHash = (uint32_t*)Xrealloc(pRegion->pRangeHash, pRegion->nRangeSize*sizeof(uint32_t));
+    }
+    pRegion->nCount = nCount;
+    pRegion->nRanges = nRanges;
+
+    for (int i = 0; i < nCount; i++)
+        fpSerialize(nRegion, i, pRegion->pData + i*nFields);
+
+    // only the ranges that changed since the last check are hashed again
+    for (int i = 0; i < nRanges; i++)
+    {
+        int const nFirst = i*nRangeObjects;
+        int const nObjects = ClipHigh(nCount - nFirst, nRangeObjects);
+        int32_t const *pData = pRegion->pData + nFirst*nFields;
+        int const nBytes = nObjects*nFields*sizeof(int32_t);
+        if (pPrev && nFirst + nObjects <= pPrev->nCount && (nObjects == nRangeObjects || pPrev->nCount == nCount)
+            && !memcmp(pData, pPrev->pData + nFirst*nFields, nBytes))
+            pRegion->pRangeHash[i] = pPrev->pRangeHash[i];
+        else
+            pRegion->pRangeHash[i] = XXH32(pData, nBytes, i);
+    }
+    pRegion->nHash = XXH32(pRegion->pRangeHash, nRanges*sizeof(uint32_t), nCount);
+}
+
+void fpRecord(int nCheck, unsigned int *pChecksum)
+{
+    if (fpFrozen)
+        return;
+
+    fpEventCount = 0;
+    evEnumerate(fpAddEvent);
+
+    FPRECORD *pPrev = fpGetRecord(nCheck-1);
+    FPRECORD *pRecord = &fpHistory[nCheck % kFPHistory];
+    pRecord->nCheck = nCheck;
+    pRecord->nFrame = gFrame;
+    pRecord->bValid = true;
+
+    for (int i = 0; i < kFPRegionMax; i++)
+        fpRecordRegion(i, &pRecord->region[i], pPrev ? &pPrev->region[i] : NULL);
+
+    for (int nWord = 1; nWord < 4; nWord++)
+    {
+        uint32_t nHash[kFPRegionMax*2];
+        int nHashes = 0;
+        for (int i = 0; i < kFPRegionMax; i++)
+        {
+            if (fpRegionInfo[i].nWord != nWord)
+                continue;
+            nHash[nHashes++] = pRecord->region[i].nCount;
+            nHash[nHashes++] = pRecord->region[i].nHash;
+        }
+        pChecksum[nWord] = XXH32(nHash, nHashes*sizeof(uint32_t), nWord);
+    }
+}
+
+// keeps the fingerprints of the check that went out of sync around until the report is done
+void fpFreeze(void)
+{
+    fpFrozen = true;
+}
+
+static uint32_t fpSpanHash(const FPREGION *pRegion, int nFirst, int nLast)
+{
+    return XXH32(pRegion->pRangeHash + nFirst, (nLast - nFirst)*sizeof(uint32_t), 0);
+}
+
+static int fpSpanCount(int nFirst, int nLast)
+{
+    return ClipHigh(nLast - nFirst, kFPMaxSpans);
+}
+
+static int fpSpanStart(int nFirst, int nLast, int nSpan)
+{
+    return nFirst + (nLast - nFirst) * nSpan / fpSpanCount(nFirst, nLast);
+}
+
+static void fpSendQuery(int nPlayer, int nOp, int nCheck, const char *pBuffer, int nSize)
+{
+    char buffer[32];
+    char *pPacket = buffer;
+    PutPacketByte(pPacket, 5);
+    PutPacketByte(pPacket, nOp);
+    PutPacketDWord(pPacket, nCheck);
+    if (nSize > 0)
+        PutPacketBuffer(pPacket, pBuffer, nSize);
+    netSendPacket(nPlayer, buffer, pPacket - buffer);
+}
+
+void fpProcessQuery(int nPlayer, char *pPacket, int nSize)
+{
+    char buffer[512];
+    char *pReply = buffer;
+    char *pEnd = pPacket + nSize;
+    if (nSize < 5)
+        return;
+    int const nOp = GetPacketByte(pPacket);
+    int const nCheck = GetPacketDWord(pPacket);
+    const FPRECORD *pRecord = fpGetRecord(nCheck);
+    PutPacketByte(pReply, 6);
+    PutPacketByte(pReply, nOp);
+    PutPacketDWord(pReply, nCheck);
+    char *pStatus = pReply;
+    PutPacketByte(pReply, pRecord ? kFPStatusOk : kFPStatusMissing);
+    if (pRecord)
+    {
+        switch (nOp)
+        {
+        case kFPOpRegions:
+            for (int i = 0; i < kFPRegionMax; i++)
+            {
+                PutPacketDWord(pReply, pRecord->region[i].nCount);
+                PutPacketDWord(pReply, pRecord->region[i].nHash);
+            }
+            break;
+        case kFPOpSpans:
+        {
+            if (pEnd - pPacket < 9)
+            {
+                *pStatus = kFPStatusBadRequest;
+                break;
+            }
+            int const nRegion = (unsigned char)GetPacketByte(pPacket);
+            int const nFirst = GetPacketDWord(pPacket);
+            int const nLast = GetPacketDWord(pPacket);
+            if (nRegion >= kFPRegionMax || nFirst < 0 || nFirst >= nLast || nLast > pRecord->region[nRegion].nRanges)
+            {
+                *pStatus = kFPStatusBadRequest;
+                break;
+            }
+            const FPREGION *pRegion = &pRecord->region[nRegion];
+            int const nSpans = fpSpanCount(nFirst, nLast);
+            PutPacketByte(pReply, nRegion);
+            PutPacketDWord(pReply, nFirst);
+            PutPacketDWord(pReply, nLast);
+            for (int i = 0; i < nSpans; i++)
+                PutPacketDWord(pReply, fpSpanHash(pRegion, fpSpanStart(nFirst, nLast, i), fpSpanStart(nFirst, nLast, i+1)));
+            break;
+        }
+        case kFPOpData:
+        {
+            if (pEnd - pPacket < 7)
+            {
+                *pStatus = kFPStatusBadRequest;
+                break;
+            }
+            int const nRegion = (unsigned char)GetPacketByte(pPacket);
+            int const nRange = GetPacketDWord(pPacket);
+            int const nOffset = (unsigned short)GetPacketWord(pPacket);
+            if (nRegion >= kFPRegionMax || nRange < 0 || nRange >= pRecord->region[nRegion].nRanges)
+            {
+                *pStatus = kFPStatusBadRequest;
+                break;
+            }
+            const FPREGION *pRegion = &pRecord->region[nRegion];
+            int const nFields = fpRegionInfo[nRegion].nFields;
+            int const nFirst = nRange*fpRangeObjects(nRegion);
+            int const nObjects = ClipHigh(pRegion->nCount - nFirst, fpRangeObjects(nRegion));
+            int const nTotal = nObjects*nFields*sizeof(int32_t);
+            if (nOffset >= nTotal)
+            {
+                *pStatus = kFPStatusBadRequest;
+                break;
+            }
+            int const nLength = ClipHigh(nTotal - nOffset, kFPChunkBytes);
+            PutPacketByte(pReply, nRegion);
+            PutPacketDWord(pReply, nRange);
+            PutPacketWord(pReply, nOffset);
+            PutPacketWord(pReply, nTotal);
+            PutPacketWord(pReply, nLength);
+            PutPacketBuffer(pReply, (const char*)(pRegion->pData + nFirst*nFields) + nOffset, nLength);
+            break;
+        }
+        default:
+            *pStatus = kFPStatusBadRequest;
+            break;
+        }
+    }
+    netSendPacket(nPlayer, buffer, pReply - buffer);
+}
+
+static struct {
+    bool bActive;
+    int nPlayer;
+    int nCheck;
+    FILE *hFile;
+    char zName[BMAX_PATH];
+    int nPeerCount[kFPRegionMax];
+    int nMismatch;      // bit mask of the regions left to narrow down
+    int nRegion;
+    int nFirst, nLast;
+    int nRange;
+    char *pPeerData;
+    int nPeerDataSize;
+    int nDiffs;
+} fpReport;
+
+static void fpEndReport(void)
+{
+    char buffer[128];
+    fprintf(fpReport.hFile, "\n%d differing fields found.\n", fpReport.nDiffs);
+    fclose(fpReport.hFile);
+    fpReport.hFile = NULL;
+    fpReport.bActive = false;
+    sprintf(buffer, "Desync report written to %s", fpReport.zName);
+    OSD_Printf("%s\n", buffer);
+    viewSetMessage(buffer);
+}
+
+static void fpAbortReport(const char *pzReason)
+{
+    fprintf(fpReport.hFile, "\n%s\n", pzReason);
+    fpEndReport();
+}
+
+static void fpQuerySpans(int nRegion, int nFirst, int nLast)
+{
+    char buffer[16];
+    char *pPacket = buffer;
+    fpReport.nRegion = nRegion;
+    fpReport.nFirst = nFirst;
+    fpReport.nLast = nLast;
+    PutPacketByte(pPacket, nRegion);
+    PutPacketDWord(pPacket, nFirst);
+    PutPacketDWord(pPacket, nLast);
+    fpSendQuery(fpReport.nPlayer, kFPOpSpans, fpReport.nCheck, buffer, pPacket - buffer);
+}
+
+static void fpQueryData(int nOffset)
+{
+    char buffer[16];
+    char *pPacket = buffer;
+    PutPacketByte(pPacket, fpReport.nRegion);
+    PutPacketDWord(pPacket, fpReport.nRange);
+    PutPacketWord(pPacket, nOffset);
+    fpSendQuery(fpReport.nPlayer, kFPOpData, fpReport.nCheck, buffer, pPacket - buffer);
+}
+
+// moves on to the next region that differs, or finishes the report
+static void fpNextRegion(const FPRECORD *pRecord)
+{
+    while (fpReport.nMismatch)
+    {
+        int nRegion = 0;
+        while (!(fpReport.nMismatch & (1 << nRegion)))
+            nRegion++;
+        fpReport.nMismatch &= ~(1 << nRegion);
+
+        const FPREGION *pRegion = &pRecord->region[nRegion];
+        int const nPeerCount = fpReport.nPeerCount[nRegion];
+        fprintf(fpReport.hFile, "\n%s:\n", fpRegionInfo[nRegion].pzName);
+        if (pRegion->nCount != nPeerCount)
+            fprintf(fpReport.hFile, "  count: %d local, %d remote\n", pRegion->nCount, nPeerCount);
+        int const nRanges = ClipHigh(pRegion->nRanges, fpRangeCount(nRegion, nPeerCount));
+        if (nRanges > 0)
+        {
+            fpQuerySpans(nRegion, 0, nRanges);
+            return;
+        }
+    }
+    fpEndReport();
+}
+
+static void fpCompareRange(const FPRECORD *pRecord, int nPeerBytes)
+{
+    int const nRegion = fpReport.nRegion;
+    const FPREGIONINFO *pInfo = &fpRegionInfo[nRegion];
+    const FPREGION *pRegion = &pRecord->region[nRegion];
+    int const nFields = pInfo->nFields;
+    int const nFirst = fpReport.nRange*fpRangeObjects(nRegion);
+    int const nObjects = ClipHigh(ClipHigh(pRegion->nCount - nFirst, fpRangeObjects(nRegion)), nPeerBytes / (nFields*4));
+    const int32_t *pPeer = (const int32_t*)fpReport.pPeerData;
+    for (int i = 0; i < nObjects; i++)
+    {
+        const int32_t *pLocal = pRegion->pData + (nFirst+i)*nFields;
+        const int32_t *pRemote = pPeer + i*nFields;
+        if (!memcmp(pLocal, pRemote, nFields*sizeof(int32_t)))
+            continue;
+        fprintf(fpReport.hFile, "  %s %d\n", pInfo->pzName, nFirst+i);
+        for (int j = 0; j < nFields; j++)
+        {
+            if (pLocal[j] == pRemote[j])
+                continue;
+            if (pInfo->pFields)
+                fprintf(fpReport.hFile, "    %s: %d local, %d remote\n", pInfo->pFields[j].pzName, pLocal[j], pRemote[j]);
+            else
+                fprintf(fpReport.hFile, "    +0x%x: %d local, %d remote\n", (int)offsetof(PLAYER, used1) + j*4, pLocal[j], pRemote[j]);
+            fpReport.nDiffs++;
+        }
+    }
+}
+
+void fpReset(void)
+{
+    for (int i = 0; i < kFPHistory; i++)
+        fpHistory[i].bValid = false;
+    fpFrozen = false;
+    if (fpReport.bActive)
+        fpAbortReport("The game was reset before the report was complete.");
+}
+
+void fpBeginReport(int nCheck, int nPlayer)
+{
+    if (fpReport.bActive)
+        return;
+    const FPRECORD *pRecord = fpGetRecord(nCheck);
+    if (!pRecord)
+    {
+        OSD_Printf("Fingerprint of sync check %d is no longer available, no desync report written.\n", nCheck);
+        return;
+    }
+    sprintf(fpReport.zName, "desync%d.txt", pRecord->nFrame);
+    fpReport.hFile = fopen(fpReport.zName, "wt");
+    if (!fpReport.hFile)
+    {
+        OSD_Printf("Error writing %s\n", fpReport.zName);
+        return;
+    }
+    fpReport.bActive = true;
+    fpReport.nPlayer = nPlayer;
+    fpReport.nCheck = nCheck;
+    fpReport.nDiffs = 0;
+    fprintf(fpReport.hFile, "Out of sync at check %d, frame %d\n", nCheck, pRecord->nFrame);
+    fprintf(fpReport.hFile, "local: player %d (%s), remote: player %d (%s)\n", myconnectindex, gProfile[myconnectindex].name,
+        nPlayer, gProfile[nPlayer].name);
+    fpSendQuery(nPlayer, kFPOpRegions, nCheck, NULL, 0);
+}
+
+void fpProcessReply(int nPlayer, char *pPacket, int nSize)
+{
+    if (!fpReport.bActive || nPlayer != fpReport.nPlayer || nSize < 6)
+        return;
+    char *pEnd = pPacket + nSize;
+    int const nOp = GetPacketByte(pPacket);
+    int const nCheck = GetPacketDWord(pPacket);
+    int const nStatus = GetPacketByte(pPacket);
+    if (nCheck != fpReport.nCheck)
+        return;
+    const FPRECORD *pRecord = fpGetRecord(nCheck);
+    if (!pRecord)
+    {
+        fpAbortReport("The local fingerprint is no longer available.");
+        return;
+    }
+    if (nStatus == kFPStatusMissing)
+    {
+        fpAbortReport("The remote fingerprint is no longer available.");
+        return;
+    }
+    if (nStatus != kFPStatusOk)
+    {
+        fpAbortReport("The remote player rejected a query.");
+        return;
+    }
+    switch (nOp)
+    {
+    case kFPOpRegions:
+    {
+        if (pEnd - pPacket < kFPRegionMax*8)
+            return;
+        fpReport.nMismatch = 0;
+        fprintf(fpReport.hFile, "\n%-12s %10s %10s %10s %10s\n", "region", "count", "hash", "remote", "hash");
+        for (int i = 0; i < kFPRegionMax; i++)
+        {
+            const FPREGION *pRegion = &pRecord->region[i];
+            fpReport.nPeerCount[i] = GetPacketDWord(pPacket);
+            uint32_t const nPeerHash = GetPacketDWord(pPacket);
+            bool const bMismatch = pRegion->nCount != fpReport.nPeerCount[i] || pRegion->nHash != nPeerHash;
+            if (bMismatch)
+                fpReport.nMismatch |= 1 << i;
+            fprintf(fpReport.hFile, "%-12s %10d   %08x %10d   %08x%s\n", fpRegionInfo[i].pzName, pRegion->nCount, pRegion->nHash,
+                fpReport.nPeerCount[i], nPeerHash, bMismatch ? "  *" : "");
+        }
+        fpNextRegion(pRecord);
+        break;
+    }
+    case kFPOpSpans:
+    {
+        if (pEnd - pPacket < 9)
+            return;
+        int const nRegion = (unsigned char)GetPacketByte(pPacket);
+        int const nFirst = GetPacketDWord(pPacket);
+        int const nLast = GetPacketDWord(pPacket);
+        if (nRegion != fpReport.nRegion || nFirst != fpReport.nFirst || nLast != fpReport.nLast)
+            return;
+        int const nSpans = fpSpanCount(nFirst, nLast);
+        if (pEnd - pPacket < nSpans*4)
+            return;
+        const FPREGION *pRegion = &pRecord->region[nRegion];
+        for (int i = 0; i < nSpans; i++)
+        {
+            int const nStart = fpSpanStart(nFirst, nLast, i);
+            int const nEnd = fpSpanStart(nFirst, nLast, i+1);
+            if ((uint32_t)GetPacketDWord(pPacket) == fpSpanHash(pRegion, nStart, nEnd))
+                continue;
+            if (nEnd - nStart > 1)
+            {
+                fpQuerySpans(nRegion, nStart, nEnd);
+                return;
+            }
+            fpReport.nRange = nStart;
+            fpReport.nPeerDataSize = 0;
+            fpQueryData(0);
+            return;
+        }
+        fprintf(fpReport.hFile, "  all objects both sides have match\n");
+        fpNextRegion(pRecord);
+        break;
+    }
+    case kFPOpData:
+    {
+        if (pEnd - pPacket < 11)
+            return;
+        int const nRegion = (unsigned char)GetPacketByte(pPacket);
+        int const nRange = GetPacketDWord(pPacket);
+        int const nOffset = (unsigned short)GetPacketWord(pPacket);
+        int const nTotal = (unsigned short)GetPacketWord(pPacket);
+        int const nLength = (unsigned short)GetPacketWord(pPacket);
+        if (nRegion != fpReport.nRegion || nRange != fpReport.nRange || nOffset != fpReport.nPeerDataSize
+            || nOffset + nLength > nTotal || pEnd - pPacket < nLength)
+            return;
+        fpReport.pPeerData = (char*)Xrealloc(fpReport.pPeerData, nTotal);
+        GetPacketBuffer(pPacket, fpReport.pPeerData + nOffset, nLength);
+        fpReport.nPeerDataSize = nOffset + nLength;
+        if (fpReport.nPeerDataSize < nTotal)
+        {
+            fpQueryData(fpReport.nPeerDataSize);
+            return;
+        }
+        fpCompareRange(pRecord, nTotal);
+        fpNextRegion(pRecord);
+        break;
+    }
+    }
+}
@@ -0,0 +1,42 @@
+//-------------------------------------------------------------------------
+/*
+Copyright (C) 2010-2019 EDuke32 developers and contributors
+
+This file is part of NBlood.
+
+NBlood is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+//-------------------------------------------------------------------------
+#pragma once
+
+// Fingerprint of the whole simulation state, taken at every sync check.
+// The state is split into regions (sectors, walls, sprites, xsprites,
+// the event queue, SEQ instances...) and each region into ranges of a
+// few objects; a range is only rehashed when it changed since the last
+// check. The region hashes are folded into words 1-3 of gChecksum.
+//
+// The last kFPHistory fingerprints are kept. When a check mismatches,
+// the master asks the other player for region, range and object data of
+// that check until it has the first differing object of every region,
+// and writes the differing fields to a report file.
+
+#define kFPHistory 16
+
+void fpReset(void);
+void fpRecord(int nCheck, unsigned int *pChecksum);
+void fpFreeze(void);
+void fpBeginReport(int nCheck, int nPlayer);
+void fpProcessQuery(int nPlayer, char *pPacket, int nSize);
+void fpProcessReply(int nPlayer, char *pPacket, int nSize);
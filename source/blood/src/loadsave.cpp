@@ -30,10 +30,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "asound.h"
 #include "blood.h"
 #include "demo.h"
+#include "fingerprint.h"
 #include "globals.h"
 #include "db.h"
 #include "messages.h"
 #include "menu.h"
+#include "misc.h"
 #include "network.h"
 #include "loadsave.h"
 #include "resource.h"
@@ -59,6 +61,13 @@ void *dword_27AA44 = NULL;
 LoadSave LoadSave::head(123);
 FILE *LoadSave::hSFile = NULL;
 int LoadSave::hLFile = -1;
+char *LoadSave::pBuffer = NULL;
+int LoadSave::nBufferSize = 0;
+int LoadSave::nBufferPos = 0;
+
+// grown as needed and kept, every state is about the same size
+static char *pStateBuffer;
+static int nStateBufferSize;
 
 short word_27AA54 = 0;
 
@@ -81,6 +90,14 @@ void LoadSave::Load(void)
 void LoadSave::Read(void *pData, int nSize)
 {
     dword_27AA38 += nSize;
+    if (pBuffer)
+    {
+        if (nBufferPos + nSize > nBufferSize)
+            ThrowError("Error reading saved state.");
+        memcpy(pData, pBuffer + nBufferPos, nSize);
+        nBufferPos += nSize;
+        return;
+    }
     dassert(hLFile != -1);
     if (kread(hLFile, pData, nSize) != nSize)
         ThrowError("Error reading save file.");
@@ -90,6 +107,18 @@ void LoadSave::Write(void *pData, int nSize)
 {
     dword_27AA38 += nSize;
     dword_27AA3C += nSize;
+    if (pBuffer)
+    {
+        if (nBufferPos + nSize > nBufferSize)
+        {
+            nBufferSize = max(nBufferSize * 2, nBufferPos + nSize);
+            pStateBuffer = pBuffer = (char *)Xrealloc(pBuffer, nBufferSize);
+            nStateBufferSize = nBufferSize;
+        }
+        memcpy(pBuffer + nBufferPos, pData, nSize);
+        nBufferPos += nSize;
+        return;
+    }
     dassert(hSFile != NULL);
     if (fwrite(pData, 1, nSize, hSFile) != (size_t)nSize)
         ThrowError("File error #%d writing save file.", errno);
@@ -152,6 +181,7 @@ void LoadSave::LoadGame(char *pzFile)
     gCheckTail = 0;
     gBufferJitter = 0;
     bOutOfSync = 0;
+    fpReset();
     for (int i = 0; i < gNetPlayers; i++)
         playerSetRace(&gPlayer[i], gPlayer[i].lifeMode);
     if (VanillaMode())
@@ -245,6 +275,71 @@ void LoadSave::SaveGame(char *pzFile)
     hSFile = NULL;
 }
 
+// Saves the game state to a new block of memory, for keyframes that are
+// restored within the same level. The random seeds are not in save files
+// but are added here, so that the game plays on exactly as it did.
+char *LoadSave::SaveState(int *pSize)
+{
+    if (!pStateBuffer)
+    {
+        nStateBufferSize = 0x100000;
+        pStateBuffer = (char *)Xmalloc(nStateBufferSize);
+    }
+    pBuffer = pStateBuffer;
+    nBufferSize = nStateBufferSize;
+    nBufferPos = 0;
+    dword_27AA38 = 0;
+    LoadSave *rover = head.next;
+    while (rover != &head)
+    {
+        rover->Save();
+        rover = rover->next;
+    }
+    head.Write(&randSeed, sizeof(randSeed));
+    head.Write(&wrandomseed, sizeof(wrandomseed));
+    char *pState = (char *)Xmalloc(nBufferPos);
+    memcpy(pState, pBuffer, nBufferPos);
+    *pSize = nBufferPos;
+    pBuffer = NULL;
+    nBufferSize = nBufferPos = 0;
+    return pState;
+}
+
+// Counterpart of SaveState(). Unlike LoadGame() it leaves the network and
+// input state, the clock, messages and music alone.
+void LoadSave::LoadState(char *pState, int nSize)
+{
+    ClockTicks nClock = totalclock;
+    sndKillAllSounds();
+    sfxKillAllSounds();
+    ambKillAll();
+    seqKillAll();
+    pBuffer = pState;
+    nBufferSize = nSize;
+    nBufferPos = 0;
+    LoadSave *rover = head.next;
+    while (rover != &head)
+    {
+        rover->Load();
+        rover = rover->next;
+    }
+    head.Read(&randSeed, sizeof(randSeed));
+    head.Read(&wrandomseed, sizeof(wrandomseed));
+    pBuffer = NULL;
+    nBufferSize = nBufferPos = 0;
+    totalclock = nClock;
+    InitSectorFX();
+    viewInitializePrediction();
+    ambInit();
+#ifdef YAX_ENABLE
+    yax_update(numyaxbunches > 0 ? 2 : 1);
+#endif
+    // walls moved by sliding doors have to be seen where the state puts them, by clipmove() as well
+    calc_sector_reachability();
+    for (int i = 0; i < gNetPlayers; i++)
+        playerSetRace(&gPlayer[i], gPlayer[i].lifeMode);
+}
+
 class MyLoadSave : public LoadSave
 {
 public:
@@ -29,6 +29,10 @@ public:
     static LoadSave head;
     static FILE *hSFile;
     static int hLFile;
+    // memory image used instead of the files by SaveState() and LoadState()
+    static char *pBuffer;
+    static int nBufferSize;
+    static int nBufferPos;
     LoadSave *prev;
     LoadSave *next;
     LoadSave() {
@@ -49,6 +53,8 @@ public:
     void Write(void *, int);
     static void LoadGame(char *);
     static void SaveGame(char *);
+    static char *SaveState(int *pSize);
+    static void LoadState(char *pState, int nSize);
 };
 
 extern unsigned int gSavedOffset;
@@ -0,0 +1,540 @@
+//-------------------------------------------------------------------------
+/*
+Copyright (C) 2010-2019 EDuke32 developers and contributors
+
+This file is part of NBlood.
+
+NBlood is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+//-------------------------------------------------------------------------
+#include <deque>
+#include "build.h"
+#include "mmulti.h"
+#include "compat.h"
+#include "osd.h"
+#include "timer.h"
+#include "common_game.h"
+#include "blood.h"
+#include "demo.h"
+#include "fingerprint.h"
+#include "globals.h"
+#include "levels.h"
+#include "loopback.h"
+#include "network.h"
+#include "player.h"
+
+int gLoopbackLatency = 0;
+int gLoopbackJitter = 0;
+int gLoopbackLoss = 0;
+int gLoopbackDuration = 0;
+int gLoopbackHeadless = 1;
+int gLoopbackCorrupt = -1;
+char gLoopbackInput[BMAX_PATH];
+
+#define kLoopbackMinResend 50 // ms
+#define kLoopbackHistogram 64 // 1 ms buckets of frame time, the last one takes everything slower
+
+struct LBPACKET
+{
+    uint64_t nDeliver;
+    int nSize;
+    char pData[576];
+};
+
+struct LBLINK
+{
+    std::deque<LBPACKET> queue;
+    uint64_t nLastDeliver;
+};
+
+struct LBSCRIPT
+{
+    uint32_t nSeed;
+    int nTicks;
+    int nForward;
+    int nStrafe;
+    int nTurn;
+    bool bShoot;
+    bool bJump;
+};
+
+struct LBCLIENT
+{
+    int nInputHead;     // inputs sent to the master
+    int nMasterHead;    // inputs received from the master
+    unsigned int checkFifo[256][4];
+    int nCheckHead;
+    int nCheckTail;
+};
+
+struct LBSTATS
+{
+    uint64_t nStartTime;
+    int nFrames;
+    uint64_t nFrameTime;
+    uint64_t nMaxFrameTime;
+    int nSlowFrames;
+    int histogram[kLoopbackHistogram];
+    // 0: master to clients, 1: clients to master
+    int nPackets[2];
+    int64_t nBytes[2];
+    int nResends[2];
+    int nMaxQueue[2];
+    int nOutOfSyncFrame;
+    int nOutOfSyncCheck;
+};
+
+static LBLINK lbToClient[kMaxPlayers];
+static LBLINK lbToMaster[kMaxPlayers];
+static LBCLIENT lbClient[kMaxPlayers];
+static LBSCRIPT lbScript[kMaxPlayers];
+static int lbInputFrame[kMaxPlayers];
+static LBSTATS lbStats;
+static uint32_t lbSeed;
+
+// set while a client handles a packet, its replies go back to the master
+static int lbSender = -1;
+
+static GINPUT *lbDemoInput;
+static int lbDemoFrames;
+static int lbDemoPlayers;
+
+// own generator, jitter and loss must not disturb the game's random numbers
+static int lbRandom(uint32_t *pSeed)
+{
+    *pSeed = *pSeed * 1103515245 + 12345;
+    return (*pSeed >> 16) & 0x7fff;
+}
+
+static uint64_t lbMsToTicks(int nMs)
+{
+    return (uint64_t)nMs * timerGetNanoTickRate() / 1000;
+}
+
+static double lbTicksToMs(uint64_t nTicks)
+{
+    return (double)nTicks * 1000.0 / timerGetNanoTickRate();
+}
+
+static void lbQueue(LBLINK *pLink, int nDir, const char *pBuffer, int nSize)
+{
+    dassert(nSize > 0 && nSize <= (int)sizeof(LBPACKET::pData));
+    int nDelay = gLoopbackLatency;
+    if (gLoopbackJitter > 0)
+        nDelay += lbRandom(&lbSeed) % (gLoopbackJitter + 1);
+    // a lost packet is sent again once the sender's resend timer runs out
+    int const nLoss = ClipHigh(gLoopbackLoss, 90);
+    while (nLoss > 0 && lbRandom(&lbSeed) % 100 < nLoss)
+    {
+        nDelay += ClipLow(2 * (gLoopbackLatency + gLoopbackJitter), kLoopbackMinResend);
+        lbStats.nResends[nDir]++;
+    }
+    LBPACKET packet;
+    // the link is in order, nothing overtakes a packet that is still held up
+    packet.nDeliver = max(timerGetNanoTicks() + lbMsToTicks(nDelay), pLink->nLastDeliver);
+    packet.nSize = nSize;
+    memcpy(packet.pData, pBuffer, nSize);
+    pLink->nLastDeliver = packet.nDeliver;
+    pLink->queue.push_back(packet);
+    lbStats.nPackets[nDir]++;
+    lbStats.nBytes[nDir] += nSize;
+    lbStats.nMaxQueue[nDir] = ClipLow(lbStats.nMaxQueue[nDir], (int)pLink->queue.size());
+}
+
+static void lbClearLink(LBLINK *pLink)
+{
+    pLink->queue.clear();
+    pLink->nLastDeliver = 0;
+}
+
+static void lbScriptInput(LBSCRIPT *pScript, GINPUT *pInput)
+{
+    bool const bNewLeg = --pScript->nTicks <= 0;
+    if (bNewLeg)
+    {
+        pScript->nTicks = 8 + lbRandom(&pScript->nSeed) % 45;
+        pScript->nForward = (lbRandom(&pScript->nSeed) % 4) ? 2048 : -1024;
+        pScript->nStrafe = (lbRandom(&pScript->nSeed) % 3 - 1) * 1024;
+        pScript->nTurn = lbRandom(&pScript->nSeed) % 33 - 16;
+        pScript->bShoot = lbRandom(&pScript->nSeed) % 3 == 0;
+        pScript->bJump = lbRandom(&pScript->nSeed) % 8 == 0;
+    }
+    memset(pInput, 0, sizeof(GINPUT));
+    pInput->syncFlags.run = 1;
+    pInput->forward = pScript->nForward;
+    pInput->strafe = pScript->nStrafe;
+    pInput->q16turn = fix16_from_int(pScript->nTurn);
+    pInput->buttonFlags.shoot = pScript->bShoot;
+    pInput->buttonFlags.jump = pScript->bJump;
+    pInput->keyFlags.action = lbRandom(&pScript->nSeed) % 32 == 0;
+    pInput->keyFlags.nextWeapon = bNewLeg && lbRandom(&pScript->nSeed) % 4 == 0;
+}
+
+static void lbFreeDemo(void)
+{
+    if (lbDemoInput)
+        Xfree(lbDemoInput);
+    lbDemoInput = NULL;
+    lbDemoFrames = lbDemoPlayers = 0;
+}
+
+static void lbLoadDemo(const char *pzFile)
+{
+    lbFreeDemo();
+    CDemo *pDemo = new CDemo;
+    if (!pDemo->SetupPlayback(pzFile))
+    {
+        OSD_Printf("Loopback: could not play back %s, using scripted input\n", pzFile);
+        delete pDemo;
+        return;
+    }
+    int const nPlayers = ClipRange(pDemo->atf.nNetPlayers, 1, kMaxPlayers);
+    int const nCount = pDemo->atf.nInputCount - pDemo->atf.nInputCount % nPlayers;
+    if (nCount <= 0)
+    {
+        OSD_Printf("Loopback: %s has no input, using scripted input\n", pzFile);
+        delete pDemo;
+        return;
+    }
+    lbDemoInput = (GINPUT*)Xmalloc(nCount * sizeof(GINPUT));
+    for (int i = 0; i < nCount; i += kInputBufferSize)
+    {
+        int const nChunk = ClipHigh(nCount - i, kInputBufferSize);
+        pDemo->ReadInput(nChunk);
+        memcpy(&lbDemoInput[i], pDemo->at1aa, nChunk * sizeof(GINPUT));
+    }
+    delete pDemo;
+    for (int i = 0; i < nCount; i++)
+    {
+        // the harness decides when the game ends
+        lbDemoInput[i].keyFlags.pause = 0;
+        lbDemoInput[i].keyFlags.quit = 0;
+        lbDemoInput[i].keyFlags.restart = 0;
+    }
+    lbDemoPlayers = nPlayers;
+    lbDemoFrames = nCount / nPlayers;
+    OSD_Printf("Loopback: playing the input of %d player(s) from %s (%d frames)\n", lbDemoPlayers, pzFile, lbDemoFrames);
+}
+
+void lbGetInput(int nPlayer, GINPUT *pInput)
+{
+    int const nFrame = lbInputFrame[nPlayer]++;
+    if (lbDemoInput)
+    {
+        // the demo stores the inputs of all its players frame by frame, and loops
+        *pInput = lbDemoInput[(nFrame % lbDemoFrames) * lbDemoPlayers + nPlayer % lbDemoPlayers];
+        return;
+    }
+    lbScriptInput(&lbScript[nPlayer], pInput);
+}
+
+static void lbClientSendInput(int nClient)
+{
+    LBCLIENT *pClient = &lbClient[nClient];
+    GINPUT input;
+    lbGetInput(nClient, &input);
+    if (input.buttonFlags.byte)
+        input.syncFlags.buttonChange = 1;
+    if (input.keyFlags.word)
+        input.syncFlags.keyChange = 1;
+    if (input.useFlags.byte)
+        input.syncFlags.useChange = 1;
+    if (input.newWeapon)
+        input.syncFlags.weaponChange = 1;
+    if (input.q16mlook)
+        input.syncFlags.mlookChange = 1;
+    char buffer[576];
+    char *pPacket = buffer;
+    PutPacketByte(pPacket, 1);
+    PutPacketByte(pPacket, input.syncFlags.byte);
+    PutPacketWord(pPacket, input.forward);
+    PutPacketDWord(pPacket, input.q16turn);
+    PutPacketWord(pPacket, input.strafe);
+    if (input.syncFlags.buttonChange)
+        PutPacketByte(pPacket, input.buttonFlags.byte);
+    if (input.syncFlags.keyChange)
+        PutPacketWord(pPacket, input.keyFlags.word);
+    if (input.syncFlags.useChange)
+        PutPacketByte(pPacket, input.useFlags.byte);
+    if (input.syncFlags.weaponChange)
+        PutPacketByte(pPacket, input.newWeapon);
+    if (input.syncFlags.mlookChange)
+        PutPacketDWord(pPacket, input.q16mlook);
+    // the client runs the same simulation, so its checksums are the master's
+    while (pClient->nCheckTail != pClient->nCheckHead && pPacket + 16 <= buffer + sizeof(buffer))
+    {
+        unsigned int checkSum[4];
+        memcpy(checkSum, pClient->checkFifo[pClient->nCheckTail&255], sizeof(checkSum));
+        if (pClient->nCheckTail == gLoopbackCorrupt && nClient == connectpoint2[connecthead])
+            checkSum[1] ^= 1;
+        PutPacketBuffer(pPacket, checkSum, sizeof(checkSum));
+        pClient->nCheckTail++;
+    }
+    lbQueue(&lbToMaster[nClient], 1, buffer, pPacket - buffer);
+    pClient->nInputHead++;
+}
+
+static void lbClientReceive(int nClient, char *pBuffer, int nSize)
+{
+    LBCLIENT *pClient = &lbClient[nClient];
+    char *pPacket = pBuffer;
+    switch ((unsigned char)GetPacketByte(pPacket))
+    {
+    case 0:
+    {
+        for (int p = connecthead; p >= 0; p = connectpoint2[p])
+        {
+            SYNCFLAGS syncFlags;
+            syncFlags.byte = GetPacketByte(pPacket);
+            pPacket += 2+4+2;
+            if (syncFlags.buttonChange)
+                pPacket++;
+            if (syncFlags.keyChange)
+                pPacket += 2;
+            if (syncFlags.useChange)
+                pPacket++;
+            if (syncFlags.weaponChange)
+                pPacket++;
+            if (syncFlags.mlookChange)
+                pPacket += 4;
+        }
+        if ((pClient->nMasterHead&15) == 0)
+        {
+            for (int p = connectpoint2[connecthead]; p >= 0; p = connectpoint2[p])
+                pPacket++;
+        }
+        pClient->nMasterHead++;
+        while (pPacket + 16 <= pBuffer + nSize)
+        {
+            GetPacketBuffer(pPacket, pClient->checkFifo[pClient->nCheckHead&255], 16);
+            pClient->nCheckHead++;
+        }
+        break;
+    }
+    case 5:
+        lbSender = nClient;
+        fpProcessQuery(connecthead, pPacket, pBuffer + nSize - pPacket);
+        lbSender = -1;
+        break;
+    case 250:
+    {
+        char ready = (char)250;
+        lbQueue(&lbToMaster[nClient], 1, &ready, 1);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void lbUpdate(void)
+{
+    uint64_t const nNow = timerGetNanoTicks();
+    for (int p = connectpoint2[connecthead]; p >= 0; p = connectpoint2[p])
+    {
+        LBLINK *pLink = &lbToClient[p];
+        while (!pLink->queue.empty() && pLink->queue.front().nDeliver <= nNow)
+        {
+            LBPACKET packet = pLink->queue.front();
+            pLink->queue.pop_front();
+            lbClientReceive(p, packet.pData, packet.nSize);
+        }
+        // one input per tick the master has been through, a client with a perfectly matched clock
+        while (lbClient[p].nInputHead < gNetFifoHead[connecthead])
+            lbClientSendInput(p);
+    }
+}
+
+void lbSendPacket(int nDest, char *pBuffer, int nSize)
+{
+    if (lbSender >= 0)
+    {
+        lbQueue(&lbToMaster[lbSender], 1, pBuffer, nSize);
+        return;
+    }
+    if (nDest <= 0 || nDest >= kMaxPlayers || nDest == myconnectindex)
+        return;
+    lbQueue(&lbToClient[nDest], 0, pBuffer, nSize);
+}
+
+int lbGetPacket(short *pSource, char *pMessage)
+{
+    uint64_t const nNow = timerGetNanoTicks();
+    int nFirst = -1;
+    for (int p = connectpoint2[connecthead]; p >= 0; p = connectpoint2[p])
+    {
+        LBLINK *pLink = &lbToMaster[p];
+        if (pLink->queue.empty() || pLink->queue.front().nDeliver > nNow)
+            continue;
+        if (nFirst < 0 || pLink->queue.front().nDeliver < lbToMaster[nFirst].queue.front().nDeliver)
+            nFirst = p;
+    }
+    if (nFirst < 0)
+        return 0;
+    LBLINK *pLink = &lbToMaster[nFirst];
+    int const nSize = pLink->queue.front().nSize;
+    memcpy(pMessage, pLink->queue.front().pData, nSize);
+    pLink->queue.pop_front();
+    *pSource = nFirst;
+    return nSize;
+}
+
+void lbReset(void)
+{
+    for (int p = 0; p < kMaxPlayers; p++)
+    {
+        LBCLIENT *pClient = &lbClient[p];
+        pClient->nInputHead = 0;
+        pClient->nMasterHead = 0;
+        pClient->nCheckHead = pClient->nCheckTail = 0;
+        lbInputFrame[p] = 0;
+        lbScript[p].nSeed = 0x1d872b41 + p * 7919;
+        lbScript[p].nTicks = 0;
+    }
+}
+
+void lbInit(void)
+{
+    lbDeinit();
+    lbSeed = 0x2545f491;
+    lbSender = -1;
+    lbReset();
+    lbResetStats();
+    // the clients introduce themselves like netBroadcastPlayerInfo does
+    for (int p = connectpoint2[connecthead]; p >= 0; p = connectpoint2[p])
+    {
+        PROFILE profile;
+        memset(&profile, 0, sizeof(profile));
+        profile.nAutoAim = 1;
+        profile.nWeaponSwitch = 1;
+        profile.skill = 2;
+        Bsnprintf(profile.name, sizeof(profile.name), "Client %d", p);
+        char buffer[1 + sizeof(PROFILE)];
+        char *pPacket = buffer;
+        PutPacketByte(pPacket, 251);
+        PutPacketBuffer(pPacket, &profile, sizeof(PROFILE));
+        lbQueue(&lbToMaster[p], 1, buffer, pPacket - buffer);
+    }
+    initprintf("Loopback game with %d simulated client(s)\n", numplayers - 1);
+}
+
+void lbDeinit(void)
+{
+    for (int p = 0; p < kMaxPlayers; p++)
+    {
+        lbClearLink(&lbToClient[p]);
+        lbClearLink(&lbToMaster[p]);
+    }
+    lbFreeDemo();
+}
+
+void lbStartGame(const char *pzUserMap)
+{
+    // read here rather than in lbInit so that autoexec.cfg can set it
+    if (gLoopbackInput[0])
+        lbLoadDemo(gLoopbackInput);
+    memset(&gPacketStartGame, 0, sizeof(gPacketStartGame));
+    gPacketStartGame.gameType = 2;
+    gPacketStartGame.episodeId = 0;
+    gPacketStartGame.levelId = 0;
+    gPacketStartGame.difficulty = 2;
+    gPacketStartGame.monsterSettings = gGameOptions.nMonsterSettings;
+    gPacketStartGame.weaponSettings = 2;
+    gPacketStartGame.itemSettings = 1;
+    gPacketStartGame.respawnSettings = 0;
+    gPacketStartGame.bFriendlyFire = true;
+    gPacketStartGame.bPlayerKeys = LOSTONDEATH;
+    if (pzUserMap)
+    {
+        Bstrncpy(gPacketStartGame.userMapName, pzUserMap, sizeof(gPacketStartGame.userMapName)-1);
+        gPacketStartGame.userMap = 1;
+    }
+    netBroadcastNewGame();
+    lbResetStats();
+    gStartNewGame = 1;
+}
+
+void lbFrameDone(uint64_t nTime)
+{
+    lbStats.nFrames++;
+    lbStats.nFrameTime += nTime;
+    lbStats.nMaxFrameTime = max(lbStats.nMaxFrameTime, nTime);
+    double const nMs = lbTicksToMs(nTime);
+    if (nMs > 1000.0 / kTicsPerSec)
+        lbStats.nSlowFrames++;
+    lbStats.histogram[ClipHigh((int)nMs, kLoopbackHistogram-1)]++;
+    if (bOutOfSync && lbStats.nOutOfSyncFrame < 0)
+    {
+        lbStats.nOutOfSyncFrame = gFrame;
+        lbStats.nOutOfSyncCheck = gCheckTail;
+        OSD_Printf("Loopback: out of sync at frame %d (check %d)\n", gFrame, gCheckTail);
+    }
+    if (gLoopbackDuration > 0 && lbStats.nFrames >= gLoopbackDuration * kTicsPerSec)
+    {
+        lbPrintStats();
+        gQuitGame = true;
+    }
+}
+
+void lbResetStats(void)
+{
+    memset(&lbStats, 0, sizeof(lbStats));
+    lbStats.nStartTime = timerGetNanoTicks();
+    lbStats.nOutOfSyncFrame = -1;
+    lbStats.nOutOfSyncCheck = -1;
+}
+
+static double lbPercentile(int nPercent)
+{
+    int const nWanted = (lbStats.nFrames * nPercent + 99) / 100;
+    int nCount = 0;
+    for (int i = 0; i < kLoopbackHistogram; i++)
+    {
+        nCount += lbStats.histogram[i];
+        if (nCount >= nWanted)
+            return i + 1;
+    }
+    return kLoopbackHistogram;
+}
+
+void lbPrintStats(void)
+{
+    if (gNetMode != NETWORK_LOOPBACK)
+    {
+        OSD_Printf("Not in a loopback game\n");
+        return;
+    }
+    double const nSeconds = lbTicksToMs(timerGetNanoTicks() - lbStats.nStartTime) / 1000.0;
+    OSD_Printf("Loopback: %d players, latency %d ms, jitter %d ms, loss %d%%, %s input\n", numplayers,
+        gLoopbackLatency, gLoopbackJitter, gLoopbackLoss, lbDemoInput ? "demo" : "scripted");
+    OSD_Printf("%d frames in %.1f s\n", lbStats.nFrames, nSeconds);
+    if (lbStats.nFrames > 0)
+    {
+        OSD_Printf("Frame time: avg %.3f ms, max %.3f ms, p50 <%.0f ms, p99 <%.0f ms, %d over the %.1f ms budget\n",
+            lbTicksToMs(lbStats.nFrameTime) / lbStats.nFrames, lbTicksToMs(lbStats.nMaxFrameTime),
+            lbPercentile(50), lbPercentile(99), lbStats.nSlowFrames, 1000.0 / kTicsPerSec);
+    }
+    static const char *pzDir[2] = { "master to clients", "clients to master" };
+    for (int i = 0; i < 2; i++)
+    {
+        OSD_Printf("%s: %d packets, %" PRId64 " bytes (%.0f bytes/s, %.1f bytes/frame), %d resent, at most %d queued\n",
+            pzDir[i], lbStats.nPackets[i], lbStats.nBytes[i], nSeconds > 0 ? lbStats.nBytes[i] / nSeconds : 0.0,
+            lbStats.nFrames > 0 ? (double)lbStats.nBytes[i] / lbStats.nFrames : 0.0, lbStats.nResends[i], lbStats.nMaxQueue[i]);
+    }
+    if (lbStats.nOutOfSyncFrame >= 0)
+        OSD_Printf("Out of sync at frame %d (check %d)\n", lbStats.nOutOfSyncFrame, lbStats.nOutOfSyncCheck);
+    else
+        OSD_Printf("In sync, %d checks compared\n", gCheckTail);
+}
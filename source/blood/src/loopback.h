@@ -0,0 +1,55 @@
+//-------------------------------------------------------------------------
+/*
+Copyright (C) 2010-2019 EDuke32 developers and contributors
+
+This file is part of NBlood.
+
+NBlood is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+//-------------------------------------------------------------------------
+#pragma once
+#include "compat.h"
+#include "controls.h"
+
+// In-process transport for NETWORK_LOOPBACK (-loopback <players>). This
+// instance is the master; players 1 and up are simulated clients that
+// live inside the transport and speak the slave side of the protocol:
+// they answer the ready handshake, send one input per tick and echo the
+// master's checksums back. Their inputs come from a wander script or from
+// the players of a recorded demo.
+//
+// Every link is reliable and in order like the ENet channel it stands in
+// for. A packet arrives after the latency plus a random jitter, and every
+// loss adds a resend timeout.
+
+extern int gLoopbackLatency;
+extern int gLoopbackJitter;
+extern int gLoopbackLoss;
+extern int gLoopbackDuration;
+extern int gLoopbackHeadless;
+extern int gLoopbackCorrupt;
+extern char gLoopbackInput[BMAX_PATH];
+
+void lbInit(void);
+void lbDeinit(void);
+void lbReset(void);
+void lbStartGame(const char *pzUserMap);
+void lbSendPacket(int nDest, char *pBuffer, int nSize);
+int lbGetPacket(short *pSource, char *pMessage);
+void lbUpdate(void);
+void lbGetInput(int nPlayer, GINPUT *pInput);
+void lbFrameDone(uint64_t nTime);
+void lbResetStats(void);
+void lbPrintStats(void);
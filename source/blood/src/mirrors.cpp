@@ -377,6 +377,7 @@ void DrawMirrors(int x, int y, int z, fix16_t a, fix16_t horiz, int smooth, int
                 wall[mirrorwall[2]].y = wall[mirrorwall[1]].y+(wall[mirrorwall[1]].y-wall[mirrorwall[0]].y)*16;
                 wall[mirrorwall[3]].x = wall[mirrorwall[0]].x+(wall[mirrorwall[0]].x-wall[mirrorwall[1]].x)*16;
                 wall[mirrorwall[3]].y = wall[mirrorwall[0]].y+(wall[mirrorwall[0]].y-wall[mirrorwall[1]].y)*16;
+                sectorGridInvalidate(mirrorsector);
                 sector[mirrorsector].floorz = sector[nSector].floorz;
                 sector[mirrorsector].ceilingz = sector[nSector].ceilingz;
                 int cx, cy, ca;
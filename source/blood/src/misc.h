@@ -26,6 +26,7 @@ bool FileRead(FILE *, void *, unsigned int);
 bool FileWrite(FILE *, void *, unsigned int);
 bool FileLoad(const char *, void *, unsigned int);
 int FileLength(FILE *);
+extern unsigned int randSeed;
 unsigned int qrand(void);
 void ChangeExtension(char *pzFile, const char *pzExt);
 void SplitPath(const char *pzPath, char *pzDirectory, char *pzFile, char *pzType);
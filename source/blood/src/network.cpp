@@ -29,7 +29,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "compat.h"
 #include "config.h"
 #include "controls.h"
+#include "fingerprint.h"
 #include "globals.h"
+#include "loopback.h"
 #include "network.h"
 #include "menu.h"
 #include "player.h"
@@ -67,7 +69,8 @@ char gNetAddress[32];
 // PORT-TODO: Use different port?
 int gNetPort = kNetDefaultPort;
 
-const short word_1328AC = 0x214;
+// bumped whenever the packets or the sync checksum change, so mismatched builds refuse to play together
+const short word_1328AC = 0x215;
 
 PKT_STARTGAME gPacketStartGame;
 
@@ -168,6 +171,11 @@ void netResetToSinglePlayer(void)
 
 void netSendPacket(int nDest, char *pBuffer, int nSize)
 {
+    if (gNetMode == NETWORK_LOOPBACK)
+    {
+        lbSendPacket(nDest, pBuffer, nSize);
+        return;
+    }
 #ifndef NETCODE_DISABLE
     if (gNetMode == NETWORK_NONE)
         return;
@@ -235,39 +243,18 @@ void netResetState(void)
     gCheckTail = 0;
     bOutOfSync = 0;
     gBufferJitter = 1;
+    fpReset();
+    if (gNetMode == NETWORK_LOOPBACK)
+        lbReset();
 }
 
 void CalcGameChecksum(void)
 {
     memset(gChecksum, 0, sizeof(gChecksum));
     gChecksum[0] = wrand();
-    for (int p = connecthead; p >= 0; p = connectpoint2[p])
-    {
-        int *pBuffer = &gPlayer[p].used1;
-        int sum = 0;
-        int length = ((char*)&gPlayer[p+1]-(char*)pBuffer)/4;
-        while (length--)
-        {
-            sum += *pBuffer++;
-        }
-        gChecksum[1] ^= sum;
-        pBuffer = (int*)gPlayer[p].pSprite;
-        sum = 0;
-        length = sizeof(spritetype)/4;
-        while (length--)
-        {
-            sum += *pBuffer++;
-        }
-        gChecksum[2] ^= sum;
-        pBuffer = (int*)gPlayer[p].pXSprite;
-        sum = 0;
-        length = sizeof(XSPRITE)/4;
-        while (length--)
-        {
-            sum += *pBuffer++;
-        }
-        gChecksum[3] ^= sum;
-    }
+    // 1: players, 2: sectors and walls, 3: sprites, events and sequences
+    if (numplayers > 1)
+        fpRecord(gCheckHead[myconnectindex], gChecksum);
 }
 
 void netCheckSync(void)
@@ -289,7 +276,8 @@ void netCheckSync(void)
 
         for (int p = connecthead; p >= 0; p = connectpoint2[p])
         {
-            if (p != myconnectindex)
+            // a slave only gets the master's checksums, so it compares its own
+            if (p != myconnectindex || myconnectindex != connecthead)
             {
                 int status = memcmp(gCheckFifo[gCheckTail&255][p], gCheckFifo[gCheckTail&255][connecthead], 16);
                 if (status)
@@ -302,6 +290,12 @@ void netCheckSync(void)
                             pBuffer += sprintf(pBuffer, " %d", i);
                     }
                     viewSetErrorMessage(buffer);
+                    if (!bOutOfSync)
+                    {
+                        fpFreeze();
+                        if (myconnectindex == connecthead)
+                            fpBeginReport(gCheckTail, p);
+                    }
                     bOutOfSync = 1;
                 }
             }
@@ -312,6 +306,11 @@ void netCheckSync(void)
 
 short netGetPacket(short *pSource, char *pMessage)
 {
+    if (gNetMode == NETWORK_LOOPBACK)
+    {
+        lbUpdate();
+        return lbGetPacket(pSource, pMessage);
+    }
 #ifndef NETCODE_DISABLE
     if (gNetMode == NETWORK_NONE)
         return 0;
@@ -483,6 +482,12 @@ void netGetPackets(void)
         case 4:
             sndStartSample(4400+GetPacketByte(pPacket), 128, 1, 0);
             break;
+        case 5:
+            fpProcessQuery(nPlayer, pPacket, packet+nSize-pPacket);
+            break;
+        case 6:
+            fpProcessReply(nPlayer, pPacket, packet+nSize-pPacket);
+            break;
         case 7:
             nPlayer = GetPacketDWord(pPacket);
             dassert(nPlayer != myconnectindex);
@@ -727,6 +732,8 @@ void netGetInput(void)
             return;
     GINPUT &input = gFifoInput[gNetFifoHead[myconnectindex]&255][myconnectindex];
     input = gNetInput;
+    if (gNetMode == NETWORK_LOOPBACK && gLoopbackHeadless)
+        lbGetInput(myconnectindex, &input);
     gNetFifoHead[myconnectindex]++;
     if (gGameOptions.nGameType == 0 || numplayers == 1)
     {
@@ -889,6 +896,18 @@ void netInitialize(bool bConsole)
     netDeinitialize();
     memset(gPlayerReady, 0, sizeof(gPlayerReady));
     netResetState();
+    if (gNetMode == NETWORK_LOOPBACK)
+    {
+        // no sockets, the other players are simulated by the transport
+        myconnectindex = connecthead = 0;
+        gInitialNetPlayers = numplayers = gNetPlayers;
+        for (int i = 0; i < numplayers-1; i++)
+            connectpoint2[i] = i+1;
+        connectpoint2[numplayers-1] = -1;
+        gGameOptions.nGameType = 2;
+        lbInit();
+        return;
+    }
 #ifndef NETCODE_DISABLE
     char buffer[128];
     gNetENetServer = gNetENetClient = NULL;
@@ -1159,6 +1178,11 @@ void netInitialize(bool bConsole)
 
 void netDeinitialize(void)
 {
+    if (gNetMode == NETWORK_LOOPBACK)
+    {
+        lbDeinit();
+        return;
+    }
 #ifndef NETCODE_DISABLE
     gNetENetInit = false;
     if (gNetMode != NETWORK_NONE)
@@ -1191,6 +1215,11 @@ void netPostEPacket(ENetPacket *pEPacket)
 
 void netUpdate(void)
 {
+    if (gNetMode == NETWORK_LOOPBACK)
+    {
+        lbUpdate();
+        return;
+    }
 #ifndef NETCODE_DISABLE
     ENetEvent event;
     if (gNetMode == NETWORK_NONE)
@@ -1302,6 +1331,8 @@ void netUpdate(void)
 
 void faketimerhandler(void)
 {
+    if (gNetMode == NETWORK_LOOPBACK)
+        lbUpdate();
 #ifndef NETCODE_DISABLE
     if (gNetMode != NETWORK_NONE && gNetENetInit)
         netUpdate();
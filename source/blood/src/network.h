@@ -35,7 +35,8 @@ enum PACKETMODE {
 enum NETWORKMODE {
     NETWORK_NONE = 0,
     NETWORK_SERVER,
-    NETWORK_CLIENT
+    NETWORK_CLIENT,
+    NETWORK_LOOPBACK
 };
 
 enum PLAYERKEYSMODE {
@@ -142,6 +143,7 @@ inline void GetPacketBuffer(char *&p, void *pBuffer, int size)
     p += size;
 }
 
+void netSendPacket(int nDest, char *pBuffer, int nSize);
 void netResetState(void);
 void netResetToSinglePlayer(void);
 void netBroadcastMessage(int nPlayer, const char *pzMessage);
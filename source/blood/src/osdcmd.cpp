@@ -37,6 +37,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gamemenu.h"
 #include "globals.h"
 #include "levels.h"
+#include "loopback.h"
 #include "menu.h"
 #include "messages.h"
 #include "network.h"
@@ -221,6 +222,48 @@ static int osdcmd_demo(osdcmdptr_t parm)
     return OSDCMD_OK;
 }
 
+static int osdcmd_demo_seek(osdcmdptr_t parm)
+{
+    if (parm->numparms != 1)
+        return OSDCMD_SHOWHELP;
+
+    if (!gDemo.at1)
+    {
+        OSD_Printf("demo_seek: No demo is playing\n");
+        return OSDCMD_OK;
+    }
+
+    gDemo.Seek(Batol(parm->parms[0])*kTicsPerSec);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_demo_skip(osdcmdptr_t parm)
+{
+    if (parm->numparms != 1)
+        return OSDCMD_SHOWHELP;
+
+    if (!gDemo.at1)
+    {
+        OSD_Printf("demo_skip: No demo is playing\n");
+        return OSDCMD_OK;
+    }
+
+    gDemo.Skip(Batol(parm->parms[0])*kTicsPerSec);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_demo_seektest(osdcmdptr_t parm)
+{
+    if (parm->numparms != 1)
+        return OSDCMD_SHOWHELP;
+
+    gDemo.SeekTest(ClipLow(Batol(parm->parms[0]), 0));
+
+    return OSDCMD_OK;
+}
+
 int osdcmd_restartvid(osdcmdptr_t UNUSED(parm))
 {
     UNREFERENCED_CONST_PARAMETER(parm);
@@ -755,6 +798,17 @@ static int osdcmd_quickload(osdcmdptr_t UNUSED(parm))
     return OSDCMD_OK;
 }
 
+static int osdcmd_loopbackstats(osdcmdptr_t parm)
+{
+    if (parm->numparms == 1 && !Bstrcasecmp(parm->parms[0], "reset"))
+        lbResetStats();
+    else if (parm->numparms == 0)
+        lbPrintStats();
+    else
+        return OSDCMD_SHOWHELP;
+    return OSDCMD_OK;
+}
+
 static int osdcmd_screenshot(osdcmdptr_t parm)
 {
     static const char *fn = "blud0000.png";
@@ -1048,6 +1102,16 @@ int32_t registerosdcommands(void)
         { "mus_redbook", "enables/disables redbook audio", (void *)&CDAudioToggle, CVAR_BOOL, 0, 1 },
         { "net_address","sets network address used for multiplayer", (void *)zNetAddressBuffer, CVAR_STRING|CVAR_FUNCPTR, 0, 16 },
         { "net_port","sets network port used for multiplayer", (void *)zNetPortBuffer, CVAR_STRING|CVAR_FUNCPTR, 0, 6 },
+        { "demo_keyframeinterval","seconds of demo playback between the keyframes seeking restores from, 0 to only keep the start", (void *)&gDemoKeyframeInterval, CVAR_INT, 0, 600 },
+        { "demo_keyframememory","megabytes the keyframes of a demo may use before every other one is dropped", (void *)&gDemoKeyframeMemory, CVAR_INT, 1, 2048 },
+        { "demo_headless","play demos without drawing and as fast as possible, print the seek stats and quit at the end", (void *)&gDemoHeadless, CVAR_BOOL|CVAR_NOSAVE, 0, 1 },
+        { "net_loopback_latency","one way latency in milliseconds of the links to the simulated clients of -loopback", (void *)&gLoopbackLatency, CVAR_INT|CVAR_NOSAVE, 0, 2000 },
+        { "net_loopback_jitter","random extra delay in milliseconds added to each loopback packet", (void *)&gLoopbackJitter, CVAR_INT|CVAR_NOSAVE, 0, 1000 },
+        { "net_loopback_loss","percentage of loopback packets lost once and resent", (void *)&gLoopbackLoss, CVAR_INT|CVAR_NOSAVE, 0, 90 },
+        { "net_loopback_input","demo whose recorded input drives the players of a loopback game, empty for scripted input", (void *)gLoopbackInput, CVAR_STRING|CVAR_NOSAVE, 0, BMAX_PATH },
+        { "net_loopback_duration","seconds of game time after which a loopback game prints its stats and quits, 0 to run until quit", (void *)&gLoopbackDuration, CVAR_INT|CVAR_NOSAVE, 0, 86400 },
+        { "net_loopback_headless","skip drawing the view and use scripted input for the local player in a loopback game", (void *)&gLoopbackHeadless, CVAR_BOOL|CVAR_NOSAVE, 0, 1 },
+        { "net_loopback_corrupt","checksum number the first simulated client reports wrong, to exercise desync handling; -1 for none", (void *)&gLoopbackCorrupt, CVAR_INT|CVAR_NOSAVE, -1, 0x7fffffff },
 //
 //        { "osdhightile", "enable/disable hires art replacements for console text", (void *)&osdhightile, CVAR_BOOL, 0, 1 },
 //        { "osdscale", "adjust console text size", (void *)&osdscale, CVAR_FLOAT|CVAR_FUNCPTR, 1, 4 },
@@ -1118,6 +1182,9 @@ int32_t registerosdcommands(void)
     OSD_RegisterFunction("changelevel","changelevel <volume> <level>: warps to the given level", osdcmd_changelevel);
     OSD_RegisterFunction("map","map <mapfile>: loads the given user map", osdcmd_map);
     OSD_RegisterFunction("demo","demo <demofile or demonum>: starts the given demo", osdcmd_demo);
+    OSD_RegisterFunction("demo_seek","demo_seek <seconds>: jumps to the given time of the playing demo", osdcmd_demo_seek);
+    OSD_RegisterFunction("demo_skip","demo_skip <seconds>: skips forwards or, with a negative count, backwards in the playing demo", osdcmd_demo_skip);
+    OSD_RegisterFunction("demo_seektest","demo_seektest <count>: seeks to <count> random frames of the playing or next demo and prints the seek latency", osdcmd_demo_seektest);
 //    }
 //
 //    OSD_RegisterFunction("addpath","addpath <path>: adds path to game filesystem", osdcmd_addpath);
@@ -1162,6 +1229,7 @@ int32_t registerosdcommands(void)
 //    OSD_RegisterFunction("listplayers","listplayers: lists currently connected multiplayer clients", osdcmd_listplayers);
 //#endif
     OSD_RegisterFunction("music","music E<ep>L<lev>: change music", osdcmd_music);
+    OSD_RegisterFunction("net_loopbackstats","net_loopbackstats [reset]: prints or resets the frame time, traffic and sync stats of a loopback game", osdcmd_loopbackstats);
 //
 //#if !defined NETCODE_DISABLE
 //    OSD_RegisterFunction("name","name: change your multiplayer nickname", osdcmd_name);
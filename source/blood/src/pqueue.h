@@ -66,6 +66,7 @@ public:
     virtual T Remove(void) = 0;
     virtual uint32_t LowestPriority(void) = 0;
     virtual void Kill(std::function<bool(T)> pMatch) = 0;
+    virtual void Enumerate(std::function<void(uint32_t, T)> pFunc) = 0;
 };
 
 template<typename T> class VanillaPriorityQueue : public PriorityQueue<T>
@@ -143,6 +144,11 @@ public:
                 i++;
         }
     }
+    void Enumerate(std::function<void(uint32_t, T)> pFunc)
+    {
+        for (unsigned int i = 1; i <= fNodeCount; i++)
+            pFunc(queueItems[i].at0, queueItems[i].at4);
+    }
 };
 
 template<typename T> class StdPriorityQueue : public PriorityQueue<T>
@@ -183,4 +189,9 @@ public:
                 i++;
         }
     }
+    void Enumerate(std::function<void(uint32_t, T)> pFunc)
+    {
+        for (auto i = stdQueue.begin(); i != stdQueue.end(); i++)
+            pFunc(i->at0, i->at4);
+    }
 };
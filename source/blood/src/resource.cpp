@@ -42,7 +42,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "sound.h"
 #endif
 
-CACHENODE Resource::purgeHead = { NULL, &purgeHead, &purgeHead, 0 };
+CACHENODE Resource::purgeHead = { NULL, &purgeHead, &purgeHead, 0, false };
 
 #ifdef USE_QHEAP
 QHeap *Resource::heap;
@@ -235,13 +235,17 @@ void Resource::Flush(CACHENODE *h)
 {
     if (h->ptr)
     {
+        if (!h->mapped)
+        {
 #ifdef USE_QHEAP
-        heap->Free(h->ptr);
+            heap->Free(h->ptr);
 #else
-        delete[] (char*)h->ptr;
+            delete[] (char*)h->ptr;
 #endif
-        
+        }
+
         h->ptr = NULL;
+        h->mapped = false;
         if (h->lockCount == 0)
         {
             RemoveMRU(h);
@@ -591,8 +595,9 @@ void *Resource::Alloc(int nSize)
     {
         dassert(node->lockCount == 0);
         dassert(node->ptr != NULL);
-        int nFree = heap->Free(node->ptr);
+        int nFree = node->mapped ? 0 : heap->Free(node->ptr);
         node->ptr = NULL;
+        node->mapped = false;
         RemoveMRU(node);
         if (nSize <= nFree)
         {
@@ -692,14 +697,21 @@ void Resource::Read(DICTNODE *n, void *p)
     }
     else
     {
-        int r = klseek(handle, n->offset, SEEK_SET);
-        if (r == -1)
+        if (char const *pView = View(n))
         {
-            ThrowError("Error seeking to resource!");
+            Bmemcpy(p, pView, n->size);
         }
-        if ((uint32_t)kread(handle, p, n->size) != n->size)
+        else
         {
-            ThrowError("Error loading resource!");
+            int r = klseek(handle, n->offset, SEEK_SET);
+            if (r == -1)
+            {
+                ThrowError("Error seeking to resource!");
+            }
+            if ((uint32_t)kread(handle, p, n->size) != n->size)
+            {
+                ThrowError("Error loading resource!");
+            }
         }
         if (n->flags & DICT_CRYPT)
         {
@@ -792,6 +804,33 @@ void Resource::Read(DICTNODE *n, void *p)
     }
 }
 
+char const *Resource::View(DICTNODE *n)
+{
+    dassert(n != NULL);
+    if ((n->flags & (DICT_EXTERNAL | DICT_BUFFER)) || handle == -1)
+        return NULL;
+    int32_t nLength;
+    char const *pView = (char const *)kfileview(handle, &nLength, 1);
+    if (!pView || n->offset > (uint32_t)nLength || n->size > (uint32_t)nLength - n->offset)
+        return NULL;
+    return pView + n->offset;
+}
+
+// Sound data is only ever read, so it can be played straight from the
+// archive instead of being copied into the cache.
+bool Resource::Map(DICTNODE *h)
+{
+    dassert(h != NULL);
+    if ((h->flags & DICT_CRYPT) || Bstrcmp(h->type, "RAW"))
+        return false;
+    char const *pView = View(h);
+    if (!pView)
+        return false;
+    h->ptr = const_cast<char *>(pView);
+    h->mapped = true;
+    return true;
+}
+
 void *Resource::Load(DICTNODE *h)
 {
     dassert(h != NULL);
@@ -809,8 +848,11 @@ void *Resource::Load(DICTNODE *h)
     }
     else
     {
-        h->ptr = Alloc(h->size);
-        Read(h);
+        if (!Map(h))
+        {
+            h->ptr = Alloc(h->size);
+            Read(h);
+        }
 
         h->prev = purgeHead.prev;
         purgeHead.prev->next = h;
@@ -840,7 +882,7 @@ void *Resource::Lock(DICTNODE *h)
             RemoveMRU(h);
         }
     }
-    else
+    else if (!Map(h))
     {
         h->ptr = Alloc(h->size);
         Read(h);
@@ -914,8 +956,10 @@ void Resource::PurgeCache(void)
         {
             dassert(pDict->lockCount == 0);
             dassert(pDict->ptr != NULL);
-            Free(pDict->ptr);
+            if (!pDict->mapped)
+                Free(pDict->ptr);
             pDict->ptr = NULL;
+            pDict->mapped = false;
             RemoveMRU(pDict);
         }
     }
@@ -66,6 +66,7 @@ struct CACHENODE
     CACHENODE *prev;
     CACHENODE *next;
     int lockCount;
+    bool mapped;  // ptr points into the archive's mapping and isn't freed
 };
 
 struct DICTNODE : CACHENODE
@@ -103,6 +104,8 @@ public:
     DICTNODE *Lookup(unsigned int id, const char *type);
     void Read(DICTNODE *n);
     void Read(DICTNODE *n, void *p);
+    char const *View(DICTNODE *n);
+    bool Map(DICTNODE *h);
     void *Load(DICTNODE *h);
     void *Load(DICTNODE *h, void *p);
     void *Lock(DICTNODE *h);
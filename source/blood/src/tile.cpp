@@ -141,15 +141,25 @@ void tileProcessGLVoxels(void)
     if (voxInit)
         return;
     voxInit = true;
+    voxloadreq_t *pReqs = (voxloadreq_t*)Xmalloc(kMaxVoxels * sizeof(voxloadreq_t));
+    DICTNODE **pNodes = (DICTNODE**)Xmalloc(kMaxVoxels * sizeof(DICTNODE*));
     for (int i = 0; i < kMaxVoxels; i++)
     {
-        DICTNODE *hVox = gSysRes.Lookup(i, "KVX");
-        if (!hVox)
+        DICTNODE *hVox = pNodes[i] = gSysRes.Lookup(i, "KVX");
+        pReqs[i] = { NULL, hVox ? (char*)gSysRes.Lock(hVox) : NULL, hVox ? (int32_t)hVox->size : 0, NULL };
+    }
+    voxloadbatch(pReqs, kMaxVoxels);
+    for (int i = 0; i < kMaxVoxels; i++)
+    {
+        if (!pNodes[i])
             continue;
-        char *pVox = (char*)gSysRes.Load(hVox);
-        voxmodels[i] = loadkvxfrombuf(pVox, hVox->size);
-        voxvboalloc(voxmodels[i]);
+        gSysRes.Unlock(pNodes[i]);
+        voxmodels[i] = pReqs[i].model;
+        if (voxmodels[i])
+            voxvboalloc(voxmodels[i]);
     }
+    Xfree(pNodes);
+    Xfree(pReqs);
 }
 #endif
 
@@ -818,6 +818,7 @@ void DragPoint(int nWall, int x, int y)
     viewInterpolateWall(nWall, &wall[nWall]);
     wall[nWall].x = x;
     wall[nWall].y = y;
+    sectorGridInvalidate(sectorofwall(nWall));
 
     int vsi = numwalls;
     int vb = nWall;
@@ -829,6 +830,7 @@ void DragPoint(int nWall, int x, int y)
             viewInterpolateWall(vb, &wall[vb]);
             wall[vb].x = x;
             wall[vb].y = y;
+            sectorGridInvalidate(sectorofwall(vb));
         }
         else
         {
@@ -841,6 +843,7 @@ void DragPoint(int nWall, int x, int y)
                     viewInterpolateWall(vb, &wall[vb]);
                     wall[vb].x = x;
                     wall[vb].y = y;
+                    sectorGridInvalidate(sectorofwall(vb));
                 }
                 else
                     break;
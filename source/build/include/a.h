@@ -148,4 +148,48 @@ void mmxoverlay();
 
 #endif	// else
 
+// SIMD versions of the C column and span kernels, see a-simd.cpp.
+// r_classicsimd caps the instruction set that classicSimdInit() may pick;
+// 0 forces the scalar code so the outputs can be compared.
+enum
+{
+    CLASSICSIMD_SCALAR,
+    CLASSICSIMD_SSE2,
+    CLASSICSIMD_SSE41,
+    CLASSICSIMD_AVX2,
+};
+
+// A null entry means that the scalar kernel is used.
+typedef struct
+{
+    // cnt pixels leftwards from p, like hlineasm4()
+    void (*hline)(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc, int32_t yinc,
+                  int32_t logx, int32_t logy, int32_t cnt);
+    // cnt rows of four adjacent columns, like vlineasm4() with logy != 0
+    void (*vline4)(char *p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc, const int32_t *vinc, int32_t logy,
+                   int32_t bpl, int32_t cnt);
+    // like vline4, skipping color 255; saturate is -1 or 0
+    void (*mvline4)(char *p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc, const int32_t *vinc, int32_t logy,
+                    int32_t bpl, int32_t cnt, int32_t saturate);
+    // cnt pixels rightwards from p skipping color 255, like mhline()
+    void (*mhline)(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc, int32_t yinc,
+                   int32_t logx, int32_t logy, int32_t cnt);
+    // like mhline, blended through trans; shift is 0 or 8
+    void (*thline)(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc, int32_t yinc,
+                   int32_t logx, int32_t logy, int32_t cnt, const char *trans, int32_t shift);
+    // cnt pixels, like slopevlin()
+    void (*slope)(char *p, intptr_t const *slopalptr, int32_t cnt, uint32_t bx, uint32_t by, int32_t bz, int32_t bzinc,
+                  int32_t x3, int32_t y3, const char *buf, int32_t pinc, int32_t logx, int32_t logy);
+    // cnt pixels downwards from p, like spritevline()
+    void (*spritevline)(char *p, const char *pal, const char *buf, int32_t bx, int32_t by, int32_t bxinc, int32_t byinc,
+                        int32_t ysiz, int32_t bpl, int32_t cnt);
+} classicsimd_t;
+
+extern int32_t r_classicsimd;
+extern int32_t classicsimdlevel;
+extern classicsimd_t classicsimd;
+
+int32_t classicSimdInit(void);
+char const *classicSimdLevelName(int32_t level);
+
 #endif // a_h_
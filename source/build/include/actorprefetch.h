@@ -0,0 +1,36 @@
+// actorprefetch.h
+//  Prepares the collision data for a game tick's actor movement on a thread pool.
+//
+// Before a game moves its actors one by one, it can hand actorPrefetchRun()
+// a list of the actors about to move and where they are expected to go. The
+// pool workers then fill the clip cache entries of those actors (see
+// clipCachePrefetch()) and build the sector visibility rows of the sectors
+// they are in (see sectorPVSPrefetchRow()), while nothing else is running.
+// Neither of these changes what clipmove(), pushmove(), getzrange() or
+// cansee() return, only how much work they have left to do, so the game
+// code that follows runs serially and in its usual order as before.
+
+#pragma once
+
+#ifndef actorprefetch_h_
+#define actorprefetch_h_
+
+#include "compat.h"
+
+#define MAXACTORPREFETCHTHREADS 32
+
+typedef struct
+{
+    vec2_t  pos;
+    vec2_t  move;      // expected clipmove() displacement in world units
+    int32_t walldist;
+    int32_t owner;     // the cache owner passed to clipmove() and friends
+    int16_t sectnum;
+} actorprefetch_t;
+
+extern int32_t actorprefetch_threads;
+
+void actorPrefetchRun(actorprefetch_t const *jobs, int32_t numjobs);
+void actorPrefetchUninit(void);
+
+#endif // actorprefetch_h_
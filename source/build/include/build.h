@@ -598,6 +598,8 @@ enum
 
 EXTERN int32_t guniqhudid;
 EXTERN int32_t spritesortcnt;
+// running count of the bunches found by the classic renderer, never reset by the engine
+EXTERN int32_t classicbunchcnt;
 extern int32_t g_loadedMapVersion;
 
 typedef struct {
@@ -1256,6 +1258,12 @@ void    artClearMapArt(void);
 void    artSetupMapArt(const char *filename);
 bool    tileLoad(int16_t tilenume);
 void    tileLoadData(int16_t tilenume, int32_t dasiz, char *buffer);
+// the part of tileLoad() that comes after the data is in waloff[tilenume]
+void    tileLoadFinish(int16_t tilenume);
+// where the data of tilenume sits in a memory-mapped view of its ART file, or
+// NULL if only tileLoadData() can get it; valid until artReleaseViews()
+char const *tileGetArtView(int16_t tilenume);
+void    artReleaseViews(void);
 intptr_t tileLoadScaled(int const picnum, vec2_16_t* upscale = nullptr);
 int32_t tileGetCRC32(int16_t tileNum);
 vec2_16_t tileGetSize(int16_t tileNum);
@@ -1269,6 +1277,7 @@ void   tileCopySection(int32_t tilenume1, int32_t sx1, int32_t sy1, int32_t xsiz
 void   squarerotatetile(int16_t tilenume);
 
 int32_t   videoSetGameMode(char davidoption, int32_t daupscaledxdim, int32_t daupscaledydim, int32_t dabpp, int32_t daupscalefactor);
+void   videoSetHeadlessMode(char *buf, int32_t xsiz, int32_t ysiz);
 void   videoNextPage(void);
 void   videoSetCorrectedAspect();
 void   videoSetViewableArea(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
@@ -1351,10 +1360,12 @@ static FORCE_INLINE void rotatesprite_win(int32_t sx, int32_t sy, int32_t z, int
 }
 
 void   getzrange(const vec3_t *pos, int16_t sectnum, int32_t *ceilz, int32_t *ceilhit, int32_t *florz,
-                 int32_t *florhit, int32_t walldist, uint32_t cliptype) ATTRIBUTE((nonnull(1,3,4,5,6)));
+                 int32_t *florhit, int32_t walldist, uint32_t cliptype, int32_t cacheowner = -1) ATTRIBUTE((nonnull(1,3,4,5,6)));
 extern vec2_t hitscangoal;
 int32_t   hitscan(const vec3_t *sv, int16_t sectnum, int32_t vx, int32_t vy, int32_t vz,
                   hitdata_t *hitinfo, uint32_t cliptype) ATTRIBUTE((nonnull(1,6)));
+int32_t   hitscan_batch(const vec3_t *sv, int16_t sectnum, int32_t numrays, const vec3_t *vec,
+                        hitdata_t *hitinfo, uint32_t cliptype) ATTRIBUTE((nonnull(1,4,5)));
 void   neartag(int32_t xs, int32_t ys, int32_t zs, int16_t sectnum, int16_t ange,
                int16_t *neartagsector, int16_t *neartagwall, int16_t *neartagsprite,
                int32_t *neartaghitdist, int32_t neartagrange, uint8_t tagsearch,
@@ -1365,6 +1376,7 @@ int32_t   inside(int32_t x, int32_t y, int16_t sectnum);
 void   calc_sector_reachability(void);
 int    sectorsareconnected(int const, int const);
 void   dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags);
+void   sectorGridInvalidate(int sectnum);
 void   setfirstwall(int16_t sectnum, int16_t newfirstwall);
 int32_t try_facespr_intersect(uspriteptr_t const spr, vec3_t const in,
                                      int32_t vx, int32_t vy, int32_t vz,
@@ -21,6 +21,9 @@ struct cpuinfo_t
     struct
     {
         int invariant_tsc : 1;
+        int sse2 : 1;
+        int sse41 : 1;
+        int avx2 : 1;
     } features;
 };
 
@@ -20,6 +20,12 @@ typedef struct
     intptr_t *hand;
     int32_t   leng;
     int32_t   ovh;
+
+    int32_t offset;        // from the start of the cache
+    int32_t prev, next;    // neighbors in address order, -1 at either end
+    int32_t fprev, fnext;  // neighbors in the free list of its size class while free
+    int32_t heappos;       // position in the eviction heap while allocated
+    int32_t cost;          // of evicting the block, as of when it was last looked at
 } cacheindex_t;
 
 enum cachelock_t : char
@@ -30,6 +36,23 @@ enum cachelock_t : char
     CACHE1D_PERMANENT = 255,
 };
 
+#define CACHE1D_SIZECLASSES 32
+
+typedef struct
+{
+    uint32_t allocs;      // requests served by allocateBlock()
+    uint32_t freeHits;    // ...from a free block, without evicting anything
+    uint32_t evictHits;   // ...by evicting one of the cheapest blocks in the heap
+    uint32_t scanMisses;  // ...only by scanning the whole cache for the cheapest window, like before
+    uint32_t evictions;   // blocks whose handle was cleared
+    uint64_t evictedBytes;
+} cachestats_t;
+
+// Blocks that are free sit in segregated free lists, one for each power of two of their size, and the
+// ones that are allocated in a binary heap ordered by the cost of evicting them. The cost is the same
+// weighting of lock byte and size findBlock() uses. Since the lock bytes belong to the users of the
+// cache and change behind its back, a key is only trusted after checking it against the lock byte.
+
 class cache1d
 {
 public:
@@ -39,16 +62,35 @@ public:
 
     void    ageBlocks(void);
     int32_t findBlock(int32_t const newbytes, int32_t * const besto, int32_t * const bestz);
-    void    report(void);
+    void    report(bool const listBlocks = true);
     void    reset(void);
 
     int numBlocks(void) { return m_numBlocks; }
     cacheindex_t const * getIndex(void) { return m_index; }
+    cachestats_t const & getStats(void) { return m_stats; }
 
 private:
-    void inc_and_check_cacnum(void);
+    int  newBlock(void);
+    int  deleteBlock(int const block, int const keep);
+
+    void linkFree(int const block);
+    void unlinkFree(int const block);
+    int  findFree(int32_t const newbytes);
+
+    void heapPush(int const block);
+    void heapRemove(int const block);
+    void heapUpdate(int const block);
+    void heapSiftUp(int pos);
+    void heapSiftDown(int pos);
+    void heapRebuild(void);
+
+    int  evictBlock(int block);
+    int  evictToFit(int32_t const newbytes);
+    int  takeWindow(int32_t const newbytes, int const first);
+    void placeBlock(int const block, intptr_t *newhandle, int32_t const newbytes, char *newlockptr, int32_t const askedbytes);
 
     cacheindex_t *m_index{};
+    int32_t      *m_heap{};
 
     intptr_t m_baseAddress{};
     int32_t  m_totalSize{};
@@ -56,6 +98,13 @@ private:
 
     int m_maxBlocks{};
     int m_numBlocks{};
+    int m_firstBlock{};
+    int m_heapSize{};
+
+    int32_t  m_freeList[CACHE1D_SIZECLASSES]{};
+    uint32_t m_freeClasses{};
+
+    cachestats_t m_stats{};
 };
 
 extern cache1d g_cache;
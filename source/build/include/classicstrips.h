@@ -0,0 +1,53 @@
+// classicstrips.h
+//  Splits the pixel fill of the classic renderer across a thread pool.
+//
+// While renderDrawRoomsQ16() is running with r_classicthreads > 1, the column
+// and span kernels (vlineasm1/vlineasm4/hlineasm4/slopevlin and the
+// floating-point slope columns) don't touch the frame buffer. Instead, they
+// record what they would have drawn. classicStripsFlush() then splits the
+// recorded list into one list per vertical strip of the screen, clipping the
+// commands that cross strip boundaries, and every strip is replayed by its
+// own worker. Each pixel still receives its writes in the original order, so
+// the result is identical to the single-threaded path.
+
+#pragma once
+
+#ifndef classicstrips_h_
+#define classicstrips_h_
+
+#include "compat.h"
+
+#define MAXCLASSICTHREADS 32
+
+extern int32_t r_classicthreads;
+extern int32_t classicstrips_active;
+
+// Floating-point slope column, see fgrouscan().
+typedef struct
+{
+    intptr_t buf, trans;
+    float bz, bzinc, x3, y3;
+    int32_t x1, y1, pinc;
+    int16_t mode;
+    int8_t logx, logy;
+} fslopecol_t;
+
+void classicFSlopeColumn(fslopecol_t const &col, uint8_t *p, intptr_t const *slopalptr, int32_t cnt);
+
+void classicStripsBegin(intptr_t frameplace, int32_t bytesperline, int32_t xdim);
+void classicStripsFlush(void);
+void classicStripsEnd(void);
+void classicStripsUninit(void);
+
+uint32_t classicStripsVline(int32_t vinc, intptr_t pal, int32_t cnt, uint32_t vplc, intptr_t buf, intptr_t p,
+                            int32_t logy, int32_t tilesizy);
+void classicStripsVline4(int32_t cnt, intptr_t p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc,
+                         int32_t const *vinc, int32_t logy, int32_t tilesizy);
+void classicStripsHline(int32_t cnt, intptr_t pal, uint32_t by, uint32_t bx, intptr_t p, intptr_t buf,
+                        int32_t xinc, int32_t yinc, int32_t logx, int32_t logy);
+void classicStripsSlopevlin(intptr_t p, intptr_t const *slopalptr, int32_t cnt, int32_t bx, int32_t by,
+                            int32_t bz, int32_t bzinc, int32_t x3, int32_t y3, intptr_t buf, int32_t pinc,
+                            int32_t logx, int32_t logy);
+void classicStripsFSlope(fslopecol_t const &col, intptr_t p, intptr_t const *slopalptr, int32_t cnt);
+
+#endif // classicstrips_h_
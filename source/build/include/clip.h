@@ -17,6 +17,7 @@ extern "C" {
 
 #define MAXCLIPSECTORS 512
 #define MAXCLIPNUM 4096
+#define MAXHITSCANBATCH 64  // rays hitscan_batch() traces together
 #define CLIPCURBHEIGHT (1<<8)
 #ifdef HAVE_CLIPSHAPE_FEATURE
 
@@ -78,12 +79,27 @@ int clipinsidebox(vec2_t const vect, int const wallnum, int const walldist);
 
 extern int32_t clipmoveboxtracenum;
 
+// Callers that move the same sprite every tick can pass its number as
+// cacheowner to let clipmove() and pushmove() reuse the wall lists they
+// gathered for it last time. The results are the same either way, which
+// clipcache_check verifies by repeating every such call without the cache.
+#define CLIPCACHESIZE 512  // owners share entries modulo this, must be a power of 2
+
+extern int32_t clipcache_enabled;
+extern int32_t clipcache_check;
+void clipCacheInvalidate(int sectnum);
+
+// Fills the cache entry of owner ahead of a move by move.x, move.y from pos
+// in sectnum. Calls for owners that don't share an entry can run at the same
+// time, as long as nothing changes the map meanwhile.
+void clipCachePrefetch(int32_t owner, int sectnum, vec2_t pos, vec2_t move, int32_t walldist);
+
 int32_t clipmove(vec3_t *const pos, int16_t *const sectnum, int32_t xvect, int32_t yvect, int32_t const walldist, int32_t const ceildist,
-                 int32_t const flordist, uint32_t const cliptype) ATTRIBUTE((nonnull(1, 2)));
+                 int32_t const flordist, uint32_t const cliptype, int32_t const cacheowner = -1) ATTRIBUTE((nonnull(1, 2)));
 int32_t clipmovex(vec3_t *const pos, int16_t *const sectnum, int32_t xvect, int32_t yvect, int32_t const walldist, int32_t const ceildist,
                   int32_t const flordist, uint32_t const cliptype, uint8_t const noslidep) ATTRIBUTE((nonnull(1, 2)));
 int pushmove(vec3_t *const vect, int16_t *const sectnum, int32_t const walldist, int32_t const ceildist, int32_t const flordist,
-                 uint32_t const cliptype, bool clear = true) ATTRIBUTE((nonnull(1, 2)));
+                 uint32_t const cliptype, bool clear = true, int32_t const cacheowner = -1) ATTRIBUTE((nonnull(1, 2)));
 
 #ifdef __cplusplus
 }
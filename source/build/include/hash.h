@@ -1,58 +1,44 @@
-
 #pragma once
 
 #ifndef hash_h_
 #define hash_h_
 
-#include "libdivide.h"
-
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 // Hash functions
-#define DJB_MAGIC 5381u
+// open addressing with linear probing and backward shift deletion, so that no tombstones are left behind
 
-typedef struct hashitem  // size is 12/24 bytes.
+typedef struct hashitem  // size is 12/16 bytes.
 {
-    char *string;
     intptr_t key;
-    struct hashitem *next;
+    uint32_t code;
+    uint32_t string;  // offset of the key in the arena, 0 signifies an empty slot
 } hashitem_t;
 
-typedef struct  
+typedef struct
 {
-    uint32_t v;
-    libdivide::libdivide_u32_t d;
-} hashprime_t;
+    uint32_t size;  // number of keys the table is sized for by hash_init(), it grows beyond that as needed
+    uint32_t mask, count;
+
+    // the keys are interned here one after the other, deleted ones are dropped when the arena is compacted
+    uint32_t arenalen, arenasiz, arenadead;
+    char    *arena;
+} hashstate_t;
 
 typedef struct
 {
     union
     {
         uint32_t    size;
-        hashprime_t prime;
+        hashstate_t state;
     };
-    hashitem_t **items;
+    hashitem_t *items;
 } hashtable_t;
 
-// djb3 algorithm
-static inline uint32_t hash_getcode(const char *s)
-{
-    uint32_t h = DJB_MAGIC;
-    char ch;
-
-    while ((ch = Btolower(*s++)) != '\0')
-        h = ((h << 5) + h) ^ ch;
-
-    return h;
-}
-
-static FORCE_INLINE uint32_t hash_getbucket(hashtable_t const *t, const char *s)
-{
-    uint32_t const h = hash_getcode(s);
-    return h - libdivide::libdivide_u32_do(h, &t->prime.d) * t->prime.v;
-}
+// case-insensitive, so that hash_findcase() probes the same slots as hash_find()
+uint32_t hash_getcode(const char *s);
 
 void hash_init(hashtable_t *t);
 void hash_loop(hashtable_t *t, void (*func)(const char *, intptr_t));
@@ -64,41 +50,37 @@ intptr_t hash_findcase(hashtable_t const *t, char const *s);
 intptr_t hash_find(hashtable_t const *t, char const *s);
 
 // Hash functions
-// modified for raw binary keys and one big allocation, and maximum find() performance
+// modified for raw binary keys, and maximum find() performance
+
+#define INTHASH_EMPTY INTPTR_MIN
 
 typedef struct inthashitem
 {
-    intptr_t key;
+    intptr_t key;  // INTHASH_EMPTY signifies an empty slot
     intptr_t value;
-    struct inthashitem *collision; // use NULL to signify empty and pointer identity to signify end of linked list
 } inthashitem_t;
 
+typedef struct
+{
+    uint32_t count;  // number of slots requested from inthash_init(), see INTHASH_SIZE
+    uint32_t mask, numkeys;
+
+    // the one key that can't be stored in a slot
+    int32_t  hasemptykey;
+    intptr_t emptyvalue;
+} inthashstate_t;
+
 typedef struct
 {
     inthashitem_t *items;
     union
     {
-        uint32_t    count;
-        hashprime_t prime;
+        uint32_t       count;
+        inthashstate_t state;
     };
 } inthashtable_t;
 
-// djb3 algorithm
-static inline uint32_t inthash_getcode(intptr_t key)
-{
-    uint32_t h = DJB_MAGIC;
-
-    for (auto keybuf = (uint8_t const *) &key, keybuf_end = keybuf + sizeof(key); keybuf < keybuf_end; ++keybuf)
-        h = ((h << 5) + h) ^ (uint32_t) *keybuf;
-
-    return h;
-}
-
-static FORCE_INLINE uint32_t inthash_getbucket(inthashtable_t const *t, intptr_t key)
-{
-    uint32_t const h = inthash_getcode(key);
-    return h - libdivide::libdivide_u32_do(h, &t->prime.d) * t->prime.v;
-}
+uint32_t inthash_getcode(intptr_t key);
 
 void inthash_init(inthashtable_t *t);
 void inthash_loop(inthashtable_t const *t, void (*func)(intptr_t, intptr_t));
@@ -108,8 +90,7 @@ void inthash_delete(inthashtable_t *t, intptr_t key);
 
 intptr_t inthash_find(inthashtable_t const *t, intptr_t key);
 
-// keep the load factor below 0.75 and make sure the size is odd
-// ideally we would find the next largest prime number
+// keep the load factor below 0.75
 #define INTHASH_SIZE(size) ((size * 4u / 3u) | 1u)
 
 #ifdef __cplusplus
@@ -4,6 +4,7 @@
 #include "build.h"
 #include "palette.h"
 #include "vec.h"
+#include "texcachefmt.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,22 +40,6 @@ extern polytint_t hictinting[MAXPALOOKUPS];
 extern hicreplctyp *hicreplc[MAXTILES];
 extern int32_t hicinitcounter;
 
-typedef struct texcachehead_t
-{
-    char magic[4];	// 'PMST', was 'Polymost'
-    int xdim, ydim;	// of image, unpadded
-    int flags;		// 1 = !2^x, 2 = has alpha, 4 = lzw compressed
-    int quality;    // r_downsize at the time the cache was written
-} texcacheheader;
-
-typedef struct texcachepic_t
-{
-    int size;
-    int format;
-    int xdim, ydim;	// of mipmap (possibly padded)
-    int border, depth;
-} texcachepicture;
-
 hicreplctyp * hicfindsubst(int picnum, int palnum, int nozero = 0);
 hicreplctyp * hicfindskybox(int picnum, int palnum, int nozero = 0);
 void hictinting_applypixcolor(coltype* tcol, uint8_t pal, bool no_rb_swap);
@@ -105,17 +90,6 @@ static inline void globaltinting_apply_ub(uint8_t *color)
     color[2] = (uint8_t)(color[2] * (float)globalb * (1.f/255.f));
 }
 
-// texcacheheader cachead.flags bits
-enum
-{
-    CACHEAD_NONPOW2 = 1,
-    CACHEAD_HASALPHA = 2,
-    CACHEAD_COMPRESSED = 4,
-    CACHEAD_NODOWNSIZE = 8,
-    CACHEAD_HASFULLBRIGHT = 16,
-    CACHEAD_NPOTWALL = 32,
-};
-
 // hicreplctyp hicr->flags bits
 enum
 {
@@ -34,12 +34,38 @@ extern void kpzload (const char *, intptr_t *, int32_t *, int32_t *);
 extern void kpgetdim (const char *, int32_t, int32_t *, int32_t *);
 extern int32_t kprender (const char *, int32_t, intptr_t, int32_t, int32_t, int32_t);
 
+	//SIMD versions of the PNG unfilter, JPEG IDCT and color conversion inner loops, see kplib-simd.cpp:
+enum
+{
+    KPLIBSIMD_SCALAR,
+    KPLIBSIMD_SSE2,
+    KPLIBSIMD_AVX2,
+};
+
+typedef struct
+{
+    // PNG filter types 0-4: unfilters up to len bytes of a row from src, storing them downwards from dst
+    // like putbuf() and updating the left/up-left pixels of filter types 1, 3 and 4. Called at a pixel
+    // boundary, returns the number of bytes done; the rest is left to the scalar code.
+    int32_t (*unfilter[5])(uint8_t *dst, uint8_t const *src, int32_t len, int32_t bpp, uint8_t *left, uint8_t *upleft);
+    // like invdct8x8() with all rows present
+    void (*idct)(int32_t *dc);
+    // one row of 8 pixels of yrbrend(), hsamp 1 or 2
+    void (*ycbcr)(int32_t *dst, int32_t const *y, int32_t const *cbcr, int32_t hsamp);
+} kplibsimd_t;
+
+extern kplibsimd_t kplibsimd;
+
+// Picks the best kernels the CPU supports up to maxlevel and returns the level.
+extern int32_t kplibSimdInit(int32_t maxlevel);
+
 	//ZIP functions:
 extern int32_t kzaddstack (const char *);
 extern void kzuninit ();
 extern intptr_t kzopen (const char *);
 extern int32_t kzread (void *, int32_t);
 extern int32_t kzseek (int32_t, int32_t);
+extern char const *kzstoredin (void); //ZIP/GRP the open file is stored in uncompressed (at kzfs.seek0), or NULL
 
 static inline int32_t kztell(void) { return kzfs.fil ? kzfs.pos : -1; }
 static inline int32_t kzeof(void) { return kzfs.fil ? kzfs.pos >= kzfs.leng : -1; }
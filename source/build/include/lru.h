@@ -43,6 +43,10 @@ private:
     int m_tail;
     int m_count;
 
+    // Only queues of pointers can own their items.
+    template <typename U> static void freeItem(U * & item) { DO_FREE_AND_NULL(item); }
+    template <typename U> static void freeItem(U &) { }
+
 public:
     CircularQueue() { m_items = (T *)mi_calloc(Capacity, sizeof(T)); clear(); }
     ~CircularQueue() { mi_free(m_items); }
@@ -55,7 +59,7 @@ public:
 
         if (ResetItems & RF_FREE)
             for (int i = 0; i < Capacity; i++)
-                DO_FREE_AND_NULL(m_items[i]);
+                freeItem(m_items[i]);
 
         if (ResetItems & RF_INIT)
             for (int i = 0; i < Capacity; i++)
@@ -66,12 +70,12 @@ public:
     {
         if (m_head == (Capacity - 1))
             m_head = -1;
-        else if (m_count < Capacity)
+        if (m_count < Capacity)
             ++m_count;
         if ((++m_head == m_tail) | (m_tail == -1))
         {
             if ((m_tail != -1) & ((ResetItems & RF_FREE) == RF_FREE))
-                Xfree(m_items[m_tail]);
+                freeItem(m_items[m_tail]);
             m_tail = (m_tail + 1) % Capacity;
         }
         m_items[m_head] = item;
@@ -82,7 +86,7 @@ public:
         Bassert(!isEmpty());
 
         if (ResetItems & RF_FREE)
-            Xfree(m_items[m_tail]);
+            freeItem(m_items[m_tail]);
 
         if (ResetItems & RF_INIT)
             m_items[m_tail] = T {};
@@ -124,6 +128,13 @@ public:
 // is removed to make room for the new insertion, which
 // becomes the MRU item. The cache uses a hash-table and
 // a circular queue under the hood.
+//
+// Every access pushes the key again, so the queue may hold
+// several references to one item. Each reference carries
+// the access count it was pushed with and only the newest
+// one is live. The queue has room for two references per
+// item and is compacted down to the live ones when it fills
+// up, so no item ever loses its place in the queue.
 template <typename K,      // Key type
           typename V,      // Value type
           int CacheSize,   // Size of the cache in items
@@ -132,8 +143,48 @@ template <typename K,      // Key type
 class LruCache final
 {
 private:
-    std::unordered_map<K, V>    m_cache; // Size capped to CacheSize
-    CircularQueue<K, CacheSize> m_lruQ;  // back=MRU, front=LRU
+    struct Item
+    {
+        V        value;
+        uint32_t stamp;
+    };
+    using Ref = std::pair<K, uint32_t>;
+
+    std::unordered_map<K, Item>        m_cache; // Size capped to CacheSize
+    CircularQueue<Ref, CacheSize * 2>  m_lruQ;  // back=MRU, front=LRU
+    uint32_t                           m_stamp = 0;
+
+    bool isLive(const Ref & ref) const
+    {
+        auto iter = m_cache.find(ref.first);
+        return iter != m_cache.end() && iter->second.stamp == ref.second;
+    }
+
+    void pushRef(const K & key, Item & item)
+    {
+        if (m_lruQ.isFull())
+        {
+            for (int i = m_lruQ.size(); i > 0; --i)
+            {
+                Ref const ref = m_lruQ.front();
+                m_lruQ.popFront();
+                if (isLive(ref))
+                    m_lruQ.pushBack(ref);
+            }
+            Bassert(!m_lruQ.isFull());
+        }
+
+        item.stamp = ++m_stamp;
+        m_lruQ.pushBack({ key, item.stamp });
+    }
+
+    // Drops the stale references at the front of the queue,
+    // leaving the live reference to the LRU item there.
+    void trimFront()
+    {
+        while (!isLive(m_lruQ.front()))
+            m_lruQ.popFront();
+    }
 
 public:
     using Pair = std::pair<K, V>;
@@ -144,43 +195,46 @@ public:
         auto iter = m_cache.find(key);
         if (iter == m_cache.end())
             return nullptr;
-        m_lruQ.pushBack(iter->first);
-        return &iter->second;
+        pushRef(iter->first, iter->second);
+        return &iter->second.value;
+    }
+
+    // Like access(), but leaves the item's place in the queue alone.
+    V * peek(const K & key)
+    {
+        auto iter = m_cache.find(key);
+        return iter == m_cache.end() ? nullptr : &iter->second.value;
     }
 
     bool insert(const K & key, const V & value, Pair * outOptEvictedEntry = nullptr)
     {
-        Bassert(access(key) == nullptr); // No duplicate keys
+        Bassert(peek(key) == nullptr); // No duplicate keys
 
-        bool entryEvicted = false;
-        if (m_cache.size() == CacheSize)
-        {
-            // Make room for a new item by removing the oldest cached.
-            // Need to call in a loop because the LRU queue might have
-            // multiple references to the same item, which might have
-            // already been removed from the cache by a previous insert.
-            for (;;)
-            {
-                auto iter = m_cache.find(m_lruQ.front());
-                m_lruQ.popFront();
+        bool const entryEvicted = (m_cache.size() == CacheSize) && popLru(outOptEvictedEntry);
 
-                if (iter != m_cache.end())
-                {
-                    if (outOptEvictedEntry)
-                        *outOptEvictedEntry = *iter;
-                    m_cache.erase(iter);
-                    entryEvicted = true;
-                    break;
-                }
-            }
-            Bassert(m_cache.size() == CacheSize - 1);
-        }
-
-        m_cache.insert({ key, value });
-        m_lruQ.pushBack(key);
+        auto iter = m_cache.insert({ key, Item { value, 0 } }).first;
+        pushRef(iter->first, iter->second);
         return entryEvicted;
     }
 
+    // Removes the LRU item, for caches that are limited by
+    // something other than the number of items they hold.
+    bool popLru(Pair * outOptEvictedEntry = nullptr)
+    {
+        if (isEmpty())
+            return false;
+
+        trimFront();
+
+        auto iter = m_cache.find(m_lruQ.front().first);
+        m_lruQ.popFront();
+
+        if (outOptEvictedEntry)
+            *outOptEvictedEntry = { iter->first, iter->second.value };
+        m_cache.erase(iter);
+        return true;
+    }
+
     void clear()
     {
         m_cache.clear();
@@ -197,20 +251,23 @@ public:
     Pair mru() const
     {
         Bassert(!isEmpty());
-        return *m_cache.find(m_lruQ.back());
+        auto iter = m_cache.find(m_lruQ.back().first);
+        return { iter->first, iter->second.value };
     }
 
-    Pair lru() const
+    Pair lru()
     {
         Bassert(!isEmpty());
-        return *m_cache.find(m_lruQ.front());
+        trimFront();
+        auto iter = m_cache.find(m_lruQ.front().first);
+        return { iter->first, iter->second.value };
     }
 
     int copyContents(std::array<Pair, CacheSize> & dest) const
     {
         int n = 0;
-        for (const Pair & p : m_cache)
-            dest[n++] = p;
+        for (auto const & p : m_cache)
+            dest[n++] = { p.first, p.second.value };
         return n;
     }
 };
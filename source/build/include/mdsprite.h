@@ -232,7 +232,26 @@ void voxvboalloc(voxmodel_t *vm);
 void voxvbofree(voxmodel_t *vm);
 #endif
 
+#define MAXVOXELTHREADS 8
+
+// A model for voxloadbatch() to load: the file filename, or the KVX file of len
+// bytes at buf if filename is NULL. model is NULL afterwards if it couldn't be.
+typedef struct
+{
+    const char *filename;
+    const char *buf;
+    int32_t len;
+    voxmodel_t *model;
+} voxloadreq_t;
+
+extern int32_t r_voxelgreedymesh;
+extern int32_t r_voxelthreads;
+
 void voxfree(voxmodel_t *m);
+// Loads the models from the texture cache where it can, and meshes the others
+// r_voxelthreads at a time before adding them to the cache.
+void voxloadbatch(voxloadreq_t *reqs, int32_t num);
+void voxfreepool(void);
 voxmodel_t *voxload(const char *filnam);
 voxmodel_t *loadkvxfrombuf(const char *buffer, int32_t length);
 int32_t polymost_voxdraw(voxmodel_t *m, tspriteptr_t const tspr);
@@ -0,0 +1,30 @@
+// sectorgrid.h
+//  Uniform grid of sector bounding boxes for point-in-sector queries.
+//
+// The grid is built when a map is loaded. Each cell lists, in ascending
+// order, the sectors whose bounding box overlaps it, so the linear scans in
+// updatesector*() only need to run inside() on a handful of candidates.
+//
+// dragpoint() and the games' own wall movers report moved walls through
+// sectorGridInvalidate(). A sector that grows past the cells it was filed
+// under is kept on a short list of outliers that is checked by every query
+// until the grid is rebuilt.
+
+#pragma once
+
+#ifndef sectorgrid_h_
+#define sectorgrid_h_
+
+#include "compat.h"
+
+extern int32_t sectorgrid_enabled;
+extern int32_t sectorgrid_check;
+
+void sectorGridBuild(void);
+void sectorGridUninit(void);
+
+// Returns the sectors whose bounding box contains (x, y) in ascending order,
+// or NULL if the grid is disabled.
+int16_t const *sectorGridQuery(int32_t x, int32_t y, int32_t *numcandidates);
+
+#endif // sectorgrid_h_
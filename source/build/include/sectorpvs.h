@@ -0,0 +1,54 @@
+// sectorpvs.h
+//  Conservative sector-to-sector visibility for cansee().
+//
+// A sector can only see another if some straight line passes through a
+// chain of red walls leading from one to the other, crossing each of them
+// from the front. The rows of the table are found lazily, one source sector
+// at a time, by walking those chains and keeping track of the directions a
+// line through all of their walls could have. Heights, masked walls and
+// sprites are ignored, so the table only ever says "maybe".
+//
+// A row stays valid until the walls of one of the sectors in it move, which
+// is reported through sectorGridInvalidate(). Maps with TROR don't use the
+// table.
+
+#pragma once
+
+#ifndef sectorpvs_h_
+#define sectorpvs_h_
+
+#include "compat.h"
+
+typedef struct
+{
+    uint32_t tests;       // cansee() calls that consulted the table
+    uint32_t rejected;    // ... and were answered without walking any walls
+    uint32_t unchecked;   // cansee() calls too long for the table to vouch for
+    uint32_t rowsbuilt;
+    uint32_t rowsgivenup; // rows with too many chains, marked as seeing everything
+} sectorpvsstats_t;
+
+extern int32_t sectorpvs_enabled;
+extern int32_t sectorpvs_check;
+extern sectorpvsstats_t sectorpvs_stats;
+
+void sectorPVSBuild(void);
+void sectorPVSUninit(void);
+void sectorPVSInvalidate(int sectnum);
+
+// Sets the table up for the current map if needed. Returns 0 if cansee()
+// doesn't use it.
+int sectorPVSReady(void);
+
+// Builds the row of sectnum ahead of the cansee() calls that would need it,
+// after sectorPVSReady() returned nonzero. Rows of different sectors can be
+// built at the same time by different workers, see actorprefetch.h. Returns
+// 0 if the row was there already, 1 if it was built and 2 if it was given up
+// on.
+int sectorPVSPrefetchRow(int sectnum, int worker);
+
+// Returns nonzero if no line from (x1, y1) in sect1 to (x2, y2) can reach
+// sect2 according to cansee()'s wall crossing rules.
+int sectorPVSRejects(int32_t x1, int32_t y1, int sect1, int32_t x2, int32_t y2, int sect2);
+
+#endif // sectorpvs_h_
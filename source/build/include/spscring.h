@@ -0,0 +1,70 @@
+#include "compat.h"
+#ifndef spscring_h__
+#define spscring_h__
+
+// ------------------------------------------------------------------
+// SPSCRing:
+// ------------------------------------------------------------------
+
+// Bounded, lock-free FIFO with exactly one producer and one consumer.
+// Neither side ever waits for the other: push() fails when the ring
+// is full and pop() fails when it is empty. Several producers (or
+// consumers) can share a ring as long as they serialise among
+// themselves, which never involves the other side.
+template<typename T, uint32_t Capacity>
+class SPSCRing final
+{
+    static_assert(isPow2(Capacity), "SPSCRing capacity must be a power of two");
+
+public:
+
+    SPSCRing()
+        : m_head{ 0 }
+        , m_tail{ 0 }
+    { }
+
+    // Producer side.
+    FORCE_INLINE bool push(T const & item)
+    {
+        uint32_t const tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    FORCE_INLINE bool pop(T & item)
+    {
+        uint32_t const head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only exact when called from the consumer, or with both sides stopped.
+    FORCE_INLINE uint32_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+    FORCE_INLINE bool isEmpty() const { return size() == 0; }
+
+    // Not copyable.
+    SPSCRing(const SPSCRing &) = delete;
+    SPSCRing & operator = (const SPSCRing &) = delete;
+
+private:
+
+    // the indices only ever count up, the wrap to zero is harmless as Capacity divides 2^32
+    alignas(64) std::atomic<uint32_t> m_head;
+    alignas(64) std::atomic<uint32_t> m_tail;
+    alignas(64) T m_items[Capacity];
+};
+#endif // spscring_h__
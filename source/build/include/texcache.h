@@ -13,9 +13,8 @@ extern "C" {
 
 #ifdef USE_OPENGL
 
-#define TEXCACHEMAGIC "LZ41"
 #define GLTEXCACHEADSIZ 8192
-#define TEXCACHEHASHSIZE 1024
+#define MAXTEXCACHETHREADS 8
 
 enum texcacherr_t
 {
@@ -28,13 +27,11 @@ enum texcacherr_t
     TEXCACHEERRORS
 };
 
-typedef struct texcacheitem_
+typedef struct
 {
-    char    *name;
-    int32_t offset;
-    int32_t len;
-
-    struct texcacheitem_ *next;
+    uint64_t key;
+    int32_t  offset;
+    int32_t  len;  // 0 for a free slot
 } texcacheindex;
 
 typedef struct {
@@ -42,16 +39,13 @@ typedef struct {
     buildvfs_FILE  indexFilePtr;
     buildvfs_FILE  dataFilePtr;
 
-    texcacheindex * first;
-    texcacheindex * current;
-    texcacheindex **entries;
+    // open addressing on the key with linear probing, indexsiz is a power of two
+    texcacheindex *index;
+    int32_t indexsiz;
 
     pthtyp *list[GLTEXCACHEADSIZ];
 
-    hashtable_t hashes;
-
     int32_t numentries;
-    int32_t entrybufsiz;
     bsize_t dataFilePos;
 } globaltexcache;
 
@@ -59,26 +53,32 @@ extern globaltexcache texcache;
 
 extern char TEXCACHEFILE[BMAX_PATH];
 
+extern int32_t texcache_threads;
+
 extern int32_t texcache_enabled(void);
 extern void texcache_freeptrs(void);
 extern void texcache_syncmemcache(void);
 extern void texcache_init(void);
 int texcache_loadoffsets(void);
 int texcache_readdata(void *outBuf, int32_t len);
+texcacheindex const *texcache_findentry(char const *cacheid);
 extern pthtyp *texcache_fetch(int32_t dapicnum, int32_t dapalnum, int32_t dashade, int32_t dameth);
 extern int32_t texcache_loadskin(const texcacheheader *head, int32_t *doalloc, GLuint *glpic, vec2_t *siz);
 extern int32_t texcache_loadtile(const texcacheheader *head, int32_t *doalloc, pthtyp *pth);
 extern char const * texcache_calcid(char *outbuf, const char *filename, int32_t len, int32_t dameth, char effect);
 extern void texcache_prewritetex(texcacheheader *head);
 void texcache_postwritetex(char const * cacheid, int32_t offset);
+int32_t texcache_writechunk(void const *buf, int32_t len);
 extern void texcache_writetex_fromdriver(char const * cacheid, texcacheheader *head);
 extern int texcache_readtexheader(char const * cacheid, texcacheheader *head, int32_t modelp);
 extern void texcache_openfiles(void);
 extern void texcache_setupmemcache(void);
 extern void texcache_checkgarbage(void);
 extern void texcache_setupindex(void);
+extern void texcache_freepool(void);
 
-extern voxmodel_t* voxcache_fetchvoxmodel(const char* const cacheid);
+// Sets *damaged if the entry of cacheid exists but can't be used.
+extern voxmodel_t* voxcache_fetchvoxmodel(const char* const cacheid, int32_t* const damaged);
 extern void voxcache_writevoxmodel(const char* const cacheid, voxmodel_t* vm);
 
 #endif
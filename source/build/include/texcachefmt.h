@@ -0,0 +1,168 @@
+// texcachefmt.h
+//  On-disk layout of the texture cache, shared by the engine and texcachetool.
+//
+// The cache is a data file, "texturecache", that entries are only ever
+// appended to, and an index saying where the current entry for each cache id
+// is. Everything is stored little-endian.
+//
+// The index, "texturecache.index2":
+//   char    magic[4]         "TCI2"
+//   int32_t numsorted
+//   texcacheindexrec[numsorted], sorted by key
+//   texcacheindexrec[...], one for every entry written since, later ones winning
+// The key is the number texcache_calcid() prints as the cache id. When the
+// engine loads an index with records after the sorted ones, it writes it
+// back out sorted. The text index of older versions, "texturecache.index",
+// has a "<cache id> <offset> <length>" line for each entry, and is converted
+// to an index2 when there isn't one yet.
+//
+// Texture entries begin with a texcacheheader. In "LZ41" entries it is
+// followed by each mip level's texcachepicture and chunks in turn, so that
+// the levels can only be found by going through the ones before them. In
+// "LZ42" entries it is followed by an int32_t level count and a table of
+// texcachemip records giving every chunk's position in the entry, and then
+// by the chunks themselves. The chunks are the fields of the DXT blocks of
+// the level stored separately, see dxtfilter.cpp: the alpha field for DXT3
+// and DXT5 only, the two colors and the indices. Each is LZ4 compressed if
+// the entry has CACHEAD_COMPRESSED set and that made it smaller, and stored
+// as is otherwise. LZ41 chunks are preceded by their length.
+//
+// Voxel model entries begin with "VOX2", followed by the sizes of the model
+// and its LZ4 compressed vertices, indices and skin, see voxcachedat_t in
+// texcache.cpp. Their cache ids come from the contents of the voxel file.
+// Entries without any of these magics are voxel models of older versions.
+
+#pragma once
+
+#ifndef texcachefmt_h_
+#define texcachefmt_h_
+
+#include "compat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEXCACHEMAGIC "LZ41"
+#define TEXCACHEMAGIC2 "LZ42"
+#define TEXCACHEINDEXMAGIC "TCI2"
+#define VOXCACHEMAGIC "VOX2"
+
+#define TEXCACHEMAXMIPS 24
+
+// the pict.format values that use 16 byte DXT blocks
+#define TEXCACHE_FORMAT_DXT3 0x83F2
+#define TEXCACHE_FORMAT_DXT5 0x83F3
+
+enum
+{
+    TEXCACHECHUNK_ALPHA,
+    TEXCACHECHUNK_RGB,
+    TEXCACHECHUNK_INDEX,
+    TEXCACHECHUNKS
+};
+
+typedef struct texcachehead_t
+{
+    char magic[4];	// 'PMST', was 'Polymost'
+    int xdim, ydim;	// of image, unpadded
+    int flags;		// 1 = !2^x, 2 = has alpha, 4 = lzw compressed
+    int quality;    // r_downsize at the time the cache was written
+} texcacheheader;
+
+// texcacheheader cachead.flags bits
+enum
+{
+    CACHEAD_NONPOW2 = 1,
+    CACHEAD_HASALPHA = 2,
+    CACHEAD_COMPRESSED = 4,
+    CACHEAD_NODOWNSIZE = 8,
+    CACHEAD_HASFULLBRIGHT = 16,
+    CACHEAD_NPOTWALL = 32,
+};
+
+typedef struct texcachepic_t
+{
+    int size;
+    int format;
+    int xdim, ydim;	// of mipmap (possibly padded)
+    int border, depth;
+} texcachepicture;
+
+typedef struct
+{
+    texcachepicture pict;
+    int32_t chunkofs[TEXCACHECHUNKS];  // from the start of the entry
+    int32_t chunklen[TEXCACHECHUNKS];  // as stored, 0 if the level has no such chunk
+} texcachemip;
+
+typedef struct
+{
+    uint64_t key;
+    uint32_t offset;
+    uint32_t len;
+} texcacheindexrec;
+
+#define TEXCACHEINDEXHEADSIZ 8
+#define TEXCACHEINDEXRECSIZ 16
+#define TEXCACHEMIPSIZ (int32_t)(sizeof(texcachepicture) + 2*TEXCACHECHUNKS*sizeof(int32_t))
+
+static FORCE_INLINE uint64_t texcache_idkey(char const *cacheid)
+{
+    uint64_t const key = strtoull(cacheid, NULL, 16);
+    return key ? key : 1;  // 0 is never in the index
+}
+
+// Returns the number of index records in the v2 index of len bytes at data,
+// and the number of sorted ones at its start in numsorted, or -1 if it isn't
+// one. A partial record at the end is not counted, see texcache_indextail().
+int32_t texcache_checkindex(char const *data, int32_t len, int32_t *numsorted);
+void    texcache_getindexrec(char const *data, int32_t rec, texcacheindexrec *r);
+
+// Returns the number of bytes of a record cut short at the end of an index of
+// len bytes. Records appended after them would be misaligned, so an index
+// with a tail has to be rewritten before it is appended to.
+static FORCE_INLINE int32_t texcache_indextail(int32_t len)
+{
+    return len > TEXCACHEINDEXHEADSIZ ? (len - TEXCACHEINDEXHEADSIZ) % TEXCACHEINDEXRECSIZ : 0;
+}
+
+// Writes the header of a v2 index and the given records, sorting them first.
+// buf must hold TEXCACHEINDEXHEADSIZ + num*TEXCACHEINDEXRECSIZ bytes.
+void    texcache_putindex(char *buf, texcacheindexrec *recs, int32_t num);
+void    texcache_putindexrec(char *buf, texcacheindexrec const *r);
+
+// Reads the header of a texture entry of len bytes in native byte order and
+// finds its mip levels, which mips has room for TEXCACHEMAXMIPS of. Returns
+// the number of levels, 0 if the entry isn't a texture and -1 if it is
+// damaged.
+int32_t texcache_parseentry(char const *data, int32_t len, texcacheheader *head, texcachemip *mips);
+
+static FORCE_INLINE int32_t texcache_chunksize(texcachemip const *mip, int c)
+{
+    int32_t const stride = (mip->pict.format == TEXCACHE_FORMAT_DXT3 || mip->pict.format == TEXCACHE_FORMAT_DXT5) ? 16 : 8;
+
+    if (c == TEXCACHECHUNK_ALPHA && stride != 16)
+        return 0;
+
+    return (mip->pict.size / stride) * (c == TEXCACHECHUNK_ALPHA ? 8 : 4);
+}
+
+// Unpacks chunk c of a level into buf, which holds texcache_chunksize()
+// bytes. Safe to call from any thread. Returns 0 on success.
+int32_t texcache_unpackchunk(char const *entry, texcachemip const *mip, int c, char *buf, int32_t ispacked);
+
+// The size of an LZ42 entry's header and level table, and the function
+// writing them, with the chunk offsets of mips relative to the end of the
+// table.
+static FORCE_INLINE int32_t texcache_entryheadsize(int32_t nummips)
+{
+    return sizeof(texcacheheader) + sizeof(int32_t) + nummips * TEXCACHEMIPSIZ;
+}
+void    texcache_putentryhead(char *buf, texcacheheader const *head, texcachemip const *mips, int32_t nummips);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // texcachefmt_h_
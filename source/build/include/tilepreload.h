@@ -0,0 +1,63 @@
+// tilepreload.h
+//  Loads the tiles a level is going to use on a thread pool while the loading screen is up.
+//
+// A game queues every tile it wants in memory, along with the hightile
+// precache flags it keeps in precachehightile[], between tilePreloadBegin()
+// and its first tilePreloadRun() call. A few tiles ahead of the one being
+// finished, the main thread sets up their cache blocks and looks up their
+// replacement textures, and the pool workers copy the tile data out of the
+// memory-mapped ART files and decode the replacement pictures.
+//
+// tilePreloadRun() finishes the tiles in the order they were queued: it does
+// what tileLoad() would have done after reading the data, and then hands the
+// tile to the game, whose polymost_precache() calls pick up the decoded
+// pictures instead of reading and decoding the files themselves. Everything
+// touching the cache, the VFS or OpenGL stays on the main thread, and tiles
+// that can't be read from a view, like rotated tiles and tiles made by
+// tilefromtexture, simply go through tileLoad() when their turn comes.
+
+#pragma once
+
+#ifndef tilepreload_h_
+#define tilepreload_h_
+
+#include "compat.h"
+
+#ifdef USE_OPENGL
+# include "hightile.h"
+#endif
+
+#define MAXTILEPRELOADTHREADS 8
+
+// how long tilePreloadRun() is usually given before the loading screen is drawn again, in ms
+#define TILEPRELOAD_FRAMETIME 12
+
+// hightile precache flags, one for each precachehightile[] bitmap
+enum
+{
+    TILEPRELOAD_WALL   = 1,
+    TILEPRELOAD_SPRITE = 2,
+};
+
+typedef void (*tilepreloadfunc_t)(int32_t tilenum, int32_t hightile);
+
+extern int32_t tilepreload_threads;
+
+void    tilePreloadBegin(void);
+void    tilePreloadQueue(int32_t tilenum, int32_t hightile);
+
+// Finishes queued tiles and passes them to func, if given, until budget
+// milliseconds have passed. Returns the number of tiles still left.
+int32_t tilePreloadRun(tilepreloadfunc_t func, int32_t budget);
+
+// Waits for the workers and drops whatever was not finished yet.
+void    tilePreloadEnd(void);
+void    tilePreloadUninit(void);
+
+#ifdef USE_OPENGL
+// The decoded picture of a replacement texture of the tile last passed to
+// the game, in a buffer of siz.x*siz.y pixels the caller frees, or NULL.
+coltype *tilePreloadTakeHightile(char const *fn, int32_t leng, vec2_t *tsiz, vec2_t *siz);
+#endif
+
+#endif // tilepreload_h_
@@ -247,6 +247,11 @@ static inline void krename(int32_t, int32_t, const char *)
 {
 }
 
+static inline void const *kfileview(buildvfs_kfd, int32_t *, int32_t)
+{
+    return nullptr;
+}
+
 #else
 using buildvfs_kfd = int32_t;
 #define buildvfs_kfd_invalid (-1)
@@ -277,8 +282,17 @@ void	kclose(buildvfs_kfd handle);
 
 void krename(int32_t crcval, int32_t filenum, const char *newname);
 char const * kfileparent(int32_t handle);
+
+// Returns a read-only view of the whole file and sets *length, or returns
+// NULL if the file can't be viewed, e.g. because it is compressed. Views of
+// files inside groups and zips stay valid until uninitgroupfile(). Files on
+// disk are only mapped if loose is nonzero, and their views go away with
+// kclose(). The file position is left alone.
+void const *kfileview(buildvfs_kfd handle, int32_t *length, int32_t loose);
 #endif
 
+extern int32_t kfileview_enabled;
+
 extern int32_t kpzbufloadfil(buildvfs_kfd);
 
 #ifdef WITHKPLIB
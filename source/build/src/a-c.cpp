@@ -11,6 +11,7 @@
 // by the EDuke32 team (development@voidpoint.com)
 
 #include "a.h"
+#include "classicstrips.h"
 #include "pragmas.h"
 
 #ifdef ENGINE_USING_A_C
@@ -57,6 +58,18 @@ void hlineasm4(bssize_t cnt, int32_t skiploadincs, int32_t paloffs, uint32_t by,
 
     if (!skiploadincs) { gbxinc = asm1; gbyinc = asm2; }
 
+    if (EDUKE32_PREDICT_FALSE(classicstrips_active))
+    {
+        classicStripsHline(cnt, (intptr_t)&ghlinepal[paloffs], by, bx, p, (intptr_t)gbuf, gbxinc, gbyinc, glogx, glogy);
+        return;
+    }
+
+    if (classicsimd.hline && glogx && glogy)
+    {
+        classicsimd.hline((char *)p, &ghlinepal[paloffs], gbuf, bx, by, gbxinc, gbyinc, glogx, glogy, cnt+1);
+        return;
+    }
+
     const char *const A_C_RESTRICT palptr = &ghlinepal[paloffs];
     const char *const A_C_RESTRICT buf = gbuf;
     const vec2_t inc = { gbxinc, gbyinc };
@@ -101,6 +114,20 @@ void slopevlin(intptr_t p, int32_t i, intptr_t slopaloffs, bssize_t cnt, int32_t
 
     bz = asm3; bzinc = (asm1>>3);
     slopalptr = (intptr_t *)slopaloffs;
+
+    if (EDUKE32_PREDICT_FALSE(classicstrips_active))
+    {
+        UNREFERENCED_PARAMETER(i);
+        classicStripsSlopevlin(p, slopalptr, cnt, bx, by, bz, bzinc, globalx3, globaly3, (intptr_t)gbuf, gpinc, glogx, glogy);
+        return;
+    }
+
+    if (classicsimd.slope && glogx && glogy)
+    {
+        classicsimd.slope((char *)p, slopalptr, cnt, bx, by, bz, bzinc, globalx3, globaly3, gbuf, gpinc, glogx, glogy);
+        return;
+    }
+
     for (; cnt>0; cnt--)
     {
         i = (sloptable[(bz>>6)+HALFSLOPTABLESIZ]); bz += bzinc;
@@ -132,6 +159,9 @@ void setupvlineasm(int32_t neglogy) { glogy = neglogy; }
 // cnt+1 loop iterations!
 int32_t vlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p)
 {
+    if (EDUKE32_PREDICT_FALSE(classicstrips_active))
+        return classicStripsVline(vinc, paloffs, cnt, vplc, bufplc, p, glogy, globaltilesizy);
+
     const char *const A_C_RESTRICT buf = (char *)bufplc;
     const char *const A_C_RESTRICT pal = (char *)paloffs;
     const int32_t logy = glogy, ourbpl = bpl;
@@ -250,6 +280,12 @@ static void vlineasm4nlogy(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal
 // cnt >= 1
 void vlineasm4(bssize_t cnt, char *p)
 {
+    if (EDUKE32_PREDICT_FALSE(classicstrips_active))
+    {
+        classicStripsVline4(cnt, (intptr_t)p, palookupoffse, bufplce, vplce, vince, glogy, globaltilesizy);
+        return;
+    }
+
     char * const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
     char * const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
 #ifdef USE_VECTOR_EXT
@@ -272,6 +308,12 @@ void vlineasm4(bssize_t cnt, char *p)
     assert(logy);
 #endif
 
+    if (classicsimd.vline4)
+    {
+        classicsimd.vline4(p, palookupoffse, bufplce, vplce, vince, logy, ourbpl, cnt);
+        return;
+    }
+
     // just fucking shoot me
 #ifdef CLASSIC_SLICE_BY_4
     for (; cnt>=4;cnt-=4)
@@ -395,6 +437,16 @@ void mvlineasm4(bssize_t cnt, char *p)
     const int32_t logy = glogy, ourbpl = bpl;
     char ch;
 
+    if (classicsimd.mvline4 && logy)
+    {
+#ifdef USE_SATURATE_VPLC
+        classicsimd.mvline4(p, palookupoffse, bufplce, vplce, vince, logy, ourbpl, cnt, g_saturate);
+#else
+        classicsimd.mvline4(p, palookupoffse, bufplce, vplce, vince, logy, ourbpl, cnt, 0);
+#endif
+        return;
+    }
+
     if (logy)
     {
         do
@@ -555,6 +607,13 @@ void mhline(intptr_t bufplc, uint32_t bx, int32_t cntup16, int32_t junk, uint32_
 
     cntup16>>=16;
     cntup16++;
+
+    if (classicsimd.mhline && glogx && glogy)
+    {
+        classicsimd.mhline((char *)p, gpal, gbuf, bx, by, xinc, yinc, glogx, glogy, cntup16);
+        return;
+    }
+
     do
     {
         ch = gbuf[((bx>>(32-glogx))<<glogy)+(by>>(32-glogy))];
@@ -584,6 +643,12 @@ void thline(intptr_t bufplc, uint32_t bx, int32_t cntup16, int32_t junk, uint32_
 
     uint8_t const shift = transmode<<3;
 
+    if (classicsimd.thline && glogx && glogy)
+    {
+        classicsimd.thline((char *)p, gpal, gbuf, bx, by, xinc, yinc, glogx, glogy, cntup16, gtrans, shift);
+        return;
+    }
+
     do
     {
         ch = gbuf[((bx>>(32-glogx))<<glogy)+(by>>(32-glogy))];
@@ -607,6 +672,13 @@ void setupspritevline(intptr_t paloffs, int32_t bxinc, int32_t byinc, int32_t ys
 void spritevline(int32_t bx, int32_t by, bssize_t cnt, intptr_t bufplc, intptr_t p)
 {
     gbuf = (char *)bufplc;
+
+    if (classicsimd.spritevline && cnt > 1)
+    {
+        classicsimd.spritevline((char *)p, gpal, gbuf, bx, by, gbxinc, gbyinc, glogy, bpl, cnt-1);
+        return;
+    }
+
     for (; cnt>1; cnt--)
     {
         (*(char *)p) = gpal[gbuf[(bx>>16)*glogy+(by>>16)]];
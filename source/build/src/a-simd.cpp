@@ -0,0 +1,613 @@
+// a-simd.cpp
+//  SSE2/SSE4.1/AVX2 versions of the column and span kernels in a-c.cpp.
+//
+// Each kernel steps 4 (SSE) or 8 (AVX2) pixels or columns per iteration,
+// computing the texture coordinates of all of them at once. The SSE
+// kernels fetch texels and palookup entries with byte loads. The AVX2
+// ones gather them too: each lane fetches the aligned dword that holds its
+// byte and shifts the byte out. An aligned dword never crosses a page, so
+// this can't fault even at the last byte of a tile or palookup. The bytes
+// are packed into one store where the destination is contiguous. The
+// results are identical to the scalar code in a-c.cpp, which can be forced
+// with r_classicsimd 0.
+
+#include "a.h"
+#include "build_cpuid.h"
+#include "baselayer.h"
+
+#if defined EDUKE32_CPU_X86 && defined ENGINE_USING_A_C && (EDUKE32_GCC_PREREQ(4,9) || defined __clang__ || defined _MSC_VER)
+# define CLASSICSIMD_ENABLED
+# include <immintrin.h>
+#endif
+
+int32_t r_classicsimd = CLASSICSIMD_AVX2;
+int32_t classicsimdlevel;
+classicsimd_t classicsimd;
+
+#ifdef CLASSICSIMD_ENABLED
+
+#if defined __GNUC__ || defined __clang__
+# define SIMD_TARGET(x) __attribute__((target(x)))
+#else
+# define SIMD_TARGET(x)
+#endif
+
+#define SIMD_SSE2  SIMD_TARGET("sse2")
+#define SIMD_SSE41 SIMD_TARGET("sse4.1")
+#define SIMD_AVX2  SIMD_TARGET("avx2")
+
+// ((u>>(32-logx))<<logy) + (v>>(32-logy)) for four lanes
+static FORCE_INLINE SIMD_SSE2 __m128i texcoord4(__m128i u, __m128i v, __m128i shx, __m128i shy, __m128i logy)
+{
+    return _mm_add_epi32(_mm_sll_epi32(_mm_srl_epi32(u, shx), logy), _mm_srl_epi32(v, shy));
+}
+
+static FORCE_INLINE SIMD_AVX2 __m256i texcoord8(__m256i u, __m256i v, __m128i shx, __m128i shy, __m128i logy)
+{
+    return _mm256_add_epi32(_mm256_sll_epi32(_mm256_srl_epi32(u, shx), logy), _mm256_srl_epi32(v, shy));
+}
+
+static FORCE_INLINE SIMD_SSE2 __m128i ramp4(uint32_t base, uint32_t inc)
+{
+    return _mm_setr_epi32(base, base + inc, base + inc*2, base + inc*3);
+}
+
+static FORCE_INLINE SIMD_AVX2 __m256i ramp8(uint32_t base, uint32_t inc)
+{
+    return _mm256_setr_epi32(base, base + inc, base + inc*2, base + inc*3,
+                             base + inc*4, base + inc*5, base + inc*6, base + inc*7);
+}
+
+static FORCE_INLINE uint32_t pack4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+    return a | (b << 8) | (c << 16) | ((uint32_t)d << 24);
+}
+
+static FORCE_INLINE uint32_t loadpix4(const char *p) { uint32_t v; Bmemcpy(&v, p, sizeof(v)); return v; }
+static FORCE_INLINE void storepix4(char *p, uint32_t v) { Bmemcpy(p, &v, sizeof(v)); }
+
+static FORCE_INLINE void storepix8(char *p, uint64_t v) { Bmemcpy(p, &v, sizeof(v)); }
+
+#define PALBUF(pal, buf, idx) ((uint8_t)(pal)[(uint8_t)(buf)[idx]])
+
+// base[idx] for eight lanes, zero extended
+static FORCE_INLINE SIMD_AVX2 __m256i gather8(const char *base, __m256i idx)
+{
+    int32_t const mis = (intptr_t)base & 3;
+    __m256i const ofs = _mm256_add_epi32(idx, _mm256_set1_epi32(mis));
+    __m256i const dw  = _mm256_i32gather_epi32((int const *)(base - mis), _mm256_srai_epi32(ofs, 2), 4);
+    __m256i const sh  = _mm256_slli_epi32(_mm256_and_si256(ofs, _mm256_set1_epi32(3)), 3);
+    return _mm256_and_si256(_mm256_srlv_epi32(dw, sh), _mm256_set1_epi32(0xff));
+}
+
+// the bytes at four absolute addresses, zero extended
+static FORCE_INLINE SIMD_AVX2 __m128i gather4abs(__m256i addr)
+{
+    __m256i const mis = _mm256_and_si256(addr, _mm256_set1_epi64x(3));
+    __m128i const dw  = _mm256_i64gather_epi32((int const *)nullptr, _mm256_sub_epi64(addr, mis), 1);
+    __m128i const sh  = _mm_slli_epi32(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(mis, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6))), 3);
+    return _mm_and_si128(_mm_srlv_epi32(dw, sh), _mm_set1_epi32(0xff));
+}
+
+static FORCE_INLINE SIMD_AVX2 __m256i ptr4(intptr_t a, intptr_t b, intptr_t c, intptr_t d)
+{
+    return _mm256_setr_epi64x((uintptr_t)a, (uintptr_t)b, (uintptr_t)c, (uintptr_t)d);
+}
+
+// the low bytes of the lanes, lane 0 in the lowest byte
+static FORCE_INLINE SIMD_AVX2 uint64_t packbytes8(__m256i x)
+{
+    __m256i const b = _mm256_shuffle_epi8(x, _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                              0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    return (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(b))
+           | ((uint64_t)(uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(b, 1)) << 32);
+}
+
+static FORCE_INLINE SIMD_AVX2 uint32_t packbytes4(__m128i x)
+{
+    return _mm_cvtsi128_si32(_mm_shuffle_epi8(x, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)));
+}
+
+///// hlineasm4 /////
+
+static SIMD_SSE2 void hline_sse2(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc,
+                                 int32_t yinc, int32_t logx, int32_t logy, int32_t cnt)
+{
+    __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+    __m128i const dx = _mm_set1_epi32((uint32_t)xinc<<2), dy = _mm_set1_epi32((uint32_t)yinc<<2);
+    __m128i u = ramp4(bx, -(uint32_t)xinc), v = ramp4(by, -(uint32_t)yinc);
+    uint32_t i[4];
+
+    // pixel k goes to p-k, so the lowest byte of the store is the last pixel
+    for (; cnt >= 4; cnt -= 4, p -= 4)
+    {
+        _mm_storeu_si128((__m128i *)i, texcoord4(u, v, shx, shy, shl));
+        storepix4(p-3, pack4(PALBUF(pal, buf, i[3]), PALBUF(pal, buf, i[2]), PALBUF(pal, buf, i[1]), PALBUF(pal, buf, i[0])));
+        u = _mm_sub_epi32(u, dx);
+        v = _mm_sub_epi32(v, dy);
+    }
+
+    bx = _mm_cvtsi128_si32(u);
+    by = _mm_cvtsi128_si32(v);
+
+    for (; cnt > 0; cnt--, p--)
+    {
+        *p = PALBUF(pal, buf, ((bx>>(32-logx))<<logy)+(by>>(32-logy)));
+        bx -= xinc;
+        by -= yinc;
+    }
+}
+
+static SIMD_AVX2 void hline_avx2(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc,
+                                 int32_t yinc, int32_t logx, int32_t logy, int32_t cnt)
+{
+    if (cnt >= 8)
+    {
+        __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+        __m256i const dx = _mm256_set1_epi32((uint32_t)xinc<<3), dy = _mm256_set1_epi32((uint32_t)yinc<<3);
+        // lane k is pixel 7-k, so the lanes are in memory order from p-7
+        __m256i u = ramp8(bx - (uint32_t)xinc*7, xinc), v = ramp8(by - (uint32_t)yinc*7, yinc);
+
+        for (; cnt >= 8; cnt -= 8, p -= 8)
+        {
+            storepix8(p-7, packbytes8(gather8(pal, gather8(buf, texcoord8(u, v, shx, shy, shl)))));
+            u = _mm256_sub_epi32(u, dx);
+            v = _mm256_sub_epi32(v, dy);
+        }
+
+        bx = _mm256_extract_epi32(u, 7);
+        by = _mm256_extract_epi32(v, 7);
+    }
+
+    hline_sse2(p, pal, buf, bx, by, xinc, yinc, logx, logy, cnt);
+}
+
+///// vlineasm4/mvlineasm4 /////
+
+static SIMD_SSE2 void vline4_sse2(char *p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc, const int32_t *vinc,
+                                  int32_t logy, int32_t bpl, int32_t cnt)
+{
+    const char *const A_C_RESTRICT pal0 = (const char *)pal[0], *const A_C_RESTRICT pal1 = (const char *)pal[1];
+    const char *const A_C_RESTRICT pal2 = (const char *)pal[2], *const A_C_RESTRICT pal3 = (const char *)pal[3];
+    const char *const A_C_RESTRICT buf0 = (const char *)buf[0], *const A_C_RESTRICT buf1 = (const char *)buf[1];
+    const char *const A_C_RESTRICT buf2 = (const char *)buf[2], *const A_C_RESTRICT buf3 = (const char *)buf[3];
+    __m128i const sh = _mm_cvtsi32_si128(logy), inc = _mm_loadu_si128((__m128i const *)vinc);
+    __m128i v = _mm_loadu_si128((__m128i const *)vplc);
+    uint32_t i[4];
+
+    for (; cnt > 0; cnt--, p += bpl)
+    {
+        _mm_storeu_si128((__m128i *)i, _mm_srl_epi32(v, sh));
+        storepix4(p, pack4(PALBUF(pal0, buf0, i[0]), PALBUF(pal1, buf1, i[1]), PALBUF(pal2, buf2, i[2]), PALBUF(pal3, buf3, i[3])));
+        v = _mm_add_epi32(v, inc);
+    }
+
+    _mm_storeu_si128((__m128i *)vplc, v);
+}
+
+static SIMD_SSE2 void mvline4_sse2(char *p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc, const int32_t *vinc,
+                                   int32_t logy, int32_t bpl, int32_t cnt, int32_t saturate)
+{
+    __m128i const sh = _mm_cvtsi32_si128(logy), inc = _mm_loadu_si128((__m128i const *)vinc);
+    __m128i const bias = _mm_set1_epi32(INT32_MIN), incbiased = _mm_xor_si128(inc, bias);
+    __m128i const sat = _mm_set1_epi32(saturate);
+    __m128i v = _mm_loadu_si128((__m128i const *)vplc);
+    uint32_t i[4];
+
+    for (; cnt > 0; cnt--, p += bpl)
+    {
+        _mm_storeu_si128((__m128i *)i, _mm_srl_epi32(v, sh));
+
+        uint32_t pix = 0, mask = 0;
+
+        for (int j = 0; j < 4; j++)
+        {
+            uint8_t const ch = ((const char *)buf[j])[i[j]];
+
+            if (ch != 255)
+            {
+                pix  |= (uint32_t)((const uint8_t *)pal[j])[ch] << (j << 3);
+                mask |= 0xffu << (j << 3);
+            }
+        }
+
+        if (mask)
+            storepix4(p, (loadpix4(p) & ~mask) | pix);
+
+        // vplc |= saturate & (vplc < vinc), with an unsigned compare
+        v = _mm_add_epi32(v, inc);
+        v = _mm_or_si128(v, _mm_and_si128(sat, _mm_cmplt_epi32(_mm_xor_si128(v, bias), incbiased)));
+    }
+
+    _mm_storeu_si128((__m128i *)vplc, v);
+}
+
+static SIMD_AVX2 void vline4_avx2(char *p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc, const int32_t *vinc,
+                                  int32_t logy, int32_t bpl, int32_t cnt)
+{
+    __m128i const sh = _mm_cvtsi32_si128(logy), inc = _mm_loadu_si128((__m128i const *)vinc);
+    __m256i const vbuf = ptr4(buf[0], buf[1], buf[2], buf[3]), vpal = ptr4(pal[0], pal[1], pal[2], pal[3]);
+    __m128i v = _mm_loadu_si128((__m128i const *)vplc);
+
+    for (; cnt > 0; cnt--, p += bpl)
+    {
+        __m128i const ch = gather4abs(_mm256_add_epi64(vbuf, _mm256_cvtepu32_epi64(_mm_srl_epi32(v, sh))));
+        storepix4(p, packbytes4(gather4abs(_mm256_add_epi64(vpal, _mm256_cvtepu32_epi64(ch)))));
+        v = _mm_add_epi32(v, inc);
+    }
+
+    _mm_storeu_si128((__m128i *)vplc, v);
+}
+
+static SIMD_AVX2 void mvline4_avx2(char *p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc, const int32_t *vinc,
+                                   int32_t logy, int32_t bpl, int32_t cnt, int32_t saturate)
+{
+    __m128i const sh = _mm_cvtsi32_si128(logy), inc = _mm_loadu_si128((__m128i const *)vinc);
+    __m128i const bias = _mm_set1_epi32(INT32_MIN), incbiased = _mm_xor_si128(inc, bias);
+    __m128i const sat = _mm_set1_epi32(saturate), transparent = _mm_set1_epi32(255);
+    __m256i const vbuf = ptr4(buf[0], buf[1], buf[2], buf[3]), vpal = ptr4(pal[0], pal[1], pal[2], pal[3]);
+    __m128i v = _mm_loadu_si128((__m128i const *)vplc);
+
+    for (; cnt > 0; cnt--, p += bpl)
+    {
+        __m128i const ch = gather4abs(_mm256_add_epi64(vbuf, _mm256_cvtepu32_epi64(_mm_srl_epi32(v, sh))));
+        uint32_t const mask = ~packbytes4(_mm_cmpeq_epi32(ch, transparent));
+
+        if (mask)
+        {
+            uint32_t const pix = packbytes4(gather4abs(_mm256_add_epi64(vpal, _mm256_cvtepu32_epi64(ch))));
+            storepix4(p, (loadpix4(p) & ~mask) | (pix & mask));
+        }
+
+        // vplc |= saturate & (vplc < vinc), with an unsigned compare
+        v = _mm_add_epi32(v, inc);
+        v = _mm_or_si128(v, _mm_and_si128(sat, _mm_cmplt_epi32(_mm_xor_si128(v, bias), incbiased)));
+    }
+
+    _mm_storeu_si128((__m128i *)vplc, v);
+}
+
+///// mhline/thline /////
+
+static SIMD_SSE2 void mhline_sse2(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc,
+                                  int32_t yinc, int32_t logx, int32_t logy, int32_t cnt)
+{
+    __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+    __m128i const dx = _mm_set1_epi32((uint32_t)xinc<<2), dy = _mm_set1_epi32((uint32_t)yinc<<2);
+    __m128i u = ramp4(bx, xinc), v = ramp4(by, yinc);
+    uint32_t i[4];
+
+    for (; cnt >= 4; cnt -= 4, p += 4)
+    {
+        _mm_storeu_si128((__m128i *)i, texcoord4(u, v, shx, shy, shl));
+
+        uint32_t pix = 0, mask = 0;
+
+        for (int j = 0; j < 4; j++)
+        {
+            uint8_t const ch = buf[i[j]];
+
+            if (ch != 255)
+            {
+                pix  |= (uint32_t)(uint8_t)pal[ch] << (j << 3);
+                mask |= 0xffu << (j << 3);
+            }
+        }
+
+        if (mask)
+            storepix4(p, (loadpix4(p) & ~mask) | pix);
+
+        u = _mm_add_epi32(u, dx);
+        v = _mm_add_epi32(v, dy);
+    }
+
+    bx = _mm_cvtsi128_si32(u);
+    by = _mm_cvtsi128_si32(v);
+
+    for (; cnt > 0; cnt--, p++)
+    {
+        uint8_t const ch = buf[((bx>>(32-logx))<<logy)+(by>>(32-logy))];
+        if (ch != 255) *p = pal[ch];
+        bx += xinc;
+        by += yinc;
+    }
+}
+
+static SIMD_SSE2 void thline_sse2(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc,
+                                  int32_t yinc, int32_t logx, int32_t logy, int32_t cnt, const char *trans, int32_t shift)
+{
+    __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+    __m128i const dx = _mm_set1_epi32((uint32_t)xinc<<2), dy = _mm_set1_epi32((uint32_t)yinc<<2);
+    __m128i u = ramp4(bx, xinc), v = ramp4(by, yinc);
+    uint32_t i[4];
+
+    for (; cnt >= 4; cnt -= 4, p += 4)
+    {
+        _mm_storeu_si128((__m128i *)i, texcoord4(u, v, shx, shy, shl));
+
+        for (int j = 0; j < 4; j++)
+        {
+            uint8_t const ch = buf[i[j]];
+            if (ch != 255) p[j] = trans[((uint8_t)p[j]<<(8-shift))|((uint8_t)pal[ch]<<shift)];
+        }
+
+        u = _mm_add_epi32(u, dx);
+        v = _mm_add_epi32(v, dy);
+    }
+
+    bx = _mm_cvtsi128_si32(u);
+    by = _mm_cvtsi128_si32(v);
+
+    for (; cnt > 0; cnt--, p++)
+    {
+        uint8_t const ch = buf[((bx>>(32-logx))<<logy)+(by>>(32-logy))];
+        if (ch != 255) *p = trans[((uint8_t)*p<<(8-shift))|((uint8_t)pal[ch]<<shift)];
+        bx += xinc;
+        by += yinc;
+    }
+}
+
+static SIMD_AVX2 void mhline_avx2(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc,
+                                  int32_t yinc, int32_t logx, int32_t logy, int32_t cnt)
+{
+    if (cnt >= 8)
+    {
+        __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+        __m256i const dx = _mm256_set1_epi32((uint32_t)xinc<<3), dy = _mm256_set1_epi32((uint32_t)yinc<<3);
+        __m256i const transparent = _mm256_set1_epi32(255);
+        __m256i u = ramp8(bx, xinc), v = ramp8(by, yinc);
+
+        for (; cnt >= 8; cnt -= 8, p += 8)
+        {
+            __m256i const ch = gather8(buf, texcoord8(u, v, shx, shy, shl));
+            uint64_t const mask = ~packbytes8(_mm256_cmpeq_epi32(ch, transparent));
+
+            if (mask)
+            {
+                uint64_t dst;
+                Bmemcpy(&dst, p, sizeof(dst));
+                storepix8(p, (dst & ~mask) | (packbytes8(gather8(pal, ch)) & mask));
+            }
+
+            u = _mm256_add_epi32(u, dx);
+            v = _mm256_add_epi32(v, dy);
+        }
+
+        bx = _mm_cvtsi128_si32(_mm256_castsi256_si128(u));
+        by = _mm_cvtsi128_si32(_mm256_castsi256_si128(v));
+    }
+
+    mhline_sse2(p, pal, buf, bx, by, xinc, yinc, logx, logy, cnt);
+}
+
+static SIMD_AVX2 void thline_avx2(char *p, const char *pal, const char *buf, uint32_t bx, uint32_t by, int32_t xinc,
+                                  int32_t yinc, int32_t logx, int32_t logy, int32_t cnt, const char *trans, int32_t shift)
+{
+    if (cnt >= 8)
+    {
+        __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+        __m128i const shdst = _mm_cvtsi32_si128(8-shift), shsrc = _mm_cvtsi32_si128(shift);
+        __m256i const dx = _mm256_set1_epi32((uint32_t)xinc<<3), dy = _mm256_set1_epi32((uint32_t)yinc<<3);
+        __m256i const transparent = _mm256_set1_epi32(255);
+        __m256i u = ramp8(bx, xinc), v = ramp8(by, yinc);
+
+        for (; cnt >= 8; cnt -= 8, p += 8)
+        {
+            __m256i const ch = gather8(buf, texcoord8(u, v, shx, shy, shl));
+            uint64_t const mask = ~packbytes8(_mm256_cmpeq_epi32(ch, transparent));
+
+            if (mask)
+            {
+                uint64_t dst;
+                Bmemcpy(&dst, p, sizeof(dst));
+                __m256i const idx = _mm256_or_si256(_mm256_sll_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *)p)), shdst),
+                                                    _mm256_sll_epi32(gather8(pal, ch), shsrc));
+                storepix8(p, (dst & ~mask) | (packbytes8(gather8(trans, idx)) & mask));
+            }
+
+            u = _mm256_add_epi32(u, dx);
+            v = _mm256_add_epi32(v, dy);
+        }
+
+        bx = _mm_cvtsi128_si32(_mm256_castsi256_si128(u));
+        by = _mm_cvtsi128_si32(_mm256_castsi256_si128(v));
+    }
+
+    thline_sse2(p, pal, buf, bx, by, xinc, yinc, logx, logy, cnt, trans, shift);
+}
+
+///// slopevlin /////
+
+static FORCE_INLINE void slopepixel(char *&p, intptr_t const *&slopalptr, uint32_t bx, uint32_t by, int32_t &bz,
+                                    int32_t bzinc, int32_t x3, int32_t y3, const char *buf, int32_t pinc,
+                                    int32_t logx, int32_t logy)
+{
+    int32_t const i = sloptable[(bz>>6)+HALFSLOPTABLESIZ];
+    uint32_t const u = bx + (uint32_t)x3*i;
+    uint32_t const v = by + (uint32_t)y3*i;
+    *p = *(char *)(slopalptr[0] + (uint8_t)buf[((u>>(32-logx))<<logy)+(v>>(32-logy))]);
+    slopalptr--;
+    p += pinc;
+    bz += bzinc;
+}
+
+static SIMD_SSE41 void slope_sse41(char *p, intptr_t const *slopalptr, int32_t cnt, uint32_t bx, uint32_t by,
+                                   int32_t bz, int32_t bzinc, int32_t x3, int32_t y3, const char *buf, int32_t pinc,
+                                   int32_t logx, int32_t logy)
+{
+    __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+    __m128i const vx3 = _mm_set1_epi32(x3), vy3 = _mm_set1_epi32(y3);
+    __m128i const vbx = _mm_set1_epi32(bx), vby = _mm_set1_epi32(by);
+    __m128i const dz = _mm_set1_epi32((uint32_t)bzinc<<2);
+    __m128i z = ramp4(bz, bzinc);
+    int32_t zi[4];
+    uint32_t i[4];
+
+    for (; cnt >= 4; cnt -= 4)
+    {
+        _mm_storeu_si128((__m128i *)zi, _mm_srai_epi32(z, 6));
+
+        __m128i const s = _mm_setr_epi32(sloptable[zi[0]+HALFSLOPTABLESIZ], sloptable[zi[1]+HALFSLOPTABLESIZ],
+                                         sloptable[zi[2]+HALFSLOPTABLESIZ], sloptable[zi[3]+HALFSLOPTABLESIZ]);
+        __m128i const u = _mm_add_epi32(vbx, _mm_mullo_epi32(vx3, s));
+        __m128i const v = _mm_add_epi32(vby, _mm_mullo_epi32(vy3, s));
+
+        _mm_storeu_si128((__m128i *)i, texcoord4(u, v, shx, shy, shl));
+
+        for (int j = 0; j < 4; j++, p += pinc)
+            *p = *(char *)(slopalptr[-j] + (uint8_t)buf[i[j]]);
+
+        slopalptr -= 4;
+        z = _mm_add_epi32(z, dz);
+    }
+
+    bz = _mm_cvtsi128_si32(z);
+
+    for (; cnt > 0; cnt--)
+        slopepixel(p, slopalptr, bx, by, bz, bzinc, x3, y3, buf, pinc, logx, logy);
+}
+
+static SIMD_AVX2 void slope_avx2(char *p, intptr_t const *slopalptr, int32_t cnt, uint32_t bx, uint32_t by,
+                                 int32_t bz, int32_t bzinc, int32_t x3, int32_t y3, const char *buf, int32_t pinc,
+                                 int32_t logx, int32_t logy)
+{
+    if (cnt >= 8)
+    {
+        __m128i const shx = _mm_cvtsi32_si128(32-logx), shy = _mm_cvtsi32_si128(32-logy), shl = _mm_cvtsi32_si128(logy);
+        __m256i const vx3 = _mm256_set1_epi32(x3), vy3 = _mm256_set1_epi32(y3);
+        __m256i const vbx = _mm256_set1_epi32(bx), vby = _mm256_set1_epi32(by);
+        __m256i const dz = _mm256_set1_epi32((uint32_t)bzinc<<3);
+        __m256i z = ramp8(bz, bzinc);
+
+        for (; cnt >= 8; cnt -= 8)
+        {
+            __m256i const s = _mm256_i32gather_epi32((int const *)&sloptable[HALFSLOPTABLESIZ], _mm256_srai_epi32(z, 6), 4);
+            __m256i const u = _mm256_add_epi32(vbx, _mm256_mullo_epi32(vx3, s));
+            __m256i const v = _mm256_add_epi32(vby, _mm256_mullo_epi32(vy3, s));
+
+            __m256i const ch = gather8(buf, texcoord8(u, v, shx, shy, shl));
+            // every pixel has its own palookup
+            __m128i const lo = gather4abs(_mm256_add_epi64(ptr4(slopalptr[0], slopalptr[-1], slopalptr[-2], slopalptr[-3]),
+                                                           _mm256_cvtepu32_epi64(_mm256_castsi256_si128(ch))));
+            __m128i const hi = gather4abs(_mm256_add_epi64(ptr4(slopalptr[-4], slopalptr[-5], slopalptr[-6], slopalptr[-7]),
+                                                           _mm256_cvtepu32_epi64(_mm256_extracti128_si256(ch, 1))));
+            uint64_t pix = packbytes4(lo) | ((uint64_t)packbytes4(hi) << 32);
+
+            for (int j = 0; j < 8; j++, p += pinc, pix >>= 8)
+                *p = (char)pix;
+
+            slopalptr -= 8;
+            z = _mm256_add_epi32(z, dz);
+        }
+
+        bz = _mm_cvtsi128_si32(_mm256_castsi256_si128(z));
+    }
+
+    slope_sse41(p, slopalptr, cnt, bx, by, bz, bzinc, x3, y3, buf, pinc, logx, logy);
+}
+
+///// spritevline /////
+
+static SIMD_SSE41 void spritevline_sse41(char *p, const char *pal, const char *buf, int32_t bx, int32_t by,
+                                         int32_t bxinc, int32_t byinc, int32_t ysiz, int32_t bpl, int32_t cnt)
+{
+    __m128i const dx = _mm_set1_epi32((uint32_t)bxinc<<2), dy = _mm_set1_epi32((uint32_t)byinc<<2);
+    __m128i const vysiz = _mm_set1_epi32(ysiz);
+    __m128i u = ramp4(bx, bxinc), v = ramp4(by, byinc);
+    int32_t i[4];
+
+    for (; cnt >= 4; cnt -= 4)
+    {
+        _mm_storeu_si128((__m128i *)i, _mm_add_epi32(_mm_mullo_epi32(_mm_srai_epi32(u, 16), vysiz), _mm_srai_epi32(v, 16)));
+
+        for (int j = 0; j < 4; j++, p += bpl)
+            *p = PALBUF(pal, buf, i[j]);
+
+        u = _mm_add_epi32(u, dx);
+        v = _mm_add_epi32(v, dy);
+    }
+
+    bx = _mm_cvtsi128_si32(u);
+    by = _mm_cvtsi128_si32(v);
+
+    for (; cnt > 0; cnt--, p += bpl)
+    {
+        *p = PALBUF(pal, buf, (bx>>16)*ysiz+(by>>16));
+        bx += bxinc;
+        by += byinc;
+    }
+}
+
+static SIMD_AVX2 void spritevline_avx2(char *p, const char *pal, const char *buf, int32_t bx, int32_t by,
+                                       int32_t bxinc, int32_t byinc, int32_t ysiz, int32_t bpl, int32_t cnt)
+{
+    if (cnt >= 8)
+    {
+        __m256i const dx = _mm256_set1_epi32((uint32_t)bxinc<<3), dy = _mm256_set1_epi32((uint32_t)byinc<<3);
+        __m256i const vysiz = _mm256_set1_epi32(ysiz);
+        __m256i u = ramp8(bx, bxinc), v = ramp8(by, byinc);
+
+        for (; cnt >= 8; cnt -= 8)
+        {
+            __m256i const i = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(u, 16), vysiz), _mm256_srai_epi32(v, 16));
+            uint64_t pix = packbytes8(gather8(pal, gather8(buf, i)));
+
+            for (int j = 0; j < 8; j++, p += bpl, pix >>= 8)
+                *p = (char)pix;
+
+            u = _mm256_add_epi32(u, dx);
+            v = _mm256_add_epi32(v, dy);
+        }
+
+        bx = _mm_cvtsi128_si32(_mm256_castsi256_si128(u));
+        by = _mm_cvtsi128_si32(_mm256_castsi256_si128(v));
+    }
+
+    spritevline_sse41(p, pal, buf, bx, by, bxinc, byinc, ysiz, bpl, cnt);
+}
+
+#undef PALBUF
+
+static classicsimd_t const simdfuncs[] =
+{
+    { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr },
+    { hline_sse2, vline4_sse2, mvline4_sse2, mhline_sse2, thline_sse2, nullptr, nullptr },
+    { hline_sse2, vline4_sse2, mvline4_sse2, mhline_sse2, thline_sse2, slope_sse41, spritevline_sse41 },
+    { hline_avx2, vline4_avx2, mvline4_avx2, mhline_avx2, thline_avx2, slope_avx2, spritevline_avx2 },
+};
+
+#endif // CLASSICSIMD_ENABLED
+
+int32_t classicSimdInit(void)
+{
+    int32_t level = CLASSICSIMD_SCALAR;
+
+#ifdef CLASSICSIMD_ENABLED
+    if (cpu.features.sse2)
+    {
+        level = CLASSICSIMD_SSE2;
+
+        if (cpu.features.sse41)
+        {
+            level = CLASSICSIMD_SSE41;
+
+            if (cpu.features.avx2)
+                level = CLASSICSIMD_AVX2;
+        }
+    }
+
+    level = min(level, r_classicsimd);
+    classicsimd = simdfuncs[level];
+#endif
+
+    classicsimdlevel = level;
+    LOG_F(INFO, "Classic renderer using %s kernels", classicSimdLevelName(level));
+
+    return level;
+}
+
+char const *classicSimdLevelName(int32_t level)
+{
+    static char const *const levelnames[] = { "scalar", "SSE2", "SSE4.1", "AVX2" };
+    return levelnames[clamp(level, 0, (int32_t)ARRAY_SIZE(levelnames) - 1)];
+}
@@ -0,0 +1,113 @@
+// actorprefetch.cpp
+//  Parallel preparation of actor collision data, see actorprefetch.h.
+
+#include "actorprefetch.h"
+#include "build.h"
+#include "libasync_config.h"
+#include "microprofile.h"
+#include "sectorpvs.h"
+
+int32_t actorprefetch_threads = 1;
+
+static async::threadpool_scheduler *prefetchpool;
+static int32_t prefetchpoolthreads;
+
+static int32_t *prefetchjobs;
+static int16_t *prefetchsects;
+static int32_t  maxprefetchjobs;
+
+static uint8_t prefetchslotmap[(CLIPCACHESIZE+7)>>3];
+static uint8_t prefetchsectmap[(MAXSECTORS+7)>>3];
+
+// rows built and given up on by each worker, added to the stats afterwards
+static int32_t prefetchrows[MAXACTORPREFETCHTHREADS][3];
+
+void actorPrefetchRun(actorprefetch_t const *jobs, int32_t numjobs)
+{
+    int32_t const numthreads = clamp(actorprefetch_threads, 1, MAXACTORPREFETCHTHREADS);
+
+    if (numthreads <= 1 || numjobs <= 0)
+        return;
+
+    MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
+
+    if (numthreads != prefetchpoolthreads)
+    {
+        actorPrefetchUninit();
+        prefetchpool = new async::threadpool_scheduler(numthreads, []() { MicroProfileOnThreadCreate("Actor prefetch"); }, nullptr);
+        prefetchpoolthreads = numthreads;
+    }
+
+    if (numjobs > maxprefetchjobs)
+    {
+        maxprefetchjobs = numjobs;
+        prefetchjobs  = (int32_t *)Xrealloc(prefetchjobs, maxprefetchjobs * sizeof(int32_t));
+        prefetchsects = (int16_t *)Xrealloc(prefetchsects, maxprefetchjobs * sizeof(int16_t));
+    }
+
+    Bmemset(prefetchslotmap, 0, sizeof(prefetchslotmap));
+    Bmemset(prefetchsectmap, 0, sizeof(prefetchsectmap));
+
+    int32_t numclipjobs = 0, numsects = 0;
+    bool const pvsready = sectorPVSReady();
+
+    // Owners that share a cache entry would only push each other out of it,
+    // and two workers must never fill the same one, so only the first of
+    // them gets it. Likewise every row is built once.
+    for (int i = 0; i < numjobs; i++)
+    {
+        auto const &job = jobs[i];
+
+        if (job.owner < 0 || (unsigned)job.sectnum >= (unsigned)numsectors)
+            continue;
+
+        int const slot = job.owner & (CLIPCACHESIZE-1);
+
+        if (clipcache_enabled && !bitmap_test(prefetchslotmap, slot))
+        {
+            bitmap_set(prefetchslotmap, slot);
+            prefetchjobs[numclipjobs++] = i;
+        }
+
+        if (pvsready && !bitmap_test(prefetchsectmap, job.sectnum))
+        {
+            bitmap_set(prefetchsectmap, job.sectnum);
+            prefetchsects[numsects++] = job.sectnum;
+        }
+    }
+
+    if (numclipjobs == 0 && numsects == 0)
+        return;
+
+    Bmemset(prefetchrows, 0, sizeof(prefetchrows));
+
+    async::parallel_for(*prefetchpool, async::static_partitioner(async::irange(0, numthreads), 1),
+                        [jobs, numthreads, numclipjobs, numsects](int32_t const worker)
+    {
+        for (int i = worker; i < numclipjobs; i += numthreads)
+        {
+            auto const &job = jobs[prefetchjobs[i]];
+            clipCachePrefetch(job.owner, job.sectnum, job.pos, job.move, job.walldist);
+        }
+
+        for (int i = worker; i < numsects; i += numthreads)
+            prefetchrows[worker][sectorPVSPrefetchRow(prefetchsects[i], worker)]++;
+    });
+
+    for (int i = 0; i < numthreads; i++)
+    {
+        sectorpvs_stats.rowsbuilt   += prefetchrows[i][1];
+        sectorpvs_stats.rowsgivenup += prefetchrows[i][2];
+    }
+}
+
+void actorPrefetchUninit(void)
+{
+    delete prefetchpool;
+    prefetchpool        = nullptr;
+    prefetchpoolthreads = 0;
+
+    DO_FREE_AND_NULL(prefetchjobs);
+    DO_FREE_AND_NULL(prefetchsects);
+    maxprefetchjobs = 0;
+}
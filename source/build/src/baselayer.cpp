@@ -1,14 +1,19 @@
 #include "baselayer.h"
 
 #include "a.h"
+#include "actorprefetch.h"
 #include "build.h"
 #include "cache1d.h"
+#include "classicstrips.h"
 #include "communityapi.h"
 #include "compat.h"
 #include "mimalloc.h"
 #include "osd.h"
 #include "polymost.h"
 #include "renderlayer.h"
+#include "sectorgrid.h"
+#include "sectorpvs.h"
+#include "tilepreload.h"
 
 #define MINICORO_IMPL
 #define MCO_LOG initprintf
@@ -148,6 +153,19 @@ static int osdfunc_bucketlist(osdcmdptr_t UNUSED(parm))
     return OSDCMD_OK;
 }
 
+static int osdfunc_sectorpvsinfo(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    auto const &stats = sectorpvs_stats;
+
+    LOG_F(INFO, "%u cansee() calls tested, %u rejected (%.1f%%), %u too long to test", stats.tests, stats.rejected,
+          stats.tests ? stats.rejected * 100.0 / stats.tests : 0.0, stats.unchecked);
+    LOG_F(INFO, "%u rows built, %u given up on", stats.rowsbuilt, stats.rowsgivenup);
+
+    return OSDCMD_OK;
+}
+
 static int osdfunc_heapinfo(osdcmdptr_t UNUSED(parm))
 {
     UNREFERENCED_CONST_PARAMETER(parm);
@@ -779,6 +797,8 @@ static int osdcmd_cvar_set_baselayer(osdcmdptr_t parm)
         if (r_maxfps > 0) r_maxfps = clamp(r_maxfps, 30, 1000);
         g_frameDelay = calcFrameDelay(r_maxfps);
     }
+    else if (!Bstrcasecmp(parm->name, "r_classicsimd"))
+        classicSimdInit();
     return r;
 }
 
@@ -798,6 +818,8 @@ int32_t baselayer_init(void)
         { "r_usenewaspect","enable/disable new screen aspect ratio determination code",(void *) &r_usenewaspect, CVAR_BOOL, 0, 1 },
         { "r_screenaspect","if using r_usenewaspect and in fullscreen, screen aspect ratio in the form XXYY, e.g. 1609 for 16:9",
           (void *) &r_screenxy, SCREENASPECT_CVAR_TYPE, 0, 9999 },
+        { "r_classicsimd","SIMD kernels used by the classic renderer: 0: scalar  1: SSE2  2: SSE4.1  3: AVX2 (if supported)",(void *) &r_classicsimd, CVAR_INT|CVAR_FUNCPTR, CLASSICSIMD_SCALAR, CLASSICSIMD_AVX2 },
+        { "r_classicthreads","number of threads used to fill the frame buffer in the classic renderer",(void *) &r_classicthreads, CVAR_INT, 1, MAXCLASSICTHREADS },
         { "r_fpgrouscan","use floating-point numbers for slope rendering",(void *) &r_fpgrouscan, CVAR_BOOL, 0, 1 },
         { "r_hightile","enable/disable hightile texture rendering",(void *) &usehightile, CVAR_BOOL, 0, 1 },
         { "r_novoxmips","turn off/on the use of mipmaps when rendering 8-bit voxels",(void *) &novoxmips, CVAR_BOOL, 0, 1 },
@@ -811,6 +833,15 @@ int32_t baselayer_init(void)
         { "vid_contrast","adjusts contrast component of gamma ramp",(void *) &g_videoContrast, CVAR_FLOAT|CVAR_FUNCPTR, 0, 10 },
         { "vid_brightness","adjusts brightness component of gamma ramp",(void *) &g_videoBrightness, CVAR_FLOAT|CVAR_FUNCPTR, -10, 10 },
         { "screenshot_dir", "Screenshot save path",  (void*)screenshot_dir, CVAR_STRING, 0, sizeof(screenshot_dir) - 1 },
+        { "sectorgrid", "enable/disable the sector grid used to find the sector containing a point",(void *) &sectorgrid_enabled, CVAR_BOOL, 0, 1 },
+        { "sectorgrid_check", "check every sector grid lookup against a scan of all sectors",(void *) &sectorgrid_check, CVAR_BOOL, 0, 1 },
+        { "sectorpvs", "enable/disable the sector visibility table used to skip cansee() checks between sectors that can't see each other",(void *) &sectorpvs_enabled, CVAR_BOOL, 0, 1 },
+        { "sectorpvs_check", "check every cansee() call rejected by the sector visibility table against a full cansee()",(void *) &sectorpvs_check, CVAR_BOOL, 0, 1 },
+        { "clipcache", "enable/disable reusing the wall lists gathered by a sprite's previous clipmove() and pushmove() calls",(void *) &clipcache_enabled, CVAR_BOOL, 0, 1 },
+        { "clipcache_check", "repeat every clipmove(), pushmove() and getzrange() call that has a cache owner without the cache and report differing results",(void *) &clipcache_check, CVAR_BOOL, 0, 1 },
+        { "actorprefetch_threads", "number of threads used to prepare the clipping and visibility data of moving actors at the start of a game tick",(void *) &actorprefetch_threads, CVAR_INT, 1, MAXACTORPREFETCHTHREADS },
+        { "vfs_mmap", "enable/disable reading files from memory-mapped views of the group and zip files holding them",(void *) &kfileview_enabled, CVAR_BOOL, 0, 1 },
+        { "tilepreload_threads", "number of threads used to read tiles and decode their replacement textures during level loads, 0 to load them on the main thread",(void *) &tilepreload_threads, CVAR_INT, 0, MAXTILEPRELOADTHREADS },
 #ifdef DEBUGGINGAIDS
         { "debug1","debug counter",(void *) &debug1, CVAR_FLOAT, -100000, 100000 },
         { "debug2","debug counter",(void *) &debug2, CVAR_FLOAT, -100000, 100000 },
@@ -846,6 +877,8 @@ int32_t baselayer_init(void)
     polymost_initosdfuncs();
 #endif
 
+    OSD_RegisterFunction("sectorpvsinfo", "sectorpvsinfo: displays sector visibility table statistics", osdfunc_sectorpvsinfo);
+
     for (native_t i = 0; i < NUMKEYS; i++)
         if (g_keyRemapTable[i] == 0)
             g_keyRemapTable[i] = i;
@@ -880,6 +880,9 @@ CANCEL:
             }
         }
 
+        // the editor changes walls in too many places to track them all
+        sectorGridInvalidate(-1);
+
         OSD_DispatchQueued();
 
         videoNextPage();
@@ -3886,6 +3889,8 @@ void overheadeditor(void)
             }
         }
 
+        sectorGridInvalidate(-1);
+
         if (resetsynctics)
         {
             resetsynctics = 0;
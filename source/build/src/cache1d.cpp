@@ -50,23 +50,62 @@ static int32_t lockrecip[200];
 cache1d g_cache;
 
 #if !defined DEBUG_ALLOCACHE_AS_MALLOC
-static int osdfunc_cacheinfo(osdcmdptr_t UNUSED(parm))
+static int osdfunc_cacheinfo(osdcmdptr_t parm)
 {
-    UNREFERENCED_CONST_PARAMETER(parm);
-
-    g_cache.report();
+    g_cache.report(parm->numparms < 1 || Bstrcasecmp(parm->parms[0], "stats"));
 
     return OSDCMD_OK;
 }
 
+// how many blocks of the free list of the size class of a request are tried before taking one from a larger class
+#define CACHE1D_CLASSPROBES 16
+
+// how many of the cheapest blocks evictToFit() tries as the start of a window before scanning the whole
+// cache, and how many blocks long such a window can be
+#define CACHE1D_EVICTSEEDS  64
+#define CACHE1D_EVICTWINDOW 4
+
+static FORCE_INLINE int sizeClass(int32_t const leng) { return 31 - libdivide::libdivide_count_leading_zeros32(leng); }
+
+static FORCE_INLINE bool isFree(cacheindex_t const &block) { return block.lock == &zerochar; }
+
+// Potential for eviction increases with
+//  - smaller item size
+//  - smaller lock byte value (but in [1 .. 199])
+static FORCE_INLINE int32_t evictCost(cacheindex_t const &block)
+{
+    uint8_t const lock = *block.lock;
+
+    if (lock == 0)
+        return 0;
+    else if (lock >= CACHE1D_LOCKED)
+        return INT32_MAX;
+
+    return mulscale32(block.leng + 65536, lockrecip[lock]);
+}
+
+static FORCE_INLINE int32_t heapKey(cacheindex_t const &block)
+{
+    int32_t const cost = evictCost(block);
+    return cost == INT32_MAX ? INT32_MAX : (int32_t)(((int64_t)cost << 12) / block.leng);
+}
+
 void cache1d::reset(void)
 {
     Bmemset(m_index, 0, m_maxBlocks * sizeof(cacheindex_t));
 
-    m_index[0].leng = m_totalSize;
-    m_index[0].lock = &zerochar;
+    for (auto &head : m_freeList)
+        head = -1;
+
+    m_freeClasses = 0;
+    m_numBlocks   = 0;
+    m_heapSize    = 0;
+    m_stats       = {};
+
+    m_firstBlock = newBlock();
+    m_index[m_firstBlock].leng = m_totalSize;
 
-    m_numBlocks = 1;
+    linkFree(m_firstBlock);
 }
 
 void cache1d::initBuffer(intptr_t dacachestart, uint32_t dacachesize, uint32_t minsize /*= 0*/)
@@ -76,7 +115,7 @@ void cache1d::initBuffer(intptr_t dacachestart, uint32_t dacachesize, uint32_t m
         for (int i = 1; i < 200; i++)
             lockrecip[i] = tabledivide32_noinline(1 << 28, 200 - i);
 
-        OSD_RegisterFunction("cacheinfo", "cacheinfo: displays cache statistics", osdfunc_cacheinfo);
+        OSD_RegisterFunction("cacheinfo", "cacheinfo [stats]: displays cache statistics, without the block listing if \"stats\" is given", osdfunc_cacheinfo);
 
         g_cacheInit = true;
     }
@@ -90,6 +129,7 @@ void cache1d::initBuffer(intptr_t dacachestart, uint32_t dacachesize, uint32_t m
     m_maxBlocks = MINCACHEINDEXSIZE;
     m_alignment = minsize >= MINCACHEBLOCKSIZE ? minsize : Bgetpagesize();
     m_index     = (cacheindex_t *)Xaligned_alloc(m_alignment, m_maxBlocks * sizeof(cacheindex_t));
+    m_heap      = (int32_t *)Xmalloc(m_maxBlocks * sizeof(int32_t));
 
     reset();
 
@@ -98,9 +138,9 @@ void cache1d::initBuffer(intptr_t dacachestart, uint32_t dacachesize, uint32_t m
 }
 
 // Dynamic cache resizing -- increase cache array size when full
-void cache1d::inc_and_check_cacnum(void)
+int cache1d::newBlock(void)
 {
-    if (++m_numBlocks >= m_maxBlocks)
+    if (m_numBlocks >= m_maxBlocks)
     {
         auto new_index = (cacheindex_t *)Xaligned_alloc(Bgetpagesize(), (m_maxBlocks + MINCACHEINDEXSIZE) * sizeof(cacheindex_t));
 
@@ -110,45 +150,362 @@ void cache1d::inc_and_check_cacnum(void)
         Xaligned_free(m_index);
         m_index = new_index;
         m_maxBlocks += MINCACHEINDEXSIZE;
+        m_heap = (int32_t *)Xrealloc(m_heap, m_maxBlocks * sizeof(int32_t));
         DLOG_F(INFO, "Cache size increased by %d to new max of %d entries", MINCACHEINDEXSIZE, m_maxBlocks);
     }
+
+    auto &block = m_index[m_numBlocks];
+
+    block = {};
+    block.lock    = &zerochar;
+    block.prev    = block.next  = -1;
+    block.fprev   = block.fnext = -1;
+    block.heappos = -1;
+
+    return m_numBlocks++;
 }
 
-int32_t cache1d::findBlock(int32_t const newbytes, int32_t * const besto, int32_t * const bestz)
+// Removes a block that is no longer linked to anything by moving the last one into its slot.
+// Returns the index that block keep has afterwards.
+int cache1d::deleteBlock(int const block, int const keep)
 {
-    int32_t bestval = INT32_MAX;
+    int const last = --m_numBlocks;
+
+    if (block != last)
+    {
+        auto &moved = m_index[block];
+
+        moved = m_index[last];
+
+        if (moved.prev >= 0)
+            m_index[moved.prev].next = block;
+        else
+            m_firstBlock = block;
+
+        if (moved.next >= 0)
+            m_index[moved.next].prev = block;
+
+        // the block may be in the middle of being merged, and so in neither a free list nor the heap
+        if (moved.fprev >= 0)
+            m_index[moved.fprev].fnext = block;
+        else if (isFree(moved) && m_freeList[sizeClass(moved.leng)] == last)
+            m_freeList[sizeClass(moved.leng)] = block;
+
+        if (moved.fnext >= 0)
+            m_index[moved.fnext].fprev = block;
+
+        if (moved.heappos >= 0)
+            m_heap[moved.heappos] = block;
+    }
+
+    m_index[last] = {};
+    m_index[last].lock = &zerochar;
+
+    return keep == last ? block : keep;
+}
+
+void cache1d::linkFree(int const block)
+{
+    auto &b = m_index[block];
+    int const c = sizeClass(b.leng);
+
+    b.lock    = &zerochar;
+    b.hand    = nullptr;
+    b.ovh     = 0;
+    b.heappos = -1;
+    b.fprev   = -1;
+    b.fnext   = m_freeList[c];
+
+    if (b.fnext >= 0)
+        m_index[b.fnext].fprev = block;
+
+    m_freeList[c] = block;
+    m_freeClasses |= 1u << c;
+}
+
+void cache1d::unlinkFree(int const block)
+{
+    auto &b = m_index[block];
+    int const c = sizeClass(b.leng);
+
+    if (b.fprev >= 0)
+        m_index[b.fprev].fnext = b.fnext;
+    else if ((m_freeList[c] = b.fnext) < 0)
+        m_freeClasses &= ~(1u << c);
+
+    if (b.fnext >= 0)
+        m_index[b.fnext].fprev = b.fprev;
+
+    b.fprev = b.fnext = -1;
+}
+
+int cache1d::findFree(int32_t const newbytes)
+{
+    int const c = sizeClass(newbytes);
+
+    // the class of the request also holds blocks smaller than it
+    int probes = CACHE1D_CLASSPROBES;
+
+    for (int block = m_freeList[c]; block >= 0 && probes--; block = m_index[block].fnext)
+        if (m_index[block].leng >= newbytes)
+            return block;
+
+    // while any block of a larger class will do
+    uint32_t const larger = c < CACHE1D_SIZECLASSES-1 ? m_freeClasses & ~((2u << c) - 1) : 0;
+
+    if (!larger)
+        return -1;
+
+    return m_freeList[sizeClass(larger & (0u - larger))];
+}
+
+void cache1d::heapSiftUp(int pos)
+{
+    int const block = m_heap[pos];
+    int32_t const cost = m_index[block].cost;
+
+    while (pos > 0)
+    {
+        int const parent = (pos - 1) >> 1;
+
+        if (m_index[m_heap[parent]].cost <= cost)
+            break;
+
+        m_heap[pos] = m_heap[parent];
+        m_index[m_heap[pos]].heappos = pos;
+        pos = parent;
+    }
+
+    m_heap[pos] = block;
+    m_index[block].heappos = pos;
+}
+
+void cache1d::heapSiftDown(int pos)
+{
+    int const block = m_heap[pos];
+    int32_t const cost = m_index[block].cost;
+
+    for (int child; (child = (pos << 1) + 1) < m_heapSize; pos = child)
+    {
+        if (child + 1 < m_heapSize && m_index[m_heap[child + 1]].cost < m_index[m_heap[child]].cost)
+            child++;
+
+        if (cost <= m_index[m_heap[child]].cost)
+            break;
+
+        m_heap[pos] = m_heap[child];
+        m_index[m_heap[pos]].heappos = pos;
+    }
+
+    m_heap[pos] = block;
+    m_index[block].heappos = pos;
+}
+
+void cache1d::heapPush(int const block)
+{
+    m_index[block].cost = heapKey(m_index[block]);
+    m_heap[m_heapSize] = block;
+    heapSiftUp(m_heapSize++);
+}
+
+void cache1d::heapRemove(int const block)
+{
+    int const pos  = m_index[block].heappos;
+    int const last = m_heap[--m_heapSize];
+
+    m_index[block].heappos = -1;
+
+    if (pos == m_heapSize)
+        return;
+
+    m_heap[pos] = last;
+    m_index[last].heappos = pos;
+    heapSiftUp(pos);
+    heapSiftDown(m_index[last].heappos);
+}
+
+// brings the key of the block up to date with its lock byte
+void cache1d::heapUpdate(int const block)
+{
+    auto &b = m_index[block];
+    int32_t const cost = heapKey(b);
+
+    if (cost == b.cost)
+        return;
+
+    bool const up = cost < b.cost;
+
+    b.cost = cost;
+
+    if (up)
+        heapSiftUp(b.heappos);
+    else
+        heapSiftDown(b.heappos);
+}
+
+void cache1d::heapRebuild(void)
+{
+    for (int pos = 0; pos < m_heapSize; pos++)
+        m_index[m_heap[pos]].cost = heapKey(m_index[m_heap[pos]]);
+
+    for (int pos = (m_heapSize >> 1) - 1; pos >= 0; pos--)
+        heapSiftDown(pos);
+}
+
+// Takes an allocated block out of the cache and merges it with the free blocks around it.
+// Returns the index of the resulting free block.
+int cache1d::evictBlock(int block)
+{
+    heapRemove(block);
 
-    for (native_t z=m_numBlocks-1, o1=m_totalSize; z>=0; z--)
     {
-        o1 -= m_index[z].leng;
+        auto &b = m_index[block];
+
+        if (*b.lock)
+            *b.hand = 0;
+
+        m_stats.evictions++;
+        m_stats.evictedBytes += b.leng;
+    }
+
+    int const next = m_index[block].next;
+
+    if (next >= 0 && isFree(m_index[next]))
+    {
+        unlinkFree(next);
+
+        auto &b = m_index[block];
 
-        int32_t const o2 = o1 + newbytes;
+        b.leng += m_index[next].leng;
+        b.next  = m_index[next].next;
+
+        if (b.next >= 0)
+            m_index[b.next].prev = block;
+
+        block = deleteBlock(next, block);
+    }
+
+    int const prev = m_index[block].prev;
+
+    if (prev >= 0 && isFree(m_index[prev]))
+    {
+        unlinkFree(prev);
+
+        auto &p = m_index[prev];
+
+        p.leng += m_index[block].leng;
+        p.next  = m_index[block].next;
+
+        if (p.next >= 0)
+            m_index[p.next].prev = prev;
+
+        block = deleteBlock(block, prev);
+    }
+
+    linkFree(block);
+
+    return block;
+}
 
-        if (o2 > m_totalSize)
+// Looks for the cheapest window big enough for the request that starts at one of the few cheapest blocks
+// in the heap, or at the free block right before one, and evicts it. Windows are weighed like findBlock()
+// does, but only those are looked at, and only up to a number of blocks long.
+int cache1d::evictToFit(int32_t const newbytes)
+{
+    int     seeds[CACHE1D_EVICTSEEDS];
+    int     numSeeds  = 0;
+    int     beststart = -1;
+    int32_t bestval   = INT32_MAX;
+    bool    refreshed = false;
+
+    while (m_heapSize > 0 && numSeeds < CACHE1D_EVICTSEEDS)
+    {
+        int const block = m_heap[0];
+        auto &b = m_index[block];
+
+        if (heapKey(b) != b.cost)
+        {
+            heapUpdate(block);
+            continue;
+        }
+
+        if (b.cost == INT32_MAX)
+        {
+            // everything left was locked when last looked at, but may not be anymore
+            if (refreshed)
+                break;
+
+            heapRebuild();
+            refreshed = true;
+            continue;
+        }
+
+        heapRemove(block);
+        seeds[numSeeds++] = block;
+
+        int const start = b.prev >= 0 && isFree(m_index[b.prev]) ? b.prev : block;
+        int32_t const end = m_index[start].offset + newbytes;
+
+        if (end > m_totalSize)
             continue;
 
         int32_t daval = 0;
 
-        for (native_t i=o1, zz=z; i<o2; i+=m_index[zz++].leng)
+        for (int32_t zz = start, n = 0, o = m_index[start].offset; o < end; o += m_index[zz].leng, zz = m_index[zz].next)
         {
-            if (*m_index[zz].lock == 0)
-                continue;
-            else if (*m_index[zz].lock >= CACHE1D_LOCKED)
+            int32_t const cost = evictCost(m_index[zz]);
+
+            if (n++ == CACHE1D_EVICTWINDOW || cost == INT32_MAX || (daval += cost) >= bestval)
             {
                 daval = INT32_MAX;
                 break;
             }
+        }
+
+        if (daval < bestval)
+        {
+            bestval   = daval;
+            beststart = start;
+        }
+    }
 
-            // Potential for eviction increases with
-            //  - smaller item size
-            //  - smaller lock byte value (but in [1 .. 199])
-            daval += mulscale32(m_index[zz].leng + 65536, lockrecip[*m_index[zz].lock]);
+    // put them back before evicting anything, which can move blocks to other slots
+    for (int i = 0; i < numSeeds; i++)
+        heapPush(seeds[i]);
 
-            if (daval >= bestval)
-                break;
+    return beststart >= 0 ? takeWindow(newbytes, beststart) : -1;
+}
+
+// Finds the cheapest window of the given size in the whole cache. The window slides along the blocks
+// in address order, so that every block is added to and taken out of its sum once.
+int32_t cache1d::findBlock(int32_t const newbytes, int32_t * const besto, int32_t * const bestz)
+{
+    int32_t bestval = INT32_MAX;
+    int64_t daval   = 0;
+    int     locked  = 0;
+
+    // the window holds the blocks from z up to but not including zz, which end at o2
+    native_t zz = m_firstBlock;
+    int32_t  o2 = 0;
+
+    for (native_t z=m_firstBlock; z>=0; z=m_index[z].next)
+    {
+        int32_t const o1 = m_index[z].offset;
+
+        if (o1 + newbytes > m_totalSize)
+            break;
+
+        for (; o2 < o1 + newbytes; o2 += m_index[zz].leng, zz = m_index[zz].next)
+        {
+            int32_t const cost = evictCost(m_index[zz]);
+
+            if (cost == INT32_MAX)
+                locked++;
+            else
+                daval += cost;
         }
 
-        if (daval < bestval)
+        if (!locked && daval < bestval)
         {
             bestval = daval;
             *besto  = o1;
@@ -157,6 +514,13 @@ int32_t cache1d::findBlock(int32_t const newbytes, int32_t * const besto, int32_
             if (bestval == 0)
                 break;
         }
+
+        int32_t const cost = evictCost(m_index[z]);
+
+        if (cost == INT32_MAX)
+            locked--;
+        else
+            daval -= cost;
     }
 
     return bestval;
@@ -183,6 +547,63 @@ void cache1d::tryHarder(int32_t const newbytes, int32_t *const besto, int32_t *c
     }
 }
 
+// Evicts everything in the window of the given size starting at the given block.
+// Returns the index of the free block that covers the window.
+int cache1d::takeWindow(int32_t const newbytes, int const first)
+{
+    int32_t const end = m_index[first].offset + newbytes;
+    int block = first;
+
+    do
+    {
+        if (!isFree(m_index[block]))
+            block = evictBlock(block);
+
+        if (m_index[block].offset + m_index[block].leng >= end)
+            return block;
+    } while ((block = m_index[block].next) >= 0);
+
+    // findBlock() only returns windows that fit in the cache
+    return -1;
+}
+
+// Allocates a free block that is big enough from its low end, putting the rest back into the free lists.
+void cache1d::placeBlock(int const block, intptr_t *newhandle, int32_t const newbytes, char *newlockptr, int32_t const askedbytes)
+{
+    unlinkFree(block);
+
+    if (int32_t const rest = m_index[block].leng - newbytes)
+    {
+        int const r = newBlock();
+        auto &b = m_index[block];
+        auto &rem = m_index[r];
+
+        rem.offset = b.offset + newbytes;
+        rem.leng   = rest;
+        rem.prev   = block;
+        rem.next   = b.next;
+
+        if (b.next >= 0)
+            m_index[b.next].prev = r;
+
+        b.next = r;
+        b.leng = newbytes;
+
+        // the block after it isn't free, or it would have been merged with this one
+        linkFree(r);
+    }
+
+    auto &found = m_index[block];
+
+    found.hand  = newhandle;
+    found.lock  = newlockptr;
+    found.ovh   = newbytes-askedbytes;
+
+    *newhandle = m_baseAddress + found.offset;
+
+    heapPush(block);
+}
+
 void cache1d::allocateBlock(intptr_t* newhandle, int32_t newbytes, char* newlockptr)
 {
     // Make all requests a multiple of the minimum block size
@@ -209,67 +630,30 @@ void cache1d::allocateBlock(intptr_t* newhandle, int32_t newbytes, char* newlock
         fatal_exit("BUFFER TOO BIG TO FIT IN CACHE!");
     }
 
-    int32_t bestz = 0;
-    int32_t besto = 0;
-
-    // if we can't find a block, try to age the cache until we can
-    // it's better than the alternative of aborting the entire program
-    
-    if (findBlock(newbytes, &besto, &bestz) == INT32_MAX)
-        tryHarder(newbytes, &besto, &bestz);
+    m_stats.allocs++;
 
-    //printf("%d %d %d\n",besto,newbytes,*newlockptr);
+    int block = findFree(newbytes);
 
-    //Suck things out
-    int32_t sucklen = -newbytes;
-    int32_t suckz = bestz;
-
-    for (;sucklen<0; sucklen+=m_index[suckz++].leng)
-        if (*m_index[suckz].lock)
-            *m_index[suckz].hand = 0;
-
-    //Remove all blocks except 1
-    suckz -= bestz+1;
-    m_numBlocks -= suckz;
-
-    auto &found = m_index[bestz];
-
-    Bmemmove(&found, &m_index[bestz + suckz], (m_numBlocks - bestz) * sizeof(cacheindex_t));
-
-    found.hand  = newhandle;
-    found.leng  = newbytes;
-    found.lock  = newlockptr;
-    found.ovh   = newbytes-askedbytes;
-
-    *newhandle = m_baseAddress + besto;
-
-    //Add new empty block if necessary
-    if (sucklen <= 0)
-        return;
-
-    if (++bestz == m_numBlocks)
+    if (block >= 0)
+        m_stats.freeHits++;
+    else if ((block = evictToFit(newbytes)) >= 0)
+        m_stats.evictHits++;
+    else
     {
-        inc_and_check_cacnum();
-        m_index[bestz].leng = sucklen;
-        m_index[bestz].lock = &zerochar;
-        return;
-    }
+        int32_t bestz = 0;
+        int32_t besto = 0;
 
-    auto &rem = m_index[bestz];
+        // if we can't find a block, try to age the cache until we can
+        // it's better than the alternative of aborting the entire program
 
-    if (*rem.lock == 0)
-    {
-        rem.leng += sucklen;
-        return;
-    }
-
-    inc_and_check_cacnum();
+        if (findBlock(newbytes, &besto, &bestz) == INT32_MAX)
+            tryHarder(newbytes, &besto, &bestz);
 
-    for (native_t z=m_numBlocks-1; z>bestz; z--)
-        m_index[z] = m_index[z-1];
+        block = takeWindow(newbytes, bestz);
+        m_stats.scanMisses++;
+    }
 
-    rem.leng = sucklen;
-    rem.lock = &zerochar;
+    placeBlock(block, newhandle, newbytes, newlockptr, askedbytes);
 }
 
 void cache1d::ageBlocks(void)
@@ -283,13 +667,19 @@ void cache1d::ageBlocks(void)
 
     while(cnt--)
     {
+        auto &b = m_index[agecount];
+
         // If we have pointer to lock char and it's in [2 .. 199], decrease.
-        if (m_index[agecount].lock)
+        if (b.lock)
         {
-             if ((((*m_index[agecount].lock)-2)&255) < CACHE1D_UNLOCKED-1)
-                (*m_index[agecount].lock)--;
-             else if (*m_index[agecount].lock == CACHE1D_PERMANENT)
+             if ((((*b.lock)-2)&255) < CACHE1D_UNLOCKED-1)
+                (*b.lock)--;
+             else if (*b.lock == CACHE1D_PERMANENT)
                  cnt++;
+
+             // the lock bytes of the blocks also change without the cache knowing, so catch up on those as well
+             if (!isFree(b))
+                 heapUpdate(agecount);
         }
 
         if (--agecount < 0)
@@ -297,74 +687,85 @@ void cache1d::ageBlocks(void)
     }
 }
 
-void cache1d::report(void)
+void cache1d::report(bool const listBlocks /*= true*/)
 {
     int32_t usedSize = 0;
     int32_t unusable = 0;
+    int32_t freeSize = 0, freeBlocks = 0, largestFree = 0;
     inthashtable_t h_blocktotile = { nullptr, INTHASH_SIZE(m_maxBlocks) };
     
-    inthash_init(&h_blocktotile);
-    
-    for (native_t j = 0; j < MAXTILES-1; j++)
+    if (listBlocks)
     {
-        if (waloff[j])
-            inthash_add(&h_blocktotile, waloff[j], j, true);
-
-        if (classicht[j].ptr)
-            inthash_add(&h_blocktotile, classicht[j].ptr, j, true);
+        inthash_init(&h_blocktotile);
 
-        if (tiletovox[j] != -1)
+        for (native_t j = 0; j < MAXTILES-1; j++)
         {
-            for (int i=0; i<MAXVOXMIPS; i++)
-                if (voxoff[tiletovox[j]][i])
-                    inthash_add(&h_blocktotile, (intptr_t)voxoff[tiletovox[j]][i], j, true);
+            if (waloff[j])
+                inthash_add(&h_blocktotile, waloff[j], j, true);
+
+            if (classicht[j].ptr)
+                inthash_add(&h_blocktotile, classicht[j].ptr, j, true);
+
+            if (tiletovox[j] != -1)
+            {
+                for (int i=0; i<MAXVOXMIPS; i++)
+                    if (voxoff[tiletovox[j]][i])
+                        inthash_add(&h_blocktotile, (intptr_t)voxoff[tiletovox[j]][i], j, true);
+            }
         }
+
+        LOG_F(INFO, "Block listing:");
     }
 
-    LOG_F(INFO, "Block listing:");
-    
     int constexpr reportLineSize = 128;
     auto buf = (char*)Balloca(reportLineSize);
 
-    for (int i = 0; i < m_numBlocks-1; i++)
+    for (int i = 0, z = m_firstBlock; z >= 0; i++, z = m_index[z].next)
     {
-        buf[0] = '\0';
-        int len = Bsnprintf(buf, reportLineSize, "%4d ", i);
+        auto const &b = m_index[z];
 
-        if (m_index[i].hand)            
+        if (isFree(b))
         {
-            len += Bsnprintf(buf+len, reportLineSize-len, "@ %x: ", (int32_t)(*m_index[i].hand - m_baseAddress));
+            freeSize += b.leng;
+            freeBlocks++;
+            largestFree = max(largestFree, b.leng);
         }
         else
         {
-            Bstrcat(buf, "FREE");
-            LOG_F(INFO, "%s", buf);
-            continue;
+            unusable += b.ovh;
+
+            if (*b.lock)
+                usedSize += b.leng;
         }
 
-        len += Bsnprintf(buf+len, reportLineSize-len, "SIZ:%5d ", m_index[i].leng);
-        unusable += m_index[i].ovh;
+        if (!listBlocks)
+            continue;
 
-        len += Bsnprintf(buf+len, reportLineSize-len, "USE:%5d ", m_index[i].leng-m_index[i].ovh);
+        buf[0] = '\0';
+        int len = Bsnprintf(buf, reportLineSize, "%4d ", i);
 
-        len += Bsnprintf(buf+len, reportLineSize-len, "DEAD:%4d ", m_index[i].ovh);
-        
-        if (m_index[i].lock)
+        if (b.hand)            
         {
-            len += Bsnprintf(buf+len, reportLineSize-len, "LCK:%d ", *m_index[i].lock);
-
-            if (*m_index[i].lock)
-                usedSize += m_index[i].leng;
+            len += Bsnprintf(buf+len, reportLineSize-len, "@ %x: ", (int32_t)(*b.hand - m_baseAddress));
         }
         else
-            len += Bsnprintf(buf+len, reportLineSize-len, "LCK:NULL ");
+        {
+            Bstrcat(buf, "FREE");
+            LOG_F(INFO, "%s", buf);
+            continue;
+        }
+
+        len += Bsnprintf(buf+len, reportLineSize-len, "SIZ:%5d ", b.leng);
+        len += Bsnprintf(buf+len, reportLineSize-len, "USE:%5d ", b.leng-b.ovh);
+        len += Bsnprintf(buf+len, reportLineSize-len, "DEAD:%4d ", b.ovh);
+        len += Bsnprintf(buf+len, reportLineSize-len, "LCK:%d ", *b.lock);
 
-        int const tile = inthash_find(&h_blocktotile, *m_index[i].hand);
+        int const tile = inthash_find(&h_blocktotile, *b.hand);
 
         if (tile != -1)
         {
-            auto typestr = *m_index[i].hand == waloff[tile] ? "ART:%4d " :
-                           *m_index[i].hand == classicht[tile].ptr ? "HI:%4d " :
+            auto typestr = *b.hand == waloff[tile] ? "ART:%4d " :
+                           *b.hand == classicht[tile].ptr ? "HI:%4d " :
                            "VOX:%4d "; // needs to be last or else we have to loop through voxoff[tile][]
                 
             len += Bsnprintf(buf + len, reportLineSize - len, typestr, tile);
@@ -383,7 +784,19 @@ void cache1d::report(void)
 
     LOG_F(INFO, "%d KB (%.2f%%) space made unusable by block alignment.", unusable >> 10, (float)unusable / m_totalSize * 100.f);
 
-    inthash_free(&h_blocktotile);
+    // fragmentation is the share of the free space that isn't in the largest free block
+    LOG_F(INFO, "Free:        %dKB in %d blocks, largest %dKB, %.2f%% fragmented", freeSize >> 10, freeBlocks, largestFree >> 10,
+          freeSize ? (float)(freeSize - largestFree) / freeSize * 100.f : 0.f);
+
+    auto const &s = m_stats;
+    float const pct = s.allocs ? 100.f / s.allocs : 0.f;
+
+    LOG_F(INFO, "Allocations: %u, %u (%.2f%%) hit a free block, %u (%.2f%%) missed and evicted the cheapest blocks, %u (%.2f%%) missed and scanned the cache",
+          s.allocs, s.freeHits, s.freeHits * pct, s.evictHits, s.evictHits * pct, s.scanMisses, s.scanMisses * pct);
+    LOG_F(INFO, "Evictions:   %u blocks, %" PRIu64 "KB", s.evictions, s.evictedBytes >> 10);
+
+    if (listBlocks)
+        inthash_free(&h_blocktotile);
 }
 #else
 void cache1d::initBuffer(intptr_t dacachestart, uint32_t dacachesize, uint32_t minsize /*= 0*/)
@@ -400,6 +813,6 @@ void cache1d::allocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlock
 }
 
 void cache1d::ageBlocks(void) {}
-void cache1d::report(void) {}
+void cache1d::report(bool /*listBlocks = true*/) {}
 void cache1d::reset(void) {}
 #endif
@@ -0,0 +1,571 @@
+// classicstrips.cpp
+//  Deferred, strip-parallel pixel fill for the classic renderer.
+//  See classicstrips.h for an overview.
+
+#include "a.h"
+#include "build.h"
+#include "classicstrips.h"
+#include "libasync_config.h"
+#include "microprofile.h"
+
+int32_t r_classicthreads = 1;
+int32_t classicstrips_active;
+
+enum
+{
+    STRIPCMD_VLINE,
+    STRIPCMD_VLINE4,
+    STRIPCMD_HLINE,
+    STRIPCMD_SLOPE,
+    STRIPCMD_FSLOPE,
+};
+
+typedef struct
+{
+    uint8_t type;
+    int8_t logx, logy;
+    int32_t x, cnt;   // leftmost frame buffer column, pixel count
+    intptr_t p;       // first pixel written (rightmost one for hlines)
+
+    union
+    {
+        struct { intptr_t pal, buf; uint32_t vplc; int32_t vinc, tilesizy; } v;
+        struct { intptr_t pal[4], buf[4]; uint32_t vplc[4]; int32_t vinc[4], tilesizy; } v4;
+        struct { intptr_t pal, buf; uint32_t bx, by; int32_t xinc, yinc; } h;
+        struct { intptr_t buf; int32_t bx, by, bz, bzinc, x3, y3, pinc; uint32_t slopal; } s;
+        struct { fslopecol_t col; uint32_t slopal; } fs;
+    };
+} stripcmd_t;
+
+static stripcmd_t *stripcmd;
+static int32_t numstripcmds, maxstripcmds;
+
+// copies of the slopalookup[] runs referenced by STRIPCMD_SLOPE/STRIPCMD_FSLOPE
+static intptr_t *stripslopal;
+static uint32_t numstripslopal, maxstripslopal;
+
+static intptr_t stripframeplace;
+static int32_t stripbpl;
+
+// A command as seen by one strip. For hlines, [lo, hi] is the range of pixel
+// indices that fall into the strip; for vline4s, the range of its columns.
+typedef struct
+{
+    int32_t cmd;
+    int16_t lo, hi;
+} stripref_t;
+
+// Everything a worker touches besides the command list: its own column
+// window, its own clipped view of the commands and the frame layout.
+typedef struct
+{
+    int32_t x1, x2;   // frame buffer columns [x1, x2)
+    int32_t bpl;
+
+    stripref_t *ref;
+    int32_t numrefs, maxrefs;
+} stripworker_t;
+
+static stripworker_t stripworker[MAXCLASSICTHREADS];
+static int32_t stripwidth;
+
+static async::threadpool_scheduler *strippool;
+static int32_t strippoolthreads;
+
+static FORCE_INLINE int32_t stripcolumn(intptr_t p) { return (int32_t)((p - stripframeplace) % stripbpl); }
+
+static stripcmd_t *stripcmd_new(uint8_t type, intptr_t p)
+{
+    if (EDUKE32_PREDICT_FALSE(numstripcmds == maxstripcmds))
+    {
+        maxstripcmds = max(maxstripcmds << 1, 4096);
+        stripcmd = (stripcmd_t *)Xrealloc(stripcmd, maxstripcmds * sizeof(stripcmd_t));
+    }
+
+    auto cmd  = &stripcmd[numstripcmds++];
+    cmd->type = type;
+    cmd->p    = p;
+    cmd->x    = stripcolumn(p);
+
+    return cmd;
+}
+
+// Stores slopalptr[0], slopalptr[-1] ... slopalptr[-(cnt-1)] and returns the
+// index of the copy of slopalptr[0], so that the copy can be walked backwards
+// the same way as the original.
+static uint32_t stripslopal_copy(intptr_t const *slopalptr, int32_t cnt)
+{
+    if (EDUKE32_PREDICT_FALSE(numstripslopal + cnt > maxstripslopal))
+    {
+        maxstripslopal = max((numstripslopal + cnt) << 1, 65536u);
+        stripslopal = (intptr_t *)Xrealloc(stripslopal, maxstripslopal * sizeof(intptr_t));
+    }
+
+    Bmemcpy(&stripslopal[numstripslopal], slopalptr - (cnt - 1), cnt * sizeof(intptr_t));
+    numstripslopal += cnt;
+
+    return numstripslopal - 1;
+}
+
+static FORCE_INLINE uint32_t mulscale32u(uint32_t a, uint32_t b) { return ((uint64_t)a * b) >> 32; }
+
+//
+// recording
+//
+
+// cnt+1 iterations, like vlineasm1()
+uint32_t classicStripsVline(int32_t vinc, intptr_t pal, int32_t cnt, uint32_t vplc, intptr_t buf, intptr_t p,
+                            int32_t logy, int32_t tilesizy)
+{
+    auto cmd = stripcmd_new(STRIPCMD_VLINE, p);
+
+    cmd->cnt        = cnt + 1;
+    cmd->logy       = logy;
+    cmd->v.pal      = pal;
+    cmd->v.buf      = buf;
+    cmd->v.vplc     = vplc;
+    cmd->v.vinc     = vinc;
+    cmd->v.tilesizy = tilesizy;
+
+    return vplc + (uint32_t)vinc * (uint32_t)cmd->cnt;
+}
+
+// cnt iterations, like vlineasm4()
+void classicStripsVline4(int32_t cnt, intptr_t p, intptr_t const *pal, intptr_t const *buf, uint32_t *vplc,
+                         int32_t const *vinc, int32_t logy, int32_t tilesizy)
+{
+    auto cmd = stripcmd_new(STRIPCMD_VLINE4, p);
+
+    cmd->cnt         = cnt;
+    cmd->logy        = logy;
+    cmd->v4.tilesizy = tilesizy;
+
+    for (int i = 0; i < 4; i++)
+    {
+        cmd->v4.pal[i]  = pal[i];
+        cmd->v4.buf[i]  = buf[i];
+        cmd->v4.vplc[i] = vplc[i];
+        cmd->v4.vinc[i] = vinc[i];
+
+        vplc[i] += (uint32_t)vinc[i] * (uint32_t)cnt;
+    }
+}
+
+// cnt+1 pixels leftwards from p, like hlineasm4()
+void classicStripsHline(int32_t cnt, intptr_t pal, uint32_t by, uint32_t bx, intptr_t p, intptr_t buf,
+                        int32_t xinc, int32_t yinc, int32_t logx, int32_t logy)
+{
+    auto cmd = stripcmd_new(STRIPCMD_HLINE, p);
+
+    cmd->cnt    = cnt + 1;
+    cmd->x     -= cnt;
+    cmd->logx   = logx;
+    cmd->logy   = logy;
+    cmd->h.pal  = pal;
+    cmd->h.buf  = buf;
+    cmd->h.bx   = bx;
+    cmd->h.by   = by;
+    cmd->h.xinc = xinc;
+    cmd->h.yinc = yinc;
+}
+
+// cnt iterations, like slopevlin()
+void classicStripsSlopevlin(intptr_t p, intptr_t const *slopalptr, int32_t cnt, int32_t bx, int32_t by,
+                            int32_t bz, int32_t bzinc, int32_t x3, int32_t y3, intptr_t buf, int32_t pinc,
+                            int32_t logx, int32_t logy)
+{
+    if (cnt <= 0)
+        return;
+
+    auto cmd = stripcmd_new(STRIPCMD_SLOPE, p);
+
+    cmd->cnt      = cnt;
+    cmd->logx     = logx;
+    cmd->logy     = logy;
+    cmd->s.buf    = buf;
+    cmd->s.bx     = bx;
+    cmd->s.by     = by;
+    cmd->s.bz     = bz;
+    cmd->s.bzinc  = bzinc;
+    cmd->s.x3     = x3;
+    cmd->s.y3     = y3;
+    cmd->s.pinc   = pinc;
+    cmd->s.slopal = stripslopal_copy(slopalptr, cnt);
+}
+
+void classicStripsFSlope(fslopecol_t const &col, intptr_t p, intptr_t const *slopalptr, int32_t cnt)
+{
+    if (cnt <= 0)
+        return;
+
+    auto cmd = stripcmd_new(STRIPCMD_FSLOPE, p);
+
+    cmd->cnt       = cnt;
+    cmd->fs.col    = col;
+    cmd->fs.slopal = stripslopal_copy(slopalptr, cnt);
+}
+
+//
+// drawing
+//
+
+#define LINTERPSIZ 4
+
+template <int mode>
+static void fslopecolumn(fslopecol_t const &col, uint8_t *p, intptr_t const *slopalptr, int32_t cnt)
+{
+    const uint8_t *const A_C_RESTRICT buf   = (const uint8_t *)col.buf;
+    const uint8_t *const A_C_RESTRICT trans = (const uint8_t *)col.trans;
+    int32_t const logx = col.logx, logy = col.logy, pinc = col.pinc;
+
+    float bz = col.bz;
+    int u0 = Blrintf(1048576.f*col.x3/bz);
+    int v0 = Blrintf(1048576.f*col.y3/bz);
+
+    while (cnt > 0)
+    {
+        bz += col.bzinc*(1<<LINTERPSIZ);
+        int u1 = Blrintf(1048576.f*col.x3/bz);
+        int v1 = Blrintf(1048576.f*col.y3/bz);
+        u1 = (u1-u0)>>LINTERPSIZ;
+        v1 = (v1-v0)>>LINTERPSIZ;
+        int cnt2 = min(cnt, 1<<LINTERPSIZ);
+        for (; cnt2>0; cnt2--)
+        {
+            uint32_t const u = (col.x1+u0)&0xffff;
+            uint32_t const v = (col.y1+v0)&0xffff;
+            uint8_t ch = buf[((u>>(16-logx))<<logy)+(v>>(16-logy))];
+
+            if (mode == 0)
+                *p = *(uint8_t *)(slopalptr[0]+ch);
+            else if (ch != 255)
+            {
+                ch = *(uint8_t *)(slopalptr[0]+ch);
+
+                if (mode == 128)
+                    *p = ch;
+                else if (mode == 256)
+                    *p = trans[(*p<<8)|ch];
+                else
+                    *p = trans[ch<<8|*p];
+            }
+
+            slopalptr--;
+            p += pinc;
+            u0 += u1;
+            v0 += v1;
+        }
+        cnt -= 1<<LINTERPSIZ;
+    }
+}
+
+#undef LINTERPSIZ
+
+void classicFSlopeColumn(fslopecol_t const &col, uint8_t *p, intptr_t const *slopalptr, int32_t cnt)
+{
+    switch (col.mode)
+    {
+    case 0:   fslopecolumn<0>(col, p, slopalptr, cnt); break;
+    case 128: fslopecolumn<128>(col, p, slopalptr, cnt); break;
+    case 256: fslopecolumn<256>(col, p, slopalptr, cnt); break;
+    case 384: fslopecolumn<384>(col, p, slopalptr, cnt); break;
+    }
+}
+
+static void stripvline(char *p, const char *pal, const char *buf, uint32_t vplc, int32_t vinc, int32_t cnt,
+                       int32_t logy, int32_t tilesizy, int32_t bpl)
+{
+    if (logy)
+    {
+        for (; cnt > 0; cnt--, p += bpl, vplc += vinc)
+            *p = pal[(uint8_t)buf[vplc>>logy]];
+    }
+    else
+    {
+        for (; cnt > 0; cnt--, p += bpl, vplc += vinc)
+            *p = pal[(uint8_t)buf[mulscale32u(vplc, tilesizy)]];
+    }
+}
+
+static void stripvline4(stripcmd_t const &cmd, int32_t bpl)
+{
+    char *const A_C_RESTRICT pal[4] = { (char *)cmd.v4.pal[0], (char *)cmd.v4.pal[1], (char *)cmd.v4.pal[2], (char *)cmd.v4.pal[3] };
+    char *const A_C_RESTRICT buf[4] = { (char *)cmd.v4.buf[0], (char *)cmd.v4.buf[1], (char *)cmd.v4.buf[2], (char *)cmd.v4.buf[3] };
+    uint32_t vplc[4] = { cmd.v4.vplc[0], cmd.v4.vplc[1], cmd.v4.vplc[2], cmd.v4.vplc[3] };
+    int32_t const logy = cmd.logy;
+    char *p = (char *)cmd.p;
+
+    if (!logy)
+    {
+        for (int i = 0; i < 4; i++)
+            stripvline(p + i, pal[i], buf[i], vplc[i], cmd.v4.vinc[i], cmd.cnt, 0, cmd.v4.tilesizy, bpl);
+        return;
+    }
+
+    if (classicsimd.vline4)
+    {
+        classicsimd.vline4(p, cmd.v4.pal, cmd.v4.buf, vplc, cmd.v4.vinc, logy, bpl, cmd.cnt);
+        return;
+    }
+
+    for (int32_t cnt = cmd.cnt; cnt > 0; cnt--, p += bpl)
+    {
+        p[0] = pal[0][(uint8_t)buf[0][vplc[0]>>logy]];
+        p[1] = pal[1][(uint8_t)buf[1][vplc[1]>>logy]];
+        p[2] = pal[2][(uint8_t)buf[2][vplc[2]>>logy]];
+        p[3] = pal[3][(uint8_t)buf[3][vplc[3]>>logy]];
+
+        vplc[0] += cmd.v4.vinc[0];
+        vplc[1] += cmd.v4.vinc[1];
+        vplc[2] += cmd.v4.vinc[2];
+        vplc[3] += cmd.v4.vinc[3];
+    }
+}
+
+// draws pixels i1 to i2 of the hline
+static void striphline(stripcmd_t const &cmd, int32_t i1, int32_t i2)
+{
+    const char *const A_C_RESTRICT pal = (const char *)cmd.h.pal;
+    const char *const A_C_RESTRICT buf = (const char *)cmd.h.buf;
+    int32_t const logx = cmd.logx, logy = cmd.logy;
+    uint32_t bx = cmd.h.bx - (uint32_t)cmd.h.xinc * (uint32_t)i1;
+    uint32_t by = cmd.h.by - (uint32_t)cmd.h.yinc * (uint32_t)i1;
+    char *pp = (char *)cmd.p - i1;
+
+    if (classicsimd.hline && logx && logy)
+    {
+        classicsimd.hline(pp, pal, buf, bx, by, cmd.h.xinc, cmd.h.yinc, logx, logy, i2 - i1 + 1);
+        return;
+    }
+
+    for (int32_t i = i1; i <= i2; i++, pp--)
+    {
+        *pp = pal[(uint8_t)buf[((bx>>(32-logx))<<logy)+(by>>(32-logy))]];
+        bx -= cmd.h.xinc;
+        by -= cmd.h.yinc;
+    }
+}
+
+static void stripslope(stripcmd_t const &cmd)
+{
+    const char *const A_C_RESTRICT buf = (const char *)cmd.s.buf;
+    intptr_t const *slopalptr = &stripslopal[cmd.s.slopal];
+    int32_t const logx = cmd.logx, logy = cmd.logy;
+    int32_t bz = cmd.s.bz;
+    char *p = (char *)cmd.p;
+
+    if (classicsimd.slope && logx && logy)
+    {
+        classicsimd.slope(p, slopalptr, cmd.cnt, cmd.s.bx, cmd.s.by, bz, cmd.s.bzinc, cmd.s.x3, cmd.s.y3, buf,
+                          cmd.s.pinc, logx, logy);
+        return;
+    }
+
+    for (int32_t cnt = cmd.cnt; cnt > 0; cnt--)
+    {
+        int32_t const i = sloptable[(bz>>6)+HALFSLOPTABLESIZ]; bz += cmd.s.bzinc;
+        uint32_t const u = cmd.s.bx + (inthi_t)cmd.s.x3*i;
+        uint32_t const v = cmd.s.by + (inthi_t)cmd.s.y3*i;
+        *p = *(char *)(slopalptr[0] + (uint8_t)buf[((u>>(32-logx))<<logy)+(v>>(32-logy))]);
+        slopalptr--;
+        p += cmd.s.pinc;
+    }
+}
+
+static inline int32_t stripof(int32_t x) { return min(x / stripwidth, strippoolthreads - 1); }
+
+static void stripref_add(int32_t strip, int32_t cmd, int32_t lo, int32_t hi)
+{
+    auto &w = stripworker[strip];
+
+    if (EDUKE32_PREDICT_FALSE(w.numrefs == w.maxrefs))
+    {
+        w.maxrefs = max(w.maxrefs << 1, 1024);
+        w.ref     = (stripref_t *)Xrealloc(w.ref, w.maxrefs * sizeof(stripref_t));
+    }
+
+    auto &ref = w.ref[w.numrefs++];
+    ref.cmd = cmd;
+    ref.lo  = lo;
+    ref.hi  = hi;
+}
+
+// Hands every recorded command to the strips it touches, clipped to each of
+// them, so that a worker only walks its own share of the list.
+static void classicPartitionStrips(void)
+{
+    MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
+
+    for (native_t i = 0; i < strippoolthreads; i++)
+        stripworker[i].numrefs = 0;
+
+    for (native_t i = 0; i < numstripcmds; i++)
+    {
+        auto const &cmd = stripcmd[i];
+
+        switch (cmd.type)
+        {
+        case STRIPCMD_VLINE4:
+        {
+            int32_t const s1 = stripof(cmd.x), s2 = stripof(cmd.x + 3);
+
+            if (s1 == s2)
+            {
+                stripref_add(s1, i, 0, 3);
+                break;
+            }
+
+            // straddles a strip boundary: every strip draws its share of the columns
+            for (int32_t s = s1; s <= s2; s++)
+            {
+                auto const &w = stripworker[s];
+                stripref_add(s, i, max(0, w.x1 - cmd.x), min(3, w.x2 - 1 - cmd.x));
+            }
+            break;
+        }
+        case STRIPCMD_HLINE:
+        {
+            // pixel i is at column xr-i
+            int32_t const xr = cmd.x + cmd.cnt - 1;
+
+            for (int32_t s = stripof(max(cmd.x, 0)), s2 = stripof(xr); s <= s2; s++)
+            {
+                auto const &w = stripworker[s];
+                int32_t const i1 = max(0, xr - w.x2 + 1);
+                int32_t const i2 = min(cmd.cnt - 1, xr - w.x1);
+
+                if (i1 <= i2)
+                    stripref_add(s, i, i1, i2);
+            }
+            break;
+        }
+        default:
+            stripref_add(stripof(cmd.x), i, 0, 0);
+            break;
+        }
+    }
+}
+
+static void classicDrawStrip(stripworker_t const &w)
+{
+    MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
+
+    int32_t const bpl = w.bpl;
+
+    for (native_t i = 0; i < w.numrefs; i++)
+    {
+        auto const &ref = w.ref[i];
+        auto const &cmd = stripcmd[ref.cmd];
+
+        switch (cmd.type)
+        {
+        case STRIPCMD_VLINE:
+            stripvline((char *)cmd.p, (const char *)cmd.v.pal, (const char *)cmd.v.buf, cmd.v.vplc, cmd.v.vinc,
+                       cmd.cnt, cmd.logy, cmd.v.tilesizy, bpl);
+            break;
+        case STRIPCMD_VLINE4:
+            if (ref.lo == 0 && ref.hi == 3)
+                stripvline4(cmd, bpl);
+            else
+            {
+                for (int j = ref.lo; j <= ref.hi; j++)
+                    stripvline((char *)cmd.p + j, (const char *)cmd.v4.pal[j], (const char *)cmd.v4.buf[j],
+                               cmd.v4.vplc[j], cmd.v4.vinc[j], cmd.cnt, cmd.logy, cmd.v4.tilesizy, bpl);
+            }
+            break;
+        case STRIPCMD_HLINE:
+            striphline(cmd, ref.lo, ref.hi);
+            break;
+        case STRIPCMD_SLOPE:
+            stripslope(cmd);
+            break;
+        case STRIPCMD_FSLOPE:
+            classicFSlopeColumn(cmd.fs.col, (uint8_t *)cmd.p, &stripslopal[cmd.fs.slopal], cmd.cnt);
+            break;
+        }
+    }
+}
+
+void classicStripsBegin(intptr_t frameplace, int32_t bytesperline, int32_t xdim)
+{
+#ifdef ENGINE_USING_A_C
+    int32_t const numthreads = clamp(r_classicthreads, 1, MAXCLASSICTHREADS);
+
+    if (numthreads <= 1 || bytesperline <= 0)
+        return;
+
+    if (numthreads != strippoolthreads)
+    {
+        classicStripsUninit();
+        strippool = new async::threadpool_scheduler(numthreads, []() { MicroProfileOnThreadCreate("Classic strip"); }, nullptr);
+        strippoolthreads = numthreads;
+    }
+
+    stripframeplace = frameplace;
+    stripbpl        = bytesperline;
+
+    // keep strip boundaries on 4-column groups so vlineasm4 calls rarely get split
+    stripwidth = ((xdim + numthreads - 1) / numthreads + 3) & ~3;
+
+    for (native_t i = 0; i < numthreads; i++)
+    {
+        auto &w = stripworker[i];
+
+        w.x1  = i * stripwidth;
+        // the last strip also covers any padding between xdim and bytesperline
+        w.x2  = i == numthreads - 1 ? INT32_MAX : (i + 1) * stripwidth;
+        w.bpl = bytesperline;
+    }
+
+    numstripcmds   = 0;
+    numstripslopal = 0;
+
+    classicstrips_active = 1;
+#else
+    UNREFERENCED_PARAMETER(frameplace);
+    UNREFERENCED_PARAMETER(bytesperline);
+    UNREFERENCED_PARAMETER(xdim);
+#endif
+}
+
+void classicStripsFlush(void)
+{
+    if (!classicstrips_active)
+        return;
+
+    MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
+
+    if (numstripcmds > 0)
+    {
+        classicPartitionStrips();
+
+        async::parallel_for(*strippool, async::static_partitioner(async::irange(0, strippoolthreads), 1), [](int32_t const strip)
+        {
+            classicDrawStrip(stripworker[strip]);
+        });
+    }
+
+    numstripcmds   = 0;
+    numstripslopal = 0;
+}
+
+void classicStripsEnd(void)
+{
+    classicStripsFlush();
+    classicstrips_active = 0;
+}
+
+void classicStripsUninit(void)
+{
+    classicstrips_active = 0;
+
+    delete strippool;
+    strippool        = nullptr;
+    strippoolthreads = 0;
+
+    for (auto &w : stripworker)
+    {
+        DO_FREE_AND_NULL(w.ref);
+        w.numrefs = w.maxrefs = 0;
+    }
+}
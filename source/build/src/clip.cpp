@@ -8,11 +8,22 @@
 
 #include "a.h"
 #include "build.h"
+#include "build_cpuid.h"
 #include "baselayer.h"
 #include "clip.h"
 #include "engine_priv.h"
 #include "microprofile.h"
 
+#if defined EDUKE32_CPU_X86 && (EDUKE32_GCC_PREREQ(4,9) || defined __clang__ || defined _MSC_VER)
+# define HITSCAN_AVX2
+# include <immintrin.h>
+# if defined __GNUC__ || defined __clang__
+#  define SIMD_AVX2 __attribute__((target("avx2")))
+# else
+#  define SIMD_AVX2
+# endif
+#endif
+
 static int16_t clipnum;
 static linetype clipit[MAXCLIPNUM];
 static int32_t clipsectnum, origclipsectnum, layerclipsectnum, clipspritenum;
@@ -597,6 +608,184 @@ int clipinsidebox(vec2_t const vect, int const wallnum, int const walldist)
 }
 
 
+//
+// clip cache
+//
+// The clipmove() and pushmove() calls made for one sprite from one tick to
+// the next usually cover almost the same area. For each owner the cache keeps
+// the walls of the sectors visited so far that touch a box somewhat larger
+// than the area of the call that set it up, and hands them out in place of
+// the full wall lists for as long as the calls stay inside that box. The
+// walls that are left out would have failed the bounding box tests anyway.
+//
+#define CLIPCACHESECTS 32
+#define CLIPCACHEWALLS 224
+#define CLIPCACHEMARGIN 256
+// see clipcache_keepwall()
+#define CLIPCACHEMAXCOORD (1<<29)
+
+typedef struct
+{
+    int32_t  owner;
+    uint32_t gen;
+    vec2_t   min, max;
+    int16_t  numsects, numwalls;
+    int16_t  sectnum[CLIPCACHESECTS];
+    int16_t  sectwallstart[CLIPCACHESECTS+1];
+    uint32_t sectgen[CLIPCACHESECTS];
+    int16_t  walls[CLIPCACHEWALLS];
+} clipcache_t;
+
+int32_t clipcache_enabled = 1;
+int32_t clipcache_check;
+
+static clipcache_t clipcache[CLIPCACHESIZE];
+static uint32_t    clipcachegen = 1;
+static uint32_t    clipcachesectgen[MAXSECTORS];
+
+// set while clipcache_check repeats a call with the cache
+static int32_t clipcache_checking;
+
+void clipCacheInvalidate(int const sectnum)
+{
+    if ((unsigned)sectnum < MAXSECTORS)
+        clipcachesectgen[sectnum]++;
+    else
+        clipcachegen++;
+}
+
+static FORCE_INLINE bool clipcache_farcoord(int32_t const v)
+{
+    return (uint64_t)((int64_t)v + CLIPCACHEMAXCOORD) >= 2*(uint64_t)CLIPCACHEMAXCOORD;
+}
+
+// Walls far out are always kept: clipinsideboxline() can overflow on them,
+// and then its result has nothing to do with the bounding box.
+static FORCE_INLINE bool clipcache_keepwall(clipcache_t const *const cache, uwallptr_t const wal, uwallptr_t const wal2)
+{
+    if (clipcache_farcoord(wal->x) || clipcache_farcoord(wal->y) || clipcache_farcoord(wal2->x) || clipcache_farcoord(wal2->y))
+        return true;
+
+    return !((wal->x < cache->min.x && wal2->x < cache->min.x) || (wal->x > cache->max.x && wal2->x > cache->max.x) ||
+             (wal->y < cache->min.y && wal2->y < cache->min.y) || (wal->y > cache->max.y && wal2->y > cache->max.y));
+}
+
+static FORCE_INLINE int32_t clipcache_clampcoord(int64_t const v)
+{
+    return (int32_t)clamp<int64_t>(v, INT32_MIN, INT32_MAX);
+}
+
+// Returns the cache entry of owner if it covers the box from boxmin to
+// boxmax, after setting it up again if it doesn't.
+static clipcache_t *clipcache_get(int32_t const owner, vec2_t const boxmin, vec2_t const boxmax)
+{
+    if (!clipcache_enabled || owner < 0)
+        return NULL;
+
+    auto &cache = clipcache[owner & (CLIPCACHESIZE-1)];
+
+    if (cache.owner == owner && cache.gen == clipcachegen && boxmin.x >= cache.min.x && boxmin.y >= cache.min.y &&
+        boxmax.x <= cache.max.x && boxmax.y <= cache.max.y)
+        return &cache;
+
+    cache.owner = owner;
+    cache.gen   = clipcachegen;
+    cache.min   = { clipcache_clampcoord((int64_t)boxmin.x - CLIPCACHEMARGIN), clipcache_clampcoord((int64_t)boxmin.y - CLIPCACHEMARGIN) };
+    cache.max   = { clipcache_clampcoord((int64_t)boxmax.x + CLIPCACHEMARGIN), clipcache_clampcoord((int64_t)boxmax.y + CLIPCACHEMARGIN) };
+
+    cache.numsects = cache.numwalls = 0;
+    cache.sectwallstart[0] = 0;
+
+    return &cache;
+}
+
+// Returns the walls of sectnum that touch the cached box, in order, or NULL
+// if they don't fit.
+static int16_t const *clipcache_sectorwalls(clipcache_t *const cache, int const sectnum, int *const numwalls)
+{
+    for (int i = 0; i < cache->numsects; i++)
+    {
+        if (cache->sectnum[i] != sectnum)
+            continue;
+
+        if (cache->sectgen[i] != clipcachesectgen[sectnum])
+        {
+            // its walls moved, start over
+            cache->numsects = cache->numwalls = 0;
+            break;
+        }
+
+        *numwalls = cache->sectwallstart[i+1] - cache->sectwallstart[i];
+        return &cache->walls[cache->sectwallstart[i]];
+    }
+
+    auto const sec = (usectorptr_t)&sector[sectnum];
+
+    if (cache->numsects == CLIPCACHESECTS || cache->numwalls + sec->wallnum > CLIPCACHEWALLS)
+        return NULL;
+
+    int const start = cache->numwalls;
+    auto wal = (uwallptr_t)&wall[sec->wallptr];
+
+    for (int j = sec->wallptr, endwall = sec->wallptr + sec->wallnum; j < endwall; j++, wal++)
+        if (clipcache_keepwall(cache, wal, (uwallptr_t)&wall[wal->point2]))
+            cache->walls[cache->numwalls++] = j;
+
+    int const i = cache->numsects++;
+
+    cache->sectnum[i] = sectnum;
+    cache->sectgen[i] = clipcachesectgen[sectnum];
+    cache->sectwallstart[i+1] = cache->numwalls;
+
+    *numwalls = cache->numwalls - start;
+    return &cache->walls[start];
+}
+
+void clipCachePrefetch(int32_t const owner, int const sectnum, vec2_t const pos, vec2_t const move, int32_t const walldist)
+{
+    if ((unsigned)sectnum >= (unsigned)numsectors || walldist < 0)
+        return;
+
+    // big enough for the clipmove() box of the move and the getzrange() box
+    // at either end of it
+    int64_t const dist = (int64_t)klabs(move.x) + klabs(move.y) + MAXCLIPDIST + walldist + 16;
+    vec2_t const  goal = { clipcache_clampcoord((int64_t)pos.x + move.x), clipcache_clampcoord((int64_t)pos.y + move.y) };
+
+    vec2_t const boxmin = { clipcache_clampcoord(min(pos.x, goal.x) - dist), clipcache_clampcoord(min(pos.y, goal.y) - dist) };
+    vec2_t const boxmax = { clipcache_clampcoord(max(pos.x, goal.x) + dist), clipcache_clampcoord(max(pos.y, goal.y) + dist) };
+
+    clipcache_t *const cache = clipcache_get(owner, boxmin, boxmax);
+
+    if (!cache)
+        return;
+
+    for (int i = 0; i < cache->numsects; i++)
+    {
+        if (cache->sectgen[i] != clipcachesectgen[cache->sectnum[i]])
+        {
+            cache->numsects = cache->numwalls = 0;
+            break;
+        }
+    }
+
+    int numwalls;
+
+    if (!clipcache_sectorwalls(cache, sectnum, &numwalls))
+        return;
+
+    // every sector a call inside the box could get to, in the order they are found
+    for (int i = 0; i < cache->numsects; i++)
+    {
+        for (int j = cache->sectwallstart[i]; j < cache->sectwallstart[i+1]; j++)
+        {
+            int const nextsect = wall[cache->walls[j]].nextsector;
+
+            if ((unsigned)nextsect < (unsigned)numsectors && !clipcache_sectorwalls(cache, nextsect, &numwalls))
+                return;
+        }
+    }
+}
+
 static int32_t clipmove_warned;
 
 static inline void addclipsect(int const sectnum)
@@ -1130,11 +1319,31 @@ void clipmove_compat(vec3_t* const pos, int16_t*sectnum)
 // clipmove
 //
 int32_t clipmove(vec3_t * const pos, int16_t * const sectnum, int32_t xvect, int32_t yvect,
-                 int32_t const walldist, int32_t const ceildist, int32_t const flordist, uint32_t const cliptype)
+                 int32_t const walldist, int32_t const ceildist, int32_t const flordist, uint32_t const cliptype,
+                 int32_t const cacheowner /*= -1*/)
 {
     if ((xvect|yvect) == 0 || *sectnum < 0)
         return 0;
 
+    if (clipcache_check && cacheowner >= 0 && !clipcache_checking)
+    {
+        vec3_t  cachedpos  = *pos;
+        int16_t cachedsect = *sectnum;
+
+        clipcache_checking = 1;
+        int32_t const cachedret = clipmove(&cachedpos, &cachedsect, xvect, yvect, walldist, ceildist, flordist, cliptype, cacheowner);
+        clipcache_checking = 0;
+
+        vec3_t const origpos = *pos;
+        int32_t const ret = clipmove(pos, sectnum, xvect, yvect, walldist, ceildist, flordist, cliptype);
+
+        if (cachedret != ret || cachedpos != *pos || cachedsect != *sectnum)
+            LOG_F(WARNING, "clip cache: clipmove() of %d from (%d, %d) by (%d, %d) ended at (%d, %d) in sector %d instead of (%d, %d) in sector %d",
+                  cacheowner, origpos.x, origpos.y, xvect, yvect, cachedpos.x, cachedpos.y, cachedsect, pos->x, pos->y, *sectnum);
+
+        return ret;
+    }
+
     uspriteptr_t curspr=NULL;  // non-NULL when handling sprite with sector-like clipping
 
     int const initialsectnum = *sectnum;
@@ -1152,6 +1361,8 @@ int32_t clipmove(vec3_t * const pos, int16_t * const sectnum, int32_t xvect, int
     vec2_t const  clipMin = { cent.x - rad, cent.y - rad };
     vec2_t const  clipMax = { cent.x + rad, cent.y + rad };
 
+    clipcache_t *const cache = clipcache_get(cacheowner, clipMin, clipMax);
+
     int clipshapeidx  = -1;
     int clipsectcnt   = 0;
     int clipspritecnt = 0;
@@ -1209,11 +1420,17 @@ int32_t clipmove(vec3_t * const pos, int16_t * const sectnum, int32_t xvect, int
         auto const sec       = (usectorptr_t)&sector[dasect];
         int const  startwall = sec->wallptr;
         int const  endwall   = startwall + sec->wallnum;
-        auto       wal       = (uwallptr_t)&wall[startwall];
 
-        for (native_t j=startwall; j<endwall; j++, wal++)
+        // the clip map's sectors and walls aren't cached
+        int numcachedwalls = 0;
+        int16_t const *const cachedwalls = (cache && !curspr) ? clipcache_sectorwalls(cache, dasect, &numcachedwalls) : NULL;
+        int const wallcnt = cachedwalls ? numcachedwalls : endwall - startwall;
+
+        for (native_t i=0; i<wallcnt; i++)
         {
-            auto const wal2 = (uwallptr_t)&wall[wal->point2];
+            native_t const j    = cachedwalls ? cachedwalls[i] : startwall + i;
+            auto const     wal  = (uwallptr_t)&wall[j];
+            auto const     wal2 = (uwallptr_t)&wall[wal->point2];
 
             if ((wal->x < clipMin.x && wal2->x < clipMin.x) || (wal->x > clipMax.x && wal2->x > clipMax.x) ||
                 (wal->y < clipMin.y && wal2->y < clipMin.y) || (wal->y > clipMax.y && wal2->y > clipMax.y))
@@ -1667,10 +1884,41 @@ int32_t clipmove(vec3_t * const pos, int16_t * const sectnum, int32_t xvect, int
 // pushmove
 //
 int pushmove(vec3_t *const vect, int16_t *const sectnum,
-    int32_t const walldist, int32_t const ceildist, int32_t const flordist, uint32_t const cliptype, bool clear /*= true*/)
+    int32_t const walldist, int32_t const ceildist, int32_t const flordist, uint32_t const cliptype, bool clear /*= true*/,
+    int32_t const cacheowner /*= -1*/)
 {
+    if (clipcache_check && cacheowner >= 0 && !clipcache_checking)
+    {
+        vec3_t  cachedpos  = *vect;
+        int16_t cachedsect = *sectnum;
+
+        clipcache_checking = 1;
+        int const cachedret = pushmove(&cachedpos, &cachedsect, walldist, ceildist, flordist, cliptype, clear, cacheowner);
+        clipcache_checking = 0;
+
+        vec3_t const origpos = *vect;
+        int const ret = pushmove(vect, sectnum, walldist, ceildist, flordist, cliptype, clear);
+
+        if (cachedret != ret || cachedpos != *vect || cachedsect != *sectnum)
+            LOG_F(WARNING, "clip cache: pushmove() of %d from (%d, %d) ended at (%d, %d) in sector %d instead of (%d, %d) in sector %d",
+                  cacheowner, origpos.x, origpos.y, cachedpos.x, cachedpos.y, cachedsect, vect->x, vect->y, *sectnum);
+
+        return ret;
+    }
+
     int bad;
 
+    // The cache is only used on the first pass, while the position hasn't
+    // been pushed yet and clipinsidebox() can't overflow on the walls it
+    // leaves out.
+    clipcache_t *cache = NULL;
+
+    if (walldist >= 4 && walldist < (1<<16) && !clipcache_farcoord(vect->x) && !clipcache_farcoord(vect->y))
+    {
+        int32_t const boxdist = walldist-4;
+        cache = clipcache_get(cacheowner, { vect->x - boxdist, vect->y - boxdist }, { vect->x + boxdist, vect->y + boxdist });
+    }
+
     const int32_t dawalclipmask = (cliptype&65535);
     //    const int32_t dasprclipmask = (cliptype>>16);
 
@@ -1740,9 +1988,24 @@ int pushmove(vec3_t *const vect, int16_t *const sectnum,
             else
                 endwall = sec->wallptr, startwall = endwall + sec->wallnum;
 
+            int numcachedwalls = 0;
+            int16_t const *cachedwall = cache ? clipcache_sectorwalls(cache, clipsectorlist[clipsectcnt], &numcachedwalls) : NULL;
+            int16_t const *const cachedend = cachedwall + numcachedwalls;
+
             int i;
 
-            for (i=startwall, wal=(uwallptr_t)&wall[startwall]; i!=endwall; i+=dir, wal+=dir)
+            for (i=startwall; i!=endwall; i+=dir)
+            {
+                // after a push, the rest of the walls are scanned in full
+                if (cachedwall)
+                {
+                    if (cachedwall == cachedend)
+                        break;
+                    i = *cachedwall++;
+                }
+
+                wal = (uwallptr_t)&wall[i];
+
                 if (clipinsidebox(vect->xy, i, walldist-4) == 1)
                 {
                     int j = 0;
@@ -1790,6 +2053,8 @@ int pushmove(vec3_t *const vect, int16_t *const sectnum,
                             bad2--; if (bad2 == 0) break;
                         } while (clipinsidebox(vect->xy, i, walldist-4) != 0);
                         bad = -1;
+                        cache = NULL;
+                        cachedwall = NULL;
 
                         if (enginecompatibilitymode == ENGINE_EDUKE32)
                         {
@@ -1812,6 +2077,7 @@ int pushmove(vec3_t *const vect, int16_t *const sectnum,
                     else if (bitmap_test(clipsectormap, wal->nextsector) == 0)
                         addclipsect(wal->nextsector);
                 }
+            }
 
             clipsectcnt++;
         } while (clipsectcnt < clipsectnum);
@@ -1826,7 +2092,7 @@ int pushmove(vec3_t *const vect, int16_t *const sectnum,
 //
 void getzrange(const vec3_t *pos, int16_t sectnum,
                int32_t *ceilz, int32_t *ceilhit, int32_t *florz, int32_t *florhit,
-               int32_t walldist, uint32_t cliptype)
+               int32_t walldist, uint32_t cliptype, int32_t cacheowner /*= -1*/)
 {
     MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
 
@@ -1837,6 +2103,23 @@ void getzrange(const vec3_t *pos, int16_t sectnum,
         return;
     }
 
+    if (clipcache_check && cacheowner >= 0 && !clipcache_checking)
+    {
+        int32_t cachedceilz, cachedceilhit, cachedflorz, cachedflorhit;
+
+        clipcache_checking = 1;
+        getzrange(pos, sectnum, &cachedceilz, &cachedceilhit, &cachedflorz, &cachedflorhit, walldist, cliptype, cacheowner);
+        clipcache_checking = 0;
+
+        getzrange(pos, sectnum, ceilz, ceilhit, florz, florhit, walldist, cliptype);
+
+        if (cachedceilz != *ceilz || cachedceilhit != *ceilhit || cachedflorz != *florz || cachedflorhit != *florhit)
+            LOG_F(WARNING, "clip cache: getzrange() of %d at (%d, %d) in sector %d found %d/%d and %d/%d instead of %d/%d and %d/%d",
+                  cacheowner, pos->x, pos->y, sectnum, cachedceilz, cachedceilhit, cachedflorz, cachedflorhit, *ceilz, *ceilhit, *florz, *florhit);
+
+        return;
+    }
+
     int32_t clipsectcnt = 0;
 
 #ifdef YAX_ENABLE
@@ -1856,6 +2139,8 @@ void getzrange(const vec3_t *pos, int16_t sectnum,
     const int32_t dawalclipmask = (cliptype&65535);
     const int32_t dasprclipmask = (cliptype>>16);
 
+    clipcache_t *const cache = clipcache_get(cacheowner, { xmin, ymin }, { xmax, ymax });
+
     vec2_t closest = pos->xy;
     if (enginecompatibilitymode == ENGINE_EDUKE32)
         getsectordist(closest, sectnum, &closest);
@@ -1952,8 +2237,13 @@ restart_grand:
         const int startwall = startsec->wallptr;
         const int endwall = startwall + startsec->wallnum;
 
-        for (bssize_t j=startwall; j<endwall; j++)
+        int numcachedwalls = 0;
+        int16_t const *const cachedwalls = (cache && !curspr) ? clipcache_sectorwalls(cache, clipsectorlist[clipsectcnt], &numcachedwalls) : NULL;
+        int const wallcnt = cachedwalls ? numcachedwalls : endwall - startwall;
+
+        for (bssize_t i=0; i<wallcnt; i++)
         {
+            const int j = cachedwalls ? cachedwalls[i] : startwall + i;
             const int k = wall[j].nextsector;
 
             if (k >= 0)
@@ -2446,6 +2736,143 @@ static int32_t hitscan_trysector(const vec3_t *sv, usectorptr_t sec, hitdata_t *
     return 0;
 }
 
+// tests sprite z, which is in dasector, against the ray
+static void hitscan_trysprite(const vec3_t *sv, int32_t vx, int32_t vy, int32_t vz, hitdata_t *hit,
+                              int const dasector, int const z)
+{
+    auto const spr = (uspriteptr_t)&sprite[z];
+    uint32_t const cstat = spr->cstat;
+    int32_t x1 = spr->x, y1 = spr->y, z1 = spr->z, x2, y2, intx, inty, intz, k, daz;
+
+    switch (cstat&CSTAT_SPRITE_ALIGNMENT)
+    {
+    case 0:
+    {
+        if (try_facespr_intersect(spr, *sv, vx, vy, vz, &hit->xyz, 0))
+        {
+            hit->sect = dasector;
+            hit->wall = -1;
+            hit->sprite = z;
+        }
+
+        break;
+    }
+
+    case CSTAT_SPRITE_ALIGNMENT_WALL:
+    {
+        int32_t ucoefup16;
+        int32_t tilenum = spr->picnum;
+
+        get_wallspr_points(spr, &x1, &x2, &y1, &y2);
+
+        if ((cstat&64) != 0)   //back side of 1-way sprite
+            if (compat_maybe_truncate_to_int32((coord_t)(x1-sv->x)*(y2-sv->y))
+                < compat_maybe_truncate_to_int32((coord_t)(x2-sv->x)*(y1-sv->y))) return;
+
+        ucoefup16 = rintersect(sv->x,sv->y,sv->z,vx,vy,vz,x1,y1,x2,y2,&intx,&inty,&intz);
+        if (ucoefup16 == -1) return;
+
+        if (klabs(intx-sv->x)+klabs(inty-sv->y) > klabs((hit->x)-sv->x)+klabs((hit->y)-sv->y))
+            return;
+
+        daz = spr->z + spriteheightofs(z, &k, 1);
+        if (intz > daz-k && intz < daz)
+        {
+            if (picanm[tilenum].sf&PICANM_TEXHITSCAN_BIT)
+            {
+                tileUpdatePicnum(&tilenum, 0);
+
+                if (!waloff[tilenum])
+                    tileLoad(tilenum);
+
+                if (waloff[tilenum])
+                {
+                    // daz-intz > 0 && daz-intz < k
+                    int32_t xtex = mulscale16(ucoefup16, tilesiz[tilenum].x);
+                    int32_t vcoefup16 = 65536-divscale16(daz-intz, k);
+                    int32_t ytex = mulscale16(vcoefup16, tilesiz[tilenum].y);
+
+                    const char *texel = (char *)(waloff[tilenum] + tilesiz[tilenum].y*xtex + ytex);
+                    if (*texel == 255)
+                        return;
+                }
+            }
+
+            hit_set(hit, dasector, -1, z, intx, inty, intz);
+        }
+        break;
+    }
+
+    case CSTAT_SPRITE_ALIGNMENT_FLOOR:
+    {
+        int32_t x3, y3, x4, y4, zz;
+        intz = z1;
+
+        if (vz == 0 || ((intz-sv->z)^vz) < 0) return;
+
+        if ((cstat&64) != 0)
+            if ((sv->z > intz) == ((cstat&8)==0)) return;
+        if (enginecompatibilitymode == ENGINE_EDUKE32)
+        {
+            // Abyss crash prevention code ((intz-sv->z)*zx overflowing a 8-bit word)
+            // PK: the reason for the crash is not the overflowing (even if it IS a problem;
+            // signed overflow is undefined behavior in C), but rather the idiv trap when
+            // the resulting quotient doesn't fit into a *signed* 32-bit integer.
+            zz = (uint32_t)(intz-sv->z) * vx;
+            intx = sv->x+scale(zz,1,vz);
+            zz = (uint32_t)(intz-sv->z) * vy;
+            inty = sv->y+scale(zz,1,vz);
+        }
+        else
+        {
+            intx = sv->x+scale(intz-sv->z,vx,vz);
+            inty = sv->y+scale(intz-sv->z,vy,vz);
+        }
+
+        if (klabs(intx-sv->x)+klabs(inty-sv->y) > klabs((hit->x)-sv->x)+klabs((hit->y)-sv->y))
+            return;
+
+        get_floorspr_points((uspriteptr_t)spr, intx, inty, &x1, &x2, &x3, &x4,
+                            &y1, &y2, &y3, &y4, 0);
+
+        if (get_floorspr_clipyou({x1, y1}, {x2, y2}, {x3, y3}, {x4, y4}))
+            hit_set(hit, dasector, -1, z, intx, inty, intz);
+
+        break;
+    }
+
+    case CSTAT_SPRITE_ALIGNMENT_SLOPE:
+    {
+        int32_t x3, y3, x4, y4;
+        int32_t const heinum = spriteGetSlope(z);
+        int32_t const dax = (heinum * sintable[(spr->ang+1024)&2047]) << 1;
+        int32_t const day = (heinum * sintable[(spr->ang+512)&2047]) << 1;
+        int32_t const j = (vz<<8)-dmulscale15(dax,vy,-day,vx);
+        if (j == 0) return;
+        if ((cstat&64) != 0)
+            if ((j < 0) == ((cstat&8)==0)) return;
+        int32_t i = ((spr->z-sv->z)<<8)+dmulscale15(dax,sv->y-spr->y,-day,sv->x-spr->x);
+        if ((i^j) < 0 || (klabs(i)>>1) >= klabs(j)) return;
+
+        i = divscale30(i,j);
+        intx = sv->x + mulscale30(vx,i);
+        inty = sv->y + mulscale30(vy,i);
+        intz = sv->z + mulscale30(vz,i);
+
+        if (klabs(intx-sv->x)+klabs(inty-sv->y) > klabs((hit->x)-sv->x)+klabs((hit->y)-sv->y))
+            return;
+
+        get_floorspr_points((uspriteptr_t)spr, intx, inty, &x1, &x2, &x3, &x4,
+                            &y1, &y2, &y3, &y4, spriteGetSlope(z));
+
+        if (get_floorspr_clipyou({x1, y1}, {x2, y2}, {x3, y3}, {x4, y4}))
+            hit_set(hit, dasector, -1, z, intx, inty, intz);
+
+        break;
+    }
+    }
+}
+
 //
 // hitscan
 //
@@ -2453,7 +2880,7 @@ int32_t hitscan(const vec3_t *sv, int16_t sectnum, int32_t vx, int32_t vy, int32
                 hitdata_t *hit, uint32_t cliptype)
 {
     int32_t x1, y1=0, z1=0, x2, y2, intx, inty, intz;
-    int32_t i, k, daz;
+    int32_t i, daz;
     int16_t tempshortcnt, tempshortnum;
 
     uspriteptr_t curspr = NULL;
@@ -2663,134 +3090,7 @@ restart_grand:
                 continue;
             }
 #endif
-            x1 = spr->x; y1 = spr->y; z1 = spr->z;
-            switch (cstat&CSTAT_SPRITE_ALIGNMENT)
-            {
-            case 0:
-            {
-                if (try_facespr_intersect(spr, *sv, vx, vy, vz, &hit->xyz, 0))
-                {
-                    hit->sect = dasector;
-                    hit->wall = -1;
-                    hit->sprite = z;
-                }
-
-                break;
-            }
-
-            case CSTAT_SPRITE_ALIGNMENT_WALL:
-            {
-                int32_t ucoefup16;
-                int32_t tilenum = spr->picnum;
-
-                get_wallspr_points(spr, &x1, &x2, &y1, &y2);
-
-                if ((cstat&64) != 0)   //back side of 1-way sprite
-                    if (compat_maybe_truncate_to_int32((coord_t)(x1-sv->x)*(y2-sv->y))
-                        < compat_maybe_truncate_to_int32((coord_t)(x2-sv->x)*(y1-sv->y))) continue;
-
-                ucoefup16 = rintersect(sv->x,sv->y,sv->z,vx,vy,vz,x1,y1,x2,y2,&intx,&inty,&intz);
-                if (ucoefup16 == -1) continue;
-
-                if (klabs(intx-sv->x)+klabs(inty-sv->y) > klabs((hit->x)-sv->x)+klabs((hit->y)-sv->y))
-                    continue;
-
-                daz = spr->z + spriteheightofs(z, &k, 1);
-                if (intz > daz-k && intz < daz)
-                {
-                    if (picanm[tilenum].sf&PICANM_TEXHITSCAN_BIT)
-                    {
-                        tileUpdatePicnum(&tilenum, 0);
-
-                        if (!waloff[tilenum])
-                            tileLoad(tilenum);
-
-                        if (waloff[tilenum])
-                        {
-                            // daz-intz > 0 && daz-intz < k
-                            int32_t xtex = mulscale16(ucoefup16, tilesiz[tilenum].x);
-                            int32_t vcoefup16 = 65536-divscale16(daz-intz, k);
-                            int32_t ytex = mulscale16(vcoefup16, tilesiz[tilenum].y);
-
-                            const char *texel = (char *)(waloff[tilenum] + tilesiz[tilenum].y*xtex + ytex);
-                            if (*texel == 255)
-                                continue;
-                        }
-                    }
-
-                    hit_set(hit, dasector, -1, z, intx, inty, intz);
-                }
-                break;
-            }
-
-            case CSTAT_SPRITE_ALIGNMENT_FLOOR:
-            {
-                int32_t x3, y3, x4, y4, zz;
-                intz = z1;
-
-                if (vz == 0 || ((intz-sv->z)^vz) < 0) continue;
-
-                if ((cstat&64) != 0)
-                    if ((sv->z > intz) == ((cstat&8)==0)) continue;
-                if (enginecompatibilitymode == ENGINE_EDUKE32)
-                {
-                    // Abyss crash prevention code ((intz-sv->z)*zx overflowing a 8-bit word)
-                    // PK: the reason for the crash is not the overflowing (even if it IS a problem;
-                    // signed overflow is undefined behavior in C), but rather the idiv trap when
-                    // the resulting quotient doesn't fit into a *signed* 32-bit integer.
-                    zz = (uint32_t)(intz-sv->z) * vx;
-                    intx = sv->x+scale(zz,1,vz);
-                    zz = (uint32_t)(intz-sv->z) * vy;
-                    inty = sv->y+scale(zz,1,vz);
-                }
-                else
-                {
-                    intx = sv->x+scale(intz-sv->z,vx,vz);
-                    inty = sv->y+scale(intz-sv->z,vy,vz);
-                }
-
-                if (klabs(intx-sv->x)+klabs(inty-sv->y) > klabs((hit->x)-sv->x)+klabs((hit->y)-sv->y))
-                    continue;
-
-                get_floorspr_points((uspriteptr_t)spr, intx, inty, &x1, &x2, &x3, &x4,
-                                    &y1, &y2, &y3, &y4, 0);
-
-                if (get_floorspr_clipyou({x1, y1}, {x2, y2}, {x3, y3}, {x4, y4}))
-                    hit_set(hit, dasector, -1, z, intx, inty, intz);
-
-                break;
-            }
-
-            case CSTAT_SPRITE_ALIGNMENT_SLOPE:
-            {
-                int32_t x3, y3, x4, y4;
-                int32_t const heinum = spriteGetSlope(z);
-                int32_t const dax = (heinum * sintable[(spr->ang+1024)&2047]) << 1;
-                int32_t const day = (heinum * sintable[(spr->ang+512)&2047]) << 1;
-                int32_t const j = (vz<<8)-dmulscale15(dax,vy,-day,vx);
-                if (j == 0) continue;
-                if ((cstat&64) != 0)
-                    if ((j < 0) == ((cstat&8)==0)) continue;
-                int32_t i = ((spr->z-sv->z)<<8)+dmulscale15(dax,sv->y-spr->y,-day,sv->x-spr->x);
-                if ((i^j) < 0 || (klabs(i)>>1) >= klabs(j)) continue;
-
-                i = divscale30(i,j);
-                intx = sv->x + mulscale30(vx,i);
-                inty = sv->y + mulscale30(vy,i);
-                intz = sv->z + mulscale30(vz,i);
-
-                if (klabs(intx-sv->x)+klabs(inty-sv->y) > klabs((hit->x)-sv->x)+klabs((hit->y)-sv->y))
-                    continue;
-
-                get_floorspr_points((uspriteptr_t)spr, intx, inty, &x1, &x2, &x3, &x4,
-                                    &y1, &y2, &y3, &y4, spriteGetSlope(z));
-
-                if (get_floorspr_clipyou({x1, y1}, {x2, y2}, {x3, y3}, {x4, y4}))
-                    hit_set(hit, dasector, -1, z, intx, inty, intz);
-
-                break;
-            }
-            }
+            hitscan_trysprite(sv, vx, vy, vz, hit, dasector, z);
         }
     }
     while (++tempshortcnt < tempshortnum || clipspritecnt < clipspritenum);
@@ -2845,3 +3145,248 @@ restart_grand:
     return 0;
 }
 
+//
+// hitscan_batch
+//
+// Traces numrays rays from sv, giving the same results as one hitscan() call
+// per ray. Every ray still visits its sectors in the order hitscan() would,
+// but the rays that are about to visit the same sector do so together: the
+// per-wall work that only depends on sv is done once, and the first half of
+// rintersect() runs for all rays of the group at once.
+//
+
+static int16_t hitscanbatch_sectlist[MAXHITSCANBATCH][MAXCLIPSECTORS];
+static int16_t hitscanbatch_sectcnt[MAXHITSCANBATCH], hitscanbatch_sectnum[MAXHITSCANBATCH];
+static int32_t hitscanbatch_vx[MAXHITSCANBATCH], hitscanbatch_vy[MAXHITSCANBATCH];
+
+// rintersect()'s early outs, with x31 = x3-x1, x34 = x3-x4 etc.
+static FORCE_INLINE bool hitscan_wallray(int64_t vx, int64_t vy, int32_t x31, int32_t y31, int32_t x34, int32_t y34, int64_t topt)
+{
+    int64_t const bot  = vx*y34 - vy*x34;
+    int64_t const topu = vx*y31 - vy*x31;
+
+    if (bot > 0)
+        return topt >= 0 && topu >= 0 && topu < bot;
+
+    if (bot < 0)
+        return topt <= 0 && topu <= 0 && topu > bot;
+
+    return false;
+}
+
+#ifdef HITSCAN_AVX2
+static SIMD_AVX2 uint64_t hitscan_wallrays_avx2(int const numrays, int32_t x31, int32_t y31, int32_t x34, int32_t y34, int64_t topt)
+{
+    // _mm256_mul_epi32() only reads the low 32 bits of each lane
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const vx31 = _mm256_set1_epi64x(x31), vy31 = _mm256_set1_epi64x(y31);
+    __m256i const vx34 = _mm256_set1_epi64x(x34), vy34 = _mm256_set1_epi64x(y34);
+    uint64_t rays = 0;
+
+    for (int r = 0; r < numrays; r += 4)
+    {
+        __m256i const vx = _mm256_cvtepi32_epi64(_mm_loadu_si128((__m128i const *)&hitscanbatch_vx[r]));
+        __m256i const vy = _mm256_cvtepi32_epi64(_mm_loadu_si128((__m128i const *)&hitscanbatch_vy[r]));
+        __m256i const bot  = _mm256_sub_epi64(_mm256_mul_epi32(vx, vy34), _mm256_mul_epi32(vy, vx34));
+        __m256i const topu = _mm256_sub_epi64(_mm256_mul_epi32(vx, vy31), _mm256_mul_epi32(vy, vx31));
+        __m256i pass = zero;
+
+        // bot > 0 && topu >= 0 && topu < bot
+        if (topt >= 0)
+            pass = _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, topu),
+                                       _mm256_and_si256(_mm256_cmpgt_epi64(bot, zero), _mm256_cmpgt_epi64(bot, topu)));
+
+        // bot < 0 && topu <= 0 && topu > bot
+        if (topt <= 0)
+            pass = _mm256_or_si256(pass, _mm256_andnot_si256(_mm256_cmpgt_epi64(topu, zero),
+                                                             _mm256_and_si256(_mm256_cmpgt_epi64(zero, bot), _mm256_cmpgt_epi64(topu, bot))));
+
+        rays |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(pass)) << r;
+    }
+
+    return rays;
+}
+#endif
+
+// returns the rays in raymask that may hit the wall (x3,y3)-(x4,y4)
+static uint64_t hitscan_wallrays(int const numrays, uint64_t const raymask, const vec3_t *sv, int32_t x3, int32_t y3, int32_t x4, int32_t y4)
+{
+    // same int32_t differences as in rintersect()
+    int32_t const x31 = x3-sv->x, y31 = y3-sv->y, x34 = x3-x4, y34 = y3-y4;
+    int64_t const topt = (int64_t)x31*y34 - (int64_t)y31*x34;
+
+#ifdef HITSCAN_AVX2
+    if (cpu.features.avx2)
+        return raymask & hitscan_wallrays_avx2(numrays, x31, y31, x34, y34, topt);
+#endif
+
+    uint64_t rays = 0;
+
+    for (int r = 0; r < numrays; r++)
+        if (((raymask >> r) & 1) && hitscan_wallray(hitscanbatch_vx[r], hitscanbatch_vy[r], x31, y31, x34, y34, topt))
+            rays |= (uint64_t)1 << r;
+
+    return rays;
+}
+
+static void hitscan_batchsector(const vec3_t *sv, int const dasector, int const numrays, uint64_t rays, const vec3_t *vec,
+                                hitdata_t *hits, uint32_t const cliptype)
+{
+    int32_t const dawalclipmask = (cliptype&65535);
+    int32_t const dasprclipmask = (cliptype>>16);
+    auto const sec = (usectorptr_t)&sector[dasector];
+
+    for (int r = 0; r < numrays; r++)
+    {
+        if (((rays >> r) & 1) == 0)
+            continue;
+
+        auto const &v = vec[r];
+
+        if (hitscan_trysector(sv, sec, &hits[r], v.x,v.y,v.z, sec->ceilingstat, sec->ceilingheinum, sec->ceilingz, -1, NULL) ||
+            hitscan_trysector(sv, sec, &hits[r], v.x,v.y,v.z, sec->floorstat, sec->floorheinum, sec->floorz, 1, NULL))
+            rays &= ~((uint64_t)1 << r);
+    }
+
+    if (!rays)
+        return;
+
+    ////////// Walls //////////
+
+    int const startwall = sec->wallptr, endwall = startwall + sec->wallnum;
+
+    for (int z=startwall; z<endwall; z++)
+    {
+        auto const wal  = (uwallptr_t)&wall[z];
+        auto const wal2 = (uwallptr_t)&wall[wal->point2];
+
+        int const nextsector = wal->nextsector;
+        int32_t const x1 = wal->x, y1 = wal->y, x2 = wal2->x, y2 = wal2->y;
+
+        if (compat_maybe_truncate_to_int32((coord_t)(x1-sv->x)*(y2-sv->y))
+            < compat_maybe_truncate_to_int32((coord_t)(x2-sv->x)*(y1-sv->y))) continue;
+
+        // rintersect_old() computes with 32-bit products, so the filter only applies to rintersect()
+        uint64_t const wallrays = (enginecompatibilitymode == ENGINE_EDUKE32) ? hitscan_wallrays(numrays, rays, sv, x1, y1, x2, y2) : rays;
+
+        for (int r = 0; r < numrays; r++)
+        {
+            if (((wallrays >> r) & 1) == 0)
+                continue;
+
+            auto const &v = vec[r];
+            auto const hit = &hits[r];
+            int32_t intx, inty, intz;
+
+            if (rintersect(sv->x,sv->y,sv->z, v.x,v.y,v.z, x1,y1, x2,y2, &intx,&inty,&intz) == -1) continue;
+
+            if (klabs(intx-sv->x)+klabs(inty-sv->y) >= klabs((hit->x)-sv->x)+klabs((hit->y)-sv->y))
+                continue;
+
+            if ((nextsector < 0) || (wal->cstat&dawalclipmask))
+            {
+                hit_set(hit, dasector, z, -1, intx, inty, intz);
+                continue;
+            }
+
+            int32_t daz, daz2;
+            getzsofslope(nextsector,intx,inty,&daz,&daz2);
+            if (intz <= daz || intz >= daz2)
+            {
+                hit_set(hit, dasector, z, -1, intx, inty, intz);
+                continue;
+            }
+
+            auto const sectlist = hitscanbatch_sectlist[r];
+            auto &sectnum = hitscanbatch_sectnum[r];
+            int zz;
+            for (zz = sectnum - 1; zz >= 0; zz--)
+                if (sectlist[zz] == nextsector) break;
+            if (zz < 0 && sectnum < MAXCLIPSECTORS) sectlist[sectnum++] = nextsector;
+        }
+    }
+
+    ////////// Sprites //////////
+
+    if (dasprclipmask==0)
+        return;
+
+    for (int z=headspritesect[dasector]; z>=0; z=nextspritesect[z])
+    {
+#ifdef USE_OPENGL
+        if (!hitallsprites)
+#endif
+            if ((sprite[z].cstat&dasprclipmask) == 0)
+                continue;
+
+        for (int r = 0; r < numrays; r++)
+            if ((rays >> r) & 1)
+                hitscan_trysprite(sv, vec[r].x, vec[r].y, vec[r].z, &hits[r], dasector, z);
+    }
+}
+
+int32_t hitscan_batch(const vec3_t *sv, int16_t sectnum, int32_t numrays, const vec3_t *vec,
+                      hitdata_t *hits, uint32_t cliptype)
+{
+    // TROR, sector-like sprites and the 1995 engine's wall handling are left
+    // to hitscan() itself
+    bool fallback = (sectnum < 0 || enginecompatibilitymode == ENGINE_19950829);
+#ifdef HAVE_CLIPSHAPE_FEATURE
+    fallback |= (numclipmaps > 0);
+#endif
+#ifdef YAX_ENABLE
+    fallback |= (numyaxbunches > 0 && !editstatus);
+#endif
+
+    if (fallback)
+    {
+        for (int r = 0; r < numrays; r++)
+            hitscan(sv, sectnum, vec[r].x, vec[r].y, vec[r].z, &hits[r], cliptype);
+
+        return sectnum < 0 ? -1 : 0;
+    }
+
+    for (; numrays > 0; numrays -= MAXHITSCANBATCH, vec += MAXHITSCANBATCH, hits += MAXHITSCANBATCH)
+    {
+        int const batchrays = min(numrays, MAXHITSCANBATCH);
+        uint64_t active = 0;
+
+        for (int r = 0; r < batchrays; r++)
+        {
+            hits[r].sect = -1; hits[r].wall = -1; hits[r].sprite = -1;
+            hits[r].xy = hitscangoal;
+
+            hitscanbatch_vx[r] = vec[r].x;
+            hitscanbatch_vy[r] = vec[r].y;
+            hitscanbatch_sectlist[r][0] = sectnum;
+            hitscanbatch_sectcnt[r] = 0;
+            hitscanbatch_sectnum[r] = 1;
+
+            active |= (uint64_t)1 << r;
+        }
+
+        while (active)
+        {
+            // the first ray that isn't done yet picks the sector, and every
+            // ray that would visit the same sector next comes along
+            int first = 0;
+            while (((active >> first) & 1) == 0)
+                first++;
+
+            int const dasector = hitscanbatch_sectlist[first][hitscanbatch_sectcnt[first]];
+            uint64_t rays = 0;
+
+            for (int r = first; r < batchrays; r++)
+                if (((active >> r) & 1) && hitscanbatch_sectlist[r][hitscanbatch_sectcnt[r]] == dasector)
+                    rays |= (uint64_t)1 << r;
+
+            hitscan_batchsector(sv, dasector, batchrays, rays, vec, hits, cliptype);
+
+            for (int r = first; r < batchrays; r++)
+                if (((rays >> r) & 1) && ++hitscanbatch_sectcnt[r] >= hitscanbatch_sectnum[r])
+                    active &= ~((uint64_t)1 << r);
+        }
+    }
+
+    return 0;
+}
@@ -16,6 +16,17 @@ cpuinfo_t cpu;
 static char g_cpuVendorIDString[16];
 static char g_cpuBrandString[48];
 
+static uint32_t sysGetXCR0(void)
+{
+#ifdef _MSC_VER
+    return (uint32_t)_xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+}
+
 void sysReadCPUID()
 {
     int32_t regs[4];
@@ -36,6 +47,8 @@ void sysReadCPUID()
 
     cpu.vendorIDString = g_cpuVendorIDString;
 
+    auto const maxleaf = (unsigned)regs[0];
+
     if (!Bstrcmp(g_cpuVendorIDString, "GenuineIntel"))
         cpu.type = CPU_INTEL;
     else if (!Bstrcmp(g_cpuVendorIDString, "AuthenticAMD"))
@@ -43,6 +56,30 @@ void sysReadCPUID()
     else
         cpu.type = CPU_UNKNOWN;
 
+    if (maxleaf >= 1)
+    {
+#ifdef _WIN32
+        __cpuid(regs, 1);
+#else
+        __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        cpu.features.sse2  = (regs[3] & (1 << 26)) != 0;
+        cpu.features.sse41 = (regs[2] & (1 << 19)) != 0;
+
+        // AVX2 also needs the OS to save the upper halves of the ymm registers
+        if ((regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && (sysGetXCR0() & 6) == 6 && maxleaf >= 7)
+        {
+#ifdef _WIN32
+            __cpuidex(regs, 7, 0);
+#else
+            __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+            cpu.features.avx2 = (regs[1] & (1 << 5)) != 0;
+        }
+
+        DVLOG_F(LOG_DEBUG, "CPUID features: SSE2 %d, SSE4.1 %d, AVX2 %d", !!cpu.features.sse2, !!cpu.features.sse41, !!cpu.features.avx2);
+    }
+
 #ifdef _WIN32
     __cpuid(regs, 0x80000000);
 #else
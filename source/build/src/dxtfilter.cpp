@@ -68,12 +68,12 @@ static uint16_t dedxt_hicoadd(uint16_t c)
     b = ((c>> 0)+(g>>1))&31;
     return ((r<<11)+(g<<5)+b);
 }
-#endif
 
-void dxt_handle_io(int32_t len, void *midbuf, char *packbuf)
+// Packs a chunk of the entry being written and adds it to it, see texcache_writechunk().
+static int32_t dxt_handle_io(texcachemip *mip, int c, int32_t len, void *midbuf, char *packbuf)
 {
     void *writebuf;
-    int32_t j, cleng;
+    int32_t cleng;
 
     if (glusetexcache == 2)
     {
@@ -92,67 +92,23 @@ void dxt_handle_io(int32_t len, void *midbuf, char *packbuf)
         writebuf = midbuf;
     }
 
-    // native -> external (little endian)
-    j = B_LITTLE32(cleng);
-    buildvfs_fwrite(&j, sizeof(j), 1, texcache.dataFilePtr);
-    buildvfs_fwrite(writebuf, cleng, 1, texcache.dataFilePtr);
-}
-
-int32_t dedxt_handle_io(int32_t j /* TODO: better name */,
-                               void *midbuf, int32_t mbufsiz, char *packbuf, int32_t ispacked)
-{
-    void *inbuf;
-    int32_t cleng;
-
-    if (texcache_readdata(&cleng, sizeof(int32_t)))
-        return -1;
-
-    // external (little endian) -> native
-    cleng = B_LITTLE32(cleng);
-
-    inbuf = (ispacked && cleng < j) ? packbuf : midbuf;
-
-    if (texcache.rw_mmap.is_mapped() && texcache.rw_mmap.mapped_length() >= texcache.dataFilePos + cleng)
-    {
-        if (ispacked && cleng < j)
-        {
-            if (LZ4_decompress_safe(texcache.rw_mmap.data() + texcache.dataFilePos, (char*)midbuf, cleng, mbufsiz) <= 0)
-            {
-                texcache.dataFilePos += cleng;
-                return -1;
-            }
-        }
-        else Bmemcpy(inbuf, texcache.rw_mmap.data() + texcache.dataFilePos, cleng);
-
-        texcache.dataFilePos += cleng;
-    }
-    else
-    {
-        buildvfs_fseek_abs(texcache.dataFilePtr, texcache.dataFilePos);
-        texcache.dataFilePos += cleng;
-
-        if (buildvfs_fread(inbuf, cleng, 1, texcache.dataFilePtr) != 1)
-            return -1;
-
-        if (ispacked && cleng < j)
-            if (LZ4_decompress_safe(packbuf, (char*)midbuf, cleng, mbufsiz) <= 0)
-                return -1;
-    }
+    mip->chunklen[c] = cleng;
+    mip->chunkofs[c] = texcache_writechunk(writebuf, cleng);
 
-    return 0;
+    return mip->chunkofs[c] < 0;
 }
 
-#ifndef EDUKE32_GLES
-// NOTE: <pict> members are in external (little) endianness.
-int32_t dxtfilter(const texcachepicture *pict, const char *pic, void *midbuf, char *packbuf, uint32_t miplen)
+// NOTE: <mip> members are in native endianness.
+int32_t dxtfilter(texcachemip *mip, const char *pic, void *midbuf, char *packbuf)
 {
+    uint32_t const miplen = mip->pict.size;
     uint32_t j, k, offs, stride;
     char *cptr;
 
-    if ((pict->format == (signed) B_LITTLE32(GL_COMPRESSED_RGB_S3TC_DXT1_EXT)) ||
-            (pict->format == (signed) B_LITTLE32(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT))) { offs = 0; stride = 8; }
-    else if ((pict->format == (signed) B_LITTLE32(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)) ||
-             (pict->format == (signed) B_LITTLE32(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT))) { offs = 8; stride = 16; }
+    if ((mip->pict.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ||
+            (mip->pict.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)) { offs = 0; stride = 8; }
+    else if ((mip->pict.format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) ||
+             (mip->pict.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)) { offs = 8; stride = 16; }
     else
         { offs = 0; stride = 8; }
 
@@ -164,7 +120,8 @@ int32_t dxtfilter(const texcachepicture *pict, const char *pic, void *midbuf, ch
         for (j=stride; (unsigned)j<miplen; j+=stride)
             for (k=0; k<8; k++) *cptr++ = pic[j+k];
 
-        dxt_handle_io(tabledivide32(miplen, stride)<<3, midbuf, packbuf);
+        if (dxt_handle_io(mip, TEXCACHECHUNK_ALPHA, tabledivide32(miplen, stride)<<3, midbuf, packbuf))
+            return -1;
     }
 
     //rgb0,rgb1
@@ -173,7 +130,8 @@ int32_t dxtfilter(const texcachepicture *pict, const char *pic, void *midbuf, ch
         for (j=0; (unsigned)j<miplen; j+=stride)
             { B_BUF16(cptr, dxt_hicosub(B_UNBUF16(&pic[offs+j+k]))); cptr += 2; }
 
-    dxt_handle_io(tabledivide32(miplen, stride)<<2, midbuf, packbuf);
+    if (dxt_handle_io(mip, TEXCACHECHUNK_RGB, tabledivide32(miplen, stride)<<2, midbuf, packbuf))
+        return -1;
 
     //index_4x4
     cptr = (char *)midbuf;
@@ -187,62 +145,63 @@ int32_t dxtfilter(const texcachepicture *pict, const char *pic, void *midbuf, ch
         cptr += 4;
     }
 
-    dxt_handle_io(tabledivide32(miplen, stride)<<2, midbuf, packbuf);
+    if (dxt_handle_io(mip, TEXCACHECHUNK_INDEX, tabledivide32(miplen, stride)<<2, midbuf, packbuf))
+        return -1;
 
     return 0;
 }
 
-// NOTE: <pict> members are in native endianness.
-int32_t dedxtfilter(const texcachepicture *pict, char *pic, void *midbuf, char *packbuf, int32_t ispacked)
+// NOTE: <mip> members are in native endianness.
+// Unpacks chunk c of the level into midbuf, which holds texcache_chunksize()
+// bytes, and undoes its filter into the fields of the DXT blocks at pic it
+// was taken from. The chunks of a level can be handled at the same time.
+int32_t dedxtfilter(const texcachemip *mip, int c, const char *entry, char *pic, void *midbuf, int32_t ispacked)
 {
     int32_t j, k, offs, stride;
+    int32_t const size = mip->pict.size;
     char *cptr;
 
-    if ((pict->format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ||
-            (pict->format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)) { offs = 0; stride = 8; }
-    else if ((pict->format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) ||
-             (pict->format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)) { offs = 8; stride = 16; }
+    if ((mip->pict.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ||
+            (mip->pict.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)) { offs = 0; stride = 8; }
+    else if ((mip->pict.format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) ||
+             (mip->pict.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)) { offs = 8; stride = 16; }
     else
         { offs = 0; stride = 8; }
 
-    if (stride == 16) //If DXT3...
-    {
-        //alpha_4x4
-        if (dedxt_handle_io(tabledivide32(pict->size, stride)*8, midbuf, pict->size, packbuf, ispacked))
-            return -1;
-
-        cptr = (char *)midbuf;
-        for (k=0; k<8; k++) pic[k] = *cptr++;
-        for (j=stride; j<pict->size; j+=stride)
-            for (k=0; k<8; k++) pic[j+k] = (*cptr++);
-    }
-
-    //rgb0,rgb1
-    if (dedxt_handle_io(tabledivide32(pict->size, stride)*4, midbuf, pict->size, packbuf, ispacked))
+    if (texcache_unpackchunk(entry, mip, c, (char *)midbuf, ispacked))
         return -1;
 
     cptr = (char *)midbuf;
-    for (k=0; k<=2; k+=2)
+
+    switch (c)
     {
-        for (j=0; j<pict->size; j+=stride)
+    case TEXCACHECHUNK_ALPHA: //If DXT3...
+        for (k=0; k<8; k++) pic[k] = *cptr++;
+        for (j=stride; j<size; j+=stride)
+            for (k=0; k<8; k++) pic[j+k] = (*cptr++);
+        break;
+
+    case TEXCACHECHUNK_RGB: //rgb0,rgb1
+        for (k=0; k<=2; k+=2)
         {
-            B_BUF16(&pic[offs+j+k], dedxt_hicoadd(B_UNBUF16(cptr)));
-            cptr += 2;
+            for (j=0; j<size; j+=stride)
+            {
+                B_BUF16(&pic[offs+j+k], dedxt_hicoadd(B_UNBUF16(cptr)));
+                cptr += 2;
+            }
         }
-    }
+        break;
 
-    //index_4x4:
-    if (dedxt_handle_io(tabledivide32(pict->size, stride)*4, midbuf, pict->size, packbuf, ispacked))
-        return -1;
-
-    cptr = (char *)midbuf;
-    for (j=0; j<pict->size; j+=stride)
-    {
-        pic[j+offs+4] = ((cptr[0]>>0)&3) + (((cptr[1]>>0)&3)<<2) + (((cptr[2]>>0)&3)<<4) + (((cptr[3]>>0)&3)<<6);
-        pic[j+offs+5] = ((cptr[0]>>2)&3) + (((cptr[1]>>2)&3)<<2) + (((cptr[2]>>2)&3)<<4) + (((cptr[3]>>2)&3)<<6);
-        pic[j+offs+6] = ((cptr[0]>>4)&3) + (((cptr[1]>>4)&3)<<2) + (((cptr[2]>>4)&3)<<4) + (((cptr[3]>>4)&3)<<6);
-        pic[j+offs+7] = ((cptr[0]>>6)&3) + (((cptr[1]>>6)&3)<<2) + (((cptr[2]>>6)&3)<<4) + (((cptr[3]>>6)&3)<<6);
-        cptr += 4;
+    case TEXCACHECHUNK_INDEX: //index_4x4
+        for (j=0; j<size; j+=stride)
+        {
+            pic[j+offs+4] = ((cptr[0]>>0)&3) + (((cptr[1]>>0)&3)<<2) + (((cptr[2]>>0)&3)<<4) + (((cptr[3]>>0)&3)<<6);
+            pic[j+offs+5] = ((cptr[0]>>2)&3) + (((cptr[1]>>2)&3)<<2) + (((cptr[2]>>2)&3)<<4) + (((cptr[3]>>2)&3)<<6);
+            pic[j+offs+6] = ((cptr[0]>>4)&3) + (((cptr[1]>>4)&3)<<2) + (((cptr[2]>>4)&3)<<4) + (((cptr[3]>>4)&3)<<6);
+            pic[j+offs+7] = ((cptr[0]>>6)&3) + (((cptr[1]>>6)&3)<<2) + (((cptr[2]>>6)&3)<<4) + (((cptr[3]>>6)&3)<<6);
+            cptr += 4;
+        }
+        break;
     }
 
     return 0;
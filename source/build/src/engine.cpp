@@ -9,9 +9,11 @@
 #define engine_c_
 
 #include "a.h"
+#include "actorprefetch.h"
 #include "baselayer.h"
 #include "build.h"
 #include "cache1d.h"
+#include "classicstrips.h"
 #include "colmatch.h"
 #include "common.h"
 #include "communityapi.h"
@@ -27,7 +29,10 @@
 #include "palette.h"
 #include "pragmas.h"
 #include "scriptfile.h"
+#include "sectorgrid.h"
+#include "sectorpvs.h"
 #include "softsurface.h"
+#include "tilepreload.h"
 #include "vfs.h"
 
 #ifdef USE_OPENGL
@@ -38,6 +43,7 @@
 #  include "polymer.h"
 # endif
 # include "polymost.h"
+# include "texcache.h"
 #endif
 
 //////////
@@ -248,7 +254,8 @@ invalid:
         
         cht->upscale = upscale;
         cht->lock    = CACHE1D_UNLOCKED;
-        
+
+        classicStripsFlush();
         g_cache.allocateBlock(&cht->ptr, xsiz * ysiz, &cht->lock);
 
         //paletteFlushClosestColor();
@@ -1875,6 +1882,7 @@ skipitaddwall:
             if (wall[thewall[s]].point2 != thewall[bunchp2[s]] || xb2[s] >= xb1[bunchp2[s]])
             {
                 bunchfirst[numbunches++] = bunchp2[s], bunchp2[s] = -1;
+                classicbunchcnt++;
 #ifdef YAX_ENABLE
                 if (scansector_retfast)
                     return;
@@ -2907,6 +2915,9 @@ static void ceilscan(int32_t x1, int32_t x2, int32_t sectnum)
         return;
     }
 
+    // slowhline() draws directly
+    classicStripsFlush();
+
     switch (globalorientation&0x180)
     {
     case 128:
@@ -3005,6 +3016,9 @@ static void florscan(int32_t x1, int32_t x2, int32_t sectnum)
         return;
     }
 
+    // slowhline() draws directly
+    classicStripsFlush();
+
     switch (globalorientation&0x180)
     {
     case 128:
@@ -3795,119 +3809,17 @@ static void fgrouscan(int32_t dax1, int32_t dax2, int32_t sectnum, char dastat)
 
             globalx3 = globalx2*(1.f/1024.f);
             globaly3 = globaly2*(1.f/1024.f);
-            float bz = (y2*globalzd)*(1.f/65536.f) + globalzx*(1.f/64.f);
-            uint8_t *p = (uint8_t*)(ylookup[y2]+x+frameoffset);
-            intptr_t* A_C_RESTRICT slopalptr = (intptr_t*)nptr2;
-            const char* const A_C_RESTRICT trans = paletteGetBlendTable(0);
-            uint32_t u, v;
-            int cnt = y2-y1+1;
-#define LINTERPSIZ 4
-            int u0 = Blrintf(1048576.f*globalx3/bz);
-            int v0 = Blrintf(1048576.f*globaly3/bz);
-            switch (globalorientation&0x180)
-            {
-            case 0:
-                while (cnt > 0)
-                {
-                    bz += bzinc*(1<<LINTERPSIZ);
-                    int u1 = Blrintf(1048576.f*globalx3/bz);
-                    int v1 = Blrintf(1048576.f*globaly3/bz);
-                    u1 = (u1-u0)>>LINTERPSIZ;
-                    v1 = (v1-v0)>>LINTERPSIZ;
-                    int cnt2 = min(cnt, 1<<LINTERPSIZ);
-                    for (; cnt2>0; cnt2--)
-                    {
-                        u = (globalx1+u0)&0xffff;
-                        v = (globaly1+v0)&0xffff;
-                        *p = *(uint8_t *)(((intptr_t)slopalptr[0])+ggbuf[((u>>(16-gglogx))<<gglogy)+(v>>(16-gglogy))]);
-                        slopalptr--;
-                        p += ggpinc;
-                        u0 += u1;
-                        v0 += v1;
-                    }
-                    cnt -= 1<<LINTERPSIZ;
-                }
-                break;
-            case 128:
-                while (cnt > 0)
-                {
-                    bz += bzinc*(1<<LINTERPSIZ);
-                    int u1 = Blrintf(1048576.f*globalx3/bz);
-                    int v1 = Blrintf(1048576.f*globaly3/bz);
-                    u1 = (u1-u0)>>LINTERPSIZ;
-                    v1 = (v1-v0)>>LINTERPSIZ;
-                    int cnt2 = min(cnt, 1<<LINTERPSIZ);
-                    for (; cnt2>0; cnt2--)
-                    {
-                        u = (globalx1+u0)&0xffff;
-                        v = (globaly1+v0)&0xffff;
-                        uint8_t ch = ggbuf[((u>>(16-gglogx))<<gglogy)+(v>>(16-gglogy))];
-                        if (ch != 255)
-                            *p = *(uint8_t *)(((intptr_t)slopalptr[0])+ch);
-                        slopalptr--;
-                        p += ggpinc;
-                        u0 += u1;
-                        v0 += v1;
-                    }
-                    cnt -= 1<<LINTERPSIZ;
-                }
-                break;
-            case 256:
-                while (cnt > 0)
-                {
-                    bz += bzinc*(1<<LINTERPSIZ);
-                    int u1 = Blrintf(1048576.f*globalx3/bz);
-                    int v1 = Blrintf(1048576.f*globaly3/bz);
-                    u1 = (u1-u0)>>LINTERPSIZ;
-                    v1 = (v1-v0)>>LINTERPSIZ;
-                    int cnt2 = min(cnt, 1<<LINTERPSIZ);
-                    for (; cnt2>0; cnt2--)
-                    {
-                        u = (globalx1+u0)&0xffff;
-                        v = (globaly1+v0)&0xffff;
-                        uint8_t ch = ggbuf[((u>>(16-gglogx))<<gglogy)+(v>>(16-gglogy))];
-                        if (ch != 255)
-                        {
-                            ch = *(uint8_t *)(((intptr_t)slopalptr[0])+ch);
-                            *p = trans[(*p<<8)|ch];
-                        }
-                        slopalptr--;
-                        p += ggpinc;
-                        u0 += u1;
-                        v0 += v1;
-                    }
-                    cnt -= 1<<LINTERPSIZ;
-                }
-                break;
-            case 384:
-                while (cnt > 0)
-                {
-                    bz += bzinc*(1<<LINTERPSIZ);
-                    int u1 = Blrintf(1048576.f*globalx3/bz);
-                    int v1 = Blrintf(1048576.f*globaly3/bz);
-                    u1 = (u1-u0)>>LINTERPSIZ;
-                    v1 = (v1-v0)>>LINTERPSIZ;
-                    int cnt2 = min(cnt, 1<<LINTERPSIZ);
-                    for (; cnt2>0; cnt2--)
-                    {
-                        u = (globalx1+u0)&0xffff;
-                        v = (globaly1+v0)&0xffff;
-                        uint8_t ch = ggbuf[((u>>(16-gglogx))<<gglogy)+(v>>(16-gglogy))];
-                        if (ch != 255)
-                        {
-                            ch = *(uint8_t *)(((intptr_t)slopalptr[0])+ch);
-                            *p = trans[ch<<8|*p];
-                        }
-                        slopalptr--;
-                        p += ggpinc;
-                        u0 += u1;
-                        v0 += v1;
-                    }
-                    cnt -= 1<<LINTERPSIZ;
-                }
-                break;
-            }
-#undef LINTERPSIZ
+            fslopecol_t const col = { (intptr_t)ggbuf, (intptr_t)paletteGetBlendTable(0),
+                                      (y2*globalzd)*(1.f/65536.f) + globalzx*(1.f/64.f), bzinc,
+                                      globalx3, globaly3, globalx1, globaly1, ggpinc,
+                                      (int16_t)(globalorientation&0x180), (int8_t)gglogx, (int8_t)gglogy };
+            intptr_t const p = ylookup[y2]+x+frameoffset;
+
+            if (classicstrips_active)
+                classicStripsFSlope(col, p, nptr2, y2-y1+1);
+            else
+                classicFSlopeColumn(col, (uint8_t *)p, nptr2, y2-y1+1);
+
             if ((x&15) == 0) faketimerhandler();
         }
 next_most:
@@ -4123,10 +4035,12 @@ static void grouscan(int32_t dax1, int32_t dax2, int32_t sectnum, char dastat)
                 slopevlin(ylookup[y2]+x+frameoffset,krecipasm(asm3>>3),(intptr_t)nptr2,y2-y1+1,globalx1,globaly1);
                 break;
             case 128:
+                classicStripsFlush();
                 mslopevlin((uint8_t *)(ylookup[y2]+x+frameoffset),nptr2,y2-y1+1,globalx1,globaly1);
                 break;
             case 256:
             case 384:
+                classicStripsFlush();
                 tslopevlin((uint8_t *)(ylookup[y2]+x+frameoffset),nptr2,y2-y1+1,globalx1,globaly1);
                 break;
             }
@@ -8979,6 +8893,9 @@ int32_t engineInit(void)
     if (engineLoadTables())
         return 1;
 
+    classicSimdInit();
+    kplibSimdInit(KPLIBSIMD_AVX2);
+
     xyaspect = -1;
 
     rotatesprite_y_offset = 0;
@@ -9040,6 +8957,11 @@ int32_t enginePostInit(void)
 void engineUnInit(void)
 {
     communityapiShutdown();
+    classicStripsUninit();
+    actorPrefetchUninit();
+    tilePreloadUninit();
+    sectorGridUninit();
+    sectorPVSUninit();
 
 #ifdef USE_OPENGL
     if (qsetmode)
@@ -9051,6 +8973,8 @@ void engineUnInit(void)
 # endif
     }
     hicinit();
+    texcache_freepool();
+    voxfreepool();
 #endif
 
     Buninitart();
@@ -9357,6 +9281,8 @@ int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
 
     frameoffset = frameplace + windowxy1.y*bytesperline + windowxy1.x;
 
+    classicStripsBegin(frameplace, bytesperline, xdim);
+
     numhits = xdimen; numscans = 0; numbunches = 0;
     maskwallcnt = 0; smostwallcnt = 0; smostcnt = 0; spritesortcnt = 0;
 
@@ -9416,6 +9342,7 @@ int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
         if (numbunches==0)
         {
             inpreparemirror = 0;
+            classicStripsEnd();
             videoEndDrawing();  //!!!
             return 0;
         }
@@ -9504,6 +9431,8 @@ int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
         bunchlast[closest] = bunchlast[numbunches];
     }
 
+    classicStripsEnd();
+
     videoEndDrawing();   //}}}
 
     return inpreparemirror;
@@ -10515,6 +10444,10 @@ int sectorsareconnected(int const sect1, int const sect2)
 
 void calc_sector_reachability(void)
 {
+    // the games call this after restoring a saved map state; this also
+    // throws out the visibility table and the clip cache
+    sectorGridInvalidate(-1);
+
     if (!numsectors)
         return;
 
@@ -10650,6 +10583,10 @@ static int32_t engineFinishLoadBoard(const vec3_t* dapos, int16_t* dacursectnum,
     numsprites = realnumsprites;
     Bassert(numsprites == Numsprites);
 
+    sectorGridBuild();
+    sectorPVSBuild();
+    clipCacheInvalidate(-1);
+
     //Must be after loading sectors, etc!
     updatesector(dapos->x, dapos->y, dacursectnum);
 
@@ -11589,18 +11526,38 @@ static void PolymostProcessVoxels(void)
     LOG_F(INFO, "Generating 3D meshes from voxel model data. This may take a while...");
     videoNextPage();
 
+    auto reqs = (voxloadreq_t *)Xmalloc(MAXVOXELS * sizeof(voxloadreq_t));
+    auto voxnums = (int16_t *)Xmalloc(MAXVOXELS * sizeof(int16_t));
+    int32_t numreqs = 0;
+
     for (bssize_t i=0; i<MAXVOXELS; i++)
     {
         if (voxfilenames[i])
         {
-            voxmodels[i] = voxload(voxfilenames[i]);
+            reqs[numreqs] = { voxfilenames[i], NULL, 0, NULL };
+            voxnums[numreqs++] = i;
+        }
+    }
+
+    voxloadbatch(reqs, numreqs);
+
+    for (bssize_t j=0; j<numreqs; j++)
+    {
+        int const i = voxnums[j];
+
+        if ((voxmodels[i] = reqs[j].model))
+        {
             voxmodels[i]->scale = voxscale[i]*(1.f/65536.f);
 # ifdef USE_GLEXT
             voxvboalloc(voxmodels[i]);
 # endif
-            DO_FREE_AND_NULL(voxfilenames[i]);
         }
+
+        DO_FREE_AND_NULL(voxfilenames[i]);
     }
+
+    Xfree(voxnums);
+    Xfree(reqs);
 }
 
 static void PolymostFreeVBOs(void)
@@ -11726,6 +11683,42 @@ int32_t videoSetGameMode(char davidoption, int32_t daupscaledxdim, int32_t daups
     return 0;
 }
 
+//
+// videoSetHeadlessMode
+//
+// Points the classic renderer at a caller-owned buffer of xsiz*ysiz bytes
+// instead of a window, e.g. for benchmarking without any video output.
+// Nothing is ever presented; the buffer can be inspected after each
+// renderDrawRoomsQ16()/renderDrawMasks() pair.
+void videoSetHeadlessMode(char *buf, int32_t xsiz, int32_t ysiz)
+{
+    xres = xdim = xsiz;
+    yres = ydim = ysiz;
+    bpp = 8;
+    bytesperline = xsiz;
+    upscalefactor = 1;
+
+#ifdef USE_OPENGL
+    fxdim = (float) xdim;
+    fydim = (float) ydim;
+
+    rendmode = REND_CLASSIC;
+#endif
+
+    // videoBeginDrawing() leaves frameplace alone while rendering offscreen
+    frameplace = (intptr_t)buf;
+    offscreenrendering = 1;
+
+    videoAllocateBuffers();
+
+    oxyaspect = oxdimen = oviewingrange = -1;
+
+    calc_ylookup(bytesperline, ydim);
+    videoSetViewableArea(0, 0, xdim-1, ydim-1);
+
+    qsetmode = 200;
+}
+
 
 //
 // nextpage
@@ -12233,12 +12226,8 @@ int32_t cansee_19950829(int32_t xs, int32_t ys, int32_t zs, int16_t sectnums, in
     return 0;
 }
 
-int32_t cansee(int32_t x1, int32_t y1, int32_t z1, int16_t sect1, int32_t x2, int32_t y2, int32_t z2, int16_t sect2, int32_t wallmask)
+static int32_t cansee_walk(int32_t x1, int32_t y1, int32_t z1, int16_t sect1, int32_t x2, int32_t y2, int32_t z2, int16_t sect2, int32_t wallmask)
 {
-    MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
-
-    if (enginecompatibilitymode == ENGINE_19950829)
-        return cansee_19950829(x1, y1, z1, sect1, x2, y2, z2, sect2);
     int32_t dacnt, danum;
     const int32_t x21 = x2-x1, y21 = y2-y1, z21 = z2-z1;
 
@@ -12247,18 +12236,6 @@ int32_t cansee(int32_t x1, int32_t y1, int32_t z1, int16_t sect1, int32_t x2, in
     int16_t pendingsectnum;
     vec3_t pendingvec;
 
-    // Negative sectnums can happen, for example if the player is using noclip.
-    // MAXSECTORS can happen from C-CON, e.g. canseespr with a sprite not in
-    // the game world.
-    if ((unsigned)sect1 >= MAXSECTORS || (unsigned)sect2 >= MAXSECTORS)
-        return 0;
-
-    if (!sectorsareconnected(sect1, sect2))
-    {
-        DVLOG_F(LOG_DEBUG, "cansee: sector %d can't reach sector %d", sect1, sect2);
-        return 0;
-    }
-
     Bmemset(&pendingvec, 0, sizeof(vec3_t));  // compiler-happy
 #endif
     Bmemset(sectbitmap, 0, sizeof(sectbitmap));
@@ -12421,6 +12398,43 @@ add_nextsector:
     return 0;
 }
 
+int32_t cansee(int32_t x1, int32_t y1, int32_t z1, int16_t sect1, int32_t x2, int32_t y2, int32_t z2, int16_t sect2, int32_t wallmask)
+{
+    MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
+
+    if (enginecompatibilitymode == ENGINE_19950829)
+        return cansee_19950829(x1, y1, z1, sect1, x2, y2, z2, sect2);
+
+#ifdef YAX_ENABLE
+    // Negative sectnums can happen, for example if the player is using noclip.
+    // MAXSECTORS can happen from C-CON, e.g. canseespr with a sprite not in
+    // the game world.
+    if ((unsigned)sect1 >= MAXSECTORS || (unsigned)sect2 >= MAXSECTORS)
+        return 0;
+
+    if (!sectorsareconnected(sect1, sect2))
+    {
+        DVLOG_F(LOG_DEBUG, "cansee: sector %d can't reach sector %d", sect1, sect2);
+        return 0;
+    }
+#endif
+
+    if (sectorPVSRejects(x1, y1, sect1, x2, y2, sect2))
+    {
+        if (!sectorpvs_check)
+            return 0;
+
+        int32_t const result = cansee_walk(x1, y1, z1, sect1, x2, y2, z2, sect2, wallmask);
+
+        if (result)
+            LOG_F(WARNING, "sector PVS: sector %d can see sector %d from (%d, %d) to (%d, %d)", sect1, sect2, x1, y1, x2, y2);
+
+        return result;
+    }
+
+    return cansee_walk(x1, y1, z1, sect1, x2, y2, z2, sect2, wallmask);
+}
+
 //
 // neartag
 //
@@ -12554,6 +12568,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
             wall[w].x = dax;
             wall[w].y = day;
             bitmap_set(walbitmap, w);
+            sectorGridInvalidate(sectorofwall(w));
 
             for (YAX_ITER_WALLS(w, j, tmpcf))
             {
@@ -12630,6 +12645,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
 
     wall[tempshort].x = dax;
     wall[tempshort].y = day;
+    sectorGridInvalidate(sectorofwall(tempshort));
 
     if (editstatus)
     {
@@ -12649,6 +12665,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
             wall[tempshort].x = dax;
             wall[tempshort].y = day;
             editwall[tempshort>>3] |= 1<<(tempshort&7);
+            sectorGridInvalidate(sectorofwall(tempshort));
         }
         else
         {
@@ -12662,6 +12679,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
                     wall[tempshort].x = dax;
                     wall[tempshort].y = day;
                     editwall[tempshort>>3] |= 1<<(tempshort&7);
+                    sectorGridInvalidate(sectorofwall(tempshort));
                 }
                 else
                 {
@@ -12779,6 +12797,116 @@ int findwallbetweensectors(int sect1, int sect2)
 int16_t updatesectorneighborlist[MAXSECTORS];
 uint8_t updatesectorneighbormap[(MAXSECTORS+7)>>3];
 
+// results of the predicates passed to sectorsearch()
+enum
+{
+    SECTORSEARCH_OUTSIDE,  // (x,y) isn't inside the sector
+    SECTORSEARCH_REJECTED, // (x,y) is inside, but the sector doesn't qualify
+    SECTORSEARCH_FOUND,
+};
+
+// Returns the first sector for which pred() returns SECTORSEARCH_FOUND, going
+// outward from origin in the order origin, origin+1, origin-1, origin+2, ...
+// An origin of numsectors scans from the highest sector down.
+template <typename Pred>
+static int sectorsearch_linear(int const origin, Pred pred)
+{
+    if ((unsigned)origin < (unsigned)numsectors && pred(origin) == SECTORSEARCH_FOUND)
+        return origin;
+
+    for (int highsect = origin + 1, lowsect = origin - 1; highsect < numsectors || lowsect >= 0; highsect++, lowsect--)
+    {
+        if ((unsigned)highsect < (unsigned)numsectors && pred(highsect) == SECTORSEARCH_FOUND)
+            return highsect;
+        if ((unsigned)lowsect < (unsigned)numsectors && pred(lowsect) == SECTORSEARCH_FOUND)
+            return lowsect;
+    }
+
+    return -1;
+}
+
+// Same as sectorsearch_linear(), but only visits the sectors whose bounding
+// box contains (x,y) according to the sector grid.
+template <typename Pred>
+static int sectorsearch(int32_t const x, int32_t const y, int const origin, Pred pred)
+{
+    int32_t numcandidates;
+    int16_t const *const candidates = sectorGridQuery(x, y, &numcandidates);
+
+    if (!candidates)
+        return sectorsearch_linear(origin, pred);
+
+    int highidx = 0;
+    while (highidx < numcandidates && candidates[highidx] < origin)
+        highidx++;
+
+    int lowidx = highidx - 1;
+    int sectnum = -1, anyinside = 0;
+
+    while (highidx < numcandidates || lowidx >= 0)
+    {
+        int const candidate = (lowidx < 0 || (highidx < numcandidates && 2*(candidates[highidx]-origin)-1 < 2*(origin-candidates[lowidx])))
+                              ? candidates[highidx++]
+                              : candidates[lowidx--];
+        int const result = pred(candidate);
+
+        if (result == SECTORSEARCH_FOUND)
+        {
+            sectnum = candidate;
+            break;
+        }
+
+        anyinside |= (result == SECTORSEARCH_REJECTED);
+    }
+
+    // A point that no sector in the grid contains may still be inside a
+    // sector whose walls were moved without sectorGridInvalidate().
+    if (sectnum < 0 && !anyinside)
+        return sectorsearch_linear(origin, pred);
+
+    if (sectorgrid_check)
+    {
+        int const linsectnum = sectorsearch_linear(origin, pred);
+
+        if (linsectnum != sectnum)
+        {
+            LOG_F(WARNING, "sector grid: found sector %d at (%d, %d) instead of %d", sectnum, x, y, linsectnum);
+            return linsectnum;
+        }
+    }
+
+    return sectnum;
+}
+
+static FORCE_INLINE int sectorsearch_inside(int32_t const x, int32_t const y, int const sectnum)
+{
+    return inside_p(x, y, sectnum) ? SECTORSEARCH_FOUND : SECTORSEARCH_OUTSIDE;
+}
+
+static FORCE_INLINE int sectorsearch_inside_exclude(int32_t const x, int32_t const y, int const sectnum, const uint8_t *excludesectbitmap)
+{
+    if (!inside_p(x, y, sectnum))
+        return SECTORSEARCH_OUTSIDE;
+
+    return bitmap_test(excludesectbitmap, sectnum) ? SECTORSEARCH_REJECTED : SECTORSEARCH_FOUND;
+}
+
+static FORCE_INLINE int sectorsearch_inside_z(int32_t const x, int32_t const y, int32_t const z, int const sectnum)
+{
+    if (!inside_p(x, y, sectnum))
+        return SECTORSEARCH_OUTSIDE;
+
+    int32_t cz, fz;
+    getzsofslope(sectnum, x, y, &cz, &fz);
+    return (z >= cz && z <= fz) ? SECTORSEARCH_FOUND : SECTORSEARCH_REJECTED;
+}
+
+static FORCE_INLINE int sectorsearch_inside_exclude_z(int32_t const x, int32_t const y, int32_t const z, int const sectnum, const uint8_t *excludesectbitmap)
+{
+    int const result = sectorsearch_inside_z(x, y, z, sectnum);
+    return (result == SECTORSEARCH_FOUND && bitmap_test(excludesectbitmap, sectnum)) ? SECTORSEARCH_REJECTED : result;
+}
+
 void updatesector_compat(int32_t const x, int32_t const y, int16_t* const sectnum)
 {
     if (inside_p(x, y, *sectnum))
@@ -12801,36 +12929,18 @@ void updatesector_compat(int32_t const x, int32_t const y, int16_t* const sectnu
 
     // we need to support passing in a sectnum of -1, unfortunately
 
-    for (int i = numsectors - 1; i >= 0; --i)
-        if (inside_p(x, y, i))
-            SET_AND_RETURN(*sectnum, i);
-
-    *sectnum = -1;
+    *sectnum = sectorsearch(x, y, numsectors, [=](int i) { return sectorsearch_inside(x, y, i); });
 }
 
 void updatesector_tryremaining(int32_t const x, int32_t const y, int16_t *const sectnum)
 {
     // we need to support passing in a sectnum of -1, unfortunately
     int16_t const sect = *sectnum == -1 ? numsectors >> 1 : *sectnum;
-    int trycnt = max<int>(numsectors - sect, sect);
 
     // re-use the bitmap generated by updatesectorneighbor[z]
     // since these sectors were already checked there, there's
     // no need to check them again.
-    if (inside_exclude_p(x, y, sect, updatesectorneighbormap))
-        SET_AND_RETURN(*sectnum, sect);
-
-    int16_t highsect = sect, lowsect = sect;
-
-    do
-    {
-        if (highsect < numsectors-1 && inside_exclude_p(x, y, ++highsect, updatesectorneighbormap))
-            SET_AND_RETURN(*sectnum, highsect);
-        if (lowsect > 0 && inside_exclude_p(x, y, --lowsect, updatesectorneighbormap))
-            SET_AND_RETURN(*sectnum, lowsect);
-    } while (trycnt--);
-
-    *sectnum = -1;
+    *sectnum = sectorsearch(x, y, sect, [=](int i) { return sectorsearch_inside_exclude(x, y, i, updatesectorneighbormap); });
 }
 
 // same as above but with z height checks
@@ -12838,22 +12948,8 @@ void updatesectorz_tryremaining(int32_t const x, int32_t const y, int32_t const
 {
     // we need to support passing in a sectnum of -1, unfortunately
     int16_t const sect = *sectnum == -1 ? numsectors >> 1 : *sectnum;
-    int trycnt = max<int>(numsectors - sect, sect);
-
-    if (inside_exclude_z_p(x, y, z, sect, updatesectorneighbormap))
-        SET_AND_RETURN(*sectnum, sect);
-
-    int16_t highsect = sect, lowsect = sect;
-
-    do
-    {
-        if (highsect < numsectors-1 && inside_exclude_z_p(x, y, z, ++highsect, updatesectorneighbormap))
-            SET_AND_RETURN(*sectnum, highsect);
-        if (lowsect > 0 && inside_exclude_z_p(x, y, z, --lowsect, updatesectorneighbormap))
-            SET_AND_RETURN(*sectnum, lowsect);
-    } while (trycnt--);
 
-    *sectnum = -1;
+    *sectnum = sectorsearch(x, y, sect, [=](int i) { return sectorsearch_inside_exclude_z(x, y, z, i, updatesectorneighbormap); });
 }
 
 void updatesector(int32_t const x, int32_t const y, int16_t* const sectnum)
@@ -12895,18 +12991,8 @@ void updatesectorexclude(int32_t const x, int32_t const y, int16_t * const sectn
     }
 
     int16_t const sect = *sectnum == -1 ? numsectors >> 1 : *sectnum;
-    int trycnt = max<int>(numsectors - sect, sect);
-    int16_t highsect = sect, lowsect = sect;
 
-    do
-    {
-        if (highsect < numsectors-1 && inside_exclude_p(x, y, ++highsect, excludesectbitmap))
-            SET_AND_RETURN(*sectnum, highsect);
-        if (lowsect > 0 && inside_exclude_p(x, y, --lowsect, excludesectbitmap))
-            SET_AND_RETURN(*sectnum, lowsect);
-    } while (trycnt--);
-
-    *sectnum = -1;
+    *sectnum = sectorsearch(x, y, sect, [=](int i) { return sectorsearch_inside_exclude(x, y, i, excludesectbitmap); });
 }
 
 void updatesectorz_compat(int32_t const x, int32_t const y, int32_t const z, int16_t * const sectnum)
@@ -12977,11 +13063,7 @@ void updatesectorz_compat(int32_t const x, int32_t const y, int32_t const z, int
     }
 
     // we need to support passing in a sectnum of -1, unfortunately
-    for (int i = numsectors - 1; i >= 0; --i)
-        if (inside_z_p(x, y, z, i))
-            SET_AND_RETURN(*sectnum, i);
-
-    *sectnum = -1;
+    *sectnum = sectorsearch(x, y, numsectors, [=](int i) { return sectorsearch_inside_z(x, y, z, i); });
 }
 
 
@@ -3,53 +3,116 @@
 #include "hash.h"
 #include "baselayer.h"
 
-// vaguely inspired by https://databasearchitects.blogspot.com/2020/01/all-hash-table-sizes-you-will-ever-need.html
-// all things considered, I would have just used that implementation if MSVC had any support for __int128
-static constexpr uint64_t primes[] = {
-    11ull,     13ull,     17ull,     19ull,     37ull,      41ull,      43ull,     59ull,     67ull,     73ull,     79ull,     83ull,     109ull,    113ull,
-    131ull,    139ull,    149ull,    157ull,    163ull,     173ull,     191ull,    211ull,    227ull,    241ull,    257ull,    269ull,    283ull,    307ull,
-    331ull,    349ull,    373ull,    397ull,    419ull,     439ull,     461ull,    499ull,    523ull,    557ull,    587ull,    617ull,    647ull,    691ull,
-    727ull,    769ull,    809ull,    877ull,    941ull,     997ull,     1049ull,   1103ull,   1163ull,   1223ull,   1283ull,   1367ull,   1439ull,   1523ull,
-    1609ull,   1693ull,   1783ull,   1871ull,   1987ull,    2087ull,    2203ull,   2333ull,   2459ull,   2591ull,   2719ull,   2857ull,   2999ull,   3163ull,
-    3323ull,   3491ull,   3671ull,   3863ull,   4091ull,    4297ull,    4513ull,   4751ull,   4987ull,   5237ull,   5501ull,   5791ull,   6079ull,   6397ull,
-    6733ull,   7079ull,   7433ull,   7877ull,   8269ull,    8681ull,    9127ull,   9587ull,   10067ull,  10589ull,  11117ull,  11677ull,  12263ull,  12893ull,
-    13537ull,  14221ull,  14947ull,  15727ull,  16519ull,   17351ull,   18217ull,  19139ull,  20101ull,  21107ull,  22189ull,  23297ull,  24473ull,  25717ull,
-    27011ull,  28387ull,  29819ull,  31321ull,  32887ull,   34537ull,   36263ull,  38083ull,  39989ull,  41999ull,  44101ull,  46307ull,  48623ull,  51059ull,
-    53611ull,  56333ull,  59149ull,  62119ull,  65239ull,   68501ull,   71933ull,  75533ull,  79309ull,  83273ull,  87481ull,  91867ull,  96461ull,  101287ull,
-    106357ull, 111697ull, 117281ull, 123191ull, 129379ull,  135851ull,  142657ull, 149791ull, 157279ull, 165161ull, 173431ull, 182101ull, 191227ull, 200789ull,
-    210827ull, 221399ull, 232499ull, 244157ull, 256369ull,  269189ull,  282661ull, 296797ull, 311677ull, 327263ull, 343627ull, 360817ull, 378869ull, 397811ull,
-    417719ull, 438611ull, 460543ull, 483611ull, 507803ull,  533213ull,  559877ull, 587891ull, 617311ull, 648181ull, 680597ull, 714673ull, 750413ull, 787981ull,
-    827389ull, 868771ull, 912211ull, 957821ull, 1005761ull, 1056049ull,
-};
-
-static uint64_t hash_findprime(uint64_t desiredSize)
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+// both tables are open addressed with linear probing, sized to a power of two and kept at most 3/4 full.
+// deleting an item shifts the items after it in its run back toward their home slots instead of leaving
+// a tombstone, so lookups never have to step over dead slots.
+
+#define HASH_MINSLOTS 16u
+
+static FORCE_INLINE bool hash_overloaded(uint32_t const count, uint32_t const mask) { return (count + 1) * 4 > (mask + 1) * 3; }
+
+uint32_t hash_getcode(const char *s)
 {
-    if (desiredSize >= primes[ARRAY_SIZE(primes)-1])
+    char buf[64];
+    uint64_t h = 0;
+    int len;
+
+    // lowercased in chunks, so that no temporary copy of the whole string is needed.
+    // ASCII only, which is all that Bstrcasecmp() folds in the C locale, because tolower() is a call into the CRT.
+    do
+    {
+        for (len = 0; len < (int)sizeof(buf) && s[len]; len++)
+            buf[len] = s[len] | ((uint8_t)(s[len] - 'A') < 26u) << 5;
+
+        h = XXH3_64bits_withSeed(buf, len, h);
+        s += len;
+    } while (len == (int)sizeof(buf));
+
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// puts the items and live keys of the table into newly allocated storage with the given number of slots,
+// which also compacts the arena
+static void hash_rehash(hashtable_t *t, uint32_t const numslots)
+{
+    auto const olditems = t->items;
+    auto const oldarena = t->state.arena;
+    uint32_t const oldslots = t->state.mask + 1;
+
+    t->state.arenasiz  = max(t->state.arenasiz, (t->state.arenalen - t->state.arenadead) * 2);
+    t->state.arena     = (char *) Xmalloc(t->state.arenasiz);
+    t->state.arena[0]  = 0;
+    t->state.arenalen  = 1;
+    t->state.arenadead = 0;
+
+    t->items = (hashitem_t *) Xaligned_calloc(16, numslots, sizeof(hashitem_t));
+    t->state.mask  = numslots - 1;
+
+    for (auto item = olditems, items_end = olditems + oldslots; item < items_end; ++item)
     {
-        LOG_F(ERROR, "hash_findprime: size %" PRIu64 "requested, consider expanding prime table!", desiredSize);
-        return primes[ARRAY_SIZE(primes)-1];
+        if (!item->string)
+            continue;
+
+        uint32_t idx = item->code & t->state.mask;
+
+        while (t->items[idx].string)
+            idx = (idx + 1) & t->state.mask;
+
+        char const *const s   = oldarena + item->string;
+        uint32_t const    len = Bstrlen(s) + 1;
+
+        t->items[idx] = *item;
+        t->items[idx].string = t->state.arenalen;
+
+        Bmemcpy(t->state.arena + t->state.arenalen, s, len);
+        t->state.arenalen += len;
     }
 
-    uint64_t lower = 0, upper = ARRAY_SIZE(primes)-1;
-    while (lower != upper)
+    Xaligned_free(olditems);
+    Xfree(oldarena);
+}
+
+static uint32_t hash_intern(hashtable_t *t, const char *s)
+{
+    uint32_t const len = Bstrlen(s) + 1;
+
+    if (t->state.arenalen + len > t->state.arenasiz)
     {
-        uint64_t middle = lower + ((upper - lower) >> 1);
-        if (primes[middle] < desiredSize)
-            lower = middle + 1;
-        else if (primes[middle] > desiredSize)
-            upper = middle;
-        else
-            return primes[middle];
+        if (t->state.arenadead >= t->state.arenalen >> 1)
+            hash_rehash(t, t->state.mask + 1);
+
+        if (t->state.arenalen + len > t->state.arenasiz)
+        {
+            t->state.arenasiz = max(t->state.arenasiz * 2, t->state.arenalen + len);
+            t->state.arena    = (char *) Xrealloc(t->state.arena, t->state.arenasiz);
+        }
     }
-    return primes[lower];
+
+    uint32_t const ofs = t->state.arenalen;
+
+    Bmemcpy(t->state.arena + ofs, s, len);
+    t->state.arenalen += len;
+
+    return ofs;
 }
 
 void hash_init(hashtable_t *t)
 {
     hash_free(t);
-    t->prime.v = hash_findprime(t->size);
-    t->prime.d = libdivide::libdivide_u32_gen(t->prime.v);
-    t->items = (hashitem_t **) Xaligned_calloc(16, t->prime.v, sizeof(hashitem_t));
+
+    uint32_t const numslots = nextPow2(max(HASH_MINSLOTS, t->state.size * 4u / 3u + 1));
+
+    t->items = (hashitem_t *) Xaligned_calloc(16, numslots, sizeof(hashitem_t));
+    t->state.mask  = numslots - 1;
+
+    // room for keys of 16 characters on average
+    t->state.arenasiz = max(256u, t->state.size * 16u);
+    t->state.arena    = (char *) Xmalloc(t->state.arenasiz);
+    t->state.arena[0] = 0;
+    t->state.arenalen = 1;
 }
 
 void hash_loop(hashtable_t *t, void(*func)(const char *, intptr_t))
@@ -57,33 +120,18 @@ void hash_loop(hashtable_t *t, void(*func)(const char *, intptr_t))
     if (t->items == nullptr)
         return;
 
-    for (unsigned i=0; i < t->prime.v; i++)
-        for (auto item = t->items[i]; item != nullptr; item = item->next)
-            func(item->string, item->key);
+    for (auto item = t->items, items_end = t->items + t->state.mask + 1; item < items_end; ++item)
+        if (item->string)
+            func(t->state.arena + item->string, item->key);
 }
 
 void hash_free(hashtable_t *t)
 {
-    if (t->items == nullptr)
-        return;
-
-    int remaining = t->prime.v - 1;
-
-    do
-    {
-        auto cur = t->items[remaining];
-
-        while (cur)
-        {
-            auto tmp = cur;
-            cur = cur->next;
-
-            Xfree(tmp->string);
-            Xaligned_free(tmp);
-        }
-    } while (--remaining >= 0);
-
     ALIGNED_FREE_AND_NULL(t->items);
+    DO_FREE_AND_NULL(t->state.arena);
+
+    t->state.mask = t->state.count = 0;
+    t->state.arenalen = t->state.arenasiz = t->state.arenadead = 0;
 }
 
 void hash_add(hashtable_t *t, const char *s, intptr_t key, int32_t replace)
@@ -91,38 +139,30 @@ void hash_add(hashtable_t *t, const char *s, intptr_t key, int32_t replace)
 #ifdef DEBUGGINGAIDS
     Bassert(t->items != nullptr);
 #endif
-    uint32_t const code = hash_getbucket(t,s);
-    auto cur = t->items[code];
+    uint32_t const code = hash_getcode(s);
+    uint32_t idx = code & t->state.mask;
 
-    if (!cur)
+    for (; t->items[idx].string; idx = (idx + 1) & t->state.mask)
     {
-        cur = (hashitem_t *) Xaligned_alloc(16, sizeof(hashitem_t));
-        cur->string = Xstrdup(s);
-        cur->key    = key;
-        cur->next   = nullptr;
-
-        t->items[code] = cur;
-        return;
-    }
+        auto &item = t->items[idx];
 
-    hashitem_t *prev = nullptr;
-
-    do
-    {
-        if (Bstrcmp(s, cur->string) == 0)
+        if (item.code == code && Bstrcmp(s, t->state.arena + item.string) == 0)
         {
-            if (replace) cur->key = key;
+            if (replace) item.key = key;
             return;
         }
-        prev = cur;
-    } while ((cur = cur->next));
+    }
+
+    if (hash_overloaded(t->state.count, t->state.mask))
+        hash_rehash(t, (t->state.mask + 1) << 1);
 
-    cur = (hashitem_t *) Xaligned_alloc(16, sizeof(hashitem_t));
-    cur->string = Xstrdup(s);
-    cur->key    = key;
-    cur->next   = nullptr;
+    uint32_t const string = hash_intern(t, s);
 
-    prev->next = cur;
+    // interning can rehash the table as well
+    for (idx = code & t->state.mask; t->items[idx].string; idx = (idx + 1) & t->state.mask) { }
+
+    t->items[idx] = { key, code, string };
+    t->state.count++;
 }
 
 // delete at most once
@@ -131,31 +171,36 @@ void hash_delete(hashtable_t *t, const char *s)
 #ifdef DEBUGGINGAIDS
     Bassert(t->items != nullptr);
 #endif
-    uint32_t const code = hash_getbucket(t,s);
-    auto cur = t->items[code];
+    uint32_t const code = hash_getcode(s);
+    uint32_t idx = code & t->state.mask;
 
-    if (!cur)
+    for (; t->items[idx].string; idx = (idx + 1) & t->state.mask)
+        if (t->items[idx].code == code && Bstrcmp(s, t->state.arena + t->items[idx].string) == 0)
+            break;
+
+    if (!t->items[idx].string)
         return;
 
-    hashitem_t *prev = nullptr;
+    t->state.arenadead += Bstrlen(t->state.arena + t->items[idx].string) + 1;
 
-    do
+    // move every item after the hole that may live there, i.e. whose home slot isn't between the hole and itself
+    uint32_t hole = idx;
+
+    for (idx = (idx + 1) & t->state.mask; t->items[idx].string; idx = (idx + 1) & t->state.mask)
     {
-        if (Bstrcmp(s, cur->string) == 0)
-        {
-            Xfree(cur->string);
+        uint32_t const home = t->items[idx].code & t->state.mask;
 
-            if (!prev)
-                t->items[code] = cur->next;
-            else
-                prev->next = cur->next;
+        if (((idx - home) & t->state.mask) >= ((idx - hole) & t->state.mask))
+        {
+            t->items[hole] = t->items[idx];
+            hole = idx;
+        }
+    }
 
-            Xaligned_free(cur);
+    t->items[hole].string = 0;
 
-            break;
-        }
-        prev = cur;
-    } while ((cur = cur->next));
+    if (--t->state.count == 0)
+        t->state.arenalen = 1, t->state.arenadead = 0;
 }
 
 intptr_t hash_find(const hashtable_t * const t, char const * const s)
@@ -163,15 +208,15 @@ intptr_t hash_find(const hashtable_t * const t, char const * const s)
 #ifdef DEBUGGINGAIDS
     Bassert(t->items != nullptr);
 #endif
-    auto cur = t->items[hash_getbucket(t,s)];
+    uint32_t const code = hash_getcode(s);
 
-    if (!cur)
-        return -1;
+    for (uint32_t idx = code & t->state.mask; t->items[idx].string; idx = (idx + 1) & t->state.mask)
+    {
+        auto const &item = t->items[idx];
 
-    do
-        if (Bstrcmp(s, cur->string) == 0)
-            return cur->key;
-    while ((cur = cur->next));
+        if (item.code == code && Bstrcmp(s, t->state.arena + item.string) == 0)
+            return item.key;
+    }
 
     return -1;
 }
@@ -181,28 +226,74 @@ intptr_t hash_findcase(const hashtable_t * const t, char const * const s)
 #ifdef DEBUGGINGAIDS
     Bassert(t->items != nullptr);
 #endif
-    auto cur = t->items[hash_getbucket(t,s)];
+    uint32_t const code = hash_getcode(s);
 
-    if (!cur)
-        return -1;
+    for (uint32_t idx = code & t->state.mask; t->items[idx].string; idx = (idx + 1) & t->state.mask)
+    {
+        auto const &item = t->items[idx];
 
-    do
-        if (Bstrcasecmp(s, cur->string) == 0)
-            return cur->key;
-    while ((cur = cur->next));
+        if (item.code == code && Bstrcasecmp(s, t->state.arena + item.string) == 0)
+            return item.key;
+    }
 
     return -1;
 }
 
 
-void inthash_free(inthashtable_t *t) { ALIGNED_FREE_AND_NULL(t->items); }
+uint32_t inthash_getcode(intptr_t key)
+{
+    uint64_t const h = XXH3_64bits(&key, sizeof(key));
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static FORCE_INLINE void inthash_clear(inthashitem_t *items, uint32_t const numslots)
+{
+    for (auto item = items, items_end = items + numslots; item < items_end; ++item)
+        item->key = INTHASH_EMPTY;
+}
+
+static void inthash_rehash(inthashtable_t *t, uint32_t const numslots)
+{
+    auto const olditems = t->items;
+    uint32_t const oldslots = t->state.mask + 1;
+
+    t->items = (inthashitem_t *) Xaligned_alloc(16, numslots * sizeof(inthashitem_t));
+    t->state.mask  = numslots - 1;
+    inthash_clear(t->items, numslots);
+
+    for (auto item = olditems, items_end = olditems + oldslots; item < items_end; ++item)
+    {
+        if (item->key == INTHASH_EMPTY)
+            continue;
+
+        uint32_t idx = inthash_getcode(item->key) & t->state.mask;
+
+        while (t->items[idx].key != INTHASH_EMPTY)
+            idx = (idx + 1) & t->state.mask;
+
+        t->items[idx] = *item;
+    }
+
+    Xaligned_free(olditems);
+}
+
+void inthash_free(inthashtable_t *t)
+{
+    ALIGNED_FREE_AND_NULL(t->items);
+
+    t->state.mask = t->state.numkeys = 0;
+    t->state.hasemptykey = 0;
+}
 
 void inthash_init(inthashtable_t *t)
 {
     inthash_free(t);
-    t->prime.v = hash_findprime(t->count);
-    t->prime.d = libdivide::libdivide_u32_gen(t->prime.v);
-    t->items = (inthashitem_t *) Xaligned_calloc(16, t->prime.v, sizeof(inthashitem_t));
+
+    uint32_t const numslots = nextPow2(max(HASH_MINSLOTS, t->state.count));
+
+    t->items = (inthashitem_t *) Xaligned_alloc(16, numslots * sizeof(inthashitem_t));
+    t->state.mask  = numslots - 1;
+    inthash_clear(t->items, numslots);
 }
 
 void inthash_loop(inthashtable_t const *t, void(*func)(intptr_t, intptr_t))
@@ -210,8 +301,12 @@ void inthash_loop(inthashtable_t const *t, void(*func)(intptr_t, intptr_t))
     if (t->items == nullptr)
         return;
 
-    for (auto *item = t->items, *const items_end = t->items + t->prime.v; item < items_end; ++item)
-        func(item->key, item->value);
+    for (auto *item = t->items, *const items_end = t->items + t->state.mask + 1; item < items_end; ++item)
+        if (item->key != INTHASH_EMPTY)
+            func(item->key, item->value);
+
+    if (t->state.hasemptykey)
+        func(INTHASH_EMPTY, t->state.emptyvalue);
 }
 
 
@@ -220,51 +315,35 @@ void inthash_add(inthashtable_t *t, intptr_t key, intptr_t value, int32_t replac
 #ifdef DEBUGGINGAIDS
     Bassert(t->items != nullptr);
 #endif
-    auto seeker = t->items + inthash_getbucket(t,key);
-
-    if (seeker->collision == nullptr)
+    if (EDUKE32_PREDICT_FALSE(key == INTHASH_EMPTY))
     {
-        seeker->key = key;
-        seeker->value = value;
-        seeker->collision = seeker;
+        if (!t->state.hasemptykey || replace)
+            t->state.emptyvalue = value;
+        t->state.hasemptykey = 1;
         return;
     }
 
-    if (seeker->key == key)
-    {
-        if (replace)
-            seeker->value = value;
-        return;
-    }
+    uint32_t idx = inthash_getcode(key) & t->state.mask;
 
-    while (seeker != seeker->collision)
+    for (; t->items[idx].key != INTHASH_EMPTY; idx = (idx + 1) & t->state.mask)
     {
-        seeker = seeker->collision;
-
-        if (seeker->key == key)
+        if (t->items[idx].key == key)
         {
             if (replace)
-                seeker->value = value;
+                t->items[idx].value = value;
             return;
         }
     }
 
-    auto tail = seeker;
-    int ofs;
-
-    do
+    if (hash_overloaded(t->state.numkeys, t->state.mask))
     {
-        ofs = (tail - t->items + 1);
-        tail = t->items + ofs - libdivide::libdivide_u32_do(ofs, &t->prime.d) * t->prime.v;
-    }
-    while (tail->collision != nullptr && tail != seeker);
+        inthash_rehash(t, (t->state.mask + 1) << 1);
 
-    if (EDUKE32_PREDICT_FALSE(tail == seeker))
-        fatal_exit("inthash_add(): table full!");
+        for (idx = inthash_getcode(key) & t->state.mask; t->items[idx].key != INTHASH_EMPTY; idx = (idx + 1) & t->state.mask) { }
+    }
 
-    tail->key = key;
-    tail->value = value;
-    tail->collision = seeker->collision = tail;
+    t->items[idx] = { key, value };
+    t->state.numkeys++;
 }
 
 // delete at most once
@@ -273,26 +352,33 @@ void inthash_delete(inthashtable_t *t, intptr_t key)
 #ifdef DEBUGGINGAIDS
     Bassert(t->items != nullptr);
 #endif
-    auto seeker = t->items + inthash_getbucket(t,key);
-
-    if (seeker->collision == nullptr || seeker->key == key)
+    if (EDUKE32_PREDICT_FALSE(key == INTHASH_EMPTY))
     {
-        seeker->collision = nullptr;
+        t->state.hasemptykey = 0;
         return;
     }
 
-    while (seeker != seeker->collision)
+    uint32_t idx = inthash_getcode(key) & t->state.mask;
+
+    for (; t->items[idx].key != key; idx = (idx + 1) & t->state.mask)
+        if (t->items[idx].key == INTHASH_EMPTY)
+            return;
+
+    uint32_t hole = idx;
+
+    for (idx = (idx + 1) & t->state.mask; t->items[idx].key != INTHASH_EMPTY; idx = (idx + 1) & t->state.mask)
     {
-        auto prev = seeker;
-        seeker = seeker->collision;
+        uint32_t const home = inthash_getcode(t->items[idx].key) & t->state.mask;
 
-        if (seeker->key == key)
+        if (((idx - home) & t->state.mask) >= ((idx - hole) & t->state.mask))
         {
-            prev->collision = seeker == seeker->collision ? prev : seeker->collision;
-            seeker->collision = nullptr;
-            return;
+            t->items[hole] = t->items[idx];
+            hole = idx;
         }
     }
+
+    t->items[hole].key = INTHASH_EMPTY;
+    t->state.numkeys--;
 }
 
 intptr_t inthash_find(inthashtable_t const *t, intptr_t key)
@@ -300,21 +386,12 @@ intptr_t inthash_find(inthashtable_t const *t, intptr_t key)
 #ifdef DEBUGGINGAIDS
     Bassert(t->items != nullptr);
 #endif
-    auto seeker = t->items + inthash_getbucket(t,key);
-
-    if (seeker->collision == nullptr)
-        return -1;
-
-    if (seeker->key == key)
-        return seeker->value;
+    if (EDUKE32_PREDICT_FALSE(key == INTHASH_EMPTY))
+        return t->state.hasemptykey ? t->state.emptyvalue : -1;
 
-    while (seeker != seeker->collision)
-    {
-        seeker = seeker->collision;
-
-        if (seeker->key == key)
-            return seeker->value;
-    }
+    for (uint32_t idx = inthash_getcode(key) & t->state.mask; t->items[idx].key != INTHASH_EMPTY; idx = (idx + 1) & t->state.mask)
+        if (t->items[idx].key == key)
+            return t->items[idx].value;
 
     return -1;
 }
@@ -0,0 +1,478 @@
+// kplib-simd.cpp
+//  SSE2/AVX2 versions of the PNG unfilter, JPEG IDCT and YCbCr->RGB loops in kplib.cpp.
+//
+// putbuf() stores each PNG row backwards, so the None and Up kernels reverse
+// 16 or 32 bytes of the inflated data at a time and add them to the previous
+// row in place. Sub, Avg and Paeth depend on the pixel to the left, so those
+// step a whole RGB or RGBA pixel per iteration instead of a byte, keeping the
+// left and up-left pixels in a register in the order they are stored in;
+// other pixel sizes are left to the scalar code. The IDCT does the row and
+// column passes of invdct8x8() on 4 or 8 rows or columns at once, and the
+// color conversion does one row of a block with the same fixed point math as
+// the crmul[]/cbmul[]/colclip[] tables of yrbrend(). The results are
+// identical to the scalar code.
+
+#include "compat.h"
+#include "build_cpuid.h"
+#include "kplib.h"
+#include "log.h"
+
+#if defined EDUKE32_CPU_X86 && B_LITTLE_ENDIAN == 1 && (EDUKE32_GCC_PREREQ(4,9) || defined __clang__ || defined _MSC_VER)
+# define KPLIBSIMD_ENABLED
+# include <immintrin.h>
+#endif
+
+#ifdef KPLIBSIMD_ENABLED
+
+#if defined __GNUC__ || defined __clang__
+# define SIMD_TARGET(x) __attribute__((target(x)))
+#else
+# define SIMD_TARGET(x)
+#endif
+
+#define SIMD_SSE2 SIMD_TARGET("sse2")
+#define SIMD_AVX2 SIMD_TARGET("avx2")
+
+///// PNG unfilter /////
+
+static FORCE_INLINE SIMD_SSE2 __m128i reverse16(__m128i x)
+{
+    x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_mm_shuffle_epi32(x, _MM_SHUFFLE(1,0,3,2)), _MM_SHUFFLE(0,1,2,3)), _MM_SHUFFLE(0,1,2,3));
+    return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+static FORCE_INLINE SIMD_AVX2 __m256i reverse32(__m256i x)
+{
+    __m256i const rev = _mm256_setr_epi8(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(x, rev), _MM_SHUFFLE(1,0,3,2));
+}
+
+// byte k of src goes to dst[-k]
+static SIMD_SSE2 int32_t unfilter0_sse2(uint8_t *dst, uint8_t const *src, int32_t len, int32_t, uint8_t *, uint8_t *)
+{
+    int32_t i = 0;
+
+    for (; i <= len-16; i += 16)
+        _mm_storeu_si128((__m128i *)(dst-i-15), reverse16(_mm_loadu_si128((__m128i const *)(src+i))));
+
+    return i;
+}
+
+static SIMD_SSE2 int32_t unfilter2_sse2(uint8_t *dst, uint8_t const *src, int32_t len, int32_t, uint8_t *, uint8_t *)
+{
+    int32_t i = 0;
+
+    for (; i <= len-16; i += 16)
+    {
+        __m128i *const p = (__m128i *)(dst-i-15);
+        _mm_storeu_si128(p, _mm_add_epi8(_mm_loadu_si128(p), reverse16(_mm_loadu_si128((__m128i const *)(src+i)))));
+    }
+
+    return i;
+}
+
+static SIMD_AVX2 int32_t unfilter0_avx2(uint8_t *dst, uint8_t const *src, int32_t len, int32_t, uint8_t *, uint8_t *)
+{
+    int32_t i = 0;
+
+    for (; i <= len-32; i += 32)
+        _mm256_storeu_si256((__m256i *)(dst-i-31), reverse32(_mm256_loadu_si256((__m256i const *)(src+i))));
+
+    return i;
+}
+
+static SIMD_AVX2 int32_t unfilter2_avx2(uint8_t *dst, uint8_t const *src, int32_t len, int32_t, uint8_t *, uint8_t *)
+{
+    int32_t i = 0;
+
+    for (; i <= len-32; i += 32)
+    {
+        __m256i *const p = (__m256i *)(dst-i-31);
+        _mm256_storeu_si256(p, _mm256_add_epi8(_mm256_loadu_si256(p), reverse32(_mm256_loadu_si256((__m256i const *)(src+i)))));
+    }
+
+    return i;
+}
+
+// A pixel as stored in the row, the last channel in the lowest byte. Channel
+// order is the order of the inflated data and of the left/up-left buffers.
+template <int bpp> static FORCE_INLINE uint32_t chanorder(uint8_t const *p)
+{
+    return bpp == 4 ? B_SWAP32(B_UNBUF32(p)) : (p[2] | (p[1] << 8) | (p[0] << 16));
+}
+
+template <int bpp> static FORCE_INLINE void putchanorder(uint8_t *p, uint32_t v)
+{
+    if (bpp == 4)
+        B_BUF32(p, B_SWAP32(v));
+    else
+        p[0] = v >> 16, p[1] = v >> 8, p[2] = v;
+}
+
+template <int bpp> static FORCE_INLINE uint32_t loadpix(uint8_t const *p)
+{
+    return bpp == 4 ? B_UNBUF32(p) : (B_UNBUF16(p) | (p[2] << 16));
+}
+
+template <int bpp> static FORCE_INLINE void storepix(uint8_t *p, uint32_t v)
+{
+    if (bpp == 4)
+        B_BUF32(p, v);
+    else
+        B_BUF16(p, v), p[2] = v >> 16;
+}
+
+enum { UNFILTER_SUB = 1, UNFILTER_AVG = 3, UNFILTER_PAETH = 4 };
+
+template <int filt, int bpp> static FORCE_INLINE SIMD_SSE2 int32_t unfilterpix_sse2(uint8_t *dst, uint8_t const *src, int32_t len,
+                                                                                   uint8_t *left, uint8_t *upleft)
+{
+    __m128i const zero = _mm_setzero_si128(), one = _mm_set1_epi8(1);
+    __m128i a = _mm_cvtsi32_si128(chanorder<bpp>(left));
+    __m128i c = _mm_cvtsi32_si128(chanorder<bpp>(upleft));
+    int32_t const npix = len/bpp;
+
+    // the lowest byte of pixel k is at dst-k*bpp-(bpp-1)
+    dst -= bpp-1;
+
+    for (int32_t k = 0; k < npix; k++, dst -= bpp, src += bpp)
+    {
+        __m128i const raw = _mm_cvtsi32_si128(chanorder<bpp>(src));
+
+        if (filt == UNFILTER_SUB)
+            a = _mm_add_epi8(a, raw);
+        else
+        {
+            __m128i const b = _mm_cvtsi32_si128(loadpix<bpp>(dst));
+
+            if (filt == UNFILTER_AVG)
+                a = _mm_add_epi8(_mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one)), raw);
+            else
+            {
+                __m128i const a16 = _mm_unpacklo_epi8(a, zero), b16 = _mm_unpacklo_epi8(b, zero), c16 = _mm_unpacklo_epi8(c, zero);
+                __m128i pa = _mm_sub_epi16(b16, c16), pb = _mm_sub_epi16(a16, c16);
+                __m128i pc = _mm_add_epi16(pa, pb);
+
+                pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+                pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+                pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+                // ties go to a, then b, like Paeth686()
+                __m128i const m = _mm_min_epi16(pa, _mm_min_epi16(pb, pc));
+                __m128i const isa = _mm_cmpeq_epi16(m, pa), isb = _mm_cmpeq_epi16(m, pb);
+                __m128i const bc = _mm_or_si128(_mm_and_si128(isb, b16), _mm_andnot_si128(isb, c16));
+                __m128i const pred = _mm_or_si128(_mm_and_si128(isa, a16), _mm_andnot_si128(isa, bc));
+
+                a = _mm_add_epi8(_mm_packus_epi16(pred, zero), raw);
+                c = b;
+            }
+        }
+
+        storepix<bpp>(dst, _mm_cvtsi128_si32(a));
+    }
+
+    putchanorder<bpp>(left, _mm_cvtsi128_si32(a));
+    if (filt == UNFILTER_PAETH)
+        putchanorder<bpp>(upleft, _mm_cvtsi128_si32(c));
+
+    return npix*bpp;
+}
+
+template <int filt> static SIMD_SSE2 int32_t unfilter_sse2(uint8_t *dst, uint8_t const *src, int32_t len, int32_t bpp,
+                                                           uint8_t *left, uint8_t *upleft)
+{
+    switch (bpp)
+    {
+    case 3: return unfilterpix_sse2<filt, 3>(dst, src, len, left, upleft);
+    case 4: return unfilterpix_sse2<filt, 4>(dst, src, len, left, upleft);
+    default: return 0;
+    }
+}
+
+///// JPEG IDCT /////
+
+#define KPEG_SQRT2 23726566   //(sqrt(2))<<24
+#define KPEG_C182 31000253    //(cos(PI/8)*2)<<24
+#define KPEG_C18S22 43840978  //(cos(PI/8)*sqrt(2)*2)<<24
+#define KPEG_C38S22 18159528  //(cos(PI*3/8)*sqrt(2)*2)<<24
+
+// The butterfly of invdct8x8() on the vectors d[0..7], each lane going
+// through it separately. k[] holds the four multipliers.
+#define KPEG_IDCT8(d, k, add, sub, mulshr32, slli) do { \
+    auto t3 = add(d[2], d[6]); \
+    auto t2 = sub(slli(mulshr32(sub(d[2], d[6]), k[0]), 2), t3); \
+    auto t4 = add(d[0], d[4]), t5 = sub(d[0], d[4]); \
+    auto const t0 = add(t4, t3); t3 = sub(t4, t3); \
+    auto const t1 = add(t5, t2); t2 = sub(t5, t2); \
+    auto const d17p = add(d[1], d[7]), d53p = add(d[5], d[3]); \
+    t4 = slli(mulshr32(sub(sub(d[5], d[3]), sub(d[7], d[1])), k[1]), 2); \
+    auto const t7 = add(d17p, d53p); \
+    auto const t6 = sub(add(slli(mulshr32(sub(d[3], d[5]), k[2]), 3), t4), t7); \
+    t5 = sub(slli(mulshr32(sub(d17p, d53p), k[0]), 2), t6); \
+    t4 = add(sub(slli(mulshr32(sub(d[1], d[7]), k[3]), 2), t4), t5); \
+    d[0] = add(t0, t7); d[7] = sub(t0, t7); d[1] = add(t1, t6); d[6] = sub(t1, t6); \
+    d[2] = add(t2, t5); d[5] = sub(t2, t5); d[4] = add(t3, t4); d[3] = sub(t3, t4); \
+} while (0)
+
+// mulshr32() for four lanes; k is positive
+static FORCE_INLINE SIMD_SSE2 __m128i mulshr32_sse2(__m128i a, __m128i k)
+{
+    __m128i const even = _mm_srli_epi64(_mm_mul_epu32(a, k), 32);
+    __m128i const odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), k);
+    __m128i const hi   = _mm_or_si128(even, _mm_and_si128(odd, _mm_setr_epi32(0, -1, 0, -1)));
+
+    // the unsigned product is too large by k<<32 where a is negative
+    return _mm_sub_epi32(hi, _mm_and_si128(_mm_srai_epi32(a, 31), k));
+}
+
+static FORCE_INLINE SIMD_AVX2 __m256i mulshr32_avx2(__m256i a, __m256i k)
+{
+    __m256i const even = _mm256_srli_epi64(_mm256_mul_epi32(a, k), 32);
+    __m256i const odd  = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), k);
+    return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+#define ADD4(a, b) _mm_add_epi32(a, b)
+#define SUB4(a, b) _mm_sub_epi32(a, b)
+#define SLLI4(a, n) _mm_slli_epi32(a, n)
+#define ADD8(a, b) _mm256_add_epi32(a, b)
+#define SUB8(a, b) _mm256_sub_epi32(a, b)
+#define SLLI8(a, n) _mm256_slli_epi32(a, n)
+
+static FORCE_INLINE SIMD_SSE2 void transpose4x4(__m128i &r0, __m128i &r1, __m128i &r2, __m128i &r3)
+{
+    __m128i const t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i const t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+
+    r0 = _mm_unpacklo_epi64(t0, t1);
+    r1 = _mm_unpackhi_epi64(t0, t1);
+    r2 = _mm_unpacklo_epi64(t2, t3);
+    r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+// v[i][h] holds elements 4h..4h+3 of row i of an 8x8 block
+static FORCE_INLINE SIMD_SSE2 void transpose8x8_sse2(__m128i v[8][2])
+{
+    transpose4x4(v[0][0], v[1][0], v[2][0], v[3][0]);
+    transpose4x4(v[4][1], v[5][1], v[6][1], v[7][1]);
+    transpose4x4(v[0][1], v[1][1], v[2][1], v[3][1]);
+    transpose4x4(v[4][0], v[5][0], v[6][0], v[7][0]);
+
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i const t = v[i][1];
+        v[i][1] = v[i+4][0];
+        v[i+4][0] = t;
+    }
+}
+
+static SIMD_SSE2 void idct_sse2(int32_t *dc)
+{
+    __m128i const k[4] = { _mm_set1_epi32(KPEG_SQRT2<<6), _mm_set1_epi32(KPEG_C182<<6), _mm_set1_epi32(KPEG_C18S22<<5),
+                           _mm_set1_epi32(KPEG_C38S22<<6) };
+    __m128i v[8][2], d[8];
+
+    for (int i = 0; i < 8; i++)
+    {
+        v[i][0] = _mm_loadu_si128((__m128i const *)&dc[i*8]);
+        v[i][1] = _mm_loadu_si128((__m128i const *)&dc[i*8+4]);
+    }
+
+    // rows: v[j][h] is now element j of rows 4h..4h+3
+    transpose8x8_sse2(v);
+
+    for (int h = 0; h < 2; h++)
+    {
+        for (int j = 0; j < 8; j++) d[j] = v[j][h];
+        KPEG_IDCT8(d, k, ADD4, SUB4, mulshr32_sse2, SLLI4);
+        for (int j = 0; j < 8; j++) v[j][h] = d[j];
+    }
+
+    // columns
+    transpose8x8_sse2(v);
+
+    for (int h = 0; h < 2; h++)
+    {
+        for (int j = 0; j < 8; j++) d[j] = v[j][h];
+        KPEG_IDCT8(d, k, ADD4, SUB4, mulshr32_sse2, SLLI4);
+        for (int j = 0; j < 8; j++) _mm_storeu_si128((__m128i *)&dc[j*8+h*4], d[j]);
+    }
+}
+
+static FORCE_INLINE SIMD_AVX2 void transpose8x8_avx2(__m256i *v)
+{
+    __m256i t[8], u[8];
+
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i]   = _mm256_unpacklo_epi32(v[i], v[i+1]);
+        t[i+1] = _mm256_unpackhi_epi32(v[i], v[i+1]);
+    }
+
+    for (int i = 0; i < 8; i += 4)
+    {
+        u[i]   = _mm256_unpacklo_epi64(t[i], t[i+2]);
+        u[i+1] = _mm256_unpackhi_epi64(t[i], t[i+2]);
+        u[i+2] = _mm256_unpacklo_epi64(t[i+1], t[i+3]);
+        u[i+3] = _mm256_unpackhi_epi64(t[i+1], t[i+3]);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        v[i]   = _mm256_permute2x128_si256(u[i], u[i+4], 0x20);
+        v[i+4] = _mm256_permute2x128_si256(u[i], u[i+4], 0x31);
+    }
+}
+
+static SIMD_AVX2 void idct_avx2(int32_t *dc)
+{
+    __m256i const k[4] = { _mm256_set1_epi32(KPEG_SQRT2<<6), _mm256_set1_epi32(KPEG_C182<<6), _mm256_set1_epi32(KPEG_C18S22<<5),
+                           _mm256_set1_epi32(KPEG_C38S22<<6) };
+    __m256i d[8];
+
+    for (int i = 0; i < 8; i++)
+        d[i] = _mm256_loadu_si256((__m256i const *)&dc[i*8]);
+
+    transpose8x8_avx2(d);
+    KPEG_IDCT8(d, k, ADD8, SUB8, mulshr32_avx2, SLLI8);
+    transpose8x8_avx2(d);
+    KPEG_IDCT8(d, k, ADD8, SUB8, mulshr32_avx2, SLLI8);
+
+    for (int i = 0; i < 8; i++)
+        _mm256_storeu_si256((__m256i *)&dc[i*8], d[i]);
+}
+
+#undef ADD4
+#undef SUB4
+#undef SLLI4
+#undef ADD8
+#undef SUB8
+#undef SLLI8
+
+///// JPEG YCbCr->RGB /////
+
+// 1.402, -0.71414, -0.34414 and 1.772 in 20 bit fixed point, as in initkpeg()
+#define KPEG_CRR 1470104
+#define KPEG_CRG -748830
+#define KPEG_CBG -360857
+#define KPEG_CBB 1858077
+
+static FORCE_INLINE SIMD_SSE2 __m128i mullo_sse2(__m128i a, __m128i k)
+{
+    __m128i const even = _mm_mul_epu32(a, k);
+    __m128i const odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), k);
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+// colclip[(unsigned)v>>22] is min(max((v>>22)+128, 0), 255): packs_epi32 keeps
+// the 10 bit value and packus_epi16 clamps it after the bias is added.
+static SIMD_SSE2 void ycbcr_sse2(int32_t *dst, int32_t const *y, int32_t const *cbcr, int32_t hsamp)
+{
+    __m128i const crr = _mm_set1_epi32(KPEG_CRR), crg = _mm_set1_epi32(KPEG_CRG);
+    __m128i const cbg = _mm_set1_epi32(KPEG_CBG), cbb = _mm_set1_epi32(KPEG_CBB);
+    __m128i const bias = _mm_set1_epi16(128), alpha = _mm_set1_epi16(255);
+    __m128i cb[2], cr[2], r[2], g[2], b[2];
+
+    if (hsamp == 1)
+    {
+        for (int h = 0; h < 2; h++)
+        {
+            cb[h] = _mm_srai_epi32(_mm_loadu_si128((__m128i const *)&cbcr[h*4]), 20);
+            cr[h] = _mm_srai_epi32(_mm_loadu_si128((__m128i const *)&cbcr[h*4+64]), 20);
+        }
+    }
+    else
+    {
+        __m128i const cb4 = _mm_srai_epi32(_mm_loadu_si128((__m128i const *)cbcr), 20);
+        __m128i const cr4 = _mm_srai_epi32(_mm_loadu_si128((__m128i const *)&cbcr[64]), 20);
+
+        cb[0] = _mm_unpacklo_epi32(cb4, cb4), cb[1] = _mm_unpackhi_epi32(cb4, cb4);
+        cr[0] = _mm_unpacklo_epi32(cr4, cr4), cr[1] = _mm_unpackhi_epi32(cr4, cr4);
+    }
+
+    for (int h = 0; h < 2; h++)
+    {
+        __m128i const yv = _mm_loadu_si128((__m128i const *)&y[h*4]);
+
+        r[h] = _mm_srai_epi32(_mm_add_epi32(yv, mullo_sse2(cr[h], crr)), 22);
+        g[h] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(yv, mullo_sse2(cr[h], crg)), mullo_sse2(cb[h], cbg)), 22);
+        b[h] = _mm_srai_epi32(_mm_add_epi32(yv, mullo_sse2(cb[h], cbb)), 22);
+    }
+
+    __m128i const bg = _mm_packus_epi16(_mm_add_epi16(_mm_packs_epi32(b[0], b[1]), bias), _mm_add_epi16(_mm_packs_epi32(g[0], g[1]), bias));
+    __m128i const ra = _mm_packus_epi16(_mm_add_epi16(_mm_packs_epi32(r[0], r[1]), bias), alpha);
+    __m128i const br = _mm_unpacklo_epi8(bg, ra), ga = _mm_unpackhi_epi8(bg, ra);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi8(br, ga));
+    _mm_storeu_si128((__m128i *)&dst[4], _mm_unpackhi_epi8(br, ga));
+}
+
+static SIMD_AVX2 void ycbcr_avx2(int32_t *dst, int32_t const *y, int32_t const *cbcr, int32_t hsamp)
+{
+    __m256i cb, cr;
+
+    if (hsamp == 1)
+    {
+        cb = _mm256_loadu_si256((__m256i const *)cbcr);
+        cr = _mm256_loadu_si256((__m256i const *)&cbcr[64]);
+    }
+    else
+    {
+        __m256i const dup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+        cb = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)cbcr)), dup);
+        cr = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)&cbcr[64])), dup);
+    }
+
+    cb = _mm256_srai_epi32(cb, 20);
+    cr = _mm256_srai_epi32(cr, 20);
+
+    __m256i const yv = _mm256_loadu_si256((__m256i const *)y);
+    __m256i const r = _mm256_srai_epi32(_mm256_add_epi32(yv, _mm256_mullo_epi32(cr, _mm256_set1_epi32(KPEG_CRR))), 22);
+    __m256i const g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(yv, _mm256_mullo_epi32(cr, _mm256_set1_epi32(KPEG_CRG))),
+                                                         _mm256_mullo_epi32(cb, _mm256_set1_epi32(KPEG_CBG))), 22);
+    __m256i const b = _mm256_srai_epi32(_mm256_add_epi32(yv, _mm256_mullo_epi32(cb, _mm256_set1_epi32(KPEG_CBB))), 22);
+    __m256i const bias = _mm256_set1_epi16(128);
+
+    // per 128-bit lane: b0-3 g0-3 r0-3 a0-3, then transposed to pixels
+    __m256i const bgra = _mm256_packus_epi16(_mm256_add_epi16(_mm256_packs_epi32(b, g), bias),
+                                             _mm256_add_epi16(_mm256_packs_epi32(r, _mm256_set1_epi32(127)), bias));
+    __m256i const order = _mm256_setr_epi8(0,4,8,12,1,5,9,13,2,6,10,14,3,7,11,15,0,4,8,12,1,5,9,13,2,6,10,14,3,7,11,15);
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_shuffle_epi8(bgra, order));
+}
+
+static kplibsimd_t const simdfuncs[] =
+{
+    { { nullptr, nullptr, nullptr, nullptr, nullptr }, nullptr, nullptr },
+    { { unfilter0_sse2, unfilter_sse2<UNFILTER_SUB>, unfilter2_sse2, unfilter_sse2<UNFILTER_AVG>, unfilter_sse2<UNFILTER_PAETH> },
+      idct_sse2, ycbcr_sse2 },
+    { { unfilter0_avx2, unfilter_sse2<UNFILTER_SUB>, unfilter2_avx2, unfilter_sse2<UNFILTER_AVG>, unfilter_sse2<UNFILTER_PAETH> },
+      idct_avx2, ycbcr_avx2 },
+};
+
+#endif // KPLIBSIMD_ENABLED
+
+int32_t kplibSimdInit(int32_t maxlevel)
+{
+    int32_t level = KPLIBSIMD_SCALAR;
+
+#ifdef KPLIBSIMD_ENABLED
+    if (cpu.features.sse2)
+    {
+        level = KPLIBSIMD_SSE2;
+
+        if (cpu.features.avx2)
+            level = KPLIBSIMD_AVX2;
+    }
+
+    level = clamp(maxlevel, KPLIBSIMD_SCALAR, level);
+    kplibsimd = simdfuncs[level];
+#else
+    UNREFERENCED_PARAMETER(maxlevel);
+#endif
+
+    static char const *const levelnames[] = { "scalar", "SSE2", "AVX2" };
+    LOG_F(INFO, "Picture decoding using %s kernels", levelnames[level]);
+
+    return level;
+}
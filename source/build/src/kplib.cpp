@@ -36,6 +36,8 @@ credits.
 
 #include "vfs.h"
 
+#include <mutex>
+
 #if !defined(_WIN32)
 static FORCE_INLINE CONSTEXPR int32_t klrotl(int32_t i, int sh) { return (i >> (-sh)) | (i << sh); }
 #else
@@ -121,7 +123,7 @@ static int8_t kcoltype, filtype, bitdepth;
 
 //.PNG specific variables:
 static int32_t bakr = 0x80, bakg = 0x80, bakb = 0x80; //this used to be public...
-static int32_t gslidew = 0, gslider = 0, xm, xmn[4], xr0, xr1, xplc, yplc;
+static int32_t gslidew = 0, gslider = 0, xm, xmn[4], xmbpp, xr0, xr1, xplc, yplc;
 static intptr_t nfplace;
 static int32_t clen[320], cclen[19], bitpos, filt, xsiz, ysiz;
 int32_t xsizbpl, ixsiz, ixoff, iyoff, ixstp, iystp, intlac, nbpl;
@@ -587,6 +589,42 @@ static inline void pal8hlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixst
 //    /f4: 4444444...
 //    /f5: 0142321...
 static int32_t filter1st, filterest;
+static inline void unfilterbytes(const uint8_t *buf, int32_t i, int32_t x)
+{
+    switch (filt)
+    {
+    case 0:
+            while (i < x) { olinbuf[xplc--] = buf[i++]; }
+        break;
+    case 1:
+            while (i < x)
+            {
+                olinbuf[xplc--] = (uint8_t)(opixbuf1[xm] += buf[i++]);
+                xm = xmn[xm];
+            }
+        break;
+    case 2:
+            while (i < x) { olinbuf[xplc--] += (uint8_t)buf[i++]; }
+        break;
+    case 3:
+            while (i < x)
+            {
+                opixbuf1[xm] = olinbuf[xplc] = (uint8_t)(((opixbuf1[xm]+olinbuf[xplc])>>1)+buf[i++]);
+                xm = xmn[xm]; xplc--;
+            }
+        break;
+    case 4:
+            while (i < x)
+            {
+                opixbuf1[xm] = (uint8_t)(Paeth686(opixbuf1[xm],olinbuf[xplc],opixbuf0[xm])+buf[i++]);
+                opixbuf0[xm] = olinbuf[xplc];
+                olinbuf[xplc--] = opixbuf1[xm];
+                xm = xmn[xm];
+            }
+        break;
+    }
+}
+
 static void putbuf(const uint8_t *buf, int32_t leng)
 {
     int32_t i;
@@ -604,38 +642,17 @@ static void putbuf(const uint8_t *buf, int32_t leng)
     while (i < leng)
     {
         int32_t x = i+xplc; if (x > leng) x = leng;
-        switch (filt)
+        if (((unsigned)filt < 5) && (kplibsimd.unfilter[filt]))
         {
-        case 0:
-                while (i < x) { olinbuf[xplc--] = buf[i++]; }
-            break;
-        case 1:
-                while (i < x)
-                {
-                    olinbuf[xplc--] = (uint8_t)(opixbuf1[xm] += buf[i++]);
-                    xm = xmn[xm];
-                }
-            break;
-        case 2:
-                while (i < x) { olinbuf[xplc--] += (uint8_t)buf[i++]; }
-            break;
-        case 3:
-                while (i < x)
-                {
-                    opixbuf1[xm] = olinbuf[xplc] = (uint8_t)(((opixbuf1[xm]+olinbuf[xplc])>>1)+buf[i++]);
-                    xm = xmn[xm]; xplc--;
-                }
-            break;
-        case 4:
-                while (i < x)
-                {
-                    opixbuf1[xm] = (uint8_t)(Paeth686(opixbuf1[xm],olinbuf[xplc],opixbuf0[xm])+buf[i++]);
-                    opixbuf0[xm] = olinbuf[xplc];
-                    olinbuf[xplc--] = opixbuf1[xm];
-                    xm = xmn[xm];
-                }
-            break;
+            if (xm) //Finish the pixel split by the previous call first
+            {
+                int32_t const xe = min(i+xmbpp-xm, x);
+                unfilterbytes(buf,i,xe); i = xe;
+            }
+            int32_t const n = kplibsimd.unfilter[filt](&olinbuf[xplc],&buf[i],x-i,xmbpp,opixbuf1,opixbuf0);
+            i += n; xplc -= n;
         }
+        unfilterbytes(buf,i,x); i = x;
 
         if (xplc > 0) return;
 
@@ -818,10 +835,10 @@ static int32_t kpngrend(const char *kfilebuf, int32_t kfilength,
     kp_yres = dayres;
     switch (kcoltype)
     {
-    case 4: xmn[0] = 1; xmn[1] = 0; break;
-    case 2: xmn[0] = 1; xmn[1] = 2; xmn[2] = 0; break;
-    case 6: xmn[0] = 1; xmn[1] = 2; xmn[2] = 3; xmn[3] = 0; break;
-    default: xmn[0] = 0; break;
+    case 4: xmn[0] = 1; xmn[1] = 0; xmbpp = 2; break;
+    case 2: xmn[0] = 1; xmn[1] = 2; xmn[2] = 0; xmbpp = 3; break;
+    case 6: xmn[0] = 1; xmn[1] = 2; xmn[2] = 3; xmn[3] = 0; xmbpp = 4; break;
+    default: xmn[0] = 0; xmbpp = 1; break;
     }
     switch (bitdepth)
     {
@@ -1107,6 +1124,8 @@ static void invdct8x8(int32_t *dc, uint8_t dcflag)
 #define C38S22 18159528  //(cos(PI*3/8)*sqrt(2)*2)<<24
     int32_t *edc, t0, t1, t2, t3, t4, t5, t6, t7;
 
+    if (kplibsimd.idct) { kplibsimd.idct(dc); return; }
+
     edc = dc+64;
     do
     {
@@ -1164,7 +1183,17 @@ static void yrbrend(int32_t x, int32_t y, int32_t *ldct)
             if (lnumcomponents > 1) dc2 = &ldct[(lcomphvsamp0<<6)+((yy>>lcompvsampshift0)<<3)+(xx>>lcomphsampshift0)];
             xxxend = min(clipxdim-ox,8);
             yyyend = min(clipydim-oy,8);
-            if ((lcomphsamp[0] == 1) && (xxxend == 8))
+            if ((kplibsimd.ycbcr) && ((unsigned)(lcomphsamp[0]-1) < 2) && (xxxend == 8))
+            {
+                for (yyy=0; yyy<yyyend; yyy++)
+                {
+                    kplibsimd.ycbcr((int32_t *)p,dc,dc2,lcomphsamp[0]);
+                    p += kp_bytesperline;
+                    dc += 8;
+                    if (!((yyy+1)&(lcompvsamp[0]-1))) dc2 += 8;
+                }
+            }
+            else if ((lcomphsamp[0] == 1) && (xxxend == 8))
             {
                 for (yyy=0; yyy<yyyend; yyy++)
                 {
@@ -1236,6 +1265,7 @@ static void yrbrend(int32_t x, int32_t y, int32_t *ldct)
     }
 }
 void (*kplib_yrbrend_func)(int32_t,int32_t,int32_t *) = yrbrend;
+kplibsimd_t kplibsimd;
 
 #define KPEG_GETBITS(curbits, minbits, num, kfileptr, kfileend)\
     while (curbits < minbits)\
@@ -2293,9 +2323,14 @@ void kpgetdim(const char *buf, int32_t leng, int32_t *xsiz, int32_t *ysiz)
     }
 }
 
+// The decoders keep their state in the globals above, so pictures decoded by
+// the tile preload workers (see tilepreload.h) take turns with the main thread.
+static std::mutex kprendermutex;
+
 int32_t kprender(const char *buf, int32_t leng, intptr_t frameptr, int32_t bpl,
                  int32_t xdim, int32_t ydim)
 {
+    std::lock_guard<std::mutex> lock(kprendermutex);
     uint8_t const *ubuf = (uint8_t const *)buf;
 
     paleng = 0; bakcol = 0; numhufblocks = zlibcompflags = 0; filtype = -1;
@@ -2387,6 +2422,7 @@ int32_t wildmatch(const char *match, const char *wild)
 #define KZHASHINITSIZE 8192
 static char *kzhashbuf = 0;
 static int32_t kzhashead[256], kzhashpos, kzlastfnam = -1, kzhashsiz, kzdirnamhead = -1;
+static int32_t kzzipnam = -1; //zipnam index of the file kzopen() opened from a ZIP/GRP, -1 otherwise
 
 static int32_t kzcheckhashsiz(int32_t siz)
 {
@@ -2437,7 +2473,13 @@ static int32_t kzcheckhash(const char *filnam, char **zipnam, int32_t *fileoffs,
 void kzuninit()
 {
     DO_FREE_AND_NULL(kzhashbuf);
-    kzhashpos = kzhashsiz = 0; kzdirnamhead = -1;
+    kzhashpos = kzhashsiz = 0; kzdirnamhead = -1; kzzipnam = -1;
+}
+
+char const *kzstoredin(void)
+{
+    if (!kzfs.fil || kzfs.comptyp || kzzipnam < 0) return NULL;
+    return &kzhashbuf[kzzipnam];
 }
 
 //If file found, loads internal directory from ZIP/GRP into memory (hash) to allow faster access later
@@ -2553,6 +2595,7 @@ void kzsetfil(buildvfs_FILE fil)
     kzfs.comptyp = 0;
     kzfs.seek0 = 0;
     kzfs.leng = buildvfs_flength(fil);
+    kzzipnam = -1;
     kzfs.pos = 0;
     kzfs.i = 0;
 }
@@ -2564,6 +2607,7 @@ intptr_t kzopen(const char *filnam)
     char tempbuf[46+260], *zipnam, iscomp;
 
     //kzfs.fil = 0;
+    kzzipnam = -1;
     if (filnam[0] != '|') //Search standalone file first
     {
         kzfs.fil = buildvfs_fopen_read(filnam);
@@ -2581,6 +2625,7 @@ intptr_t kzopen(const char *filnam)
     {
         fil = buildvfs_fopen_read(zipnam); if (!fil) return 0;
         buildvfs_fseek_abs(fil,fileoffs);
+        kzzipnam = zipnam-kzhashbuf;
         if (!iscomp) //Must be from GRP file
         {
             kzfs.fil = fil;
@@ -18,6 +18,7 @@ Ken Silverman's official web site: http://www.advsys.net/ken
 #include "tilepacker.h"
 #include "colmatch.h"
 #include "texcache.h"
+#include "tilepreload.h"
 #include "hash.h"
 
 #ifdef POLYMOST2
@@ -2410,18 +2411,25 @@ uint8_t *gloadindexedtile_mdloadskin_shared(char *fn, int32_t picfillen, vec2_t
 coltype *gloadtruecolortile_mdloadskin_shared(char *fn, int32_t picfillen, vec2_t *const tsiz, vec2_t *const siz, char *const onebitalpha, polytintflags_t effect,
                                              int32_t dapalnum, char *const al)
 {
-    int32_t isart;
-    if (!gloadtile_mdloadskin_check(fn, picfillen, tsiz, siz, &isart))
-        return nullptr;
+    int32_t isart = 0;
+    coltype* pic = tilePreloadTakeHightile(fn, picfillen, tsiz, siz);
+    bool const predecoded = (pic != nullptr);
+
+    if (!predecoded)
+    {
+        if (!gloadtile_mdloadskin_check(fn, picfillen, tsiz, siz, &isart))
+            return nullptr;
+
+        pic = (coltype*)Xcalloc(siz->y, siz->x * sizeof(coltype));
+    }
 
     int32_t const bytesperline = siz->x * sizeof(coltype);
-    coltype* pic = (coltype*)Xcalloc(siz->y, bytesperline);
 
     static coltype* lastpic = NULL;
     static char* lastfn = NULL;
     static int32_t lastsize = 0;
 
-    if (lastpic && lastfn && !Bstrcmp(lastfn, fn))
+    if (lastpic && lastfn && !Bstrcmp(lastfn, fn) && !predecoded)
     {
         gloadtile_willprint = 1;
         Bmemcpy(pic, lastpic, siz->x * siz->y * sizeof(coltype));
@@ -2433,7 +2441,8 @@ coltype *gloadtruecolortile_mdloadskin_shared(char *fn, int32_t picfillen, vec2_
             artConvertRGB((palette_t*)pic, (uint8_t*)&kpzbuf[ARTv1_UNITOFFSET], siz->x, tsiz->x, tsiz->y);
         }
 #ifdef WITHKPLIB
-        else
+        // otherwise a tile preload worker decoded it already, see tilepreload.h
+        else if (!predecoded)
         {
             if (kprender(kpzbuf, picfillen, (intptr_t)pic, bytesperline, siz->x, siz->y))
             {
@@ -10016,6 +10025,7 @@ void polymost_initosdfuncs(void)
         { "r_memcache","enable/disable texture cache memory cache",(void *) &glusememcache, CVAR_BOOL, 0, 1 },
         { "r_polygonmode","debugging feature",(void *) &r_polygonmode, CVAR_INT | CVAR_NOSAVE, 0, 3 },
         { "r_texcache","enable/disable OpenGL compressed texture cache",(void *) &glusetexcache, CVAR_INT, 0, 2 },
+        { "r_texcachethreads","number of threads used to decompress the mip levels of a cached texture at the same time",(void *) &texcache_threads, CVAR_INT, 1, MAXTEXCACHETHREADS },
 #endif
         { "r_animsmoothing","enable/disable model animation smoothing",(void *) &r_animsmoothing, CVAR_BOOL, 0, 1 },
         { "r_anisotropy", "changes the OpenGL texture anisotropy setting (requires r_useindexedcolortextures to be off)", (void *) &glanisotropy, CVAR_INT|CVAR_FUNCPTR|CVAR_RESTARTVID, 1, 16 },
@@ -10056,6 +10066,8 @@ void polymost_initosdfuncs(void)
           (void *)&vsync, CVAR_INT | CVAR_FUNCPTR, -1, 2 },
 
         { "r_vertexarrays","enable/disable using vertex arrays when drawing models",(void *) &r_vertexarrays, CVAR_BOOL, 0, 1 },
+        { "r_voxelgreedymesh","enable/disable merging the faces of voxel models into as few quads as can be found when meshing them",(void *) &r_voxelgreedymesh, CVAR_BOOL, 0, 1 },
+        { "r_voxelthreads","number of threads used to mesh voxel models at the same time",(void *) &r_voxelthreads, CVAR_INT, 1, MAXVOXELTHREADS },
         { "r_yshearing", "enable/disable y-shearing", (void*) &r_yshearing, CVAR_BOOL, 0, 1 },
         { "r_flatsky", "enable/disable flat skies", (void*)& r_flatsky, CVAR_BOOL, 0, 1 },
         { "r_skyzbufferhack", "enable/disable polymost sky z-buffer hack", (void*)& r_skyzbufferhack, CVAR_BOOL, 0, 1 },
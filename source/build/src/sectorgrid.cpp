@@ -0,0 +1,310 @@
+// sectorgrid.cpp
+//  Uniform grid of sector bounding boxes, see sectorgrid.h.
+
+#include "build.h"
+#include "editor.h"
+#include "sectorgrid.h"
+#include "sectorpvs.h"
+
+int32_t sectorgrid_enabled = 1;
+int32_t sectorgrid_check;
+
+#define SECTORGRID_MINSHIFT 6
+#define SECTORGRID_MAXSHIFT 30
+#define SECTORGRID_MAXCELLS (1<<16)
+#define SECTORGRID_MAXENTRIES (1<<21)
+#define SECTORGRID_MAXOUTLIERS 64
+
+typedef struct
+{
+    vec2_t min, max;
+} sectorbbox_t;
+
+typedef struct
+{
+    int16_t x0, y0, x1, y1;
+} cellspan_t;
+
+static sectorbbox_t sectorbbox[MAXSECTORS];
+static cellspan_t   sectorspan[MAXSECTORS];
+
+static vec2_t   gridorigin;
+static int32_t  gridshift, gridxcells, gridycells;
+static int32_t *gridcellstart;
+static int16_t *gridcellsects;
+static int32_t  gridnumentries;
+
+// the map the grid was built for, -1 if it needs to be rebuilt
+static int32_t gridnumsectors = -1, gridnumwalls;
+
+static int16_t outliers[SECTORGRID_MAXOUTLIERS];
+static int32_t numoutliers;
+static uint8_t outliermap[(MAXSECTORS+7)>>3];
+
+static int16_t candidates[MAXSECTORS];
+
+// The box is grown by one unit on every side, since inside() treats the
+// point as being slightly to the lower right on one of its two passes.
+static void sectorgrid_calcbbox(int const sectnum)
+{
+    auto &bbox = sectorbbox[sectnum];
+    auto wal = (uwallptr_t)&wall[sector[sectnum].wallptr];
+    int wallsleft = sector[sectnum].wallnum;
+
+    bbox.min = { INT32_MAX, INT32_MAX };
+    bbox.max = { INT32_MIN, INT32_MIN };
+
+    for (; wallsleft > 0; wallsleft--, wal++)
+    {
+        bbox.min.x = min(bbox.min.x, wal->x);
+        bbox.min.y = min(bbox.min.y, wal->y);
+        bbox.max.x = max(bbox.max.x, wal->x);
+        bbox.max.y = max(bbox.max.y, wal->y);
+    }
+
+    if (bbox.min.x > bbox.max.x)
+    {
+        // no walls: nothing can be inside
+        bbox.min = { 1, 1 };
+        bbox.max = { 0, 0 };
+        return;
+    }
+
+    bbox.min.x -= (bbox.min.x > INT32_MIN);
+    bbox.min.y -= (bbox.min.y > INT32_MIN);
+    bbox.max.x += (bbox.max.x < INT32_MAX);
+    bbox.max.y += (bbox.max.y < INT32_MAX);
+}
+
+static FORCE_INLINE int sectorgrid_cell(int32_t const v, int32_t const origin, int32_t const numcells)
+{
+    return clamp((int32_t)(((int64_t)v - origin) >> gridshift), 0, numcells - 1);
+}
+
+static void sectorgrid_calcspan(int const sectnum)
+{
+    auto const &bbox = sectorbbox[sectnum];
+    auto       &span = sectorspan[sectnum];
+
+    if (bbox.min.x > bbox.max.x)
+    {
+        span = { 1, 1, 0, 0 };
+        return;
+    }
+
+    span.x0 = sectorgrid_cell(bbox.min.x, gridorigin.x, gridxcells);
+    span.y0 = sectorgrid_cell(bbox.min.y, gridorigin.y, gridycells);
+    span.x1 = sectorgrid_cell(bbox.max.x, gridorigin.x, gridxcells);
+    span.y1 = sectorgrid_cell(bbox.max.y, gridorigin.y, gridycells);
+}
+
+void sectorGridBuild(void)
+{
+    gridnumsectors = numsectors;
+    gridnumwalls   = numwalls;
+    gridnumentries = 0;
+    gridxcells = gridycells = 0;
+
+    Bmemset(outliermap, 0, sizeof(outliermap));
+    numoutliers = 0;
+
+    if (numsectors <= 0)
+        return;
+
+    vec2_t mapmin = { INT32_MAX, INT32_MAX }, mapmax = { INT32_MIN, INT32_MIN };
+
+    for (int i = 0; i < numsectors; i++)
+    {
+        sectorgrid_calcbbox(i);
+
+        auto const &bbox = sectorbbox[i];
+
+        if (bbox.min.x > bbox.max.x)
+            continue;
+
+        mapmin.x = min(mapmin.x, bbox.min.x);
+        mapmin.y = min(mapmin.y, bbox.min.y);
+        mapmax.x = max(mapmax.x, bbox.max.x);
+        mapmax.y = max(mapmax.y, bbox.max.y);
+    }
+
+    if (mapmin.x > mapmax.x)
+        return;
+
+    gridorigin = mapmin;
+
+    int64_t const mapw = (int64_t)mapmax.x - mapmin.x + 1, maph = (int64_t)mapmax.y - mapmin.y + 1;
+    int64_t const wantcells = min<int64_t>(max(numsectors * 2, 64), SECTORGRID_MAXCELLS);
+
+    // find the smallest cell size that keeps both the number of cells and
+    // the number of cell entries in check
+    for (gridshift = SECTORGRID_MINSHIFT; gridshift <= SECTORGRID_MAXSHIFT; gridshift++)
+    {
+        int64_t const xcells = ((mapw - 1) >> gridshift) + 1, ycells = ((maph - 1) >> gridshift) + 1;
+
+        if (xcells * ycells > wantcells)
+            continue;
+
+        gridxcells = (int32_t)xcells;
+        gridycells = (int32_t)ycells;
+
+        int64_t entries = 0;
+
+        for (int i = 0; i < numsectors; i++)
+        {
+            sectorgrid_calcspan(i);
+
+            auto const &span = sectorspan[i];
+
+            if (span.x0 <= span.x1)
+                entries += (int64_t)(span.x1 - span.x0 + 1) * (span.y1 - span.y0 + 1);
+        }
+
+        if (entries <= SECTORGRID_MAXENTRIES)
+        {
+            gridnumentries = (int32_t)entries;
+            break;
+        }
+    }
+
+    int32_t const numcells = gridxcells * gridycells;
+
+    gridcellstart = (int32_t *)Xrealloc(gridcellstart, (numcells + 1) * sizeof(int32_t));
+    gridcellsects = (int16_t *)Xrealloc(gridcellsects, max(gridnumentries, 1) * sizeof(int16_t));
+
+    Bmemset(gridcellstart, 0, (numcells + 1) * sizeof(int32_t));
+
+    for (int i = 0; i < numsectors; i++)
+    {
+        auto const &span = sectorspan[i];
+
+        for (int y = span.y0; y <= span.y1; y++)
+            for (int x = span.x0; x <= span.x1; x++)
+                gridcellstart[y * gridxcells + x + 1]++;
+    }
+
+    for (int i = 0; i < numcells; i++)
+        gridcellstart[i + 1] += gridcellstart[i];
+
+    // cellstart[c] is used as the fill position of cell c-1 and ends up
+    // pointing at the start of cell c again once every sector is filed
+    for (int i = 0; i < numsectors; i++)
+    {
+        auto const &span = sectorspan[i];
+
+        for (int y = span.y0; y <= span.y1; y++)
+            for (int x = span.x0; x <= span.x1; x++)
+                gridcellsects[gridcellstart[y * gridxcells + x]++] = i;
+    }
+
+    for (int i = numcells; i > 0; i--)
+        gridcellstart[i] = gridcellstart[i - 1];
+
+    gridcellstart[0] = 0;
+}
+
+void sectorGridUninit(void)
+{
+    DO_FREE_AND_NULL(gridcellstart);
+    DO_FREE_AND_NULL(gridcellsects);
+    gridnumsectors = -1;
+}
+
+void sectorGridInvalidate(int const sectnum)
+{
+    sectorPVSInvalidate(sectnum);
+    clipCacheInvalidate(sectnum);
+
+    if (gridnumsectors < 0)
+        return;
+
+    // the editor can leave the sector and wall arrays in an intermediate
+    // state while it moves things around, so just start over
+    if (editstatus || sectnum < 0 || gridnumsectors != numsectors || gridnumwalls != numwalls)
+    {
+        gridnumsectors = -1;
+        return;
+    }
+
+    // sectors past the end of the map, like Blood's mirror sector, aren't
+    // in the grid
+    if (sectnum >= gridnumsectors)
+        return;
+
+    auto const oldspan = sectorspan[sectnum];
+
+    sectorgrid_calcbbox(sectnum);
+
+    if (bitmap_test(outliermap, sectnum))
+        return;
+
+    sectorgrid_calcspan(sectnum);
+
+    auto const span = sectorspan[sectnum];
+
+    // it stays filed under the cells it was first filed under
+    sectorspan[sectnum] = oldspan;
+
+    if (span.x0 > span.x1 || (span.x0 >= oldspan.x0 && span.y0 >= oldspan.y0 && span.x1 <= oldspan.x1 && span.y1 <= oldspan.y1))
+        return;
+
+    if (numoutliers == SECTORGRID_MAXOUTLIERS)
+    {
+        gridnumsectors = -1;
+        return;
+    }
+
+    bitmap_set(outliermap, sectnum);
+    outliers[numoutliers++] = sectnum;
+}
+
+static FORCE_INLINE bool sectorgrid_bboxcontains(int const sectnum, int32_t const x, int32_t const y)
+{
+    auto const &bbox = sectorbbox[sectnum];
+    return x >= bbox.min.x && x <= bbox.max.x && y >= bbox.min.y && y <= bbox.max.y;
+}
+
+int16_t const *sectorGridQuery(int32_t const x, int32_t const y, int32_t *const numcandidates)
+{
+    if (!sectorgrid_enabled)
+        return NULL;
+
+    if (gridnumsectors != numsectors || gridnumwalls != numwalls)
+        sectorGridBuild();
+
+    int num = 0;
+
+    if (gridxcells > 0)
+    {
+        // points off the grid go to the nearest edge cell, which is also where
+        // sectorgrid_calcspan() files a sector that has since grown past it
+        int const cell = sectorgrid_cell(y, gridorigin.y, gridycells) * gridxcells + sectorgrid_cell(x, gridorigin.x, gridxcells);
+
+        for (int i = gridcellstart[cell], end = gridcellstart[cell + 1]; i < end; i++)
+        {
+            int const sectnum = gridcellsects[i];
+
+            if (!bitmap_test(outliermap, sectnum) && sectorgrid_bboxcontains(sectnum, x, y))
+                candidates[num++] = sectnum;
+        }
+    }
+
+    // outliers go in sorted, the list is short
+    for (int i = 0; i < numoutliers; i++)
+    {
+        int const sectnum = outliers[i];
+
+        if (!sectorgrid_bboxcontains(sectnum, x, y))
+            continue;
+
+        int j = num++;
+
+        for (; j > 0 && candidates[j - 1] > sectnum; j--)
+            candidates[j] = candidates[j - 1];
+
+        candidates[j] = sectnum;
+    }
+
+    *numcandidates = num;
+    return candidates;
+}
@@ -0,0 +1,325 @@
+// sectorpvs.cpp
+//  Conservative sector-to-sector visibility for cansee(), see sectorpvs.h.
+
+#include "actorprefetch.h"
+#include "build.h"
+#include "editor.h"
+#include "sectorpvs.h"
+
+int32_t sectorpvs_enabled = 1;
+int32_t sectorpvs_check;
+sectorpvsstats_t sectorpvs_stats;
+
+// chains longer than this, or rows that take more steps than this, are given up on
+#define SECTORPVS_MAXDEPTH 128
+#define SECTORPVS_MAXSTEPS (1<<14)
+
+enum
+{
+    PVSROW_STALE,
+    PVSROW_VALID,
+    PVSROW_ALL,  // given up on, sees every sector
+};
+
+// A set of line directions, stored as the normals n of the lines. When not
+// full, it holds the normals from lo counterclockwise to hi, at most half a
+// turn. Both are perpendiculars of differences of wall points, so they are
+// exact.
+typedef struct
+{
+    int64_t lox, loy, hix, hiy;
+    int32_t full;
+} pvscone_t;
+
+typedef struct
+{
+    pvscone_t cone;
+    int32_t   wallnum;  // next wall of sectnum to try
+    int16_t   sectnum;
+} pvsframe_t;
+
+static uint8_t *pvsrows;
+static uint8_t *pvsrowstate;
+static int32_t  pvsrowsize;
+
+// the map the table was set up for, -1 if it needs to be set up again
+static int32_t pvsnumsectors = -1, pvsnumwalls;
+
+// extents of all walls, only ever grown while walls move
+static vec2_t  pvsmin, pvsmax;
+static int64_t pvsmaxspan;
+
+typedef struct
+{
+    pvsframe_t stack[SECTORPVS_MAXDEPTH];
+    vec2_t     right[SECTORPVS_MAXDEPTH], left[SECTORPVS_MAXDEPTH];
+    uint8_t    onpath[(MAXSECTORS+7)>>3];
+} pvsworkspace_t;
+
+// one for each prefetch worker, cansee() itself uses the first
+static pvsworkspace_t pvsworkspace[MAXACTORPREFETCHTHREADS];
+
+static FORCE_INLINE uint8_t *sectorpvs_row(int const sectnum) { return &pvsrows[sectnum * pvsrowsize]; }
+
+static FORCE_INLINE int64_t sectorpvs_abs(int64_t const v) { return v < 0 ? -v : v; }
+
+static void sectorpvs_addextents(int const sectnum)
+{
+    auto wal = (uwallptr_t)&wall[sector[sectnum].wallptr];
+
+    for (int i = sector[sectnum].wallnum; i > 0; i--, wal++)
+    {
+        auto const wal2 = (uwallptr_t)&wall[wal->point2];
+
+        pvsmin.x = min(pvsmin.x, wal->x);
+        pvsmin.y = min(pvsmin.y, wal->y);
+        pvsmax.x = max(pvsmax.x, wal->x);
+        pvsmax.y = max(pvsmax.y, wal->y);
+
+        pvsmaxspan = max(pvsmaxspan, max(sectorpvs_abs((int64_t)wal2->x - wal->x), sectorpvs_abs((int64_t)wal2->y - wal->y)));
+    }
+}
+
+// Whether the normal (x, y) lies between lo and hi. The products can lose
+// precision with huge coordinates, so normals that are a rounding error
+// outside count as inside, which only makes the result more permissive.
+static FORCE_INLINE bool sectorpvs_inarc(int64_t const lox, int64_t const loy, int64_t const hix, int64_t const hiy,
+                                         int64_t const x, int64_t const y)
+{
+    double const lo = (double)lox * y - (double)loy * x;
+    double const hi = (double)x * hiy - (double)y * hix;
+    double const eps = 1e-9 * ((double)sectorpvs_abs(x) + sectorpvs_abs(y));
+
+    return lo >= -eps * ((double)sectorpvs_abs(lox) + sectorpvs_abs(loy)) &&
+           hi >= -eps * ((double)sectorpvs_abs(hix) + sectorpvs_abs(hiy));
+}
+
+// Narrows the cone down to the normals n with n.(vx, vy) >= 0. Returns false
+// if nothing is left.
+static bool sectorpvs_clipcone(pvscone_t &cone, int64_t const vx, int64_t const vy)
+{
+    if (vx == 0 && vy == 0)
+        return true;
+
+    // the half turn of normals from (vy, -vx) to (-vy, vx)
+    if (cone.full)
+    {
+        cone = { vy, -vx, -vy, vx, 0 };
+        return true;
+    }
+
+    pvscone_t res = cone;
+
+    if (sectorpvs_inarc(vy, -vx, -vy, vx, cone.lox, cone.loy))
+        ;
+    else if (sectorpvs_inarc(cone.lox, cone.loy, cone.hix, cone.hiy, vy, -vx))
+        res.lox = vy, res.loy = -vx;
+    else
+        return false;
+
+    // if neither end is inside the other arc, that is a rounding error and
+    // keeping the old end is the permissive choice
+    if (!sectorpvs_inarc(vy, -vx, -vy, vx, cone.hix, cone.hiy) &&
+        sectorpvs_inarc(cone.lox, cone.loy, cone.hix, cone.hiy, -vy, vx))
+        res.hix = -vy, res.hiy = vx;
+
+    cone = res;
+    return true;
+}
+
+// cansee() follows a red wall from wal to wal2 when its line crosses it with
+// wal on its right and wal2 on its left. A single line crosses all walls of a
+// chain that way iff its normal n has n.(left_j - right_i) >= 0 for every
+// pair of walls i and j in the chain.
+static int sectorpvs_buildrow(int const sect1, pvsworkspace_t &ws)
+{
+    uint8_t *const row = sectorpvs_row(sect1);
+    auto const pvsstack = ws.stack;
+    auto const pvsright = ws.right, pvsleft = ws.left;
+    auto const pvsonpath = ws.onpath;
+
+    Bmemset(row, 0, pvsrowsize);
+    bitmap_set(row, sect1);
+
+    int depth = 0, steps = 0;
+
+    pvsstack[0].cone.full = 1;
+    pvsstack[0].wallnum = sector[sect1].wallptr;
+    pvsstack[0].sectnum = sect1;
+    bitmap_set(pvsonpath, sect1);
+
+    while (depth >= 0)
+    {
+        auto &frame = pvsstack[depth];
+        auto const sec = (usectorptr_t)&sector[frame.sectnum];
+
+        if (frame.wallnum >= sec->wallptr + sec->wallnum)
+        {
+            bitmap_clear(pvsonpath, frame.sectnum);
+            depth--;
+            continue;
+        }
+
+        auto const wal = (uwallptr_t)&wall[frame.wallnum++];
+        int const nextsect = wal->nextsector;
+
+        // a chain through the same sector twice sees no more than the
+        // chain without the loop
+        if (nextsect < 0 || bitmap_test(pvsonpath, nextsect))
+            continue;
+
+        if (++steps > SECTORPVS_MAXSTEPS || depth + 1 == SECTORPVS_MAXDEPTH)
+        {
+            for (; depth >= 0; depth--)
+                bitmap_clear(pvsonpath, pvsstack[depth].sectnum);
+
+            Bmemset(row, 0xff, pvsrowsize);
+            return pvsrowstate[sect1] = PVSROW_ALL;
+        }
+
+        auto const wal2 = (uwallptr_t)&wall[wal->point2];
+        vec2_t const right = { wal->x, wal->y }, left = { wal2->x, wal2->y };
+        pvscone_t cone = frame.cone;
+
+        bool visible = sectorpvs_clipcone(cone, (int64_t)left.x - right.x, (int64_t)left.y - right.y);
+
+        for (int i = 0; i < depth && visible; i++)
+            visible = sectorpvs_clipcone(cone, (int64_t)left.x - pvsright[i].x, (int64_t)left.y - pvsright[i].y) &&
+                      sectorpvs_clipcone(cone, (int64_t)pvsleft[i].x - right.x, (int64_t)pvsleft[i].y - right.y);
+
+        if (!visible)
+            continue;
+
+        bitmap_set(row, nextsect);
+
+        pvsright[depth] = right;
+        pvsleft[depth]  = left;
+
+        auto &next = pvsstack[++depth];
+
+        next.cone = cone;
+        next.wallnum = sector[nextsect].wallptr;
+        next.sectnum = nextsect;
+        bitmap_set(pvsonpath, nextsect);
+    }
+
+    return pvsrowstate[sect1] = PVSROW_VALID;
+}
+
+static void sectorpvs_countrow(int const state)
+{
+    if (state == PVSROW_ALL)
+        sectorpvs_stats.rowsgivenup++;
+    else
+        sectorpvs_stats.rowsbuilt++;
+}
+
+void sectorPVSBuild(void)
+{
+    pvsnumsectors = numsectors;
+    pvsnumwalls   = numwalls;
+
+    if (numsectors <= 0)
+        return;
+
+    pvsrowsize  = (numsectors + 7) >> 3;
+    pvsrows     = (uint8_t *)Xrealloc(pvsrows, numsectors * pvsrowsize);
+    pvsrowstate = (uint8_t *)Xrealloc(pvsrowstate, numsectors);
+
+    Bmemset(pvsrowstate, PVSROW_STALE, numsectors);
+
+    pvsmin = { INT32_MAX, INT32_MAX };
+    pvsmax = { INT32_MIN, INT32_MIN };
+    pvsmaxspan = 0;
+
+    for (int i = 0; i < numsectors; i++)
+        sectorpvs_addextents(i);
+}
+
+void sectorPVSUninit(void)
+{
+    DO_FREE_AND_NULL(pvsrows);
+    DO_FREE_AND_NULL(pvsrowstate);
+    pvsnumsectors = -1;
+}
+
+void sectorPVSInvalidate(int const sectnum)
+{
+    if (pvsnumsectors < 0)
+        return;
+
+    if (editstatus || sectnum < 0 || pvsnumsectors != numsectors || pvsnumwalls != numwalls)
+    {
+        pvsnumsectors = -1;
+        return;
+    }
+
+    if (sectnum >= pvsnumsectors)
+        return;
+
+    sectorpvs_addextents(sectnum);
+
+    // every row that reached the sector may have gone through its walls
+    for (int i = 0; i < pvsnumsectors; i++)
+        if (pvsrowstate[i] == PVSROW_VALID && bitmap_test(sectorpvs_row(i), sectnum))
+            pvsrowstate[i] = PVSROW_STALE;
+}
+
+int sectorPVSReady(void)
+{
+    if (!sectorpvs_enabled)
+        return 0;
+
+#ifdef YAX_ENABLE
+    if (numyaxbunches > 0)
+        return 0;
+#endif
+
+    if (pvsnumsectors != numsectors || pvsnumwalls != numwalls)
+        sectorPVSBuild();
+
+    return 1;
+}
+
+int sectorPVSPrefetchRow(int const sectnum, int const worker)
+{
+    if ((unsigned)sectnum >= (unsigned)pvsnumsectors || pvsrowstate[sectnum] != PVSROW_STALE)
+        return 0;
+
+    return sectorpvs_buildrow(sectnum, pvsworkspace[worker]);
+}
+
+int sectorPVSRejects(int32_t const x1, int32_t const y1, int const sect1, int32_t const x2, int32_t const y2, int const sect2)
+{
+    if (sect1 == sect2 || !sectorPVSReady())
+        return 0;
+
+    if ((unsigned)sect1 >= (unsigned)numsectors || (unsigned)sect2 >= (unsigned)numsectors)
+        return 0;
+
+    // cansee() only decides which walls the line crosses correctly while its
+    // products fit in 32 bits. Past that it can reach sectors no line could.
+    // Each of dist*span, dist*reach and reach*span is one half of a difference
+    // cansee() computes, so all three have to stay below 2^30.
+    int64_t const dist  = max(sectorpvs_abs((int64_t)x2 - x1), sectorpvs_abs((int64_t)y2 - y1));
+    int64_t const reach = max(max((int64_t)x1 - pvsmin.x, (int64_t)pvsmax.x - x1),
+                              max((int64_t)y1 - pvsmin.y, (int64_t)pvsmax.y - y1));
+
+    if (dist >= (1<<30) || reach >= (1<<30) || dist * max(reach, pvsmaxspan) >= (1<<30) ||
+        reach * pvsmaxspan >= (1<<30))
+    {
+        sectorpvs_stats.unchecked++;
+        return 0;
+    }
+
+    sectorpvs_stats.tests++;
+
+    if (pvsrowstate[sect1] == PVSROW_STALE)
+        sectorpvs_countrow(sectorpvs_buildrow(sect1, pvsworkspace[0]));
+
+    if (bitmap_test(sectorpvs_row(sect1), sect2))
+        return 0;
+
+    sectorpvs_stats.rejected++;
+    return 1;
+}
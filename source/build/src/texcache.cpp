@@ -10,6 +10,8 @@
 #include "scriptfile.h"
 #include "xxhash.h"
 #include "kplib.h"
+#include "libasync_config.h"
+#include "microprofile.h"
 
 #include "vfs.h"
 
@@ -21,6 +23,8 @@
 #endif
 #include <sys/stat.h>
 
+#include <atomic>
+
 #include "mio.hpp"
 
 // mio uses OS file pointers on Windows and regular int file descriptors elsewhere
@@ -33,10 +37,25 @@
 #define CLEAR_GL_ERRORS() while(glGetError() != GL_NO_ERROR) { }
 #define TEXCACHE_FREEBUFS() { Xfree(pic), Xfree(packbuf), Xfree(midbuf); }
 
+// textures whose levels add up to fewer bytes than this are decoded on the main thread
+#define TEXCACHE_PARALLELSIZE 65536
+
 globaltexcache texcache;
 
 char TEXCACHEFILE[BMAX_PATH] = "texturecache";
 
+int32_t texcache_threads = 4;
+
+static async::threadpool_scheduler *texcachepool;
+static int32_t texcachepoolthreads;
+
+// the chunks of the entry texcache_writetex_fromdriver() is putting together
+static char   *chunkbuf;
+static int32_t chunkbuflen, chunkbufsiz;
+
+// the entry texcache_readtexheader() found last
+static texcacheindex loadentry;
+
 static const char *texcache_errors[TEXCACHEERRORS] = {
     "no error",
     "out of memory",
@@ -261,26 +280,78 @@ static void texcache_closefiles(void)
 
 void texcache_freeptrs(void)
 {
-    texcache.entrybufsiz = 0;
+    DO_FREE_AND_NULL(texcache.index);
+    texcache.indexsiz   = 0;
+    texcache.numentries = 0;
+
+    DO_FREE_AND_NULL(chunkbuf);
+    chunkbufsiz = 0;
+}
+
+void texcache_freepool(void)
+{
+    delete texcachepool;
+    texcachepool        = nullptr;
+    texcachepoolthreads = 0;
+}
+
+static texcacheindex *texcache_findslot(uint64_t const key)
+{
+    uint32_t const mask = texcache.indexsiz - 1;
+
+    // the keys are hashes already
+    for (uint32_t i = (uint32_t)(key ^ (key >> 32)) & mask;; i = (i + 1) & mask)
+        if (texcache.index[i].len == 0 || texcache.index[i].key == key)
+            return &texcache.index[i];
+}
 
-    if (!texcache.entries)
+// Makes room for num entries, keeping the table at most three quarters full.
+static void texcache_reserve(int32_t const num)
+{
+    if (num * 4 <= texcache.indexsiz * 3)
         return;
 
-    for (bssize_t i = 0; i < texcache.numentries; i++)
-        if (texcache.entries[i])
-        {
-            for (bssize_t ii = texcache.numentries - 1; ii >= 0; ii--)
-                if (i != ii && texcache.entries[ii] == texcache.entries[i])
-                {
-                    /*OSD_Printf("removing duplicate cacheptr %d\n",ii);*/
-                    texcache.entries[ii] = NULL;
-                }
+    texcacheindex *const oindex = texcache.index;
+    int32_t const oindexsiz = texcache.indexsiz;
 
-            DO_FREE_AND_NULL(texcache.entries[i]->name);
-            DO_FREE_AND_NULL(texcache.entries[i]);
-        }
+    texcache.indexsiz = max(oindexsiz, 1024);
+    while (num * 4 > texcache.indexsiz * 3)
+        texcache.indexsiz <<= 1;
 
-    DO_FREE_AND_NULL(texcache.entries);
+    texcache.index = (texcacheindex *)Xcalloc(texcache.indexsiz, sizeof(texcacheindex));
+
+    for (bssize_t i = 0; i < oindexsiz; i++)
+        if (oindex[i].len)
+            *texcache_findslot(oindex[i].key) = oindex[i];
+
+    Xfree(oindex);
+}
+
+static void texcache_addentry(uint64_t const key, int32_t const offset, int32_t const len)
+{
+    if (len <= 0)
+        return;
+
+    texcache_reserve(texcache.numentries + 1);
+
+    texcacheindex *const t = texcache_findslot(key);
+
+    if (!t->len)
+        texcache.numentries++;
+
+    t->key    = key;
+    t->offset = offset;
+    t->len    = len;
+}
+
+texcacheindex const *texcache_findentry(char const *cacheid)
+{
+    if (!texcache.numentries)
+        return nullptr;
+
+    texcacheindex const *const t = texcache_findslot(texcache_idkey(cacheid));
+
+    return t->len ? t : nullptr;
 }
 
 static inline void texcache_clearmemcache(void)
@@ -320,15 +391,6 @@ void texcache_init(void)
     texcache_closefiles();
     texcache_clearmemcache();
     texcache_freeptrs();
-
-    texcache.current = texcache.first = (texcacheindex *)Xcalloc(1, sizeof(texcacheindex));
-    texcache.numentries = 0;
-
-    //    Bmemset(&firstcacheindex, 0, sizeof(texcacheindex));
-    //    Bmemset(&cacheptrs[0], 0, sizeof(cacheptrs));
-
-    texcache.hashes.size = TEXCACHEHASHSIZE;
-    hash_init(&texcache.hashes);
 }
 
 static void texcache_deletefiles(void)
@@ -339,6 +401,8 @@ static void texcache_deletefiles(void)
     Bstrcpy(ptempbuf, TEXCACHEFILE);
     Bstrcat(ptempbuf, ".index");
     unlink(ptempbuf);
+    Bstrcat(ptempbuf, "2");
+    unlink(ptempbuf);
 }
 
 int32_t texcache_enabled(void)
@@ -364,7 +428,7 @@ void texcache_openfiles(void)
     Bassert(!texcache.indexFilePtr && !texcache.dataFilePtr);
 
     Bstrcpy(ptempbuf, TEXCACHEFILE);
-    Bstrcat(ptempbuf, ".index");
+    Bstrcat(ptempbuf, ".index2");
 
     bool const texcache_exists = buildvfs_exists(ptempbuf);
 
@@ -381,7 +445,9 @@ void texcache_openfiles(void)
 
     if (!texcache_exists)
     {
-        buildvfs_fputstr(texcache.indexFilePtr, "// automatically generated by the engine, DO NOT MODIFY!\n");
+        char head[TEXCACHEINDEXHEADSIZ];
+        texcache_putindex(head, nullptr, 0);
+        buildvfs_fwrite(head, sizeof(head), 1, texcache.indexFilePtr);
     }
 
     LOG_F(INFO, "Opened %s as cache file.", TEXCACHEFILE);
@@ -393,21 +459,16 @@ void texcache_checkgarbage(void)
     if (!texcache_enabled())
         return;
 
-    texcache.current = texcache.first;
+    int64_t bytes = 0;
 
-    int32_t bytes = 0;
-
-    while (texcache.current->next)
-    {
-        bytes += texcache.current->len;
-        texcache.current = texcache.current->next;
-    }
+    for (bssize_t i = 0; i < texcache.indexsiz; i++)
+        bytes += texcache.index[i].len;
 
     buildvfs_fseek_end(texcache.dataFilePtr);
     bytes = buildvfs_ftell(texcache.dataFilePtr)-bytes;
 
     if (bytes)
-        LOG_F(INFO, "Cache contains %d bytes of garbage data", bytes);
+        LOG_F(INFO, "Cache contains %" PRId64 " bytes of garbage data", bytes);
 }
 
 void texcache_invalidate(void)
@@ -423,7 +484,8 @@ void texcache_invalidate(void)
     texcache_openfiles();
 }
 
-int texcache_loadoffsets(void)
+// Loads the text index of older versions.
+static int texcache_loadtextindex(void)
 {
     Bstrcpy(ptempbuf, TEXCACHEFILE);
     Bstrcat(ptempbuf, ".index");
@@ -440,36 +502,89 @@ int texcache_loadoffsets(void)
         if (scriptfile_getnumber(script, &foffset)) break;	// offset in cache
         if (scriptfile_getnumber(script, &fsize)) break;	// size
 
-        int const i = hash_find(&texcache.hashes,fname);
+        texcache_addentry(texcache_idkey(fname), foffset, fsize);
+    }
+
+    scriptfile_close(script);
+    return 0;
+}
+
+// Replaces the index with one holding the current entries, sorted.
+static void texcache_writeindex(void)
+{
+    int32_t const len = TEXCACHEINDEXHEADSIZ + texcache.numentries * TEXCACHEINDEXRECSIZ;
+    auto recs = (texcacheindexrec *)Xmalloc(max(texcache.numentries, 1) * sizeof(texcacheindexrec));
+    auto buf  = (char *)Xmalloc(len);
+    int32_t num = 0;
+
+    for (bssize_t i = 0; i < texcache.indexsiz; i++)
+        if (texcache.index[i].len)
+            recs[num++] = { texcache.index[i].key, (uint32_t)texcache.index[i].offset, (uint32_t)texcache.index[i].len };
+
+    texcache_putindex(buf, recs, num);
+
+    Bstrcpy(ptempbuf, TEXCACHEFILE);
+    Bstrcat(ptempbuf, ".index2");
+
+    MAYBE_FCLOSE_AND_NULL(texcache.indexFilePtr);
+
+    buildvfs_FILE fp = buildvfs_fopen_write(ptempbuf);
+
+    if (!fp || buildvfs_fwrite(buf, len, 1, fp) != 1)
+        LOG_F(ERROR, "Unable to write cache index %s: %s.", ptempbuf, strerror(errno));
+
+    MAYBE_FCLOSE_AND_NULL(fp);
+
+    texcache.indexFilePtr = buildvfs_fopen_append(ptempbuf);
+
+    Xfree(buf);
+    Xfree(recs);
+}
+
+int texcache_loadoffsets(void)
+{
+    Bstrcpy(ptempbuf, TEXCACHEFILE);
+    Bstrcat(ptempbuf, ".index2");
+
+    int32_t numrecs = -1, numsorted = 0, tail = 0;
 
-        if (i > -1)
+    {
+        std::error_code error;
+        auto map = mio::make_mmap_source((char const *)ptempbuf, error);
+
+        if (!error && map.is_mapped())
         {
-            // update an existing entry
-            texcacheindex *t = texcache.entries[i];
-            t->offset = foffset;
-            t->len = fsize;
-            /*initprintf("%s %d got a match for %s offset %d\n",__FILE__, __LINE__, fname,foffset);*/
+            numrecs = texcache_checkindex(map.data(), map.length(), &numsorted);
+            tail    = texcache_indextail(map.length());
         }
-        else
+
+        if (numrecs > 0)
         {
-            texcacheindex * const index = texcache.current;
-
-            index->name   = Xstrdup(fname);
-            index->offset = foffset;
-            index->len    = fsize;
-            index->next   = (texcacheindex *) Xcalloc(1, sizeof(texcacheindex));
-            hash_add(&texcache.hashes, fname, texcache.numentries, 1);
-            if (++texcache.numentries > texcache.entrybufsiz)
+            texcache_reserve(numrecs);
+
+            for (bssize_t i = 0; i < numrecs; i++)
             {
-                texcache.entrybufsiz += 512;
-                texcache.entries = (texcacheindex **) Xrealloc(texcache.entries, sizeof(intptr_t) * texcache.entrybufsiz);
+                texcacheindexrec r;
+                texcache_getindexrec(map.data(), i, &r);
+                texcache_addentry(r.key, r.offset, r.len);
             }
-            texcache.entries[texcache.numentries-1] = texcache.current;
-            texcache.current = index->next;
         }
     }
 
-    scriptfile_close(script);
+    if (numrecs >= 0 && tail)
+        LOG_F(WARNING, "Dropping a partial record of %d bytes at the end of the cache index.", tail);
+
+    bool rewrite = numrecs < 0 || numrecs > numsorted || tail;
+
+    if (numrecs <= 0 && !texcache_loadtextindex() && texcache.numentries)
+    {
+        LOG_F(INFO, "Converting text cache index of %d entries.", texcache.numentries);
+        rewrite = true;
+    }
+
+    if (rewrite && texcache.indexFilePtr)
+        texcache_writeindex();
+
     return 0;
 }
 
@@ -521,12 +636,13 @@ int texcache_readtexheader(char const * cacheid, texcacheheader *head, int32_t m
     if (!texcache_enabled())
         return 0;
 
-    int32_t i = hash_find(&texcache.hashes, cacheid);
+    texcacheindex const *const t = texcache_findentry(cacheid);
 
-    if (i < 0 || !texcache.entries[i])
+    if (!t)
         return 0;  // didn't find it
 
-    texcache.dataFilePos = texcache.entries[i]->offset;
+    loadentry = *t;
+    texcache.dataFilePos = t->offset;
 //    initprintf("%s %d got a match for %s offset %d\n",__FILE__, __LINE__, cachefn,offset);
 
     int err = 0;
@@ -534,7 +650,7 @@ int texcache_readtexheader(char const * cacheid, texcacheheader *head, int32_t m
     if (texcache_readdata(head, sizeof(texcacheheader)))
         FAIL(0);
 
-    if (Bmemcmp(head->magic, TEXCACHEMAGIC, 4))
+    if (Bmemcmp(head->magic, TEXCACHEMAGIC2, 4) && Bmemcmp(head->magic, TEXCACHEMAGIC, 4))
         FAIL(1);
 
     // native (little-endian) -> internal
@@ -585,16 +701,10 @@ failure:
 
 void texcache_prewritetex(texcacheheader *head)
 {
-    Bmemcpy(head->magic, TEXCACHEMAGIC, 4);   // sizes are set by caller
+    Bmemcpy(head->magic, TEXCACHEMAGIC2, 4);   // sizes are set by caller
 
     if (glusetexcache == 2)
         head->flags |= CACHEAD_COMPRESSED;
-
-    // native -> external (little-endian)
-    head->xdim    = B_LITTLE32(head->xdim);
-    head->ydim    = B_LITTLE32(head->ydim);
-    head->flags   = B_LITTLE32(head->flags);
-    head->quality = B_LITTLE32(head->quality);
 }
 
 #define WRITEX_FAIL_ON_ERROR() if (glGetError() != GL_NO_ERROR) goto failure
@@ -617,23 +727,28 @@ void texcache_writetex_fromdriver(char const * const cacheid, texcacheheader *he
     }
 
     texcache_prewritetex(head);
-    buildvfs_fseek_end(texcache.dataFilePtr);
-    size_t const offset = buildvfs_ftell(texcache.dataFilePtr);
 
-    texcachepicture pict;
+    texcachemip mips[TEXCACHEMAXMIPS];
+    int32_t nummips = 0;
 
     char *pic     = nullptr;
     char *packbuf = nullptr;
     void *midbuf  = nullptr;
+    char *entryhead = nullptr;
     size_t alloclen = 0;
 
-    //    OSD_Printf("Caching %s, offset 0x%x\n", cachefn, offset);
-    if (buildvfs_fwrite(head, sizeof(texcacheheader), 1, texcache.dataFilePtr) != 1) goto failure;
+    chunkbuflen = 0;
 
     CLEAR_GL_ERRORS();
 
     for (int level = 0, padx = 0, pady = 0; level == 0 || (padx > 1 || pady > 1); ++level)
     {
+        if (level == TEXCACHEMAXMIPS)
+            goto failure;
+
+        texcachemip &mip = mips[level];
+        Bmemset(&mip, 0, sizeof(texcachemip));
+
         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &gi);
         WRITEX_FAIL_ON_ERROR();
         if (gi != GL_TRUE)
@@ -645,31 +760,28 @@ void texcache_writetex_fromdriver(char const * const cacheid, texcacheheader *he
 #if defined __APPLE__ && defined POLYMER
         if (pr_ati_textureformat_one && gi == 1) gi = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
 #endif
-        // native -> external (little endian)
-        pict.format = B_LITTLE32(gi);
+        mip.pict.format = gi;
 
         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &gi);
         WRITEX_FAIL_ON_ERROR();
-        padx      = gi;
-        pict.xdim = B_LITTLE32(gi);
+        padx = mip.pict.xdim = gi;
 
         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &gi);
         WRITEX_FAIL_ON_ERROR();
-        pady      = gi;
-        pict.ydim = B_LITTLE32(gi);
+        pady = mip.pict.ydim = gi;
 
         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_BORDER, &gi);
         WRITEX_FAIL_ON_ERROR();
-        pict.border = B_LITTLE32(gi);
+        mip.pict.border = gi;
 
         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_DEPTH, &gi);
         WRITEX_FAIL_ON_ERROR();
-        pict.depth = B_LITTLE32(gi);
+        mip.pict.depth = gi;
 
         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &gi);
         WRITEX_FAIL_ON_ERROR();
         uint32_t miplen = gi;
-        pict.size       = B_LITTLE32(gi);
+        mip.pict.size   = gi;
 
         if (alloclen < miplen)
         {
@@ -682,18 +794,34 @@ void texcache_writetex_fromdriver(char const * const cacheid, texcacheheader *he
         glGetCompressedTexImage(GL_TEXTURE_2D, level, pic);
         WRITEX_FAIL_ON_ERROR();
 
-        if (buildvfs_fwrite(&pict, sizeof(texcachepicture), 1, texcache.dataFilePtr) != 1) goto failure;
-        if (dxtfilter(&pict, pic, midbuf, packbuf, miplen)) goto failure;
+        if (dxtfilter(&mip, pic, midbuf, packbuf)) goto failure;
+        nummips++;
     }
 
-    texcache_postwritetex(cacheid, offset);
+    {
+        // the whole entry goes out at once, with the level table up front
+        int32_t const headsiz = texcache_entryheadsize(nummips);
+
+        entryhead = (char *)Xmalloc(headsiz);
+        texcache_putentryhead(entryhead, head, mips, nummips);
+
+        buildvfs_fseek_end(texcache.dataFilePtr);
+        size_t const offset = buildvfs_ftell(texcache.dataFilePtr);
+
+        //    OSD_Printf("Caching %s, offset 0x%x\n", cachefn, offset);
+        if (buildvfs_fwrite(entryhead, headsiz, 1, texcache.dataFilePtr) != 1) goto failure;
+        if (buildvfs_fwrite(chunkbuf, chunkbuflen, 1, texcache.dataFilePtr) != 1) goto failure;
+
+        texcache_postwritetex(cacheid, offset);
+    }
+
+    Xfree(entryhead);
     TEXCACHE_FREEBUFS();
     return;
 
 failure:
     LOG_F(ERROR, "texcache mystery error");
-    texcache.current->offset = 0;
-    Xfree(texcache.current->name);
+    Xfree(entryhead);
     TEXCACHE_FREEBUFS();
 }
 
@@ -701,52 +829,36 @@ failure:
 
 void texcache_postwritetex(char const * const cacheid, int32_t const offset)
 {
-    int32_t const i = hash_find(&texcache.hashes, cacheid);
+    buildvfs_fseek_end(texcache.dataFilePtr);
 
-    texcacheindex *t;
+    texcacheindexrec const r = { texcache_idkey(cacheid), (uint32_t)offset, (uint32_t)(buildvfs_ftell(texcache.dataFilePtr) - offset) };
 
-    if (i > -1)
-    {
-        // update an existing entry
-        t = texcache.entries[i];
+    texcache_addentry(r.key, r.offset, r.len);
 
-        t->offset = offset;
-        buildvfs_fseek_end(texcache.dataFilePtr);
-        t->len    = buildvfs_ftell(texcache.dataFilePtr) - t->offset;
-        /*initprintf("%s %d got a match for %s offset %d\n",__FILE__, __LINE__, cachefn,offset);*/
+    if (texcache.indexFilePtr)
+    {
+        char buf[TEXCACHEINDEXRECSIZ];
+        texcache_putindexrec(buf, &r);
+        buildvfs_fwrite(buf, sizeof(buf), 1, texcache.indexFilePtr);
     }
     else
-    {
-        t = texcache.current;
-
-        Xfree(t->name);
-        t->name   = Xstrdup(cacheid);
-        t->offset = offset;
-        buildvfs_fseek_end(texcache.dataFilePtr);
-        t->len    = buildvfs_ftell(texcache.dataFilePtr) - t->offset;
-        t->next   = (texcacheindex *)Xcalloc(1, sizeof(texcacheindex));
-
-        hash_add(&texcache.hashes, cacheid, texcache.numentries, 0);
-
-        if (++texcache.numentries > texcache.entrybufsiz)
-        {
-            texcache.entrybufsiz += 512;
-            texcache.entries = (texcacheindex **)Xrealloc(texcache.entries, sizeof(intptr_t) * texcache.entrybufsiz);
-        }
+        LOG_F(ERROR, "fatal error in texcache: no indexFilePtr");
+}
 
-        texcache.entries[texcache.numentries - 1] = t;
-        texcache.current = t->next;
-    }
+int32_t texcache_writechunk(void const *buf, int32_t len)
+{
+    int32_t const offset = chunkbuflen;
 
-    if (texcache.indexFilePtr)
+    if (chunkbuflen + len > chunkbufsiz)
     {
-        char buf[64];
-        buildvfs_fputstrptr(texcache.indexFilePtr, t->name);
-        snprintf(buf, sizeof(buf), " %d %d\n", t->offset, t->len);
-        buildvfs_fputstrptr(texcache.indexFilePtr, buf);
+        chunkbufsiz = max(chunkbufsiz << 1, chunkbuflen + len);
+        chunkbuf    = (char *)Xrealloc(chunkbuf, chunkbufsiz);
     }
-    else
-        LOG_F(ERROR, "fatal error in texcache: no indexFilePtr");
+
+    Bmemcpy(chunkbuf + offset, buf, len);
+    chunkbuflen += len;
+
+    return offset;
 }
 
 #endif
@@ -779,56 +891,116 @@ static char const* texcache_format_to_name(GLint format)
     }
 }
 
-static int32_t texcache_loadmips(const texcacheheader *head, GLenum *glerr)
+static void texcache_setuppool(int32_t const numthreads)
 {
-    texcachepicture pict;
+    if (numthreads == texcachepoolthreads)
+        return;
 
-    char *pic     = nullptr;
-    char *packbuf = nullptr;
-    void *midbuf  = nullptr;
+    texcache_freepool();
+    texcachepool = new async::threadpool_scheduler(numthreads, []() { MicroProfileOnThreadCreate("Texcache"); }, nullptr);
+    texcachepoolthreads = numthreads;
+}
 
-    int32_t alloclen=0;
+static int32_t texcache_loadmips(const texcacheheader *head, GLenum *glerr)
+{
+#if defined USE_GLEXT && !defined EDUKE32_GLES
+    MICROPROFILE_SCOPEI("Texcache", EDUKE32_FUNCTION, MP_AUTO);
 
-#if !defined USE_GLEXT && defined EDUKE32_GLES
-    UNREFERENCED_PARAMETER(glerr);
-    UNREFERENCED_PARAMETER(head);
-#endif
+    texcacheindex const t = loadentry;
 
-    for (bssize_t level = 0; level==0 || (pict.xdim > 1 || pict.ydim > 1); level++)
+    char const *entry;
+    char *entrybuf = nullptr;
+
+    if (texcache.rw_mmap.is_mapped() && texcache.rw_mmap.length() >= (size_t)t.offset + t.len)
+        entry = texcache.rw_mmap.data() + t.offset;
+    else
     {
-        if (texcache_readdata(&pict, sizeof(texcachepicture)))
+        entry = entrybuf = (char *)Xmalloc(t.len);
+
+        if (buildvfs_fseek_abs(texcache.dataFilePtr, t.offset) || buildvfs_fread(entrybuf, t.len, 1, texcache.dataFilePtr) != 1)
         {
-            TEXCACHE_FREEBUFS();
+            Xfree(entrybuf);
             return TEXCACHERR_BUFFERUNDERRUN;
         }
+    }
 
-        // external (little endian) -> native
-        pict.size   = B_LITTLE32(pict.size);
-        pict.format = B_LITTLE32(pict.format);
-        pict.xdim   = B_LITTLE32(pict.xdim);
-        pict.ydim   = B_LITTLE32(pict.ydim);
-        pict.border = B_LITTLE32(pict.border);
-        pict.depth  = B_LITTLE32(pict.depth);
+    texcacheheader entryhead;
+    texcachemip mips[TEXCACHEMAXMIPS];
+    int32_t const nummips = texcache_parseentry(entry, t.len, &entryhead, mips);
 
-        if (alloclen < pict.size)
-        {
-            alloclen = pict.size;
-            pic      = (char *)Xrealloc(pic, pict.size);
-            packbuf  = (char *)Xrealloc(packbuf, pict.size + 16);
-            midbuf   = (void *)Xrealloc(midbuf, pict.size);
-        }
+    if (nummips <= 0)
+    {
+        Xfree(entrybuf);
+        return TEXCACHERR_BUFFERUNDERRUN;
+    }
 
-#if defined USE_GLEXT && !defined EDUKE32_GLES
-        if (dedxtfilter(&pict, pic, midbuf, packbuf, (head->flags & CACHEAD_COMPRESSED) != 0))
+    // Every chunk of every level is a job of its own: each one fills
+    // different bytes of its level's DXT blocks, and is unpacked into a
+    // scratch area of its own.
+    struct { int16_t level, c; int32_t picofs, midofs; } jobs[TEXCACHEMAXMIPS * TEXCACHECHUNKS];
+    int32_t numjobs = 0, picsiz = 0, midsiz = 0;
+
+    for (bssize_t level = 0; level < nummips; level++)
+    {
+        for (int c = 0; c < TEXCACHECHUNKS; c++)
         {
-            TEXCACHE_FREEBUFS();
-            return TEXCACHERR_DEDXT;
+            int32_t const size = texcache_chunksize(&mips[level], c);
+
+            if (size)
+            {
+                jobs[numjobs++] = { (int16_t)level, (int16_t)c, picsiz, midsiz };
+                midsiz += size;
+            }
         }
 
-        glCompressedTexImage2D(GL_TEXTURE_2D, level, pict.format, pict.xdim, pict.ydim, pict.border, pict.size, pic);
+        picsiz += mips[level].pict.size;
+    }
+
+    char *pic    = (char *)Xmalloc(picsiz);
+    char *midbuf = (char *)Xmalloc(midsiz);
+    int32_t const ispacked = (head->flags & CACHEAD_COMPRESSED) != 0;
+    std::atomic<int32_t> failed(0);
+
+    auto dojob = [&](int32_t const i)
+    {
+        auto const &job = jobs[i];
+
+        if (dedxtfilter(&mips[job.level], job.c, entry, pic + job.picofs, midbuf + job.midofs, ispacked))
+            failed = 1;
+    };
+
+    int32_t const numthreads = clamp(texcache_threads, 1, MAXTEXCACHETHREADS);
+
+    if (numthreads > 1 && picsiz >= TEXCACHE_PARALLELSIZE)
+    {
+        texcache_setuppool(numthreads);
+        async::parallel_for(*texcachepool, async::static_partitioner(async::irange(0, numjobs), 1), dojob);
+    }
+    else
+    {
+        for (bssize_t i = 0; i < numjobs; i++)
+            dojob(i);
+    }
+
+    Xfree(entrybuf);
+    Xfree(midbuf);
+
+    if (failed)
+    {
+        Xfree(pic);
+        return TEXCACHERR_DEDXT;
+    }
+
+    char const *levelpic = pic;
+
+    for (bssize_t level = 0; level < nummips; level++)
+    {
+        texcachepicture const &pict = mips[level].pict;
+
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, pict.format, pict.xdim, pict.ydim, pict.border, pict.size, levelpic);
         if ((*glerr=glGetError()) != GL_NO_ERROR)
         {
-            TEXCACHE_FREEBUFS();
+            Xfree(pic);
             return TEXCACHERR_COMPTEX;
         }
 
@@ -836,7 +1008,7 @@ static int32_t texcache_loadmips(const texcacheheader *head, GLenum *glerr)
         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
         if ((*glerr = glGetError()) != GL_NO_ERROR)
         {
-            TEXCACHE_FREEBUFS();
+            Xfree(pic);
             return TEXCACHERR_GETTEXLEVEL;
         }
 
@@ -844,14 +1016,20 @@ static int32_t texcache_loadmips(const texcacheheader *head, GLenum *glerr)
         {
             LOG_F(ERROR, "Invalid texcache format, have format %s but need format %s.",
                                     texcache_format_to_name(pict.format), texcache_format_to_name(format));
-            TEXCACHE_FREEBUFS();
+            Xfree(pic);
             return -1;
         }
-#endif
+
+        levelpic += pict.size;
     }
 
-    TEXCACHE_FREEBUFS();
+    Xfree(pic);
     return 0;
+#else
+    UNREFERENCED_PARAMETER(glerr);
+    UNREFERENCED_PARAMETER(head);
+    return -1;
+#endif
 }
 
 int32_t texcache_loadskin(const texcacheheader *head, int32_t *doalloc, GLuint *glpic, vec2_t *siz)
@@ -938,38 +1116,66 @@ void texcache_setupmemcache(void)
 } while(0);
 
 struct voxcachedat_t {
+    char magic[4];  // VOXCACHEMAGIC
     int32_t qcnt, mytexx, mytexy;
     int32_t compressed_size;
+    vec3_t siz;
+    vec3f_t piv;
+    int32_t is8bit;
 };
 
-voxmodel_t* voxcache_fetchvoxmodel(const char* const cacheid)
+voxmodel_t* voxcache_fetchvoxmodel(const char* const cacheid, int32_t* const damaged)
 {
     if (!texcache_enabled()) return NULL;
 
-    int32_t i = hash_find(&texcache.hashes, cacheid);
-    if (i < 0 || !texcache.entries[i])
+    texcacheindex const *const t = texcache_findentry(cacheid);
+    if (!t)
         return NULL;  // didn't find it
 
     voxcachedat_t voxd = {};
+    texcache.dataFilePos = t->offset;
+
+    if (t->len < (int32_t)sizeof(voxd) || texcache_readdata(&voxd, sizeof(voxd)) || Bmemcmp(voxd.magic, VOXCACHEMAGIC, 4)
+        || voxd.qcnt < 0 || voxd.mytexx <= 0 || voxd.mytexy <= 0 || voxd.mytexx > 16384 || voxd.mytexy > 16384
+        || voxd.compressed_size <= 0 || voxd.compressed_size > t->len - (int32_t)sizeof(voxd))
+    {
+        *damaged = 1;
+        return NULL;
+    }
+
     size_t vertexsize, indexsize, mytexsize, totalsize;
     voxmodel_t* vm = (voxmodel_t*)Xcalloc(1, sizeof(voxmodel_t));
 
-    texcache.dataFilePos = texcache.entries[i]->offset;
-    texcache_readdata(&voxd, sizeof(voxd));
     vm->mytexx = voxd.mytexx;
     vm->mytexy = voxd.mytexy;
     vm->qcnt = voxd.qcnt;
+    vm->siz = voxd.siz;
+    vm->piv = voxd.piv;
+    vm->is8bit = voxd.is8bit;
     INITVARS_VOXSIZES(vertexsize, indexsize, mytexsize, totalsize);
 
-    char* compressed_data = (char*)Xmalloc(voxd.compressed_size);
-    texcache_readdata(compressed_data, voxd.compressed_size);
+    // LZ4 can't make anything smaller than about 1/255 of its size
+    if (totalsize / 255 > (size_t)voxd.compressed_size)
+    {
+        *damaged = 1;
+        Xfree(vm);
+        return NULL;
+    }
 
+    char* compressed_data = (char*)Xmalloc(voxd.compressed_size);
     char* decompressed_data = (char*)Xmalloc(totalsize);
-    auto bytes = LZ4_decompress_safe(compressed_data, decompressed_data, voxd.compressed_size, totalsize);
-    Xfree(compressed_data);
 
-    UNREFERENCED_PARAMETER(bytes);
-    Bassert(bytes > 0);
+    if (texcache_readdata(compressed_data, voxd.compressed_size)
+        || LZ4_decompress_safe(compressed_data, decompressed_data, voxd.compressed_size, totalsize) != (int)totalsize)
+    {
+        *damaged = 1;
+        Xfree(compressed_data);
+        Xfree(decompressed_data);
+        Xfree(vm);
+        return NULL;
+    }
+
+    Xfree(compressed_data);
 
     vm->vertex = (GLfloat*)Xmalloc(vertexsize);
     Bmemcpy(vm->vertex, decompressed_data, vertexsize);
@@ -990,7 +1196,8 @@ void voxcache_writevoxmodel(const char* const cacheid, voxmodel_t* vm)
     if (!vm || !texcache_enabled()) return;
 
     size_t vertexsize, indexsize, mytexsize, totalsize;
-    voxcachedat_t vxdat = { vm->qcnt, vm->mytexx, vm->mytexy, 0 };
+    voxcachedat_t vxdat = { "", vm->qcnt, vm->mytexx, vm->mytexy, 0, vm->siz, vm->piv, vm->is8bit };
+    Bmemcpy(vxdat.magic, VOXCACHEMAGIC, 4);
     INITVARS_VOXSIZES(vertexsize, indexsize, mytexsize, totalsize);
 
     char* srcdata = (char*)Xmalloc(totalsize);
@@ -1020,8 +1227,6 @@ void voxcache_writevoxmodel(const char* const cacheid, voxmodel_t* vm)
 
 vxstore_failure:
     LOG_F(ERROR, "voxcache mystery error");
-    texcache.current->offset = 0;
-    Xfree(texcache.current->name);
     Xfree(targetdata);
 }
 
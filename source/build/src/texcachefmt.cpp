@@ -0,0 +1,223 @@
+// texcachefmt.cpp
+//  Reading and writing texture cache entries and indices, see texcachefmt.h.
+
+#include "compat.h"
+#include "texcachefmt.h"
+#include "lz4.h"
+
+#include <algorithm>
+
+EDUKE32_STATIC_ASSERT(sizeof(texcacheheader) == 20);
+EDUKE32_STATIC_ASSERT(sizeof(texcachepicture) == 24);
+
+static FORCE_INLINE int32_t texcache_get32(char const *p) { return (int32_t)B_LITTLE32(B_UNBUF32(p)); }
+static FORCE_INLINE void texcache_put32(char *p, int32_t v) { B_BUF32(p, B_LITTLE32((uint32_t)v)); }
+
+int32_t texcache_checkindex(char const *data, int32_t len, int32_t *numsorted)
+{
+    if (len < TEXCACHEINDEXHEADSIZ || Bmemcmp(data, TEXCACHEINDEXMAGIC, 4))
+        return -1;
+
+    // a record cut short by a crash while it was being appended is not
+    // counted, the caller rewrites the index without it
+    int32_t const numrecs = (len - TEXCACHEINDEXHEADSIZ) / TEXCACHEINDEXRECSIZ;
+
+    *numsorted = texcache_get32(data + 4);
+
+    if ((unsigned)*numsorted > (unsigned)numrecs)
+        return -1;
+
+    return numrecs;
+}
+
+void texcache_getindexrec(char const *data, int32_t rec, texcacheindexrec *r)
+{
+    char const *p = data + TEXCACHEINDEXHEADSIZ + rec * TEXCACHEINDEXRECSIZ;
+
+    r->key    = B_LITTLE64(B_UNBUF64(p));
+    r->offset = texcache_get32(p + 8);
+    r->len    = texcache_get32(p + 12);
+}
+
+void texcache_putindexrec(char *buf, texcacheindexrec const *r)
+{
+    B_BUF64(buf, B_LITTLE64(r->key));
+    texcache_put32(buf + 8, r->offset);
+    texcache_put32(buf + 12, r->len);
+}
+
+void texcache_putindex(char *buf, texcacheindexrec *recs, int32_t num)
+{
+    std::sort(recs, recs + num, [](texcacheindexrec const &a, texcacheindexrec const &b) { return a.key < b.key; });
+
+    Bmemcpy(buf, TEXCACHEINDEXMAGIC, 4);
+    texcache_put32(buf + 4, num);
+
+    for (int i = 0; i < num; i++)
+        texcache_putindexrec(buf + TEXCACHEINDEXHEADSIZ + i * TEXCACHEINDEXRECSIZ, &recs[i]);
+}
+
+static char const *texcache_getpict(char const *p, texcachepicture *pict)
+{
+    pict->size   = texcache_get32(p);
+    pict->format = texcache_get32(p + 4);
+    pict->xdim   = texcache_get32(p + 8);
+    pict->ydim   = texcache_get32(p + 12);
+    pict->border = texcache_get32(p + 16);
+    pict->depth  = texcache_get32(p + 20);
+
+    return p + sizeof(texcachepicture);
+}
+
+int32_t texcache_parseentry(char const *data, int32_t len, texcacheheader *head, texcachemip *mips)
+{
+    if (len < (int32_t)sizeof(texcacheheader))
+        return 0;
+
+    Bmemcpy(head->magic, data, 4);
+
+    bool const v2 = !Bmemcmp(head->magic, TEXCACHEMAGIC2, 4);
+
+    if (!v2 && Bmemcmp(head->magic, TEXCACHEMAGIC, 4))
+        return 0;
+
+    head->xdim    = texcache_get32(data + 4);
+    head->ydim    = texcache_get32(data + 8);
+    head->flags   = texcache_get32(data + 12);
+    head->quality = texcache_get32(data + 16);
+
+    char const *p = data + sizeof(texcacheheader);
+    char const *const end = data + len;
+
+    if (v2)
+    {
+        if (end - p < (int32_t)sizeof(int32_t))
+            return -1;
+
+        int32_t const nummips = texcache_get32(p);
+        p += sizeof(int32_t);
+
+        if (nummips <= 0 || nummips > TEXCACHEMAXMIPS || len < texcache_entryheadsize(nummips))
+            return -1;
+
+        int32_t const headsiz = texcache_entryheadsize(nummips);
+
+        for (int level = 0; level < nummips; level++)
+        {
+            texcachemip &mip = mips[level];
+
+            p = texcache_getpict(p, &mip.pict);
+
+            for (int c = 0; c < TEXCACHECHUNKS; c++, p += sizeof(int32_t))
+                mip.chunkofs[c] = texcache_get32(p);
+            for (int c = 0; c < TEXCACHECHUNKS; c++, p += sizeof(int32_t))
+                mip.chunklen[c] = texcache_get32(p);
+
+            if (mip.pict.size <= 0)
+                return -1;
+
+            for (int c = 0; c < TEXCACHECHUNKS; c++)
+            {
+                int32_t const size = texcache_chunksize(&mip, c);
+
+                if (!size)
+                {
+                    if (mip.chunklen[c])
+                        return -1;
+                    continue;
+                }
+
+                if (mip.chunklen[c] <= 0 || mip.chunklen[c] > size || mip.chunkofs[c] < headsiz || mip.chunkofs[c] > len - mip.chunklen[c])
+                    return -1;
+            }
+        }
+
+        return nummips;
+    }
+
+    for (int level = 0; level < TEXCACHEMAXMIPS; level++)
+    {
+        texcachemip &mip = mips[level];
+
+        if (end - p < (int32_t)sizeof(texcachepicture))
+            return -1;
+
+        p = texcache_getpict(p, &mip.pict);
+
+        if (mip.pict.size <= 0)
+            return -1;
+
+        for (int c = 0; c < TEXCACHECHUNKS; c++)
+        {
+            int32_t const size = texcache_chunksize(&mip, c);
+
+            mip.chunkofs[c] = mip.chunklen[c] = 0;
+
+            if (!size)
+                continue;
+
+            if (end - p < (int32_t)sizeof(int32_t))
+                return -1;
+
+            int32_t const cleng = texcache_get32(p);
+            p += sizeof(int32_t);
+
+            if (cleng <= 0 || cleng > size || cleng > end - p)
+                return -1;
+
+            mip.chunkofs[c] = p - data;
+            mip.chunklen[c] = cleng;
+            p += cleng;
+        }
+
+        if (mip.pict.xdim <= 1 && mip.pict.ydim <= 1)
+            return level + 1;
+    }
+
+    return -1;
+}
+
+int32_t texcache_unpackchunk(char const *entry, texcachemip const *mip, int c, char *buf, int32_t ispacked)
+{
+    int32_t const size  = texcache_chunksize(mip, c);
+    int32_t const cleng = mip->chunklen[c];
+    char const *const src = entry + mip->chunkofs[c];
+
+    if (ispacked && cleng < size)
+        return LZ4_decompress_safe(src, buf, cleng, size) != size;
+
+    if (cleng != size)
+        return -1;
+
+    Bmemcpy(buf, src, size);
+    return 0;
+}
+
+void texcache_putentryhead(char *buf, texcacheheader const *head, texcachemip const *mips, int32_t nummips)
+{
+    int32_t const headsiz = texcache_entryheadsize(nummips);
+
+    Bmemcpy(buf, TEXCACHEMAGIC2, 4);
+    texcache_put32(buf + 4, head->xdim);
+    texcache_put32(buf + 8, head->ydim);
+    texcache_put32(buf + 12, head->flags);
+    texcache_put32(buf + 16, head->quality);
+
+    char *p = buf + sizeof(texcacheheader);
+
+    texcache_put32(p, nummips);
+    p += sizeof(int32_t);
+
+    for (int level = 0; level < nummips; level++)
+    {
+        texcachemip const &mip = mips[level];
+        int32_t const pict[6] = { mip.pict.size, mip.pict.format, mip.pict.xdim, mip.pict.ydim, mip.pict.border, mip.pict.depth };
+
+        for (int i = 0; i < 6; i++, p += sizeof(int32_t))
+            texcache_put32(p, pict[i]);
+        for (int c = 0; c < TEXCACHECHUNKS; c++, p += sizeof(int32_t))
+            texcache_put32(p, mip.chunklen[c] ? mip.chunkofs[c] + headsiz : 0);
+        for (int c = 0; c < TEXCACHECHUNKS; c++, p += sizeof(int32_t))
+            texcache_put32(p, mip.chunklen[c]);
+    }
+}
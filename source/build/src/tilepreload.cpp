@@ -0,0 +1,453 @@
+// tilepreload.cpp
+//  Level load tile preloading on a thread pool, see tilepreload.h.
+
+#include "build.h"
+#include "cache1d.h"
+#include "classicstrips.h"
+#include "kplib.h"
+#include "libasync_config.h"
+#include "microprofile.h"
+#include "tilepreload.h"
+#include "vfs.h"
+
+#ifdef USE_OPENGL
+# include "hash.h"
+# include "polymost.h"
+# include "texcache.h"
+# ifdef POLYMER
+#  include "polymer.h"
+# endif
+#endif
+
+int32_t tilepreload_threads = 0;
+
+#define TILEPRELOAD_WINDOW    32         // tiles set up ahead of the one being finished
+#define TILEPRELOAD_MAXPICS   8          // replacement textures decoded for one tile
+#define TILEPRELOAD_MAXFILES  16         // loose replacement textures kept open for their views
+#define TILEPRELOAD_MAXBYTES  (16<<20)   // ART data in locked cache blocks at once
+
+typedef struct
+{
+    char const  *filename;
+    char const  *data;
+#ifdef USE_OPENGL
+    coltype     *pic;
+#endif
+    vec2_t       tsiz, siz;
+    int32_t      leng;
+    buildvfs_kfd fil;  // kept open while the view of a loose file is in use
+} preloadpic_t;
+
+typedef struct
+{
+    char const  *data;  // the tile's ART data, NULL if tileLoad() has to read it
+    int32_t      bytes;
+    int32_t      numpics;
+    preloadpic_t pics[TILEPRELOAD_MAXPICS];
+} preloadslot_t;
+
+static async::threadpool_scheduler *preloadpool;
+static int32_t preloadpoolthreads;
+
+static int16_t preloadtiles[MAXTILES];
+static uint8_t preloadflags[MAXTILES];
+static uint8_t preloadqueuedmap[(MAXTILES+7)>>3];
+static int32_t preloadnumqueued;
+
+// queue entries from preloadnext up to preloadsetup have a slot
+static int32_t preloadnext, preloadsetup;
+static int32_t preloadbytes, preloadopenfiles;
+
+static preloadslot_t     preloadslots[TILEPRELOAD_WINDOW];
+static async::task<void> preloadjobs[TILEPRELOAD_WINDOW];
+
+// the slot of the tile being passed to the game, -1 if none
+static int32_t preloadcurrent = -1;
+
+#ifdef USE_OPENGL
+static int32_t preloadtexcache;
+
+static bool tilepreload_precachedpal(int const pal)
+{
+    // the last regular palookup is the crosshair's, which the games skip
+    if (pal < MAXPALOOKUPS - RESERVEDPALS - 1)
+    {
+#ifdef POLYMER
+        if (videoGetRenderMode() == REND_POLYMER && polymer_havehighpalookup(0, pal))
+            return false;
+#endif
+        return palookup[pal] != NULL;
+    }
+
+#ifdef USE_GLEXT
+    if (pal == DETAILPAL)
+        return r_detailmapping;
+
+    if (pal == GLOWPAL)
+        return r_glowmapping;
+#endif
+#ifdef POLYMER
+    if (videoGetRenderMode() == REND_POLYMER)
+    {
+        if (pal == SPECULARPAL)
+            return pr_specularmapping;
+
+        if (pal == NORMALPAL)
+            return pr_normalmapping;
+    }
+#endif
+
+    return false;
+}
+
+// Whether polymost_precache(tilenum, pal, type) will find the texture either
+// uploaded already or in the texcache, so that decoding its picture would be
+// for nothing. This mirrors texcache_fetch() and gloadtile_hi().
+static bool tilepreload_havetexture(int const tilenum, int const pal, hicreplctyp const *const hicr, int32_t const leng, int const type)
+{
+    int const dameth = type * (DAMETH_CLAMPED|DAMETH_MASK);
+
+    for (auto pth = texcache.list[tilenum & (GLTEXCACHEADSIZ-1)]; pth; pth = pth->next)
+    {
+        if (pth->picnum == tilenum && pth->hicr == hicr &&
+            (pth->flags & (PTH_CLAMPED|PTH_HIGHTILE|PTH_INVALIDATED)) == (TO_PTH_CLAMPED(dameth)|PTH_HIGHTILE))
+            return true;
+    }
+
+    if (!preloadtexcache)
+        return false;
+
+    polytintflags_t const tintflags = hictinting[pal].f;
+    int const tintpal = (tintflags & HICTINT_APPLYOVERALTPAL) ? 0 : hicr->palnum;
+    char texcacheid[BMAX_PATH];
+
+    texcache_calcid(texcacheid, hicr->filename, leng + (pal << 8), DAMETH_NARROW_MASKPROPS(dameth),
+                    ((tintpal > 0) ? 0 : tintflags) & HICTINT_IN_MEMORY);
+
+    return texcache_findentry(texcacheid) != nullptr;
+}
+
+static void tilepreload_findpics(int const tilenum, int const hightile, preloadslot_t &slot)
+{
+    if (!hightile || !usehightile || videoGetRenderMode() < REND_POLYMOST || !in3dmode())
+        return;
+
+    for (int pal = 0; pal < MAXPALOOKUPS && slot.numpics < TILEPRELOAD_MAXPICS; pal++)
+    {
+        if (!tilepreload_precachedpal(pal))
+            continue;
+
+        auto const hicr = hicfindsubst(tilenum, pal, hictinting[pal].f & HICTINT_ALWAYSUSEART);
+
+        if (!hicr || !hicr->filename)
+            continue;
+
+        int i = 0;
+
+        while (i < slot.numpics && Bstrcmp(slot.pics[i].filename, hicr->filename))
+            i++;
+
+        if (i < slot.numpics)
+            continue;
+
+        auto &pic = slot.pics[slot.numpics];
+
+        pic.fil = kopen4load(hicr->filename, 0);
+
+        if (pic.fil == buildvfs_kfd_invalid)
+            continue;
+
+        pic.leng = kfilelength(pic.fil);
+
+        bool wanted = false;
+
+        for (int type = 0; type < 2 && !wanted; type++)
+            wanted = (hightile & (1 << type)) && !tilepreload_havetexture(tilenum, pal, hicr, pic.leng, type);
+
+        // views of files in groups and zips outlive their handles
+        if (wanted && (pic.data = (char const *)kfileview(pic.fil, &pic.leng, 0)))
+        {
+            kclose(pic.fil);
+            pic.fil = buildvfs_kfd_invalid;
+        }
+        else if (wanted && preloadopenfiles < TILEPRELOAD_MAXFILES && (pic.data = (char const *)kfileview(pic.fil, &pic.leng, 1)))
+            preloadopenfiles++;
+        else
+        {
+            kclose(pic.fil);
+            continue;
+        }
+
+        pic.filename = hicr->filename;
+        pic.pic = NULL;
+        slot.numpics++;
+    }
+}
+
+// runs on the workers
+static void tilepreload_decode(preloadpic_t &pic)
+{
+    vec2_t tsiz = { 0, 0 };
+
+    kpgetdim(pic.data, pic.leng, &tsiz.x, &tsiz.y);
+
+    // ART unit files and whatever else kplib doesn't know are left to polymost
+    if (tsiz.x <= 0 || tsiz.y <= 0)
+        return;
+
+    vec2_t siz = tsiz;
+
+    if (!glinfo.texnpot)
+    {
+        for (siz.x = 1; siz.x < tsiz.x; siz.x += siz.x) {}
+        for (siz.y = 1; siz.y < tsiz.y; siz.y += siz.y) {}
+    }
+
+    int32_t const bytesperline = siz.x * sizeof(coltype);
+    auto buf = (coltype *)Xcalloc(siz.y, bytesperline);
+
+    if (kprender(pic.data, pic.leng, (intptr_t)buf, bytesperline, siz.x, siz.y))
+    {
+        Xfree(buf);
+        return;
+    }
+
+    pic.tsiz = tsiz;
+    pic.siz  = siz;
+    pic.pic  = buf;
+}
+
+coltype *tilePreloadTakeHightile(char const *fn, int32_t leng, vec2_t *tsiz, vec2_t *siz)
+{
+    if (preloadcurrent < 0)
+        return NULL;
+
+    auto &slot = preloadslots[preloadcurrent];
+
+    for (int i = 0; i < slot.numpics; i++)
+    {
+        auto &pic = slot.pics[i];
+
+        if (!pic.pic || pic.leng != leng || Bstrcmp(pic.filename, fn))
+            continue;
+
+        auto const buf = pic.pic;
+
+        *tsiz = pic.tsiz;
+        *siz  = pic.siz;
+        pic.pic = NULL;
+
+        return buf;
+    }
+
+    return NULL;
+}
+#endif
+
+static void tilepreload_freepics(preloadslot_t &slot)
+{
+    for (int i = 0; i < slot.numpics; i++)
+    {
+        auto &pic = slot.pics[i];
+
+#ifdef USE_OPENGL
+        DO_FREE_AND_NULL(pic.pic);
+#endif
+        if (pic.fil != buildvfs_kfd_invalid)
+        {
+            kclose(pic.fil);
+            preloadopenfiles--;
+        }
+    }
+
+    slot.numpics = 0;
+}
+
+static void tilepreload_setup(void)
+{
+    for (; preloadsetup < preloadnumqueued && preloadsetup - preloadnext < TILEPRELOAD_WINDOW; preloadsetup++)
+    {
+        int const tilenum = preloadtiles[preloadsetup];
+        int32_t const dasiz = tilesiz[tilenum].x * tilesiz[tilenum].y;
+        int const slotnum = preloadsetup % TILEPRELOAD_WINDOW;
+        auto &slot = preloadslots[slotnum];
+
+        // let the window drain before locking up more of the cache
+        if (preloadsetup > preloadnext && preloadbytes + dasiz > TILEPRELOAD_MAXBYTES)
+            break;
+
+        slot.data    = NULL;
+        slot.bytes   = 0;
+        slot.numpics = 0;
+
+        if (waloff[tilenum] == 0 && dasiz > 0 && (slot.data = tileGetArtView(tilenum)))
+        {
+            // the allocation may evict tiles that queued strip draws still reference
+            classicStripsFlush();
+
+            // locked until tilePreloadRun() gets to it, so that nothing evicts
+            // the block while a worker is filling it
+            walock[tilenum] = CACHE1D_LOCKED;
+            g_cache.allocateBlock(&waloff[tilenum], dasiz, &walock[tilenum]);
+
+            slot.bytes = dasiz;
+            preloadbytes += dasiz;
+        }
+
+#ifdef USE_OPENGL
+        tilepreload_findpics(tilenum, preloadflags[preloadsetup], slot);
+#endif
+
+        if (!slot.data && !slot.numpics)
+            continue;
+
+        auto const dst = (char *)waloff[tilenum];
+
+        preloadjobs[slotnum] = async::spawn(*preloadpool, [&slot, dst, dasiz]()
+        {
+            MICROPROFILE_SCOPEI("Engine", "Tile preload", MP_AUTO);
+
+            if (slot.data)
+                Bmemcpy(dst, slot.data, dasiz);
+
+#ifdef USE_OPENGL
+            for (int i = 0; i < slot.numpics; i++)
+                tilepreload_decode(slot.pics[i]);
+#endif
+        });
+    }
+}
+
+// Waits for the tile at the head of the queue and does what tileLoad() would
+// have done after reading its data.
+static int tilepreload_finish(void)
+{
+    int const tilenum = preloadtiles[preloadnext];
+    int const slotnum = preloadnext % TILEPRELOAD_WINDOW;
+    auto &slot = preloadslots[slotnum];
+
+    if (preloadjobs[slotnum].valid())
+    {
+        preloadjobs[slotnum].wait();
+        preloadjobs[slotnum] = async::task<void>();
+    }
+
+    if (slot.data)
+    {
+        walock[tilenum] = CACHE1D_UNLOCKED;
+        preloadbytes -= slot.bytes;
+        slot.data = NULL;
+
+        // also throws out whatever a loading screen may have uploaded from
+        // the half-filled block in the meantime
+        tileLoadFinish(tilenum);
+    }
+    else if (waloff[tilenum] == 0)
+        tileLoad(tilenum);
+
+    return slotnum;
+}
+
+void tilePreloadBegin(void)
+{
+    tilePreloadEnd();
+
+    int32_t const numthreads = clamp(tilepreload_threads, 0, MAXTILEPRELOADTHREADS);
+
+    if (numthreads != preloadpoolthreads)
+    {
+        delete preloadpool;
+        preloadpool = numthreads > 0 ? new async::threadpool_scheduler(numthreads, []() { MicroProfileOnThreadCreate("Tile preload"); }, nullptr) : nullptr;
+        preloadpoolthreads = numthreads;
+    }
+
+#ifdef USE_OPENGL
+    preloadtexcache = videoGetRenderMode() >= REND_POLYMOST && texcache_enabled();
+#endif
+}
+
+void tilePreloadQueue(int32_t tilenum, int32_t hightile)
+{
+    if ((unsigned)tilenum >= (unsigned)MAXTILES)
+        return;
+
+    if (bitmap_test(preloadqueuedmap, tilenum))
+    {
+        // only while it's still waiting for a slot
+        for (int i = preloadsetup; i < preloadnumqueued; i++)
+            if (preloadtiles[i] == tilenum)
+                preloadflags[i] |= hightile;
+
+        return;
+    }
+
+    bitmap_set(preloadqueuedmap, tilenum);
+    preloadtiles[preloadnumqueued] = tilenum;
+    preloadflags[preloadnumqueued] = hightile;
+    preloadnumqueued++;
+}
+
+int32_t tilePreloadRun(tilepreloadfunc_t func, int32_t budget)
+{
+    MICROPROFILE_SCOPEI("Engine", EDUKE32_FUNCTION, MP_AUTO);
+
+    uint32_t const starttime = timerGetTicks();
+
+    while (preloadnext < preloadnumqueued)
+    {
+        int const tilenum = preloadtiles[preloadnext];
+
+        if (!preloadpool)
+        {
+            if (waloff[tilenum] == 0)
+                tileLoad(tilenum);
+
+            if (func)
+                func(tilenum, preloadflags[preloadnext]);
+
+            preloadnext++;
+        }
+        else
+        {
+            tilepreload_setup();
+
+            preloadcurrent = tilepreload_finish();
+
+            if (func)
+                func(tilenum, preloadflags[preloadnext]);
+
+            preloadnext++;
+
+            tilepreload_freepics(preloadslots[preloadcurrent]);
+            preloadcurrent = -1;
+        }
+
+        if (timerGetTicks() - starttime >= (uint32_t)budget)
+            break;
+    }
+
+    return preloadnumqueued - preloadnext;
+}
+
+void tilePreloadEnd(void)
+{
+    // the data of the tiles that were set up is in the cache already, so
+    // they may as well be finished
+    for (; preloadnext < preloadsetup; preloadnext++)
+        tilepreload_freepics(preloadslots[tilepreload_finish()]);
+
+    Bmemset(preloadqueuedmap, 0, sizeof(preloadqueuedmap));
+    preloadnumqueued = preloadnext = preloadsetup = 0;
+    preloadbytes = 0;
+
+    artReleaseViews();
+}
+
+void tilePreloadUninit(void)
+{
+    tilePreloadEnd();
+
+    delete preloadpool;
+    preloadpool        = nullptr;
+    preloadpoolthreads = 0;
+}
@@ -9,6 +9,7 @@
 #include "baselayer.h"
 #include "build.h"
 #include "cache1d.h"
+#include "classicstrips.h"
 #include "compat.h"
 #include "crc32.h"
 #include "engine_priv.h"
@@ -47,6 +48,18 @@ static int32_t mapartfnXXofs;  // byte offset to 'XX' (the number part) in the a
 static int32_t artfilnum, artfilplc;
 static buildvfs_kfd artfil;
 
+// ART files kept open for tileGetArtView()
+#define MAXARTVIEWS 16
+
+static struct
+{
+    buildvfs_kfd fil;
+    char const  *data;
+    int32_t      leng;
+    int32_t      tfn;
+} artview[MAXARTVIEWS];
+static int32_t numartviews;
+
 ////////// Per-map ART file loading //////////
 
 // Some forward declarations.
@@ -642,6 +655,9 @@ bool tileLoad(int16_t tileNum)
     // Allocate storage if necessary.
     if (waloff[tileNum] == 0)
     {
+        // the allocation may evict tiles that queued strip draws still reference
+        classicStripsFlush();
+
         walock[tileNum] = CACHE1D_UNLOCKED;
         g_cache.allocateBlock(&waloff[tileNum], dasiz, &walock[tileNum]);
     }
@@ -649,6 +665,13 @@ bool tileLoad(int16_t tileNum)
     if (!duke64 || !rt_tileload_callback || !rt_tileload_callback(tileNum))
         tileLoadData(tileNum, dasiz, (char *) waloff[tileNum]);
 
+    tileLoadFinish(tileNum);
+
+    return (waloff[tileNum] != 0 && tilesiz[tileNum].x > 0 && tilesiz[tileNum].y > 0);
+}
+
+void tileLoadFinish(int16_t tileNum)
+{
 #ifdef USE_OPENGL
     if (videoGetRenderMode() >= REND_POLYMOST &&
         in3dmode())
@@ -664,8 +687,58 @@ bool tileLoad(int16_t tileNum)
 #endif
 
     tilePostLoad(tileNum);
+}
 
-    return (waloff[tileNum] != 0 && tilesiz[tileNum].x > 0 && tilesiz[tileNum].y > 0);
+char const *tileGetArtView(int16_t tilenume)
+{
+    if ((unsigned)tilenume >= (unsigned)MAXTILES || rottile[tilenume].owner != -1 || bitmap_test(faketile, tilenume)
+        || (duke64 && rt_tileload_callback))
+        return NULL;
+
+    int const dasiz = tilesiz[tilenume].x * tilesiz[tilenume].y;
+    int const tfn   = tilefilenum[tilenume];
+
+    if (dasiz <= 0 || tilefileoffs[tilenume] < 0)
+        return NULL;
+
+    int i = 0;
+
+    for (; i < numartviews; i++)
+        if (artview[i].tfn == tfn)
+            break;
+
+    if (i == numartviews)
+    {
+        if (numartviews == MAXARTVIEWS)
+            return NULL;
+
+        auto &view = artview[numartviews++];
+
+        view.tfn  = tfn;
+        view.data = NULL;
+        view.leng = 0;
+        view.fil  = kopen4loadfrommod(artGetIndexedFileName(tfn), 0);
+
+        // loose files are only mapped for as long as they stay open
+        if (view.fil != buildvfs_kfd_invalid)
+            view.data = (char const *)kfileview(view.fil, &view.leng, 1);
+    }
+
+    auto const &view = artview[i];
+
+    if (!view.data || tilefileoffs[tilenume] + dasiz > view.leng)
+        return NULL;
+
+    return view.data + tilefileoffs[tilenume];
+}
+
+void artReleaseViews(void)
+{
+    for (int i = 0; i < numartviews; i++)
+        if (artview[i].fil != buildvfs_kfd_invalid)
+            kclose(artview[i].fil);
+
+    numartviews = 0;
 }
 
 void tileMaybeRotate(int16_t tilenume)
@@ -738,6 +811,16 @@ void tileLoadData(int16_t tilenume, int32_t dasiz, char *buffer)
         faketimerhandler();
     }
 
+    int32_t artleng;
+    auto const artview = (char const *)kfileview(artfil, &artleng, 1);
+
+    if (artview && tilefileoffs[tilenume] >= 0 && tilefileoffs[tilenume] + dasiz <= artleng)
+    {
+        Bmemcpy(buffer, artview + tilefileoffs[tilenume], dasiz);
+        faketimerhandler();
+        return;
+    }
+
     // Seek to the right position.
     if (artfilplc != tilefileoffs[tilenume])
     {
@@ -15,6 +15,17 @@
 #include "vfs.h"
 #include "cache1d.h"
 
+#ifndef USE_PHYSFS
+#include "mio.hpp"
+
+// mio uses OS file handles on Windows and regular int file descriptors elsewhere
+#ifdef _WIN32
+# define MIO_HANDLE_FROM_FD(fd) (mio::file_handle_type)(_get_osfhandle(fd))
+#else
+# define MIO_HANDLE_FROM_FD(fd) (mio::file_handle_type)(fd)
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -129,6 +140,7 @@ typedef struct _searchpath
 static searchpath_t *searchpathhead = NULL;
 static size_t maxsearchpathlen = 0;
 int32_t pathsearchmode = 0;
+int32_t kfileview_enabled = 1;
 
 #ifndef USE_PHYSFS
 
@@ -465,6 +477,15 @@ static intptr_t filehan[MAXOPENFILES] =
     -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
 };
 
+// read-only mappings handed out by kfileview(), made on first use
+#define MAXZIPMAPS 16
+
+static mio::mmap_source groupmap[MAXGROUPFILES];
+static mio::mmap_source filemap[MAXOPENFILES];
+
+static char *zipmapname[MAXZIPMAPS];
+static mio::mmap_source zipmap[MAXZIPMAPS];
+
 #ifdef WITHKPLIB
 static char filenamsav[MAXOPENFILES][260];
 static int32_t kzcurhand = -1;
@@ -663,11 +684,18 @@ void uninitgroupfile(void)
             DO_FREE_AND_NULL(gfileoffs[i]);
             DO_FREE_AND_NULL(groupname[i]);
 
+            groupmap[i].unmap();
             Bclose(groupfil[i]);
             groupfil[i] = -1;
         }
     numgroupfiles = 0;
 
+    for (i=0; i<MAXZIPMAPS; i++)
+    {
+        DO_FREE_AND_NULL(zipmapname[i]);
+        zipmap[i].unmap();
+    }
+
     // JBF 20040111: "close" any files open in groups
     for (i=0; i<MAXOPENFILES; i++)
     {
@@ -1017,7 +1045,12 @@ int32_t ktell_internal(int32_t handle, const uint8_t *arraygrp, intptr_t *arrayh
 void kclose_internal(int32_t handle, const uint8_t *arraygrp, intptr_t *arrayhan)
 {
     if (handle < 0) return;
-    if (arraygrp[handle] == GRP_FILESYSTEM) Bclose(arrayhan[handle]);
+    if (arraygrp[handle] == GRP_FILESYSTEM)
+    {
+        if (arrayhan == filehan)
+            filemap[handle].unmap();
+        Bclose(arrayhan[handle]);
+    }
 #ifdef WITHKPLIB
     else if (arraygrp[handle] == GRP_ZIP)
     {
@@ -1049,6 +1082,89 @@ void kclose(int32_t handle)
     return kclose_internal(handle, filegrp, filehan);
 }
 
+static void const *kfileview_map(mio::mmap_source &map, intptr_t const fd, int32_t const offset, int32_t const leng)
+{
+    if (!map.is_open())
+    {
+        std::error_code error;
+        map.map(MIO_HANDLE_FROM_FD(fd), 0, mio::map_entire_file, error);
+
+        if (error)
+        {
+            map.unmap();
+            return NULL;
+        }
+    }
+
+    if (offset < 0 || leng <= 0 || (size_t)offset + leng > map.mapped_length())
+        return NULL;
+
+    return map.data() + offset;
+}
+
+void const *kfileview(buildvfs_kfd handle, int32_t *length, int32_t loose)
+{
+    if (!kfileview_enabled || (unsigned)handle >= MAXOPENFILES || filehan[handle] == -1)
+        return NULL;
+
+    int32_t const groupnum = filegrp[handle];
+    int32_t const leng = *length = kfilelength(handle);
+
+    if (groupnum == GRP_FILESYSTEM)
+        return loose ? kfileview_map(filemap[handle], filehan[handle], 0, leng) : NULL;
+#ifdef WITHKPLIB
+    else if (groupnum == GRP_ZIP)
+    {
+        // kfilelength() made the handle the open one
+        char const *const zipnam = kzstoredin();
+
+        if (!zipnam)
+            return NULL;
+
+        int i = 0;
+
+        for (; i < MAXZIPMAPS && zipmapname[i]; i++)
+            if (!Bstrcmp(zipmapname[i], zipnam))
+                break;
+
+        if (i == MAXZIPMAPS)
+            return NULL;
+
+        if (!zipmapname[i])
+        {
+            std::error_code error;
+            zipmap[i].map(zipnam, 0, mio::map_entire_file, error);
+
+            if (error)
+            {
+                zipmap[i].unmap();
+                return NULL;
+            }
+
+            zipmapname[i] = Xstrdup(zipnam);
+        }
+
+        if (kzfs.seek0 < 0 || leng <= 0 || (size_t)kzfs.seek0 + leng > zipmap[i].mapped_length())
+            return NULL;
+
+        return zipmap[i].data() + kzfs.seek0;
+    }
+#endif
+
+    if (EDUKE32_PREDICT_FALSE(groupfil[groupnum] == -1))
+        return NULL;
+
+    int32_t rootgroupnum = groupnum;
+    int32_t offset = gfileoffs[groupnum][filehan[handle]];
+    while (groupfilgrp[rootgroupnum] != GRP_FILESYSTEM)
+    {
+        offset += gfileoffs[groupfilgrp[rootgroupnum]][groupfil[rootgroupnum]];
+        rootgroupnum = groupfilgrp[rootgroupnum];
+    }
+
+    return kfileview_map(groupmap[rootgroupnum], groupfil[rootgroupnum], offset, leng);
+}
+
 static int32_t kread_grp(int32_t handle, void *buffer, int32_t leng)
 {
     return kread_internal(handle, buffer, leng, groupfilgrp, groupfil, groupfilpos);
@@ -10,31 +10,64 @@
 #include "glad/glad.h"
 #include "hightile.h"
 #include "kplib.h"
+#include "libasync_config.h"
 #include "mdsprite.h"
+#include "microprofile.h"
 #include "palette.h"
 #include "polymost.h"
 #include "pragmas.h"
 #include "texcache.h"
 #include "vfs.h"
+#include "xxhash.h"
 
-//For loading/conversion only
-static vec3_t voxsiz;
-static int32_t yzsiz, *vbit = 0; //vbit: 1 bit per voxel: 0=air,1=solid
-static vec3f_t voxpiv;
+// change to stop using the voxel models older versions put in the texture cache
+#define VOXCACHEVERSION 1
 
-static int32_t *vcolhashead = 0, vcolhashsizm1;
-typedef struct { int32_t p, c, n; } voxcol_t;
-static voxcol_t *vcol = 0; int32_t vnum = 0, vmax = 0;
+// the largest dimension of a model
+#define VOXMAXSIZ 1024
+
+int32_t r_voxelgreedymesh = 1;
+int32_t r_voxelthreads = 4;
+
+static async::threadpool_scheduler *voxpool;
+static int32_t voxpoolthreads;
 
+typedef struct { int32_t p, c, n; } voxcol_t;
 typedef struct { int16_t x, y; } spoint2d;
-static spoint2d *shp;
-static int32_t *shcntmal, *shcnt = 0, shcntp;
 
-static int32_t mytexo5, *zbit, gmaxx, gmaxy, garea, pow2m1[33];
-static voxmodel_t *gvox;
-static voxrect_t *gquad;
-static int32_t gqfacind[7];
+//For loading/conversion only: everything converting one model uses, so that
+//several models can be converted at the same time
+typedef struct
+{
+    vec3_t voxsiz;
+    int32_t yzsiz, *vbit; //vbit: 1 bit per voxel: 0=air,1=solid
+    vec3f_t voxpiv;
+
+    int32_t *vcolhashead, vcolhashsizm1;
+    voxcol_t *vcol;
+    int32_t vnum, vmax;
+
+    spoint2d *shp;
+    int32_t *shcntmal, *shcnt, shcntp;
+
+    int32_t mytexo5, *zbit, gmaxx, gmaxy, garea;
+    voxmodel_t *gvox;
+    voxrect_t *gquad;
+    int32_t gqfacind[7];
+
+    int32_t greedy;
+    uint32_t randseed;
+} voxconv_t;
 
+typedef void (*daquad_t)(voxconv_t *, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t,
+                         int32_t, int32_t, int32_t, int32_t);
+
+enum
+{
+    VOXFMT_VOX,
+    VOXFMT_KVX,
+    VOXFMT_KV6,
+};
 
 //pitch must equal xsiz*4
 uint32_t gloadtex_indexed(const int32_t *picbuf, int32_t xsiz, int32_t ysiz)
@@ -119,30 +152,44 @@ uint32_t gloadtex(const int32_t *picbuf, int32_t xsiz, int32_t ysiz, int32_t is8
     return rtexid;
 }
 
-static int32_t getvox(int32_t x, int32_t y, int32_t z)
+static FORCE_INLINE int32_t pow2m1(int32_t i)
+{
+    return i < 32 ? (int32_t)((1u<<i)-1) : -1;
+}
+
+//The same numbers for every model, unlike rand(), so that a model always gets the same skin
+static int32_t voxrand(voxconv_t *vc)
+{
+    vc->randseed = vc->randseed*214013 + 2531011;
+    return (vc->randseed>>16)&32767;
+}
+
+static int32_t getvox(voxconv_t *vc, int32_t x, int32_t y, int32_t z)
 {
-    z += x*yzsiz + y*voxsiz.z;
+    z += x*vc->yzsiz + y*vc->voxsiz.z;
 
-    for (x=vcolhashead[(z*214013LL)&vcolhashsizm1]; x>=0; x=vcol[x].n)
-        if (vcol[x].p == z)
-            return vcol[x].c;
+    for (x=vc->vcolhashead[(z*214013LL)&vc->vcolhashsizm1]; x>=0; x=vc->vcol[x].n)
+        if (vc->vcol[x].p == z)
+            return vc->vcol[x].c;
 
     return 0x808080;
 }
 
-static void putvox(int32_t x, int32_t y, int32_t z, int32_t col)
+static void putvox(voxconv_t *vc, int32_t x, int32_t y, int32_t z, int32_t col)
 {
-    if (vnum >= vmax)
+    if (vc->vnum >= vc->vmax)
     {
-        vmax = max(vmax<<1, 4096);
-        vcol = (voxcol_t *)Xrealloc(vcol, vmax*sizeof(voxcol_t));
+        vc->vmax = max(vc->vmax<<1, 4096);
+        vc->vcol = (voxcol_t *)Xrealloc(vc->vcol, vc->vmax*sizeof(voxcol_t));
     }
 
-    z += x*yzsiz + y*voxsiz.z;
+    z += x*vc->yzsiz + y*vc->voxsiz.z;
 
-    vcol[vnum].p = z; z = (z*214013LL)&vcolhashsizm1;
-    vcol[vnum].c = col;
-    vcol[vnum].n = vcolhashead[z]; vcolhashead[z] = vnum++;
+    voxcol_t &vcol = vc->vcol[vc->vnum];
+
+    vcol.p = z; z = (z*214013LL)&vc->vcolhashsizm1;
+    vcol.c = col;
+    vcol.n = vc->vcolhashead[z]; vc->vcolhashead[z] = vc->vnum++;
 }
 
 //Set all bits in vbit from (x,y,z0) to (x,y,z1-1) to 0's
@@ -166,20 +213,22 @@ static void setzrange1(int32_t *lptr, int32_t z0, int32_t z1)
     lptr[z] |=~-(1<<SHIFTMOD32(z1));
 }
 
-static int32_t isrectfree(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
+static int32_t isrectfree(voxconv_t *vc, int32_t x0, int32_t y0, int32_t dx, int32_t dy)
 {
 #if 0
     int32_t i, j, x;
-    i = y0*gvox->mytexx + x0;
-    for (dy=0; dy; dy--, i+=gvox->mytexx)
-        for (x=0; x<dx; x++) { j = i+x; if (zbit[j>>5]&(1<<SHIFTMOD32(j))) return 0; }
+    i = y0*vc->gvox->mytexx + x0;
+    for (dy=0; dy; dy--, i+=vc->gvox->mytexx)
+        for (x=0; x<dx; x++) { j = i+x; if (vc->zbit[j>>5]&(1<<SHIFTMOD32(j))) return 0; }
 #else
+    int32_t const *const zbit = vc->zbit;
+    int32_t const mytexo5 = vc->mytexo5;
     int32_t i = y0*mytexo5 + (x0>>5);
     dx += x0-1;
     const int32_t c = (dx>>5) - (x0>>5);
 
-    int32_t m = ~pow2m1[x0&31];
-    const int32_t m1 = pow2m1[(dx&31)+1];
+    int32_t m = ~pow2m1(x0&31);
+    const int32_t m1 = pow2m1((dx&31)+1);
 
     if (!c)
     {
@@ -207,20 +256,22 @@ static int32_t isrectfree(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
     return 1;
 }
 
-static void setrect(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
+static void setrect(voxconv_t *vc, int32_t x0, int32_t y0, int32_t dx, int32_t dy)
 {
 #if 0
     int32_t i, j, y;
-    i = y0*gvox->mytexx + x0;
-    for (y=0; y<dy; y++, i+=gvox->mytexx)
-        for (x=0; x<dx; x++) { j = i+x; zbit[j>>5] |= (1<<SHIFTMOD32(j)); }
+    i = y0*vc->gvox->mytexx + x0;
+    for (y=0; y<dy; y++, i+=vc->gvox->mytexx)
+        for (x=0; x<dx; x++) { j = i+x; vc->zbit[j>>5] |= (1<<SHIFTMOD32(j)); }
 #else
+    int32_t *const zbit = vc->zbit;
+    int32_t const mytexo5 = vc->mytexo5;
     int32_t i = y0*mytexo5 + (x0>>5);
     dx += x0-1;
     const int32_t c = (dx>>5) - (x0>>5);
 
-    int32_t m = ~pow2m1[x0&31];
-    const int32_t m1 = pow2m1[(dx&31)+1];
+    int32_t m = ~pow2m1(x0&31);
+    const int32_t m1 = pow2m1((dx&31)+1);
 
     if (!c)
     {
@@ -243,7 +294,7 @@ static void setrect(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
 #endif
 }
 
-static void cntquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
+static void cntquad(voxconv_t *vc, int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
                     int32_t x2, int32_t y2, int32_t z2, int32_t face)
 {
     UNREFERENCED_PARAMETER(x1);
@@ -260,18 +311,20 @@ static void cntquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
 
     if (x < y) { z = x; x = y; y = z; }
 
-    shcnt[y*shcntp+x]++;
+    vc->shcnt[y*vc->shcntp+x]++;
 
-    if (x > gmaxx) gmaxx = x;
-    if (y > gmaxy) gmaxy = y;
+    if (x > vc->gmaxx) vc->gmaxx = x;
+    if (y > vc->gmaxy) vc->gmaxy = y;
 
-    garea += (x+(VOXBORDWIDTH<<1)) * (y+(VOXBORDWIDTH<<1));
-    gvox->qcnt++;
+    vc->garea += (x+(VOXBORDWIDTH<<1)) * (y+(VOXBORDWIDTH<<1));
+    vc->gvox->qcnt++;
 }
 
-static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
+static void addquad(voxconv_t *vc, int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
                     int32_t x2, int32_t y2, int32_t z2, int32_t face)
 {
+    voxmodel_t *const gvox = vc->gvox;
+    spoint2d const *const shp = vc->shp;
     int32_t i;
     int32_t x = labs(x2-x0), y = labs(y2-y0), z = labs(z2-z0);
 
@@ -281,7 +334,7 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
 
     if (x < y) { z = x; x = y; y = z; i += 3; }
 
-    z = shcnt[y*shcntp+x]++;
+    z = vc->shcnt[y*vc->shcntp+x]++;
     int32_t *lptr = &gvox->mytex[(shp[z].y+VOXBORDWIDTH)*gvox->mytexx +
                                  (shp[z].x+VOXBORDWIDTH)];
     int32_t nx = 0, ny = 0, nz = 0;
@@ -333,7 +386,7 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
                 break;
             }
 
-            lptr[xx] = getvox(nx, ny, nz);
+            lptr[xx] = getvox(vc, nx, ny, nz);
         }
 
     //Extend borders horizontally
@@ -356,7 +409,7 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
                 (x+(VOXBORDWIDTH<<1))<<2);
     }
 
-    voxrect_t *const qptr = &gquad[gvox->qcnt];
+    voxrect_t *const qptr = &vc->gquad[gvox->qcnt];
 
     qptr->v[0].x = x0; qptr->v[0].y = y0; qptr->v[0].z = z0;
     qptr->v[1].x = x1; qptr->v[1].y = y1; qptr->v[1].z = z1;
@@ -382,26 +435,26 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
     qptr->v[3].y = qptr->v[0].y - qptr->v[1].y + qptr->v[2].y;
     qptr->v[3].z = qptr->v[0].z - qptr->v[1].z + qptr->v[2].z;
 
-    if (gqfacind[face] < 0)
-        gqfacind[face] = gvox->qcnt;
+    if (vc->gqfacind[face] < 0)
+        vc->gqfacind[face] = gvox->qcnt;
 
     gvox->qcnt++;
 }
 
-static inline int32_t isolid(int32_t x, int32_t y, int32_t z)
+static inline int32_t isolid(voxconv_t const *vc, int32_t x, int32_t y, int32_t z)
 {
-    if ((uint32_t)x >= (uint32_t)voxsiz.x) return 0;
-    if ((uint32_t)y >= (uint32_t)voxsiz.y) return 0;
-    if ((uint32_t)z >= (uint32_t)voxsiz.z) return 0;
+    if ((uint32_t)x >= (uint32_t)vc->voxsiz.x) return 0;
+    if ((uint32_t)y >= (uint32_t)vc->voxsiz.y) return 0;
+    if ((uint32_t)z >= (uint32_t)vc->voxsiz.z) return 0;
 
-    z += x*yzsiz + y*voxsiz.z;
+    z += x*vc->yzsiz + y*vc->voxsiz.z;
 
-    return vbit[z>>5] & (1<<SHIFTMOD32(z));
+    return vc->vbit[z>>5] & (1<<SHIFTMOD32(z));
 }
 
-static FORCE_INLINE int isair(int32_t i)
+static FORCE_INLINE int isair(voxconv_t const *vc, int32_t i)
 {
-    return !(vbit[i>>5] & (1<<SHIFTMOD32(i)));
+    return !(vc->vbit[i>>5] & (1<<SHIFTMOD32(i)));
 }
 
 #ifdef USE_GLEXT
@@ -433,12 +486,195 @@ void voxvbofree(voxmodel_t *vm)
 }
 #endif
 
-static voxmodel_t *vox2poly()
+//Covers the faces of each row of voxels with strips, merging the strips of neighboring rows
+//only where they begin and end at the same places
+static void stripquads(voxconv_t *vc, daquad_t daquad)
+{
+    vec3_t const voxsiz = vc->voxsiz;
+    int32_t i = (max(voxsiz.y, voxsiz.z)+1)<<2;
+    int32_t *const bx0 = (int32_t *)Xmalloc(i<<1);
+    int32_t *const by0 = (int32_t *)(((intptr_t)bx0)+i);
+
+    int32_t ov, oz=0;
+
+    memset(by0, -1, (max(voxsiz.y, voxsiz.z)+1)<<2);
+    int32_t v = 0;
+
+    for (i=-1; i<=1; i+=2)
+        for (bssize_t y=0; y<voxsiz.y; y++)
+            for (bssize_t x=0; x<=voxsiz.x; x++)
+                for (bssize_t z=0; z<=voxsiz.z; z++)
+                {
+                    ov = v; v = (isolid(vc, x, y, z) && (!isolid(vc, x, y+i, z)));
+                    if ((by0[z] >= 0) && ((by0[z] != oz) || (v >= ov)))
+                    {
+                        daquad(vc, bx0[z], y, by0[z], x, y, by0[z], x, y, z, i>=0);
+                        by0[z] = -1;
+                    }
+
+                    if (v > ov) oz = z;
+                    else if ((v < ov) && (by0[z] != oz)) { bx0[z] = x; by0[z] = oz; }
+                }
+
+    for (i=-1; i<=1; i+=2)
+        for (bssize_t z=0; z<voxsiz.z; z++)
+            for (bssize_t x=0; x<=voxsiz.x; x++)
+                for (bssize_t y=0; y<=voxsiz.y; y++)
+                {
+                    ov = v; v = (isolid(vc, x, y, z) && (!isolid(vc, x, y, z-i)));
+                    if ((by0[y] >= 0) && ((by0[y] != oz) || (v >= ov)))
+                    {
+                        daquad(vc, bx0[y], by0[y], z, x, by0[y], z, x, y, z, (i>=0)+2);
+                        by0[y] = -1;
+                    }
+
+                    if (v > ov) oz = y;
+                    else if ((v < ov) && (by0[y] != oz)) { bx0[y] = x; by0[y] = oz; }
+                }
+
+    for (i=-1; i<=1; i+=2)
+        for (bssize_t x=0; x<voxsiz.x; x++)
+            for (bssize_t y=0; y<=voxsiz.y; y++)
+                for (bssize_t z=0; z<=voxsiz.z; z++)
+                {
+                    ov = v; v = (isolid(vc, x, y, z) && (!isolid(vc, x-i, y, z)));
+                    if ((by0[z] >= 0) && ((by0[z] != oz) || (v >= ov)))
+                    {
+                        daquad(vc, x, bx0[z], by0[z], x, y, by0[z], x, y, z, (i>=0)+4);
+                        by0[z] = -1;
+                    }
+
+                    if (v > ov) oz = z;
+                    else if ((v < ov) && (by0[z] != oz)) { bx0[z] = y; by0[z] = oz; }
+                }
+
+    Xfree(bx0);
+}
+
+//Finds rectangles covering the faces set in mask, a slice of rows*cols of them, greedily: each one
+//starts at the first face not covered yet, takes the run of faces from there and then every
+//following row that has all of the faces of that run, whatever else the row has. Goes down the
+//columns instead if bycols is set. Stores the rectangles as r0,c0,r1,c1 in rects, clears mask
+//and returns how many there are.
+static int32_t greedyslice(char *mask, int32_t rows, int32_t cols, int32_t bycols, int32_t *rects)
+{
+    //the slice as numlines lines of linelen faces, one face being linestep from the next in a line
+    int32_t const numlines = bycols ? cols : rows, linelen = bycols ? rows : cols;
+    int32_t const linestep = bycols ? cols : 1, nextline = bycols ? 1 : cols;
+    int32_t num = 0;
+
+    for (int32_t l0=0; l0<numlines; l0++)
+    {
+        char *const line = &mask[l0*nextline];
+
+        for (int32_t f0=0; f0<linelen; f0++)
+        {
+            if (!line[f0*linestep])
+                continue;
+
+            int32_t f1 = f0+1, l1 = l0+1;
+
+            while (f1 < linelen && line[f1*linestep])
+                f1++;
+
+            for (; l1<numlines; l1++)
+            {
+                char const *const nline = &mask[l1*nextline];
+                int32_t f = f0;
+
+                while (f < f1 && nline[f*linestep])
+                    f++;
+
+                if (f < f1)
+                    break;
+            }
+
+            for (int32_t l=l0; l<l1; l++)
+                for (int32_t f=f0; f<f1; f++)
+                    mask[l*nextline + f*linestep] = 0;
+
+            int32_t *const r = &rects[(num++)<<2];
+
+            if (bycols) { r[0] = f0; r[1] = l0; r[2] = f1; r[3] = l1; }
+            else { r[0] = l0; r[1] = f0; r[2] = l1; r[3] = f1; }
+
+            f0 = f1;
+        }
+    }
+
+    return num;
+}
+
+//Covers the faces of each slice of voxels with rectangles found by greedyslice(), going along
+//the rows or down the columns of the slice, whichever needs fewer. Makes the same faces as
+//stripquads(), in the same order of directions, with fewer quads.
+static void greedyquads(voxconv_t *vc, daquad_t daquad)
 {
-    gvox = (voxmodel_t *)Xcalloc(1, sizeof(voxmodel_t));
+    vec3_t const voxsiz = vc->voxsiz;
+    int32_t const slicesiz = max(voxsiz.x*max(voxsiz.y, voxsiz.z), voxsiz.y*voxsiz.z);
+    char *const mask = (char *)Xmalloc(slicesiz<<1);
+    char *const mask2 = mask + slicesiz;
+    int32_t *const rects = (int32_t *)Xmalloc(slicesiz*sizeof(int32_t)*4*2);
+    int32_t *const rects2 = rects + slicesiz*4;
+
+    //the slices of axis 1 are the y faces, which stripquads() does first
+    static const int32_t axes[3] = { 1, 2, 0 };
+
+    for (int32_t const axis : axes)
+    {
+        //each slice has rows*cols faces, see the daquad() calls
+        int32_t const numslices = axis == 0 ? voxsiz.x : axis == 1 ? voxsiz.y : voxsiz.z;
+        int32_t const rows = axis == 0 ? voxsiz.y : voxsiz.x;
+        int32_t const cols = axis == 2 ? voxsiz.y : voxsiz.z;
+
+        for (int32_t i=-1; i<=1; i+=2)
+        {
+            int32_t const face = (i>=0) + (axis == 1 ? 0 : axis == 2 ? 2 : 4);
+
+            for (int32_t s=0; s<numslices; s++)
+            {
+                for (int32_t r=0, m=0; r<rows; r++)
+                    for (int32_t c=0; c<cols; c++, m++)
+                    {
+                        switch (axis)
+                        {
+                        case 0: mask[m] = isolid(vc, s, r, c) && !isolid(vc, s-i, r, c); break;
+                        case 1: mask[m] = isolid(vc, r, s, c) && !isolid(vc, r, s+i, c); break;
+                        case 2: mask[m] = isolid(vc, r, c, s) && !isolid(vc, r, c, s-i); break;
+                        }
+                    }
+
+                Bmemcpy(mask2, mask, rows*cols);
+
+                int32_t num = greedyslice(mask, rows, cols, 0, rects);
+                int32_t const num2 = greedyslice(mask2, rows, cols, 1, rects2);
+                int32_t const *const r = num2 < num ? rects2 : rects;
+
+                num = min(num, num2);
+
+                for (int32_t j=0; j<num<<2; j+=4)
+                {
+                    switch (axis)
+                    {
+                    case 0: daquad(vc, s, r[j], r[j+1], s, r[j+2], r[j+1], s, r[j+2], r[j+3], face); break;
+                    case 1: daquad(vc, r[j], s, r[j+1], r[j+2], s, r[j+1], r[j+2], s, r[j+3], face); break;
+                    case 2: daquad(vc, r[j], r[j+1], s, r[j+2], r[j+1], s, r[j+2], r[j+3], s, face); break;
+                    }
+                }
+            }
+        }
+    }
+
+    Xfree(rects);
+    Xfree(mask);
+}
+
+static voxmodel_t *vox2poly(voxconv_t *vc)
+{
+    voxmodel_t *const gvox = vc->gvox = (voxmodel_t *)Xcalloc(1, sizeof(voxmodel_t));
 
     //x is largest dimension, y is 2nd largest dimension
-    int32_t x = voxsiz.x, y = voxsiz.y, z = voxsiz.z;
+    int32_t x = vc->voxsiz.x, y = vc->voxsiz.y, z = vc->voxsiz.z;
 
     if (x < y && x < z)
         x = z;
@@ -452,92 +688,31 @@ static voxmodel_t *vox2poly()
         y = z;
     }
 
-    shcntp = x;
+    vc->shcntp = x;
     int32_t i = x*y*sizeof(int32_t);
 
-    shcntmal = (int32_t *)Xmalloc(i);
-    memset(shcntmal, 0, i);
-    shcnt = &shcntmal[-shcntp-1];
-
-    gmaxx = gmaxy = garea = 0;
+    vc->shcntmal = (int32_t *)Xmalloc(i);
+    memset(vc->shcntmal, 0, i);
+    vc->shcnt = &vc->shcntmal[-vc->shcntp-1];
 
-    if (pow2m1[32] != -1)
-    {
-        for (i=0; i<32; i++)
-            pow2m1[i] = (1u<<i)-1;
-        pow2m1[32] = -1;
-    }
+    vc->gmaxx = vc->gmaxy = vc->garea = 0;
 
     for (i=0; i<7; i++)
-        gqfacind[i] = -1;
+        vc->gqfacind[i] = -1;
 
-    i = (max(voxsiz.y, voxsiz.z)+1)<<2;
-    int32_t *const bx0 = (int32_t *)Xmalloc(i<<1);
-    int32_t *const by0 = (int32_t *)(((intptr_t)bx0)+i);
-
-    int32_t ov, oz=0;
+    int32_t *const shcnt = vc->shcnt;
+    int32_t const shcntp = vc->shcntp;
 
     for (bssize_t cnt=0; cnt<2; cnt++)
     {
-        void (*daquad)(int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t) =
-            cnt == 0 ? cntquad : addquad;
-
         gvox->qcnt = 0;
 
-        memset(by0, -1, (max(voxsiz.y, voxsiz.z)+1)<<2);
-        int32_t v = 0;
-
-        for (i=-1; i<=1; i+=2)
-            for (bssize_t y=0; y<voxsiz.y; y++)
-                for (bssize_t x=0; x<=voxsiz.x; x++)
-                    for (bssize_t z=0; z<=voxsiz.z; z++)
-                    {
-                        ov = v; v = (isolid(x, y, z) && (!isolid(x, y+i, z)));
-                        if ((by0[z] >= 0) && ((by0[z] != oz) || (v >= ov)))
-                        {
-                            daquad(bx0[z], y, by0[z], x, y, by0[z], x, y, z, i>=0);
-                            by0[z] = -1;
-                        }
-
-                        if (v > ov) oz = z;
-                        else if ((v < ov) && (by0[z] != oz)) { bx0[z] = x; by0[z] = oz; }
-                    }
-
-        for (i=-1; i<=1; i+=2)
-            for (bssize_t z=0; z<voxsiz.z; z++)
-                for (bssize_t x=0; x<=voxsiz.x; x++)
-                    for (bssize_t y=0; y<=voxsiz.y; y++)
-                    {
-                        ov = v; v = (isolid(x, y, z) && (!isolid(x, y, z-i)));
-                        if ((by0[y] >= 0) && ((by0[y] != oz) || (v >= ov)))
-                        {
-                            daquad(bx0[y], by0[y], z, x, by0[y], z, x, y, z, (i>=0)+2);
-                            by0[y] = -1;
-                        }
-
-                        if (v > ov) oz = y;
-                        else if ((v < ov) && (by0[y] != oz)) { bx0[y] = x; by0[y] = oz; }
-                    }
-
-        for (i=-1; i<=1; i+=2)
-            for (bssize_t x=0; x<voxsiz.x; x++)
-                for (bssize_t y=0; y<=voxsiz.y; y++)
-                    for (bssize_t z=0; z<=voxsiz.z; z++)
-                    {
-                        ov = v; v = (isolid(x, y, z) && (!isolid(x-i, y, z)));
-                        if ((by0[z] >= 0) && ((by0[z] != oz) || (v >= ov)))
-                        {
-                            daquad(x, bx0[z], by0[z], x, y, by0[z], x, y, z, (i>=0)+4);
-                            by0[z] = -1;
-                        }
-
-                        if (v > ov) oz = z;
-                        else if ((v < ov) && (by0[z] != oz)) { bx0[z] = y; by0[z] = oz; }
-                    }
+        (vc->greedy ? greedyquads : stripquads)(vc, cnt == 0 ? cntquad : addquad);
 
         if (!cnt)
         {
-            shp = (spoint2d *)Xmalloc(gvox->qcnt*sizeof(spoint2d));
+            spoint2d *const shp = vc->shp = (spoint2d *)Xmalloc(gvox->qcnt*sizeof(spoint2d));
+            int32_t const gmaxx = vc->gmaxx, gmaxy = vc->gmaxy;
 
             int32_t sc = 0;
 
@@ -560,7 +735,7 @@ static voxmodel_t *vox2poly()
             for (gvox->mytexy=32; gvox->mytexy<(gmaxy+(VOXBORDWIDTH<<1)); gvox->mytexy<<=1)
                 /* do_nothing */;
 
-            while (gvox->mytexx*gvox->mytexy*8 < garea*9) //This should be sufficient to fit most skins...
+            while (gvox->mytexx*gvox->mytexy*8 < vc->garea*9) //This should be sufficient to fit most skins...
             {
 skindidntfit:
                 if (gvox->mytexx <= gvox->mytexy)
@@ -569,13 +744,13 @@ skindidntfit:
                     gvox->mytexy <<= 1;
             }
 
-            mytexo5 = gvox->mytexx>>5;
+            vc->mytexo5 = gvox->mytexx>>5;
 
             i = ((gvox->mytexx*gvox->mytexy+31)>>5)<<2;
-            zbit = (int32_t *)Xmalloc(i);
-            memset(zbit, 0, i);
+            vc->zbit = (int32_t *)Xmalloc(i);
+            memset(vc->zbit, 0, i);
 
-            v = gvox->mytexx*gvox->mytexy;
+            int32_t const v = gvox->mytexx*gvox->mytexy;
             for (bssize_t z=0; z<sc; z++)
             {
                 const int32_t dx = shp[z].x + (VOXBORDWIDTH<<1);
@@ -587,16 +762,16 @@ skindidntfit:
                 do
                 {
 #if (VOXUSECHAR != 0)
-                    x0 = ((rand()&32767)*(min(gvox->mytexx, 255)-dx))>>15;
-                    y0 = ((rand()&32767)*(min(gvox->mytexy, 255)-dy))>>15;
+                    x0 = (voxrand(vc)*(min(gvox->mytexx, 255)-dx))>>15;
+                    y0 = (voxrand(vc)*(min(gvox->mytexy, 255)-dy))>>15;
 #else
-                    x0 = ((rand()&32767)*(gvox->mytexx+1-dx))>>15;
-                    y0 = ((rand()&32767)*(gvox->mytexy+1-dy))>>15;
+                    x0 = (voxrand(vc)*(gvox->mytexx+1-dx))>>15;
+                    y0 = (voxrand(vc)*(gvox->mytexy+1-dy))>>15;
 #endif
                     i--;
                     if (i < 0) //Time-out! Very slow if this happens... but at least it still works :P
                     {
-                        Xfree(zbit);
+                        DO_FREE_AND_NULL(vc->zbit);
 
                         //Re-generate shp[].x/y (box sizes) from shcnt (now head indices) for next pass :/
                         int j = 0;
@@ -624,25 +799,24 @@ skindidntfit:
 
                         goto skindidntfit;
                     }
-                } while (!isrectfree(x0, y0, dx, dy));
+                } while (!isrectfree(vc, x0, y0, dx, dy));
 
-                while (y0 && isrectfree(x0, y0-1, dx, 1))
+                while (y0 && isrectfree(vc, x0, y0-1, dx, 1))
                     y0--;
-                while (x0 && isrectfree(x0-1, y0, 1, dy))
+                while (x0 && isrectfree(vc, x0-1, y0, 1, dy))
                     x0--;
 
-                setrect(x0, y0, dx, dy);
+                setrect(vc, x0, y0, dx, dy);
                 shp[z].x = x0; shp[z].y = y0; //Overwrite size with top-left location
             }
 
-            gquad = (voxrect_t *)Xrealloc(gquad, gvox->qcnt*sizeof(voxrect_t));
+            vc->gquad = (voxrect_t *)Xrealloc(vc->gquad, gvox->qcnt*sizeof(voxrect_t));
             gvox->mytex = (int32_t *)Xmalloc(gvox->mytexx*gvox->mytexy*sizeof(int32_t));
         }
     }
 
-    Xfree(shp);
-    Xfree(zbit);
-    Xfree(bx0);
+    DO_FREE_AND_NULL(vc->shp);
+    DO_FREE_AND_NULL(vc->zbit);
 
     const float phack[2] = { 0, 1.f / 256.f };
 
@@ -654,7 +828,7 @@ skindidntfit:
 
     for (int i = 0; i < gvox->qcnt; i++)
     {
-        const vert_t *const vptr = &gquad[i].v[0];
+        const vert_t *const vptr = &vc->gquad[i].v[0];
 
         const int32_t xx = vptr[0].x + vptr[2].x;
         const int32_t yy = vptr[0].y + vptr[2].y;
@@ -682,81 +856,88 @@ skindidntfit:
     return gvox;
 }
 
-static void alloc_vcolhashead(void)
+static void alloc_vcolhashead(voxconv_t *vc)
 {
-    vcolhashead = (int32_t *)Xmalloc((vcolhashsizm1+1)*sizeof(int32_t));
-    memset(vcolhashead, -1, (vcolhashsizm1+1)*sizeof(int32_t));
+    vc->vcolhashead = (int32_t *)Xmalloc((vc->vcolhashsizm1+1)*sizeof(int32_t));
+    memset(vc->vcolhashead, -1, (vc->vcolhashsizm1+1)*sizeof(int32_t));
 }
 
-static void alloc_vbit(void)
+static void alloc_vbit(voxconv_t *vc)
 {
-    yzsiz = voxsiz.y*voxsiz.z;
-    int32_t i = ((voxsiz.x*yzsiz+31)>>3)+1;
+    vc->yzsiz = vc->voxsiz.y*vc->voxsiz.z;
+    int32_t i = ((vc->voxsiz.x*vc->yzsiz+31)>>3)+1;
 
-    vbit = (int32_t *)Xmalloc(i);
-    memset(vbit, 0, i);
+    vc->vbit = (int32_t *)Xmalloc(i);
+    memset(vc->vbit, 0, i);
 }
 
-static void read_pal(buildvfs_kfd fil, int32_t pal[256])
+// the palette is in the last 768 bytes of each format
+static void read_pal(const char *buf, int32_t len, int32_t pal[256])
 {
-    klseek(fil, -768, SEEK_END);
+    const uint8_t *c = (const uint8_t *)&buf[len-768];
 
-    for (bssize_t i=0; i<256; i++)
+    for (bssize_t i=0; i<256; i++, c+=3)
     {
-        char c[3];
-        kread(fil, c, 3);
 //#if B_BIG_ENDIAN != 0
         pal[i] = B_LITTLE32((c[0]<<18) + (c[1]<<10) + (c[2]<<2) + (i<<24));
 //#endif
     }
 }
 
-static int32_t loadvox(const char *filnam)
+// returns -1 if the dimensions of the model are bad
+static int32_t read_siz(voxconv_t *vc, const char *buf)
 {
-    const buildvfs_kfd fil = kopen4load(filnam, 0);
-    if (fil == buildvfs_kfd_invalid)
+    vc->voxsiz.x = B_LITTLE32(B_UNBUF32(&buf[0]));
+    vc->voxsiz.y = B_LITTLE32(B_UNBUF32(&buf[4]));
+    vc->voxsiz.z = B_LITTLE32(B_UNBUF32(&buf[8]));
+
+    if ((unsigned)(vc->voxsiz.x-1) >= VOXMAXSIZ || (unsigned)(vc->voxsiz.y-1) >= VOXMAXSIZ || (unsigned)(vc->voxsiz.z-1) >= VOXMAXSIZ)
         return -1;
 
-    kread(fil, &voxsiz, sizeof(vec3_t));
-#if B_BIG_ENDIAN != 0
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
-#endif
-    voxpiv.x = (float)voxsiz.x * .5f;
-    voxpiv.y = (float)voxsiz.y * .5f;
-    voxpiv.z = (float)voxsiz.z * .5f;
+    return 0;
+}
+
+static int32_t loadvox(voxconv_t *vc, const char *buf, int32_t len)
+{
+    if (len < 12+768 || read_siz(vc, buf))
+        return -1;
+
+    vec3_t const voxsiz = vc->voxsiz;
+
+    if (voxsiz.x*voxsiz.y*voxsiz.z > len-12-768)
+        return -1;
+
+    vc->voxpiv.x = (float)voxsiz.x * .5f;
+    vc->voxpiv.y = (float)voxsiz.y * .5f;
+    vc->voxpiv.z = (float)voxsiz.z * .5f;
 
     int32_t pal[256];
-    read_pal(fil, pal);
+    read_pal(buf, len, pal);
     pal[255] = -1;
 
-    vcolhashsizm1 = 8192-1;
-    alloc_vcolhashead();
-    alloc_vbit();
+    vc->vcolhashsizm1 = 8192-1;
+    alloc_vcolhashead(vc);
+    alloc_vbit(vc);
 
-    char *const tbuf = (char *)Xmalloc(voxsiz.z*sizeof(uint8_t));
+    int32_t const yzsiz = vc->yzsiz;
+    const uint8_t *tbuf = (const uint8_t *)&buf[12];
 
-    klseek(fil, 12, SEEK_SET);
     for (bssize_t x=0; x<voxsiz.x; x++)
-        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
+        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z, tbuf+=voxsiz.z)
         {
-            kread(fil, tbuf, voxsiz.z);
-
             for (bssize_t z=voxsiz.z-1; z>=0; z--)
                 if (tbuf[z] != 255)
                 {
                     const int32_t i = j+z;
-                    vbit[i>>5] |= (1<<SHIFTMOD32(i));
+                    vc->vbit[i>>5] |= (1<<SHIFTMOD32(i));
                 }
         }
 
-    klseek(fil, 12, SEEK_SET);
+    tbuf = (const uint8_t *)&buf[12];
+
     for (bssize_t x=0; x<voxsiz.x; x++)
-        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
+        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z, tbuf+=voxsiz.z)
         {
-            kread(fil, tbuf, voxsiz.z);
-
             for (bssize_t z=0; z<voxsiz.z; z++)
             {
                 if (tbuf[z] == 255)
@@ -764,187 +945,218 @@ static int32_t loadvox(const char *filnam)
 
                 if (!x || !y || !z || x == voxsiz.x-1 || y == voxsiz.y-1 || z == voxsiz.z-1)
                 {
-                    putvox(x, y, z, pal[tbuf[z]]);
+                    putvox(vc, x, y, z, pal[tbuf[z]]);
                     continue;
                 }
 
                 const int32_t k = j+z;
 
-                if (isair(k-yzsiz) || isair(k+yzsiz) ||
-                    isair(k-voxsiz.z) || isair(k+voxsiz.z) ||
-                    isair(k-1) || isair(k+1))
+                if (isair(vc, k-yzsiz) || isair(vc, k+yzsiz) ||
+                    isair(vc, k-voxsiz.z) || isair(vc, k+voxsiz.z) ||
+                    isair(vc, k-1) || isair(vc, k+1))
                 {
-                    putvox(x, y, z, pal[tbuf[z]]);
+                    putvox(vc, x, y, z, pal[tbuf[z]]);
                     continue;
                 }
             }
         }
 
-    Xfree(tbuf);
-    kclose(fil);
-
     return 0;
 }
 
-static int32_t loadkvx(const char *filnam)
+static int32_t loadkvx(voxconv_t *vc, const char *buf, int32_t len)
 {
-    int32_t i, mip1leng;
+    if (len < 28+768)
+        return -1;
 
-    const buildvfs_kfd fil = kopen4load(filnam, 0);
-    if (fil == buildvfs_kfd_invalid)
+    int32_t const mip1leng = B_LITTLE32(B_UNBUF32(&buf[0]));
+
+    // the first mip level, and the palette after the others
+    if (mip1leng < 24 || mip1leng > len-4-768 || read_siz(vc, &buf[4]))
         return -1;
 
-    kread(fil, &mip1leng, 4); mip1leng = B_LITTLE32(mip1leng);
-    kread(fil, &voxsiz, sizeof(vec3_t));
-#if B_BIG_ENDIAN != 0
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
-#endif
-    kread(fil, &i, 4); voxpiv.x = (float)B_LITTLE32(i)*(1.f/256.f);
-    kread(fil, &i, 4); voxpiv.y = (float)B_LITTLE32(i)*(1.f/256.f);
-    kread(fil, &i, 4); voxpiv.z = (float)B_LITTLE32(i)*(1.f/256.f);
-    klseek(fil, (voxsiz.x+1)<<2, SEEK_CUR);
+    vec3_t const voxsiz = vc->voxsiz;
+
+    vc->voxpiv.x = (float)(int32_t)B_LITTLE32(B_UNBUF32(&buf[16]))*(1.f/256.f);
+    vc->voxpiv.y = (float)(int32_t)B_LITTLE32(B_UNBUF32(&buf[20]))*(1.f/256.f);
+    vc->voxpiv.z = (float)(int32_t)B_LITTLE32(B_UNBUF32(&buf[24]))*(1.f/256.f);
 
     const int32_t ysizp1 = voxsiz.y+1;
-    i = voxsiz.x*ysizp1*sizeof(int16_t);
+    const int32_t xyoffsofs = 28+((voxsiz.x+1)<<2);
+    const int32_t slabofs = xyoffsofs+((ysizp1*voxsiz.x)<<1);
 
-    uint16_t *xyoffs = (uint16_t *)Xmalloc(i);
-    kread(fil, xyoffs, i);
+    // the slabs of the first mip level end where it does
+    if (slabofs > 4+mip1leng)
+        return -1;
 
-    for (i=i/sizeof(int16_t)-1; i>=0; i--)
-        xyoffs[i] = B_LITTLE16(xyoffs[i]);
+    const char *const xyoffs = &buf[xyoffsofs];
+    const uint8_t *cptr = (const uint8_t *)&buf[slabofs];
+    const uint8_t *const cend = (const uint8_t *)&buf[4+mip1leng];
 
     int32_t pal[256];
-    read_pal(fil, pal);
+    read_pal(buf, len, pal);
 
-    alloc_vbit();
+    alloc_vbit(vc);
 
-    for (vcolhashsizm1=4096; vcolhashsizm1<(mip1leng>>1); vcolhashsizm1<<=1)
+    for (vc->vcolhashsizm1=4096; vc->vcolhashsizm1<(mip1leng>>1); vc->vcolhashsizm1<<=1)
     {
         /* do nothing */
     }
-    vcolhashsizm1--; //approx to numvoxs!
-    alloc_vcolhashead();
-
-    klseek(fil, 28+((voxsiz.x+1)<<2)+((ysizp1*voxsiz.x)<<1), SEEK_SET);
-
-    i = kfilelength(fil)-ktell(fil);
-    char *const tbuf = (char *)Xmalloc(i);
-
-    kread(fil, tbuf, i);
-    kclose(fil);
-
-    char *cptr = tbuf;
+    vc->vcolhashsizm1--; //approx to numvoxs!
+    alloc_vcolhashead(vc);
 
     for (bssize_t x=0; x<voxsiz.x; x++) //Set surface voxels to 1 else 0
-        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
+        for (bssize_t y=0, j=x*vc->yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
         {
-            i = xyoffs[x*ysizp1+y+1] - xyoffs[x*ysizp1+y];
-            if (!i)
-                continue;
-
+            const int32_t o = (x*ysizp1+y)<<1;
+            int32_t i = B_LITTLE16(B_UNBUF16(&xyoffs[o+2])) - B_LITTLE16(B_UNBUF16(&xyoffs[o]));
             int32_t z1 = 0;
 
-            while (i)
+            while (i > 0)
             {
+                if (cend-cptr < 3)
+                    return -1;
+
                 const int32_t z0 = cptr[0];
                 const int32_t k = cptr[1];
                 cptr += 3;
 
-                if (!(cptr[-1]&16))
-                    setzrange1(vbit, j+z1, j+z0);
+                if (z0+k > voxsiz.z || cend-cptr < k)
+                    return -1;
+
+                if (!(cptr[-1]&16) && z1 < z0)
+                    setzrange1(vc->vbit, j+z1, j+z0);
 
                 i -= k+3;
                 z1 = z0+k;
 
-                setzrange1(vbit, j+z0, j+z1);  // PK: oob in AMC TC dev if vbit alloc'd w/o +1
+                setzrange1(vc->vbit, j+z0, j+z1);  // PK: oob in AMC TC dev if vbit alloc'd w/o +1
 
                 for (bssize_t z=z0; z<z1; z++)
-                    putvox(x, y, z, pal[*cptr++]);
+                    putvox(vc, x, y, z, pal[*cptr++]);
             }
         }
 
-    Xfree(tbuf);
-    Xfree(xyoffs);
-
     return 0;
 }
 
-static int32_t loadkv6(const char *filnam)
+static int32_t loadkv6(voxconv_t *vc, const char *buf, int32_t len)
 {
-    int32_t i;
-
-    const buildvfs_kfd fil = kopen4load(filnam, 0);
-    if (fil == buildvfs_kfd_invalid)
+    if (len < 32 || B_LITTLE32(B_UNBUF32(&buf[0])) != 0x6c78764b) //Kvxl
         return -1;
 
-    kread(fil, &i, 4);
-    if (B_LITTLE32(i) != 0x6c78764b)
-    {
-        kclose(fil);
+    if (read_siz(vc, &buf[4]))
         return -1;
-    } //Kvxl
 
-    kread(fil, &voxsiz, sizeof(vec3_t));
-#if B_BIG_ENDIAN != 0
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
-#endif
-    kread(fil, &i, 4); i = B_LITTLE32(i); voxpiv.x = *(float*)&i;
-    kread(fil, &i, 4); i = B_LITTLE32(i); voxpiv.y = *(float*)&i;
-    kread(fil, &i, 4); i = B_LITTLE32(i); voxpiv.z = *(float*)&i;
+    vec3_t const voxsiz = vc->voxsiz;
+    uint32_t i;
+
+    i = B_LITTLE32(B_UNBUF32(&buf[16])); Bmemcpy(&vc->voxpiv.x, &i, sizeof(float));
+    i = B_LITTLE32(B_UNBUF32(&buf[20])); Bmemcpy(&vc->voxpiv.y, &i, sizeof(float));
+    i = B_LITTLE32(B_UNBUF32(&buf[24])); Bmemcpy(&vc->voxpiv.z, &i, sizeof(float));
 
-    int32_t numvoxs;
-    kread(fil, &numvoxs, 4); numvoxs = B_LITTLE32(numvoxs);
+    int32_t numvoxs = B_LITTLE32(B_UNBUF32(&buf[28]));
+
+    if ((unsigned)numvoxs > (unsigned)(len-32)>>3)
+        return -1;
 
-    uint16_t *const ylen = (uint16_t *)Xmalloc(voxsiz.x*voxsiz.y*sizeof(int16_t));
+    const int32_t ylenofs = 32+(numvoxs<<3)+(voxsiz.x<<2);
 
-    klseek(fil, 32+(numvoxs<<3)+(voxsiz.x<<2), SEEK_SET);
-    kread(fil, ylen, voxsiz.x*voxsiz.y*sizeof(int16_t));
-    for (i=voxsiz.x*voxsiz.y-1; i>=0; i--)
-        ylen[i] = B_LITTLE16(ylen[i]);
+    if (ylenofs > len || voxsiz.x*voxsiz.y > (len-ylenofs)>>1)
+        return -1;
 
-    klseek(fil, 32, SEEK_SET);
+    const char *const ylen = &buf[ylenofs];
+    const char *c = &buf[32];
 
-    alloc_vbit();
+    alloc_vbit(vc);
 
-    for (vcolhashsizm1=4096; vcolhashsizm1<numvoxs; vcolhashsizm1<<=1)
+    for (vc->vcolhashsizm1=4096; vc->vcolhashsizm1<numvoxs; vc->vcolhashsizm1<<=1)
     {
         /* do nothing */
     }
-    vcolhashsizm1--;
-    alloc_vcolhashead();
+    vc->vcolhashsizm1--;
+    alloc_vcolhashead(vc);
 
     for (bssize_t x=0; x<voxsiz.x; x++)
-        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
+        for (bssize_t y=0, j=x*vc->yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
         {
             int32_t z1 = voxsiz.z;
 
-            for (i=ylen[x*voxsiz.y+y]; i>0; i--)
+            for (int32_t n=B_LITTLE16(B_UNBUF16(&ylen[(x*voxsiz.y+y)<<1])); n>0; n--, c+=8) //b,g,r,a,z_lo,z_hi,vis,dir
             {
-                char c[8];
-                kread(fil, c, 8); //b,g,r,a,z_lo,z_hi,vis,dir
+                if (--numvoxs < 0)
+                    return -1;
 
                 const int32_t z0 = B_LITTLE16(B_UNBUF16(&c[4]));
 
+                if (z0 >= voxsiz.z)
+                    return -1;
+
                 if (!(c[6]&16))
-                    setzrange1(vbit, j+z1, j+z0);
+                    setzrange1(vc->vbit, j+z1, j+z0);
 
-                vbit[(j+z0)>>5] |= (1<<SHIFTMOD32(j+z0));
+                vc->vbit[(j+z0)>>5] |= (1<<SHIFTMOD32(j+z0));
 
-                putvox(x, y, z0, B_LITTLE32(B_UNBUF32(&c[0]))&0xffffff);
+                putvox(vc, x, y, z0, B_LITTLE32(B_UNBUF32(&c[0]))&0xffffff);
                 z1 = z0+1;
             }
         }
 
-    Xfree(ylen);
-    kclose(fil);
-
     return 0;
 }
 
+static int32_t voxformat(const char *filnam)
+{
+    const int32_t i = Bstrlen(filnam)-4;
+    if (i < 0)
+        return -1;
+
+    if (!Bstrcasecmp(&filnam[i], ".vox")) return VOXFMT_VOX;
+    if (!Bstrcasecmp(&filnam[i], ".kvx")) return VOXFMT_KVX;
+    if (!Bstrcasecmp(&filnam[i], ".kv6")) return VOXFMT_KV6;
+    //if (!Bstrcasecmp(&filnam[i],".vxl")) return VOXFMT_VXL;
+
+    return -1;
+}
+
+// Parses a model of the given format and makes its mesh and skin. Safe to call
+// from any thread, as everything it uses is in its own voxconv_t.
+static voxmodel_t *voxconvert(int32_t fmt, const char *buf, int32_t len, int32_t greedy)
+{
+    MICROPROFILE_SCOPEI("Voxel", EDUKE32_FUNCTION, MP_AUTO);
+
+    voxconv_t vc = {};
+    int32_t ret = -1;
+
+    vc.greedy = greedy;
+    vc.randseed = 1;
+
+    switch (fmt)
+    {
+    case VOXFMT_VOX: ret = loadvox(&vc, buf, len); break;
+    case VOXFMT_KVX: ret = loadkvx(&vc, buf, len); break;
+    case VOXFMT_KV6: ret = loadkv6(&vc, buf, len); break;
+    }
+
+    voxmodel_t *vm = NULL;
+
+    if (ret >= 0)
+    {
+        vm = vox2poly(&vc);
+        vm->siz = vc.voxsiz;
+        vm->piv = vc.voxpiv;
+        vm->is8bit = (fmt != VOXFMT_KV6);
+    }
+
+    Xfree(vc.shcntmal);
+    Xfree(vc.vbit);
+    Xfree(vc.vcol);
+    Xfree(vc.vcolhashead);
+    Xfree(vc.gquad);
+
+    return vm;
+}
+
 void voxfree(voxmodel_t *m)
 {
     if (!m)
@@ -960,173 +1172,157 @@ void voxfree(voxmodel_t *m)
     Xfree(m);
 }
 
-voxmodel_t *voxload(const char *filnam)
+void voxfreepool(void)
+{
+    delete voxpool;
+    voxpool        = nullptr;
+    voxpoolthreads = 0;
+}
+
+static void voxsetuppool(int32_t const numthreads)
 {
-    int32_t is8bit, ret;
+    if (numthreads == voxpoolthreads)
+        return;
 
-    const int32_t i = Bstrlen(filnam)-4;
-    if (i < 0)
-        return NULL;
+    voxfreepool();
+    voxpool = new async::threadpool_scheduler(numthreads, []() { MicroProfileOnThreadCreate("Voxel"); }, nullptr);
+    voxpoolthreads = numthreads;
+}
 
-    if (!Bstrcasecmp(&filnam[i], ".vox")) { ret = loadvox(filnam); is8bit = 1; }
-    else if (!Bstrcasecmp(&filnam[i], ".kvx")) { ret = loadkvx(filnam); is8bit = 1; }
-    else if (!Bstrcasecmp(&filnam[i], ".kv6")) { ret = loadkv6(filnam); is8bit = 0; }
-    //else if (!Bstrcasecmp(&filnam[i],".vxl")) { ret = loadvxl(filnam); is8bit = 0; }
-    else return NULL;
+void voxloadbatch(voxloadreq_t *reqs, int32_t num)
+{
+    MICROPROFILE_SCOPEI("Voxel", EDUKE32_FUNCTION, MP_AUTO);
 
-    voxmodel_t* vm = NULL;
-    if (ret >= 0)
+    struct voxjob_t
     {
-        // file presence is guaranteed
-        buildvfs_kfd filh = kopen4load(filnam, 0);
-        int32_t const filelen = kfilelength(filh);
-        kclose(filh);
+        const char *data;
+        char *filebuf;
+        int32_t len, fmt;
+        char cacheid[24];
+    };
+
+    auto jobs = (voxjob_t *)Xcalloc(num, sizeof(voxjob_t));
+    auto misses = (int32_t *)Xmalloc(num * sizeof(int32_t));
+    int32_t nummisses = 0, numcached = 0, numdamaged = 0;
+    int32_t const greedy = !!r_voxelgreedymesh;
+
+    // the cache is only touched here on the main thread, and the files are
+    // read here too, so that the jobs below have nothing but memory to work on
+    for (bssize_t i = 0; i < num; i++)
+    {
+        voxloadreq_t &req = reqs[i];
+        voxjob_t &job = jobs[i];
 
-        char voxcacheid[BMAX_PATH];
-        texcache_calcid(voxcacheid, filnam, filelen, -1, -1);
+        req.model = NULL;
 
-        // static variable 'gvox' is normally defined by 'vox2poly' -- do same here for safety
-        if (!(gvox = vm = voxcache_fetchvoxmodel(voxcacheid)))
+        if (req.filename)
         {
-            vm = vox2poly();
-            voxcache_writevoxmodel(voxcacheid, vm);
-        }
+            if ((job.fmt = voxformat(req.filename)) < 0)
+                continue;
 
-        if (vm)
-        {
-            vm->mdnum = 1; //VOXel model id
-            vm->scale = vm->bscale = 1.f;
-            vm->siz.x = voxsiz.x; vm->siz.y = voxsiz.y; vm->siz.z = voxsiz.z;
-            vm->piv.x = voxpiv.x; vm->piv.y = voxpiv.y; vm->piv.z = voxpiv.z;
-            vm->is8bit = is8bit;
+            buildvfs_kfd const fil = kopen4load(req.filename, 0);
+            if (fil == buildvfs_kfd_invalid)
+                continue;
 
-            vm->texid = (uint32_t*)Xcalloc(MAXPALOOKUPS, sizeof(uint32_t));
-        }
-    }
+            job.len = kfilelength(fil);
+            job.filebuf = (char *)Xmalloc(max(job.len, 1));
 
-    DO_FREE_AND_NULL(shcntmal);
-    DO_FREE_AND_NULL(vbit);
-    DO_FREE_AND_NULL(vcol);
-    vnum = vmax = 0;
-    DO_FREE_AND_NULL(vcolhashead);
+            if (kread(fil, job.filebuf, job.len) != job.len)
+                DO_FREE_AND_NULL(job.filebuf);
 
-    return vm;
-}
+            kclose(fil);
 
-voxmodel_t *loadkvxfrombuf(const char *kvxbuffer, int32_t length)
-{
-    int32_t i, mip1leng;
+            if (!(job.data = job.filebuf))
+                continue;
+        }
+        else
+        {
+            if (!(job.data = req.buf))
+                continue;
 
-    if (!kvxbuffer)
-        return NULL;
+            job.fmt = VOXFMT_KVX;
+            job.len = req.len;
+        }
 
-    char *buffer = (char*)Xmalloc(length);
-    if (!buffer)
-        return NULL;
+        // the contents of the file and everything changing what is made of them
+        uint64_t const seed = (VOXCACHEVERSION<<8) + (greedy<<4) + job.fmt;
+        Bsprintf(job.cacheid, "%08" PRIx64, XXH3_64bits_withSeed(job.data, job.len, seed));
 
-    Bmemcpy(buffer, kvxbuffer, length);
+        int32_t damaged = 0;
 
-    int32_t *longptr = (int32_t*)buffer;
+        if ((req.model = voxcache_fetchvoxmodel(job.cacheid, &damaged)))
+            numcached++;
+        else
+            misses[nummisses++] = i;
 
-    mip1leng = *longptr++; mip1leng = B_LITTLE32(mip1leng);
-    if (mip1leng > length - 4)
-    {
-        // Invalid KVX file
-        Xfree(buffer);
-        return NULL;
+        numdamaged += damaged;
     }
-    memcpy(&voxsiz, longptr, sizeof(vec3_t));
-    longptr += 3;
-#if B_BIG_ENDIAN != 0
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
-#endif
-    i = *longptr++; voxpiv.x = (float)B_LITTLE32(i)*(1.f/256.f);
-    i = *longptr++; voxpiv.y = (float)B_LITTLE32(i)*(1.f/256.f);
-    i = *longptr++; voxpiv.z = (float)B_LITTLE32(i)*(1.f/256.f);
-    longptr += voxsiz.x+1;
 
-    const int32_t ysizp1 = voxsiz.y+1;
-    i = voxsiz.x*ysizp1*sizeof(int16_t);
-    uint16_t *xyoffs = (uint16_t*)longptr;
+    if (numdamaged)
+        LOG_F(WARNING, "%d voxel models in the texture cache are damaged and will be made again.", numdamaged);
 
-    for (i=i/sizeof(int16_t)-1; i>=0; i--)
-        xyoffs[i] = B_LITTLE16(xyoffs[i]);
+    auto convert = [&](int32_t const m)
+    {
+        voxjob_t const &job = jobs[misses[m]];
+        reqs[misses[m]].model = voxconvert(job.fmt, job.data, job.len, greedy);
+    };
 
-    const char *paloff = buffer+length-768;
-    int32_t pal[256];
+    int32_t const numthreads = clamp(r_voxelthreads, 1, MAXVOXELTHREADS);
 
-    for (bssize_t i=0; i<256; i++)
+    // the pool keeps the size set by the cvar, however few models a batch has
+    if (numthreads > 1 && nummisses > 1)
     {
-        const char *c = &paloff[i*3];
-//#if B_BIG_ENDIAN != 0
-        pal[i] = B_LITTLE32((c[0]<<18) + (c[1]<<10) + (c[2]<<2) + (i<<24));
-//#endif
+        voxsetuppool(numthreads);
+        async::parallel_for(*voxpool, async::static_partitioner(async::irange(0, nummisses), 1), convert);
     }
-
-    alloc_vbit();
-
-    for (vcolhashsizm1=4096; vcolhashsizm1<(mip1leng>>1); vcolhashsizm1<<=1)
+    else
     {
-        /* do nothing */
+        for (bssize_t m = 0; m < nummisses; m++)
+            convert(m);
     }
-    vcolhashsizm1--; //approx to numvoxs!
-    alloc_vcolhashead();
 
-    const char *cptr = buffer+28+((voxsiz.x+1)<<2)+((ysizp1*voxsiz.x)<<1);
+    for (bssize_t m = 0; m < nummisses; m++)
+        voxcache_writevoxmodel(jobs[misses[m]].cacheid, reqs[misses[m]].model);
 
-    for (bssize_t x=0; x<voxsiz.x; x++) //Set surface voxels to 1 else 0
-        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
-        {
-            i = xyoffs[x*ysizp1+y+1] - xyoffs[x*ysizp1+y];
-            if (!i)
-                continue;
-
-            int32_t z1 = 0;
-
-            while (i)
-            {
-                const int32_t z0 = cptr[0];
-                const int32_t k = cptr[1];
-                cptr += 3;
-
-                if (!(cptr[-1]&16))
-                    setzrange1(vbit, j+z1, j+z0);
-
-                i -= k+3;
-                z1 = z0+k;
+    int32_t numloaded = 0;
 
-                setzrange1(vbit, j+z0, j+z1);  // PK: oob in AMC TC dev if vbit alloc'd w/o +1
+    for (bssize_t i = 0; i < num; i++)
+    {
+        voxmodel_t *const vm = reqs[i].model;
 
-                for (bssize_t z=z0; z<z1; z++)
-                    putvox(x, y, z, pal[*cptr++]);
-            }
+        if (vm)
+        {
+            vm->mdnum = 1; //VOXel model id
+            vm->scale = vm->bscale = 1.f;
+            vm->texid = (uint32_t *)Xcalloc(MAXPALOOKUPS, sizeof(uint32_t));
+            numloaded++;
         }
 
-    voxmodel_t *const vm = vox2poly();
+        Xfree(jobs[i].filebuf);
+    }
 
-    if (vm)
-    {
-        vm->mdnum = 1; //VOXel model id
-        vm->scale = vm->bscale = 1.f;
-        vm->siz.x = voxsiz.x; vm->siz.y = voxsiz.y; vm->siz.z = voxsiz.z;
-        vm->piv.x = voxpiv.x; vm->piv.y = voxpiv.y; vm->piv.z = voxpiv.z;
-        vm->is8bit = 1;
+    if (num > 1)
+        LOG_F(INFO, "Loaded %d voxel models, %d of them from the texture cache.", numloaded, numcached);
 
-        vm->texid = (uint32_t *)Xcalloc(MAXPALOOKUPS, sizeof(uint32_t));
-    }
+    Xfree(misses);
+    Xfree(jobs);
+}
 
-    DO_FREE_AND_NULL(shcntmal);
-    DO_FREE_AND_NULL(vbit);
-    DO_FREE_AND_NULL(vcol);
-    vnum = vmax = 0;
-    DO_FREE_AND_NULL(vcolhashead);
-    Xfree(buffer);
+voxmodel_t *voxload(const char *filnam)
+{
+    voxloadreq_t req = { filnam, NULL, 0, NULL };
+    voxloadbatch(&req, 1);
+    return req.model;
+}
 
-    return vm;
+voxmodel_t *loadkvxfrombuf(const char *kvxbuffer, int32_t length)
+{
+    voxloadreq_t req = { NULL, kvxbuffer, length, NULL };
+    voxloadbatch(&req, 1);
+    return req.model;
 }
 
+
 //Draw voxel model as perfect cubes
 int32_t polymost_voxdraw(voxmodel_t *m, tspriteptr_t const tspr)
 {
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <map>
 #endif
 
+#include "actorprefetch.h"
 #include "colmatch.h"
 #include "duke3d.h"
 #include "input.h"
@@ -623,7 +624,7 @@ int32_t A_MoveSpriteClipdist(int32_t spriteNum, vec3_t const &change, uint32_t c
     else
     {
         pSprite->z -= diffZ >> 1;
-        returnValue = clipmove(&pSprite->xyz, &newSectnum, change.x << 13, change.y << 13, clipDist, ZOFFSET6, ZOFFSET6, clipType);
+        returnValue = clipmove(&pSprite->xyz, &newSectnum, change.x << 13, change.y << 13, clipDist, ZOFFSET6, ZOFFSET6, clipType, spriteNum);
         pSprite->z += diffZ >> 1;
     }
 
@@ -4208,6 +4209,29 @@ static int A_FindLocatorWithHiLoTags(int const hitag, int const tag, int const s
     return -1;
 }
 
+// Lets the engine prepare the clipping data of every actor about to move, on
+// its worker threads. A_MoveSprite() moves by half the change it's given.
+ACTOR_STATIC void G_PrefetchActors(void)
+{
+    static actorprefetch_t prefetchJobs[MAXSPRITES];
+    int numJobs = 0;
+
+    for (bssize_t SPRITES_OF(STAT_ACTOR, spriteNum))
+    {
+        auto const pSprite = &sprite[spriteNum];
+        auto &     job     = prefetchJobs[numJobs++];
+
+        job.pos      = pSprite->xy;
+        job.move     = { ((pSprite->xvel * sintable[(pSprite->ang + 512) & 2047]) >> 14) >> 1,
+                         ((pSprite->xvel * sintable[pSprite->ang & 2047]) >> 14) >> 1 };
+        job.walldist = A_GetClipdist(spriteNum);
+        job.owner    = spriteNum;
+        job.sectnum  = pSprite->sectnum;
+    }
+
+    actorPrefetchRun(prefetchJobs, numJobs);
+}
+
 ACTOR_STATIC void G_MoveActors(void)
 {
     int spriteNum = headspritestat[STAT_ACTOR];
@@ -9343,6 +9367,7 @@ void G_MoveWorld(void)
 
     {
         MICROPROFILE_SCOPEI("MoveWorld", "MoveActors", MP_YELLOW4);
+        G_PrefetchActors();
         G_MoveActors();  //ST 1
     }
 
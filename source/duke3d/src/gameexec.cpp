@@ -327,20 +327,34 @@ int A_GetFurthestAngle(int const spriteNum, int const angDiv)
     int       furthestAngle = 0;
     int const angIncs       = tabledivide32_noinline(2048, angDiv);
     int32_t   greatestDist  = INT32_MIN;
-    hitdata_t hit;
+    vec3_t    rayVec[MAXHITSCANBATCH];
+    hitdata_t rayHit[MAXHITSCANBATCH];
+    vec3_t    origin = pSprite->xyz;
+
+    origin.z -= ZOFFSET3;
 
-    for (native_t j = pSprite->ang; j < (2048 + pSprite->ang); j += angIncs)
+    // the rays have no side effects between them, so they can share one sector walk
+    for (native_t j = pSprite->ang; j < (2048 + pSprite->ang);)
     {
-        vec3_t origin = pSprite->xyz;
-        origin.z -= ZOFFSET3;
-        hitscan(&origin, pSprite->sectnum, sintable[(j + 512) & 2047], sintable[j & 2047], 0, &hit, CLIPMASK1);
+        int numRays = 0;
+
+        for (; numRays < MAXHITSCANBATCH && j + numRays * angIncs < (2048 + pSprite->ang); numRays++)
+        {
+            int const rayAng = j + numRays * angIncs;
+            rayVec[numRays] = { sintable[(rayAng + 512) & 2047], sintable[rayAng & 2047], 0 };
+        }
 
-        int const hitDist = klabs(hit.x-pSprite->x) + klabs(hit.y-pSprite->y);
+        hitscan_batch(&origin, pSprite->sectnum, numRays, rayVec, rayHit, CLIPMASK1);
 
-        if (hitDist > greatestDist)
+        for (int i = 0; i < numRays; i++, j += angIncs)
         {
-            greatestDist = hitDist;
-            furthestAngle = j;
+            int const hitDist = klabs(rayHit[i].x-pSprite->x) + klabs(rayHit[i].y-pSprite->y);
+
+            if (hitDist > greatestDist)
+            {
+                greatestDist = hitDist;
+                furthestAngle = j;
+            }
         }
     }
 
@@ -478,7 +492,7 @@ void VM_GetZRange(int const spriteNum, int32_t* const ceilhit, int32_t* const fl
     pSprite->cstat = 0;
     pSprite->z -= AC_FZOFFSET(spriteNum);
     
-    getzrange(&pSprite->xyz, pSprite->sectnum, &pActor->ceilingz, ceilhit, &pActor->floorz, florhit, wallDist, CLIPMASK0);
+    getzrange(&pSprite->xyz, pSprite->sectnum, &pActor->ceilingz, ceilhit, &pActor->floorz, florhit, wallDist, CLIPMASK0, spriteNum);
 
     pSprite->z += AC_FZOFFSET(spriteNum);
     pSprite->cstat = ocstat;
@@ -151,8 +151,8 @@ void __fastcall VM_SetSector(int const sectNum, int const labelNum, int32_t newV
 
 memberlabel_t const WallLabels[]=
 {
-    MEMBER(wall, x,          WALL_X),
-    MEMBER(wall, y,          WALL_Y),
+    { "x", WALL_X, sizeof(wall[0].x) | LABEL_WRITEFUNC, 0, offsetof(uwalltype, x) },
+    { "y", WALL_Y, sizeof(wall[0].y) | LABEL_WRITEFUNC, 0, offsetof(uwalltype, y) },
     MEMBER(wall, point2,     WALL_POINT2),
     MEMBER(wall, nextwall,   WALL_NEXTWALL),
     MEMBER(wall, nextsector, WALL_NEXTSECTOR),
@@ -197,6 +197,18 @@ void __fastcall VM_SetWall(int const wallNum, int const labelNum, int32_t const
 {
     switch (labelNum)
     {
+        case WALL_X:
+        case WALL_Y:
+            if (labelNum == WALL_X)
+                wall[wallNum].x = newValue;
+            else
+                wall[wallNum].y = newValue;
+
+            // the sector grid, the visibility table and the clip cache hold on to wall positions
+            if (wallNum < numwalls)
+                sectorGridInvalidate(sectorofwall(wallNum));
+            break;
+
         case WALL_BLEND:
 #ifdef NEW_MAP_FORMAT
             w.blend = newValue;
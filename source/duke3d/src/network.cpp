@@ -213,20 +213,30 @@ static int32_t g_chatPlayer = -1;
 #define NETINDEX_BITS (16 + 1)
 
 
-// worst case: 2 bits per field per stuct if every field in every struct is changed
+// worst case: 3 bits per field per stuct if every field in every struct is changed
 #define WORLD_CHANGEBITSSIZE                                                                                                               \
-    (MAXWALLS * ARRAY_SIZE(WallFields) * 2) + (MAXSECTORS * ARRAY_SIZE(SectorFields) * 2) + (MAXSPRITES * ARRAY_SIZE(ActorFields) * 2)
+    (MAXWALLS * ARRAY_SIZE(WallFields) * 3) + (MAXSECTORS * ARRAY_SIZE(SectorFields) * 3) + (MAXSPRITES * ARRAY_SIZE(ActorFields) * 3)
 
 //                              each changed entry has a netindex + stop codes                  bits to indicate whether a field
 //                              changed/zeroed                 convert to bytes....
 #define WORLD_OVERHEADSIZE (((MAXSECTORS + MAXWALLS + MAXSPRITES + 3) * NETINDEX_BITS + WORLD_CHANGEBITSSIZE) >> 8) + 1
 
 
+// fields the server may send with their low bits dropped, see g_netQuantizePos and g_netQuantizeAng
+enum netQuant_t
+{
+    NETQUANT_NONE,
+    NETQUANT_POS,
+    NETQUANT_ANG,
+    NETQUANT_COUNT
+};
+
 typedef struct netField_s
 {
     const char  *name;      // field name
     int32_t     offset;     // offset from the start of the entity struct
     int32_t     bits;       // field size
+    int32_t     quant = NETQUANT_NONE;
 
 } netField_t;
 
@@ -317,9 +327,9 @@ static netField_t ActorFields[] =
 
     { ACTF(flags),                      32 },
 
-    { ACTF(bpos_x),                     32 },
-    { ACTF(bpos_y),                     32 },
-    { ACTF(bpos_z),                     32 },
+    { ACTF(bpos_x),                     32, NETQUANT_POS },
+    { ACTF(bpos_y),                     32, NETQUANT_POS },
+    { ACTF(bpos_z),                     32, NETQUANT_POS },
 
     { ACTF(floorz),                     32 },
     { ACTF(ceilingz),                   32 },
@@ -347,9 +357,9 @@ static netField_t ActorFields[] =
     //------------------------------------------------------
     // sprite fields
 
-    { ACTF(spr_x),                          32 },
-    { ACTF(spr_y),                          32 },
-    { ACTF(spr_z),                          32 },
+    { ACTF(spr_x),                          32, NETQUANT_POS },
+    { ACTF(spr_y),                          32, NETQUANT_POS },
+    { ACTF(spr_z),                          32, NETQUANT_POS },
 
     { ACTF(spr_cstat),          16 },
 
@@ -366,7 +376,7 @@ static netField_t ActorFields[] =
     { ACTF(spr_sectnum),        16 },
     { ACTF(spr_statnum),        16 },
 
-    { ACTF(spr_ang),            16 },
+    { ACTF(spr_ang),            16, NETQUANT_ANG },
     { ACTF(spr_owner),          16 },
     { ACTF(spr_xvel),           16 },
     { ACTF(spr_yvel),           16 },
@@ -423,9 +433,6 @@ static netField_t ActorFields[] =
 static const int64_t cWORLD_DataSize     = WORLD_DATASIZE;
 static const int64_t cWORLD_OverheadSize = WORLD_OVERHEADSIZE;
 static const int64_t cWORLD_TotalSize    = MAX_WORLDBUFFER;
-
-// ...it's pretty big for now (!)
-static const int64_t SnapshotArraySize = sizeof(netmapstate_t) * NET_REVISIONS;
 #endif
 
 
@@ -439,13 +446,50 @@ static uint32_t g_netMapRevisionNumber = 0;
 // what version of the game the client has interpolated to.
 static uint32_t g_cl_InterpolatedRevision = 0;
 
+// the walls, sectors and actors of one revision that differ from the baseline of its history,
+// each entry is an index followed by the whole struct
+typedef struct netsparse_s
+{
+    int32_t     count;
+    int32_t     capacity;
+    uint16_t    *index;
+    uint8_t     *data;
+} netsparse_t;
+
+typedef struct netrevision_s
+{
+    uint32_t    revisionNumber;
+    int32_t     maxActorIndex;
+    int32_t     isValid;
+
+    netsparse_t wall;
+    netsparse_t sector;
+    netsparse_t actor;
+} netrevision_t;
+
+// A history of map states keeps the first one stored after the map loaded as its baseline, and only the
+// changes from that for each of the last NET_REVISIONS revisions. Revisions are put back together in the
+// work state when they're asked for, see Net_GetRevision().
+typedef struct netstatehistory_s
+{
+    netmapstate_t   baseline;
+    netmapstate_t   work;
+    int32_t         haveBaseline;
+    int32_t         workSlot;       // revision[workSlot] is applied to work, or -1 if it's a copy of the baseline
+
+    // note that the map state number is not an index into here,
+    // to get the index into this array out of a map state number, do <Map state number> % NET_REVISONS
+    netrevision_t   revision[NET_REVISIONS];
+} netstatehistory_t;
+
 static netmapstate_t *g_mapStartState;
 
-static netmapstate_t *g_cl_InterpolatedMapStateHistory[NET_REVISIONS];
+// the server's newest snapshot while it is sent out, or the one the client is reading from a world update
+static netmapstate_t g_netCurrentMapState;
+
+static netstatehistory_t g_cl_InterpolatedMapStateHistory;
 
-// note that the map state number is not an index into here,
-// to get the index into this array out of a map state number, do <Map state number> % NET_REVISONS
-static netmapstate_t *g_mapStateHistory[NET_REVISIONS];
+static netstatehistory_t g_mapStateHistory;
 static uint8_t       *tempnetbuf;
 
 // Remember that this constant needs to be one bit longer than a struct index, so it can't be mistaken for a valid wall, sprite, or sector index
@@ -453,11 +497,35 @@ static const int32_t cSTOP_PARSING_CODE = ((1 << NETINDEX_BITS) - 1);
 
 static uint32_t NET_75_CHECK;
 
+// low bits dropped from NETQUANT_POS and NETQUANT_ANG fields in the world update being written or read,
+// the server takes them from g_netQuantizePos and g_netQuantizeAng and sends them in the packet header
+static int32_t g_netPacketQuant[NETQUANT_COUNT];
+
+// world update sizes and server side snapshot costs, see Net_PrintSnapshotStats()
+typedef struct netclientstats_s
+{
+    uint64_t bytes;
+    uint32_t updates;
+    uint32_t maxBytes;
+    uint32_t fromInitialState;  // updates that had to be encoded against the initial map state
+} netclientstats_t;
+
+static netclientstats_t g_netClientStats[MAXPLAYERS];
+
+static uint64_t g_netStatsStartTicks;
+static uint64_t g_netSnapshotTicks;
+static uint64_t g_netEncodeTicks;
+static uint64_t g_netMaxUpdateTicks;
+static uint32_t g_netStatsUpdates;
+static uint32_t g_netStatsEncodes;
+
 // Externally available data / functions
 int32_t     g_netPlayersWaiting = 0;
 int32_t     g_netIndex          = 2;
 newgame_t   pendingnewgame;
 bool        g_enableClientInterpolationCheck = true;
+int32_t     g_netQuantizePos = 0;
+int32_t     g_netQuantizeAng = 0;
 
 
 // Internal functions
@@ -599,7 +667,7 @@ static void Net_InitNetActor(netactor_t *netActor)
 // Net -> Game Arrays
 //------------------------------------------------------------------------------
 
-static void Net_CopyWallFromNet(netWall_t* netWall, walltype* gameWall)
+static void Net_CopyWallFromNet(const netWall_t* netWall, walltype* gameWall)
 {
     // (convert data from 32 bit integers)
 
@@ -642,7 +710,7 @@ static void Net_CopyWallFromNet(netWall_t* netWall, walltype* gameWall)
 
 }
 
-static void Net_CopySectorFromNet(netSector_t* netSector, sectortype* gameSector)
+static void Net_CopySectorFromNet(const netSector_t* netSector, sectortype* gameSector)
 {
     Bassert(gameSector);
     Bassert(netSector);
@@ -1080,6 +1148,7 @@ static void Net_CopyPlayerActorDataFromNet(const netactor_t* netActor, spritetyp
 
 }
 
+// cl_snapshot is nullptr if the client has no state of its own for the revision, then everything is copied
 static void Net_CopyActorsToGameArrays(const netmapstate_t* srv_snapshot, const netmapstate_t* cl_snapshot)
 {
     int32_t actorIndex = 0;
@@ -1097,9 +1166,8 @@ static void Net_CopyActorsToGameArrays(const netmapstate_t* srv_snapshot, const
     for (actorIndex = 0; actorIndex < MAXSPRITES; actorIndex++)
     {
         const netactor_t*       srvActor = &(srv_snapshot->actor[actorIndex]);
-        const netactor_t*       clActor  = &(cl_snapshot->actor[actorIndex]);
 
-        int status = memcmp(srvActor, clActor, sizeof(netactor_t));
+        int status = cl_snapshot ? memcmp(srvActor, &(cl_snapshot->actor[actorIndex]), sizeof(netactor_t)) : 1;
 
         if(status == 0)
         {
@@ -2565,12 +2633,12 @@ static void Net_InitMapState(netmapstate_t* mapState)
         mapState->actor[index] = sprDefault;
     }
 
-    for (index = 0; index < MAXWALLS; index++)
+    for (index = 0; index < mapState->numWalls; index++)
     {
         mapState->wall[index] = cNullNetWall;
     }
 
-    for (index = 0; index < MAXSECTORS; index++)
+    for (index = 0; index < mapState->numSectors; index++)
     {
         mapState->sector[index] = cNullNetSector;
     }
@@ -2581,6 +2649,291 @@ static void Net_InitMapState(netmapstate_t* mapState)
 
 }
 
+// (re)allocate the arrays of a map state for the loaded map, zeroed
+static void Net_AllocMapState(netmapstate_t* mapState)
+{
+    Xfree(mapState->actor);
+    Xfree(mapState->wall);
+    Xfree(mapState->sector);
+
+    mapState->numWalls   = numwalls;
+    mapState->numSectors = numsectors;
+
+    mapState->actor  = (netactor_t *)Xcalloc(MAXSPRITES, sizeof(netactor_t));
+    mapState->wall   = (netWall_t *)Xcalloc(max<int32_t>(numwalls, 1), sizeof(netWall_t));
+    mapState->sector = (netSector_t *)Xcalloc(max<int32_t>(numsectors, 1), sizeof(netSector_t));
+}
+
+static void Net_FreeMapState(netmapstate_t* mapState)
+{
+    DO_FREE_AND_NULL(mapState->actor);
+    DO_FREE_AND_NULL(mapState->wall);
+    DO_FREE_AND_NULL(mapState->sector);
+
+    mapState->numWalls   = 0;
+    mapState->numSectors = 0;
+}
+
+static void Net_CopyMapState(netmapstate_t* to, const netmapstate_t* from)
+{
+    Bassert(to->numWalls == from->numWalls && to->numSectors == from->numSectors);
+
+    to->revisionNumber = from->revisionNumber;
+    to->maxActorIndex  = from->maxActorIndex;
+
+    Bmemcpy(to->actor, from->actor, sizeof(netactor_t) * MAXSPRITES);
+    Bmemcpy(to->wall, from->wall, sizeof(netWall_t) * from->numWalls);
+    Bmemcpy(to->sector, from->sector, sizeof(netSector_t) * from->numSectors);
+}
+
+static size_t Net_MapStateSize(const netmapstate_t* mapState)
+{
+    return sizeof(netactor_t) * MAXSPRITES + sizeof(netWall_t) * mapState->numWalls + sizeof(netSector_t) * mapState->numSectors;
+}
+
+//-------------------------------------------------------------------------------------
+// Map state history
+
+// collect the structs in state that differ from the ones in baseline
+static void Net_BuildSparse(netsparse_t* sparse, const void* state, const void* baseline, int32_t count, int32_t size)
+{
+    auto stateStruct    = (const uint8_t *)state;
+    auto baselineStruct = (const uint8_t *)baseline;
+
+    sparse->count = 0;
+
+    for (int32_t index = 0; index < count; index++, stateStruct += size, baselineStruct += size)
+    {
+        if (!Bmemcmp(stateStruct, baselineStruct, size))
+        {
+            continue;
+        }
+
+        if (sparse->count == sparse->capacity)
+        {
+            sparse->capacity = max(sparse->capacity * 2, 64);
+            sparse->index    = (uint16_t *)Xrealloc(sparse->index, sparse->capacity * sizeof(uint16_t));
+            sparse->data     = (uint8_t *)Xrealloc(sparse->data, sparse->capacity * size);
+        }
+
+        sparse->index[sparse->count] = index;
+        Bmemcpy(&sparse->data[sparse->count * size], stateStruct, size);
+        sparse->count++;
+    }
+
+    // give memory back once most of the map has gone back to looking like the baseline
+    if (sparse->capacity > 64 && sparse->count < (sparse->capacity >> 2))
+    {
+        sparse->capacity = max(sparse->count * 2, 64);
+        sparse->index    = (uint16_t *)Xrealloc(sparse->index, sparse->capacity * sizeof(uint16_t));
+        sparse->data     = (uint8_t *)Xrealloc(sparse->data, sparse->capacity * size);
+    }
+}
+
+static void Net_ApplySparse(const netsparse_t* sparse, void* state, int32_t size)
+{
+    for (int32_t entry = 0; entry < sparse->count; entry++)
+    {
+        Bmemcpy((uint8_t *)state + (size_t)sparse->index[entry] * size, &sparse->data[entry * size], size);
+    }
+}
+
+static void Net_RevertSparse(const netsparse_t* sparse, void* state, const void* baseline, int32_t size)
+{
+    for (int32_t entry = 0; entry < sparse->count; entry++)
+    {
+        size_t const offset = (size_t)sparse->index[entry] * size;
+
+        Bmemcpy((uint8_t *)state + offset, (const uint8_t *)baseline + offset, size);
+    }
+}
+
+static void Net_FreeSparse(netsparse_t* sparse)
+{
+    DO_FREE_AND_NULL(sparse->index);
+    DO_FREE_AND_NULL(sparse->data);
+
+    sparse->count    = 0;
+    sparse->capacity = 0;
+}
+
+static void Net_FreeHistory(netstatehistory_t* history)
+{
+    for (netrevision_t &revision : history->revision)
+    {
+        Net_FreeSparse(&revision.wall);
+        Net_FreeSparse(&revision.sector);
+        Net_FreeSparse(&revision.actor);
+
+        revision.isValid = 0;
+    }
+
+    Net_FreeMapState(&history->baseline);
+    Net_FreeMapState(&history->work);
+
+    history->haveBaseline = 0;
+    history->workSlot     = -1;
+}
+
+// take the work state back to the baseline
+static void Net_RevertWorkState(netstatehistory_t* history)
+{
+    if (history->workSlot < 0)
+    {
+        return;
+    }
+
+    netrevision_t const *revision = &history->revision[history->workSlot];
+
+    Net_RevertSparse(&revision->wall, history->work.wall, history->baseline.wall, sizeof(netWall_t));
+    Net_RevertSparse(&revision->sector, history->work.sector, history->baseline.sector, sizeof(netSector_t));
+    Net_RevertSparse(&revision->actor, history->work.actor, history->baseline.actor, sizeof(netactor_t));
+
+    history->workSlot = -1;
+}
+
+// store mapState as revision mapState->revisionNumber, replacing the one NET_REVISIONS before it
+static void Net_StoreRevision(netstatehistory_t* history, const netmapstate_t* mapState)
+{
+    if (!history->haveBaseline)
+    {
+        Net_AllocMapState(&history->baseline);
+        Net_AllocMapState(&history->work);
+
+        Net_CopyMapState(&history->baseline, mapState);
+        Net_CopyMapState(&history->work, mapState);
+
+        history->haveBaseline = 1;
+        history->workSlot     = -1;
+    }
+
+    Bassert(mapState->numWalls == history->baseline.numWalls && mapState->numSectors == history->baseline.numSectors);
+
+    int32_t const slot = mapState->revisionNumber % NET_REVISIONS;
+
+    // the work state can only be taken back to the baseline with the changes that were applied to it
+    if (history->workSlot == slot)
+    {
+        Net_RevertWorkState(history);
+    }
+
+    netrevision_t *revision = &history->revision[slot];
+
+    Net_BuildSparse(&revision->wall, mapState->wall, history->baseline.wall, mapState->numWalls, sizeof(netWall_t));
+    Net_BuildSparse(&revision->sector, mapState->sector, history->baseline.sector, mapState->numSectors, sizeof(netSector_t));
+    Net_BuildSparse(&revision->actor, mapState->actor, history->baseline.actor, MAXSPRITES, sizeof(netactor_t));
+
+    revision->revisionNumber = mapState->revisionNumber;
+    revision->maxActorIndex  = mapState->maxActorIndex;
+    revision->isValid        = 1;
+}
+
+static int32_t Net_HaveRevision(const netstatehistory_t* history, uint32_t revisionNumber)
+{
+    netrevision_t const *revision = &history->revision[revisionNumber % NET_REVISIONS];
+
+    return revision->isValid && revision->revisionNumber == revisionNumber;
+}
+
+// Put a revision back together from the baseline, returns nullptr if it isn't (or no longer is) in the history.
+// The returned state belongs to the history and is only good until the next call for it.
+static const netmapstate_t* Net_GetRevision(netstatehistory_t* history, uint32_t revisionNumber)
+{
+    if (!Net_HaveRevision(history, revisionNumber))
+    {
+        return nullptr;
+    }
+
+    int32_t const        slot     = revisionNumber % NET_REVISIONS;
+    netrevision_t const *revision = &history->revision[slot];
+
+    if (history->workSlot != slot)
+    {
+        Net_RevertWorkState(history);
+
+        Net_ApplySparse(&revision->wall, history->work.wall, sizeof(netWall_t));
+        Net_ApplySparse(&revision->sector, history->work.sector, sizeof(netSector_t));
+        Net_ApplySparse(&revision->actor, history->work.actor, sizeof(netactor_t));
+
+        history->workSlot = slot;
+    }
+
+    history->work.revisionNumber = revisionNumber;
+    history->work.maxActorIndex  = revision->maxActorIndex;
+
+    return &history->work;
+}
+
+static size_t Net_SparseSize(const netsparse_t* sparse, int32_t size)
+{
+    return sparse->capacity * (sizeof(uint16_t) + size);
+}
+
+static void Net_PrintHistoryMemory(const char* name, const netstatehistory_t* history)
+{
+    if (!history->haveBaseline)
+    {
+        OSD_Printf("%s: nothing stored\n", name);
+        return;
+    }
+
+    size_t const stateSize = Net_MapStateSize(&history->baseline);
+    size_t       revisionsSize = 0;
+    int32_t      numRevisions  = 0;
+    int32_t      newestSlot    = 0;
+
+    for (int32_t slot = 0; slot < NET_REVISIONS; slot++)
+    {
+        if (history->revision[slot].isValid && history->revision[slot].revisionNumber > history->revision[newestSlot].revisionNumber)
+        {
+            newestSlot = slot;
+        }
+    }
+
+    OSD_Printf("%s: baseline and work state %.1f KiB each\n", name, stateSize / 1024.0);
+
+    // oldest first
+    for (int32_t slotOffset = 1; slotOffset <= NET_REVISIONS; slotOffset++)
+    {
+        netrevision_t const *revision = &history->revision[(newestSlot + slotOffset) % NET_REVISIONS];
+
+        if (!revision->isValid)
+        {
+            continue;
+        }
+
+        size_t const revisionSize = Net_SparseSize(&revision->wall, sizeof(netWall_t)) + Net_SparseSize(&revision->sector, sizeof(netSector_t))
+                                    + Net_SparseSize(&revision->actor, sizeof(netactor_t));
+
+        OSD_Printf("  revision %u: %d walls, %d sectors, %d actors changed, %.1f KiB\n", revision->revisionNumber, revision->wall.count,
+                   revision->sector.count, revision->actor.count, revisionSize / 1024.0);
+
+        revisionsSize += revisionSize;
+        numRevisions++;
+    }
+
+    OSD_Printf("%s: %.1f KiB for %d revisions, %.1f KiB per revision\n", name, (stateSize * 2 + revisionsSize) / 1024.0, numRevisions,
+               numRevisions ? revisionsSize / 1024.0 / numRevisions : 0.0);
+}
+
+void Net_PrintHistoryStats(void)
+{
+    if (g_mapStartState == nullptr || g_mapStartState->actor == nullptr)
+    {
+        OSD_Printf("No map state history, start or join a multiplayer game first.\n");
+        return;
+    }
+
+    OSD_Printf("Initial and current map state: %.1f KiB each\n", Net_MapStateSize(g_mapStartState) / 1024.0);
+
+    Net_PrintHistoryMemory("Server snapshots", &g_mapStateHistory);
+
+    if (g_netClient)
+    {
+        Net_PrintHistoryMemory("Client states", &g_cl_InterpolatedMapStateHistory);
+    }
+}
+
 // Both client and server execute this
 static void Net_ResetPlayers()
 {
@@ -2635,6 +2988,13 @@ static void Net_ResetPlayerReady()
 
 #define	FLOAT_INT_BITS	13
 
+// signed size of a changed field sent as the difference from its old value
+#define NETDELTA_BITS   12
+
+// size of each entry of g_netPacketQuant in the world update header, and the most bits that may be dropped
+#define NETQUANT_BITS   4
+#define NETQUANT_MAX    8
+
 // remember that the minimum negative number is the sign bit + all zeros
 const int32_t cTruncInt_Min = -(1 << (FLOAT_INT_BITS - 1));
 const int32_t cTruncInt_Max = (1 << (FLOAT_INT_BITS - 1)) - 1;
@@ -3037,6 +3397,80 @@ EDUKE32_UNUSED static void NetBuffer_ReadData(NetBuffer_t *netBuffer, void *data
     }
 }
 
+// Changed integer fields are sent as
+//  {0}                 the field is zero
+//  {1, <value>}        the new value, for fields no wider than NETDELTA_BITS
+//  {1, 0, <delta>}     the difference from the old value, as a NETDELTA_BITS signed integer
+//  {1, 1, <value>}     the new value
+// Quantized fields leave out the low bits they dropped from the value, and from the difference as long as the
+// old value has them clear too. It always has unless it comes from the initial map state, which isn't quantized.
+// Fields narrower than 32 bits are read back without sign extension, the copy to the game arrays truncates them.
+
+static FORCE_INLINE uint32_t Net_FieldMask(int32_t bits) { return 0xffffffffu >> (32 - bits); }
+
+static FORCE_INLINE int32_t Net_SignExtend(uint32_t value, int32_t bits)
+{
+    return (int32_t)(value << (32 - bits)) >> (32 - bits);
+}
+
+static FORCE_INLINE int32_t Net_DeltaShift(int32_t fromValue, int32_t quant)
+{
+    return ((uint32_t)fromValue & ((1u << quant) - 1)) ? 0 : quant;
+}
+
+static void NetBuffer_WriteDeltaField(NetBuffer_t *netBuffer, const netField_t *field, int32_t fromValue, int32_t toValue)
+{
+    if (toValue == 0)
+    {
+        NetBuffer_WriteBits(netBuffer, 0, 1);                                          // {0}              zero this field
+        return;
+    }
+
+    NetBuffer_WriteBits(netBuffer, 1, 1);                                              // {1}              don't zero this field
+
+    int32_t const quant = g_netPacketQuant[field->quant];
+    int32_t const width = field->bits - quant;
+
+    Bassert(((uint32_t)toValue & ((1u << quant) - 1)) == 0);
+
+    if (width > NETDELTA_BITS)
+    {
+        uint32_t const difference = ((uint32_t)toValue - (uint32_t)fromValue) & Net_FieldMask(field->bits);
+        int32_t const  delta      = Net_SignExtend(difference, field->bits) >> Net_DeltaShift(fromValue, quant);
+
+        if (delta >= -(1 << (NETDELTA_BITS - 1)) && delta < (1 << (NETDELTA_BITS - 1)))
+        {
+            NetBuffer_WriteBits(netBuffer, 0, 1);                                      // {1, 0}           send the difference
+            NetBuffer_WriteBits(netBuffer, delta, NETDELTA_BITS);                      // {1, 0, <delta>}
+            return;
+        }
+
+        NetBuffer_WriteBits(netBuffer, 1, 1);                                          // {1, 1}           send the value
+    }
+
+    NetBuffer_WriteBits(netBuffer, toValue >> quant, width);                           // {1, (1,) <value>}
+}
+
+static int32_t NetBuffer_ReadDeltaField(NetBuffer_t *netBuffer, const netField_t *field, int32_t fromValue)
+{
+    if (NetBuffer_ReadBits(netBuffer, 1) == 0)
+    {
+        return 0;
+    }
+
+    int32_t const quant = g_netPacketQuant[field->quant];
+    int32_t const width = field->bits - quant;
+
+    if (width > NETDELTA_BITS && NetBuffer_ReadBits(netBuffer, 1) == 0)
+    {
+        int32_t const delta = Net_SignExtend(NetBuffer_ReadBits(netBuffer, NETDELTA_BITS), NETDELTA_BITS);
+
+        return (int32_t)(((uint32_t)fromValue + ((uint32_t)delta << Net_DeltaShift(fromValue, quant))) & Net_FieldMask(field->bits));
+    }
+
+    return (int32_t)(((uint32_t)NetBuffer_ReadBits(netBuffer, width) << quant) & Net_FieldMask(field->bits));
+}
+
 // net struct -> Buffer functions
 //----------------------------------------------------------------------------------------------------------
 
@@ -3067,6 +3501,12 @@ static void NetBuffer_WriteDeltaNetWall(NetBuffer_t *netBuffer, const netWall_t
         return;
     }
 
+    // most of the map doesn't change from one revision to the next
+    if (!Bmemcmp(from, to, sizeof(*to)))
+    {
+        return;
+    }
+
     maxChgIndex = 0;
 
     for (fieldIndex = 0, fieldPtr = WallFields; fieldIndex < cFieldsInStruct; fieldIndex++, fieldPtr++)
@@ -3103,16 +3543,7 @@ static void NetBuffer_WriteDeltaNetWall(NetBuffer_t *netBuffer, const netWall_t
         }
 
         NetBuffer_WriteBits(netBuffer, 1, 1);                           // field changed
-
-        if (*toField == 0)
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                       // zero this field
-        }
-        else
-        {
-            NetBuffer_WriteBits(netBuffer, 1, 1);                       // don't zero this field
-            NetBuffer_WriteBits(netBuffer, *toField, fieldPtr->bits);   // new field value
-        }
+        NetBuffer_WriteDeltaField(netBuffer, fieldPtr, *fromField, *toField);
 
     }
 }
@@ -3144,6 +3575,12 @@ static void NetBuffer_WriteDeltaNetSector(NetBuffer_t *netBuffer, const netSecto
         return;
     }
 
+    // most of the map doesn't change from one revision to the next
+    if (!Bmemcmp(from, to, sizeof(*to)))
+    {
+        return;
+    }
+
     maxChgIndex = 0;
 
     for (fieldIndex = 0, fieldPtr = SectorFields; fieldIndex < cFieldsInStruct; fieldIndex++, fieldPtr++)
@@ -3180,16 +3617,7 @@ static void NetBuffer_WriteDeltaNetSector(NetBuffer_t *netBuffer, const netSecto
         }
 
         NetBuffer_WriteBits(netBuffer, 1, 1);                           // field changed
-
-        if (*toField == 0)
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                       // zero this field
-        }
-        else
-        {
-            NetBuffer_WriteBits(netBuffer, 1, 1);                       // don't zero this field
-            NetBuffer_WriteBits(netBuffer, *toField, fieldPtr->bits);      // new field value
-        }
+        NetBuffer_WriteDeltaField(netBuffer, fieldPtr, *fromField, *toField);
 
     }
 }
@@ -3239,6 +3667,11 @@ static void NetBuffer_WriteDeltaNetActor(NetBuffer_t* netBuffer, const netactor_
         return;
     }
 
+    if (!writeDeletedActors && !Bmemcmp(from, to, sizeof(*to)))
+    {
+        return;
+    }
+
     maxChgIndex = 0;
 
     for (fieldIndex = 0, fieldPtr = ActorFields; fieldIndex < cFieldsInStruct; fieldIndex++, fieldPtr++)
@@ -3309,18 +3742,7 @@ static void NetBuffer_WriteDeltaNetActor(NetBuffer_t* netBuffer, const netactor_
         }
         else
         {
-            if (*toField == 0)
-            {
-                NetBuffer_WriteBits(netBuffer, 0, 1);                                    // {1, 0}           Zero this field
-
-            }
-            else
-            {
-                NetBuffer_WriteBits(netBuffer, 1, 1);                                    // {1, 1}           don't zero this int field
-                NetBuffer_WriteBits(netBuffer, *toField, fieldPtr->bits);                    // {1, 1, <value>}  new field value
-
-            }
-
+            NetBuffer_WriteDeltaField(netBuffer, fieldPtr, *fromField, *toField);       // {1, <see NetBuffer_WriteDeltaField>}
         }
 
     }
@@ -3496,19 +3918,7 @@ static void NetBuffer_ReadDeltaWall(NetBuffer_t *netBuffer, const netWall_t *fro
         // field has changed
         else
         {
-            // zero the field
-            if (NetBuffer_ReadBits(netBuffer, 1) == 0)
-            {
-                *toField = 0;
-
-            }
-
-            // read the whole field
-            else
-            {
-                *toField = NetBuffer_ReadBits(netBuffer, field->bits);
-
-            }
+            *toField = NetBuffer_ReadDeltaField(netBuffer, field, *fromField);
 
         }
     }
@@ -3581,19 +3991,7 @@ static void NetBuffer_ReadDeltaSector(NetBuffer_t *netBuffer, const netSector_t
         // field has changed
         else
         {
-            // zero the field
-            if (NetBuffer_ReadBits(netBuffer, 1) == 0)
-            {
-                *toField = 0;
-
-            }
-
-            // read the whole field
-            else
-            {
-                *toField = NetBuffer_ReadBits(netBuffer, field->bits);
-
-            }
+            *toField = NetBuffer_ReadDeltaField(netBuffer, field, *fromField);
 
         }
     }
@@ -3738,19 +4136,7 @@ static void NetBuffer_ReadDeltaActor(NetBuffer_t* netBuffer, const netactor_t *f
             else
             {
 
-                // zero the field
-                if (NetBuffer_ReadBits(netBuffer, 1) == 0)
-                {
-                    *toField = 0;
-
-                }
-
-                // read the whole field
-                else
-                {
-                    *toField = NetBuffer_ReadBits(netBuffer, field->bits);
-
-                }
+                *toField = NetBuffer_ReadDeltaField(netBuffer, field, *fromField);
             }
 
         }
@@ -3777,7 +4163,7 @@ static void NetBuffer_ReadDeltaActor(NetBuffer_t* netBuffer, const netactor_t *f
 
 // Using oldSnapshot as the "From" snapshot, parse the data in netBuffer as a diff from
 // oldSnapshot to make newSnapshot.
-static void Net_ParseWalls(NetBuffer_t *netBuffer, netmapstate_t *oldSnapshot, netmapstate_t *newSnapshot)
+static void Net_ParseWalls(NetBuffer_t *netBuffer, const netmapstate_t *oldSnapshot, netmapstate_t *newSnapshot)
 {
     Bassert(oldSnapshot != nullptr);
     Bassert(newSnapshot != nullptr);
@@ -3895,7 +4281,7 @@ static void Net_ParseWalls(NetBuffer_t *netBuffer, netmapstate_t *oldSnapshot, n
 
 }
 
-static void Net_ParseSectors(NetBuffer_t *netBuffer, netmapstate_t *oldSnapshot, netmapstate_t *newSnapshot)
+static void Net_ParseSectors(NetBuffer_t *netBuffer, const netmapstate_t *oldSnapshot, netmapstate_t *newSnapshot)
 {
     Bassert(oldSnapshot != nullptr);
     Bassert(newSnapshot != nullptr);
@@ -4157,7 +4543,7 @@ static void Net_ParseActors(NetBuffer_t *netBuffer, const netmapstate_t* oldSnap
 
 
 
-static void NetBuffer_ReadWorldSnapshotFromBuffer(NetBuffer_t* netBuffer, netmapstate_t* oldSnapshot, netmapstate_t* newSnapshot)
+static void NetBuffer_ReadWorldSnapshotFromBuffer(NetBuffer_t* netBuffer, const netmapstate_t* oldSnapshot, netmapstate_t* newSnapshot)
 {
     Bassert(oldSnapshot != nullptr);
     Bassert(newSnapshot != nullptr);
@@ -4170,23 +4556,32 @@ static void NetBuffer_ReadWorldSnapshotFromBuffer(NetBuffer_t* netBuffer, netmap
 }
 
 
-static void Net_SendWorldUpdate(uint32_t fromRevisionNumber, uint32_t toRevisionNumber, int32_t sendToPlayerIndex)
+// the revision a world update to a client that acknowledged fromRevisionNumber is encoded against
+static uint32_t Net_GetDeltaBaseRevision(uint32_t fromRevisionNumber, uint32_t toRevisionNumber)
 {
-    if (sendToPlayerIndex == myconnectindex)
-    {
-        return;
-    }
-
-    Bassert(tempnetbuf != nullptr);
-    Bassert(NET_REVISIONS == ARRAY_SIZE(g_mapStateHistory));
+    Bassert(NET_REVISIONS == ARRAY_SIZE(g_mapStateHistory.revision));
 
-    uint32_t        playerRevisionIsTooOld = (toRevisionNumber - fromRevisionNumber) > NET_REVISIONS;
+    // NET_REVISIONS back is the history slot toRevisionNumber was just stored in
+    uint32_t        playerRevisionIsTooOld = (toRevisionNumber - fromRevisionNumber) >= NET_REVISIONS
+                                             || !Net_HaveRevision(&g_mapStateHistory, fromRevisionNumber);
 
     // to avoid the client thinking that revision 2 is older than revision 0xFFFF_FFFF,
     // send packets to take the client from the map's initial state until the client reports back
     // that it's beyond that rollover threshold.
     uint32_t        revisionInRolloverState = (fromRevisionNumber > toRevisionNumber);
 
+    if (playerRevisionIsTooOld || revisionInRolloverState)
+    {
+        return cInitialMapStateRevisionNumber;
+    }
+
+    return fromRevisionNumber;
+}
+
+// fromRevisionNumber must come from Net_GetDeltaBaseRevision()
+static ENetPacket *Net_CreateWorldUpdatePacket(uint32_t fromRevisionNumber, const netmapstate_t* toMapState)
+{
+    Bassert(tempnetbuf != nullptr);
 
     NetBuffer_t     buffer;
     NetBuffer_t*    bufferPtr = &buffer;
@@ -4194,65 +4589,48 @@ static void Net_SendWorldUpdate(uint32_t fromRevisionNumber, uint32_t toRevision
     // note: not enough stack memory to put the world data as a local variable
     uint8_t*        byteBuffer = &tempnetbuf[1];
 
-
-    uint32_t        fromRevisionNumberToSend = 0x86753090;
-
-    netmapstate_t*  toMapState = g_mapStateHistory[toRevisionNumber % NET_REVISIONS];
-    netmapstate_t*  fromMapState = NULL;
+    const netmapstate_t*  fromMapState = NULL;
 
     Bassert(toMapState != nullptr);
 
     NET_75_CHECK++; // during the rollover state it might be a good idea to init the map state history?
                     // maybe not? I do init map states before using them, so it might not be needed.
 
-
-    if (playerRevisionIsTooOld || revisionInRolloverState)
+    if (fromRevisionNumber == cInitialMapStateRevisionNumber)
     {
         fromMapState = g_mapStartState;
-        fromRevisionNumberToSend = cInitialMapStateRevisionNumber;
     }
     else
     {
-        uint32_t tFromRevisionIndex = fromRevisionNumber % NET_REVISIONS;
-
-        fromMapState = g_mapStateHistory[tFromRevisionIndex];
-        fromRevisionNumberToSend = fromRevisionNumber;
+        fromMapState = Net_GetRevision(&g_mapStateHistory, fromRevisionNumber);
     }
 
     Bassert(fromMapState != nullptr);
 
-    Bmemset(byteBuffer, 0, sizeof(tempnetbuf) - 1);
+    Bmemset(byteBuffer, 0, MAX_WORLDBUFFER - 1);
 
     tempnetbuf[0] = PACKET_WORLD_UPDATE;
 
-    NetBuffer_Init(bufferPtr, byteBuffer, MAX_WORLDBUFFER);
+    // the packet type byte comes first
+    NetBuffer_Init(bufferPtr, byteBuffer, MAX_WORLDBUFFER - 1);
 
-    NetBuffer_WriteDword(bufferPtr, fromRevisionNumberToSend);
-    NetBuffer_WriteDword(bufferPtr, toRevisionNumber);
+    NetBuffer_WriteDword(bufferPtr, fromRevisionNumber);
+    NetBuffer_WriteDword(bufferPtr, toMapState->revisionNumber);
 
-    Net_WriteWorldToBuffer(bufferPtr, fromMapState, toMapState);
+    NetBuffer_WriteBits(bufferPtr, g_netPacketQuant[NETQUANT_POS], NETQUANT_BITS);
+    NetBuffer_WriteBits(bufferPtr, g_netPacketQuant[NETQUANT_ANG], NETQUANT_BITS);
 
-    if (sendToPlayerIndex > ((int32_t) g_netServer->peerCount))
-    {
-        Net_Error_Disconnect("No peer for player.");
-        return;
-    }
+    Net_WriteWorldToBuffer(bufferPtr, fromMapState, toMapState);
 
     // in the future we could probably use these flags for enet_peer_send, for the world updates
     EDUKE32_UNUSED const ENetPacketFlag optimizedFlags = (ENetPacketFlag)(ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
 
-    NET_75_CHECK++; // HACK: I Really need to keep the peer with the player instead of assuming that the peer index is the same as the (player index - 1)
-    ENetPeer *const tCurrentPeer = &g_netServer->peers[sendToPlayerIndex - 1];
-    enet_peer_send(tCurrentPeer, CHAN_GAMESTATE, enet_packet_create(&tempnetbuf, bufferPtr->CurSize + 1, 0));
-    Dbg_PacketSent(PACKET_WORLD_UPDATE);
-
-
+    return enet_packet_create(tempnetbuf, bufferPtr->CurSize + 1, 0);
 }
 
-static void Net_CopySnapshotToGameArrays(netmapstate_t* srv_snapshot, netmapstate_t* cl_snapshot)
+static void Net_CopySnapshotToGameArrays(const netmapstate_t* srv_snapshot, const netmapstate_t* cl_snapshot)
 {
     Bassert(srv_snapshot != nullptr);
-    Bassert(cl_snapshot != nullptr);
 
     int32_t index;
 
@@ -4262,10 +4640,9 @@ static void Net_CopySnapshotToGameArrays(netmapstate_t* srv_snapshot, netmapstat
 
     for (index = 0; index < numwalls; index++)
     {
-        netWall_t*  srvWall = &(srv_snapshot->wall[index]);
-        netWall_t*  clWall  = &(cl_snapshot->wall[index]);
+        const netWall_t*  srvWall = &(srv_snapshot->wall[index]);
 
-        int status = memcmp(srvWall, clWall, sizeof(netWall_t));
+        int status = cl_snapshot ? memcmp(srvWall, &(cl_snapshot->wall[index]), sizeof(netWall_t)) : 1;
 
         if(status == 0)
         {
@@ -4284,10 +4661,9 @@ static void Net_CopySnapshotToGameArrays(netmapstate_t* srv_snapshot, netmapstat
 
     for (index = 0; index < numsectors; index++)
     {
-        netSector_t*  srvSector = &(srv_snapshot->sector[index]);
-        netSector_t*  clSector  = &(cl_snapshot->sector[index]);
+        const netSector_t*  srvSector = &(srv_snapshot->sector[index]);
 
-        int status = memcmp(srvSector, clSector, sizeof(netSector_t));
+        int status = cl_snapshot ? memcmp(srvSector, &(cl_snapshot->sector[index]), sizeof(netSector_t)) : 1;
 
         if(status == 0)
         {
@@ -4332,11 +4708,20 @@ static void Net_ReadWorldUpdate(uint8_t* packetData, int32_t packetSize)
     uint32_t packetFromRevisionNumber = NetBuffer_ReadDWord(bufferPtr);
     uint32_t packetToRevisionNumber = NetBuffer_ReadDWord(bufferPtr);
 
+    g_netPacketQuant[NETQUANT_POS] = NetBuffer_ReadBits(bufferPtr, NETQUANT_BITS);
+    g_netPacketQuant[NETQUANT_ANG] = NetBuffer_ReadBits(bufferPtr, NETQUANT_BITS);
+
+    if (g_netPacketQuant[NETQUANT_POS] > NETQUANT_MAX || g_netPacketQuant[NETQUANT_ANG] > NETQUANT_MAX)
+    {
+        Net_Error_Disconnect("Internal Error: Net_ReadWorldUpdate(): Bad quantization in world update.");
+        return;
+    }
+
     uint32_t from_IsInitialState = (packetFromRevisionNumber == cInitialMapStateRevisionNumber);
 
-    uint32_t clientRevisionIsTooOld = (packetToRevisionNumber - g_netMapRevisionNumber) > NET_REVISIONS;
+    uint32_t clientRevisionIsTooOld = (packetToRevisionNumber - g_netMapRevisionNumber) >= NET_REVISIONS;
 
-    netmapstate_t* fromMapState = NULL;
+    const netmapstate_t* fromMapState = NULL;
 
     if (clientRevisionIsTooOld && !from_IsInitialState)
     {
@@ -4368,26 +4753,31 @@ static void Net_ReadWorldUpdate(uint8_t* packetData, int32_t packetSize)
     }
     else
     {
-        fromMapState = g_mapStateHistory[packetFromRevisionNumber % NET_REVISIONS];
-    }
+        fromMapState = Net_GetRevision(&g_mapStateHistory, packetFromRevisionNumber);
 
+        if (fromMapState == nullptr)
+        {
+            // we never stored that revision, or it's been replaced since. The server will send a diff
+            // from a revision we have, or from the initial state, once our acks catch up.
+            return;
+        }
+    }
 
-    netmapstate_t* toMapState = g_mapStateHistory[packetToRevisionNumber % NET_REVISIONS];
-    netmapstate_t* clMapState = g_cl_InterpolatedMapStateHistory[packetToRevisionNumber % NET_REVISIONS];
-
-    Bassert(toMapState != nullptr);
-    Bassert(clMapState != nullptr);
 
-    toMapState->revisionNumber = packetToRevisionNumber;
+    netmapstate_t* toMapState = &g_netCurrentMapState;
 
     NET_DEBUG_VAR uint32_t DEBUG_OldClientRevision = g_netMapRevisionNumber;
 
     Bassert(fromMapState);
     NetBuffer_ReadWorldSnapshotFromBuffer(bufferPtr, fromMapState, toMapState);
 
+    toMapState->revisionNumber = packetToRevisionNumber;
+
+    Net_StoreRevision(&g_mapStateHistory, toMapState);
+
     g_netMapRevisionNumber = packetToRevisionNumber;
 
-    Net_CopySnapshotToGameArrays(toMapState, clMapState);
+    Net_CopySnapshotToGameArrays(toMapState, Net_GetRevision(&g_cl_InterpolatedMapStateHistory, packetToRevisionNumber));
 
 }
 
@@ -4571,15 +4961,114 @@ void Net_StoreClientState(void)
 
     g_cl_InterpolatedRevision = Net_GetNextRevisionNumber(g_cl_InterpolatedRevision);
 
-    netmapstate_t* currentMapState = g_cl_InterpolatedMapStateHistory[g_cl_InterpolatedRevision % NET_REVISIONS];
-
-    Bassert(currentMapState != nullptr);
+    netmapstate_t* currentMapState = &g_netCurrentMapState;
 
-    Net_InitMapState(currentMapState);
+    // every wall, sector and actor the snapshot is compared on gets overwritten, no need to init it first
     Net_AddWorldToSnapshot(currentMapState);
 
     currentMapState->revisionNumber = g_cl_InterpolatedRevision;
 
+    Net_StoreRevision(&g_cl_InterpolatedMapStateHistory, currentMapState);
+
+}
+
+// round to the nearest multiple of 1 << bits
+static FORCE_INLINE int32_t Net_QuantizeValue(int32_t value, int32_t bits)
+{
+    if (bits == 0)
+    {
+        return value;
+    }
+
+    uint32_t const half = 1u << (bits - 1);
+
+    return (int32_t)(((uint32_t)value + half) & ~((half << 1) - 1));
+}
+
+// must match the fields marked NETQUANT_POS and NETQUANT_ANG in ActorFields
+static void Net_QuantizeActors(netmapstate_t* snapshot)
+{
+    int32_t const posBits = g_netPacketQuant[NETQUANT_POS];
+    int32_t const angBits = g_netPacketQuant[NETQUANT_ANG];
+
+    if (!posBits && !angBits)
+    {
+        return;
+    }
+
+    for (int32_t actorIndex = 0; actorIndex < snapshot->maxActorIndex; actorIndex++)
+    {
+        netactor_t* netActor = &snapshot->actor[actorIndex];
+
+        netActor->spr_x  = Net_QuantizeValue(netActor->spr_x, posBits);
+        netActor->spr_y  = Net_QuantizeValue(netActor->spr_y, posBits);
+        netActor->spr_z  = Net_QuantizeValue(netActor->spr_z, posBits);
+        netActor->bpos_x = Net_QuantizeValue(netActor->bpos_x, posBits);
+        netActor->bpos_y = Net_QuantizeValue(netActor->bpos_y, posBits);
+        netActor->bpos_z = Net_QuantizeValue(netActor->bpos_z, posBits);
+
+        if (angBits)
+        {
+            netActor->spr_ang = Net_QuantizeValue(netActor->spr_ang, angBits) & 2047;
+        }
+    }
+}
+
+static void Net_ResetSnapshotStats(void)
+{
+    Bmemset(g_netClientStats, 0, sizeof(g_netClientStats));
+
+    g_netStatsStartTicks = timerGetNanoTicks();
+    g_netSnapshotTicks   = 0;
+    g_netEncodeTicks     = 0;
+    g_netMaxUpdateTicks  = 0;
+    g_netStatsUpdates    = 0;
+    g_netStatsEncodes    = 0;
+}
+
+void Net_PrintSnapshotStats(int32_t reset)
+{
+    if (!g_netServer)
+    {
+        OSD_Printf("Snapshot stats are only kept on the server.\n");
+        return;
+    }
+
+    double const tickRate = (double)timerGetNanoTickRate();
+    double const seconds  = (timerGetNanoTicks() - g_netStatsStartTicks) / tickRate;
+
+    OSD_Printf("%u world updates in %.1f seconds, quantizing positions by %d bits and angles by %d bits\n", g_netStatsUpdates,
+               seconds, g_netPacketQuant[NETQUANT_POS], g_netPacketQuant[NETQUANT_ANG]);
+
+    if (g_netStatsUpdates)
+    {
+        OSD_Printf("  snapshot %.1f us, encode %.1f us (%.2f encodes) per update, %.1f us max\n",
+                   g_netSnapshotTicks * 1000000.0 / tickRate / g_netStatsUpdates,
+                   g_netEncodeTicks * 1000000.0 / tickRate / g_netStatsUpdates,
+                   (double)g_netStatsEncodes / g_netStatsUpdates,
+                   g_netMaxUpdateTicks * 1000000.0 / tickRate);
+    }
+
+    int32_t playerIndex = 0;
+
+    for (TRAVERSE_CONNECT(playerIndex))
+    {
+        netclientstats_t const &stats = g_netClientStats[playerIndex];
+
+        if (stats.updates == 0)
+        {
+            continue;
+        }
+
+        OSD_Printf("  %2d %-16s %7.0f bytes/update avg %7u max %8.0f bytes/s, %u from initial state\n", playerIndex,
+                   g_player[playerIndex].user_name, (double)stats.bytes / stats.updates, stats.maxBytes,
+                   seconds > 0.0 ? stats.bytes / seconds : 0.0, stats.fromInitialState);
+    }
+
+    if (reset)
+    {
+        Net_ResetSnapshotStats();
+    }
 }
 
 void Net_SendMapUpdate(void)
@@ -4589,17 +5078,33 @@ void Net_SendMapUpdate(void)
         return;
     }
 
+    uint64_t const updateStartTicks = timerGetNanoTicks();
+
     g_netMapRevisionNumber = Net_GetNextRevisionNumber(g_netMapRevisionNumber);
 
-    netmapstate_t* toMapState = g_mapStateHistory[g_netMapRevisionNumber % NET_REVISIONS];
+    netmapstate_t* toMapState = &g_netCurrentMapState;
 
-    Bassert(toMapState != nullptr);
+    // picked up once per revision, the header of every update to it has to match its snapshot
+    g_netPacketQuant[NETQUANT_POS] = clamp(g_netQuantizePos, 0, NETQUANT_MAX);
+    g_netPacketQuant[NETQUANT_ANG] = clamp(g_netQuantizeAng, 0, NETQUANT_MAX);
 
-    Net_InitMapState(toMapState);
+    // every wall, sector and actor the snapshot is compared on gets overwritten, no need to init it first
     Net_AddWorldToSnapshot(toMapState);
+    Net_QuantizeActors(toMapState);
 
     toMapState->revisionNumber = g_netMapRevisionNumber;
 
+    Net_StoreRevision(&g_mapStateHistory, toMapState);
+
+    uint64_t const encodeStartTicks = timerGetNanoTicks();
+
+    g_netSnapshotTicks += encodeStartTicks - updateStartTicks;
+
+    // clients that acknowledged the same revision get the same update, encode it only once for all of them
+    uint32_t    updateFromRevision[MAXPLAYERS];
+    ENetPacket* updatePacket[MAXPLAYERS];
+    int32_t     numUpdates = 0;
+
     int32_t playerIndex = 0;
 
     for (TRAVERSE_CONNECT(playerIndex))
@@ -4610,13 +5115,67 @@ void Net_SendMapUpdate(void)
             continue;
         }
 
-        uint32_t playerRevisionNumber = g_player[playerIndex].revision;
+        if (playerIndex > ((int32_t) g_netServer->peerCount))
+        {
+            Net_Error_Disconnect("No peer for player.");
+            break;
+        }
+
+        uint32_t const fromRevisionNumber = Net_GetDeltaBaseRevision(g_player[playerIndex].revision, g_netMapRevisionNumber);
+
+        int32_t updateIndex = 0;
+
+        while (updateIndex < numUpdates && updateFromRevision[updateIndex] != fromRevisionNumber)
+        {
+            updateIndex++;
+        }
+
+        if (updateIndex == numUpdates)
+        {
+            updateFromRevision[numUpdates] = fromRevisionNumber;
+            updatePacket[numUpdates++]     = Net_CreateWorldUpdatePacket(fromRevisionNumber, toMapState);
+        }
+
+        ENetPacket *const packet = updatePacket[updateIndex];
+
+        NET_75_CHECK++; // HACK: I Really need to keep the peer with the player instead of assuming that the peer index is the same as the (player index - 1)
+        ENetPeer *const tCurrentPeer = &g_netServer->peers[playerIndex - 1];
+        enet_peer_send(tCurrentPeer, CHAN_GAMESTATE, packet);
+        Dbg_PacketSent(PACKET_WORLD_UPDATE);
+
+        netclientstats_t &stats = g_netClientStats[playerIndex];
+
+        stats.updates++;
+        stats.bytes += packet->dataLength;
+        stats.maxBytes = max<uint32_t>(stats.maxBytes, packet->dataLength);
+        stats.fromInitialState += (fromRevisionNumber == cInitialMapStateRevisionNumber);
+    }
 
-        Net_SendWorldUpdate(playerRevisionNumber, g_netMapRevisionNumber, playerIndex);
+    // enet_peer_send() takes a reference on success, like enet_host_broadcast() clean up after failed sends
+    for (int32_t updateIndex = 0; updateIndex < numUpdates; updateIndex++)
+    {
+        if (updatePacket[updateIndex]->referenceCount == 0)
+        {
+            enet_packet_destroy(updatePacket[updateIndex]);
+        }
     }
 
+    uint64_t const updateEndTicks = timerGetNanoTicks();
+
+    g_netEncodeTicks   += updateEndTicks - encodeStartTicks;
+    g_netMaxUpdateTicks = max(g_netMaxUpdateTicks, updateEndTicks - updateStartTicks);
+    g_netStatsEncodes  += numUpdates;
+    g_netStatsUpdates++;
 }
 
+static void Net_WriteMapState(FILE* mapStatesFile, const netmapstate_t* mapState)
+{
+    fwrite(&mapState->revisionNumber, sizeof(mapState->revisionNumber), 1, mapStatesFile);
+    fwrite(&mapState->maxActorIndex, sizeof(mapState->maxActorIndex), 1, mapStatesFile);
+    fwrite(mapState->actor, sizeof(netactor_t), MAXSPRITES, mapStatesFile);
+    fwrite(mapState->wall, sizeof(netWall_t), mapState->numWalls, mapStatesFile);
+    fwrite(mapState->sector, sizeof(netSector_t), mapState->numSectors, mapStatesFile);
+}
 
 void DumpMapStateHistory()
 {
@@ -4636,10 +5195,15 @@ void DumpMapStateHistory()
     // write the null map state (it should never, ever be changed, but just for completeness sake
     // fwrite(&NullMapState, sizeof(NullMapState), 1, mapStatesFile);
 
-    fwrite(g_mapStartState, sizeof(g_mapStartState), 1, mapStatesFile);
+    if (g_mapStartState != nullptr && g_mapStartState->actor != nullptr)
+        Net_WriteMapState(mapStatesFile, g_mapStartState);
 
-    for (int mapStateIndex = 0; mapStateIndex < NET_REVISIONS; mapStateIndex++)
-        fwrite(g_mapStateHistory[mapStateIndex], sizeof(netmapstate_t), 1, mapStatesFile);
+    // only the revisions still in the history, each put back together in full
+    for (netrevision_t const &revision : g_mapStateHistory.revision)
+    {
+        if (revision.isValid)
+            Net_WriteMapState(mapStatesFile, Net_GetRevision(&g_mapStateHistory, revision.revisionNumber));
+    }
 
     OSD_Printf("Dumped map states to %s.\n", fileName);
 
@@ -5156,33 +5720,24 @@ void Net_SendMessage(void)
 
 void Net_InitMapStateHistory()
 {
-    int32_t mapStateIndex = 0;
-
-    for (mapStateIndex = 0; mapStateIndex < NET_REVISIONS; mapStateIndex++)
-    {
-        if (g_mapStateHistory[mapStateIndex] == nullptr)
-            g_mapStateHistory[mapStateIndex] = (netmapstate_t *)Xcalloc(1, sizeof(netmapstate_t));
-
-        netmapstate_t *mapState = g_mapStateHistory[mapStateIndex];
-
-        if (g_cl_InterpolatedMapStateHistory[mapStateIndex] == nullptr)
-            g_cl_InterpolatedMapStateHistory[mapStateIndex] = (netmapstate_t *)Xcalloc(1, sizeof(netmapstate_t));
-
-        netmapstate_t *clState  = g_cl_InterpolatedMapStateHistory[mapStateIndex];
-
-        Net_InitMapState(mapState);
-        Net_InitMapState(clState);
-    }
+    Net_FreeHistory(&g_mapStateHistory);
+    Net_FreeHistory(&g_cl_InterpolatedMapStateHistory);
 
     if (g_mapStartState == nullptr)
         g_mapStartState = (netmapstate_t *)Xcalloc(1, sizeof(netmapstate_t));
 
+    // sized for the map that was just loaded
+    Net_AllocMapState(g_mapStartState);
+    Net_AllocMapState(&g_netCurrentMapState);
+
     Net_InitMapState(g_mapStartState);
 
     g_mapStartState->revisionNumber = cInitialMapStateRevisionNumber;
 
     g_netMapRevisionNumber    = cInitialMapStateRevisionNumber;  // Net_InitMapStateHistory()
     g_cl_InterpolatedRevision = cInitialMapStateRevisionNumber;
+
+    Net_ResetSnapshotStats();
 }
 
 void Net_StartNewGame()
@@ -34,7 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "enet.h"
 
 // net packet specification/compatibility version
-#define NETVERSION    1
+#define NETVERSION    2
 
 extern ENetHost       *g_netClient;
 extern ENetHost       *g_netServer;
@@ -177,21 +177,17 @@ typedef struct netSector_s
         extra;
 } netSector_t;
 
-const uint64_t cSnapshotMemUsage = NET_REVISIONS *	(
-                                                            (sizeof(netWall_t) * MAXWALLS)
-                                                        +   (sizeof(netSector_t)  * MAXSECTORS)
-                                                        +   (sizeof(netactor_t) * MAXSPRITES)
-                                                    );
-
-
+// the arrays are sized for the loaded map, see Net_AllocMapState()
 #pragma pack(push,1)
 typedef struct netmapstate_s
 {
     uint32_t revisionNumber;
     int32_t maxActorIndex;
-    netactor_t actor[MAXSPRITES];
-    netWall_t wall[MAXWALLS];
-    netSector_t sector[MAXSECTORS];
+    int32_t numWalls;
+    int32_t numSectors;
+    netactor_t *actor;      // MAXSPRITES
+    netWall_t *wall;        // numWalls
+    netSector_t *sector;    // numSectors
 
 } netmapstate_t;
 
@@ -240,6 +236,10 @@ extern newgame_t pendingnewgame;
 
 #ifndef NETCODE_DISABLE
 
+// bits the server drops from actor positions and angles in world updates, 0 sends them as they are
+extern int32_t g_netQuantizePos;
+extern int32_t g_netQuantizeAng;
+
 // Connect/Disconnect
 void    Net_Connect(const char *srvaddr);
 
@@ -291,6 +291,8 @@ void Net_AddWorldToInitialSnapshot();
 int32_t Dbg_PacketSent(enum DukePacket_t iPacketType);
 
 void DumpMapStateHistory();
+void Net_PrintSnapshotStats(int32_t reset);
+void Net_PrintHistoryStats(void);
 
 void Net_WaitForInitialSnapshot();
 
@@ -342,6 +344,8 @@ void Net_WaitForInitialSnapshot();
 #define Net_InitMapStateHistory(...) ((void)0)
 #define Net_AddWorldToInitialSnapshot(...) ((void)0)
 #define DumpMapStateHistory(...) ((void)0)
+#define Net_PrintSnapshotStats(...) ((void)0)
+#define Net_PrintHistoryStats(...) ((void)0)
 
 
 
@@ -1184,6 +1184,25 @@ static int osdcmd_dumpmapstate(osdfuncparm_t const * const)
     return OSDCMD_OK;
 }
 
+static int osdcmd_snapshotstats(osdcmdptr_t parm)
+{
+    if (parm->numparms > 1 || (parm->numparms == 1 && Bstrcasecmp(parm->parms[0], "reset")))
+        return OSDCMD_SHOWHELP;
+
+    Net_PrintSnapshotStats(parm->numparms == 1);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_historystats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    Net_PrintHistoryStats();
+
+    return OSDCMD_OK;
+}
+
 static int osdcmd_playerinfo(osdfuncparm_t const * const)
 {
     LOG_F(INFO, "Your player index is %d.", myconnectindex);
@@ -1602,6 +1621,9 @@ int32_t registerosdcommands(void)
         { "cl_autovote", "automatic vote yes for multiplayer map changes" CVAR_BOOL_OPTSTR, (void *)&ud.autovote, CVAR_BOOL, 0, 1 },
         { "cl_obituaries", "print player death messages in multiplayer" CVAR_BOOL_OPTSTR, (void *)&ud.obituaries, CVAR_BOOL, 0, 1 },
         { "cl_idplayers", "display player names when aiming at opponents in multiplayer" CVAR_BOOL_OPTSTR, (void *)&ud.idplayers, CVAR_BOOL, 0, 1 },
+
+        { "net_quantize_pos", "low bits of actor positions left out of world updates sent by the server", (void *)&g_netQuantizePos, CVAR_INT, 0, 8 },
+        { "net_quantize_ang", "low bits of actor angles left out of world updates sent by the server", (void *)&g_netQuantizeAng, CVAR_INT, 0, 4 },
 #endif
 
         { "cl_cheatmask", "bitmask controlling cheats unlocked in menu", (void *)&cl_cheatmask, CVAR_UINT, 0, ~0 },
@@ -1773,6 +1795,8 @@ int32_t registerosdcommands(void)
     OSD_RegisterFunction("kickban","kickban <id>: kicks a multiplayer client and prevents them from reconnecting.  See listplayers.", osdcmd_kickban);
 #endif
     OSD_RegisterFunction("listplayers","listplayers: lists currently connected multiplayer clients", osdcmd_listplayers);
+    OSD_RegisterFunction("net_historystats","net_historystats: memory used by each revision in the map state history", osdcmd_historystats);
+    OSD_RegisterFunction("net_snapshotstats","net_snapshotstats [reset]: world update bytes per client and server snapshot times", osdcmd_snapshotstats);
     OSD_RegisterFunction("name","name: change your multiplayer nickname", osdcmd_name);
     OSD_RegisterFunction("password","password: sets multiplayer game password", osdcmd_password);
     OSD_RegisterFunction("playerinfo", "Prints information about the current player", osdcmd_playerinfo);
@@ -5681,9 +5681,9 @@ HORIZONLY:;
         P_ClampZ(pPlayer, sectorLotag, ceilZ, floorZ);
 
         int const touchObject = FURY ? clipmove(&pPlayer->pos, &pPlayer->cursectnum, pPlayer->vel.x + (pPlayer->fric.x << 9),
-                                                   pPlayer->vel.y + (pPlayer->fric.y << 9), pPlayer->clipdist, (4L << 8), stepHeight, CLIPMASK0)
+                                                   pPlayer->vel.y + (pPlayer->fric.y << 9), pPlayer->clipdist, (4L << 8), stepHeight, CLIPMASK0, pPlayer->i)
                                         : clipmove(&pPlayer->pos, &pPlayer->cursectnum, pPlayer->vel.x, pPlayer->vel.y, pPlayer->clipdist,
-                                                   (4L << 8), stepHeight, CLIPMASK0);
+                                                   (4L << 8), stepHeight, CLIPMASK0, pPlayer->i);
 
         if (touchObject)
             P_CheckTouchDamage(pPlayer, touchObject);
@@ -5748,7 +5748,7 @@ HORIZONLY:;
     if (pPlayer->cursectnum >= 0 && ud.noclip == 0)
     {
 RECHECK:
-        int const  pushResult = pushmove(&pPlayer->pos, &pPlayer->cursectnum, pPlayer->clipdist - 1, (4L<<8), (4L<<8), CLIPMASK0, !mashedPotato);
+        int const  pushResult = pushmove(&pPlayer->pos, &pPlayer->cursectnum, pPlayer->clipdist - 1, (4L<<8), (4L<<8), CLIPMASK0, !mashedPotato, pPlayer->i);
         bool const squishPlayer = pushResult < 0;
 
         if (squishPlayer || klabs(actor[pPlayer->i].floorz-actor[pPlayer->i].ceilingz) < pPlayer->spritezoffset + ZOFFSET3)
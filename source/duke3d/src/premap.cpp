@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "menus.h"
 #include "savegame.h"
 #include "sbar.h"
+#include "tilepreload.h"
 
 #include "vfs.h"
 
@@ -452,6 +453,20 @@ static void cacheExtraTextureMaps(int tileNum, int type)
 #endif
 }
 
+static void cacheHightile(int32_t tileNum, int32_t hightile)
+{
+    for (int j = 0; j < 2; j++)
+    {
+        if (hightile & (1 << j))
+        {
+            tileLoadScaled(tileNum);
+
+            if (videoGetRenderMode() != REND_CLASSIC)
+                cacheExtraTextureMaps(tileNum, j);
+        }
+    }
+}
+
 void G_CacheMapData(void)
 {
     if (ud.recstat == 2 || !ud.config.useprecache)
@@ -491,47 +506,41 @@ void G_CacheMapData(void)
         }
     }
 
-    int cnt = 0;
-    int cntDisplayed = -1;
-    int pctDisplayed = -1;
-    int i = 0;
+    tilePreloadBegin();
 
-    while (cnt < g_precacheCount)
+    int numTiles = 0;
+
+    for (int i = 0; i < MAXTILES; i++)
     {
         if (bitmap_test(gotpic, i))
         {
-            cnt++;
-            
-            if (waloff[i] == 0)
-                tileLoad((int16_t)i);
+            tilePreloadQueue(i, (bitmap_test(precachehightile[0], i) ? TILEPRELOAD_WALL : 0)
+                              | (bitmap_test(precachehightile[1], i) ? TILEPRELOAD_SPRITE : 0));
+            numTiles++;
+        }
+    }
 
-            for (int j = 0; j < 2; j++)
-            {
-                if (bitmap_test(precachehightile[j], i))
-                {
-                    tileLoadScaled(i);
+    int tilesLeft = numTiles;
 
-                    if (videoGetRenderMode() != REND_CLASSIC)
-                        cacheExtraTextureMaps(i, j);
-                }
-            }
+    while (tilesLeft > 0)
+    {
+        tilesLeft = tilePreloadRun(cacheHightile, TILEPRELOAD_FRAMETIME);
 
-            gameHandleEvents();            
-            if (KB_KeyPressed(sc_Space))
-                break;            
-        }
-        i++;
-        
-        if (cntDisplayed+(i&7) < cnt-(i&7) && engineFPSLimit(true))
+        gameHandleEvents();
+        if (KB_KeyPressed(sc_Space))
+            break;
+
+        if (engineFPSLimit(true))
         {
-            int const percentComplete = min(100, tabledivide32(100 * cntDisplayed, g_precacheCount));
-            cntDisplayed = logapproach(cntDisplayed, cnt);
-            pctDisplayed = logapproach(pctDisplayed, percentComplete);
-            Bsprintf(tempbuf, "Loaded %d%% (%d/%d textures)\n", pctDisplayed, cntDisplayed, g_precacheCount);
-            G_DoLoadScreen(tempbuf, pctDisplayed);
+            int const tilesDone = numTiles - tilesLeft;
+            int const percentComplete = min(100, tabledivide32(100 * tilesDone, numTiles));
+            Bsprintf(tempbuf, "Loaded %d%% (%d/%d textures)\n", percentComplete, tilesDone, numTiles);
+            G_DoLoadScreen(tempbuf, percentComplete);
         }
     }
 
+    tilePreloadEnd();
+
     Bmemset(gotpic, 0, sizeof(gotpic));
 
     LOG_F(INFO, "Cache time: %dms.", timerGetTicks() - cacheStartTime);
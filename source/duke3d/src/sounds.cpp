@@ -532,6 +532,17 @@ int32_t S_LoadSound(int num)
 
     int32_t l = kfilelength(fp);
     g_sounds[num]->lock = CACHE1D_PERMANENT;
+
+    // sounds inside groups and zips are played straight from the mapped file
+    if (auto const view = (char const *)kfileview(fp, &l, 0))
+    {
+        snd->ptr = const_cast<char *>(view);  // only ever read
+        snd->len = l;
+        kclose(fp);
+
+        return l;
+    }
+
     snd->len = l;
     g_cache.allocateBlock((intptr_t *)&snd->ptr, l, (char *)&g_sounds[num]->lock);
     l = kread(fp, snd->ptr, l);
@@ -337,6 +337,8 @@ bool LoadLevel(int nMap)
                 wall[nWall].extra = wall_6[nWall].extra;
             }
 
+            sectorGridInvalidate(-1);
+
             for (int nSprite = 0; nSprite < nSprites; nSprite++)
             {
                 sprite[nSprite].x = sprite_6[nSprite].x;
@@ -2281,6 +2281,7 @@ void tagcode(void)
                         if (wall[k].x < subwaytrackx2[i])
                             if (wall[k].y < subwaytracky2[i])
                                 wall[k].x += subwayvel[i];
+            sectorGridInvalidate(dasector);
 
             for (j=1; j<subwaynumsectors[i]; j++)
             {
@@ -2290,6 +2291,7 @@ void tagcode(void)
                 endwall = startwall+sector[dasector].wallnum;
                 for (k=startwall; k<endwall; k++)
                     wall[k].x += subwayvel[i];
+                sectorGridInvalidate(dasector);
 
                 for (s=headspritesect[dasector]; s>=0; s=nextspritesect[s])
                     sprite[s].x += subwayvel[i];
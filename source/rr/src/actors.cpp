@@ -412,7 +412,7 @@ int32_t A_MoveSprite(int32_t spriteNum, vec3_t const * const change, uint32_t cl
     // Handle horizontal movement first.
     pSprite->z = newZ;
     int returnValue =
-    clipmove((vec3_t *)pSprite, &newSectnum, change->x << 13, change->y << 13, clipDist, ZOFFSET6, ZOFFSET6, clipType);
+    clipmove((vec3_t *)pSprite, &newSectnum, change->x << 13, change->y << 13, clipDist, ZOFFSET6, ZOFFSET6, clipType, spriteNum);
     pSprite->z = oldZ;
 
     if (isEnemy)
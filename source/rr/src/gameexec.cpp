@@ -311,20 +311,33 @@ int32_t A_GetFurthestAngle(int const spriteNum, int const angDiv)
     int32_t   furthestAngle = 0;
     int32_t   greatestDist  = INT32_MIN;
     int const angIncs       = tabledivide32_noinline(2048, angDiv);
-    hitdata_t hit;
+    vec3_t    rayVec[MAXHITSCANBATCH];
+    hitdata_t rayHit[MAXHITSCANBATCH];
 
-    for (native_t j = pSprite->ang; j < (2048 + pSprite->ang); j += angIncs)
+    // the rays have no side effects between them, so they can share one sector walk
+    for (native_t j = pSprite->ang; j < (2048 + pSprite->ang);)
     {
+        int numRays = 0;
+
+        for (; numRays < MAXHITSCANBATCH && j + numRays * angIncs < (2048 + pSprite->ang); numRays++)
+        {
+            int const rayAng = j + numRays * angIncs;
+            rayVec[numRays] = { sintable[(rayAng + 512) & 2047], sintable[rayAng & 2047], 0 };
+        }
+
         pSprite->z -= ZOFFSET3;
-        hitscan((const vec3_t *)pSprite, pSprite->sectnum, sintable[(j + 512) & 2047], sintable[j & 2047], 0, &hit, CLIPMASK1);
+        hitscan_batch((const vec3_t *)pSprite, pSprite->sectnum, numRays, rayVec, rayHit, CLIPMASK1);
         pSprite->z += ZOFFSET3;
 
-        int const hitDist = klabs(hit.x-pSprite->x) + klabs(hit.y-pSprite->y);
-
-        if (hitDist > greatestDist)
+        for (int i = 0; i < numRays; i++, j += angIncs)
         {
-            greatestDist = hitDist;
-            furthestAngle = j;
+            int const hitDist = klabs(rayHit[i].x-pSprite->x) + klabs(rayHit[i].y-pSprite->y);
+
+            if (hitDist > greatestDist)
+            {
+                greatestDist = hitDist;
+                furthestAngle = j;
+            }
         }
     }
 
@@ -615,6 +615,8 @@ void RT_LoadBoard(int boardnum)
         wall[i].ypanning = rt_wall[i].ypanning;
         rt_wall[i].sectnum = B_BIG16(rt_wall[i].sectnum);
     }
+
+    sectorGridInvalidate(-1);
     
     for (int i = 0; i < numsprites; i++)
     {
@@ -1996,6 +1996,8 @@ int32_t sv_updatestate(int32_t frominit)
 
     if (frominit)
         postloadplayer(0);
+    else
+        calc_sector_reachability();  // the diff may have moved walls
 #ifdef POLYMER
     if (videoGetRenderMode() == REND_POLYMER)
         polymer_resetlights();  // must do it after polymer_loadboard() !!!
@@ -508,6 +508,17 @@ int32_t S_LoadSound(int num)
 
     int32_t l = kfilelength(fp);
     g_soundlocks[num] = 200;
+
+    // sounds inside groups and zips are played straight from the mapped file
+    if (auto const view = (char const *)kfileview(fp, &l, 0))
+    {
+        snd.ptr = const_cast<char *>(view);  // only ever read
+        snd.siz = l;
+        kclose(fp);
+
+        return l;
+    }
+
     snd.siz = l;
     g_cache.allocateBlock((intptr_t *)&snd.ptr, l, (char *)&g_soundlocks[num]);
     l = kread(fp, snd.ptr, l);
@@ -41,6 +41,7 @@ not load" error messages.
 #include "cache.h"
 #include "sounds.h"
 #include "network.h"
+#include "tilepreload.h"
 
 // Run the game with the -CACHEPRINT option and redirect to a file.
 // It will save out the tile and sound number every time one caches.
@@ -619,28 +620,30 @@ PreCacheActor(void)
 void DoTheCache(void)
 {
     extern char CacheLastLevel[32],LevelName[20];
-    int i, cnt=0;
+    int i;
 
     PreCacheAmbient();
     PreCacheSoundSpot();
     PreCacheActor();
     PreCacheOverride();
 
+    tilePreloadBegin();
+
     for (i = 0; i < MAXTILES; i++)
     {
         if ((TEST(gotpic[i>>3], 1<<(i&7))) && (!waloff[i]))
-        {
-            tileLoad(i);
-            cnt++;
-            if (!(cnt&7))
-            {
-                AnimateCacheCursor();
-                handleevents();
-                getpackets();
-            }
-        }
+            tilePreloadQueue(i, 0);
     }
 
+    while (tilePreloadRun(nullptr, TILEPRELOAD_FRAMETIME) > 0)
+    {
+        AnimateCacheCursor();
+        handleevents();
+        getpackets();
+    }
+
+    tilePreloadEnd();
+
     memset(gotpic,0,sizeof(gotpic));
     strcpy(CacheLastLevel, LevelName);
 }
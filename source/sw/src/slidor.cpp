@@ -485,6 +485,8 @@ int DoSlidorMoveWalls(short SpriteNum, int amt)
     }
     while (w != startwall);
 
+    sectorGridInvalidate(sprite[SpriteNum].sectnum);
+
     return 0;
 }
 
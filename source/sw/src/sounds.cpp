@@ -807,7 +807,14 @@ SWBOOL CacheSound(int num, int /*type*/)
             return FALSE;
         }
 
-        if (vp != NULL)
+        // sounds inside groups and zips are played straight from the mapped file
+        if (auto const view = (uint8_t const *)kfileview(handle, &length, 0))
+        {
+            vp->data = const_cast<uint8_t *>(view);  // only ever read
+            vp->datalen = length;
+            kclose(handle);
+        }
+        else if (vp != NULL)
         {
             //FILE *fp;
 
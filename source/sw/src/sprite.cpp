@@ -1644,6 +1644,8 @@ void PreMapCombineFloors(void)
                     sectlist[sectlistend++] = nextsector;
             }
 
+            sectorGridInvalidate(dasect);
+
         }
 
         TRAVERSE_CONNECT(pnum)
@@ -1759,6 +1759,8 @@ MovePoints(SECTOR_OBJECTp sop, short delta_ang, int nx, int ny)
             }
         }
 
+        sectorGridInvalidate(*sectp - sector);
+
 PlayerPart:
 
         TRAVERSE_CONNECT(pnum)
@@ -2000,6 +2002,8 @@ RefreshPoints(SECTOR_OBJECTp sop, int nx, int ny, SWBOOL dynamic)
 
                 wallcount++;
             }
+
+            sectorGridInvalidate(*sectp - sector);
         }
     }
 
@@ -2163,6 +2167,8 @@ CollapseSectorObject(SECTOR_OBJECTp sop, int nx, int ny)
                     wp->y = ny;
                 }
             }
+
+            sectorGridInvalidate(*sectp - sector);
         }
     }
 }
@@ -0,0 +1,285 @@
+// classicbench -- headless classic renderer benchmark
+//
+// Loads a map and renders a camera path through renderDrawRoomsQ16() and
+// renderDrawMasks() into an offscreen 8-bit buffer, without opening a window.
+// Prints the frame time, the number of bunches and tsprites and a checksum of
+// the frame buffer for every frame, followed by frame time percentiles.
+//
+// The camera path file holds one keyframe per line:
+//   x y z ang horiz
+// in Build units (ang 0-2047, horiz 100 = level). The camera moves linearly
+// from one keyframe to the next over -f frames. Without a path file, the
+// camera does a full turn in four segments at the player start position.
+//
+// The game data (palette.dat, lookup.dat, tiles*.art) is looked up in the
+// current directory and in the files given with -g.
+
+#include "compat.h"
+#include "a.h"
+#include "baselayer.h"
+#include "build.h"
+#include "build_cpuid.h"
+#include "editor.h"
+#include "osd.h"
+#include "scriptfile.h"
+#include "vfs.h"
+#include "xxhash.h"
+
+#ifdef POLYMER
+# include "polymer.h"
+#endif
+
+#define CACHESIZE (128<<20)
+
+typedef struct
+{
+    vec3_t pos;
+    int32_t ang, horiz;
+} camkey_t;
+
+typedef struct
+{
+    double ms;
+    int32_t bunches, tsprites;
+    uint64_t checksum;
+} framestat_t;
+
+static camkey_t *camkeys;
+static int32_t numcamkeys;
+
+// hooks the engine expects from the application
+const char *G_DefaultDefFile(void) { return "classicbench.def"; }
+void app_crashhandler(void) { }
+void faketimerhandler(void) { }
+int osdcmd_restartvid(osdcmdptr_t) { return OSDCMD_OK; }
+void M32RunScript(const char *s) { UNREFERENCED_PARAMETER(s); }
+#ifdef POLYMER
+void G_Polymer_UnInit(void) { }
+#endif
+
+static void usage(void)
+{
+    initprintf("usage: classicbench [options] <map>\n"
+               "  -g <file>   add a group file (can be repeated)\n"
+               "  -p <file>   camera path, one \"x y z ang horiz\" keyframe per line\n"
+               "  -f <n>      frames per path segment (default 30)\n"
+               "  -w <n>      warm-up frames that are not measured (default 10)\n"
+               "  -x <n>      frame width (default 1024)\n"
+               "  -y <n>      frame height (default 768)\n"
+               "  -s <n>      highest kernel set: 0 scalar, 1 SSE2, 2 SSE4.1, 3 AVX2 (default 3)\n"
+               "  -q          only print the summary\n");
+}
+
+static int32_t loadcampath(const char *fn)
+{
+    scriptfile *sf = scriptfile_fromfile(fn);
+
+    if (!sf)
+        return -1;
+
+    int32_t maxcamkeys = 0;
+
+    while (!scriptfile_eof(sf))
+    {
+        camkey_t key;
+
+        if (scriptfile_getnumber(sf, &key.pos.x) || scriptfile_getnumber(sf, &key.pos.y) ||
+            scriptfile_getnumber(sf, &key.pos.z) || scriptfile_getnumber(sf, &key.ang) ||
+            scriptfile_getnumber(sf, &key.horiz))
+            break;
+
+        if (numcamkeys == maxcamkeys)
+        {
+            maxcamkeys = max(maxcamkeys << 1, 16);
+            camkeys = (camkey_t *)Xrealloc(camkeys, maxcamkeys * sizeof(camkey_t));
+        }
+
+        camkeys[numcamkeys++] = key;
+    }
+
+    scriptfile_close(sf);
+
+    return numcamkeys >= 2 ? 0 : -1;
+}
+
+static int32_t lerp(int32_t a, int32_t b, int32_t i, int32_t n) { return a + (int32_t)((int64_t)(b - a) * i / n); }
+
+static void getcamera(int32_t frame, int32_t framesperseg, camkey_t *cam)
+{
+    int32_t const seg = frame / framesperseg, i = frame % framesperseg;
+    auto const &a = camkeys[seg], &b = camkeys[seg + 1];
+
+    cam->pos.x = lerp(a.pos.x, b.pos.x, i, framesperseg);
+    cam->pos.y = lerp(a.pos.y, b.pos.y, i, framesperseg);
+    cam->pos.z = lerp(a.pos.z, b.pos.z, i, framesperseg);
+    // turn the short way around
+    cam->ang   = (a.ang + lerp(0, ((b.ang - a.ang + 1024) & 2047) - 1024, i, framesperseg)) & 2047;
+    cam->horiz = lerp(a.horiz, b.horiz, i, framesperseg);
+}
+
+static int cmpdouble(const void *a, const void *b)
+{
+    double const x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of a sorted array
+static double percentile(const double *sorted, int32_t n, int32_t pct)
+{
+    int32_t const rank = (pct * n + 99) / 100;
+    return sorted[clamp(rank - 1, 0, n - 1)];
+}
+
+int app_main(int argc, char const * const * argv)
+{
+    const char *mapname = NULL, *pathname = NULL;
+    int32_t framesperseg = 30, warmup = 10, xsiz = 1024, ysiz = 768, quiet = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!Bstrcmp(argv[i], "-q"))
+            quiet = 1;
+        else if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc)
+        {
+            char const *const arg = argv[++i];
+
+            switch (argv[i-1][1])
+            {
+            case 'g': initgroupfile(arg); break;
+            case 'p': pathname = arg; break;
+            case 'f': framesperseg = max(1, Batoi(arg)); break;
+            case 'w': warmup = max(0, Batoi(arg)); break;
+            case 'x': xsiz = max(320, Batoi(arg)); break;
+            case 'y': ysiz = max(200, Batoi(arg)); break;
+            case 's': r_classicsimd = clamp(Batoi(arg), CLASSICSIMD_SCALAR, CLASSICSIMD_AVX2); break;
+            default: usage(); return 1;
+            }
+        }
+        else if (argv[i][0] != '-' && !mapname)
+            mapname = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!mapname)
+    {
+        usage();
+        return 1;
+    }
+
+    // engineInit() picks the renderer kernels from the CPU features
+    sysReadCPUID();
+
+    if (enginePreInit() || engineInit())
+    {
+        initprintf("classicbench: failed to initialize the engine: %s\n", engineerrstr);
+        return 1;
+    }
+
+    artLoadFiles("tiles%03i.art", CACHESIZE);
+
+    if (enginePostInit())
+    {
+        initprintf("classicbench: failed to initialize the engine: %s\n", engineerrstr);
+        engineUnInit();
+        return 1;
+    }
+
+    vec3_t startpos;
+    int16_t startang, startsect;
+
+    if (engineLoadBoard(mapname, 0, &startpos, &startang, &startsect) < 0)
+    {
+        initprintf("classicbench: failed to load map \"%s\"\n", mapname);
+        engineUnInit();
+        return 1;
+    }
+
+    if (pathname)
+    {
+        if (loadcampath(pathname))
+        {
+            initprintf("classicbench: failed to load camera path \"%s\" (need at least two keyframes)\n", pathname);
+            engineUnInit();
+            return 1;
+        }
+    }
+    else
+    {
+        numcamkeys = 5;
+        camkeys = (camkey_t *)Xmalloc(numcamkeys * sizeof(camkey_t));
+
+        for (int i = 0; i < numcamkeys; i++)
+            camkeys[i] = { startpos, (startang + i * 512) & 2047, 100 };
+    }
+
+    char *const frame = (char *)Xaligned_alloc(16, xsiz * ysiz);
+    videoSetHeadlessMode(frame, xsiz, ysiz);
+
+    int32_t const numframes = (numcamkeys - 1) * framesperseg;
+    auto stats = (framestat_t *)Xcalloc(numframes, sizeof(framestat_t));
+    int16_t sect = startsect;
+    double const tickspersec = (double)timerGetPerformanceFrequency();
+
+    for (int32_t f = -warmup; f < numframes; f++)
+    {
+        camkey_t cam;
+        getcamera(max(f, 0), framesperseg, &cam);
+
+        // keep the last sector if the camera leaves the map
+        int16_t newsect = sect;
+        updatesectorz(cam.pos.x, cam.pos.y, cam.pos.z, &newsect);
+        if (newsect >= 0)
+            sect = newsect;
+
+        Bmemset(frame, 0, xsiz * ysiz);
+        classicbunchcnt = 0;
+
+        uint64_t const t0 = timerGetPerformanceCounter();
+
+        renderDrawRoomsQ16(cam.pos.x, cam.pos.y, cam.pos.z, fix16_from_int(cam.ang), fix16_from_int(cam.horiz), sect);
+        int32_t const tsprites = spritesortcnt;
+        renderDrawMasks();
+
+        uint64_t const t1 = timerGetPerformanceCounter();
+
+        if (f < 0)
+            continue;
+
+        auto &s = stats[f];
+
+        s.ms       = (t1 - t0) * 1000.0 / tickspersec;
+        s.bunches  = classicbunchcnt;
+        s.tsprites = tsprites;
+        s.checksum = XXH3_64bits(frame, xsiz * ysiz);
+
+        if (!quiet)
+            initprintf("frame %5d: %8.3f ms %5d bunches %5d tsprites checksum %016" PRIx64 "\n", f, s.ms, s.bunches,
+                       s.tsprites, s.checksum);
+    }
+
+    auto sorted = (double *)Xmalloc(numframes * sizeof(double));
+    double total = 0;
+
+    for (int32_t f = 0; f < numframes; f++)
+        total += (sorted[f] = stats[f].ms);
+
+    qsort(sorted, numframes, sizeof(double), cmpdouble);
+
+    initprintf("%d frames at %dx%d with %s kernels: avg %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+               numframes, xsiz, ysiz, classicSimdLevelName(classicsimdlevel), total / numframes, percentile(sorted, numframes, 50), percentile(sorted, numframes, 95),
+               percentile(sorted, numframes, 99), sorted[numframes - 1]);
+
+    Xfree(sorted);
+    Xfree(stats);
+    Xaligned_free(frame);
+    Xfree(camkeys);
+
+    engineUnInit();
+    uninitgroupfile();
+
+    return 0;
+}
@@ -0,0 +1,391 @@
+// hashbench.cpp
+//  Compares the open addressed hash tables of hash.cpp with the chained tables they replaced.
+//
+// Both kinds of table are filled with the same keys, which are then looked up
+// -n times over, half of them present and half of them not, and every third
+// one is deleted again. The results of the two kinds of table are checked
+// against each other along the way.
+
+#include "compat.h"
+#include "hash.h"
+
+#include <chrono>
+
+// the chained tables from before, with a djb hash and a prime number of buckets
+
+typedef struct oldhashitem
+{
+    char *string;
+    intptr_t key;
+    struct oldhashitem *next;
+} oldhashitem_t;
+
+typedef struct
+{
+    uint32_t size;
+    libdivide::libdivide_u32_t d;
+    oldhashitem_t **items;
+} oldhashtable_t;
+
+typedef struct oldinthashitem
+{
+    intptr_t key;
+    intptr_t value;
+    struct oldinthashitem *collision;
+} oldinthashitem_t;
+
+typedef struct
+{
+    uint32_t size;
+    libdivide::libdivide_u32_t d;
+    oldinthashitem_t *items;
+} oldinthashtable_t;
+
+static uint32_t findprime(uint32_t n)
+{
+    for (n |= 1;; n += 2)
+    {
+        uint32_t i = 3;
+
+        while (i * i <= n && n % i)
+            i += 2;
+
+        if (i * i > n)
+            return n;
+    }
+}
+
+static uint32_t oldhash_getbucket(oldhashtable_t const *t, const char *s)
+{
+    uint32_t h = 5381u;
+    char ch;
+
+    while ((ch = Btolower(*s++)) != '\0')
+        h = ((h << 5) + h) ^ ch;
+
+    return h - libdivide::libdivide_u32_do(h, &t->d) * t->size;
+}
+
+static void oldhash_init(oldhashtable_t *t, uint32_t size)
+{
+    t->size  = findprime(size);
+    t->d     = libdivide::libdivide_u32_gen(t->size);
+    t->items = (oldhashitem_t **) Xaligned_calloc(16, t->size, sizeof(oldhashitem_t));
+}
+
+static void oldhash_free(oldhashtable_t *t)
+{
+    for (uint32_t i = 0; i < t->size; i++)
+        for (auto cur = t->items[i]; cur;)
+        {
+            auto tmp = cur;
+            cur = cur->next;
+
+            Xfree(tmp->string);
+            Xaligned_free(tmp);
+        }
+
+    ALIGNED_FREE_AND_NULL(t->items);
+}
+
+static void oldhash_add(oldhashtable_t *t, const char *s, intptr_t key)
+{
+    auto pcur = &t->items[oldhash_getbucket(t, s)];
+
+    for (; *pcur; pcur = &(*pcur)->next)
+        if (Bstrcmp(s, (*pcur)->string) == 0)
+            return;
+
+    auto cur = (oldhashitem_t *) Xaligned_alloc(16, sizeof(oldhashitem_t));
+    cur->string = Xstrdup(s);
+    cur->key    = key;
+    cur->next   = nullptr;
+    *pcur = cur;
+}
+
+static void oldhash_delete(oldhashtable_t *t, const char *s)
+{
+    for (auto pcur = &t->items[oldhash_getbucket(t, s)]; *pcur; pcur = &(*pcur)->next)
+        if (Bstrcmp(s, (*pcur)->string) == 0)
+        {
+            auto cur = *pcur;
+            *pcur = cur->next;
+            Xfree(cur->string);
+            Xaligned_free(cur);
+            return;
+        }
+}
+
+static intptr_t oldhash_find(oldhashtable_t const *t, const char *s)
+{
+    for (auto cur = t->items[oldhash_getbucket(t, s)]; cur; cur = cur->next)
+        if (Bstrcmp(s, cur->string) == 0)
+            return cur->key;
+
+    return -1;
+}
+
+static uint32_t oldinthash_getbucket(oldinthashtable_t const *t, intptr_t key)
+{
+    uint32_t h = 5381u;
+
+    for (auto keybuf = (uint8_t const *) &key, keybuf_end = keybuf + sizeof(key); keybuf < keybuf_end; ++keybuf)
+        h = ((h << 5) + h) ^ (uint32_t) *keybuf;
+
+    return h - libdivide::libdivide_u32_do(h, &t->d) * t->size;
+}
+
+static void oldinthash_init(oldinthashtable_t *t, uint32_t size)
+{
+    t->size  = findprime(size);
+    t->d     = libdivide::libdivide_u32_gen(t->size);
+    t->items = (oldinthashitem_t *) Xaligned_calloc(16, t->size, sizeof(oldinthashitem_t));
+}
+
+static void oldinthash_add(oldinthashtable_t *t, intptr_t key, intptr_t value)
+{
+    auto seeker = t->items + oldinthash_getbucket(t, key);
+
+    if (seeker->collision == nullptr)
+    {
+        seeker->key = key;
+        seeker->value = value;
+        seeker->collision = seeker;
+        return;
+    }
+
+    if (seeker->key == key)
+        return;
+
+    while (seeker != seeker->collision)
+    {
+        seeker = seeker->collision;
+
+        if (seeker->key == key)
+            return;
+    }
+
+    auto tail = seeker;
+
+    do
+    {
+        uint32_t const ofs = tail - t->items + 1;
+        tail = t->items + ofs - libdivide::libdivide_u32_do(ofs, &t->d) * t->size;
+    }
+    while (tail->collision != nullptr && tail != seeker);
+
+    tail->key = key;
+    tail->value = value;
+    tail->collision = seeker->collision = tail;
+}
+
+static intptr_t oldinthash_find(oldinthashtable_t const *t, intptr_t key)
+{
+    auto seeker = t->items + oldinthash_getbucket(t, key);
+
+    if (seeker->collision == nullptr)
+        return -1;
+
+    if (seeker->key == key)
+        return seeker->value;
+
+    while (seeker != seeker->collision)
+    {
+        seeker = seeker->collision;
+
+        if (seeker->key == key)
+            return seeker->value;
+    }
+
+    return -1;
+}
+
+static double seconds(std::chrono::steady_clock::time_point const t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void report(char const *what, int32_t ops, double oldtime, double newtime)
+{
+    Bprintf("  %-8s %8.1f Mops/s old %8.1f Mops/s new  %5.2fx\n", what, ops / (oldtime * 1e6), ops / (newtime * 1e6), oldtime / newtime);
+}
+
+int main(int argc, char **argv)
+{
+    int32_t numkeys = 8192, iterations = 20;
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 < argc && !Bstrcmp(argv[i], "-k"))
+            numkeys = max(1, Batoi(argv[i + 1]));
+        else if (i + 1 < argc && !Bstrcmp(argv[i], "-n"))
+            iterations = max(1, Batoi(argv[i + 1]));
+        else
+        {
+            Bprintf("usage: hashbench [-k <keys>] [-n <iterations>]\n");
+            Bprintf("   Inserts <keys> keys (default 8192) into the string and integer hash tables\n");
+            Bprintf("   and into the chained tables they replaced, looks up twice as many keys\n");
+            Bprintf("   <iterations> times (default 20), half of them missing, deletes a third of\n");
+            Bprintf("   them and prints the speed of each table.\n");
+            return 0;
+        }
+    }
+
+    engineCreateAllocator();
+
+    // names like the labels and gamevars of CON scripts, and the keys of the found half in mixed case for hash_findcase()
+    int32_t const numnames = numkeys * 2;
+    char **names = (char **) Xmalloc(numnames * sizeof(char *));
+    char **upper = (char **) Xmalloc(numkeys * sizeof(char *));
+    intptr_t *ints = (intptr_t *) Xmalloc(numnames * sizeof(intptr_t));
+    static char const *const prefixes[] = { "ACTOR_", "weapon", "SND_", "sprite.", "TEMP", "gamevar_" };
+
+    for (int32_t i = 0; i < numnames; i++)
+    {
+        char buf[64];
+        Bsnprintf(buf, sizeof(buf), "%s%d_%x", prefixes[i % ARRAY_SIZE(prefixes)], i, i * 2654435761u);
+        names[i] = Xstrdup(buf);
+        ints[i] = (intptr_t) i * 4096 + 0x10000;  // like the addresses of cache blocks
+    }
+
+    for (int32_t i = 0; i < numkeys; i++)
+    {
+        upper[i] = Xstrdup(names[i]);
+        Bstrupr(upper[i]);
+    }
+
+    int32_t mismatches = 0;
+    int32_t const numfinds = numnames * iterations;
+    intptr_t oldsum = 0, newsum = 0;
+
+    // string tables, sized for a quarter of the keys so that both have to cope with being overloaded
+
+    oldhashtable_t oldh;
+    hashtable_t newh = { (uint32_t) numkeys >> 2, NULL };
+
+    auto t0 = std::chrono::steady_clock::now();
+    oldhash_init(&oldh, numkeys >> 2);
+    for (int32_t i = 0; i < numkeys; i++)
+        oldhash_add(&oldh, names[i], i);
+    double const oldadd = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    hash_init(&newh);
+    for (int32_t i = 0; i < numkeys; i++)
+        hash_add(&newh, names[i], i, 0);
+    double const newadd = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int32_t n = 0; n < iterations; n++)
+        for (int32_t i = 0; i < numnames; i++)
+            oldsum += oldhash_find(&oldh, names[i]);
+    double const oldfind = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int32_t n = 0; n < iterations; n++)
+        for (int32_t i = 0; i < numnames; i++)
+            newsum += hash_find(&newh, names[i]);
+    double const newfind = seconds(t0);
+
+    if (oldsum != newsum)
+    {
+        Bprintf("hash_find: the sums of the keys found differ\n");
+        mismatches++;
+    }
+
+    for (int32_t i = 0; i < numkeys; i++)
+        if (hash_findcase(&newh, upper[i]) != i)
+        {
+            Bprintf("hash_findcase: %s not found\n", upper[i]);
+            mismatches++;
+        }
+
+    t0 = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < numkeys; i += 3)
+        oldhash_delete(&oldh, names[i]);
+    double const olddel = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < numkeys; i += 3)
+        hash_delete(&newh, names[i]);
+    double const newdel = seconds(t0);
+
+    for (int32_t i = 0; i < numnames; i++)
+        if (hash_find(&newh, names[i]) != oldhash_find(&oldh, names[i]))
+        {
+            Bprintf("hash_delete: %s is %s\n", names[i], hash_find(&newh, names[i]) < 0 ? "missing" : "still there");
+            mismatches++;
+        }
+
+    Bprintf("string tables, %d keys:\n", numkeys);
+    report("add", numkeys, oldadd, newadd);
+    report("find", numfinds, oldfind, newfind);
+    report("delete", (numkeys + 2) / 3, olddel, newdel);
+
+    oldhash_free(&oldh);
+    hash_free(&newh);
+
+    // integer tables, sized as their users do
+
+    oldinthashtable_t oldih;
+    inthashtable_t newih = { nullptr, INTHASH_SIZE((uint32_t) numkeys) };
+    oldsum = newsum = 0;
+
+    t0 = std::chrono::steady_clock::now();
+    oldinthash_init(&oldih, INTHASH_SIZE((uint32_t) numkeys));
+    for (int32_t i = 0; i < numkeys; i++)
+        oldinthash_add(&oldih, ints[i], i);
+    double const oldiadd = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    inthash_init(&newih);
+    for (int32_t i = 0; i < numkeys; i++)
+        inthash_add(&newih, ints[i], i, 0);
+    double const newiadd = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int32_t n = 0; n < iterations; n++)
+        for (int32_t i = 0; i < numnames; i++)
+            oldsum += oldinthash_find(&oldih, ints[i]);
+    double const oldifind = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int32_t n = 0; n < iterations; n++)
+        for (int32_t i = 0; i < numnames; i++)
+            newsum += inthash_find(&newih, ints[i]);
+    double const newifind = seconds(t0);
+
+    if (oldsum != newsum)
+    {
+        Bprintf("inthash_find: the sums of the values found differ\n");
+        mismatches++;
+    }
+
+    for (int32_t i = 0; i < numkeys; i += 3)
+        inthash_delete(&newih, ints[i]);
+
+    for (int32_t i = 0; i < numnames; i++)
+        if (inthash_find(&newih, ints[i]) != (i < numkeys && i % 3 ? i : -1))
+        {
+            Bprintf("inthash_delete: key %d is wrong\n", i);
+            mismatches++;
+        }
+
+    Bprintf("integer tables, %d keys:\n", numkeys);
+    report("add", numkeys, oldiadd, newiadd);
+    report("find", numfinds, oldifind, newifind);
+
+    ALIGNED_FREE_AND_NULL(oldih.items);
+    inthash_free(&newih);
+
+    for (int32_t i = 0; i < numnames; i++)
+        Xfree(names[i]);
+    for (int32_t i = 0; i < numkeys; i++)
+        Xfree(upper[i]);
+
+    Xfree(ints);
+    Xfree(upper);
+    Xfree(names);
+
+    return mismatches != 0;
+}
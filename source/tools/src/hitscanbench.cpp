@@ -0,0 +1,245 @@
+// hitscanbench -- checks hitscan_batch() against hitscan()
+//
+// Loads a map and traces random rays from random points inside random
+// sectors, once with one hitscan() call per ray and once with a single
+// hitscan_batch() call for all rays of a point. Every field of every result
+// has to match; mismatches are printed and make the tool exit with status 1.
+// At the end it prints how long both versions took.
+//
+// The game data (tiles*.art) is looked up in the current directory and in
+// the files given with -g. Without the art, sprites are traced with
+// zero-sized tiles.
+
+#include "compat.h"
+#include "baselayer.h"
+#include "build.h"
+#include "build_cpuid.h"
+#include "editor.h"
+#include "osd.h"
+#include "vfs.h"
+
+#ifdef POLYMER
+# include "polymer.h"
+#endif
+
+#define CACHESIZE (128<<20)
+
+// hooks the engine expects from the application
+const char *G_DefaultDefFile(void) { return "hitscanbench.def"; }
+void app_crashhandler(void) { }
+void faketimerhandler(void) { }
+int osdcmd_restartvid(osdcmdptr_t) { return OSDCMD_OK; }
+void M32RunScript(const char *s) { UNREFERENCED_PARAMETER(s); }
+#ifdef POLYMER
+void G_Polymer_UnInit(void) { }
+#endif
+
+static uint32_t randseed = 1;
+
+// xorshift32, so the ray set only depends on -r
+static uint32_t nextrand(void)
+{
+    randseed ^= randseed << 13;
+    randseed ^= randseed >> 17;
+    randseed ^= randseed << 5;
+    return randseed;
+}
+
+static int32_t randrange(int32_t lo, int32_t hi) { return lo + (int32_t)(nextrand() % (uint32_t)(hi - lo + 1)); }
+
+static void usage(void)
+{
+    initprintf("usage: hitscanbench [options] <map>\n"
+               "  -g <file>   add a group file (can be repeated)\n"
+               "  -n <n>      number of start points (default 10000)\n"
+               "  -b <n>      rays per start point (default 16)\n"
+               "  -r <n>      random seed (default 1)\n"
+               "  -c <n>      clip mask (default 0x10001, CLIPMASK1 in the games)\n"
+               "  -q          only print the summary\n");
+}
+
+// a random point strictly inside a random sector, between its ceiling and floor
+static int32_t randpoint(vec3_t *pos, int16_t *sectnum)
+{
+    for (int tries = 0; tries < 64; tries++)
+    {
+        int16_t const s = randrange(0, numsectors - 1);
+
+        if (sector[s].wallnum < 3)
+            continue;
+
+        vec2_t mins = { INT32_MAX, INT32_MAX }, maxs = { INT32_MIN, INT32_MIN };
+
+        for (int w = sector[s].wallptr, endwall = w + sector[s].wallnum; w < endwall; w++)
+        {
+            vec2_t const wv = wall[w].xy;
+
+            mins.x = min(mins.x, wv.x); maxs.x = max(maxs.x, wv.x);
+            mins.y = min(mins.y, wv.y); maxs.y = max(maxs.y, wv.y);
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            vec2_t const p = { randrange(mins.x, maxs.x), randrange(mins.y, maxs.y) };
+
+            if (inside(p.x, p.y, s) != 1)
+                continue;
+
+            int32_t cz, fz;
+            getzsofslope(s, p.x, p.y, &cz, &fz);
+
+            if (fz - cz < 2)
+                continue;
+
+            *pos = { p.x, p.y, randrange(cz + 1, fz - 1) };
+            *sectnum = s;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static int hitdiffers(hitdata_t const &a, hitdata_t const &b)
+{
+    return a.x != b.x || a.y != b.y || a.z != b.z || a.sprite != b.sprite || a.wall != b.wall || a.sect != b.sect;
+}
+
+int app_main(int argc, char const * const * argv)
+{
+    const char *mapname = NULL;
+    int32_t numpoints = 10000, batchrays = 16, quiet = 0;
+    uint32_t cliptype = 0x10001;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!Bstrcmp(argv[i], "-q"))
+            quiet = 1;
+        else if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc)
+        {
+            char const *const arg = argv[++i];
+
+            switch (argv[i-1][1])
+            {
+            case 'g': initgroupfile(arg); break;
+            case 'n': numpoints = max(1, Batoi(arg)); break;
+            case 'b': batchrays = clamp(Batoi(arg), 1, 4096); break;
+            case 'r': randseed = max(1u, (uint32_t)Batoi(arg)); break;
+            case 'c': cliptype = (uint32_t)Bstrtol(arg, NULL, 0); break;
+            default: usage(); return 1;
+            }
+        }
+        else if (argv[i][0] != '-' && !mapname)
+            mapname = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!mapname)
+    {
+        usage();
+        return 1;
+    }
+
+    sysReadCPUID();
+
+    if (enginePreInit() || engineInit())
+    {
+        initprintf("hitscanbench: failed to initialize the engine: %s\n", engineerrstr);
+        return 1;
+    }
+
+    artLoadFiles("tiles%03i.art", CACHESIZE);
+
+    if (enginePostInit())
+    {
+        initprintf("hitscanbench: failed to initialize the engine: %s\n", engineerrstr);
+        engineUnInit();
+        return 1;
+    }
+
+    vec3_t startpos;
+    int16_t startang, startsect;
+
+    if (engineLoadBoard(mapname, 0, &startpos, &startang, &startsect) < 0 || numsectors <= 0)
+    {
+        initprintf("hitscanbench: failed to load map \"%s\"\n", mapname);
+        engineUnInit();
+        return 1;
+    }
+
+    auto vec     = (vec3_t *)Xmalloc(batchrays * sizeof(vec3_t));
+    auto scalar  = (hitdata_t *)Xmalloc(batchrays * sizeof(hitdata_t));
+    auto batched = (hitdata_t *)Xmalloc(batchrays * sizeof(hitdata_t));
+
+    double const tickspersec = (double)timerGetPerformanceFrequency();
+    uint64_t scalarticks = 0, batchticks = 0;
+    int32_t numtested = 0, mismatches = 0;
+
+    for (int32_t p = 0; p < numpoints; p++)
+    {
+        vec3_t pos;
+        int16_t sectnum;
+
+        if (randpoint(&pos, &sectnum))
+            continue;
+
+        for (int32_t r = 0; r < batchrays; r++)
+        {
+            int32_t const ang = randrange(0, 2047);
+            // mostly level rays, with some steep ones that end on a ceiling or floor
+            int32_t const vz = (nextrand() & 3) ? randrange(-8192, 8192) : randrange(-262144, 262144);
+
+            vec[r] = { sintable[(ang + 512) & 2047], sintable[ang & 2047], vz };
+        }
+
+        uint64_t const t0 = timerGetPerformanceCounter();
+
+        for (int32_t r = 0; r < batchrays; r++)
+            hitscan(&pos, sectnum, vec[r].x, vec[r].y, vec[r].z, &scalar[r], cliptype);
+
+        uint64_t const t1 = timerGetPerformanceCounter();
+
+        hitscan_batch(&pos, sectnum, batchrays, vec, batched, cliptype);
+
+        uint64_t const t2 = timerGetPerformanceCounter();
+
+        scalarticks += t1 - t0;
+        batchticks  += t2 - t1;
+        numtested++;
+
+        for (int32_t r = 0; r < batchrays; r++)
+        {
+            auto const &a = scalar[r], &b = batched[r];
+
+            if (!hitdiffers(a, b))
+                continue;
+
+            mismatches++;
+
+            if (!quiet)
+                initprintf("mismatch: from %d,%d,%d in sector %d along %d,%d,%d:\n"
+                           "  hitscan       %d,%d,%d sect %d wall %d sprite %d\n"
+                           "  hitscan_batch %d,%d,%d sect %d wall %d sprite %d\n",
+                           pos.x, pos.y, pos.z, sectnum, vec[r].x, vec[r].y, vec[r].z,
+                           a.x, a.y, a.z, a.sect, a.wall, a.sprite, b.x, b.y, b.z, b.sect, b.wall, b.sprite);
+        }
+    }
+
+    int32_t const numrays = numtested * batchrays;
+
+    initprintf("%d rays from %d points: %d mismatches, hitscan %.3f ms, hitscan_batch %.3f ms\n", numrays, numtested,
+               mismatches, scalarticks * 1000.0 / tickspersec, batchticks * 1000.0 / tickspersec);
+
+    Xfree(batched);
+    Xfree(scalar);
+    Xfree(vec);
+
+    engineUnInit();
+    uninitgroupfile();
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,370 @@
+// mixbench -- sound mixer benchmark
+//
+// Mixes a number of voices of random noise, with every combination of 8 or
+// 16-bit and mono or stereo source, at random pitches and with volume ramps,
+// into MV_MIXBUFFERSIZE frame buffers with each set of kernels the CPU
+// supports (see mixsimd.cpp), and with a copy of the 16-bit fixed point
+// mixers the float mix bus replaced.
+//
+// The output of every level is checked against the scalar float mixers
+// within a couple of samples. It is also checked against the fixed point
+// mixers, which truncate the scaled sample of every voice, within one sample
+// per voice; that is done in a second, untimed pass where every voice is
+// already at its goal volume, since the fixed point ramp stops a little
+// short of the goal. The voice volumes are low enough for the mix not to
+// clip, because the fixed point mixers clamp after every voice instead of
+// once per buffer.
+
+#include "compat.h"
+#include "baselayer.h"
+#include "build.h"
+#include "build_cpuid.h"
+#include "osd.h"
+#include "_multivc.h"
+
+#include <chrono>
+
+#ifdef POLYMER
+# include "polymer.h"
+#endif
+
+// hooks the engine expects from the application
+const char *G_DefaultDefFile(void) { return "mixbench.def"; }
+void app_crashhandler(void) { }
+void faketimerhandler(void) { }
+int osdcmd_restartvid(osdcmdptr_t) { return OSDCMD_OK; }
+extern "C" void M32RunScript(const char *s) { UNREFERENCED_PARAMETER(s); }
+#ifdef POLYMER
+void G_Polymer_UnInit(void) { }
+#endif
+
+#define NUMLEVELS (MV_MIXSIMD_VEC8+1)
+#define SOUNDFRAMES (1<<16)
+
+// fixed point mixers as they were before the float mix bus
+template <typename S, int SRCCH, int DSTCH>
+static uint32_t fixedmix(VoiceNode * const voice, int16_t *dest, uint32_t length)
+{
+    auto const *source = (S const *)voice->sound;
+
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    fix16_t const  volume   = fix16_fast_trunc_mul(voice->volume, MV_GlobalVolume);
+
+    do
+    {
+        int const frame = (position >> 16) * SRCCH;
+        auto const isample0 = CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(source[frame]);
+        auto const isample1 = SRCCH == 2 ? CONVERT_LE_SAMPLE_TO_SIGNED<S, int16_t>(source[frame + 1]) : isample0;
+
+        position += rate;
+
+        if (DSTCH == 1)
+            *dest = MIX_SAMPLES<int16_t>(SCALE_SAMPLE(SRCCH == 2 ? (isample0 + isample1) >> 1 : isample0,
+                                                      fix16_fast_trunc_mul(volume, voice->PannedVolume.Left)), *dest);
+        else
+        {
+            dest[0] = MIX_SAMPLES<int16_t>(SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left)), dest[0]);
+            dest[1] = MIX_SAMPLES<int16_t>(SCALE_SAMPLE(isample1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Right)), dest[1]);
+        }
+
+        dest += DSTCH;
+
+        voice->PannedVolume = { SMOOTH_VOLUME(voice->PannedVolume.Left, voice->GoalVolume.Left), SMOOTH_VOLUME(voice->PannedVolume.Right, voice->GoalVolume.Right) };
+    }
+    while (--length);
+
+    return position;
+}
+
+typedef uint32_t (*fixedmixfunc_t)(VoiceNode *, int16_t *, uint32_t);
+
+// in the order of mixsimd_t::mix
+static fixedmixfunc_t const fixedmixfuncs[8] =
+{
+    fixedmix<uint8_t, 1, 2>, fixedmix<uint8_t, 1, 1>, fixedmix<int16_t, 1, 2>, fixedmix<int16_t, 1, 1>,
+    fixedmix<uint8_t, 2, 2>, fixedmix<uint8_t, 2, 1>, fixedmix<int16_t, 2, 2>, fixedmix<int16_t, 2, 1>,
+};
+
+typedef struct
+{
+    int      type;  // index into mixsimd_t::mix
+    uint32_t rate;
+    fix16_t  volume;
+    fix16_t  start[2];
+    fix16_t  goal[2];
+} voicesetup_t;
+
+static uint32_t randseed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+    randseed = randseed * 1664525 + 1013904223;
+    return (uint32_t)(((uint64_t)(randseed >> 8) * n) >> 24);
+}
+
+static void resetvoices(VoiceNode *voices, voicesetup_t const *setup, char *const *sounds, int numvoices, bool ramps)
+{
+    for (int i = 0; i < numvoices; i++)
+    {
+        auto &v = voices[i];
+        auto const &s = setup[i];
+
+        v.sound        = sounds[i];
+        v.position     = 0;
+        v.RateScale    = s.rate;
+        v.volume       = s.volume;
+        v.PannedVolume = ramps ? decltype(v.PannedVolume){ s.start[0], s.start[1] } : decltype(v.PannedVolume){ s.goal[0], s.goal[1] };
+        v.GoalVolume   = { s.goal[0], s.goal[1] };
+    }
+}
+
+// starts the voices over before they would run past the end of their sound
+static void rewindvoices(VoiceNode *voices, int numvoices)
+{
+    for (int i = 0; i < numvoices; i++)
+    {
+        auto &v = voices[i];
+
+        if ((v.position >> 16) + (uint32_t)(((uint64_t)v.RateScale * MV_MIXBUFFERSIZE) >> 16) + 2 >= SOUNDFRAMES)
+            v.position &= 0xffff;
+    }
+}
+
+// a new goal every 16 buffers keeps some of the voices ramping
+static void panvoices(VoiceNode *voices, voicesetup_t const *setup, int numvoices, int buffer)
+{
+    if (buffer & 15)
+        return;
+
+    for (int i = (buffer >> 4) % 3; i < numvoices; i += 3)
+    {
+        auto &v = voices[i];
+        auto const &s = setup[i];
+
+        v.GoalVolume = (buffer >> 4) & 1 ? decltype(v.GoalVolume){ s.start[0], s.start[1] } : decltype(v.GoalVolume){ s.goal[0], s.goal[1] };
+    }
+}
+
+typedef struct
+{
+    VoiceNode         *voices;
+    voicesetup_t const *setup;
+    char *const       *sounds;
+    float             *bus;
+    int numvoices, numbuffers, samples;
+} mixjob_t;
+
+// mixes all of the buffers with the fixed point mixers for level < 0, returns the time it took
+static double mixall(mixjob_t const &job, int level, bool ramps, int16_t *out)
+{
+    VoiceNode *const voices = job.voices;
+
+    resetvoices(voices, job.setup, job.sounds, job.numvoices, ramps);
+
+    if (level >= 0)
+        MV_MixSimdInit(level);
+
+    Bmemset(out, 0, (size_t)job.numbuffers * job.samples * sizeof(int16_t));
+
+    auto const t0 = std::chrono::steady_clock::now();
+
+    for (int b = 0; b < job.numbuffers; b++)
+    {
+        int16_t *const dest = &out[b * job.samples];
+
+        rewindvoices(voices, job.numvoices);
+
+        if (ramps)
+            panvoices(voices, job.setup, job.numvoices, b);
+
+        if (level >= 0)
+            Bmemset(job.bus, 0, job.samples * sizeof(float));
+
+        // every voice is mixed in two calls, like MV_Mix() does at the end of a block, so that the kernels also
+        // get lengths that are not a multiple of their vector size
+        for (int i = 0; i < job.numvoices; i++)
+        {
+            auto &v = voices[i];
+            uint32_t const split = 1 + (b * 37 + i * 11) % (MV_MIXBUFFERSIZE - 1);
+
+            if (level < 0)
+            {
+                auto const mix = fixedmixfuncs[job.setup[i].type];
+
+                v.position = mix(&v, dest, split);
+                v.position = mix(&v, dest + split * job.samples / MV_MIXBUFFERSIZE, MV_MIXBUFFERSIZE - split);
+                continue;
+            }
+
+            auto const mix = MV_MixSimd.mix[job.setup[i].type];
+
+            MV_MixDestination = job.bus;
+            v.position = mix(&v, split);
+            v.position = mix(&v, MV_MIXBUFFERSIZE - split);
+        }
+
+        if (level < 0)
+            continue;
+
+        MV_MixSimd.topcm(dest, job.bus, job.samples);
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static int maxdifference(int16_t const *a, int16_t const *b, int count, double *mean)
+{
+    int maxdiff = 0;
+    double sum = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        int const diff = klabs(a[i] - b[i]);
+
+        maxdiff = max(maxdiff, diff);
+        sum += diff;
+    }
+
+    if (mean)
+        *mean = sum / count;
+
+    return maxdiff;
+}
+
+static void usage(void)
+{
+    Bprintf("usage: mixbench [-v <voices>] [-n <buffers>] [-r <rate>] [-c <channels>]\n");
+    Bprintf("   Mixes <voices> voices (default 64) into <buffers> buffers (default 4000) of\n");
+    Bprintf("   %d frames at <rate> Hz (default 48000) with 1 or 2 output channels\n", MV_MIXBUFFERSIZE);
+    Bprintf("   (default 2) with the old fixed point mixers and with every mixer level the\n");
+    Bprintf("   CPU supports, checks that the output matches and prints the mixing speed.\n");
+}
+
+int app_main(int argc, char const * const * argv)
+{
+    int numvoices = 64, numbuffers = 4000, mixrate = 48000, channels = 2;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc)
+        {
+            int const arg = Batoi(argv[++i]);
+
+            switch (argv[i-1][1])
+            {
+            case 'v': numvoices = clamp(arg, 1, MV_MAXVOICES); break;
+            case 'n': numbuffers = max(1, arg); break;
+            case 'r': mixrate = clamp(arg, 8000, 192000); break;
+            case 'c': channels = clamp(arg, 1, 2); break;
+            default: usage(); return 1;
+            }
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    sysReadCPUID();
+
+    int const maxlevel = MV_MixSimdInit(MV_MIXSIMD_VEC8);
+    int const samples  = MV_MIXBUFFERSIZE * channels;
+
+    MV_GlobalVolume       = fix16_one;
+    MV_VolumeSmoothFactor = fix16_from_float(1.f - powf(0.1f, 30.f / mixrate));
+
+    auto const voices = new VoiceNode[numvoices]();
+    auto const setup  = (voicesetup_t *)Xcalloc(numvoices, sizeof(voicesetup_t));
+    auto const sounds = (char **)Xcalloc(numvoices, sizeof(char *));
+
+    static uint32_t const samplerates[] = { 8000, 11025, 22050, 44100, 48000 };
+
+    // the loudest each voice can be without the sum of all of them clipping
+    fix16_t const maxvolume = fix16_one / numvoices;
+
+    for (int i = 0; i < numvoices; i++)
+    {
+        auto &s = setup[i];
+
+        s.type   = (channels == 1) | (i & 6);
+        s.rate   = (uint32_t)(((uint64_t)samplerates[rnd(ARRAY_SIZE(samplerates))] * (49152 + rnd(32768)) / mixrate));
+        s.volume = fix16_one;
+
+        for (int c = 0; c < 2; c++)
+        {
+            s.start[c] = rnd(maxvolume + 1);
+            s.goal[c]  = rnd(maxvolume + 1);
+        }
+
+        int const bytes = SOUNDFRAMES * (1 + ((s.type >> 1) & 1)) * (1 + ((s.type >> 2) & 1));
+
+        sounds[i] = (char *)Xmalloc(bytes);
+
+        for (int j = 0; j < bytes; j++)
+            sounds[i][j] = rnd(256);
+    }
+
+    int const total = numbuffers * samples;
+    int16_t *out[NUMLEVELS+1];
+
+    for (auto &o : out)
+        o = (int16_t *)Xmalloc(total * sizeof(int16_t));
+
+    // out[0] is the fixed point mixers, out[level+1] the float ones
+    mixjob_t const job = { voices, setup, sounds, (float *)Xaligned_alloc(32, samples * sizeof(float)), numvoices, numbuffers, samples };
+    double seconds[NUMLEVELS+1] = {};
+
+    for (int level = -1; level <= maxlevel; level++)
+        seconds[level+1] = mixall(job, level, true, out[level+1]);
+
+    int scalardiff[NUMLEVELS];
+
+    for (int level = MV_MIXSIMD_SCALAR; level <= maxlevel; level++)
+        scalardiff[level] = maxdifference(out[level+1], out[MV_MIXSIMD_SCALAR+1], total, nullptr);
+
+    // the fixed point ramp stops short of the goal volume once the step rounds down to 0, so the
+    // comparison with the fixed point mixers is done with voices that are already at their goal
+    int fixeddiff[NUMLEVELS];
+    double fixedmean[NUMLEVELS];
+
+    for (int level = -1; level <= maxlevel; level++)
+    {
+        mixall(job, level, false, out[level+1]);
+
+        if (level >= 0)
+            fixeddiff[level] = maxdifference(out[level+1], out[0], total, &fixedmean[level]);
+    }
+
+    double const frames = (double)numbuffers * MV_MIXBUFFERSIZE * numvoices;
+    int failed = 0;
+
+    Bprintf("%d voices, %d buffers of %d frames, %d channel output at %d Hz:\n", numvoices, numbuffers, MV_MIXBUFFERSIZE, channels, mixrate);
+    Bprintf("  %-12s %8.2f us/buffer %8.1f voice frames/us\n", "fixed point", seconds[0] * 1e6 / numbuffers, frames / (seconds[0] * 1e6));
+
+    for (int level = MV_MIXSIMD_SCALAR; level <= maxlevel; level++)
+    {
+        bool const ok = fixeddiff[level] <= numvoices && scalardiff[level] <= 2;
+
+        Bprintf("  %-12s %8.2f us/buffer %8.1f voice frames/us %5.2fx  difference from fixed point: max %d mean %.2f, from scalar: max %d%s\n",
+                MV_MixSimdName(level), seconds[level+1] * 1e6 / numbuffers, frames / (seconds[level+1] * 1e6), seconds[0] / seconds[level+1],
+                fixeddiff[level], fixedmean[level], scalardiff[level], ok ? "" : "  FAILED");
+
+        failed += !ok;
+    }
+
+    for (auto &o : out)
+        Xfree(o);
+
+    Xaligned_free(job.bus);
+
+    for (int i = 0; i < numvoices; i++)
+        Xfree(sounds[i]);
+
+    Xfree(sounds);
+    Xfree(setup);
+    delete[] voices;
+
+    return failed != 0;
+}
@@ -0,0 +1,698 @@
+// sndbench -- offline sound system benchmark
+//
+// Plays scripted sets of voices through MV_Init() and FX_Play() on the null
+// sound driver, which mixes a buffer whenever it is asked to instead of when
+// a device wants one, and reports for every set the time it took to mix a
+// buffer, the voices mixed per millisecond and, out of the mix time, the time
+// spent in each format's decoder and in the OPL3 MIDI synth.
+//
+// The voices loop and are started at random pitches and panning. WAV sounds
+// of every sample format, a four channel MOD module and a MIDI song are made
+// up on the spot; Vorbis and FLAC can't be, so those are benchmarked with the
+// files given on the command line, each of which gets a set of its own. The
+// last set plays everything at once.
+//
+// The decoded PCM cache is off unless -c is given, so that compressed sounds
+// are decoded while they are mixed, like music and long sounds always are.
+//
+// With -s, sndbench instead lets the null driver mix on its own thread in
+// real time while the main thread plays, stops, pans and repitches WAV
+// voices and now and then stops them all, thousands of times a second. At the
+// end, every voice that was started must have made exactly one callback,
+// every voice must be free again, and every command queued for the mixer
+// must have been carried out.
+
+#include "compat.h"
+#include "baselayer.h"
+#include "build.h"
+#include "build_cpuid.h"
+#include "driver_null.h"
+#include "fx_man.h"
+#include "music.h"
+#include "osd.h"
+#include "vfs.h"
+#include "_multivc.h"
+
+#include <atomic>
+#include <thread>
+
+#ifdef POLYMER
+# include "polymer.h"
+#endif
+
+// hooks the engine expects from the application
+const char *G_DefaultDefFile(void) { return "sndbench.def"; }
+void app_crashhandler(void) { }
+void faketimerhandler(void) { }
+int osdcmd_restartvid(osdcmdptr_t) { return OSDCMD_OK; }
+extern "C" void M32RunScript(const char *s) { UNREFERENCED_PARAMETER(s); }
+#ifdef POLYMER
+void G_Polymer_UnInit(void) { }
+#endif
+
+#define MAXSOUNDS 64
+
+typedef struct
+{
+    char    *data;
+    int32_t  length;
+    char     name[32];
+} sound_t;
+
+typedef struct
+{
+    char const *name;
+    int32_t     first, count;  // range of sounds[] played by the voices
+    bool        midi;
+} benchset_t;
+
+static sound_t sounds[MAXSOUNDS];
+static int32_t numsounds;
+
+static char   *midisong;
+static int32_t midisonglength;
+
+// voices whose sound has ended and has to be started again, set from the voice callback
+static bool voiceended[MV_MAXVOICES];
+
+// callbacks made during the stress test, from the mixer as well as from the main thread
+static std::atomic<uint32_t> stresscallbacks;
+
+static char const *const formatnames[] = { "unknown", "raw", "VOC", "WAV", "Vorbis", "FLAC", "XA", "XMP", "cached PCM" };
+EDUKE32_STATIC_ASSERT(ARRAY_SIZE(formatnames) == FMT_MAX);
+
+static uint32_t randseed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+    randseed = randseed * 1664525 + 1013904223;
+    return (uint32_t)(((uint64_t)(randseed >> 8) * n) >> 24);
+}
+
+typedef struct
+{
+    char   *data;
+    int32_t length, size;
+} membuf_t;
+
+static void put8(membuf_t *b, int v)
+{
+    if (b->length == b->size)
+    {
+        b->size = max(b->size << 1, 4096);
+        b->data = (char *)Xrealloc(b->data, b->size);
+    }
+
+    b->data[b->length++] = (char)v;
+}
+
+static void put16le(membuf_t *b, int v) { put8(b, v); put8(b, v >> 8); }
+static void put32le(membuf_t *b, int v) { put16le(b, v); put16le(b, v >> 16); }
+static void put16be(membuf_t *b, int v) { put8(b, v >> 8); put8(b, v); }
+static void put32be(membuf_t *b, int v) { put16be(b, v >> 16); put16be(b, v); }
+static void putstr(membuf_t *b, char const *s, int32_t len) { while (len--) put8(b, *s ? *s++ : 0); }
+
+static void addsound(char *data, int32_t length, char const *name)
+{
+    if (numsounds == MAXSOUNDS)
+    {
+        Xfree(data);
+        return;
+    }
+
+    auto &s = sounds[numsounds++];
+
+    s.data   = data;
+    s.length = length;
+    Bstrncpyz(s.name, name, sizeof(s.name));
+}
+
+// a second of a chord with a little noise on top, so that the voices don't all sound alike
+static void makewav(int bits, int channels, int rate)
+{
+    membuf_t b = {};
+    int const frames   = rate;
+    int const datasize = frames * channels * (bits >> 3);
+
+    putstr(&b, "RIFF", 4);
+    put32le(&b, 36 + datasize);
+    putstr(&b, "WAVEfmt ", 8);
+    put32le(&b, 16);
+    put16le(&b, 1);
+    put16le(&b, channels);
+    put32le(&b, rate);
+    put32le(&b, rate * channels * (bits >> 3));
+    put16le(&b, channels * (bits >> 3));
+    put16le(&b, bits);
+    putstr(&b, "data", 4);
+    put32le(&b, datasize);
+
+    float const freq = 110.f * (1 + rnd(4));
+
+    for (int i = 0; i < frames; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            float const t = (float)i / rate;
+            float const v = 0.3f * sinf(2.f * fPI * freq * t) + 0.2f * sinf(2.f * fPI * freq * (1.5f + c * 0.01f) * t)
+                          + 0.05f * ((int)rnd(2001) - 1000) / 1000.f;
+
+            if (bits == 8)
+                put8(&b, 128 + (int)(v * 127.f));
+            else
+                put16le(&b, (int)(v * 32767.f));
+        }
+    }
+
+    char name[32];
+    Bsnprintf(name, sizeof(name), "%d-bit %s WAV", bits, channels == 1 ? "mono" : "stereo");
+    addsound(b.data, b.length, name);
+}
+
+#ifdef HAVE_XMP
+// a ProTracker module with one looped waveform playing arpeggios on all four channels
+static void makemod(void)
+{
+    static int const periods[] = { 428, 381, 339, 320, 285, 254, 226, 214 };
+    int const samplelength = 64;
+
+    membuf_t b = {};
+
+    putstr(&b, "sndbench", 20);
+
+    for (int i = 0; i < 31; i++)
+    {
+        bool const used = i == 0;
+
+        putstr(&b, used ? "saw" : "", 22);
+        put16be(&b, used ? samplelength >> 1 : 0);
+        put8(&b, 0);
+        put8(&b, used ? 48 : 0);
+        put16be(&b, 0);
+        put16be(&b, used ? samplelength >> 1 : 1);
+    }
+
+    put8(&b, 1);
+    put8(&b, 127);
+    putstr(&b, "", 128);
+    putstr(&b, "M.K.", 4);
+
+    for (int row = 0; row < 64; row++)
+    {
+        for (int chan = 0; chan < 4; chan++)
+        {
+            if ((row + chan) & 1)
+            {
+                put32be(&b, 0);
+                continue;
+            }
+
+            int const period = periods[(row / 2 + chan * 2) & 7] << (chan == 0);
+
+            put8(&b, (period >> 8) & 15);
+            put8(&b, period & 255);
+            put8(&b, 1 << 4);
+            put8(&b, 0);
+        }
+    }
+
+    for (int i = 0; i < samplelength; i++)
+        put8(&b, (i * 256 / samplelength) - 128);
+
+    addsound(b.data, b.length, "MOD module");
+}
+#endif
+
+static void putvarlen(membuf_t *b, uint32_t v)
+{
+    uint8_t bytes[5];
+    int n = 0;
+
+    do
+        bytes[n++] = v & 127;
+    while ((v >>= 7) != 0);
+
+    while (n-- > 1)
+        put8(b, bytes[n] | 128);
+
+    put8(b, bytes[0]);
+}
+
+// eight bars of chords, bass and drums, for the OPL3 synth
+static void makemidi(void)
+{
+    static int const chords[4][3] = { { 60, 64, 67 }, { 65, 69, 72 }, { 67, 71, 74 }, { 57, 60, 64 } };
+
+    membuf_t track = {};
+
+    // 120 bpm, piano, fingered bass
+    putvarlen(&track, 0); put8(&track, 0xff); put8(&track, 0x51); put8(&track, 3); put8(&track, 0x07); put8(&track, 0xa1); put8(&track, 0x20);
+    putvarlen(&track, 0); put8(&track, 0xc0); put8(&track, 0);
+    putvarlen(&track, 0); put8(&track, 0xc1); put8(&track, 33);
+
+    for (int beat = 0; beat < 32; beat++)
+    {
+        auto const &chord = chords[(beat >> 3) & 3];
+
+        for (int i = 0; i < 3; i++)
+        {
+            putvarlen(&track, 0); put8(&track, 0x90); put8(&track, chord[i]); put8(&track, 90);
+        }
+
+        putvarlen(&track, 0); put8(&track, 0x91); put8(&track, chord[beat & 1] - 24); put8(&track, 100);
+        putvarlen(&track, 0); put8(&track, 0x99); put8(&track, beat & 1 ? 38 : 36); put8(&track, 110);
+        putvarlen(&track, 0); put8(&track, 0x99); put8(&track, 42); put8(&track, 80);
+
+        putvarlen(&track, 90);
+
+        for (int i = 0; i < 3; i++)
+        {
+            put8(&track, 0x80); put8(&track, chord[i]); put8(&track, 0);
+            putvarlen(&track, 0);
+        }
+
+        put8(&track, 0x81); put8(&track, chord[beat & 1] - 24); put8(&track, 0);
+        putvarlen(&track, 6);
+        put8(&track, 0x89); put8(&track, beat & 1 ? 38 : 36); put8(&track, 0);
+        putvarlen(&track, 0);
+        put8(&track, 0x89); put8(&track, 42); put8(&track, 0);
+    }
+
+    putvarlen(&track, 0); put8(&track, 0xff); put8(&track, 0x2f); put8(&track, 0);
+
+    membuf_t b = {};
+
+    putstr(&b, "MThd", 4);
+    put32be(&b, 6);
+    put16be(&b, 0);
+    put16be(&b, 1);
+    put16be(&b, 96);
+    putstr(&b, "MTrk", 4);
+    put32be(&b, track.length);
+
+    for (int i = 0; i < track.length; i++)
+        put8(&b, track.data[i]);
+
+    Xfree(track.data);
+
+    midisong       = b.data;
+    midisonglength = b.length;
+}
+
+static int loadsound(char const *fn)
+{
+    buildvfs_FILE fp = buildvfs_fopen_read(fn);
+
+    if (fp == nullptr)
+        return -1;
+
+    int32_t const length = (int32_t)buildvfs_flength(fp);
+    auto data = (char *)Xmalloc(max(length, 1));
+
+    if (length <= 0 || buildvfs_fread(data, length, 1, fp) != 1)
+    {
+        buildvfs_fclose(fp);
+        Xfree(data);
+        return -1;
+    }
+
+    buildvfs_fclose(fp);
+
+    char const *name = Bstrrchr(fn, '/');
+    addsound(data, length, name ? name + 1 : fn);
+
+    return 0;
+}
+
+static void voicecallback(intptr_t voice)
+{
+    voiceended[voice] = true;
+}
+
+static int startvoice(benchset_t const &set, int voice)
+{
+    auto const &s = sounds[set.first + voice % set.count];
+
+    int const pitch = (int)rnd(1201) - 600;
+    int const left  = 128 + rnd(128);
+    int const right = 128 + rnd(128);
+
+    voiceended[voice] = false;
+
+    return FX_Play(s.data, s.length, FX_LOOP, 0, pitch, 255, left, right, 1 + rnd(254), fix16_one, voice);
+}
+
+static void restartvoices(benchset_t const &set, int numvoices)
+{
+    for (int i = 0; i < numvoices; i++)
+    {
+        if (voiceended[i])
+            startvoice(set, i);
+    }
+}
+
+// runs one set, returns 0 when every voice could be started
+static int runset(benchset_t const &set, int numvoices, int numbuffers, int warmup)
+{
+    numvoices = set.count ? numvoices : 0;
+
+    for (int i = 0; i < numvoices; i++)
+    {
+        if (startvoice(set, i) <= 0)
+        {
+            Bprintf("  %-16s error starting %s: %s\n", set.name, sounds[set.first + i % set.count].name, FX_ErrorString(FX_Error));
+            FX_StopAllSounds();
+            return -1;
+        }
+    }
+
+    if (set.midi && MUSIC_PlaySong(midisong, midisonglength, MUSIC_LoopSong) != MUSIC_Ok)
+    {
+        Bprintf("  %-16s error starting the MIDI song: %s\n", set.name, MUSIC_ErrorString(MUSIC_ErrorCode));
+        FX_StopAllSounds();
+        return -1;
+    }
+
+    // Vorbis and XMP voices are set up on another thread, they only start playing once that is done
+    uint64_t const timeout = timerGetNanoTicks() + timerGetNanoTickRate() * 10;
+
+    while (FX_SoundsPlaying() < numvoices)
+    {
+        if (timerGetNanoTicks() > timeout)
+        {
+            Bprintf("  %-16s only %d of %d voices started\n", set.name, FX_SoundsPlaying(), numvoices);
+            FX_StopAllSounds();
+            return -1;
+        }
+
+        NullDrv_PCM_Pull(1);
+        restartvoices(set, numvoices);
+        std::this_thread::yield();
+    }
+
+    NullDrv_PCM_Pull(warmup);
+    restartvoices(set, numvoices);
+
+    mixstats_t stats;
+    MV_GetMixStats(&stats, true);
+
+    for (int i = 0; i < numbuffers; i++)
+    {
+        NullDrv_PCM_Pull(1);
+        restartvoices(set, numvoices);
+    }
+
+    MV_GetMixStats(&stats, true);
+
+    if (set.midi)
+        MUSIC_StopSong();
+
+    FX_StopAllSounds();
+
+    double const totalus = stats.totaltime / 1000.0;
+    double const bufferus = totalus / stats.buffers;
+
+    Bprintf("  %-16s %6.1f %10.2f %10.2f %6u %12.1f\n", set.name, (double)stats.voicemixes / stats.buffers, bufferus,
+            stats.maxtime / 1000.0, stats.misses, stats.voicemixes / (totalus / 1000.0));
+
+    for (int i = 0; i < FMT_MAX; i++)
+    {
+        if (stats.decodetime[i] == 0 || i == FMT_RAW || i == FMT_WAV || i == FMT_VOC || i == FMT_PCM)
+            continue;
+
+        double const decodeus = stats.decodetime[i] / 1000.0 / stats.buffers;
+        Bprintf("  %16s %-12s decoder %9.2f us/buffer, %4.1f%% of the mix time\n", "", formatnames[i], decodeus, 100.0 * decodeus / bufferus);
+    }
+
+    if (set.midi)
+    {
+        double const musicus = stats.musictime / 1000.0 / stats.buffers;
+        Bprintf("  %16s %-12s synth   %9.2f us/buffer, %4.1f%% of the mix time\n", "", "OPL3 MIDI", musicus, 100.0 * musicus / bufferus);
+    }
+
+    return 0;
+}
+
+static void stresscallback(intptr_t)
+{
+    stresscallbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+// hammers the voice calls from this thread while the null driver's own thread mixes, returns 0 if nothing leaked
+static int stresstest(int numwavs, int numvoices, int seconds)
+{
+    int handles[MV_MAXVOICES] = {};
+    uint32_t plays = 0, started = 0, stops = 0, stopalls = 0, others = 0;
+
+    FX_StopAllSounds();
+    FX_SetCallBack(stresscallback);
+
+    mixstats_t stats;
+    MV_GetMixStats(&stats, true);
+
+    uint64_t const starttime = timerGetNanoTicks();
+    uint64_t const endtime   = starttime + timerGetNanoTickRate() * seconds;
+
+    while (timerGetNanoTicks() < endtime)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            int &handle = handles[rnd(numvoices)];
+            uint32_t const op = rnd(1000);
+
+            if (op == 0)
+            {
+                FX_StopAllSounds();
+                stopalls++;
+            }
+            else if (op == 1 && handle > 0)
+            {
+                // more commands in a row than the ring holds, without a play in between to flush it
+                for (int j = 0; j < 4096; j++)
+                    FX_SetPan(handle, 255, 128 + rnd(128), 128 + rnd(128));
+                others += 4096;
+            }
+            else if (op < 500)
+            {
+                auto const &s = sounds[rnd(numwavs)];
+                int const h = FX_Play(s.data, s.length, rnd(4) ? FX_ONESHOT : FX_LOOP, 0, (int)rnd(1201) - 600, 255,
+                                      128 + rnd(128), 128 + rnd(128), 1 + rnd(254), fix16_one, 0);
+                plays++;
+
+                if (h > 0)
+                {
+                    handle = h;
+                    started++;
+                }
+            }
+            else if (handle == 0)
+                continue;  // nothing was started in this slot yet
+            else if (op < 800)
+            {
+                // the handle may well be stale by now, which has to be harmless
+                FX_StopSound(handle);
+                stops++;
+            }
+            else
+            {
+                if (op & 1)
+                    FX_SetPan(handle, 255, 128 + rnd(128), 128 + rnd(128));
+                else
+                    FX_SetPitch(handle, (int)rnd(1201) - 600);
+                others++;
+            }
+        }
+    }
+
+    double const elapsed = (double)(timerGetNanoTicks() - starttime) / timerGetNanoTickRate();
+
+    FX_StopAllSounds();
+
+    int usedhandles;
+    int const freevoices = MV_GetFreeVoices(&usedhandles);
+
+    MV_GetMixStats(&stats, true);
+    FX_SetCallBack(voicecallback);
+
+    uint32_t const callbacks = stresscallbacks.exchange(0, std::memory_order_relaxed);
+    uint32_t const calls     = plays + stops + stopalls + others;
+
+    Bprintf("stress test: %u calls in %.1f s, %.0f per second, while %u buffers were mixed\n", calls, elapsed, calls / elapsed, stats.buffers);
+    Bprintf("  %u plays (%u started), %u stops, %u stop-alls, %u pan and pitch changes\n", plays, started, stops, stopalls, others);
+    Bprintf("  %" PRIu64 " commands queued, %" PRIu64 " carried out, ring full %u times, %u dropped\n", stats.commands,
+            stats.commandsrun, stats.ringfull, stats.dropped);
+    Bprintf("  %u callbacks, %d of %d voices free, %d handles in use\n", callbacks, freevoices, MV_MaxVoices, usedhandles);
+
+    int failed = 0;
+
+    if (callbacks != started)
+    {
+        Bprintf("  error: %u voices were started but %u callbacks were made\n", started, callbacks);
+        failed++;
+    }
+
+    if (freevoices != MV_MaxVoices || usedhandles != 0)
+    {
+        Bprintf("  error: %d voices and %d handles leaked\n", MV_MaxVoices - freevoices, usedhandles);
+        failed++;
+    }
+
+    if (stats.dropped != 0 || stats.commands != stats.commandsrun)
+    {
+        Bprintf("  error: %u commands dropped, %" PRIu64 " never carried out\n", stats.dropped, stats.commands - stats.commandsrun);
+        failed++;
+    }
+
+    return failed;
+}
+
+static void usage(void)
+{
+    Bprintf("usage: sndbench [options] [sound files]\n"
+            "  -v <n>      voices per set (default 32)\n"
+            "  -n <n>      buffers mixed per set (default 2000)\n"
+            "  -w <n>      warm-up buffers that are not measured (default 100)\n"
+            "  -r <n>      mix rate (default 48000)\n"
+            "  -m <n>      output channels (default 2)\n"
+            "  -t <n>      mix threads (default 1)\n"
+            "  -o <file>   write everything that was mixed to a WAV file\n"
+            "  -c          keep the decoded PCM cache on\n"
+            "  -s <n>      run the stress test for this many seconds instead\n");
+}
+
+int app_main(int argc, char const * const * argv)
+{
+    int numvoices = 32, numbuffers = 2000, warmup = 100, mixrate = 48000, channels = 2, stressseconds = 0;
+    bool pcmcache = false;
+
+    sysReadCPUID();
+    initdivtables();
+
+    for (int i = 0; i < 3; i++)
+        makewav(8 << (i & 1), 1 + (i >> 1), i ? 22050 : 11025);
+    makewav(16, 2, 44100);
+
+    int32_t const numwavs = numsounds;
+
+#ifdef HAVE_XMP
+    makemod();
+#endif
+    int32_t const firstfile = numsounds;
+
+    makemidi();
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            if (loadsound(argv[i]))
+            {
+                Bprintf("error reading %s\n", argv[i]);
+                return 1;
+            }
+
+            continue;
+        }
+
+        if (!Bstrcmp(argv[i], "-c"))
+        {
+            pcmcache = true;
+            continue;
+        }
+
+        if (argv[i][1] == 0 || argv[i][2] != 0 || i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+
+        char const *const arg = argv[++i];
+
+        switch (argv[i-1][1])
+        {
+            case 'v': numvoices = clamp(Batoi(arg), 1, MV_MAXVOICES - 2); break;
+            case 'n': numbuffers = max(1, Batoi(arg)); break;
+            case 'w': warmup = max(0, Batoi(arg)); break;
+            case 'r': mixrate = clamp(Batoi(arg), 8000, 192000); break;
+            case 'm': channels = clamp(Batoi(arg), 1, 2); break;
+            case 't': MV_MixThreads = clamp(Batoi(arg), 1, MV_MAXMIXTHREADS); break;
+            case 'o': Bstrncpyz(NullDrv_WAVFile, arg, sizeof(NullDrv_WAVFile)); break;
+            case 's': stressseconds = max(1, Batoi(arg)); break;
+            default: usage(); return 1;
+        }
+    }
+
+    if (!pcmcache)
+        MV_PCMCacheSize = 0;
+
+    // the stress test needs the mixer running on its own at the pace of a sound card, so that the command ring fills
+    // up; the benchmark pulls every buffer itself
+    NullDrv_Speed = stressseconds ? 100 : -1;
+
+    if (MV_Init(ASS_Null, mixrate, numvoices + 1, channels, nullptr) != MV_Ok)
+    {
+        Bprintf("error initializing sound: %s\n", MV_ErrorString(MV_Error));
+        return 1;
+    }
+
+    FX_SetCallBack(voicecallback);
+    FX_SetVolume(255);
+
+    if (stressseconds)
+    {
+        Bprintf("%d voices, %d channel output at %d Hz, %d mix thread%s\n", numvoices + 1, channels, mixrate, MV_MixThreads,
+                MV_MixThreads > 1 ? "s" : "");
+
+        int const failed = stresstest(numwavs, numvoices, stressseconds);
+
+        MV_Shutdown();
+
+        for (int i = 0; i < numsounds; i++)
+            Xfree(sounds[i].data);
+
+        Xfree(midisong);
+
+        return failed != 0;
+    }
+
+    bool const midi = MUSIC_Init(ASS_OPL3) == MUSIC_Ok;
+
+    if (midi)
+        MUSIC_SetVolume(255);
+
+    benchset_t sets[MAXSOUNDS + 4];
+    int numsets = 0;
+
+    sets[numsets++] = { "WAV", 0, numwavs, false };
+#ifdef HAVE_XMP
+    sets[numsets++] = { "MOD (XMP)", numwavs, 1, false };
+#endif
+    if (midi)
+        sets[numsets++] = { "OPL3 MIDI", 0, 0, true };
+
+    for (int i = firstfile; i < numsounds; i++)
+        sets[numsets++] = { sounds[i].name, i, 1, false };
+
+    sets[numsets++] = { "everything", 0, numsounds, midi };
+
+    Bprintf("%d voices per set, %d buffers of %d frames, %d channel output at %d Hz, %d mix thread%s%s\n", numvoices, numbuffers,
+            MV_MIXBUFFERSIZE, channels, mixrate, MV_MixThreads, MV_MixThreads > 1 ? "s" : "", pcmcache ? ", PCM cache on" : "");
+    Bprintf("  %-16s %6s %10s %10s %6s %12s\n", "set", "voices", "us/buffer", "max us", "late", "voices/ms");
+
+    int failed = 0;
+
+    for (int i = 0; i < numsets; i++)
+        failed += runset(sets[i], numvoices, numbuffers, warmup) != 0;
+
+    if (midi)
+        MUSIC_Shutdown();
+
+    MV_Shutdown();
+
+    for (int i = 0; i < numsounds; i++)
+        Xfree(sounds[i].data);
+
+    Xfree(midisong);
+
+    return failed != 0;
+}
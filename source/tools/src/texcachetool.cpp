@@ -0,0 +1,282 @@
+// texcachetool.cpp
+//  Checks texture caches and converts them to the current format, see texcachefmt.h.
+
+#include "compat.h"
+#include "texcachefmt.h"
+
+#include <algorithm>
+#include <vector>
+
+static char *readfile(char const *fn, int32_t *len)
+{
+    FILE *fp = fopen(fn, "rb");
+
+    if (!fp)
+        return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    *len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *buf = (char *)Xmalloc(max(*len, 1));
+
+    if (*len && fread(buf, *len, 1, fp) != 1)
+        DO_FREE_AND_NULL(buf);
+
+    fclose(fp);
+    return buf;
+}
+
+// Returns the records of the index of the cache, the current one for each key only.
+static int loadindex(char const *cachefn, std::vector<texcacheindexrec> &recs)
+{
+    char fn[BMAX_PATH];
+    int32_t len;
+    char *buf;
+
+    Bsnprintf(fn, sizeof(fn), "%s.index2", cachefn);
+
+    if ((buf = readfile(fn, &len)))
+    {
+        int32_t numsorted;
+        int32_t const numrecs = texcache_checkindex(buf, len, &numsorted);
+
+        if (numrecs < 0)
+        {
+            Bprintf("%s: not a texture cache index\n", fn);
+            Xfree(buf);
+            return -1;
+        }
+
+        recs.resize(numrecs);
+
+        for (int i = 0; i < numrecs; i++)
+            texcache_getindexrec(buf, i, &recs[i]);
+
+        Bprintf("%s: %d records, %d of them sorted\n", fn, numrecs, numsorted);
+
+        if (int32_t const tail = texcache_indextail(len))
+            Bprintf("%s: ignoring a partial record of %d bytes at the end\n", fn, tail);
+    }
+    else
+    {
+        Bsnprintf(fn, sizeof(fn), "%s.index", cachefn);
+
+        if (!(buf = readfile(fn, &len)))
+        {
+            Bprintf("Error: no index for %s\n", cachefn);
+            return -1;
+        }
+
+        buf = (char *)Xrealloc(buf, len + 1);
+        buf[len] = 0;
+
+        for (char *line = buf, *next; line && *line; line = next)
+        {
+            char id[64];
+            int32_t offset, size;
+
+            if ((next = Bstrchr(line, '\n')))
+                *next++ = 0;
+
+            if (line[0] == '/' || sscanf(line, "%63s %d %d", id, &offset, &size) != 3)
+                continue;
+
+            recs.push_back({ texcache_idkey(id), (uint32_t)offset, (uint32_t)size });
+        }
+
+        Bprintf("%s: %d records in the text index of older versions\n", fn, (int)recs.size());
+    }
+
+    Xfree(buf);
+
+    std::stable_sort(recs.begin(), recs.end(), [](texcacheindexrec const &a, texcacheindexrec const &b) { return a.key < b.key; });
+
+    // keep the last record for each key
+    int num = 0;
+    for (int i = 0, n = recs.size(); i < n; i++)
+    {
+        if (i + 1 < n && recs[i + 1].key == recs[i].key)
+            continue;
+        recs[num++] = recs[i];
+    }
+    recs.resize(num);
+
+    return 0;
+}
+
+enum
+{
+    ENTRY_LZ41,
+    ENTRY_LZ42,
+    ENTRY_OTHER,
+    ENTRY_DAMAGED,
+    ENTRY_TYPES
+};
+
+static int checkentry(char const *data, int32_t datalen, texcacheindexrec const &r, texcacheheader *head, texcachemip *mips, int32_t *nummips)
+{
+    if (r.len == 0 || r.offset > (uint32_t)datalen || r.len > (uint32_t)datalen - r.offset)
+        return ENTRY_DAMAGED;
+
+    char const *const entry = data + r.offset;
+
+    if ((*nummips = texcache_parseentry(entry, r.len, head, mips)) < 0)
+        return ENTRY_DAMAGED;
+    if (*nummips == 0)
+        return ENTRY_OTHER;
+
+    for (int level = 0; level < *nummips; level++)
+    {
+        for (int c = 0; c < TEXCACHECHUNKS; c++)
+        {
+            int32_t const size = texcache_chunksize(&mips[level], c);
+
+            if (!size)
+                continue;
+
+            char *buf = (char *)Xmalloc(size);
+            int const err = texcache_unpackchunk(entry, &mips[level], c, buf, (head->flags & CACHEAD_COMPRESSED) != 0);
+            Xfree(buf);
+
+            if (err)
+                return ENTRY_DAMAGED;
+        }
+    }
+
+    return Bmemcmp(head->magic, TEXCACHEMAGIC2, 4) ? ENTRY_LZ41 : ENTRY_LZ42;
+}
+
+static int writefile(char const *fn, std::vector<char> const &buf)
+{
+    FILE *fp = fopen(fn, "wb");
+
+    if (!fp || (buf.size() && fwrite(buf.data(), buf.size(), 1, fp) != 1))
+    {
+        Bprintf("Error: could not write %s\n", fn);
+        if (fp)
+            fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool const convert = argc == 4 && !Bstrcmp(argv[1], "-c");
+
+    if (argc != 2 && !convert)
+    {
+        Bprintf("usage: texcachetool <cachefile>\n");
+        Bprintf("       texcachetool -c <cachefile> <newcachefile>\n");
+        Bprintf("   Checks every entry in the index of a texture cache, unpacking all of its\n");
+        Bprintf("   chunks. With -c, also writes the entries that are intact to a new cache,\n");
+        Bprintf("   textures in the current format, along with a sorted index.\n");
+        return 0;
+    }
+
+    engineCreateAllocator();
+
+    char const *const cachefn = argv[convert ? 2 : 1];
+    int32_t datalen;
+    char *data = readfile(cachefn, &datalen);
+
+    if (!data)
+    {
+        Bprintf("Error: %s could not be read\n", cachefn);
+        return 1;
+    }
+
+    std::vector<texcacheindexrec> recs;
+
+    if (loadindex(cachefn, recs))
+    {
+        Xfree(data);
+        return 1;
+    }
+
+    static char const *const typenames[ENTRY_TYPES] = { "LZ41 textures", "LZ42 textures", "other entries", "damaged entries" };
+    int count[ENTRY_TYPES] = {};
+    int64_t used = 0;
+
+    std::vector<char> newdata;
+    std::vector<texcacheindexrec> newrecs;
+    std::vector<char> chunks;
+
+    for (auto const &r : recs)
+    {
+        texcacheheader head;
+        texcachemip mips[TEXCACHEMAXMIPS];
+        int32_t nummips;
+        int const type = checkentry(data, datalen, r, &head, mips, &nummips);
+
+        count[type]++;
+
+        if (type == ENTRY_DAMAGED)
+        {
+            Bprintf("%016" PRIx64 ": damaged entry at %u, %u bytes\n", r.key, r.offset, r.len);
+            continue;
+        }
+
+        used += r.len;
+
+        if (!convert)
+            continue;
+
+        texcacheindexrec const newr = { r.key, (uint32_t)newdata.size(), 0 };
+        char const *const entry = data + r.offset;
+
+        if (type == ENTRY_OTHER)
+            newdata.insert(newdata.end(), entry, entry + r.len);
+        else
+        {
+            chunks.clear();
+
+            for (int level = 0; level < nummips; level++)
+                for (int c = 0; c < TEXCACHECHUNKS; c++)
+                {
+                    texcachemip &mip = mips[level];
+
+                    if (!mip.chunklen[c])
+                        continue;
+
+                    char const *const chunk = entry + mip.chunkofs[c];
+                    mip.chunkofs[c] = chunks.size();
+                    chunks.insert(chunks.end(), chunk, chunk + mip.chunklen[c]);
+                }
+
+            size_t const pos = newdata.size();
+            newdata.resize(pos + texcache_entryheadsize(nummips));
+            texcache_putentryhead(&newdata[pos], &head, mips, nummips);
+            newdata.insert(newdata.end(), chunks.begin(), chunks.end());
+        }
+
+        newrecs.push_back(newr);
+        newrecs.back().len = newdata.size() - newr.offset;
+    }
+
+    for (int i = 0; i < ENTRY_TYPES; i++)
+        Bprintf("%d %s\n", count[i], typenames[i]);
+
+    Bprintf("%" PRId64 " of %d bytes in use\n", used, datalen);
+
+    Xfree(data);
+
+    if (convert)
+    {
+        char fn[BMAX_PATH];
+        std::vector<char> index(TEXCACHEINDEXHEADSIZ + newrecs.size() * TEXCACHEINDEXRECSIZ);
+
+        texcache_putindex(index.data(), newrecs.data(), newrecs.size());
+        Bsnprintf(fn, sizeof(fn), "%s.index2", argv[3]);
+
+        if (writefile(argv[3], newdata) || writefile(fn, index))
+            return 1;
+
+        Bprintf("Wrote %d entries, %d bytes, to %s\n", (int)newrecs.size(), (int)newdata.size(), argv[3]);
+    }
+
+    return count[ENTRY_DAMAGED] != 0;
+}